@@ -20,8 +20,12 @@
 #include "runtime.h"
 #include "statemachine_mcbp.h"
 #include "mc_time.h"
+#include "mcbp_validators.h"
+#include "network_buffer_pool.h"
+#include "protocol/mcbp/engine_wrapper.h"
 
 #include <cctype>
+#include <cstring>
 #include <exception>
 #include <utilities/protocol2text.h>
 #include <platform/cb_malloc.h>
@@ -214,6 +218,7 @@ void McbpConnection::shrinkBuffers() {
         void* ptr = cb_realloc(read.buf, DATA_BUFFER_SIZE);
         char* newbuf = reinterpret_cast<char*>(ptr);
         if (newbuf) {
+            getThread()->bufferPool->resized(read.size, DATA_BUFFER_SIZE);
             read.buf = newbuf;
             read.size = DATA_BUFFER_SIZE;
         } else {
@@ -549,6 +554,7 @@ McbpConnection::TryReadResult McbpConnection::tryReadNetwork() {
                 setState(conn_closing);
                 return TryReadResult::MemoryError;
             }
+            getThread()->bufferPool->resized(read.size, read.size * 2);
             read.curr = read.buf = new_rbuf;
             read.size *= 2;
         }
@@ -706,6 +712,7 @@ void McbpConnection::addMsgHdr(bool reset) {
         msgcurr = 0;
         msglist.clear();
         iovused = 0;
+        iovbytes = 0;
     }
 
     msglist.emplace_back();
@@ -743,6 +750,7 @@ void McbpConnection::addIov(const void* buf, size_t len) {
     m->msg_iov[m->msg_iovlen].iov_len = len;
 
     msgbytes += len;
+    iovbytes += len;
     ++iovused;
     STATS_MAX(this, iovused_high_watermark, getIovUsed());
     m->msg_iovlen++;
@@ -784,9 +792,13 @@ McbpConnection::McbpConnection(SOCKET sfd, event_base *b)
       rlbytes(0),
       iov(IOV_LIST_INITIAL),
       iovused(0),
+      iovbytes(0),
       msglist(),
       msgcurr(0),
       msgbytes(0),
+      valueItemData(nullptr),
+      valueItemLength(0),
+      valueItemReceived(0),
       noreply(false),
       supports_datatype(false),
       supports_mutation_extras(false),
@@ -829,9 +841,13 @@ McbpConnection::McbpConnection(SOCKET sfd,
       rlbytes(0),
       iov(IOV_LIST_INITIAL),
       iovused(0),
+      iovbytes(0),
       msglist(),
       msgcurr(0),
       msgbytes(0),
+      valueItemData(nullptr),
+      valueItemLength(0),
+      valueItemReceived(0),
       noreply(false),
       supports_datatype(false),
       supports_mutation_extras(false),
@@ -987,6 +1003,11 @@ cJSON* McbpConnection::toJSON() const {
 
         }
         cJSON_AddNumberToObject(obj, "rlbytes", rlbytes);
+        if (valueItemLength != 0) {
+            cJSON_AddNumberToObject(obj, "value_item_length", valueItemLength);
+            cJSON_AddNumberToObject(
+                    obj, "value_item_received", valueItemReceived);
+        }
 
         {
             cJSON* iovobj = cJSON_CreateObject();
@@ -1207,9 +1228,6 @@ void McbpConnection::runEventLoop(short which) {
                     getId(), e.what());
         }
     }
-
-    // MB-24634: Temporarily disabled
-    // conn_return_buffers(this);
 }
 
 void McbpConnection::initiateShutdown() {
@@ -1220,6 +1238,7 @@ void McbpConnection::signalIfIdle(bool logbusy, int workerthread) {
     auto state = getState();
     if (!isEwouldblock() &&
         (state == conn_read_packet_header || state == conn_read_packet_body ||
+         state == conn_read_packet_value ||
          state == conn_waiting || state == conn_new_cmd ||
          state == conn_ship_log)) {
         // Raise a 'fake' write event to ensure the connection has an
@@ -1319,6 +1338,119 @@ std::string McbpConnection::getPrintableKey() const {
     return buffer;
 }
 
+/**
+ * The maximum number of keys coalescePipelinedGets() will fetch in a single
+ * get_multi call.
+ */
+static const size_t MaxCoalescedGets = 64;
+
+bool McbpConnection::coalescePipelinedGets(const DocKey& key,
+                                           uint16_t vbucket) {
+    prefetchedGets.clear();
+
+    std::vector<cb::GetMultiKey> keys;
+    keys.push_back({key, vbucket});
+
+    // The current packet has already been consumed, so read.curr points
+    // at the next one. Only accept complete GETQ / GETKQ packets which
+    // would pass validation and the access check when executed; anything
+    // else ends the batch, so no key reaches the engine ahead of its
+    // packet being checked.
+    const char* ptr = read.curr;
+    size_t avail = read.bytes;
+    while (keys.size() < MaxCoalescedGets &&
+           avail >= sizeof(protocol_binary_request_header)) {
+        protocol_binary_request_header header;
+        std::memcpy(&header, ptr, sizeof(header));
+        const auto& req = header.request;
+        const auto keylen = ntohs(req.keylen);
+        const auto bodylen = ntohl(req.bodylen);
+        if ((req.opcode != PROTOCOL_BINARY_CMD_GETQ &&
+             req.opcode != PROTOCOL_BINARY_CMD_GETKQ) ||
+            validate_get_header(header) != PROTOCOL_BINARY_RESPONSE_SUCCESS ||
+            keylen > KEY_MAX_LENGTH ||
+            avail < sizeof(header) + bodylen ||
+            privilegeContext.check(cb::rbac::Privilege::Read) !=
+                    cb::rbac::PrivilegeAccess::Ok) {
+            break;
+        }
+
+        keys.push_back({DocKey(reinterpret_cast<const uint8_t*>(ptr) +
+                                       sizeof(header),
+                               keylen,
+                               getDocNamespace()),
+                        ntohs(req.vbucket)});
+        ptr += sizeof(header) + bodylen;
+        avail -= sizeof(header) + bodylen;
+    }
+
+    if (keys.size() == 1) {
+        // Nothing to batch with
+        return false;
+    }
+
+    auto results = bucket_get_multi(this, keys);
+    if (results.size() != keys.size()) {
+        throw std::logic_error(
+                "McbpConnection::coalescePipelinedGets: get_multi returned " +
+                std::to_string(results.size()) + " results for " +
+                std::to_string(keys.size()) + " keys");
+    }
+
+    bool wouldBlock = false;
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        const auto& k = keys[ii];
+        if (results[ii].first == cb::engine_errc::would_block) {
+            wouldBlock = true;
+        }
+        prefetchedGets.push_back(
+                {std::string(reinterpret_cast<const char*>(k.key.data()),
+                             k.key.size()),
+                 k.key.getDocNamespace(),
+                 k.vbucket,
+                 std::move(results[ii])});
+    }
+
+    return wouldBlock;
+}
+
+bool McbpConnection::takePrefetchedGet(const DocKey& key,
+                                       uint16_t vbucket,
+                                       cb::EngineErrorItemPair& result) {
+    if (prefetchedGets.empty()) {
+        return false;
+    }
+
+    // The entries are in read buffer order, so any entry ahead of ours
+    // belongs to a packet which has already been executed without picking
+    // it up (e.g. it failed before reaching the engine). Skip those rather
+    // than dropping the whole batch, so no key we've already fetched (and
+    // the bucket has already counted) gets fetched a second time.
+    auto matches = [&key, vbucket](const PrefetchedGet& entry) {
+        return entry.vbucket == vbucket &&
+               entry.docNamespace == key.getDocNamespace() &&
+               entry.key.size() == key.size() &&
+               std::memcmp(entry.key.data(), key.data(), key.size()) == 0;
+    };
+    while (!prefetchedGets.empty() && !matches(prefetchedGets.front())) {
+        prefetchedGets.pop_front();
+    }
+    if (prefetchedGets.empty()) {
+        return false;
+    }
+
+    auto& next = prefetchedGets.front();
+    bool usable = next.result.first != cb::engine_errc::would_block &&
+                  next.result.first != cb::engine_errc::disconnect;
+    if (usable) {
+        result = std::move(next.result);
+    }
+    prefetchedGets.pop_front();
+    // An entry which had to wait for a background fetch is retried
+    // through a normal get, which should now find it resident.
+    return usable;
+}
+
 int PipeConnection::sendmsg(struct msghdr* m) {
     int res = 0;
     // Windows and POSIX safe, manually write the scatter/gather
@@ -38,6 +38,7 @@
 #include <platform/sized_buffer.h>
 
 #include <chrono>
+#include <deque>
 #include <memory>
 #include <string>
 #include <vector>
@@ -363,6 +364,14 @@ public:
         return iovused;
     }
 
+    /**
+     * Get the number of bytes referenced by the entries in use in the IO
+     * Vector
+     */
+    size_t getIovBytes() const {
+        return iovbytes;
+    }
+
     /**
      * Adds a message header to a connection.
      *
@@ -717,7 +726,8 @@ public:
     static void* getPacket(const Cookie& cookie) {
         auto c = static_cast<McbpConnection*>(cookie.connection);
         return (c->read.curr -
-               (c->binary_header.request.bodylen + sizeof(c->binary_header)));
+               (c->binary_header.request.bodylen - c->valueItemLength +
+                sizeof(c->binary_header)));
     }
 
     /**
@@ -734,6 +744,125 @@ public:
         return saslAuthEnabled;
     }
 
+    /**
+     * Called when executing a quiet get (GETQ / GETKQ) for the given key.
+     * Scan the read buffer for the run of complete GETQ / GETKQ packets
+     * which directly follow the current one, and fetch all of their keys
+     * (including the current one) from the bucket through a single
+     * get_multi call. The results are kept until the corresponding
+     * commands are executed and pick them up through takePrefetchedGet().
+     *
+     * Each packet is validated and access checked before its key joins the
+     * batch; the packets themselves are left in the read buffer and are
+     * executed as normal, so this only batches the engine lookups.
+     *
+     * @return true if any of the keys need a background fetch, in which
+     *         case the bucket will notify the cookie once all of them are
+     *         ready (the caller should return ENGINE_EWOULDBLOCK)
+     */
+    bool coalescePipelinedGets(const DocKey& key, uint16_t vbucket);
+
+    /**
+     * Take the result fetched by coalescePipelinedGets() for the given key.
+     *
+     * @return true (and sets result) if the next prefetched entry matching
+     *         key / vbucket is usable. Otherwise false, and the caller should
+     *         perform a normal get. Entries ahead of the match belong to
+     *         packets which have already been executed and are dropped.
+     */
+    bool takePrefetchedGet(const DocKey& key,
+                           uint16_t vbucket,
+                           cb::EngineErrorItemPair& result);
+
+    /**
+     * Does this connection hold any results from coalescePipelinedGets()
+     * which haven't been consumed yet?
+     */
+    bool hasPrefetchedGets() const {
+        return !prefetchedGets.empty();
+    }
+
+    /**
+     * Drop (and release the items of) all results from
+     * coalescePipelinedGets() which haven't been consumed yet. Must be
+     * called before the connection leaves its bucket.
+     */
+    void releasePrefetchedGets() {
+        prefetchedGets.clear();
+    }
+
+    /**
+     * The number of bytes at the end of the current packet (its value)
+     * which are received straight into an item allocated from the bucket
+     * rather than into the read buffer (0 if the whole packet is in the
+     * read buffer). See conn_read_packet_value.
+     */
+    uint32_t getValueItemLength() const {
+        return valueItemLength;
+    }
+
+    void setValueItemLength(uint32_t length) {
+        valueItemLength = length;
+        valueItemReceived = 0;
+    }
+
+    /// Has the item the value is received into been allocated?
+    bool hasValueItem() const {
+        return valueItem.get() != nullptr;
+    }
+
+    /**
+     * Set the item the value of the current packet is received into.
+     *
+     * @param item the newly allocated item
+     * @param data where the value is to be stored in the item (with room
+     *             for getValueItemLength() bytes)
+     */
+    void setValueItem(cb::unique_item_ptr item, char* data) {
+        valueItem = std::move(item);
+        valueItemData = data;
+        valueItemReceived = 0;
+    }
+
+    /// Where to store the next byte of the value
+    char* getValueItemCurr() const {
+        return valueItemData + valueItemReceived;
+    }
+
+    /// The number of bytes of the value still to receive
+    uint32_t getValueItemRemaining() const {
+        return valueItemLength - valueItemReceived;
+    }
+
+    void addValueItemReceived(uint32_t nbytes) {
+        valueItemReceived += nbytes;
+    }
+
+    /**
+     * Take the item the value of the current packet was received into
+     * (the packet itself still only holds the part of the body before the
+     * value).
+     *
+     * @return the item (or an empty pointer if the whole packet is in the
+     *         read buffer) and the value within it
+     */
+    std::pair<cb::unique_item_ptr, cb::const_char_buffer> takeValueItem() {
+        cb::const_char_buffer value{valueItemData, valueItemLength};
+        return {std::move(valueItem), value};
+    }
+
+    /**
+     * Release the item (if any) the value of the current packet was
+     * received into. Must be called before the connection leaves its
+     * bucket.
+     */
+    void releaseValueItem() {
+        valueItem.reset();
+        valueItemData = nullptr;
+        valueItemLength = 0;
+        valueItemReceived = 0;
+    }
+
 protected:
     void runStateMachinery();
 
@@ -803,6 +932,8 @@ protected:
     std::vector<iovec> iov;
     /** number of elements used in iov[] */
     size_t iovused;
+    /** number of bytes referenced by the elements used in iov[] */
+    size_t iovbytes;
 
     /** The message list being used for transfer */
     std::vector<struct msghdr> msglist;
@@ -817,6 +948,33 @@ protected:
      */
     std::vector<void*> reservedItems;
 
+    /**
+     * A result fetched by coalescePipelinedGets() on behalf of a pipelined
+     * get command which hasn't been executed yet.
+     */
+    struct PrefetchedGet {
+        std::string key;
+        DocNamespace docNamespace;
+        uint16_t vbucket;
+        cb::EngineErrorItemPair result;
+    };
+
+    /**
+     * Results of coalescePipelinedGets(), in the order the corresponding
+     * commands appear in the read buffer.
+     */
+    std::deque<PrefetchedGet> prefetchedGets;
+
+    /**
+     * The item the value of the current packet is received into (if
+     * valueItemLength is non-zero), where the value lives in it and how
+     * much of it we've received so far.
+     */
+    cb::unique_item_ptr valueItem;
+    char* valueItemData;
+    uint32_t valueItemLength;
+    uint32_t valueItemReceived;
+
     /**
      * A vector of temporary allocations that should be freed when the
      * the connection is done sending all of the data. Use pushTempAlloc to
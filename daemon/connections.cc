@@ -16,6 +16,7 @@
  */
 
 #include "connections.h"
+#include "network_buffer_pool.h"
 #include "runtime.h"
 #include "utilities/protocol2text.h"
 #include "settings.h"
@@ -46,9 +47,10 @@ enum class BufferLoan {
 
 /** Function prototypes ******************************************************/
 
-static BufferLoan conn_loan_single_buffer(McbpConnection *c, struct net_buf *thread_buf,
-                                             struct net_buf *conn_buf);
-static void conn_return_single_buffer(Connection *c, struct net_buf *thread_buf,
+static BufferLoan conn_loan_single_buffer(McbpConnection *c,
+                                          NetworkBufferPool& pool,
+                                          struct net_buf *conn_buf);
+static void conn_return_single_buffer(Connection *c, NetworkBufferPool& pool,
                                       struct net_buf *conn_buf);
 static void conn_destructor(Connection *c);
 static Connection *allocate_connection(SOCKET sfd,
@@ -253,6 +255,7 @@ Connection* conn_pipe_new(const int fd,
 
 void conn_cleanup_engine_allocations(McbpConnection * c) {
     c->releaseReservedItems();
+    c->releaseValueItem();
 }
 
 static void conn_cleanup(Connection *c) {
@@ -379,7 +382,8 @@ void conn_loan_buffers(Connection *connection) {
         return;
     }
 
-    auto res = conn_loan_single_buffer(c, &c->getThread()->read, &c->read);
+    auto& pool = *c->getThread()->bufferPool;
+    auto res = conn_loan_single_buffer(c, pool, &c->read);
     auto *ts = get_thread_stats(c);
     if (res == BufferLoan::Allocated) {
         ts->rbufs_allocated++;
@@ -389,7 +393,7 @@ void conn_loan_buffers(Connection *connection) {
         ts->rbufs_existing++;
     }
 
-    res = conn_loan_single_buffer(c, &c->getThread()->write, &c->write);
+    res = conn_loan_single_buffer(c, pool, &c->write);
     if (res == BufferLoan::Allocated) {
         ts->wbufs_allocated++;
     } else if (res == BufferLoan::Loaned) {
@@ -417,8 +421,8 @@ void conn_return_buffers(Connection *connection) {
         return;
     }
 
-    conn_return_single_buffer(c, &thread->read, &c->read);
-    conn_return_single_buffer(c, &thread->write, &c->write);
+    conn_return_single_buffer(c, *thread->bufferPool, &c->read);
+    conn_return_single_buffer(c, *thread->bufferPool, &c->write);
 }
 
 /** Internal functions *******************************************************/
@@ -529,65 +533,52 @@ static void release_connection(Connection *c) {
 
 /**
  * If the connection doesn't already have a populated conn_buff, ensure that
- * it does by either loaning out the threads, or allocating a new one if
- * necessary.
+ * it does by borrowing one from the thread's pool (which allocates a new one
+ * if it is empty).
  */
-static BufferLoan conn_loan_single_buffer(McbpConnection *c, struct net_buf *thread_buf,
-                                    struct net_buf *conn_buf)
+static BufferLoan conn_loan_single_buffer(McbpConnection *c,
+                                          NetworkBufferPool& pool,
+                                          struct net_buf *conn_buf)
 {
     /* Already have a (partial) buffer - nothing to do. */
     if (conn_buf->buf != NULL) {
         return BufferLoan::Existing;
     }
 
-    if (thread_buf->buf != NULL) {
-        /* Loan thread's buffer to connection. */
-        *conn_buf = *thread_buf;
-
-        thread_buf->buf = NULL;
-        thread_buf->size = 0;
-        return BufferLoan::Loaned;
-    } else {
-        /* Need to allocate a new buffer. */
-        conn_buf->buf = reinterpret_cast<char*>(cb_malloc(DATA_BUFFER_SIZE));
-        if (conn_buf->buf == NULL) {
-            /* Unable to alloc a buffer for the thread. Not much we can do here
-             * other than terminate the current connection.
-             */
-            if (settings.getVerbose()) {
-                LOG_WARNING(c,
-                            "%u: Failed to allocate new read buffer.. closing"
-                                " connection",
-                            c->getId());
-            }
-            c->setState(conn_closing);
-            return BufferLoan::Existing;
+    bool pooled;
+    conn_buf->buf = pool.get(pooled);
+    if (conn_buf->buf == NULL) {
+        /* Unable to alloc a buffer for the connection. Not much we can do
+         * here other than terminate the current connection.
+         */
+        if (settings.getVerbose()) {
+            LOG_WARNING(c,
+                        "%u: Failed to allocate new read buffer.. closing"
+                            " connection",
+                        c->getId());
         }
-        conn_buf->size = DATA_BUFFER_SIZE;
-        conn_buf->curr = conn_buf->buf;
-        conn_buf->bytes = 0;
-        return BufferLoan::Allocated;
+        c->setState(conn_closing);
+        return BufferLoan::Existing;
     }
+    conn_buf->size = uint32_t(pool.getBufferSize());
+    conn_buf->curr = conn_buf->buf;
+    conn_buf->bytes = 0;
+    return pooled ? BufferLoan::Loaned : BufferLoan::Allocated;
 }
 
 /**
- * Return an empty read buffer back to the owning worker thread.
+ * Return an empty buffer back to the owning worker thread's pool.
  */
-static void conn_return_single_buffer(Connection *c, struct net_buf *thread_buf,
+static void conn_return_single_buffer(Connection *c, NetworkBufferPool& pool,
                                       struct net_buf *conn_buf) {
     if (conn_buf->buf == NULL) {
         /* No buffer - nothing to do. */
         return;
     }
 
-    if ((conn_buf->curr == conn_buf->buf) && (conn_buf->bytes == 0)) {
-        /* Buffer clean, dispose of it. */
-        if (thread_buf->buf == NULL) {
-            /* Give back to thread. */
-            *thread_buf = *conn_buf;
-        } else {
-            cb_free(conn_buf->buf);
-        }
+    if (conn_buf->bytes == 0) {
+        /* Buffer clean, give it back */
+        pool.put(conn_buf->buf, conn_buf->size);
         conn_buf->buf = conn_buf->curr = NULL;
         conn_buf->size = 0;
     } else {
@@ -43,14 +43,13 @@ void run_event_loop(Connection* c, short which);
  * If the connection doesn't already have read/write buffers, ensure that it
  * does.
  *
- * In the common case, only one read/write buffer is created per worker thread,
- * and this buffer is loaned to the connection the worker is currently
- * handling. As long as the connection doesn't have a partial read/write (i.e.
- * the buffer is totally consumed) when it goes idle, the buffer is simply
- * returned back to the worker thread.
+ * The buffers are borrowed from the worker thread's NetworkBufferPool, and
+ * handed back by conn_return_buffers() once the connection goes idle. As
+ * long as the connection doesn't have a partial read (i.e. the buffer is
+ * totally consumed) when it goes idle it holds no buffers at all.
  *
- * If there is a partial read/write, then the buffer is left loaned to that
- * connection and the worker thread will allocate a new one.
+ * If there is a partial read, then the buffer is left loaned to that
+ * connection and the pool provides another one for the next connection.
  */
 void conn_loan_buffers(Connection *c);
 
@@ -60,6 +59,10 @@ void conn_loan_buffers(Connection *c);
  * Converse of conn_loan_buffer(); if any of the read/write buffers are empty
  * (have no partial data) then return the buffer back to the worker thread.
  * If there is partial data, then keep the buffer with the connection.
+ *
+ * Must only be called when the connection has no response in flight: the
+ * response header is built at the start of the write buffer without
+ * updating its curr / bytes.
  */
 void conn_return_buffers(Connection *c);
 
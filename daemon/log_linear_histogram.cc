@@ -0,0 +1,180 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "log_linear_histogram.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+/// @return the position of the most significant bit set in value (> 0)
+static unsigned int mostSignificantBit(uint64_t value) {
+    unsigned int ret = 0;
+    for (unsigned int step = 32; step > 0; step /= 2) {
+        if (value >> step) {
+            value >>= step;
+            ret += step;
+        }
+    }
+    return ret;
+}
+
+LogLinearHistogram::LogLinearHistogram()
+    : resetsRequested(0), resetsDone(0) {
+    clear();
+}
+
+void LogLinearHistogram::add(hrtime_t nsec) {
+    const auto requested = resetsRequested.load(std::memory_order_acquire);
+    if (requested != resetsDone.load(std::memory_order_relaxed)) {
+        clear();
+        resetsDone.store(requested, std::memory_order_release);
+    }
+
+    auto& bucket = buckets[getBucketIndex(nsec)];
+    // Only the owning thread writes, so there's no need for an atomic
+    // increment (and the lock prefix it costs).
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+    total.store(total.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+}
+
+void LogLinearHistogram::copy(const LogLinearHistogram& other) {
+    resetsDone.store(resetsRequested.load(std::memory_order_acquire),
+                     std::memory_order_release);
+    if (other.isResetPending()) {
+        clear();
+        return;
+    }
+    for (size_t ii = 0; ii < NumBuckets; ++ii) {
+        buckets[ii].store(other.buckets[ii].load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+    }
+    total.store(other.total.load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
+}
+
+void LogLinearHistogram::reset() {
+    resetsRequested.fetch_add(1, std::memory_order_release);
+}
+
+void LogLinearHistogram::clear() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+}
+
+bool LogLinearHistogram::isResetPending() const {
+    // Load resetsDone first, so that if the writer has caught up with the
+    // requests we've seen its cleared counts.
+    const auto done = resetsDone.load(std::memory_order_acquire);
+    return resetsRequested.load(std::memory_order_acquire) != done;
+}
+
+void LogLinearHistogram::aggregate(Counts& counts) const {
+    if (counts.size() != NumBuckets) {
+        throw std::invalid_argument(
+                "LogLinearHistogram::aggregate: counts has " +
+                std::to_string(counts.size()) + " entries, expected " +
+                std::to_string(NumBuckets));
+    }
+    if (isResetPending()) {
+        return;
+    }
+    for (size_t ii = 0; ii < NumBuckets; ++ii) {
+        counts[ii] += buckets[ii].load(std::memory_order_relaxed);
+    }
+}
+
+uint64_t LogLinearHistogram::getTotal() const {
+    if (isResetPending()) {
+        return 0;
+    }
+    return total.load(std::memory_order_relaxed);
+}
+
+size_t LogLinearHistogram::getBucketIndex(hrtime_t nsec) {
+    if (nsec < (hrtime_t(1) << SubBucketBits)) {
+        return size_t(nsec);
+    }
+    if (nsec >= (hrtime_t(1) << MaxValueBits)) {
+        return NumBuckets - 1;
+    }
+
+    // Keep the SubBucketBits most significant bits of the value; the
+    // number of bits shifted out selects the power of two range and the
+    // remaining bits (the top one of which is always set) the bucket
+    // within that range.
+    const unsigned int shift =
+            mostSignificantBit(nsec) - SubBucketBits + 1;
+    return size_t(shift) * SubBucketHalfCount + size_t(nsec >> shift);
+}
+
+hrtime_t LogLinearHistogram::getBucketLowerBound(size_t index) {
+    if (index >= NumBuckets) {
+        throw std::out_of_range(
+                "LogLinearHistogram::getBucketLowerBound: index (which is " +
+                std::to_string(index) + ") is out of range");
+    }
+    if (index < (size_t(1) << SubBucketBits)) {
+        return hrtime_t(index);
+    }
+    const size_t shift = index / SubBucketHalfCount - 1;
+    return hrtime_t(index - shift * SubBucketHalfCount) << shift;
+}
+
+hrtime_t LogLinearHistogram::getBucketUpperBound(size_t index) {
+    const hrtime_t lower = getBucketLowerBound(index);
+    if (index < (size_t(1) << SubBucketBits)) {
+        return lower;
+    }
+    const size_t shift = index / SubBucketHalfCount - 1;
+    return lower + (hrtime_t(1) << shift) - 1;
+}
+
+hrtime_t LogLinearHistogram::getPercentile(const Counts& counts,
+                                           double percentile) {
+    if (percentile < 0.0 || percentile > 100.0) {
+        throw std::invalid_argument(
+                "LogLinearHistogram::getPercentile: percentile (which is " +
+                std::to_string(percentile) + ") must be in the range "
+                "[0, 100]");
+    }
+
+    uint64_t total = 0;
+    for (auto count : counts) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = uint64_t(std::ceil(percentile / 100.0 * total));
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t ii = 0; ii < counts.size(); ++ii) {
+        seen += counts[ii];
+        if (seen >= rank) {
+            return getBucketUpperBound(ii);
+        }
+    }
+    return getBucketUpperBound(counts.size() - 1);
+}
@@ -0,0 +1,115 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/platform.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * A histogram of durations (in nanoseconds) with log-linear buckets, in
+ * the style of HdrHistogram:
+ *
+ *     - Durations below 128ns have one bucket per nanosecond.
+ *     - Every power of two above that ([128-255], [256-511], ...) is split
+ *       into 64 buckets of equal width.
+ *
+ * A bucket is therefore never wider than 1/64th (~1.6%) of the values it
+ * holds, which is the accuracy percentiles can be reported with. Durations
+ * of 2^40ns (~18 minutes) and above all land in the last bucket.
+ *
+ * The histogram is meant to have a single writer: add() is a relaxed load
+ * and store rather than a read-modify-write, so the owning thread never has
+ * to fight other cores for the cache line. Other threads may read the
+ * counts at any time (but the snapshot isn't atomic as a whole).
+ *
+ * Other threads may also reset() the histogram. As they can't zero the
+ * counts without racing with the writer's load and store, a reset only
+ * bumps the reset epoch; the writer zeroes the counts itself the next time
+ * it adds a value, and until then readers treat the histogram as empty.
+ */
+class LogLinearHistogram {
+public:
+    /// Bits of precision kept for each value (the linear range is 2^bits)
+    static const unsigned int SubBucketBits = 7;
+    static const unsigned int SubBucketHalfCount = 1u << (SubBucketBits - 1);
+    /// Values at or above 2^MaxValueBits are recorded in the last bucket
+    static const unsigned int MaxValueBits = 40;
+    static const size_t NumBuckets =
+            (MaxValueBits - SubBucketBits + 2) * SubBucketHalfCount;
+
+    /// Summed bucket counts of one or more histograms.
+    using Counts = std::vector<uint64_t>;
+
+    LogLinearHistogram();
+
+    LogLinearHistogram(const LogLinearHistogram&) = delete;
+
+    /// Record a duration. Must only be called by the histogram's writer.
+    void add(hrtime_t nsec);
+
+    /**
+     * Set the counts to those of another histogram. Must only be called by
+     * the histogram's writer.
+     */
+    void copy(const LogLinearHistogram& other);
+
+    /// Reset the counts. May be called by any thread.
+    void reset();
+
+    /// Add this histogram's bucket counts to counts (of NumBuckets entries).
+    void aggregate(Counts& counts) const;
+
+    uint64_t getTotal() const;
+
+    /// @return the index of the bucket the given duration is recorded in
+    static size_t getBucketIndex(hrtime_t nsec);
+
+    /// @return the smallest duration recorded in the given bucket
+    static hrtime_t getBucketLowerBound(size_t index);
+
+    /// @return the largest duration recorded in the given bucket
+    static hrtime_t getBucketUpperBound(size_t index);
+
+    /**
+     * Get the duration which the given percentage of the recorded values
+     * are less than or equal to (reported as the upper bound of the bucket
+     * holding it).
+     *
+     * @param counts bucket counts, as built by aggregate()
+     * @param percentile the percentile to get, in the range [0, 100]
+     * @return the duration in nanoseconds, or 0 if counts is empty
+     */
+    static hrtime_t getPercentile(const Counts& counts, double percentile);
+
+private:
+    /// Zero the counts. Must only be called by the histogram's writer.
+    void clear();
+
+    /// @return true if a reset was requested which the writer hasn't done yet
+    bool isResetPending() const;
+
+    std::array<std::atomic<uint64_t>, NumBuckets> buckets;
+    std::atomic<uint64_t> total;
+
+    /// Number of times reset() has been called
+    std::atomic<uint64_t> resetsRequested;
+    /// Value of resetsRequested when the writer last zeroed the counts
+    std::atomic<uint64_t> resetsDone;
+};
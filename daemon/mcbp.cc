@@ -345,8 +345,9 @@ bool mcbp_response_handler(const void* key, uint16_t keylen,
 void mcbp_collect_timings(const McbpConnection* c) {
     hrtime_t now = gethrtime();
     const hrtime_t elapsed_ns = now - c->getStart();
+    const size_t thread = c->getThread()->index;
     // aggregated timing for all buckets
-    all_buckets[0].timings.collect(c->getCmd(), elapsed_ns);
+    all_buckets[0].timings.collect(c->getCmd(), elapsed_ns, thread);
 
     // timing for current bucket
     bucket_id_t bucketid = get_bucket_id(c->getCookie());
@@ -355,7 +356,7 @@ void mcbp_collect_timings(const McbpConnection* c) {
      * to delete the bucket you're associated with and your're idle.
      */
     if (bucketid != 0) {
-        all_buckets[bucketid].timings.collect(c->getCmd(), elapsed_ns);
+        all_buckets[bucketid].timings.collect(c->getCmd(), elapsed_ns, thread);
     }
 
     // Log operations taking longer than 0.5s
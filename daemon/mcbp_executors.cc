@@ -35,6 +35,7 @@
 #include "mcbpdestroybuckettask.h"
 #include "sasl_tasks.h"
 #include "mcbp_privileges.h"
+#include "network_buffer_pool.h"
 #include "protocol/mcbp/appendprepend_context.h"
 #include "protocol/mcbp/arithmetic_context.h"
 #include "protocol/mcbp/gat_context.h"
@@ -89,17 +90,24 @@ static bool authenticated(McbpConnection* c) {
     return rv;
 }
 
-static void bin_read_chunk(McbpConnection* c, uint32_t chunk) {
-    ptrdiff_t offset;
-    c->setRlbytes(chunk);
+/**
+ * Make sure the read buffer has room for the whole of the current packet,
+ * growing it (and moving the packet to the start of it) if needed.
+ *
+ * @param c the connection
+ * @param consumed the number of bytes of the packet before read.curr
+ * @param size the total size of the packet (header included)
+ * @return false if we failed to grow the buffer (the connection is closed)
+ */
+static bool make_room_for_packet(McbpConnection* c,
+                                 size_t consumed,
+                                 size_t size) {
+    char* packet = c->read.curr - consumed;
+    const size_t offset = packet - c->read.buf;
 
     /* Ok... do we have room for everything in our buffer? */
-    offset =
-        c->read.curr + sizeof(protocol_binary_request_header) - c->read.buf;
-    if (c->getRlbytes() > c->read.size - offset) {
+    if (size > c->read.size - offset) {
         size_t nsize = c->read.size;
-        size_t size = c->getRlbytes() + sizeof(protocol_binary_request_header);
-
         while (size > nsize) {
             nsize *= 2;
         }
@@ -114,20 +122,71 @@ static void bin_read_chunk(McbpConnection* c, uint32_t chunk) {
                 LOG_WARNING(c, "%u: Failed to grow buffer.. closing connection",
                             c->getId());
                 c->setState(conn_closing);
-                return;
+                return false;
             }
 
+            c->getThread()->bufferPool->resized(c->read.size, nsize);
             c->read.buf = newm;
-            /* rcurr should point to the same offset in the packet */
-            c->read.curr =
-                c->read.buf + offset - sizeof(protocol_binary_request_header);
+            /* packet should be at the same offset in the buffer */
+            packet = c->read.buf + offset;
             c->read.size = (int)nsize;
         }
-        if (c->read.buf != c->read.curr) {
-            memmove(c->read.buf, c->read.curr, c->read.bytes);
-            c->read.curr = c->read.buf;
+        if (c->read.buf != packet) {
+            memmove(c->read.buf, packet, consumed + c->read.bytes);
+            packet = c->read.buf;
             LOG_DEBUG(c, "%u: Repack input buffer", c->getId());
         }
+        c->read.curr = packet + consumed;
+    }
+    return true;
+}
+
+/**
+ * Should the value of the current packet be received straight into the
+ * item it'll be stored in, rather than into the read buffer?
+ *
+ * That's the case for the mutations which would otherwise need the read
+ * buffer to grow, which saves copying the value from the read buffer into
+ * the item (and keeps the read buffer small). Anything out of the ordinary
+ * uses the read buffer, and gets validated / rejected as normal.
+ */
+static bool receive_value_into_item(McbpConnection* c) {
+    const auto& header = c->binary_header.request;
+    switch (header.opcode) {
+    case PROTOCOL_BINARY_CMD_SET:
+    case PROTOCOL_BINARY_CMD_SETQ:
+    case PROTOCOL_BINARY_CMD_ADD:
+    case PROTOCOL_BINARY_CMD_ADDQ:
+    case PROTOCOL_BINARY_CMD_REPLACE:
+    case PROTOCOL_BINARY_CMD_REPLACEQ:
+        break;
+    default:
+        return false;
+    }
+
+    return header.magic == PROTOCOL_BINARY_REQ && !c->isDCP() &&
+           c->getBucketEngine() != nullptr && header.extlen == 8 &&
+           header.keylen != 0 &&
+           header.bodylen > uint32_t(header.extlen + header.keylen) &&
+           mcbp::datatype::is_valid(header.datatype) &&
+           !mcbp::datatype::is_xattr(header.datatype) &&
+           header.bodylen + sizeof(c->binary_header) > c->read.size;
+}
+
+static void bin_read_chunk(McbpConnection* c, uint32_t chunk) {
+    if (receive_value_into_item(c)) {
+        // Read the extras and key into the read buffer, and the value
+        // into the item (once the key tells us what to allocate)
+        const uint32_t prefix =
+                c->binary_header.request.extlen + c->binary_header.request.keylen;
+        c->setValueItemLength(chunk - prefix);
+        chunk = prefix;
+    }
+    c->setRlbytes(chunk);
+
+    if (!make_room_for_packet(
+                c, 0, c->getRlbytes() + sizeof(protocol_binary_request_header))) {
+        return;
     }
 
     // The input buffer is big enough to fit the entire packet.
@@ -135,6 +194,68 @@ static void bin_read_chunk(McbpConnection* c, uint32_t chunk) {
     c->setState(conn_read_packet_body);
 }
 
+static McbpPrivilegeChains& get_privilege_chains() {
+    static McbpPrivilegeChains privilegeChains;
+    return privilegeChains;
+}
+
+static protocol_binary_response_status validate_bin_header(McbpConnection* c);
+
+ENGINE_ERROR_CODE mcbp_allocate_value_item(McbpConnection* c) {
+    // Don't let the client make us allocate memory for a packet we're going
+    // to reject anyway; the normal command path reports the actual error
+    // once the value has been read into the read buffer.
+    const auto opcode =
+            static_cast<protocol_binary_command>(c->binary_header.request.opcode);
+    if (get_privilege_chains().invoke(opcode, c->getCookieObject()) !=
+        cb::rbac::PrivilegeAccess::Ok) {
+        return ENGINE_EACCESS;
+    }
+    if (validate_bin_header(c) != PROTOCOL_BINARY_RESPONSE_SUCCESS ||
+        c->validateCommand(opcode) != PROTOCOL_BINARY_RESPONSE_SUCCESS) {
+        return ENGINE_EINVAL;
+    }
+
+    auto* req = reinterpret_cast<protocol_binary_request_set*>(
+            McbpConnection::getPacket(c->getCookieObject()));
+    const DocKey key{req->bytes + sizeof(req->bytes),
+                     c->binary_header.request.keylen,
+                     c->getDocNamespace()};
+
+    auto ret = bucket_allocate(c,
+                               key,
+                               c->getValueItemLength(),
+                               req->message.body.flags,
+                               ntohl(req->message.body.expiration),
+                               c->binary_header.request.datatype,
+                               c->binary_header.request.vbucket);
+    if (ret.first != cb::engine_errc::success) {
+        return ENGINE_ERROR_CODE(ret.first);
+    }
+
+    item_info info;
+    if (!bucket_get_item_info(c, ret.second.get(), &info) ||
+        info.value[0].iov_len < c->getValueItemLength()) {
+        return ENGINE_FAILED;
+    }
+
+    c->setValueItem(std::move(ret.second),
+                    static_cast<char*>(info.value[0].iov_base));
+    return ENGINE_SUCCESS;
+}
+
+void mcbp_read_value_into_buffer(McbpConnection* c) {
+    const uint32_t length = c->getValueItemLength();
+    const size_t consumed = sizeof(protocol_binary_request_header) +
+                            c->binary_header.request.extlen +
+                            c->binary_header.request.keylen;
+    c->releaseValueItem();
+    c->setRlbytes(length);
+    if (make_room_for_packet(c, consumed, consumed + length)) {
+        c->setState(conn_read_packet_body);
+    }
+}
+
 /* Just write an error message and disconnect the client */
 static void handle_binary_protocol_error(McbpConnection* c) {
     mcbp_write_packet(c, PROTOCOL_BINARY_RESPONSE_EINVAL);
@@ -151,9 +272,11 @@ void update_topkeys(const DocKey& key, McbpConnection* c) {
 
     if (topkey_commands[c->binary_header.request.opcode]) {
         if (all_buckets[c->getBucketIndex()].topkeys != nullptr) {
-            all_buckets[c->getBucketIndex()].topkeys->updateKey(key.data(),
-                                                                key.size(),
-                                                                mc_time_get_current_time());
+            all_buckets[c->getBucketIndex()].topkeys->updateKey(
+                    key.data(),
+                    key.size(),
+                    mc_time_get_current_time(),
+                    c->getThread()->index);
         }
     }
 }
@@ -650,6 +773,15 @@ static ENGINE_ERROR_CODE dcp_message_control(const void* void_cookie,
     return ENGINE_SUCCESS;
 }
 
+/**
+ * The maximum number of DCP messages, and bytes (including the values which
+ * are sent straight out of the items), to send to a DCP consumer in a
+ * single batch. A batch is also bounded by the room for the message headers
+ * in the connection's write buffer.
+ */
+static const size_t dcp_max_batch_messages = 256;
+static const size_t dcp_max_batch_bytes = 256 * 1024;
+
 void ship_mcbp_dcp_log(McbpConnection* c) {
     static struct dcp_message_producers producers = {
         dcp_message_get_failover_log,
@@ -679,8 +811,26 @@ void ship_mcbp_dcp_log(McbpConnection* c) {
     c->write.bytes = 0;
     c->write.curr = c->write.buf;
     c->setEwouldblock(false);
-    ret = c->getBucketEngine()->dcp.step(c->getBucketEngineAsV0(), c->getCookie(),
-                                         &producers);
+
+    // Fill the write buffer with as many messages as we can so that they're
+    // all sent with a single trip through libevent (and sendmsg).
+    size_t nmessages = 0;
+    do {
+        ret = c->getBucketEngine()->dcp.step(c->getBucketEngineAsV0(),
+                                             c->getCookie(), &producers);
+        if (ret == ENGINE_WANT_MORE) {
+            ++nmessages;
+        }
+    } while (ret == ENGINE_WANT_MORE && nmessages < dcp_max_batch_messages &&
+             c->getIovBytes() < dcp_max_batch_bytes);
+
+    if (nmessages > 0 && (ret == ENGINE_SUCCESS || ret == ENGINE_E2BIG)) {
+        // Either the engine ran out of data, or the next message didn't fit
+        // in the write buffer (the engine keeps it and hands it to us again
+        // on the next step). Send what we've got.
+        ret = ENGINE_WANT_MORE;
+    }
+
     if (ret == ENGINE_SUCCESS) {
         /* the engine don't have more data to send at this moment */
         c->setEwouldblock(true);
@@ -1607,11 +1757,10 @@ static protocol_binary_response_status validate_bin_header(McbpConnection* c) {
 }
 
 static void execute_request_packet(McbpConnection* c) {
-    static McbpPrivilegeChains privilegeChains;
+    auto& privilegeChains = get_privilege_chains();
     protocol_binary_response_status result;
 
-    char* packet = (c->read.curr - (c->binary_header.request.bodylen +
-                                    sizeof(c->binary_header)));
+    auto* packet = McbpConnection::getPacket(c->getCookieObject());
 
     auto opcode = static_cast<protocol_binary_command>(c->binary_header.request.opcode);
     auto executor = executors[opcode];
@@ -39,6 +39,25 @@ void mcbp_complete_packet(McbpConnection* c);
 
 int try_read_mcbp_command(McbpConnection *c);
 
+/**
+ * Allocate the item the value of the current packet is to be received
+ * into (see conn_read_packet_value). The header, extras and key are
+ * validated and the connection's access to the command is checked before
+ * anything is allocated.
+ *
+ * @return ENGINE_SUCCESS if the item was allocated, ENGINE_EACCESS /
+ *         ENGINE_EINVAL if the packet would be rejected, otherwise the
+ *         error returned by the bucket
+ */
+ENGINE_ERROR_CODE mcbp_allocate_value_item(McbpConnection* c);
+
+/**
+ * Receive the rest of the current packet into the read buffer instead of
+ * into an item (because we failed to allocate one), so that the command
+ * gets executed (and reports the error) as normal.
+ */
+void mcbp_read_value_into_buffer(McbpConnection* c);
+
 void initialize_mbcp_lookup_map(void);
 
 void ship_mcbp_dcp_log(McbpConnection* c);
@@ -727,23 +727,28 @@ static protocol_binary_response_status append_prepend_validator(const Cookie& co
     return PROTOCOL_BINARY_RESPONSE_SUCCESS;
 }
 
-static protocol_binary_response_status get_validator(const Cookie& cookie)
-{
-    auto req = static_cast<protocol_binary_request_no_extras*>(McbpConnection::getPacket(cookie));
-    uint16_t klen = ntohs(req->message.header.request.keylen);
-    uint32_t blen = ntohl(req->message.header.request.bodylen);
+protocol_binary_response_status validate_get_header(
+        const protocol_binary_request_header& header) {
+    uint16_t klen = ntohs(header.request.keylen);
+    uint32_t blen = ntohl(header.request.bodylen);
 
-    if (req->message.header.request.magic != PROTOCOL_BINARY_REQ ||
-        req->message.header.request.extlen != 0 ||
+    if (header.request.magic != PROTOCOL_BINARY_REQ ||
+        header.request.extlen != 0 ||
         klen == 0 || klen != blen ||
-        req->message.header.request.datatype != PROTOCOL_BINARY_RAW_BYTES ||
-        req->message.header.request.cas != 0) {
+        header.request.datatype != PROTOCOL_BINARY_RAW_BYTES ||
+        header.request.cas != 0) {
         return PROTOCOL_BINARY_RESPONSE_EINVAL;
     }
 
     return PROTOCOL_BINARY_RESPONSE_SUCCESS;
 }
 
+static protocol_binary_response_status get_validator(const Cookie& cookie)
+{
+    auto req = static_cast<protocol_binary_request_no_extras*>(McbpConnection::getPacket(cookie));
+    return validate_get_header(req->message.header);
+}
+
 static protocol_binary_response_status gat_validator(const Cookie& cookie) {
     auto req = static_cast<protocol_binary_request_no_extras*>(
             McbpConnection::getPacket(cookie));
@@ -63,4 +63,12 @@ private:
     std::array<FunctionChain<protocol_binary_response_status,
                              PROTOCOL_BINARY_RESPONSE_SUCCESS,
                              const Cookie&>, 0x100> commandChains;
-};
\ No newline at end of file
+};
+/**
+ * Validate the header of a GET / GETQ / GETK / GETKQ request. This is what
+ * the validator chain for those commands checks; it's exposed so a packet
+ * still sitting in the read buffer can be checked before it becomes the
+ * connection's current packet.
+ */
+protocol_binary_response_status validate_get_header(
+        const protocol_binary_request_header& header);
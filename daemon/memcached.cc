@@ -41,6 +41,7 @@
 #include "runtime.h"
 #include "session_cas.h"
 #include "settings.h"
+#include "ssl_context.h"
 #include "stats.h"
 #include "subdocument.h"
 #include "timings.h"
@@ -189,6 +190,13 @@ static void set_stats_reset_time(void)
 }
 
 void disassociate_bucket(Connection *c) {
+    // Any items we hold on to belong to the bucket we're leaving
+    auto* mcbp = dynamic_cast<McbpConnection*>(c);
+    if (mcbp != nullptr) {
+        mcbp->releasePrefetchedGets();
+        mcbp->releaseValueItem();
+    }
+
     Bucket &b = all_buckets.at(c->getBucketIndex());
     cb_mutex_enter(&b.mutex);
     b.clients--;
@@ -465,10 +473,17 @@ static void breakpad_changed_listener(const std::string&, Settings &s) {
 
 static void ssl_minimum_protocol_changed_listener(const std::string&, Settings &s) {
     set_ssl_protocol_mask(s.getSslMinimumProtocol());
+    invalidate_ssl_server_contexts();
 }
 
 static void ssl_cipher_list_changed_listener(const std::string&, Settings &s) {
     set_ssl_cipher_list(s.getSslCipherList());
+    invalidate_ssl_server_contexts();
+}
+
+static void client_cert_auth_changed_listener(const std::string&, Settings&) {
+    // The verification mode is baked into the shared SSL contexts
+    invalidate_ssl_server_contexts();
 }
 
 static void verbosity_changed_listener(const std::string&, Settings &s) {
@@ -480,22 +495,53 @@ static void saslauthd_socketpath_changed_listener(const std::string&, Settings &
 }
 
 static void interfaces_changed_listener(const std::string&, Settings &s) {
-    for (const auto& ifc : s.getInterfaces()) {
-        auto* port = get_listening_port_instance(ifc.port);
-        if (port != nullptr) {
-            if (port->maxconns != ifc.maxconn) {
-                port->maxconns = ifc.maxconn;
-            }
+    // SSL certificates (and keys) the ports no longer use
+    std::vector<std::pair<std::string, std::string>> unusedCerts;
+    {
+        std::lock_guard<std::mutex> guard(stats_mutex);
+        for (const auto& ifc : s.getInterfaces()) {
+            auto* port = get_listening_port_instance(ifc.port);
+            if (port != nullptr) {
+                if (port->maxconns != ifc.maxconn) {
+                    port->maxconns = ifc.maxconn;
+                }
 
-            if (port->backlog != ifc.backlog) {
-                port->backlog = ifc.backlog;
+                if (port->backlog != ifc.backlog) {
+                    port->backlog = ifc.backlog;
+                }
+
+                if (port->tcp_nodelay != ifc.tcp_nodelay) {
+                    port->tcp_nodelay = ifc.tcp_nodelay;
+                }
+
+                // New connections use the new certificate (SSL can't be
+                // turned on or off for a port which is already open)
+                if (port->ssl.enabled && !ifc.ssl.cert.empty() &&
+                    !ifc.ssl.key.empty() &&
+                    (port->ssl.cert != ifc.ssl.cert ||
+                     port->ssl.key != ifc.ssl.key)) {
+                    unusedCerts.emplace_back(port->ssl.cert, port->ssl.key);
+                    port->ssl.cert = ifc.ssl.cert;
+                    port->ssl.key = ifc.ssl.key;
+                }
             }
+        }
 
-            if (port->tcp_nodelay != ifc.tcp_nodelay) {
-                port->tcp_nodelay = ifc.tcp_nodelay;
+        for (const auto& port : stats.listening_ports) {
+            if (port.ssl.enabled) {
+                unusedCerts.erase(
+                        std::remove(unusedCerts.begin(),
+                                    unusedCerts.end(),
+                                    std::make_pair(port.ssl.cert,
+                                                   port.ssl.key)),
+                        unusedCerts.end());
             }
         }
     }
+
+    for (const auto& cert : unusedCerts) {
+        evict_ssl_server_context(cert.first, cert.second);
+    }
     s.calculateMaxconns();
 }
 
@@ -538,6 +584,8 @@ static void settings_init(void) {
                                ssl_minimum_protocol_changed_listener);
     settings.addChangeListener("ssl_cipher_list",
                                ssl_cipher_list_changed_listener);
+    settings.addChangeListener("client_cert_auth",
+                               client_cert_auth_changed_listener);
     settings.addChangeListener("verbosity", verbosity_changed_listener);
     settings.addChangeListener("interfaces", interfaces_changed_listener);
     settings.addChangeListener("saslauthd_socketpath",
@@ -847,33 +895,17 @@ ENGINE_ERROR_CODE refresh_cbsasl(Connection *c)
     return ENGINE_EWOULDBLOCK;
 }
 
-#if 0
-static void ssl_certs_refresh_main(void *c)
-{
-    /* Update the internal certificates */
-
-    notify_io_complete(c, ENGINE_SUCCESS);
-}
-#endif
-
 ENGINE_ERROR_CODE refresh_ssl_certs(Connection *c)
 {
-    (void)c;
-#if 0
-    cb_thread_t tid;
-    int err;
-
-    err = cb_create_thread(&tid, ssl_certs_refresh_main, c, 1);
-    if (err != 0) {
-        settings.extensions.logger->log(EXTENSION_LOG_WARNING, c,
-                                        "Failed to create ssl_certificate "
-                                        "update thread: %s",
-                                        strerror(err));
-        return ENGINE_DISCONNECT;
+    // Rebuild the SSL contexts shared by the connections from the
+    // certificates on disk. Connections already established keep using the
+    // context they were created with, new ones pick up the new one.
+    if (!reload_ssl_server_contexts()) {
+        LOG_WARNING(c,
+                    "Failed to reload one or more SSL certificates; the "
+                    "previous certificates are still in use");
+        return ENGINE_FAILED;
     }
-
-    return ENGINE_EWOULDBLOCK;
-#endif
     return ENGINE_SUCCESS;
 }
 
@@ -2116,7 +2148,9 @@ void CreateBucketThread::create() {
         all_buckets[ii].type = type;
         strcpy(all_buckets[ii].name, name.c_str());
         try {
-            all_buckets[ii].topkeys = new TopKeys(settings.getTopkeysSize());
+            all_buckets[ii].topkeys =
+                    new TopKeys(settings.getTopkeysSize(),
+                                settings.getNumWorkerThreads());
         } catch (const std::bad_alloc &) {
             result = ENGINE_ENOMEM;
             LOG_WARNING(&connection,
@@ -2362,6 +2396,7 @@ static void initialize_buckets(void) {
     int numthread = settings.getNumWorkerThreads() + 1;
     for (auto &b : all_buckets) {
         b.stats = new thread_stats[numthread];
+        b.timings.initialize(numthread);
     }
 
     // To make the life easier for us in the code, index 0
@@ -2929,6 +2964,7 @@ extern "C" int memcached_main(int argc, char **argv) {
     free_callbacks();
 
     LOG_NOTICE(NULL, "Shutting down OpenSSL");
+    invalidate_ssl_server_contexts();
     shutdown_openssl();
 
     LOG_NOTICE(NULL, "Shutting down libevent");
@@ -2,6 +2,7 @@
 #ifndef MEMCACHED_H
 #define MEMCACHED_H
 
+#include <atomic>
 #include <mutex>
 #include <vector>
 
@@ -35,6 +36,9 @@
 #define DATA_BUFFER_SIZE 2048
 #define MAX_SENDBUF_SIZE (256 * 1024 * 1024)
 
+/** Maximum number of idle network buffers kept by each worker thread. */
+#define MAX_POOLED_NETWORK_BUFFERS 64
+
 /** Initial size of list of items being returned by "get". */
 #define ITEM_LIST_INITIAL 200
 
@@ -70,12 +74,26 @@ enum class ThreadType {
 
 class Connection;
 class ConnectionQueue;
+class NetworkBufferPool;
 
 struct LIBEVENT_THREAD {
     cb_thread_t thread_id;      /* unique ID of this thread */
     struct event_base *base;    /* libevent handle this thread uses */
     struct event notify_event;  /* listen event for notify pipe */
-    SOCKET notify[2];           /* notification pipes */
+    SOCKET notify[2];           /* notification pipes (for worker threads
+                                   on Linux both are the same eventfd) */
+
+    /**
+     * Set when a wakeup has been sent to the thread which it hasn't
+     * started processing yet; further notifications are coalesced into
+     * it rather than writing to the notification pipe again.
+     */
+    std::atomic<bool> notify_pending;
+    /** Number of wakeups written to the notification pipe */
+    std::atomic<uint64_t> notify_sent;
+    /** Number of notifications coalesced into a pending wakeup */
+    std::atomic<uint64_t> notify_coalesced;
+
     ConnectionQueue *new_conn_queue; /* queue of new connections to handle */
     cb_mutex_t mutex;      /* Mutex to lock protect access to the pending_io */
     bool is_locked;
@@ -83,8 +101,9 @@ struct LIBEVENT_THREAD {
     int index;                  /* index of this thread in the threads array */
     ThreadType type;      /* Type of IO this thread processes */
 
-    struct net_buf read; /** Shared read buffer for all connections serviced by this thread. */
-    struct net_buf write; /** Shared write buffer for all connections serviced by this thread. */
+    /** Pool of read / write buffers for the connections serviced by this
+     * thread. */
+    NetworkBufferPool* bufferPool;
 
     subdoc_OPERATION* subdoc_op; /** Shared sub-document operation for all
                                      connections serviced by this thread. */
@@ -152,6 +171,24 @@ void thread_init(int nthreads, struct event_base *main_base,
 void threads_shutdown(void);
 void threads_cleanup(void);
 
+/**
+ * Get the memory used by the worker threads' network buffers.
+ *
+ * @param pooled set to the bytes held by idle buffers in the thread pools
+ * @param outstanding set to the bytes held by buffers loaned to connections
+ */
+void threads_get_network_buffer_stats(size_t& pooled, size_t& outstanding);
+
+/**
+ * Get the number of times the worker threads were woken up.
+ *
+ * @param sent set to the number of wakeups written to the threads'
+ *             notification pipes
+ * @param coalesced set to the number of notifications which didn't need a
+ *                  wakeup of their own, as one was already pending
+ */
+void threads_get_notification_stats(uint64_t& sent, uint64_t& coalesced);
+
 void dispatch_conn_new(SOCKET sfd, int parent_port);
 
 /* Lock wrappers for cache functions that are called from main loop. */
@@ -0,0 +1,71 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "network_buffer_pool.h"
+
+#include <platform/cb_malloc.h>
+
+NetworkBufferPool::NetworkBufferPool(size_t bufferSize, size_t maxPooled)
+    : bufferSize(bufferSize),
+      maxPooled(maxPooled),
+      pooledBytes(0),
+      outstandingBytes(0) {
+    buffers.reserve(maxPooled);
+}
+
+NetworkBufferPool::~NetworkBufferPool() {
+    for (auto* buf : buffers) {
+        cb_free(buf);
+    }
+}
+
+char* NetworkBufferPool::get(bool& pooled) {
+    char* ret;
+    if (buffers.empty()) {
+        pooled = false;
+        ret = reinterpret_cast<char*>(cb_malloc(bufferSize));
+        if (ret == nullptr) {
+            return nullptr;
+        }
+    } else {
+        pooled = true;
+        ret = buffers.back();
+        buffers.pop_back();
+        pooledBytes.fetch_sub(bufferSize, std::memory_order_relaxed);
+    }
+    outstandingBytes.fetch_add(bufferSize, std::memory_order_relaxed);
+    return ret;
+}
+
+void NetworkBufferPool::put(char* buf, size_t size) {
+    outstandingBytes.fetch_sub(size, std::memory_order_relaxed);
+    if (size != bufferSize || buffers.size() >= maxPooled) {
+        cb_free(buf);
+        return;
+    }
+    buffers.push_back(buf);
+    pooledBytes.fetch_add(bufferSize, std::memory_order_relaxed);
+}
+
+void NetworkBufferPool::resized(size_t oldSize, size_t newSize) {
+    if (newSize > oldSize) {
+        outstandingBytes.fetch_add(newSize - oldSize,
+                                   std::memory_order_relaxed);
+    } else {
+        outstandingBytes.fetch_sub(oldSize - newSize,
+                                   std::memory_order_relaxed);
+    }
+}
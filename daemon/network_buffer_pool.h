@@ -0,0 +1,90 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * A pool of the network (read / write) buffers used by the connections
+ * served by a worker thread.
+ *
+ * Connections borrow buffers from their thread's pool when they've got
+ * work to do, and return them when they go idle (unless they're holding
+ * on to a partially read packet), so the memory used for the buffers is
+ * proportional to the number of busy connections rather than the number
+ * of connected clients.
+ *
+ * All of the buffers in the pool have the same size; a buffer which has
+ * grown to hold a large packet is freed rather than pooled when it is
+ * returned. At most maxPooled buffers are kept around.
+ *
+ * The pool is only ever used by the thread owning it. The memory counters
+ * may be read from any thread.
+ */
+class NetworkBufferPool {
+public:
+    NetworkBufferPool(size_t bufferSize, size_t maxPooled);
+
+    NetworkBufferPool(const NetworkBufferPool&) = delete;
+
+    ~NetworkBufferPool();
+
+    /**
+     * Get a buffer of getBufferSize() bytes.
+     *
+     * @param pooled set to true if the buffer came from the pool, false if
+     *               it had to be allocated
+     * @return the buffer, or nullptr if we failed to allocate one
+     */
+    char* get(bool& pooled);
+
+    /**
+     * Give a buffer back to the pool.
+     *
+     * @param buf the buffer (obtained from get())
+     * @param size the current size of the buffer
+     */
+    void put(char* buf, size_t size);
+
+    /**
+     * Record that a connection resized (reallocated) one of its buffers.
+     */
+    void resized(size_t oldSize, size_t newSize);
+
+    size_t getBufferSize() const {
+        return bufferSize;
+    }
+
+    /// The memory held by the buffers sitting in the pool
+    size_t getPooledBytes() const {
+        return pooledBytes.load(std::memory_order_relaxed);
+    }
+
+    /// The memory held by the buffers currently borrowed by connections
+    size_t getOutstandingBytes() const {
+        return outstandingBytes.load(std::memory_order_relaxed);
+    }
+
+private:
+    const size_t bufferSize;
+    const size_t maxPooled;
+    std::vector<char*> buffers;
+    std::atomic<size_t> pooledBytes;
+    std::atomic<size_t> outstandingBytes;
+};
@@ -94,6 +94,15 @@ ENGINE_ERROR_CODE dcp_message_deletion(const void* void_cookie,
     // Use a unique_ptr to make sure we release the item in all error paths
     cb::unique_item_ptr item(it, cb::ItemDeleter{c->getBucketEngineAsV0()});
 
+    // check if we've got enough space in our current buffer to fit
+    // this message (before we reserve the item).
+    const size_t packetlen =
+            protocol_binary_request_dcp_deletion::getHeaderLength(
+                    c->isDcpCollectionAware());
+    if (c->write.bytes + packetlen + nmeta >= c->write.size) {
+        return ENGINE_E2BIG;
+    }
+
     item_info info;
     if (!bucket_get_item_info(c, it, &info)) {
         LOG_WARNING(c, "%u: dcp_message_deletion: Failed to get item info",
@@ -134,16 +143,6 @@ ENGINE_ERROR_CODE dcp_message_deletion(const void* void_cookie,
 
     packet.message.header.request.opcode = (uint8_t)PROTOCOL_BINARY_CMD_DCP_DELETION;
 
-    const size_t packetlen =
-            protocol_binary_request_dcp_deletion::getHeaderLength(
-                    c->isDcpCollectionAware());
-
-    // check if we've got enough space in our current buffer to fit
-    // this message.
-    if (c->write.bytes + packetlen + nmeta >= c->write.size) {
-        return ENGINE_E2BIG;
-    }
-
     // Add the header
     c->addIov(c->write.curr, packetlen);
     memcpy(c->write.curr, packet.bytes, packetlen);
@@ -42,6 +42,16 @@ ENGINE_ERROR_CODE dcp_message_mutation(const void* void_cookie,
     // Use a unique_ptr to make sure we release the item in all error paths
     cb::unique_item_ptr item(it, cb::ItemDeleter{c->getBucketEngineAsV0()});
 
+    // Check that the message fits in the write buffer before doing any work
+    // (the producer hands it to us again once the buffer has been sent)
+    const size_t packetlen =
+            protocol_binary_request_dcp_mutation::getHeaderLength(
+                    c->isDcpCollectionAware());
+    if (c->write.bytes + packetlen + nmeta >= c->write.size) {
+        /* We don't have room in the buffer */
+        return ENGINE_E2BIG;
+    }
+
     item_info info;
 
     if (!bucket_get_item_info(c, it, &info)) {
@@ -133,14 +143,6 @@ ENGINE_ERROR_CODE dcp_message_mutation(const void* void_cookie,
                                                 nru,
                                                 collection_len);
 
-    const size_t packetlen =
-            protocol_binary_request_dcp_mutation::getHeaderLength(
-                    c->isDcpCollectionAware());
-    if (c->write.bytes + packetlen + nmeta >= c->write.size) {
-        /* We don't have room in the buffer */
-        return ENGINE_E2BIG;
-    }
-
     memcpy(c->write.curr, packet.bytes, packetlen);
     c->addIov(c->write.curr, packetlen);
     c->write.curr += packetlen;
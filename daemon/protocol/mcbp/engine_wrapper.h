@@ -68,6 +68,15 @@ cb::EngineErrorItemPair bucket_get(
         uint16_t vbucket,
         DocStateFilter documentStateFilter = DocStateFilter::Alive);
 
+/**
+ * Fetch a batch of keys through the bucket's get_multi entry point. The
+ * caller must have checked that the bucket provides one.
+ */
+std::vector<cb::EngineErrorItemPair> bucket_get_multi(
+        McbpConnection* c,
+        const std::vector<cb::GetMultiKey>& keys,
+        DocStateFilter documentStateFilter = DocStateFilter::Alive);
+
 cb::EngineErrorItemPair bucket_get_if(McbpConnection* c,
                                       const DocKey& key,
                                       uint16_t vbucket,
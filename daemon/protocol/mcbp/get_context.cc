@@ -22,8 +22,25 @@
 #include <xattr/utils.h>
 #include <daemon/mcaudit.h>
 
+ENGINE_ERROR_CODE GetCommandContext::coalesceGets() {
+    state = State::GetItem;
+
+    const auto cmd = connection.getCmd();
+    if ((cmd == PROTOCOL_BINARY_CMD_GETQ || cmd == PROTOCOL_BINARY_CMD_GETKQ) &&
+        connection.getBucketEngine()->get_multi != nullptr &&
+        !connection.hasPrefetchedGets() &&
+        connection.coalescePipelinedGets(key, vbucket)) {
+        return ENGINE_EWOULDBLOCK;
+    }
+
+    return ENGINE_SUCCESS;
+}
+
 ENGINE_ERROR_CODE GetCommandContext::getItem() {
-    auto ret = bucket_get(&connection, key, vbucket);
+    cb::EngineErrorItemPair ret;
+    if (!connection.takePrefetchedGet(key, vbucket, ret)) {
+        ret = bucket_get(&connection, key, vbucket);
+    }
     if (ret.first == cb::engine_errc::success) {
         it = std::move(ret.second);
         if (!bucket_get_item_info(&connection, it.get(), &info)) {
@@ -149,6 +166,9 @@ ENGINE_ERROR_CODE GetCommandContext::step() {
     ENGINE_ERROR_CODE ret;
     do {
         switch (state) {
+        case State::CoalesceGets:
+            ret = coalesceGets();
+            break;
         case State::GetItem:
             ret = getItem();
             break;
@@ -30,6 +30,7 @@ public:
     // for the functions with the same name to figure out what each
     // state does
     enum class State : uint8_t {
+        CoalesceGets,
         GetItem,
         NoSuchItem,
         InflateItem,
@@ -45,7 +46,7 @@ public:
               c.getDocNamespace()),
           vbucket(ntohs(req->message.header.request.vbucket)),
           it(nullptr, cb::ItemDeleter{c.getBucketEngineAsV0()}),
-          state(State::GetItem) {
+          state(State::CoalesceGets) {
     }
 
 protected:
@@ -69,6 +70,21 @@ protected:
                connection.getCmd() == PROTOCOL_BINARY_CMD_GETKQ;
     }
 
+    /**
+     * If this is a quiet get (GETQ / GETKQ) which may be followed by more
+     * of the same in the read buffer, let the connection fetch all of
+     * their keys from the engine in one batch (see
+     * McbpConnection::coalescePipelinedGets). The following commands then
+     * pick up their results in getItem().
+     *
+     * The next state is always State::GetItem.
+     *
+     * @return ENGINE_EWOULDBLOCK if any of the batched keys needs to be
+     *         fetched from disk
+     *         ENGINE_SUCCESS if we want to continue to run the state diagram
+     */
+    ENGINE_ERROR_CODE coalesceGets();
+
     /**
      * Try to lookup the named item in the underlying engine. Given that
      * the engine may block we would return ENGINE_EWOULDBLOCK in these cases
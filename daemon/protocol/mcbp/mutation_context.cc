@@ -40,9 +40,18 @@ MutationCommandContext::MutationCommandContext(McbpConnection& c,
       flags(req->message.body.flags),
       datatype(req->message.header.request.datatype),
       state(State::ValidateInput),
+      receivedItem(nullptr, cb::ItemDeleter{c.getBucketEngineAsV0()}),
       newitem(nullptr, cb::ItemDeleter{c.getBucketEngineAsV0()}),
+      newitemIsReceived(false),
       existing(nullptr, cb::ItemDeleter{c.getBucketEngineAsV0()}),
       xattr_size(0) {
+    if (c.getValueItemLength() != 0) {
+        // The value isn't in the packet, it was received straight into an
+        // item (see conn_read_packet_value)
+        auto received = c.takeValueItem();
+        receivedItem = std::move(received.first);
+        value = received.second;
+    }
 }
 
 ENGINE_ERROR_CODE MutationCommandContext::step() {
@@ -171,18 +180,25 @@ ENGINE_ERROR_CODE MutationCommandContext::getExistingItemToPreserveXattr() {
 }
 
 ENGINE_ERROR_CODE MutationCommandContext::allocateNewItem() {
-    auto dtype = datatype;
-    if (xattr_size > 0) {
-        dtype |= PROTOCOL_BINARY_DATATYPE_XATTR;
-    }
-    auto ret = bucket_allocate(&connection, key, value.len + xattr_size,
-                               flags, expiration, dtype, vbucket);
+    if (receivedItem && xattr_size == 0) {
+        // The value is already in an item of the right size; use it as is
+        // rather than copying it into a new one
+        newitem = std::move(receivedItem);
+        newitemIsReceived = true;
+    } else {
+        auto dtype = datatype;
+        if (xattr_size > 0) {
+            dtype |= PROTOCOL_BINARY_DATATYPE_XATTR;
+        }
+        auto ret = bucket_allocate(&connection, key, value.len + xattr_size,
+                                   flags, expiration, dtype, vbucket);
 
-    if (ret.first != cb::engine_errc::success) {
-        return ENGINE_ERROR_CODE(ret.first);
-    }
+        if (ret.first != cb::engine_errc::success) {
+            return ENGINE_ERROR_CODE(ret.first);
+        }
 
-    newitem = std::move(ret.second);
+        newitem = std::move(ret.second);
+    }
 
     if (operation == OPERATION_ADD || input_cas != 0) {
         bucket_item_set_cas(&connection, newitem.get(), input_cas);
@@ -199,6 +215,19 @@ ENGINE_ERROR_CODE MutationCommandContext::allocateNewItem() {
         return ENGINE_FAILED;
     }
 
+    if (newitemIsReceived) {
+        if (newitem_info.datatype != datatype) {
+            // validateInput() found the value to be JSON
+            newitem_info.datatype = datatype;
+            if (!bucket_set_item_info(
+                        &connection, newitem.get(), &newitem_info)) {
+                return ENGINE_FAILED;
+            }
+        }
+        state = State::StoreItem;
+        return ENGINE_SUCCESS;
+    }
+
     uint8_t* root = reinterpret_cast<uint8_t*>(newitem_info.value[0].iov_base);
     if (xattr_size > 0) {
         // Preserve the xattrs
@@ -278,6 +307,11 @@ ENGINE_ERROR_CODE MutationCommandContext::sendResponse() {
 }
 
 ENGINE_ERROR_CODE MutationCommandContext::reset() {
+    if (newitemIsReceived) {
+        // value lives in it, so keep it for the retry
+        receivedItem = std::move(newitem);
+        newitemIsReceived = false;
+    }
     newitem.reset();
     existing.reset();
     xattr_size = 0;
@@ -105,7 +105,8 @@ protected:
 private:
     const ENGINE_STORE_OPERATION operation;
     const DocKey key;
-    const cb::const_char_buffer value;
+    // The value provided by the client (in the packet or receivedItem)
+    cb::const_char_buffer value;
     const uint16_t vbucket;
     const uint64_t input_cas;
     const rel_time_t expiration;
@@ -118,9 +119,17 @@ private:
     // The current state
     State state;
 
+    // The item the client's value was received into (if it was too big to
+    // go through the read buffer). It becomes the new document unless
+    // there are xattrs to preserve.
+    cb::unique_item_ptr receivedItem;
+
     // The newly created document
     cb::unique_item_ptr newitem;
 
+    // Is newitem the item the value was received into?
+    bool newitemIsReceived;
+
     // Pointer to the current value stored in the engine
     cb::unique_item_ptr existing;
 
@@ -210,6 +210,21 @@ static ENGINE_ERROR_CODE server_stats(ADD_STAT add_stat_callback,
                  thread_stats.wbufs_allocated);
         add_stat(cookie, add_stat_callback, "wbufs_loaned",
                  thread_stats.wbufs_loaned);
+
+        size_t pooled;
+        size_t outstanding;
+        threads_get_network_buffer_stats(pooled, outstanding);
+        add_stat(cookie, add_stat_callback, "network_buffers_pooled_bytes",
+                 uint64_t(pooled));
+        add_stat(cookie, add_stat_callback,
+                 "network_buffers_outstanding_bytes", uint64_t(outstanding));
+
+        uint64_t wakeups;
+        uint64_t coalesced;
+        threads_get_notification_stats(wakeups, coalesced);
+        add_stat(cookie, add_stat_callback, "worker_wakeups", wakeups);
+        add_stat(cookie, add_stat_callback, "worker_wakeups_coalesced",
+                 coalesced);
         add_stat(cookie, add_stat_callback, "iovused_high_watermark",
                  thread_stats.iovused_high_watermark);
         add_stat(cookie, add_stat_callback, "msgused_high_watermark",
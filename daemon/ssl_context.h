@@ -23,8 +23,51 @@
 #include <cJSON.h>
 #include <memcached/openssl.h>
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
+/**
+ * Get the SSL_CTX for connections using the given certificate chain and
+ * private key.
+ *
+ * Creating a context reads the certificate chain and private key (and the
+ * CA list with client certificate authentication) from disk, so all of the
+ * connections using the same files share one context, which is only
+ * recreated when the certificates are refreshed or one of the settings it
+ * is built from changes. Sharing the context also lets clients resume their
+ * TLS sessions when they reconnect (from the context's session cache, or
+ * with a session ticket encrypted with the context's keys).
+ *
+ * @param cert the certificate chain file to use
+ * @param pkey the private key file to use
+ * @return the context, or nullptr if it could not be created
+ */
+std::shared_ptr<SSL_CTX> get_ssl_server_context(const std::string& cert,
+                                                const std::string& pkey);
+
+/**
+ * Recreate all of the SSL contexts from the certificates on disk (for
+ * PROTOCOL_BINARY_CMD_SSL_CERTS_REFRESH). A context which fails to reload
+ * keeps being used.
+ *
+ * @return true if all of the contexts were reloaded
+ */
+bool reload_ssl_server_contexts();
+
+/**
+ * Drop all of the SSL contexts so that they are recreated (with the current
+ * settings) by the next connections. Existing connections are unaffected.
+ */
+void invalidate_ssl_server_contexts();
+
+/**
+ * Drop the SSL context for the given certificate chain and private key,
+ * once no interface uses them any more. Existing connections keep using it.
+ */
+void evict_ssl_server_context(const std::string& cert,
+                              const std::string& pkey);
+
 /**
  * The SslContext class is a holder class for all of the ssl-related
  * information used by the connection object.
@@ -128,7 +171,7 @@ protected:
     bool error = false;
     BIO* application = nullptr;
     BIO* network = nullptr;
-    SSL_CTX* ctx = nullptr;
+    std::shared_ptr<SSL_CTX> ctx;
     SSL* client = nullptr;
 
     struct bio_buffer {
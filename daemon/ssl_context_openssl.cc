@@ -19,6 +19,10 @@
 #include "memcached.h"
 #include "runtime.h"
 
+#include <map>
+#include <mutex>
+#include <vector>
+
 SslContext::~SslContext() {
     if (enabled) {
         disable();
@@ -45,21 +49,40 @@ int SslContext::peek(void* buf, int num) {
     return SSL_peek(client, buf, num);
 }
 
-bool SslContext::enable(const std::string& cert, const std::string& pkey) {
-    ctx = SSL_CTX_new(SSLv23_server_method());
-    set_ssl_ctx_protocol_mask(ctx);
+/**
+ * The session id context our sessions are tagged with. OpenSSL refuses to
+ * resume the session of a client which presented a certificate unless the
+ * context is set.
+ */
+static const unsigned char sslSessionIdContext[] = "memcached";
+
+static std::mutex serverContextsMutex;
+using ServerContextKey = std::pair<std::string, std::string>;
+static std::map<ServerContextKey, std::shared_ptr<SSL_CTX>> serverContexts;
+// Bumped every time the contexts are invalidated, so that a context created
+// with the old settings isn't put back in the map
+static uint64_t serverContextsGeneration = 0;
+
+static std::shared_ptr<SSL_CTX> create_ssl_server_context(
+        const std::string& cert, const std::string& pkey) {
+    SSL_CTX* raw = SSL_CTX_new(SSLv23_server_method());
+    if (raw == nullptr) {
+        LOG_WARNING(nullptr, "Failed to create SSL context");
+        return nullptr;
+    }
+    std::shared_ptr<SSL_CTX> ctx(raw, SSL_CTX_free);
+    set_ssl_ctx_protocol_mask(raw);
 
-    /* @todo don't read files, but use in-memory-copies */
-    if (!SSL_CTX_use_certificate_chain_file(ctx, cert.c_str()) ||
-        !SSL_CTX_use_PrivateKey_file(ctx, pkey.c_str(), SSL_FILETYPE_PEM)) {
+    if (!SSL_CTX_use_certificate_chain_file(raw, cert.c_str()) ||
+        !SSL_CTX_use_PrivateKey_file(raw, pkey.c_str(), SSL_FILETYPE_PEM)) {
         LOG_WARNING(nullptr,
                     "Failed to use SSL cert %s and pkey %s",
                     cert.c_str(),
                     pkey.c_str());
-        return false;
+        return nullptr;
     }
 
-    set_ssl_ctx_cipher_list(ctx);
+    set_ssl_ctx_cipher_list(raw);
     int ssl_flags = 0;
     switch (settings.getClientCertAuth()) {
     case ClientCertAuth::Mode::Mandatory:
@@ -70,17 +93,106 @@ bool SslContext::enable(const std::string& cert, const std::string& pkey) {
         STACK_OF(X509_NAME)* certNames = SSL_load_client_CA_file(cert.c_str());
         if (certNames == NULL) {
             LOG_WARNING(nullptr, "Failed to read SSL cert %s", cert.c_str());
-            return false;
+            return nullptr;
         }
-        SSL_CTX_set_client_CA_list(ctx, certNames);
-        SSL_CTX_load_verify_locations(ctx, cert.c_str(), nullptr);
-        SSL_CTX_set_verify(ctx, ssl_flags, nullptr);
+        SSL_CTX_set_client_CA_list(raw, certNames);
+        SSL_CTX_load_verify_locations(raw, cert.c_str(), nullptr);
+        SSL_CTX_set_verify(raw, ssl_flags, nullptr);
         break;
     }
     case ClientCertAuth::Mode::Disabled:
         break;
     }
 
+    // Session tickets are enabled by default, the session cache needs to
+    // be told that we're a server
+    SSL_CTX_set_session_cache_mode(raw, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_set_session_id_context(
+            raw, sslSessionIdContext, sizeof(sslSessionIdContext) - 1);
+
+    return ctx;
+}
+
+std::shared_ptr<SSL_CTX> get_ssl_server_context(const std::string& cert,
+                                                const std::string& pkey) {
+    const ServerContextKey key{cert, pkey};
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> guard(serverContextsMutex);
+        auto iter = serverContexts.find(key);
+        if (iter != serverContexts.end()) {
+            return iter->second;
+        }
+        generation = serverContextsGeneration;
+    }
+
+    // Read the files without holding the lock. Connections racing with us
+    // may do the same, in which case the first context stored is used.
+    auto ctx = create_ssl_server_context(cert, pkey);
+    if (!ctx) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(serverContextsMutex);
+    if (generation != serverContextsGeneration) {
+        // Invalidated while we were creating it; use it for this connection
+        // only
+        return ctx;
+    }
+    return serverContexts.emplace(key, ctx).first->second;
+}
+
+bool reload_ssl_server_contexts() {
+    std::vector<ServerContextKey> keys;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> guard(serverContextsMutex);
+        for (const auto& entry : serverContexts) {
+            keys.push_back(entry.first);
+        }
+        generation = serverContextsGeneration;
+    }
+
+    bool success = true;
+    std::vector<std::pair<ServerContextKey, std::shared_ptr<SSL_CTX>>> reloaded;
+    for (const auto& key : keys) {
+        auto ctx = create_ssl_server_context(key.first, key.second);
+        if (ctx) {
+            reloaded.emplace_back(key, std::move(ctx));
+        } else {
+            success = false;
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(serverContextsMutex);
+    if (generation == serverContextsGeneration) {
+        for (auto& entry : reloaded) {
+            serverContexts[entry.first] = std::move(entry.second);
+        }
+    }
+    return success;
+}
+
+void invalidate_ssl_server_contexts() {
+    std::lock_guard<std::mutex> guard(serverContextsMutex);
+    serverContexts.clear();
+    ++serverContextsGeneration;
+}
+
+void evict_ssl_server_context(const std::string& cert,
+                              const std::string& pkey) {
+    std::lock_guard<std::mutex> guard(serverContextsMutex);
+    serverContexts.erase(ServerContextKey{cert, pkey});
+    // Don't let a connection creating a context for it put it back
+    ++serverContextsGeneration;
+}
+
+bool SslContext::enable(const std::string& cert, const std::string& pkey) {
+    ctx = get_ssl_server_context(cert, pkey);
+    if (!ctx) {
+        return false;
+    }
+
     enabled = true;
     error = false;
     client = NULL;
@@ -95,7 +207,7 @@ bool SslContext::enable(const std::string& cert, const std::string& pkey) {
     BIO_new_bio_pair(
             &application, in.buffer.size(), &network, out.buffer.size());
 
-    client = SSL_new(ctx);
+    client = SSL_new(ctx.get());
     SSL_set_bio(client, application, application);
 
     return true;
@@ -127,9 +239,7 @@ void SslContext::disable() {
         SSL_free(client);
     }
     error = false;
-    if (ctx != nullptr) {
-        SSL_CTX_free(ctx);
-    }
+    ctx.reset();
     enabled = false;
 }
 
@@ -239,6 +349,10 @@ cJSON* SslContext::toJSON() const {
         cJSON_AddNumberToObject(obj, "input_buff_current", in.current);
         cJSON_AddNumberToObject(obj, "output_buff_total", out.total);
         cJSON_AddNumberToObject(obj, "output_buff_current", out.current);
+        if (connected) {
+            cJSON_AddBoolToObject(
+                    obj, "session_reused", SSL_session_reused(client) == 1);
+        }
     }
 
     return obj;
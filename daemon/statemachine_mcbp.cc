@@ -84,6 +84,8 @@ const char* McbpStateMachine::getTaskName(TaskFunction task) const {
         return "conn_parse_cmd";
     } else if (task == conn_read_packet_body) {
         return "conn_read_packet_body";
+    } else if (task == conn_read_packet_value) {
+        return "conn_read_packet_value";
     } else if (task == conn_execute) {
         return "conn_execute";
     } else if (task == conn_closing) {
@@ -125,6 +127,7 @@ static void reset_cmd_handler(McbpConnection *c) {
 
     c->getCookieObject().reset();
     c->resetCommandContext();
+    c->releaseValueItem();
 
     if (c->read.bytes == 0) {
         /* Make the whole read buffer available. */
@@ -218,6 +221,13 @@ bool conn_waiting(McbpConnection *c) {
         c->setState(conn_closing);
         return true;
     }
+
+    // Nothing is in flight while we're waiting for the next command, so
+    // hand the (empty) network buffers back to the thread's pool rather
+    // than holding on to them while idle. This can't be done at the end of
+    // runEventLoop() as the response header is built at the start of the
+    // write buffer without updating its curr / bytes (MB-24634).
+    conn_return_buffers(c);
     c->setState(conn_read_packet_header);
     return false;
 }
@@ -332,13 +342,84 @@ static bool conn_execute(McbpConnection *c) {
     return !block;
 }
 
+/**
+ * Receive (up to) nbytes of the current packet from the socket into dest.
+ *
+ * @param c the connection to read from
+ * @param dest where to store the data
+ * @param nbytes the number of bytes of the packet still to receive
+ * @param cont set to the state machine's return value if nothing was
+ *             received
+ * @return the number of bytes received, or 0 if nothing was received (in
+ *         which case the connection is either waiting for more data or
+ *         closing)
+ */
+static size_t receive_packet_data(McbpConnection* c,
+                                  char* dest,
+                                  uint32_t nbytes,
+                                  bool& cont) {
+    auto res = c->recv(dest, nbytes);
+    auto error = GetLastNetworkError();
+    if (res > 0) {
+        get_thread_stats(c)->bytes_read += res;
+        return size_t(res);
+    }
+
+    cont = true;
+    if (res == 0) { /* end of stream */
+        c->setState(conn_closing);
+        return 0;
+    }
+
+    if (res == -1 && is_blocking(error)) {
+        if (!c->updateEvent(EV_READ | EV_PERSIST)) {
+            LOG_WARNING(c,
+                        "%u: receive_packet_data - Unable to update "
+                        "libevent settings with (EV_READ | EV_PERSIST), "
+                        "closing connection (%p) %s",
+                        c->getId(),
+                        c->getCookie(),
+                        c->getDescription().c_str());
+            c->setState(conn_closing);
+            return 0;
+        }
+        cont = false;
+        return 0;
+    }
+
+    /* otherwise we have a real error, on which we close the connection */
+    if (!is_closed_conn(error)) {
+        LOG_WARNING(c,
+                    "%u Failed to read, and not due to blocking:\n"
+                        "errno: %d %s \n"
+                        "rcurr=%lx rbuf=%lx rlbytes=%d rsize=%d\n",
+                    c->getId(), errno, strerror(errno),
+                    (long)c->read.curr, (long)c->read.buf,
+                    (int)c->getRlbytes(), (int)c->read.size);
+    }
+    c->setState(conn_closing);
+    return 0;
+}
+
+/**
+ * The state to enter once the part of the packet which goes into the read
+ * buffer has been read: either receive the value (into an item) or execute
+ * the command.
+ */
+static TaskFunction next_packet_body_state(McbpConnection* c) {
+    if (c->getValueItemLength() != 0) {
+        return conn_read_packet_value;
+    }
+    return conn_execute;
+}
+
 bool conn_read_packet_body(McbpConnection* c) {
     if (is_bucket_dying(c)) {
         return true;
     }
 
     if (c->getRlbytes() == 0) {
-        c->setState(conn_execute);
+        c->setState(next_packet_body_state(c));
         return true;
     }
 
@@ -351,51 +432,81 @@ bool conn_read_packet_body(McbpConnection* c) {
 
         if (c->getRlbytes() == 0) {
             // We've got all we need... go execute the command
-            c->setState(conn_execute);
+            c->setState(next_packet_body_state(c));
             return true;
         }
     }
 
     /*  now try reading from the socket */
-    auto res = c->recv(c->read.curr, c->getRlbytes());
-    auto error = GetLastNetworkError();
-    if (res > 0) {
-        get_thread_stats(c)->bytes_read += res;
-        c->read.curr += res;
-        c->setRlbytes(c->getRlbytes() - res);
+    bool cont;
+    auto nr = receive_packet_data(c, c->read.curr, c->getRlbytes(), cont);
+    if (nr == 0) {
+        return cont;
+    }
+    c->read.curr += nr;
+    c->setRlbytes(c->getRlbytes() - uint32_t(nr));
+    return true;
+}
+
+/**
+ * Receive the value of a SET/ADD/REPLACE directly into the item it is
+ * going to be stored in (see bin_read_chunk). The extras and the key have
+ * already been read into the read buffer, which lets us allocate the
+ * item.
+ */
+bool conn_read_packet_value(McbpConnection* c) {
+    if (is_bucket_dying(c)) {
         return true;
     }
-    if (res == 0) { /* end of stream */
-        c->setState(conn_closing);
+
+    if (!c->hasValueItem()) {
+        ENGINE_ERROR_CODE ret = c->getAiostat();
+        c->setAiostat(ENGINE_SUCCESS);
+        c->setEwouldblock(false);
+
+        if (ret == ENGINE_SUCCESS) {
+            ret = mcbp_allocate_value_item(c);
+        }
+
+        if (ret == ENGINE_EWOULDBLOCK) {
+            c->setEwouldblock(true);
+            c->unregisterEvent();
+            return false;
+        }
+
+        if (ret != ENGINE_SUCCESS) {
+            // Let the command itself deal with (and report) the failure
+            mcbp_read_value_into_buffer(c);
+            return true;
+        }
+    }
+
+    if (c->getValueItemRemaining() == 0) {
+        c->setState(conn_execute);
         return true;
     }
 
-    if (res == -1 && is_blocking(error)) {
-        if (!c->updateEvent(EV_READ | EV_PERSIST)) {
-            LOG_WARNING(c,
-                        "%u: conn_read_packet_body - Unable to update libevent "
-                        "settings with (EV_READ | EV_PERSIST), closing "
-                        "connection (%p) %s",
-                        c->getId(),
-                        c->getCookie(),
-                        c->getDescription().c_str());
-            c->setState(conn_closing);
+    // Pick up the part of the value we've already read from the socket
+    if (c->read.bytes > 0) {
+        uint32_t tocopy = std::min(c->getValueItemRemaining(), c->read.bytes);
+        std::copy(c->read.curr, c->read.curr + tocopy, c->getValueItemCurr());
+        c->addValueItemReceived(tocopy);
+        c->read.curr += tocopy;
+        c->read.bytes -= tocopy;
+
+        if (c->getValueItemRemaining() == 0) {
+            c->setState(conn_execute);
             return true;
         }
-        return false;
     }
 
-    /* otherwise we have a real error, on which we close the connection */
-    if (!is_closed_conn(error)) {
-        LOG_WARNING(c,
-                    "%u Failed to read, and not due to blocking:\n"
-                        "errno: %d %s \n"
-                        "rcurr=%lx rbuf=%lx rlbytes=%d rsize=%d\n",
-                    c->getId(), errno, strerror(errno),
-                    (long)c->read.curr, (long)c->read.buf,
-                    (int)c->getRlbytes(), (int)c->read.size);
+    bool cont;
+    auto nr = receive_packet_data(
+            c, c->getValueItemCurr(), c->getValueItemRemaining(), cont);
+    if (nr == 0) {
+        return cont;
     }
-    c->setState(conn_closing);
+    c->addValueItemReceived(uint32_t(nr));
     return true;
 }
 
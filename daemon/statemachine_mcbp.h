@@ -83,6 +83,7 @@ bool conn_waiting(McbpConnection* c);
 bool conn_read_packet_header(McbpConnection* c);
 bool conn_parse_cmd(McbpConnection* c);
 bool conn_read_packet_body(McbpConnection* c);
+bool conn_read_packet_value(McbpConnection* c);
 bool conn_pending_close(McbpConnection* c);
 bool conn_immediate_close(McbpConnection* c);
 bool conn_closing(McbpConnection* c);
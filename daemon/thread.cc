@@ -5,6 +5,7 @@
 #include "config.h"
 #include "memcached.h"
 #include "connections.h"
+#include "network_buffer_pool.h"
 
 #include <atomic>
 #include <stdio.h>
@@ -21,6 +22,10 @@
 #include <queue>
 #include <memory>
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
 #define ITEMS_PER_ALLOC 64
 
 static char devnull[8192];
@@ -145,10 +150,35 @@ bool create_notification_pipe(LIBEVENT_THREAD *me)
     return true;
 }
 
+/*
+ * Create the channel used to wake up a worker thread. Worker threads only
+ * need to know that they've got work to do (not how many times they were
+ * notified), so on Linux a (much cheaper) eventfd is used.
+ */
+static bool create_worker_notification_channel(LIBEVENT_THREAD *me) {
+#ifdef __linux__
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        LOG_WARNING(NULL, "Can't create notify eventfd: %s",
+                    cb_strerror().c_str());
+        return false;
+    }
+    me->notify[0] = me->notify[1] = fd;
+    return true;
+#else
+    return create_notification_pipe(me);
+#endif
+}
+
+static bool is_eventfd(const LIBEVENT_THREAD *thread) {
+    return thread->notify[0] == thread->notify[1];
+}
+
 static void setup_dispatcher(struct event_base *main_base,
                              void (*dispatcher_callback)(evutil_socket_t, short, void *))
 {
-    memset(&dispatcher_thread, 0, sizeof(dispatcher_thread));
+    memset(static_cast<void*>(&dispatcher_thread), 0,
+           sizeof(dispatcher_thread));
     dispatcher_thread.type = ThreadType::DISPATCHER;
     dispatcher_thread.base = main_base;
 	dispatcher_thread.thread_id = cb_thread_self();
@@ -203,6 +233,13 @@ static void setup_thread(LIBEVENT_THREAD *me) {
         FATAL_ERROR(EXIT_FAILURE, "Failed to allocate memory for connection queue");
     }
 
+    try {
+        me->bufferPool = new NetworkBufferPool(DATA_BUFFER_SIZE,
+                                               MAX_POOLED_NETWORK_BUFFERS);
+    } catch (const std::bad_alloc&) {
+        FATAL_ERROR(EXIT_FAILURE, "Failed to allocate memory for network buffer pool");
+    }
+
     cb_mutex_initialize(&me->mutex);
 
     // Initialize threads' sub-document parser / handler
@@ -246,8 +283,20 @@ static int number_of_pending(Connection *c, Connection *list) {
     return rv;
 }
 
-static void drain_notification_channel(evutil_socket_t fd)
+static void drain_notification_channel(LIBEVENT_THREAD* me)
 {
+    evutil_socket_t fd = me->notify[0];
+#ifdef __linux__
+    if (is_eventfd(me)) {
+        eventfd_t value;
+        if (eventfd_read(fd, &value) == -1 && errno != EAGAIN) {
+            LOG_WARNING(NULL, "Can't read from notify eventfd: %s",
+                        cb_strerror().c_str());
+        }
+        return;
+    }
+#endif
+
     int nread;
     while ((nread = recv(fd, devnull, sizeof(devnull), 0)) == (int)sizeof(devnull)) {
         /* empty */
@@ -289,7 +338,10 @@ static void thread_libevent_process(evutil_socket_t fd, short which, void *arg)
     // tries to notify us while we're doing the work below (so we don't have
     // to care about race conditions for stuff people try to notify us
     // about.
-    drain_notification_channel(fd);
+    drain_notification_channel(me);
+    // Any notification from now on needs a new wakeup; everything notified
+    // before this point is picked up below.
+    me->notify_pending.store(false);
 
     if (memcached_shutdown) {
         // Someone requested memcached to shut down. The listen thread should
@@ -532,7 +584,7 @@ void thread_init(int nthr, struct event_base *main_base,
     setup_dispatcher(main_base, dispatcher_callback);
 
     for (i = 0; i < nthreads; i++) {
-        if (!create_notification_pipe(&threads[i])) {
+        if (!create_worker_notification_channel(&threads[i])) {
             FATAL_ERROR(EXIT_FAILURE, "Cannot create notification pipe");
         }
         threads[i].index = i;
@@ -570,11 +622,12 @@ void threads_cleanup(void)
     int ii;
     for (ii = 0; ii < nthreads; ++ii) {
         safe_close(threads[ii].notify[0]);
-        safe_close(threads[ii].notify[1]);
+        if (!is_eventfd(&threads[ii])) {
+            safe_close(threads[ii].notify[1]);
+        }
         event_base_free(threads[ii].base);
 
-        cb_free(threads[ii].read.buf);
-        cb_free(threads[ii].write.buf);
+        delete threads[ii].bufferPool;
         subdoc_op_free(threads[ii].subdoc_op);
         delete threads[ii].validator;
         delete threads[ii].new_conn_queue;
@@ -584,6 +637,27 @@ void threads_cleanup(void)
     cb_free(threads);
 }
 
+void threads_get_network_buffer_stats(size_t& pooled, size_t& outstanding) {
+    pooled = 0;
+    outstanding = 0;
+    for (int ii = 0; ii < nthreads; ++ii) {
+        if (threads[ii].bufferPool != nullptr) {
+            pooled += threads[ii].bufferPool->getPooledBytes();
+            outstanding += threads[ii].bufferPool->getOutstandingBytes();
+        }
+    }
+}
+
+void threads_get_notification_stats(uint64_t& sent, uint64_t& coalesced) {
+    sent = 0;
+    coalesced = 0;
+    for (int ii = 0; ii < nthreads; ++ii) {
+        sent += threads[ii].notify_sent.load(std::memory_order_relaxed);
+        coalesced +=
+                threads[ii].notify_coalesced.load(std::memory_order_relaxed);
+    }
+}
+
 void threads_notify_bucket_deletion(void)
 {
     for (int ii = 0; ii < nthreads; ++ii) {
@@ -613,8 +687,39 @@ void threads_initiate_bucket_deletion(void)
 }
 
 void notify_thread(LIBEVENT_THREAD *thread) {
+    if (thread->type != ThreadType::GENERAL) {
+        // The dispatcher counts the notifications it receives, so these
+        // can't be coalesced.
+        if (send(thread->notify[1], "", 1, 0) != 1 &&
+                !is_blocking(GetLastNetworkError())) {
+            log_socket_error(EXTENSION_LOG_WARNING, NULL,
+                             "Failed to notify thread: %s");
+        }
+        return;
+    }
+
+    // A worker thread picks up all of its pending work each time it's
+    // woken, so if a wakeup is already pending there's no need for another.
+    if (thread->notify_pending.exchange(true)) {
+        thread->notify_coalesced.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    thread->notify_sent.fetch_add(1, std::memory_order_relaxed);
+
+#ifdef __linux__
+    if (is_eventfd(thread)) {
+        if (eventfd_write(thread->notify[1], 1) == -1) {
+            thread->notify_pending.store(false);
+            LOG_WARNING(NULL, "Failed to notify thread: %s",
+                        cb_strerror().c_str());
+        }
+        return;
+    }
+#endif
+
     if (send(thread->notify[1], "", 1, 0) != 1 &&
             !is_blocking(GetLastNetworkError())) {
+        thread->notify_pending.store(false);
         log_socket_error(EXTENSION_LOG_WARNING, NULL,
                          "Failed to notify thread: %s");
     }
@@ -35,27 +35,27 @@ TimingHistogram::TimingHistogram(const TimingHistogram &other) {
 
 template <template <typename ...Args> class F>
 void TimingHistogram::arith_op(TimingHistogram& a, const TimingHistogram& b) {
-    a.ns = F<uint32_t>()(a.ns, b.ns);
+    a.ns = F<uint64_t>()(a.ns, b.ns);
 
     size_t idx;
     size_t len = a.usec.size();
     for (idx = 0; idx < len; ++idx) {
-        a.usec[idx] = F<uint32_t>()(a.usec[idx], b.usec[idx]);
+        a.usec[idx] = F<uint64_t>()(a.usec[idx], b.usec[idx]);
     }
 
     len = a.msec.size();
     for (idx = 0; idx < len; ++idx) {
-        a.msec[idx] = F<uint32_t>()(a.msec[idx], b.msec[idx]);
+        a.msec[idx] = F<uint64_t>()(a.msec[idx], b.msec[idx]);
     }
 
     len = a.halfsec.size();
     for (idx = 0; idx < len; ++idx) {
-        a.halfsec[idx] = F<uint32_t>()(a.halfsec[idx], b.halfsec[idx]);
+        a.halfsec[idx] = F<uint64_t>()(a.halfsec[idx], b.halfsec[idx]);
     }
 
     len = a.wayout.size();
     for (idx = 0; idx < len; ++idx) {
-        a.wayout[idx] = F<uint32_t>()(a.wayout[idx], b.wayout[idx]);
+        a.wayout[idx] = F<uint64_t>()(a.wayout[idx], b.wayout[idx]);
     }
     a.total = F<uint64_t>()(a.total, b.total);
 }
@@ -104,38 +104,38 @@ void TimingHistogram::reset(void) {
     total.reset();
 }
 
-void TimingHistogram::add(const hrtime_t nsec) {
+void TimingHistogram::add(const hrtime_t nsec, const uint64_t count) {
     hrtime_t us = nsec / 1000;
     hrtime_t ms = us / 1000;
     hrtime_t hs = ms / 500;
 
     if (us == 0) {
-        ns++;
+        ns += count;
     } else if (us < 1000) {
-        usec[us / 10]++;
+        usec[us / 10] += count;
     } else if (ms < 50) {
-        msec[ms]++;
+        msec[ms] += count;
     } else if (hs < 10) {
-        halfsec[hs]++;
+        halfsec[hs] += count;
     } else {
         // [5-9], [10-19], [20-39], [40-79], [80-inf].
         hrtime_t sec = hs / 2;
         if (sec < 10) {
-            wayout[0]++;
+            wayout[0] += count;
         } else if (sec < 20) {
-            wayout[1]++;
+            wayout[1] += count;
         } else if (sec < 40) {
-            wayout[2]++;
+            wayout[2] += count;
         } else if (sec < 80) {
-            wayout[3]++;
+            wayout[3] += count;
         } else {
-            wayout[4]++;
+            wayout[4] += count;
         }
     }
-    total++;
+    total += count;
 }
 
-std::string TimingHistogram::to_string(void) {
+unique_cJSON_ptr TimingHistogram::to_json(void) {
     unique_cJSON_ptr json(cJSON_CreateObject());
     cJSON* root = json.get();
 
@@ -176,7 +176,13 @@ std::string TimingHistogram::to_string(void) {
 
     // for backwards compatibility, add the old wayouts
     cJSON_AddNumberToObject(root, "wayout", aggregate_wayout());
-    char *ptr = cJSON_PrintUnformatted(root);
+
+    return json;
+}
+
+std::string TimingHistogram::to_string(void) {
+    unique_cJSON_ptr json(to_json());
+    char *ptr = cJSON_PrintUnformatted(json.get());
     std::string ret(ptr);
     cJSON_Free(ptr);
 
@@ -185,34 +191,34 @@ std::string TimingHistogram::to_string(void) {
 
 /* get functions of Timings class */
 
-uint32_t TimingHistogram::get_ns() {
+uint64_t TimingHistogram::get_ns() {
     return ns;
 }
 
-uint32_t TimingHistogram::get_usec(const uint8_t index) {
+uint64_t TimingHistogram::get_usec(const uint8_t index) {
     return usec[index];
 }
 
-uint32_t TimingHistogram::get_msec(const uint8_t index) {
+uint64_t TimingHistogram::get_msec(const uint8_t index) {
     return msec[index];
 }
 
-uint32_t TimingHistogram::get_halfsec(const uint8_t index) {
+uint64_t TimingHistogram::get_halfsec(const uint8_t index) {
     return halfsec[index];
 }
 
-uint32_t TimingHistogram::get_wayout(const uint8_t index) {
+uint64_t TimingHistogram::get_wayout(const uint8_t index) {
     return wayout[index];
 }
 
-uint32_t TimingHistogram::aggregate_wayout() {
-    uint32_t ret = 0;
+uint64_t TimingHistogram::aggregate_wayout() {
+    uint64_t ret = 0;
     for (auto &wo : wayout) {
         ret += wo;
     }
     return ret;
 }
 
-uint32_t TimingHistogram::get_total() {
+uint64_t TimingHistogram::get_total() {
     return total;
 }
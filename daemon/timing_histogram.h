@@ -18,6 +18,7 @@
 
 #include <platform/platform.h>
 #include <array>
+#include <cJSON_utils.h>
 #include <relaxed_atomic.h>
 #include <string>
 
@@ -40,16 +41,17 @@ public:
     TimingHistogram& operator+=(const TimingHistogram& other);
 
     void reset(void);
-    void add(const hrtime_t nsec);
+    void add(const hrtime_t nsec, const uint64_t count = 1);
+    unique_cJSON_ptr to_json(void);
     std::string to_string(void);
-    uint32_t get_ns();
-    uint32_t get_usec(const uint8_t index);
-    uint32_t get_msec(const uint8_t index);
-    uint32_t get_halfsec(const uint8_t index);
-    uint32_t get_wayout(const uint8_t index);
-    uint32_t get_total();
+    uint64_t get_ns();
+    uint64_t get_usec(const uint8_t index);
+    uint64_t get_msec(const uint8_t index);
+    uint64_t get_halfsec(const uint8_t index);
+    uint64_t get_wayout(const uint8_t index);
+    uint64_t get_total();
 
-    uint32_t aggregate_wayout();
+    uint64_t aggregate_wayout();
 
 private:
     // This helper is used for operator overloads. It is supplied a
@@ -60,14 +62,14 @@ private:
     static void arith_op(TimingHistogram& dst, const TimingHistogram& src);
 
     /* We collect timings for <=1 us */
-    Couchbase::RelaxedAtomic<uint32_t> ns;
+    Couchbase::RelaxedAtomic<uint64_t> ns;
     /* We collect timings per 10usec */
-    std::array<Couchbase::RelaxedAtomic<uint32_t>, 100> usec;
+    std::array<Couchbase::RelaxedAtomic<uint64_t>, 100> usec;
     /* we collect timings from 0-49 ms (entry 0 is never used!) */
-    std::array<Couchbase::RelaxedAtomic<uint32_t>, 50> msec;
-    std::array<Couchbase::RelaxedAtomic<uint32_t>, 10> halfsec;
+    std::array<Couchbase::RelaxedAtomic<uint64_t>, 50> msec;
+    std::array<Couchbase::RelaxedAtomic<uint64_t>, 10> halfsec;
     // wayout use the following buckets:
     // [5-9], [10-19], [20-39], [40-79], [80-inf].
-    std::array<Couchbase::RelaxedAtomic<uint32_t>, 5> wayout;
+    std::array<Couchbase::RelaxedAtomic<uint64_t>, 5> wayout;
     Couchbase::RelaxedAtomic<uint64_t> total;
 };
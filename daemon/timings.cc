@@ -17,22 +17,70 @@
 #include "timings.h"
 #include <memcached/protocol_binary.h>
 #include <platform/platform.h>
+#include <cJSON.h>
+#include <cJSON_utils.h>
 #include "timing_histogram.h"
 
+Timings::ThreadTimings::ThreadTimings() {
+    for (auto& histogram : histograms) {
+        histogram.store(nullptr);
+    }
+}
+
+Timings::ThreadTimings::~ThreadTimings() {
+    for (auto& histogram : histograms) {
+        delete histogram.load();
+    }
+}
+
+LogLinearHistogram& Timings::ThreadTimings::get(uint8_t opcode) {
+    auto* histogram = histograms[opcode].load(std::memory_order_acquire);
+    if (histogram == nullptr) {
+        std::unique_ptr<LogLinearHistogram> created(new LogLinearHistogram);
+        if (histograms[opcode].compare_exchange_strong(histogram,
+                                                       created.get())) {
+            histogram = created.release();
+        }
+    }
+    return *histogram;
+}
+
 Timings::Timings() {
     reset();
 }
 
 Timings& Timings::operator=(const Timings& other) {
-    timings = other.timings;
+    if (timings.size() < other.timings.size()) {
+        initialize(other.timings.size());
+    }
+    for (size_t thread = 0; thread < other.timings.size(); ++thread) {
+        auto& src = other.timings[thread]->histograms;
+        for (int opcode = 0; opcode < MAX_NUM_OPCODES; ++opcode) {
+            auto* histogram = src[opcode].load(std::memory_order_acquire);
+            if (histogram != nullptr) {
+                timings[thread]->get(uint8_t(opcode)).copy(*histogram);
+            }
+        }
+    }
     interval_latency_lookups = other.interval_latency_lookups;
     interval_latency_mutations = other.interval_latency_mutations;
     return *this;
 }
 
+void Timings::initialize(size_t num_threads) {
+    while (timings.size() < num_threads) {
+        timings.emplace_back(new ThreadTimings);
+    }
+}
+
 void Timings::reset(void) {
-    for (int ii = 0; ii < MAX_NUM_OPCODES; ++ii) {
-        timings[ii].reset();
+    for (auto& thread : timings) {
+        for (auto& histogram : thread->histograms) {
+            auto* ptr = histogram.load(std::memory_order_acquire);
+            if (ptr != nullptr) {
+                ptr->reset();
+            }
+        }
     }
 
     {
@@ -42,15 +90,72 @@ void Timings::reset(void) {
     }
 }
 
-void Timings::collect(const uint8_t opcode, const hrtime_t nsec) {
-    timings[opcode].add(nsec);
+void Timings::collect(const uint8_t opcode, const hrtime_t nsec,
+                      size_t thread) {
+    cb_assert(thread < timings.size());
+    timings[thread]->get(opcode).add(nsec);
     auto& interval = interval_counters[opcode];
     interval.count++;
     interval.duration_ns += nsec;
 }
 
+/**
+ * The percentiles reported (in nanoseconds) along with the histogram.
+ */
+static const std::pair<const char*, double> timings_percentiles[] = {
+    {"50", 50.0},
+    {"99", 99.0},
+    {"99.9", 99.9},
+    {"99.99", 99.99}};
+
 std::string Timings::generate(const uint8_t opcode) {
-    return timings[opcode].to_string();
+    LogLinearHistogram::Counts counts(LogLinearHistogram::NumBuckets);
+    for (auto& thread : timings) {
+        auto* histogram =
+                thread->histograms[opcode].load(std::memory_order_acquire);
+        if (histogram != nullptr) {
+            histogram->aggregate(counts);
+        }
+    }
+
+    // Existing clients expect the fixed buckets of TimingHistogram. Each
+    // log-linear bucket is put in the fixed bucket holding its lower
+    // bound; they're far finer than the fixed ones so the error is small.
+    TimingHistogram histogram;
+    for (size_t ii = 0; ii < counts.size(); ++ii) {
+        if (counts[ii] != 0) {
+            histogram.add(LogLinearHistogram::getBucketLowerBound(ii),
+                          counts[ii]);
+        }
+    }
+
+    unique_cJSON_ptr json(histogram.to_json());
+    cJSON* percentiles = cJSON_CreateObject();
+    for (const auto& percentile : timings_percentiles) {
+        cJSON_AddNumberToObject(
+                percentiles,
+                percentile.first,
+                double(LogLinearHistogram::getPercentile(counts,
+                                                         percentile.second)));
+    }
+    cJSON_AddItemToObject(json.get(), "percentiles", percentiles);
+
+    char* ptr = cJSON_PrintUnformatted(json.get());
+    std::string ret(ptr);
+    cJSON_Free(ptr);
+    return ret;
+}
+
+uint64_t Timings::get_total(const uint8_t opcode) {
+    uint64_t ret = 0;
+    for (auto& thread : timings) {
+        auto* histogram =
+                thread->histograms[opcode].load(std::memory_order_acquire);
+        if (histogram != nullptr) {
+            ret += histogram->getTotal();
+        }
+    }
+    return ret;
 }
 
 static const uint8_t timings_mutations[] = {
@@ -104,7 +209,7 @@ uint64_t Timings::get_aggregated_mutation_stats() {
 
     uint64_t ret = 0;
     for (auto cmd : timings_mutations) {
-        ret += timings[cmd].get_total();
+        ret += get_total(cmd);
     }
     return ret;
 }
@@ -113,7 +218,7 @@ uint64_t Timings::get_aggregated_retrival_stats() {
 
     uint64_t ret = 0;
     for (auto cmd : timings_retrievals) {
-        ret += timings[cmd].get_total();
+        ret += get_total(cmd);
     }
     return ret;
 }
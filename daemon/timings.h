@@ -18,10 +18,14 @@
 
 #include <platform/platform.h>
 #include <array>
+#include <atomic>
 #include <string>
+#include <memory>
 #include <mutex>
 #include <cstdint>
+#include <vector>
 
+#include "log_linear_histogram.h"
 #include "timing_histogram.h"
 #include "timing_interval.h"
 
@@ -29,6 +33,11 @@
 
 /** Records timings for each memcached opcode. Each opcode has a histogram of
  * times.
+ *
+ * Every worker thread records into its own set of histograms (allocated the
+ * first time the thread sees a given opcode), so collecting a timing never
+ * writes to memory shared with another thread. The histograms for an opcode
+ * are only summed when they're read.
  */
 class Timings {
 public:
@@ -36,8 +45,27 @@ public:
     Timings& operator=(const Timings& other);
     Timings(const Timings&) = delete;
 
+    /**
+     * Set the number of threads which may collect timings. Must be called
+     * before any timings are collected.
+     */
+    void initialize(size_t num_threads);
+
+    /**
+     * Reset all of the timings. May be called while other threads collect
+     * timings; each thread drops its old counts the next time it collects
+     * one (see LogLinearHistogram::reset()).
+     */
     void reset(void);
-    void collect(const uint8_t opcode, const hrtime_t nsec);
+
+    /**
+     * Record the time taken by a command.
+     *
+     * @param thread the index of the calling thread (less than the number
+     *               of threads passed to initialize()). Only that thread
+     *               may collect timings with this index.
+     */
+    void collect(const uint8_t opcode, const hrtime_t nsec, size_t thread);
     void sample(std::chrono::seconds sample_interval);
     std::string generate(const uint8_t opcode);
     uint64_t get_aggregated_mutation_stats();
@@ -47,6 +75,20 @@ public:
     cb::sampling::Interval get_interval_lookup_latency();
 
 private:
+    /// The histograms owned by one thread, indexed by opcode.
+    struct ThreadTimings {
+        ThreadTimings();
+        ~ThreadTimings();
+
+        LogLinearHistogram& get(uint8_t opcode);
+
+        std::array<std::atomic<LogLinearHistogram*>, MAX_NUM_OPCODES>
+                histograms;
+    };
+
+    /// @return the number of times the opcode has been collected
+    uint64_t get_total(const uint8_t opcode);
+
     // This lock is only held by sample() and some blocks within generate().
     // It guards the various IntervalSeries variables which internally
     // contain cb::RingBuffer objects which are not thread safe.
@@ -54,6 +96,6 @@ private:
 
     cb::sampling::IntervalSeries interval_latency_lookups;
     cb::sampling::IntervalSeries interval_latency_mutations;
-    std::array<TimingHistogram, MAX_NUM_OPCODES> timings;
+    std::vector<std::unique_ptr<ThreadTimings>> timings;
     std::array<cb::sampling::Interval, MAX_NUM_OPCODES> interval_counters;
 };
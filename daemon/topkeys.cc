@@ -19,6 +19,8 @@
 
 #include <algorithm>
 #include <cstring>
+#include <limits>
+#include <unordered_map>
 #include <sys/types.h>
 #include <stdlib.h>
 #include <inttypes.h>
@@ -31,162 +33,420 @@
  *
  * === TopKeys ===
  *
- * The TopKeys class is split into NUM_SHARDS shards, each which owns
- * 1/NUM_SHARDS of the keyspace. This is to allow some level of
- * concurrent access - each shard has a mutex guarding all access.
- * Other than that the TopKeys class is pretty uninteresting - it
- * simply passes on requests to the correct Shard, and when statistics
- * are requested it aggregates information from each shard.
+ * Each worker thread records the keys it sees in its own Summary, so
+ * updateKey() never takes a lock or touches memory written by another
+ * thread. When statistics are requested the summaries of all threads are
+ * read and merged (the counts of a key tracked by several threads are
+ * summed), and the most frequently accessed keys reported.
  *
- * === TopKeys::Shard ===
+ * === TopKeys::Summary ===
  *
- * This is where the action happens. Each Shard maintains an ordered
- * list of key names and related statistics, orded by when they were
- * last accessed. There is a fixed number of keys each Shard tracks.
-
- * Given we generally track only a small number of keys per shard (10
- * by default), it's highly likely that any one key access will 'miss'
- * - i.e. not find an existing topkey. Therefore this class is
- * optimized for that case, attempting to minimise memory allocation
- * in steady-state.
- *
- * Internally Shard consists of a vector of topkey_t, storing the
- * current max_keys top_keys, and a list of topkey_t pointers, used to
- * main the current most -> least recently used ordering:
-
- * max_keys elements. Each element is a tuple of
- * {hash(key), key, topkey_stats}:
- *
- *
- *       vector<topkey_t>
- *   +----------+-------------+---------------+
- *   | size_t   | std::string | topkey_item_t |
- *   +----------+-------------+---------------+
- *   | <hash 1> | <key 1>     | stats 1       | <--- Node1
- *   | <hash 2> | <key 2>     | stats 2       | <--- Node2
- *   | <hash 3> | <key 3>     | stats 3       | <--- Node3
- *   . ....                                   .
- *   | <hash N> | <key N>     | stats N       | <--- NodeN
- *   +----------------------------------------+
- *
- *   Node3 <---> Node1 <---> ... <---> Node2
- *   ^^^                               ^^^
- *   MRU                               LRU
+ * A Space-Saving summary (Metwally et al.) of the keys accessed by one
+ * thread: a fixed number of counters, each tracking one key. When a key
+ * which isn't tracked is accessed, the counter with the lowest count is
+ * taken over by it; the new key inherits that count (plus one) and the
+ * previous count is recorded as the new key's error. Any key accessed more
+ * than N / capacity times (of N accesses) is guaranteed to be tracked, and
+ * a tracked key's count over-estimates its true count by at most its
+ * error (itself at most N / capacity).
  *
+ * So that the summary follows the keys which are hot now rather than those
+ * which were hot at some point since the bucket was created, all of the
+ * counts (and errors) are halved every COUNT_HALF_LIFE seconds. Halving
+ * preserves the order of the counts, so the heap (below) stays valid.
  *
- * Upon a key 'hit', TopKeys::updateKey() is called. That hashes the
- * key, and finds the Shard responsible for that
- * key. TopKeys::Shard::updateKey() is then called.
+ * Each counter's slot is written only by the owning thread. A slot's
+ * count is updated with a plain (atomic) store; when the slot is taken
+ * over by another key its version is made odd while the key is replaced
+ * (a per-slot seqlock), so readers can detect (and retry, or give up on)
+ * a slot modified while being read. All of the slot's fields are atomics,
+ * hence readers never see a torn value.
  *
- * Shard::updateKey() iterates over the vector, searching for a hash
- * match with an existing element, using the actual key string to
- * validate (in case of a hash collision). If it is found, then the
- * stats are simply updated.  If it is not found, then the
- * least-recently-used element is selected as a 'victim' and it's
- * contents is replaced by the incoming key.  Finally the linked-list
- * is updated to move the updated element to the head of the list.
+ * The owning thread also keeps a private copy of each slot's key hash and
+ * count, a hash index of the slots and a min-heap of them ordered by
+ * count, so both finding a key and finding the lowest count are cheap and
+ * (besides comparing keys) don't need to read the shared slots.
  */
 
+class TopKeys::Summary {
+public:
+    Summary(size_t capacity, rel_time_t now);
+
+    // Record an access to the key. Must only be called by the owner.
+    void update(const cb::const_char_buffer& key,
+                size_t key_hash,
+                rel_time_t ct);
+
+    // Append the keys tracked to {entries}. May be called by any thread.
+    void read(std::vector<Entry>& entries) const;
+
+private:
+    static const size_t KEY_WORDS = (MAX_KEY_LENGTH + 7) / 8;
+    static const uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+
+    struct Slot {
+        // Odd while the key is being replaced.
+        std::atomic<uint32_t> version;
+        std::atomic<uint32_t> count;
+        std::atomic<uint32_t> error;
+        std::atomic<rel_time_t> ctime;
+        std::atomic<rel_time_t> atime;
+        std::atomic<uint8_t> nkey;
+        std::array<std::atomic<uint64_t>, KEY_WORDS> key;
+    };
+
+    static size_t keyWords(size_t nkey) {
+        return (nkey + 7) / 8;
+    }
+
+    bool slotHasKey(uint32_t idx,
+                    const cb::const_char_buffer& key,
+                    const std::array<uint64_t, KEY_WORDS>& words) const;
+
+    // Find the slot tracking the key; EMPTY if none is.
+    uint32_t findSlot(const cb::const_char_buffer& key,
+                      size_t key_hash,
+                      const std::array<uint64_t, KEY_WORDS>& words) const;
+
+    void indexInsert(uint32_t idx);
+    void indexRemove(uint32_t idx);
+
+    // Restore the heap order after counts[heap[pos]] increased.
+    void heapSiftDown(size_t pos);
+    // Restore the heap order after adding heap[pos].
+    void heapSiftUp(size_t pos);
+
+    // Halve the counts once for every COUNT_HALF_LIFE elapsed since the
+    // last time they were.
+    void decay(rel_time_t now);
+
+    std::unique_ptr<Slot[]> slots;
+    const size_t capacity;
+
+    // Owner-private state. For each slot used: the hash of its key and its
+    // count. {index} is an open-addressing (linear probing) hash table of
+    // slot numbers, keyed by hash; {heap} is a min-heap of slot numbers
+    // ordered by count (with {heapPos} the position of each slot in it), to
+    // find the slot to take over.
+    std::vector<size_t> hashes;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> index;
+    std::vector<uint32_t> heap;
+    std::vector<uint32_t> heapPos;
+    // When the counts were last halved.
+    rel_time_t lastDecay;
+};
+
+const uint32_t TopKeys::Summary::EMPTY;
+const rel_time_t TopKeys::COUNT_HALF_LIFE;
 
-TopKeys::TopKeys(int mkeys) {
-    for (auto& shard : shards) {
-        shard.setMaxKeys(mkeys);
+TopKeys::Summary::Summary(size_t capacity, rel_time_t now)
+    : slots(new Slot[capacity]), capacity(capacity), lastDecay(now) {
+    for (size_t ii = 0; ii < capacity; ++ii) {
+        slots[ii].version.store(0, std::memory_order_relaxed);
+        slots[ii].count.store(0, std::memory_order_relaxed);
     }
+    hashes.reserve(capacity);
+    counts.reserve(capacity);
+    heap.reserve(capacity);
+    heapPos.reserve(capacity);
+    size_t indexSize = 1;
+    while (indexSize < capacity * 2) {
+        indexSize <<= 1;
+    }
+    index.assign(indexSize, EMPTY);
 }
 
-TopKeys::~TopKeys() {
+bool TopKeys::Summary::slotHasKey(
+        uint32_t idx,
+        const cb::const_char_buffer& key,
+        const std::array<uint64_t, KEY_WORDS>& words) const {
+    const Slot& slot = slots[idx];
+    if (slot.nkey.load(std::memory_order_relaxed) != key.len) {
+        return false;
+    }
+    for (size_t ii = 0; ii < keyWords(key.len); ++ii) {
+        if (slot.key[ii].load(std::memory_order_relaxed) != words[ii]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t TopKeys::Summary::findSlot(
+        const cb::const_char_buffer& key,
+        size_t key_hash,
+        const std::array<uint64_t, KEY_WORDS>& words) const {
+    const size_t mask = index.size() - 1;
+    for (size_t pos = key_hash & mask; index[pos] != EMPTY;
+         pos = (pos + 1) & mask) {
+        const uint32_t idx = index[pos];
+        if (hashes[idx] == key_hash && slotHasKey(idx, key, words)) {
+            return idx;
+        }
+    }
+    return EMPTY;
 }
 
-TopKeys::Shard& TopKeys::getShard(size_t key_hash) {
-    /* This is special-cased for 8 */
-    static_assert(NUM_SHARDS == 8,
-                  "Topkeys::getShard() special-cased for SHARDS==8");
-    return shards[key_hash & 0x7];
+void TopKeys::Summary::indexInsert(uint32_t idx) {
+    const size_t mask = index.size() - 1;
+    size_t pos = hashes[idx] & mask;
+    while (index[pos] != EMPTY) {
+        pos = (pos + 1) & mask;
+    }
+    index[pos] = idx;
 }
 
-TopKeys::Shard::topkey_t*
-TopKeys::Shard::searchForKey(size_t key_hash,
-                             const cb::const_char_buffer& key) {
-
-    for (auto& topkey : storage) {
-        if (topkey.first.hash == key_hash) {
-            // Double-check with full compare
-            if (topkey.first.key.compare(0, topkey.first.key.size(),
-                                         key.buf, key.len) == 0) {
-                // Match found.
-                return &topkey;
+void TopKeys::Summary::indexRemove(uint32_t idx) {
+    const size_t mask = index.size() - 1;
+    size_t pos = hashes[idx] & mask;
+    while (index[pos] != idx) {
+        pos = (pos + 1) & mask;
+    }
+    // Backward-shift deletion: move up any following entries which would
+    // otherwise no longer be reachable from their home position.
+    size_t next = (pos + 1) & mask;
+    while (index[next] != EMPTY) {
+        const size_t home = hashes[index[next]] & mask;
+        if (((next - home) & mask) >= ((next - pos) & mask)) {
+            index[pos] = index[next];
+            pos = next;
+        }
+        next = (next + 1) & mask;
+    }
+    index[pos] = EMPTY;
+}
+
+void TopKeys::Summary::heapSiftDown(size_t pos) {
+    const size_t size = heap.size();
+    while (true) {
+        size_t smallest = pos;
+        for (size_t child = 2 * pos + 1; child <= 2 * pos + 2; ++child) {
+            if (child < size && counts[heap[child]] < counts[heap[smallest]]) {
+                smallest = child;
             }
         }
+        if (smallest == pos) {
+            return;
+        }
+        std::swap(heap[pos], heap[smallest]);
+        heapPos[heap[pos]] = uint32_t(pos);
+        heapPos[heap[smallest]] = uint32_t(smallest);
+        pos = smallest;
     }
-    return nullptr;
 }
 
-bool TopKeys::Shard::updateKey(const cb::const_char_buffer& key,
-                               size_t key_hash,
-                               const rel_time_t ct) {
-    try {
-        std::lock_guard<std::mutex> lock(mutex);
-
-        topkey_t* found_key = searchForKey(key_hash, key);
-
-        if (found_key == NULL) {
-            // Key not found.
-            if (storage.size() == max_keys) {
-                // Re-use the lowest keys' storage.
-                found_key = list.back();
-                found_key->first.hash = key_hash;
-                found_key->first.key.assign(key.buf, key.len);
-                found_key->second = topkey_item_t(ct);
-
-                // Move back element to the front, shuffling down the
-                // rest.
-                list.splice(list.begin(), list, --list.end());
-
-            } else {
-                // add a new element to the storage array.
-
-                storage.emplace_back(
-                    std::make_pair(KeyId{key_hash,
-                                         std::string(key.buf, key.len)},
-                                   topkey_item_t(ct)));
-                found_key = &storage.back();
-
-                // Insert the new item to the front of the list
-                list.push_front(found_key);
+void TopKeys::Summary::heapSiftUp(size_t pos) {
+    while (pos > 0) {
+        const size_t parent = (pos - 1) / 2;
+        if (counts[heap[parent]] <= counts[heap[pos]]) {
+            return;
+        }
+        std::swap(heap[pos], heap[parent]);
+        heapPos[heap[pos]] = uint32_t(pos);
+        heapPos[heap[parent]] = uint32_t(parent);
+        pos = parent;
+    }
+}
+
+void TopKeys::Summary::decay(rel_time_t now) {
+    if (now <= lastDecay || now - lastDecay < COUNT_HALF_LIFE) {
+        return;
+    }
+    const rel_time_t periods = (now - lastDecay) / COUNT_HALF_LIFE;
+    lastDecay += periods * COUNT_HALF_LIFE;
+    const int shift = int(std::min(periods, rel_time_t(32)));
+
+    for (uint32_t idx = 0; idx < counts.size(); ++idx) {
+        counts[idx] = shift < 32 ? counts[idx] >> shift : 0;
+        Slot& slot = slots[idx];
+        const uint32_t error = slot.error.load(std::memory_order_relaxed);
+        const uint32_t version = slot.version.load(std::memory_order_relaxed);
+        slot.version.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.count.store(counts[idx], std::memory_order_relaxed);
+        slot.error.store(shift < 32 ? error >> shift : 0,
+                         std::memory_order_relaxed);
+        slot.version.store(version + 2, std::memory_order_release);
+    }
+}
+
+void TopKeys::Summary::update(const cb::const_char_buffer& key,
+                              size_t key_hash,
+                              const rel_time_t ct) {
+    decay(ct);
+
+    std::array<uint64_t, KEY_WORDS> words;
+    std::memset(words.data(), 0, keyWords(key.len) * sizeof(uint64_t));
+    std::memcpy(words.data(), key.buf, key.len);
+
+    uint32_t idx = findSlot(key, key_hash, words);
+    if (idx != EMPTY) {
+        // Tracked - just count it.
+        if (counts[idx] != std::numeric_limits<uint32_t>::max()) {
+            ++counts[idx];
+            heapSiftDown(heapPos[idx]);
+        }
+        slots[idx].count.store(counts[idx], std::memory_order_relaxed);
+        slots[idx].atime.store(ct, std::memory_order_relaxed);
+        return;
+    }
+
+    uint32_t error;
+    if (counts.size() < capacity) {
+        idx = uint32_t(counts.size());
+        hashes.push_back(key_hash);
+        counts.push_back(1);
+        heap.push_back(idx);
+        heapPos.push_back(uint32_t(heap.size() - 1));
+        heapSiftUp(heap.size() - 1);
+        error = 0;
+    } else {
+        // Take over the counter with the lowest count.
+        idx = heap.front();
+        indexRemove(idx);
+        hashes[idx] = key_hash;
+        error = counts[idx];
+        if (counts[idx] != std::numeric_limits<uint32_t>::max()) {
+            ++counts[idx];
+            heapSiftDown(0);
+        }
+    }
+    indexInsert(idx);
+
+    Slot& slot = slots[idx];
+    const uint32_t version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.nkey.store(uint8_t(key.len), std::memory_order_relaxed);
+    for (size_t ii = 0; ii < keyWords(key.len); ++ii) {
+        slot.key[ii].store(words[ii], std::memory_order_relaxed);
+    }
+    slot.error.store(error, std::memory_order_relaxed);
+    slot.ctime.store(ct, std::memory_order_relaxed);
+    slot.atime.store(ct, std::memory_order_relaxed);
+    slot.count.store(counts[idx], std::memory_order_relaxed);
+    slot.version.store(version + 2, std::memory_order_release);
+}
+
+void TopKeys::Summary::read(std::vector<Entry>& entries) const {
+    // A slot which keeps changing under us is the one holding the lowest
+    // count (the least interesting key) - don't spin on it forever.
+    static const int MAX_ATTEMPTS = 100;
+
+    for (size_t idx = 0; idx < capacity; ++idx) {
+        const Slot& slot = slots[idx];
+        for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+            const uint32_t version =
+                    slot.version.load(std::memory_order_acquire);
+            if (version & 1) {
+                continue;
             }
-        } else {
-            // Found - shuffle to the front.
-            auto it = std::find(list.begin(), list.end(),
-                                found_key);
-            list.splice(list.begin(), list, it);
+            Entry entry;
+            entry.count = slot.count.load(std::memory_order_relaxed);
+            entry.error = slot.error.load(std::memory_order_relaxed);
+            entry.ctime = slot.ctime.load(std::memory_order_relaxed);
+            entry.atime = slot.atime.load(std::memory_order_relaxed);
+            const size_t nkey = std::min(
+                    size_t(slot.nkey.load(std::memory_order_relaxed)),
+                    size_t(MAX_KEY_LENGTH));
+            std::array<uint64_t, KEY_WORDS> words;
+            for (size_t ii = 0; ii < keyWords(nkey); ++ii) {
+                words[ii] = slot.key[ii].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.version.load(std::memory_order_relaxed) != version) {
+                continue;
+            }
+            if (entry.count != 0) {
+                entry.key.assign(reinterpret_cast<const char*>(words.data()),
+                                 nkey);
+                entries.push_back(std::move(entry));
+            }
+            break;
         }
+    }
+}
 
-        // Increment access count.
-        found_key->second.ti_access_count++;
-        return true;
+TopKeys::TopKeys(int mkeys, int nthreads)
+    : capacity(size_t(std::max(mkeys, 1)) * KEYS_MULTIPLIER),
+      nthreads(nthreads),
+      summaries(new std::atomic<Summary*>[nthreads]) {
+    for (int ii = 0; ii < nthreads; ++ii) {
+        summaries[ii].store(nullptr, std::memory_order_relaxed);
+    }
+}
 
-    } catch (const std::bad_alloc&) {
-        // Failed to update.
-        return false;
+TopKeys::~TopKeys() {
+    for (int ii = 0; ii < nthreads; ++ii) {
+        delete summaries[ii].load();
     }
 }
 
 void TopKeys::updateKey(const void *key, size_t nkey,
-                        rel_time_t operation_time) {
+                        rel_time_t operation_time, int thread) {
     cb_assert(key);
     cb_assert(nkey > 0);
 
+    if (thread < 0 || thread >= nthreads || nkey > MAX_KEY_LENGTH) {
+        return;
+    }
+
     try {
+        Summary* summary =
+                summaries[thread].load(std::memory_order_acquire);
+        if (summary == nullptr) {
+            summary = new Summary(capacity, operation_time);
+            summaries[thread].store(summary, std::memory_order_release);
+        }
+
         cb::const_char_buffer key_buf(static_cast<const char*>(key), nkey);
         std::hash<cb::const_char_buffer > hash_fn;
         const size_t key_hash = hash_fn(key_buf);
 
-        getShard(key_hash).updateKey(key_buf, key_hash, operation_time);
-    } catch (std::bad_alloc) {
+        summary->update(key_buf, key_hash, operation_time);
+    } catch (const std::bad_alloc&) {
         // Failed to increment topkeys, continue...
     }
 }
 
+std::vector<TopKeys::Entry> TopKeys::getTopKeys() const {
+    std::vector<Entry> entries;
+    for (int ii = 0; ii < nthreads; ++ii) {
+        const Summary* summary =
+                summaries[ii].load(std::memory_order_acquire);
+        if (summary != nullptr) {
+            summary->read(entries);
+        }
+    }
+
+    // Merge the entries for keys tracked by more than one thread.
+    std::unordered_map<std::string, size_t> index;
+    std::vector<Entry> merged;
+    for (auto& entry : entries) {
+        auto result = index.emplace(entry.key, merged.size());
+        if (result.second) {
+            merged.push_back(std::move(entry));
+        } else {
+            Entry& existing = merged[result.first->second];
+            existing.count += entry.count;
+            existing.error += entry.error;
+            existing.ctime = std::min(existing.ctime, entry.ctime);
+            existing.atime = std::max(existing.atime, entry.atime);
+        }
+    }
+
+    const size_t n = std::min(capacity, merged.size());
+    std::partial_sort(merged.begin(),
+                      merged.begin() + n,
+                      merged.end(),
+                      [](const Entry& a, const Entry& b) {
+                          return a.count > b.count;
+                      });
+    merged.resize(n);
+    return merged;
+}
+
 struct tk_context {
     tk_context(const void *c, ADD_STAT a, rel_time_t t, cJSON *arr)
         : cookie(c), add_stat(a), current_time(t), array(arr)
@@ -200,25 +460,23 @@ struct tk_context {
     cJSON *array;
 };
 
-static void tk_iterfunc(const std::string& key, const topkey_item_t& it,
-                        void *arg) {
+static void tk_iterfunc(const TopKeys::Entry& it, void *arg) {
     struct tk_context *c = (struct tk_context*)arg;
     char val_str[500];
-    /* Note we use accessed time for both 'atime' and 'ctime' below. They have
-     * had the same value since the topkeys code was added; but given that
-     * clients may expect separate values we print both.
-     */
-    rel_time_t created_time = c->current_time - it.ti_ctime;
-    int vlen = snprintf(val_str, sizeof(val_str) - 1, "get_hits=%d,"
+    // Both are reported as the number of seconds ago: ctime is when the key
+    // started being tracked, atime when it was last accessed.
+    rel_time_t created_time = c->current_time - it.ctime;
+    rel_time_t access_time = c->current_time - it.atime;
+    int vlen = snprintf(val_str, sizeof(val_str) - 1, "get_hits=%" PRIu32 ","
                         "get_misses=0,cmd_set=0,incr_hits=0,incr_misses=0,"
                         "decr_hits=0,decr_misses=0,delete_hits=0,"
                         "delete_misses=0,evictions=0,cas_hits=0,cas_badval=0,"
                         "cas_misses=0,get_replica=0,evict=0,getl=0,unlock=0,"
                         "get_meta=0,set_meta=0,del_meta=0,ctime=%" PRIu32
-                        ",atime=%" PRIu32, it.ti_access_count,
-                        created_time, created_time);
+                        ",atime=%" PRIu32, it.count,
+                        created_time, access_time);
     if (vlen > 0 && vlen < int(sizeof(val_str) - 1)) {
-        c->add_stat(key.c_str(), key.size(), val_str, vlen, c->cookie);
+        c->add_stat(it.key.c_str(), it.key.size(), val_str, vlen, c->cookie);
     }
 }
 
@@ -232,15 +490,16 @@ static void tk_iterfunc(const std::string& key, const topkey_item_t& it,
  *    "atime": aaa
  * }
  */
-static void tk_jsonfunc(const std::string& key, const topkey_item_t& it,
-                        void* arg) {
+static void tk_jsonfunc(const TopKeys::Entry& it, void* arg) {
     struct tk_context *c = (struct tk_context*)arg;
     cJSON *obj = cJSON_CreateObject();
-    cJSON_AddItemToObject(obj, "key", cJSON_CreateString(key.c_str()));
+    cJSON_AddItemToObject(obj, "key", cJSON_CreateString(it.key.c_str()));
     cJSON_AddItemToObject(obj, "access_count",
-                          cJSON_CreateNumber(it.ti_access_count));
+                          cJSON_CreateNumber(it.count));
     cJSON_AddItemToObject(obj, "ctime", cJSON_CreateNumber(c->current_time
-                                                           - it.ti_ctime));
+                                                           - it.ctime));
+    cJSON_AddItemToObject(obj, "atime", cJSON_CreateNumber(c->current_time
+                                                           - it.atime));
     cb_assert(c->array != NULL);
     cJSON_AddItemToArray(c->array, obj);
 }
@@ -250,8 +509,8 @@ ENGINE_ERROR_CODE TopKeys::stats(const void *cookie,
                                  ADD_STAT add_stat) {
     struct tk_context context(cookie, add_stat, current_time, nullptr);
 
-    for (auto& shard : shards) {
-        shard.accept_visitor(tk_iterfunc, &context);
+    for (const auto& entry : getTopKeys()) {
+        tk_iterfunc(entry, &context);
     }
 
     return ENGINE_SUCCESS;
@@ -274,18 +533,10 @@ ENGINE_ERROR_CODE TopKeys::json_stats(cJSON *object,
     struct tk_context context(nullptr, nullptr, current_time, topkeys);
 
     /* Collate the topkeys JSON object */
-    for (auto& shard : shards) {
-        shard.accept_visitor(tk_jsonfunc, &context);
+    for (const auto& entry : getTopKeys()) {
+        tk_jsonfunc(entry, &context);
     }
 
     cJSON_AddItemToObject(object, "topkeys", topkeys);
     return ENGINE_SUCCESS;
 }
-
-void TopKeys::Shard::accept_visitor(iterfunc_t visitor_func,
-                                    void* visitor_ctx) {
-    std::lock_guard<std::mutex> lock(mutex);
-    for (const auto key : list) {
-        visitor_func(key->first.key, key->second, visitor_ctx);
-    }
-}
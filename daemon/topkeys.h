@@ -22,42 +22,43 @@
 #include <memcached/engine.h>
 #include <cJSON.h>
 
-#include <mutex>
-#include <list>
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
 /*
  * TopKeys
  *
- * Tracks the top N most recently accessed keys. The details are
- * accessible by a stats call, which is used by ns_server to print the
- * top keys list in the GUI.
+ * Tracks the most frequently accessed keys (the "heavy hitters") of a
+ * bucket. The details are accessible by a stats call, which is used by
+ * ns_server to print the top keys list in the GUI.
  */
 
-struct topkey_item_t {
-    topkey_item_t(rel_time_t create_time)
-        : ti_ctime(create_time),
-          ti_access_count(0) { }
-
-    rel_time_t ti_ctime; /* Time this item was created */
-    int ti_access_count; /* Int count for number of times key has been accessed */
-};
-
 /* Class to track the "top" keys in a bucket.
  */
 class TopKeys {
 public:
     /* Constructor.
-     * @param mkeys Number of keys stored in each shard (i.e. up to
-     * mkeys * SHARDS will be tracked).
+     * @param mkeys Scales the number of keys tracked (by each worker thread)
+     *              and reported: mkeys * KEYS_MULTIPLIER.
+     * @param nthreads Number of worker threads which will update the keys.
      */
-    TopKeys(int mkeys);
+    TopKeys(int mkeys, int nthreads);
     ~TopKeys();
 
+    /**
+     * Record an access to the given key.
+     *
+     * Lock-free; must only be called by the worker thread with the given
+     * index (each worker thread owns the summary it updates).
+     *
+     * @param thread the index of the calling worker thread
+     */
     void updateKey(const void *key,
                    size_t nkey,
-                   rel_time_t operation_time);
+                   rel_time_t operation_time,
+                   int thread);
 
     ENGINE_ERROR_CODE stats(const void *cookie,
                             const rel_time_t current_time,
@@ -80,81 +81,48 @@ public:
     ENGINE_ERROR_CODE json_stats(cJSON *object,
                                  const rel_time_t current_time);
 
+    // A key's statistics, as reported by the stats calls.
+    struct Entry {
+        std::string key;
+        // The (estimated, decayed - see COUNT_HALF_LIFE) number of times the
+        // key was accessed.
+        uint32_t count;
+        // The maximum amount by which count may over-estimate.
+        uint32_t error;
+        // Time the key started being tracked.
+        rel_time_t ctime;
+        // Time the key was last accessed.
+        rel_time_t atime;
+    };
 
-private:
-    // Number of shards the keyspace is broken into. Permits some level of
-    // concurrent update (there is one mutex per shard).
-    static const int NUM_SHARDS = 8;
-
-    class Shard;
-
-    Shard& getShard(size_t key_hash);
-
-    // One of N Shards which the keyspace has been broken
-    // into.
-    // Responsible for tracking the top {mkeys} within it's keyspace.
-    class Shard {
-    public:
-
-        void setMaxKeys(int mkeys) {
-            max_keys = mkeys;
-            storage.reserve(max_keys);
-            // reallocating storage invalidates the LRU list.
-            list.clear();
-        }
-
-        // Updates the topkey 'ranking' for the specified key.
-        // If the item does not exist it will be created (with it's creation
-        // time set to operation_time), otherwise the existing item will be
-        // updated.
-        // On success returns true, If insufficient memory to create a
-        // new item, returns false.
-        bool updateKey(const cb::const_char_buffer& key,
-                       size_t key_hash,
-                       rel_time_t operation_time);
-
-        typedef void (*iterfunc_t)(const std::string& key,
-                                   const topkey_item_t& it,
-                                   void *arg);
-
-        /* For each key in this shard, invoke the given callback function.
-         */
-        void accept_visitor(iterfunc_t visitor_func, void* visitor_ctx);
-
-    private:
-
-        struct KeyId {
-            size_t hash;
-            std::string key;
-        };
-
-        // Pair of the key's string and the statistics related to it.
-        typedef std::pair<KeyId, topkey_item_t> topkey_t;
-
-        // An ordered list of topkey_t*, used for LRU.
-        typedef std::list<topkey_t*> key_history_t;
+    /**
+     * Merge the summaries of all of the worker threads.
+     *
+     * @return the (up to) mkeys * KEYS_MULTIPLIER most frequently accessed
+     *         keys, most frequent first
+     */
+    std::vector<Entry> getTopKeys() const;
 
-        // Vector topket_t, used for actual topke storage.
-        typedef std::vector<topkey_t> key_storage_t;
+    // Each summary tracks (and the stats report) mkeys * KEYS_MULTIPLIER
+    // keys.
+    static const int KEYS_MULTIPLIER = 8;
 
-        // Searches for the given key. If found returns a pointer to the
-        // topkey_t, else returns NULL.
-        topkey_t* searchForKey(size_t hash, const cb::const_char_buffer& key);
+    // The counts (which hence estimate the recent rather than the total
+    // number of accesses) are halved every COUNT_HALF_LIFE seconds.
+    static const rel_time_t COUNT_HALF_LIFE = 60;
 
-        // Maxumum numbers of keys to be tracked per shard.
-        unsigned int max_keys;
+private:
+    class Summary;
 
-        // mutex to serial access to this shard.
-        std::mutex mutex;
+    // The longest key tracked (KEY_MAX_LENGTH).
+    static const size_t MAX_KEY_LENGTH = 250;
 
-        // list of keys, ordered from most-recently used (front) to least recently
-        // used (back).
-        key_history_t list;
+    // The number of keys tracked by each summary, and reported.
+    const size_t capacity;
 
-        // Underlying topkey storage.
-        key_storage_t storage;
-    };
+    const int nthreads;
 
-    // array of topkey shards.
-    std::array<Shard, NUM_SHARDS> shards;
+    // One Space-Saving summary per worker thread; allocated by the
+    // owning thread on its first update.
+    std::unique_ptr<std::atomic<Summary*>[]> summaries;
 };
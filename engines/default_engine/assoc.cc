@@ -16,6 +16,8 @@
 
 #include "default_engine_internal.h"
 
+#include <new>
+
 #define hashsize(n) ((size_t)1<<(n))
 #define hashmask(n) (hashsize(n)-1)
 
@@ -24,18 +26,21 @@ static struct assoc* global_assoc = NULL;
 
 /* assoc factory. returns one new assoc or NULL if out-of-memory */
 static struct assoc* assoc_consruct(int hashpower) {
-    struct assoc* new_assoc = NULL;
-    new_assoc = static_cast<struct assoc*>(cb_calloc(1, sizeof(struct assoc)));
+    struct assoc* new_assoc = new (std::nothrow) struct assoc;
     if (new_assoc) {
         new_assoc->hashpower = hashpower;
-        cb_mutex_initialize(&new_assoc->lock);
+        new_assoc->old_hashtable = NULL;
+        new_assoc->hash_items = 0;
+        new_assoc->expanding = false;
+        new_assoc->expand_bucket = 0;
+        new_assoc->maintenance_running = false;
         new_assoc->primary_hashtable =
             static_cast<hash_item**>(cb_calloc(hashsize(hashpower),
                                                sizeof(hash_item*)));
 
         if (new_assoc->primary_hashtable == NULL) {
             /* rollback and return NULL */
-            cb_free(new_assoc);
+            delete new_assoc;
             new_assoc = NULL;
         }
     }
@@ -49,6 +54,9 @@ ENGINE_ERROR_CODE assoc_init(struct default_engine *engine) {
         For flexibility, the assoc code accesses the assoc via the engine handle.
     */
     if (global_assoc == NULL) {
+        static_assert(16 > ITEM_LOCK_POWER,
+                      "the initial hash table must have at least two buckets "
+                      "per item lock");
         global_assoc = assoc_consruct(16);
     }
     engine->assoc = global_assoc;
@@ -57,28 +65,49 @@ ENGINE_ERROR_CODE assoc_init(struct default_engine *engine) {
 
 void assoc_destroy() {
     if (global_assoc != NULL) {
-        while (global_assoc->expanding) {
+        while (global_assoc->maintenance_running) {
             usleep(250);
         }
         cb_free(global_assoc->primary_hashtable);
-        cb_free(global_assoc);
+        delete global_assoc;
         global_assoc = NULL;
     }
 }
 
-hash_item *assoc_find(struct default_engine *engine, uint32_t hash, const hash_key *key) {
-    hash_item *it;
+std::mutex& assoc_get_item_lock(struct default_engine *engine, uint32_t hash) {
+    return engine->assoc->item_locks[hash & hashmask(ITEM_LOCK_POWER)];
+}
+
+static void assoc_lock_all(struct assoc *assoc) {
+    for (auto& lock : assoc->item_locks) {
+        lock.lock();
+    }
+}
+
+static void assoc_unlock_all(struct assoc *assoc) {
+    for (auto& lock : assoc->item_locks) {
+        lock.unlock();
+    }
+}
+
+/*
+    returns the head of the hash chain the given hash lives in.
+    The item lock for the hash is assumed to be held by the caller.
+*/
+static hash_item** assoc_bucket(struct default_engine *engine, uint32_t hash) {
     unsigned int oldbucket;
-    hash_item *ret = NULL;
-    int depth = 0;
-    cb_mutex_enter(&engine->assoc->lock);
     if (engine->assoc->expanding &&
         (oldbucket = (hash & hashmask(engine->assoc->hashpower - 1))) >= engine->assoc->expand_bucket)
     {
-        it = engine->assoc->old_hashtable[oldbucket];
-    } else {
-        it = engine->assoc->primary_hashtable[hash & hashmask(engine->assoc->hashpower)];
+        return &engine->assoc->old_hashtable[oldbucket];
     }
+    return &engine->assoc->primary_hashtable[hash & hashmask(engine->assoc->hashpower)];
+}
+
+hash_item *assoc_find(struct default_engine *engine, uint32_t hash, const hash_key *key) {
+    hash_item *it = *assoc_bucket(engine, hash);
+    hash_item *ret = NULL;
+    int depth = 0;
 
     while (it) {
         const hash_key* it_key = item_get_key(it);
@@ -93,28 +122,18 @@ hash_item *assoc_find(struct default_engine *engine, uint32_t hash, const hash_k
         ++depth;
     }
     MEMCACHED_ASSOC_FIND(hash_key_get_key(key), hash_key_get_key_len(key), depth);
-    cb_mutex_exit(&engine->assoc->lock);
     return ret;
 }
 
 /*
     returns the address of the item pointer before the key.  if *item == 0,
     the item wasn't found
-    assoc->lock is assumed to be held by the caller.
+    The item lock for the hash is assumed to be held by the caller.
 */
 static hash_item** _hashitem_before(struct default_engine *engine,
                                     uint32_t hash,
                                     const hash_key* key) {
-    hash_item **pos;
-    unsigned int oldbucket;
-
-    if (engine->assoc->expanding &&
-        (oldbucket = (hash & hashmask(engine->assoc->hashpower - 1))) >= engine->assoc->expand_bucket)
-    {
-        pos = &engine->assoc->old_hashtable[oldbucket];
-    } else {
-        pos = &engine->assoc->primary_hashtable[hash & hashmask(engine->assoc->hashpower)];
-    }
+    hash_item **pos = assoc_bucket(engine, hash);
 
     while (*pos) {
         const hash_key* pos_key = item_get_key(*pos);
@@ -134,71 +153,48 @@ static hash_item** _hashitem_before(struct default_engine *engine,
 static void assoc_maintenance_thread(void *arg);
 
 /*
-    grows the hashtable to the next power of 2.
-    assoc->lock is assumed to be held by the caller.
+    starts a thread to grow the hashtable to the next power of 2.
+    The caller holds an item lock, and growing the table needs all of
+    them, so the thread does all of the work.
 */
 static void assoc_expand(struct default_engine *engine) {
-    engine->assoc->old_hashtable = engine->assoc->primary_hashtable;
-
-    engine->assoc->primary_hashtable =
-        static_cast<hash_item**>(cb_calloc(hashsize(engine->assoc->hashpower + 1),
-                                           sizeof(hash_item *)));
-    if (engine->assoc->primary_hashtable) {
-        int ret = 0;
-        cb_thread_t tid;
-
-        engine->assoc->hashpower++;
-        engine->assoc->expanding = true;
-        engine->assoc->expand_bucket = 0;
-
-        /* start a thread to do the expansion */
-        if ((ret = cb_create_named_thread(&tid, assoc_maintenance_thread,
-                                          engine, 1, "mc:assoc_maint")) != 0)
-        {
-            EXTENSION_LOGGER_DESCRIPTOR *logger;
-            logger = static_cast<EXTENSION_LOGGER_DESCRIPTOR*>
-                (engine->server.extension->get_extension(EXTENSION_LOGGER));
-            logger->log(EXTENSION_LOG_WARNING, NULL,
-                        "Can't create thread: %s", cb_strerror().c_str());
-            engine->assoc->hashpower--;
-            engine->assoc->expanding = false;
-            cb_free(engine->assoc->primary_hashtable);
-            engine->assoc->primary_hashtable = engine->assoc->old_hashtable;
-        }
-    } else {
-        engine->assoc->primary_hashtable = engine->assoc->old_hashtable;
-        /* Bad news, but we can keep running. */
+    bool running = false;
+    if (!engine->assoc->maintenance_running.compare_exchange_strong(running,
+                                                                    true)) {
+        return;
+    }
+
+    int ret = 0;
+    cb_thread_t tid;
+    if ((ret = cb_create_named_thread(&tid, assoc_maintenance_thread,
+                                      engine, 1, "mc:assoc_maint")) != 0)
+    {
+        EXTENSION_LOGGER_DESCRIPTOR *logger;
+        logger = static_cast<EXTENSION_LOGGER_DESCRIPTOR*>
+            (engine->server.extension->get_extension(EXTENSION_LOGGER));
+        logger->log(EXTENSION_LOG_WARNING, NULL,
+                    "Can't create thread: %s", cb_strerror().c_str());
+        engine->assoc->maintenance_running = false;
     }
 }
 
 /* Note: this isn't an assoc_update.  The key must not already exist to call this */
 int assoc_insert(struct default_engine *engine, uint32_t hash, hash_item *it) {
-    unsigned int oldbucket;
-
     cb_assert(assoc_find(engine, hash, item_get_key(it)) == 0);  /* shouldn't have duplicately named things defined */
 
-    cb_mutex_enter(&engine->assoc->lock);
-    if (engine->assoc->expanding &&
-        (oldbucket = (hash & hashmask(engine->assoc->hashpower - 1))) >= engine->assoc->expand_bucket)
-    {
-        it->h_next = engine->assoc->old_hashtable[oldbucket];
-        engine->assoc->old_hashtable[oldbucket] = it;
-    } else {
-        it->h_next = engine->assoc->primary_hashtable[hash & hashmask(engine->assoc->hashpower)];
-        engine->assoc->primary_hashtable[hash & hashmask(engine->assoc->hashpower)] = it;
-    }
+    hash_item **bucket = assoc_bucket(engine, hash);
+    it->h_next = *bucket;
+    *bucket = it;
 
-    engine->assoc->hash_items++;
-    if (! engine->assoc->expanding && engine->assoc->hash_items > (hashsize(engine->assoc->hashpower) * 3) / 2) {
+    const unsigned int hash_items = ++engine->assoc->hash_items;
+    if (! engine->assoc->expanding && hash_items > (hashsize(engine->assoc->hashpower) * 3) / 2) {
         assoc_expand(engine);
     }
-    cb_mutex_exit(&engine->assoc->lock);
-    MEMCACHED_ASSOC_INSERT(hash_key_get_key(item_get_key(it)), hash_key_get_key_len(item_get_key(it)), engine->assoc->hash_items);
+    MEMCACHED_ASSOC_INSERT(hash_key_get_key(item_get_key(it)), hash_key_get_key_len(item_get_key(it)), hash_items);
     return 1;
 }
 
 void assoc_delete(struct default_engine *engine, uint32_t hash, const hash_key *key) {
-    cb_mutex_enter(&engine->assoc->lock);
     hash_item **before = _hashitem_before(engine, hash, key);
 
     if (*before) {
@@ -209,63 +205,94 @@ void assoc_delete(struct default_engine *engine, uint32_t hash, const hash_key *
          */
         MEMCACHED_ASSOC_DELETE(hash_key_get_key(key),
                                hash_key_get_key_len(key),
-                               engine->assoc->hash_items);
+                               engine->assoc->hash_items.load());
         nxt = (*before)->h_next;
         (*before)->h_next = 0;   /* probably pointless, but whatever. */
         *before = nxt;
-        cb_mutex_exit(&engine->assoc->lock);
         return;
     }
-    cb_mutex_exit(&engine->assoc->lock);
     /* Note:  we never actually get here.  the callers don't delete things
        they can't find. */
     cb_assert(*before != 0);
 }
 
+/*
+    Allocate the new table and start the expansion. Returns false if there
+    was nothing to do (or we couldn't allocate the table).
+*/
+static bool assoc_start_expand(struct default_engine *engine) {
+    struct assoc *assoc = engine->assoc;
+    bool started = false;
+
+    assoc_lock_all(assoc);
+    if (!assoc->expanding &&
+        assoc->hash_items > (hashsize(assoc->hashpower) * 3) / 2) {
+        hash_item **table = static_cast<hash_item**>(
+            cb_calloc(hashsize(assoc->hashpower + 1), sizeof(hash_item *)));
+        if (table) {
+            assoc->old_hashtable = assoc->primary_hashtable;
+            assoc->primary_hashtable = table;
+            assoc->hashpower++;
+            assoc->expand_bucket = 0;
+            assoc->expanding = true;
+            started = true;
+        }
+        /* else: Bad news, but we can keep running. */
+    }
+    assoc_unlock_all(assoc);
+    return started;
+}
 
-
-#define DEFAULT_HASH_BULK_MOVE 1
-int hash_bulk_move = DEFAULT_HASH_BULK_MOVE;
+static void assoc_finish_expand(struct default_engine *engine) {
+    struct assoc *assoc = engine->assoc;
+
+    assoc_lock_all(assoc);
+    assoc->expanding = false;
+    cb_free(assoc->old_hashtable);
+    assoc->old_hashtable = NULL;
+    assoc_unlock_all(assoc);
+
+    if (engine->config.verbose > 1) {
+        EXTENSION_LOGGER_DESCRIPTOR *logger;
+        logger = static_cast<EXTENSION_LOGGER_DESCRIPTOR*>
+            (engine->server.extension->get_extension(EXTENSION_LOGGER));
+        logger->log(EXTENSION_LOG_INFO, NULL,
+                    "Hash table expansion done\n");
+    }
+}
 
 static void assoc_maintenance_thread(void *arg) {
     struct default_engine *engine = static_cast<struct default_engine*>(arg);
-    bool done = false;
-    do {
-        int ii;
-        cb_mutex_enter(&engine->assoc->lock);
-
-        for (ii = 0; ii < hash_bulk_move && engine->assoc->expanding; ++ii) {
+    struct assoc *assoc = engine->assoc;
+
+    if (assoc_start_expand(engine)) {
+        /*
+         * An old bucket and the two new buckets it splits into all map to
+         * the same item lock, so each bucket only needs its own lock held
+         * while it is migrated. hashpower and the tables can't change
+         * under us as we're the only one who modifies them.
+         */
+        const unsigned int nbuckets = hashsize(assoc->hashpower - 1);
+        for (unsigned int bucket = 0; bucket < nbuckets; ++bucket) {
+            std::lock_guard<std::mutex> guard(assoc->item_locks[bucket & hashmask(ITEM_LOCK_POWER)]);
             hash_item *it, *next;
-            int bucket;
 
-            for (it = engine->assoc->old_hashtable[engine->assoc->expand_bucket];
-                 NULL != it; it = next) {
+            for (it = assoc->old_hashtable[bucket]; NULL != it; it = next) {
                 next = it->h_next;
                 const hash_key* key = item_get_key(it);
-                bucket = crc32c(hash_key_get_key(key),
-                                hash_key_get_key_len(key),
-                                0) & hashmask(engine->assoc->hashpower);
-                it->h_next = engine->assoc->primary_hashtable[bucket];
-                engine->assoc->primary_hashtable[bucket] = it;
+                const uint32_t newbucket = crc32c(hash_key_get_key(key),
+                                                  hash_key_get_key_len(key),
+                                                  0) & hashmask(assoc->hashpower);
+                it->h_next = assoc->primary_hashtable[newbucket];
+                assoc->primary_hashtable[newbucket] = it;
             }
 
-            engine->assoc->old_hashtable[engine->assoc->expand_bucket] = NULL;
-            engine->assoc->expand_bucket++;
-            if (engine->assoc->expand_bucket == hashsize(engine->assoc->hashpower - 1)) {
-                engine->assoc->expanding = false;
-                cb_free(engine->assoc->old_hashtable);
-                if (engine->config.verbose > 1) {
-                    EXTENSION_LOGGER_DESCRIPTOR *logger;
-                    logger = static_cast<EXTENSION_LOGGER_DESCRIPTOR*>
-                        (engine->server.extension->get_extension(EXTENSION_LOGGER));
-                    logger->log(EXTENSION_LOG_INFO, NULL,
-                                "Hash table expansion done\n");
-                }
-            }
-        }
-        if (!engine->assoc->expanding) {
-            done = true;
+            assoc->old_hashtable[bucket] = NULL;
+            assoc->expand_bucket = bucket + 1;
         }
-        cb_mutex_exit(&engine->assoc->lock);
-    } while (!done);
+
+        assoc_finish_expand(engine);
+    }
+
+    assoc->maintenance_running = false;
 }
@@ -1,6 +1,20 @@
 #ifndef ASSOC_H
 #define ASSOC_H
 
+#include <atomic>
+#include <mutex>
+
+/*
+ * The hash table is protected by a fixed array of "item locks". The lock
+ * for a key is chosen by the low ITEM_LOCK_POWER bits of its hash, which
+ * (as the hash table never has fewer than 2^(ITEM_LOCK_POWER + 1) buckets)
+ * means that every bucket of both the primary and the old hash table is
+ * covered by exactly one item lock. The item lock also protects the items
+ * which hash to it (see items.cc).
+ */
+#define ITEM_LOCK_POWER 10
+#define ITEM_LOCK_COUNT (1 << ITEM_LOCK_POWER)
+
 struct assoc {
    /* how many powers of 2's worth of buckets we use */
    unsigned int hashpower;
@@ -16,7 +30,7 @@ struct assoc {
    hash_item** old_hashtable;
 
    /* Number of items in the hash table. */
-   unsigned int hash_items;
+   std::atomic<unsigned int> hash_items;
 
    /* Flag: Are we in the middle of expanding now? */
    bool expanding;
@@ -24,19 +38,31 @@ struct assoc {
    /*
     * During expansion we migrate values with bucket granularity; this is how
     * far we've gotten so far. Ranges from 0 .. hashsize(hashpower - 1) - 1.
+    * Only ever modified while holding the item lock of the bucket being
+    * migrated, but read by holders of any item lock.
     */
-   unsigned int expand_bucket;
+   std::atomic<unsigned int> expand_bucket;
 
+   /* Flag: Is the maintenance thread running? */
+   std::atomic<bool> maintenance_running;
 
    /*
-    * serialise access to the hashtable
+    * serialise access to the hashtable; hashpower, the table pointers and
+    * expanding may only be modified while holding all of them.
     */
-   cb_mutex_t lock;
+   std::mutex item_locks[ITEM_LOCK_COUNT];
 };
 
 /* associative array */
 ENGINE_ERROR_CODE assoc_init(struct default_engine *engine);
 void assoc_destroy(void);
+
+/*
+ * Get the item lock for the given hash. It must be held while calling
+ * assoc_find, assoc_insert or assoc_delete for that hash.
+ */
+std::mutex& assoc_get_item_lock(struct default_engine *engine, uint32_t hash);
+
 hash_item *assoc_find(struct default_engine *engine, uint32_t hash,
                       const hash_key* key);
 int assoc_insert(struct default_engine *engine, uint32_t hash,
@@ -62,6 +62,12 @@ static cb::EngineErrorItemPair default_get(ENGINE_HANDLE* handle,
                                            uint16_t vbucket,
                                            DocStateFilter);
 
+static std::vector<cb::EngineErrorItemPair> default_get_multi(
+        ENGINE_HANDLE* handle,
+        const void* cookie,
+        const std::vector<cb::GetMultiKey>& keys,
+        DocStateFilter documentStateFilter);
+
 static cb::EngineErrorItemPair default_get_if(ENGINE_HANDLE*,
                                               const void*,
                                               const DocKey&,
@@ -152,15 +158,19 @@ static bool set_item_info(ENGINE_HANDLE *handle, const void *cookie,
  * Once an object is in that map it may in theory be referenced, so we
  * need to ensure that the members is initialized before hitting that map.
  *
+ * The engine must have been value-initialized (`new default_engine()`),
+ * which zeroes the plain members and constructs the atomic ones (the
+ * statistics shards and oldest_live). It must not be memset, as that
+ * would overwrite the atomics behind their back.
+ *
  * @todo refactor default_engine to C++ to avoid this extra hack :)
  */
 void default_engine_constructor(struct default_engine* engine, bucket_id_t id)
 {
-    memset(engine, 0, sizeof(*engine));
-
     cb_mutex_initialize(&engine->slabs.lock);
-    cb_mutex_initialize(&engine->items.lock);
-    cb_mutex_initialize(&engine->stats.lock);
+    for (auto& lock : engine->items.lru_locks) {
+        cb_mutex_initialize(&lock);
+    }
     cb_mutex_initialize(&engine->scrubber.lock);
 
     engine->bucket_id = id;
@@ -173,6 +183,7 @@ void default_engine_constructor(struct default_engine* engine, bucket_id_t id)
     engine->engine.remove = default_item_delete;
     engine->engine.release = default_item_release;
     engine->engine.get = default_get;
+    engine->engine.get_multi = default_get_multi;
     engine->engine.get_if = default_get_if;
     engine->engine.get_locked = default_get_locked;
     engine->engine.get_and_touch = default_get_and_touch;
@@ -274,8 +285,9 @@ void destroy_engine_instance(struct default_engine* engine) {
         cb_free(engine->config.uuid);
 
         /* Clean up the mutexes */
-        cb_mutex_destroy(&engine->items.lock);
-        cb_mutex_destroy(&engine->stats.lock);
+        for (auto& lock : engine->items.lru_locks) {
+            cb_mutex_destroy(&lock);
+        }
         cb_mutex_destroy(&engine->slabs.lock);
         cb_mutex_destroy(&engine->scrubber.lock);
 
@@ -455,6 +467,52 @@ static cb::EngineErrorItemPair default_get(ENGINE_HANDLE* handle,
     }
 }
 
+static std::vector<cb::EngineErrorItemPair> default_get_multi(
+        ENGINE_HANDLE* handle,
+        const void* cookie,
+        const std::vector<cb::GetMultiKey>& keys,
+        DocStateFilter documentStateFilter) {
+    struct default_engine* engine = get_handle(handle);
+
+    std::vector<cb::EngineErrorItemPair> ret;
+    ret.reserve(keys.size());
+
+    // Look up all of the keys in vbuckets we handle in one go
+    std::vector<size_t> index;
+    std::vector<const void*> ptrs;
+    std::vector<size_t> lengths;
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        if (handled_vbucket(engine, keys[ii].vbucket)) {
+            index.push_back(ii);
+            ptrs.push_back(keys[ii].key.data());
+            lengths.push_back(keys[ii].key.size());
+        }
+        ret.push_back(
+                cb::makeEngineErrorItemPair(cb::engine_errc::not_my_vbucket));
+    }
+
+    std::vector<hash_item*> items(index.size());
+    item_get_multi(engine,
+                   cookie,
+                   index.size(),
+                   ptrs.data(),
+                   lengths.data(),
+                   documentStateFilter,
+                   items.data());
+
+    for (size_t ii = 0; ii < index.size(); ++ii) {
+        if (items[ii] != nullptr) {
+            ret[index[ii]] = cb::makeEngineErrorItemPair(
+                    cb::engine_errc::success, items[ii], handle);
+        } else {
+            ret[index[ii]] =
+                    cb::makeEngineErrorItemPair(cb::engine_errc::no_such_key);
+        }
+    }
+
+    return ret;
+}
+
 static cb::EngineErrorItemPair default_get_if(
         ENGINE_HANDLE* handle,
         const void* cookie,
@@ -565,20 +623,24 @@ static ENGINE_ERROR_CODE default_get_stats(ENGINE_HANDLE* handle,
       char val[128];
       int len;
 
-      cb_mutex_enter(&engine->stats.lock);
-      len = sprintf(val, "%" PRIu64, (uint64_t)engine->stats.evictions);
+      const struct engine_stats* stats = &engine->stats;
+      len = sprintf(val, "%" PRIu64,
+                    engine_stats_sum(stats, &engine_stats_shard::evictions));
       add_stat("evictions", 9, val, len, cookie);
-      len = sprintf(val, "%" PRIu64, (uint64_t)engine->stats.curr_items);
+      len = sprintf(val, "%" PRIu64,
+                    engine_stats_sum(stats, &engine_stats_shard::curr_items));
       add_stat("curr_items", 10, val, len, cookie);
-      len = sprintf(val, "%" PRIu64, (uint64_t)engine->stats.total_items);
+      len = sprintf(val, "%" PRIu64,
+                    engine_stats_sum(stats, &engine_stats_shard::total_items));
       add_stat("total_items", 11, val, len, cookie);
-      len = sprintf(val, "%" PRIu64, (uint64_t)engine->stats.curr_bytes);
+      len = sprintf(val, "%" PRIu64,
+                    engine_stats_sum(stats, &engine_stats_shard::curr_bytes));
       add_stat("bytes", 5, val, len, cookie);
-      len = sprintf(val, "%" PRIu64, engine->stats.reclaimed);
+      len = sprintf(val, "%" PRIu64,
+                    engine_stats_sum(stats, &engine_stats_shard::reclaimed));
       add_stat("reclaimed", 9, val, len, cookie);
       len = sprintf(val, "%" PRIu64, (uint64_t)engine->config.maxbytes);
       add_stat("engine_maxbytes", 15, val, len, cookie);
-      cb_mutex_exit(&engine->stats.lock);
    } else if (strncmp(stat_key, "slabs", 5) == 0) {
       slabs_stats(engine, add_stat, cookie);
    } else if (strncmp(stat_key, "items", 5) == 0) {
@@ -652,11 +714,9 @@ static void default_reset_stats(ENGINE_HANDLE* handle, const void *cookie) {
    struct default_engine *engine = get_handle(handle);
    item_stats_reset(engine);
 
-   cb_mutex_enter(&engine->stats.lock);
-   engine->stats.evictions = 0;
-   engine->stats.reclaimed = 0;
-   engine->stats.total_items = 0;
-   cb_mutex_exit(&engine->stats.lock);
+   engine_stats_reset(&engine->stats, &engine_stats_shard::evictions);
+   engine_stats_reset(&engine->stats, &engine_stats_shard::reclaimed);
+   engine_stats_reset(&engine->stats, &engine_stats_shard::total_items);
 }
 
 static ENGINE_ERROR_CODE initalize_configuration(struct default_engine *se,
@@ -12,6 +12,8 @@
 
 #include <stdbool.h>
 
+#include <atomic>
+
 #include <memcached/engine.h>
 #include <memcached/util.h>
 #include <memcached/visibility.h>
@@ -48,7 +50,7 @@ struct default_engine;
 
 struct config {
    size_t verbose;
-   rel_time_t oldest_live;
+   std::atomic<rel_time_t> oldest_live{0};
    bool evict_to_free;
    size_t maxbytes;
    bool preallocate;
@@ -61,16 +63,33 @@ struct config {
    bool keep_deleted;
 };
 
+/** The number of shards the engine statistics are split into */
+#define ENGINE_STATS_SHARDS 64
+
+/**
+ * One shard of the statistic information. Padded so that two shards
+ * never share a cache line (even if the struct itself isn't aligned).
+ * The counters are unsigned, so a shard's curr_bytes / curr_items may
+ * wrap if items are unlinked by a different thread than linked them;
+ * the sum over all of the shards is still correct.
+ */
+struct engine_stats_shard {
+   std::atomic<uint64_t> evictions{0};
+   std::atomic<uint64_t> reclaimed{0};
+   std::atomic<uint64_t> curr_bytes{0};
+   std::atomic<uint64_t> curr_items{0};
+   std::atomic<uint64_t> total_items{0};
+   char padding[128 - 5 * sizeof(uint64_t)];
+};
+
 /**
- * Statistic information collected by the default engine
+ * Statistic information collected by the default engine. Every worker
+ * thread updates the counters on every link and unlink, so rather than
+ * serialising them through a lock each thread updates its own shard
+ * (see engine_stats_local) and readers sum the shards.
  */
 struct engine_stats {
-   cb_mutex_t lock;
-   uint64_t evictions;
-   uint64_t reclaimed;
-   uint64_t curr_bytes;
-   uint64_t curr_items;
-   uint64_t total_items;
+   struct engine_stats_shard shards[ENGINE_STATS_SHARDS];
 };
 
 struct engine_scrubber {
@@ -128,6 +147,17 @@ char* item_get_data(const hash_item* item);
 hash_key* item_get_key(const hash_item* item);
 void item_set_cas(ENGINE_HANDLE *handle, const void *cookie,
                   item* item, uint64_t val);
+
+/** Get the calling thread's shard of the engine statistics */
+struct engine_stats_shard* engine_stats_local(struct engine_stats* stats);
+
+/** Sum the given counter over all of the shards of the engine statistics */
+uint64_t engine_stats_sum(const struct engine_stats* stats,
+                          std::atomic<uint64_t> engine_stats_shard::*counter);
+
+/** Reset the given counter in all of the shards of the engine statistics */
+void engine_stats_reset(struct engine_stats* stats,
+                        std::atomic<uint64_t> engine_stats_shard::*counter);
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -14,6 +14,11 @@
 #include "default_engine_internal.h"
 #include "engine_manager.h"
 
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 /* Forward Declarations */
 static void item_link_q(struct default_engine *engine, hash_item *it);
 static void item_unlink_q(struct default_engine *engine, hash_item *it);
@@ -30,6 +35,8 @@ static int do_item_link(struct default_engine *engine,
                         const void* cookie,
                         hash_item *it);
 static void do_item_unlink(struct default_engine *engine, hash_item *it);
+static void do_item_unlink_lru_held(struct default_engine *engine,
+                                    hash_item *it);
 static ENGINE_ERROR_CODE do_safe_item_unlink(struct default_engine *engine,
                                              hash_item *it);
 static void do_item_release(struct default_engine *engine, hash_item *it);
@@ -49,6 +56,21 @@ static bool hash_key_create(hash_key* hkey,
 static void hash_key_destroy(hash_key* hkey);
 static void hash_key_copy_to_item(hash_item* dst, const hash_key* src);
 
+/*
+ * Locking:
+ *
+ * Each key is protected by its item lock (see assoc_get_item_lock), which
+ * covers its hash chain and the refcount and fields of the items with that
+ * key. The do_* functions expect the item lock of the key they operate on
+ * to be held by the caller.
+ *
+ * The LRU of each slab class is protected by its own lock in
+ * engine->items.lru_locks, which must be acquired after any item lock.
+ * Code which walks an LRU (eviction, flush, stats and the scrubber) holds
+ * the LRU lock and may only try to acquire the item locks of the items it
+ * finds there; if that fails it skips (or retries) the item.
+ */
+
 /*
  * We only reposition items in the LRU queue if they haven't been repositioned
  * in this many seconds. That saves us from churning on frequently-accessed
@@ -62,9 +84,71 @@ static void hash_key_copy_to_item(hash_item* dst, const hash_key* src);
 static const int search_items = 50;
 
 void item_stats_reset(struct default_engine *engine) {
-    cb_mutex_enter(&engine->items.lock);
-    memset(engine->items.itemstats, 0, sizeof(engine->items.itemstats));
-    cb_mutex_exit(&engine->items.lock);
+    for (int ii = 0; ii < POWER_LARGEST; ii++) {
+        cb_mutex_enter(&engine->items.lru_locks[ii]);
+        memset(&engine->items.itemstats[ii], 0,
+               sizeof(engine->items.itemstats[ii]));
+        cb_mutex_exit(&engine->items.lru_locks[ii]);
+    }
+}
+
+struct engine_stats_shard* engine_stats_local(struct engine_stats* stats) {
+    /*
+     * Spread the threads over the shards by (a multiplicative hash of)
+     * their id. Two threads may end up sharing a shard, which costs some
+     * contention but is otherwise harmless.
+     */
+    const uint64_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return &stats->shards[(id * 0x9e3779b97f4a7c15ULL) >> 58];
+}
+
+static_assert(ENGINE_STATS_SHARDS == 64,
+              "engine_stats_local assumes 64 shards");
+
+uint64_t engine_stats_sum(const struct engine_stats* stats,
+                          std::atomic<uint64_t> engine_stats_shard::*counter) {
+    uint64_t sum = 0;
+    for (const auto& shard : stats->shards) {
+        sum += (shard.*counter).load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void engine_stats_reset(struct engine_stats* stats,
+                        std::atomic<uint64_t> engine_stats_shard::*counter) {
+    for (auto& shard : stats->shards) {
+        (shard.*counter).store(0, std::memory_order_relaxed);
+    }
+}
+
+/* Get the hash of a key, which is also used to select its item lock */
+static uint32_t hash_key_get_hash(const hash_key* key) {
+    return crc32c(hash_key_get_key(key), hash_key_get_key_len(key), 0);
+}
+
+static std::mutex& item_get_lock(struct default_engine *engine,
+                                 const hash_key* key) {
+    return assoc_get_item_lock(engine, hash_key_get_hash(key));
+}
+
+/* The scrubber's cursors live in the LRU but aren't real items */
+static bool item_is_cursor(const hash_item *it) {
+    return item_get_key(it)->header.len == 0 && it->nbytes == 0;
+}
+
+/*
+ * Try to acquire the item lock of an item found while walking an LRU.
+ * Returns NULL if the lock is busy, or if it is the lock already held by
+ * the caller (`held`, which may be NULL).
+ */
+static std::mutex* item_trylock(struct default_engine *engine,
+                                const hash_item *it,
+                                const std::mutex* held) {
+    std::mutex& lock = item_get_lock(engine, item_get_key(it));
+    if (&lock == held || !lock.try_lock()) {
+        return NULL;
+    }
+    return &lock;
 }
 
 
@@ -77,7 +161,7 @@ static size_t ITEM_ntotal(struct default_engine *engine,
 
 /* Get the next CAS id for a new item. */
 static uint64_t get_cas_id(void) {
-    static uint64_t cas_id = 0;
+    static std::atomic<uint64_t> cas_id(0);
     return ++cas_id;
 }
 
@@ -93,26 +177,25 @@ static uint64_t get_cas_id(void) {
 #endif
 
 
+/*
+ * Get the memory for a new item in slab class id; either by reclaiming an
+ * expired item from the tail of the LRU, from the slab allocator, or by
+ * evicting an item. The caller holds the LRU lock of the class, and `held`
+ * is the item lock it holds (for the key of the new item).
+ */
 /*@null@*/
-hash_item *do_item_alloc(struct default_engine *engine,
-                         const hash_key *key,
-                         const int flags,
-                         const rel_time_t exptime,
-                         const int nbytes,
-                         const void *cookie,
-                         uint8_t datatype) {
+static hash_item *do_item_alloc_lru_held(struct default_engine *engine,
+                                         const size_t ntotal,
+                                         const unsigned int id,
+                                         const void *cookie,
+                                         const std::mutex* held) {
     hash_item *it = NULL;
     int tries = search_items;
     hash_item *search;
+    std::mutex* lock;
     rel_time_t oldest_live;
     rel_time_t current_time;
-    unsigned int id;
-
-    size_t ntotal = sizeof(hash_item) + hash_key_get_alloc_size(key) + nbytes;
-
-    if ((id = slabs_clsid(engine, ntotal)) == 0) {
-        return 0;
-    }
+    auto* stats = engine_stats_local(&engine->stats);
 
     /* do a quick check if we have any expired items in the tail.. */
     oldest_live = engine->config.oldest_live;
@@ -121,6 +204,10 @@ hash_item *do_item_alloc(struct default_engine *engine,
     for (search = engine->items.tails[id];
          tries > 0 && search != NULL;
          tries--, search=search->prev) {
+        if (item_is_cursor(search) ||
+            (lock = item_trylock(engine, search, held)) == NULL) {
+            continue;
+        }
         if (search->refcount == 0 &&
             ((search->time < oldest_live) || /* dead by flush */
              (search->exptime != 0 && search->exptime < current_time)) &&
@@ -129,18 +216,18 @@ hash_item *do_item_alloc(struct default_engine *engine,
             /* I don't want to actually free the object, just steal
              * the item to avoid to grab the slab mutex twice ;-)
              */
-            cb_mutex_enter(&engine->stats.lock);
-            engine->stats.reclaimed++;
-            cb_mutex_exit(&engine->stats.lock);
+            stats->reclaimed++;
             engine->items.itemstats[id].reclaimed++;
             it->refcount = 1;
             slabs_adjust_mem_requested(engine, it->slabs_clsid, ITEM_ntotal(engine, it), ntotal);
-            do_item_unlink(engine, it);
+            do_item_unlink_lru_held(engine, it);
             /* Initialize the item block: */
             it->slabs_clsid = 0;
             it->refcount = 0;
+            lock->unlock();
             break;
         }
+        lock->unlock();
     }
 
     if (it == NULL &&
@@ -173,6 +260,10 @@ hash_item *do_item_alloc(struct default_engine *engine,
         }
 
         for (search = engine->items.tails[id]; tries > 0 && search != NULL; tries--, search=search->prev) {
+            if (item_is_cursor(search) ||
+                (lock = item_trylock(engine, search, held)) == NULL) {
+                continue;
+            }
             if (search->refcount == 0 && search->locktime <= current_time) {
                 if (search->exptime == 0 || search->exptime > current_time) {
                     engine->items.itemstats[id].evicted++;
@@ -180,22 +271,20 @@ hash_item *do_item_alloc(struct default_engine *engine,
                     if (search->exptime != 0) {
                         engine->items.itemstats[id].evicted_nonzero++;
                     }
-                    cb_mutex_enter(&engine->stats.lock);
-                    engine->stats.evictions++;
-                    cb_mutex_exit(&engine->stats.lock);
+                    stats->evictions++;
                     const hash_key* search_key = item_get_key(search);
                     engine->server.stat->evicting(cookie,
                                                   hash_key_get_client_key(search_key),
                                                   hash_key_get_client_key_len(search_key));
                 } else {
                     engine->items.itemstats[id].reclaimed++;
-                    cb_mutex_enter(&engine->stats.lock);
-                    engine->stats.reclaimed++;
-                    cb_mutex_exit(&engine->stats.lock);
+                    stats->reclaimed++;
                 }
-                do_item_unlink(engine, search);
+                do_item_unlink_lru_held(engine, search);
+                lock->unlock();
                 break;
             }
+            lock->unlock();
         }
         it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id));
         if (it == 0) {
@@ -209,12 +298,18 @@ hash_item *do_item_alloc(struct default_engine *engine,
              */
             tries = search_items;
             for (search = engine->items.tails[id]; tries > 0 && search != NULL; tries--, search=search->prev) {
+                if (item_is_cursor(search) ||
+                    (lock = item_trylock(engine, search, held)) == NULL) {
+                    continue;
+                }
                 if (search->refcount != 0 && search->time + TAIL_REPAIR_TIME < current_time) {
                     engine->items.itemstats[id].tailrepairs++;
                     search->refcount = 0;
-                    do_item_unlink(engine, search);
+                    do_item_unlink_lru_held(engine, search);
+                    lock->unlock();
                     break;
                 }
+                lock->unlock();
             }
             it = static_cast<hash_item*>(slabs_alloc(engine, ntotal, id));
             if (it == 0) {
@@ -223,11 +318,40 @@ hash_item *do_item_alloc(struct default_engine *engine,
         }
     }
 
-    cb_assert(it->slabs_clsid == 0);
+    return it;
+}
 
-    it->slabs_clsid = id;
+/*@null@*/
+hash_item *do_item_alloc(struct default_engine *engine,
+                         const hash_key *key,
+                         const int flags,
+                         const rel_time_t exptime,
+                         const int nbytes,
+                         const void *cookie,
+                         uint8_t datatype) {
+    hash_item *it;
+    unsigned int id;
+
+    size_t ntotal = sizeof(hash_item) + hash_key_get_alloc_size(key) + nbytes;
+
+    if ((id = slabs_clsid(engine, ntotal)) == 0) {
+        return 0;
+    }
 
-    cb_assert(it != engine->items.heads[it->slabs_clsid]);
+    cb_mutex_enter(&engine->items.lru_locks[id]);
+    it = do_item_alloc_lru_held(engine, ntotal, id, cookie,
+                                &item_get_lock(engine, key));
+    if (it != NULL) {
+        cb_assert(it->slabs_clsid == 0);
+        cb_assert(it != engine->items.heads[id]);
+    }
+    cb_mutex_exit(&engine->items.lru_locks[id]);
+
+    if (it == NULL) {
+        return NULL;
+    }
+
+    it->slabs_clsid = id;
 
     it->next = it->prev = it->h_next = 0;
     it->refcount = 1;     /* the caller will have a reference */
@@ -246,8 +370,6 @@ static void item_free(struct default_engine *engine, hash_item *it) {
     size_t ntotal = ITEM_ntotal(engine, it);
     unsigned int clsid;
     cb_assert((it->iflag & ITEM_LINKED) == 0);
-    cb_assert(it != engine->items.heads[it->slabs_clsid]);
-    cb_assert(it != engine->items.tails[it->slabs_clsid]);
     cb_assert(it->refcount == 0 || engine->scrubber.force_delete);
 
     /* so slab size changer can tell later if item is already free or not */
@@ -258,6 +380,7 @@ static void item_free(struct default_engine *engine, hash_item *it) {
     slabs_free(engine, it, ntotal, clsid);
 }
 
+/* The caller must hold the LRU lock of the item's slab class */
 static void item_link_q(struct default_engine *engine, hash_item *it) { /* item is the new head */
     hash_item **head, **tail;
     cb_assert(it->slabs_clsid < POWER_LARGEST);
@@ -276,6 +399,7 @@ static void item_link_q(struct default_engine *engine, hash_item *it) { /* item
     return;
 }
 
+/* The caller must hold the LRU lock of the item's slab class */
 static void item_unlink_q(struct default_engine *engine, hash_item *it) {
     hash_item **head, **tail;
     cb_assert(it->slabs_clsid < POWER_LARGEST);
@@ -308,15 +432,12 @@ int do_item_link(struct default_engine *engine,
     it->iflag |= ITEM_LINKED;
     it->time = engine->server.core->get_current_time();
 
-    assoc_insert(engine, crc32c(hash_key_get_key(key),
-                                hash_key_get_key_len(key), 0),
-                 it);
+    assoc_insert(engine, hash_key_get_hash(key), it);
 
-    cb_mutex_enter(&engine->stats.lock);
-    engine->stats.curr_bytes += ITEM_ntotal(engine, it);
-    engine->stats.curr_items += 1;
-    engine->stats.total_items += 1;
-    cb_mutex_exit(&engine->stats.lock);
+    auto* stats = engine_stats_local(&engine->stats);
+    stats->curr_bytes += ITEM_ntotal(engine, it);
+    stats->curr_items += 1;
+    stats->total_items += 1;
 
     auto cas = get_cas_id();
 
@@ -338,25 +459,28 @@ int do_item_link(struct default_engine *engine,
         return 0;
     }
 
+    cb_mutex_enter(&engine->items.lru_locks[it->slabs_clsid]);
     item_link_q(engine, it);
+    cb_mutex_exit(&engine->items.lru_locks[it->slabs_clsid]);
 
     return 1;
 }
 
-void do_item_unlink(struct default_engine *engine, hash_item *it) {
+/*
+ * Unlink an item from the hash table and its LRU. The caller holds the
+ * item lock of the item and the LRU lock of its slab class.
+ */
+void do_item_unlink_lru_held(struct default_engine *engine, hash_item *it) {
     const hash_key* key = item_get_key(it);
     MEMCACHED_ITEM_UNLINK(hash_key_get_client_key(key),
                           hash_key_get_client_key_len(key),
                           it->nbytes);
     if ((it->iflag & ITEM_LINKED) != 0) {
         it->iflag &= ~ITEM_LINKED;
-        cb_mutex_enter(&engine->stats.lock);
-        engine->stats.curr_bytes -= ITEM_ntotal(engine, it);
-        engine->stats.curr_items -= 1;
-        cb_mutex_exit(&engine->stats.lock);
-        assoc_delete(engine, crc32c(hash_key_get_key(key),
-                                    hash_key_get_key_len(key), 0),
-                     key);
+        auto* stats = engine_stats_local(&engine->stats);
+        stats->curr_bytes -= ITEM_ntotal(engine, it);
+        stats->curr_items -= 1;
+        assoc_delete(engine, hash_key_get_hash(key), key);
         item_unlink_q(engine, it);
         if (it->refcount == 0 || engine->scrubber.force_delete) {
             item_free(engine, it);
@@ -364,6 +488,15 @@ void do_item_unlink(struct default_engine *engine, hash_item *it) {
     }
 }
 
+void do_item_unlink(struct default_engine *engine, hash_item *it) {
+    if ((it->iflag & ITEM_LINKED) != 0) {
+        const unsigned int id = it->slabs_clsid;
+        cb_mutex_enter(&engine->items.lru_locks[id]);
+        do_item_unlink_lru_held(engine, it);
+        cb_mutex_exit(&engine->items.lru_locks[id]);
+    }
+}
+
 ENGINE_ERROR_CODE do_safe_item_unlink(struct default_engine* engine,
                                       hash_item* it) {
 
@@ -377,23 +510,7 @@ ENGINE_ERROR_CODE do_safe_item_unlink(struct default_engine* engine,
     auto ret = ENGINE_SUCCESS;
 
     if (it->cas == stored->cas) {
-        MEMCACHED_ITEM_UNLINK(hash_key_get_client_key(key),
-                              hash_key_get_client_key_len(key),
-                              it->nbytes);
-        if ((stored->iflag & ITEM_LINKED) != 0) {
-            stored->iflag &= ~ITEM_LINKED;
-            cb_mutex_enter(&engine->stats.lock);
-            engine->stats.curr_bytes -= ITEM_ntotal(engine, stored);
-            engine->stats.curr_items -= 1;
-            cb_mutex_exit(&engine->stats.lock);
-            assoc_delete(engine, crc32c(hash_key_get_key(key),
-                                        hash_key_get_key_len(key), 0),
-                         key);
-            item_unlink_q(engine, stored);
-            if (stored->refcount == 0 || engine->scrubber.force_delete) {
-                item_free(engine, stored);
-            }
-        }
+        do_item_unlink(engine, stored);
     } else {
         ret = ENGINE_KEY_EEXISTS;
     }
@@ -424,9 +541,11 @@ void do_item_update(struct default_engine *engine, hash_item *it) {
         cb_assert((it->iflag & ITEM_SLABBED) == 0);
 
         if ((it->iflag & ITEM_LINKED) != 0) {
+            cb_mutex_enter(&engine->items.lru_locks[it->slabs_clsid]);
             item_unlink_q(engine, it);
             it->time = current_time;
             item_link_q(engine, it);
+            cb_mutex_exit(&engine->items.lru_locks[it->slabs_clsid]);
         }
     }
 }
@@ -452,25 +571,35 @@ static void do_item_stats(struct default_engine *engine,
     int i;
     rel_time_t current_time = engine->server.core->get_current_time();
     for (i = 0; i < POWER_LARGEST; i++) {
+        cb_mutex_enter(&engine->items.lru_locks[i]);
         if (engine->items.tails[i] != NULL) {
             const char *prefix = "items";
             int search = search_items;
-            while (search > 0 &&
-                   engine->items.tails[i] != NULL &&
-                   ((engine->config.oldest_live != 0 && /* Item flushd */
-                     engine->config.oldest_live <= current_time &&
-                     engine->items.tails[i]->time <= engine->config.oldest_live) ||
-                    (engine->items.tails[i]->exptime != 0 && /* and not expired */
-                     engine->items.tails[i]->exptime < current_time))) {
-                --search;
-                if (engine->items.tails[i]->refcount == 0) {
-                    do_item_unlink(engine, engine->items.tails[i]);
-                } else {
+            while (search > 0 && engine->items.tails[i] != NULL) {
+                hash_item *tail = engine->items.tails[i];
+                std::mutex* lock;
+                if (item_is_cursor(tail) ||
+                    (lock = item_trylock(engine, tail, NULL)) == NULL) {
+                    break;
+                }
+                rel_time_t oldest_live = engine->config.oldest_live;
+                bool expired = (oldest_live != 0 && /* Item flushd */
+                                oldest_live <= current_time &&
+                                tail->time <= oldest_live) ||
+                               (tail->exptime != 0 && /* and not expired */
+                                tail->exptime < current_time);
+                if (expired && tail->refcount == 0) {
+                    do_item_unlink_lru_held(engine, tail);
+                }
+                lock->unlock();
+                if (!expired || engine->items.tails[i] == tail) {
                     break;
                 }
+                --search;
             }
             if (engine->items.tails[i] == NULL) {
                 /* We removed all of the items in this slab class */
+                cb_mutex_exit(&engine->items.lru_locks[i]);
                 continue;
             }
 
@@ -491,6 +620,7 @@ static void do_item_stats(struct default_engine *engine,
             add_statistics(c, add_stats, prefix, i, "reclaimed",
                            "%u", engine->items.itemstats[i].reclaimed);;
         }
+        cb_mutex_exit(&engine->items.lru_locks[i]);
     }
 }
 
@@ -509,6 +639,7 @@ static void do_item_stats_sizes(struct default_engine *engine,
 
         /* build the histogram */
         for (i = 0; i < POWER_LARGEST; i++) {
+            cb_mutex_enter(&engine->items.lru_locks[i]);
             hash_item *iter = engine->items.heads[i];
             while (iter) {
                 size_t ntotal = ITEM_ntotal(engine, iter);
@@ -521,6 +652,7 @@ static void do_item_stats_sizes(struct default_engine *engine,
                 }
                 iter = iter->next;
             }
+            cb_mutex_exit(&engine->items.lru_locks[i]);
         }
 
         /* write the buffer */
@@ -545,10 +677,7 @@ hash_item* do_item_get(struct default_engine* engine,
                        const hash_key* key,
                        const DocStateFilter documentStateFilter) {
     rel_time_t current_time = engine->server.core->get_current_time();
-    hash_item *it = assoc_find(engine,
-                               crc32c(hash_key_get_key(key),
-                                      hash_key_get_key_len(key), 0),
-                               key);
+    hash_item *it = assoc_find(engine, hash_key_get_hash(key), key);
     int was_found = 0;
 
     if (engine->config.verbose > 2) {
@@ -572,7 +701,7 @@ hash_item* do_item_get(struct default_engine* engine,
     if (it != NULL && engine->config.oldest_live != 0 &&
         engine->config.oldest_live <= current_time &&
         it->time <= engine->config.oldest_live) {
-        do_item_unlink(engine, it);           /* MTSAFE - items.lock held */
+        do_item_unlink(engine, it);           /* MTSAFE - item lock held */
         it = NULL;
     }
 
@@ -585,7 +714,7 @@ hash_item* do_item_get(struct default_engine* engine,
     }
 
     if (it != NULL && it->exptime != 0 && it->exptime <= current_time) {
-        do_item_unlink(engine, it);           /* MTSAFE - items.lock held */
+        do_item_unlink(engine, it);           /* MTSAFE - item lock held */
         it = NULL;
     }
 
@@ -620,7 +749,7 @@ hash_item* do_item_get(struct default_engine* engine,
 
 /*
  * Stores an item in the cache according to the semantics of one of the set
- * commands. In threaded mode, this is protected by the cache lock.
+ * commands. In threaded mode, this is protected by the item lock.
  *
  * Returns the state of storage.
  */
@@ -715,9 +844,10 @@ hash_item *item_alloc(struct default_engine *engine,
     if (!hash_key_create(&hkey, key, nkey, engine, cookie)) {
         return NULL;
     }
-    cb_mutex_enter(&engine->items.lock);
+    std::mutex& lock = item_get_lock(engine, &hkey);
+    lock.lock();
     it = do_item_alloc(engine, &hkey, flags, exptime, nbytes, cookie, datatype);
-    cb_mutex_exit(&engine->items.lock);
+    lock.unlock();
     hash_key_destroy(&hkey);
     return it;
 }
@@ -736,37 +866,73 @@ hash_item* item_get(struct default_engine* engine,
     if (!hash_key_create(&hkey, key, nkey, engine, cookie)) {
         return NULL;
     }
-    cb_mutex_enter(&engine->items.lock);
+    std::mutex& lock = item_get_lock(engine, &hkey);
+    lock.lock();
     it = do_item_get(engine, &hkey, document_state);
-    cb_mutex_exit(&engine->items.lock);
+    lock.unlock();
     hash_key_destroy(&hkey);
     return it;
 }
 
+void item_get_multi(struct default_engine* engine,
+                    const void* cookie,
+                    size_t count,
+                    const void* const* keys,
+                    const size_t* nkeys,
+                    DocStateFilter document_state,
+                    hash_item** items) {
+    // hash_key points into itself, so size the vector up front and never
+    // let it reallocate once the keys are created.
+    std::vector<hash_key> hkeys(count);
+    std::vector<bool> created(count);
+    for (size_t ii = 0; ii < count; ++ii) {
+        created[ii] =
+                hash_key_create(&hkeys[ii], keys[ii], nkeys[ii], engine, cookie);
+    }
+
+    for (size_t ii = 0; ii < count; ++ii) {
+        if (created[ii]) {
+            std::lock_guard<std::mutex> guard(item_get_lock(engine, &hkeys[ii]));
+            items[ii] = do_item_get(engine, &hkeys[ii], document_state);
+        } else {
+            items[ii] = NULL;
+        }
+    }
+
+    for (size_t ii = 0; ii < count; ++ii) {
+        if (created[ii]) {
+            hash_key_destroy(&hkeys[ii]);
+        }
+    }
+}
+
 /*
  * Decrements the reference count on an item and adds it to the freelist if
  * needed.
  */
 void item_release(struct default_engine *engine, hash_item *item) {
-    cb_mutex_enter(&engine->items.lock);
+    std::mutex& lock = item_get_lock(engine, item_get_key(item));
+    lock.lock();
     do_item_release(engine, item);
-    cb_mutex_exit(&engine->items.lock);
+    lock.unlock();
 }
 
 /*
  * Unlinks an item from the LRU and hashtable.
  */
 void item_unlink(struct default_engine *engine, hash_item *item) {
-    cb_mutex_enter(&engine->items.lock);
+    std::mutex& lock = item_get_lock(engine, item_get_key(item));
+    lock.lock();
     do_item_unlink(engine, item);
-    cb_mutex_exit(&engine->items.lock);
+    lock.unlock();
 }
 
 ENGINE_ERROR_CODE safe_item_unlink(struct default_engine *engine,
                                    hash_item *it) {
-    cb_mutex_enter(&engine->items.lock);
+    std::mutex& lock = item_get_lock(engine, item_get_key(it));
+    lock.lock();
     auto ret = do_safe_item_unlink(engine, it);
-    cb_mutex_exit(&engine->items.lock);
+    lock.unlock();
     return ret;
 }
 
@@ -785,12 +951,13 @@ ENGINE_ERROR_CODE store_item(struct default_engine *engine,
         item->iflag |= ITEM_ZOMBIE;
     }
 
-    cb_mutex_enter(&engine->items.lock);
+    std::mutex& lock = item_get_lock(engine, item_get_key(item));
+    lock.lock();
     ret = do_store_item(engine, item, operation, cookie, &stored_item);
     if (ret == ENGINE_SUCCESS) {
         *cas = stored_item->cas;
     }
-    cb_mutex_exit(&engine->items.lock);
+    lock.unlock();
     return ret;
 }
 
@@ -901,10 +1068,11 @@ ENGINE_ERROR_CODE item_get_locked(struct default_engine* engine,
         return ENGINE_TMPFAIL;
     }
 
-    cb_mutex_enter(&engine->items.lock);
+    std::mutex& lock = item_get_lock(engine, &hkey);
+    lock.lock();
     ENGINE_ERROR_CODE ret = do_item_get_locked(engine, cookie, it, &hkey,
                                                locktime);
-    cb_mutex_exit(&engine->items.lock);
+    lock.unlock();
     hash_key_destroy(&hkey);
 
     return ret;
@@ -961,9 +1129,10 @@ ENGINE_ERROR_CODE item_unlock(struct default_engine* engine,
         return ENGINE_TMPFAIL;
     }
 
-    cb_mutex_enter(&engine->items.lock);
+    std::mutex& lock = item_get_lock(engine, &hkey);
+    lock.lock();
     ENGINE_ERROR_CODE ret = do_item_unlock(engine, cookie, &hkey, cas);
-    cb_mutex_exit(&engine->items.lock);
+    lock.unlock();
     hash_key_destroy(&hkey);
 
     return ret;
@@ -1037,10 +1206,11 @@ ENGINE_ERROR_CODE item_get_and_touch(struct default_engine* engine,
         return ENGINE_TMPFAIL;
     }
 
-    cb_mutex_enter(&engine->items.lock);
+    std::mutex& lock = item_get_lock(engine, &hkey);
+    lock.lock();
     ENGINE_ERROR_CODE ret = do_item_get_and_touch(engine, cookie, it, &hkey,
                                                   exptime);
-    cb_mutex_exit(&engine->items.lock);
+    lock.unlock();
     hash_key_destroy(&hkey);
 
     return ret;
@@ -1050,12 +1220,11 @@ ENGINE_ERROR_CODE item_get_and_touch(struct default_engine* engine,
  * Flushes expired items after a flush_all call
  */
 void item_flush_expired(struct default_engine *engine) {
-    cb_mutex_enter(&engine->items.lock);
-
     rel_time_t now = engine->server.core->get_current_time();
     if (now > engine->config.oldest_live) {
         engine->config.oldest_live = now - 1;
     }
+    const rel_time_t oldest_live = engine->config.oldest_live;
 
     for (int ii = 0; ii < POWER_LARGEST; ii++) {
         hash_item *iter, *next;
@@ -1064,38 +1233,41 @@ void item_flush_expired(struct default_engine *engine) {
          * timestamp is never newer than its last access time, so we
          * only need to walk back until we hit an item older than the
          * oldest_live time.
-         * The oldest_live checking will auto-expire the remaining items.
+         * The oldest_live checking will auto-expire the remaining items
+         * (including any we skip here as their item lock is busy).
          */
+        cb_mutex_enter(&engine->items.lru_locks[ii]);
         for (iter = engine->items.heads[ii]; iter != NULL; iter = next) {
-            if (iter->time >= engine->config.oldest_live) {
+            if (iter->time >= oldest_live) {
                 next = iter->next;
-                if ((iter->iflag & ITEM_SLABBED) == 0) {
-                    do_item_unlink(engine, iter);
+                std::mutex* lock;
+                if (!item_is_cursor(iter) &&
+                    (lock = item_trylock(engine, iter, NULL)) != NULL) {
+                    if ((iter->iflag & ITEM_SLABBED) == 0) {
+                        do_item_unlink_lru_held(engine, iter);
+                    }
+                    lock->unlock();
                 }
             } else {
                 /* We've hit the first old item. Continue to the next queue. */
                 break;
             }
         }
+        cb_mutex_exit(&engine->items.lru_locks[ii]);
     }
-    cb_mutex_exit(&engine->items.lock);
 }
 
 void item_stats(struct default_engine *engine,
                    ADD_STAT add_stat, const void *cookie)
 {
-    cb_mutex_enter(&engine->items.lock);
     do_item_stats(engine, add_stat, cookie);
-    cb_mutex_exit(&engine->items.lock);
 }
 
 
 void item_stats_sizes(struct default_engine *engine,
                       ADD_STAT add_stat, const void *cookie)
 {
-    cb_mutex_enter(&engine->items.lock);
     do_item_stats_sizes(engine, add_stat, cookie);
-    cb_mutex_exit(&engine->items.lock);
 }
 
 static void do_item_link_cursor(struct default_engine *engine,
@@ -1112,6 +1284,13 @@ static void do_item_link_cursor(struct default_engine *engine,
 typedef ENGINE_ERROR_CODE (*ITERFUNC)(struct default_engine *engine,
                                       hash_item *item, void *cookie);
 
+/*
+ * Move the cursor towards the head of its LRU, calling itemfunc for each
+ * item it passes with the item's item lock held. The caller holds the LRU
+ * lock. Returns true if there is more to walk; which is also the case if
+ * we stopped early as an item lock was busy, so the caller should drop the
+ * LRU lock (to let the holder of the item lock make progress) and retry.
+ */
 static bool do_item_walk_cursor(struct default_engine *engine,
                                 hash_item *cursor,
                                 int steplength,
@@ -1123,10 +1302,16 @@ static bool do_item_walk_cursor(struct default_engine *engine,
     *error = ENGINE_SUCCESS;
 
     while (cursor->prev != NULL && ii < steplength) {
-        /* Move cursor */
         hash_item *ptr = cursor->prev;
         bool done = false;
+        std::mutex* lock = NULL;
 
+        if (!item_is_cursor(ptr) &&
+            (lock = item_trylock(engine, ptr, NULL)) == NULL) {
+            return true;
+        }
+
+        /* Move cursor */
         ++ii;
         item_unlink_q(engine, cursor);
 
@@ -1141,10 +1326,11 @@ static bool do_item_walk_cursor(struct default_engine *engine,
         }
 
         /* Ignore cursors */
-        if (item_get_key(ptr)->header.len == 0 && ptr->nbytes == 0) {
+        if (lock == NULL) {
             --ii;
         } else {
             *error = itemfunc(engine, ptr, itemdata);
+            lock->unlock();
             if (*error != ENGINE_SUCCESS) {
                 return false;
             }
@@ -1181,7 +1367,7 @@ static ENGINE_ERROR_CODE item_scrub(struct default_engine *engine,
 
     if (engine->scrubber.force_delete || (item->refcount == 0 &&
        (item->exptime != 0 && item->exptime < current_time))) {
-        do_item_unlink(engine, item);
+        do_item_unlink_lru_held(engine, item);
         engine->scrubber.cleaned++;
     }
     return ENGINE_SUCCESS;
@@ -1192,10 +1378,11 @@ static void item_scrub_class(struct default_engine *engine,
 
     ENGINE_ERROR_CODE ret;
     bool more;
+    const unsigned int id = cursor->slabs_clsid;
     do {
-        cb_mutex_enter(&engine->items.lock);
+        cb_mutex_enter(&engine->items.lru_locks[id]);
         more = do_item_walk_cursor(engine, cursor, 200, item_scrub, NULL, &ret);
-        cb_mutex_exit(&engine->items.lock);
+        cb_mutex_exit(&engine->items.lru_locks[id]);
         if (ret != ENGINE_SUCCESS) {
             break;
         }
@@ -1211,14 +1398,14 @@ void item_scrubber_main(struct default_engine *engine)
     cursor.refcount = 1;
     for (ii = 0; ii < POWER_LARGEST; ++ii) {
         bool skip = false;
-        cb_mutex_enter(&engine->items.lock);
+        cb_mutex_enter(&engine->items.lru_locks[ii]);
         if (engine->items.heads[ii] == NULL) {
             skip = true;
         } else {
             /* add the item at the tail */
             do_item_link_cursor(engine, &cursor, ii);
         }
-        cb_mutex_exit(&engine->items.lock);
+        cb_mutex_exit(&engine->items.lru_locks[ii]);
 
         if (!skip) {
             item_scrub_class(engine, &cursor);
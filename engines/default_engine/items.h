@@ -155,9 +155,11 @@ struct items {
    itemstats_t itemstats[POWER_LARGEST];
    unsigned int sizes[POWER_LARGEST];
    /*
-    * serialise access to the items data
+    * serialise access to the LRU of each slab class (heads, tails, sizes
+    * and itemstats, and the next/prev links of the items on it). Taken
+    * after the item lock of any item being modified.
    */
-   cb_mutex_t lock;
+   cb_mutex_t lru_locks[POWER_LARGEST];
 };
 
 
@@ -192,6 +194,27 @@ hash_item* item_get(struct default_engine* engine,
                     const size_t nkey,
                     const DocStateFilter state);
 
+/**
+ * Get a batch of items from the cache. Equivalent to calling item_get()
+ * for each key, but only builds the hash keys once.
+ *
+ * @param engine handle to the storage engine
+ * @param cookie connection cookie
+ * @param count the number of keys
+ * @param keys the keys for the items to get
+ * @param nkeys the number of bytes in each of the keys
+ * @param state Only return documents in this state
+ * @param items where to store the items (NULL for each key which
+ *              doesn't exist)
+ */
+void item_get_multi(struct default_engine* engine,
+                    const void* cookie,
+                    size_t count,
+                    const void* const* keys,
+                    const size_t* nkeys,
+                    const DocStateFilter state,
+                    hash_item** items);
+
 /**
  * Get an item from the cache and acquire the lock.
  *
@@ -22,66 +22,9 @@
 #include <programs/engine_testapp/mock_server.h>
 #include "benchmark_memory_tracker.h"
 #include "dcp/dcpconnmap.h"
+#include "engine_fixture.h"
 #include "ep_time.h"
 
-class EngineFixture : public benchmark::Fixture {
-protected:
-    void SetUp(const benchmark::State& state) override {
-        SingleThreadedExecutorPool::replaceExecutorPoolWithFake();
-        executorPool = reinterpret_cast<SingleThreadedExecutorPool*>(
-                ExecutorPool::get());
-        memoryTracker = BenchmarkMemoryTracker::getInstance(
-                *get_mock_server_api()->alloc_hooks);
-        memoryTracker->reset();
-        std::string config = "dbname=benchmarks-test;ht_locks=47;" + varConfig;
-
-        engine.reset(new SynchronousEPEngine(config));
-        ObjectRegistry::onSwitchThread(engine.get());
-
-        engine->setKVBucket(
-                engine->public_makeBucket(engine->getConfiguration()));
-
-        engine->public_initializeEngineCallbacks();
-        initialize_time_functions(get_mock_server_api()->core);
-        cookie = create_mock_cookie();
-    }
-
-    void TearDown(const benchmark::State& state) override {
-        executorPool->cancelAndClearAll();
-        destroy_mock_cookie(cookie);
-        destroy_mock_event_callbacks();
-        engine->getDcpConnMap().manageConnections();
-        engine.reset();
-        ObjectRegistry::onSwitchThread(nullptr);
-        ExecutorPool::shutdown();
-        memoryTracker->destroyInstance();
-    }
-
-    Item make_item(uint16_t vbid,
-                   const std::string& key,
-                   const std::string& value) {
-        uint8_t ext_meta[EXT_META_LEN] = {PROTOCOL_BINARY_DATATYPE_JSON};
-        Item item({key, DocNamespace::DefaultCollection},
-                  /*flags*/ 0,
-                  /*exp*/ 0,
-                  value.c_str(),
-                  value.size(),
-                  ext_meta,
-                  sizeof(ext_meta));
-        item.setVBucketId(vbid);
-        return item;
-    }
-
-    std::unique_ptr<SynchronousEPEngine> engine;
-    const void* cookie = nullptr;
-    const int vbid = 0;
-
-    // Allows subclasses to add stuff to the config
-    std::string varConfig;
-    BenchmarkMemoryTracker* memoryTracker;
-    SingleThreadedExecutorPool* executorPool;
-};
-
 class AccessLogBenchEngine : public EngineFixture {
 protected:
     void SetUp(const benchmark::State& state) override {
@@ -0,0 +1,105 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "bloomfilter.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <benchmark/benchmark.h>
+#include <platform/make_unique.h>
+
+#include <vector>
+
+/*
+ * Measures BloomFilter insert and lookup throughput.
+ * Variables:
+ *  - range(0) : The number of keys the filter is sized for (and populated
+ *               with by the lookup benchmarks).
+ */
+class BloomFilterBench : public benchmark::Fixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        keyCount = state.range(0);
+        // Keys are created up front so key construction isn't measured.
+        for (size_t i = 0; i < keyCount; ++i) {
+            keys.push_back(makeStoredDocKey("key_" + std::to_string(i)));
+            missKeys.push_back(makeStoredDocKey("miss_" + std::to_string(i)));
+        }
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        keys.clear();
+        missKeys.clear();
+    }
+
+    std::unique_ptr<BloomFilter> makeFilter() {
+        return std::make_unique<BloomFilter>(
+                keyCount, 0.01, BFILTER_ENABLED);
+    }
+
+    size_t keyCount;
+    std::vector<StoredDocKey> keys;
+    std::vector<StoredDocKey> missKeys;
+};
+
+BENCHMARK_DEFINE_F(BloomFilterBench, Insert)(benchmark::State& state) {
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        auto filter = makeFilter();
+        state.ResumeTiming();
+        for (const auto& key : keys) {
+            filter->addKey(key);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * keyCount);
+}
+
+BENCHMARK_DEFINE_F(BloomFilterBench, LookupHit)(benchmark::State& state) {
+    auto filter = makeFilter();
+    for (const auto& key : keys) {
+        filter->addKey(key);
+    }
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(
+                filter->maybeKeyExists(keys[i++ % keyCount]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_DEFINE_F(BloomFilterBench, LookupMiss)(benchmark::State& state) {
+    auto filter = makeFilter();
+    for (const auto& key : keys) {
+        filter->addKey(key);
+    }
+    size_t i = 0;
+    size_t falsePositives = 0;
+    while (state.KeepRunning()) {
+        falsePositives += filter->maybeKeyExists(missKeys[i++ % keyCount]);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["fp_rate"] = double(falsePositives) / state.iterations();
+}
+
+BENCHMARK_REGISTER_F(BloomFilterBench, Insert)
+        ->Arg(10000)
+        ->Arg(1000000);
+BENCHMARK_REGISTER_F(BloomFilterBench, LookupHit)
+        ->Arg(10000)
+        ->Arg(1000000);
+BENCHMARK_REGISTER_F(BloomFilterBench, LookupMiss)
+        ->Arg(10000)
+        ->Arg(1000000);
@@ -0,0 +1,166 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "hash_table.h"
+#include "item.h"
+#include "stats.h"
+#include "stored_value_factories.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <benchmark/benchmark.h>
+#include <platform/make_unique.h>
+
+#include <random>
+
+/*
+ * Compares the Chained and Tagged HashTable layouts.
+ * Variables:
+ *  - range(0) : HashTable::Layout (0: Chained, 1: Tagged)
+ *  - range(1) : The number of items to populate the HashTable with
+ */
+class HashTableBench : public benchmark::Fixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        const auto layout = state.range(0) == 0 ? HashTable::Layout::Chained
+                                                : HashTable::Layout::Tagged;
+        numItems = state.range(1);
+        ht = std::make_unique<HashTable>(
+                stats,
+                std::make_unique<StoredValueFactory>(stats),
+                47,
+                47,
+                layout);
+        for (size_t i = 0; i < numItems; ++i) {
+            Item item(makeKey(i), 0, 0, "v", 1);
+            ht->set(item);
+        }
+        // Size the table as the HashtableResizerTask would.
+        ht->resize();
+
+        // Lookups use a random sample of the stored keys, created up front
+        // so key construction isn't measured.
+        std::mt19937_64 gen(numItems);
+        std::uniform_int_distribution<size_t> dist(0, numItems - 1);
+        for (size_t i = 0; i < sampleSize; ++i) {
+            hitKeys.push_back(makeKey(dist(gen)));
+            missKeys.push_back(makeKey(numItems + i));
+        }
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        hitKeys.clear();
+        missKeys.clear();
+        ht.reset();
+    }
+
+    static StoredDocKey makeKey(size_t i) {
+        return makeStoredDocKey("key_" + std::to_string(i));
+    }
+
+    void setLabel(benchmark::State& state) {
+        state.SetLabel(ht->getLayout() == HashTable::Layout::Chained
+                               ? "Chained"
+                               : "Tagged");
+    }
+
+    const size_t sampleSize = 100000;
+    size_t numItems;
+    EPStats stats;
+    std::unique_ptr<HashTable> ht;
+    std::vector<StoredDocKey> hitKeys;
+    std::vector<StoredDocKey> missKeys;
+};
+
+BENCHMARK_DEFINE_F(HashTableBench, FindHit)(benchmark::State& state) {
+    setLabel(state);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(ht->find(hitKeys[i++ % sampleSize],
+                                          TrackReference::No,
+                                          WantsDeleted::No));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_DEFINE_F(HashTableBench, FindMiss)(benchmark::State& state) {
+    setLabel(state);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(ht->find(missKeys[i++ % sampleSize],
+                                          TrackReference::No,
+                                          WantsDeleted::No));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Each iteration inserts (and, untimed, deletes again) sampleSize new keys.
+BENCHMARK_DEFINE_F(HashTableBench, InsertDelete)(benchmark::State& state) {
+    setLabel(state);
+    std::vector<Item> items;
+    for (const auto& key : missKeys) {
+        items.emplace_back(key, 0, 0, "v", 1);
+    }
+
+    while (state.KeepRunning()) {
+        for (auto& item : items) {
+            ht->set(item);
+        }
+        state.PauseTiming();
+        for (const auto& key : missKeys) {
+            auto hbl = ht->getLockedBucket(key);
+            ht->unlocked_del(hbl, key);
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * sampleSize);
+}
+
+// Each iteration deletes (and, untimed, re-inserts) sampleSize existing keys.
+BENCHMARK_DEFINE_F(HashTableBench, Delete)(benchmark::State& state) {
+    setLabel(state);
+    std::vector<Item> items;
+    for (size_t i = 0; i < sampleSize; ++i) {
+        items.emplace_back(makeKey(i), 0, 0, "v", 1);
+    }
+
+    while (state.KeepRunning()) {
+        for (const auto& item : items) {
+            auto hbl = ht->getLockedBucket(item.getKey());
+            ht->unlocked_del(hbl, item.getKey());
+        }
+        state.PauseTiming();
+        for (auto& item : items) {
+            ht->set(item);
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * sampleSize);
+}
+
+static void HashTableArguments(benchmark::internal::Benchmark* b) {
+    for (int layout : {0, 1}) {
+        for (int items : {1000000, 10000000, 100000000}) {
+            b->Args({layout, items});
+        }
+    }
+}
+
+BENCHMARK_REGISTER_F(HashTableBench, FindHit)->Apply(HashTableArguments);
+BENCHMARK_REGISTER_F(HashTableBench, FindMiss)->Apply(HashTableArguments);
+BENCHMARK_REGISTER_F(HashTableBench, InsertDelete)
+        ->Apply(HashTableArguments);
+BENCHMARK_REGISTER_F(HashTableBench, Delete)->Apply(HashTableArguments);
@@ -0,0 +1,141 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "engine_fixture.h"
+#include "item_pager.h"
+#include "kv_bucket.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <random>
+
+/*
+ * Measures the cache hit ratio achieved by the item pager's eviction
+ * policies on a Zipfian (skewed) workload.
+ *
+ * An Ephemeral bucket is populated with numKeys documents, after which the
+ * watermarks are lowered so only about half of them fit in memory. Each
+ * iteration reads a batch of keys drawn from a Zipfian distribution; a read
+ * of a document the pager has evicted counts as a miss and the document is
+ * stored again (as a client would after fetching it from elsewhere).
+ * Whenever memory usage exceeds the high watermark the item pager is run.
+ *
+ * The hit ratio is recorded in the "hit_ratio" counter, and the number of
+ * item pager runs in "pager_runs".
+ *
+ * Variables:
+ *  - range(0) : ht_eviction_policy (0: 2-bit_nru, 1: frequency)
+ */
+class ItemPagerBench : public EngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        varConfig = "bucket_type=ephemeral;ht_eviction_policy=";
+        varConfig += state.range(0) == 0 ? "2-bit_nru" : "frequency";
+        EngineFixture::SetUp(state);
+
+        engine->getKVBucket()->setVBucketState(
+                vbid, vbucket_state_active, false);
+        for (size_t i = 0; i < numKeys; ++i) {
+            store(i);
+        }
+
+        // Only leave room for about half of the documents.
+        auto& stats = engine->getEpStats();
+        const size_t used = stats.getTotalMemoryUsed();
+        stats.mem_high_wat.store(used / 2);
+        stats.mem_low_wat.store(used * 2 / 5);
+
+        pagerRuns = 0;
+        pager = std::make_shared<ItemPager>(engine.get(), stats);
+        ExecutorPool::get()->schedule(pager);
+
+        // Zipf(s = 1) distribution over the keys.
+        std::vector<double> weights;
+        for (size_t i = 1; i <= numKeys; ++i) {
+            weights.push_back(1.0 / i);
+        }
+        distribution = std::discrete_distribution<size_t>(weights.begin(),
+                                                          weights.end());
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        pager.reset();
+        EngineFixture::TearDown(state);
+    }
+
+    void store(size_t i) {
+        auto item = make_item(vbid, "key_" + std::to_string(i), value);
+        engine->getKVBucket()->set(item, cookie);
+    }
+
+    bool get(size_t i) {
+        auto key = makeStoredDocKey("key_" + std::to_string(i));
+        auto result = engine->getKVBucket()->get(
+                key, vbid, cookie, get_options_t(TRACK_REFERENCE));
+        return result.getStatus() == ENGINE_SUCCESS;
+    }
+
+    void runTask(const std::string& name) {
+        CheckedExecutor executor(executorPool,
+                                 *executorPool->getLpTaskQ()[NONIO_TASK_IDX]);
+        executor.runCurrentTask(name);
+        executor.completeCurrentTask();
+    }
+
+    void runPagerIfNeeded() {
+        auto& stats = engine->getEpStats();
+        if (stats.getTotalMemoryUsed() <= stats.mem_high_wat.load()) {
+            return;
+        }
+        executorPool->wake(pager->getId());
+        runTask("Paging out items.");
+        runTask("Item pager on vb 0");
+        ++pagerRuns;
+    }
+
+    const size_t numKeys = 10000;
+    const size_t batchSize = 1000;
+    const std::string value = std::string(256, 'x');
+    std::shared_ptr<ItemPager> pager;
+    std::discrete_distribution<size_t> distribution;
+    size_t pagerRuns = 0;
+};
+
+BENCHMARK_DEFINE_F(ItemPagerBench, ZipfianHitRatio)(benchmark::State& state) {
+    state.SetLabel(state.range(0) == 0 ? "2-bit_nru" : "frequency");
+    std::mt19937_64 gen(numKeys);
+    size_t hits = 0;
+    size_t reads = 0;
+    while (state.KeepRunning()) {
+        for (size_t ii = 0; ii < batchSize; ++ii) {
+            const size_t key = distribution(gen);
+            if (get(key)) {
+                ++hits;
+            } else {
+                store(key);
+            }
+            ++reads;
+        }
+        runPagerIfNeeded();
+    }
+    state.counters["hit_ratio"] = double(hits) / reads;
+    state.counters["pager_runs"] = pagerRuns;
+}
+
+BENCHMARK_REGISTER_F(ItemPagerBench, ZipfianHitRatio)
+        ->Arg(0)
+        ->Arg(1)
+        ->Iterations(200);
@@ -125,6 +125,30 @@ public:
     RCValue() : _rc_refcount(0) {}
     RCValue(const RCValue &) : _rc_refcount(0) {}
     ~RCValue() {}
+
+    /**
+     * Take a reference to the value on behalf of a raw pointer handed out
+     * to code which doesn't know about reference counting (e.g. an item
+     * given to the core). Must be balanced by a call to releaseRawRef().
+     */
+    void acquireRawRef() const {
+        _rc_incref();
+    }
+
+    /**
+     * Drop a reference taken by acquireRawRef().
+     *
+     * @return true if the caller should now delete the value; either that
+     *         was the last reference, or the value was never reference
+     *         counted at all.
+     */
+    bool releaseRawRef() const {
+        if (_rc_refcount.load() == 0) {
+            return true;
+        }
+        return _rc_decref() == 0;
+    }
+
 private:
     template <class MyTT> friend class RCPtr;
     template <class MySS> friend class SingleThreadedRCPtr;
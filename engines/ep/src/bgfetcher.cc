@@ -50,8 +50,8 @@ void BgFetcher::stop() {
     ExecutorPool::get()->cancel(taskId);
 }
 
-void BgFetcher::notifyBGEvent(void) {
-    ++stats.numRemainingBgItems;
+void BgFetcher::notifyBGEvent(size_t items) {
+    stats.numRemainingBgItems.fetch_add(items);
     bool inverse = false;
     if (pendingFetch.compare_exchange_strong(inverse, true)) {
         ExecutorPool::get()->wake(taskId);
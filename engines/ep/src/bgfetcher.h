@@ -76,7 +76,12 @@ public:
     void stop(void);
     bool run(GlobalTask *task);
     bool pendingJob(void) const;
-    void notifyBGEvent(void);
+    /**
+     * Wake the fetcher for newly queued fetches.
+     *
+     * @param items the number of fetches queued
+     */
+    void notifyBGEvent(size_t items = 1);
     void setTaskId(size_t newId) { taskId = newId; }
     void addPendingVB(VBucket::id_type vbId) {
         LockHolder lh(queueMutex);
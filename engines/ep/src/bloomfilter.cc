@@ -21,6 +21,7 @@
 
 #include "murmurhash3.h"
 
+#include <algorithm>
 #include <cmath>
 
 #if __x86_64__ || __ppc64__
@@ -34,14 +35,29 @@ BloomFilter::BloomFilter(size_t key_count, double false_positive_prob,
 
     status = new_status;
     filterSize = estimateFilterSize(key_count, false_positive_prob);
-    noOfHashes = estimateNoOfHashes(key_count);
+    noOfHashes = std::max(size_t(1), estimateNoOfHashes(key_count));
     keyCounter = 0;
-    bitArray.assign(filterSize, false);
+
+    // Round the filter up to a whole number of blocks.
+    numBlocks = std::max(size_t(1), (filterSize + BlockBits - 1) / BlockBits);
+    filterSize = numBlocks * BlockBits;
+
+    // Zero-initialised, with room to align the first block to a cache line.
+    const size_t alignment = sizeof(Block);
+    storage.reset(new uint8_t[numBlocks * sizeof(Block) + alignment - 1]());
+    const auto addr = reinterpret_cast<uintptr_t>(storage.get());
+    blocks = reinterpret_cast<Block*>((addr + alignment - 1) &
+                                      ~(uintptr_t(alignment) - 1));
 }
 
 BloomFilter::~BloomFilter() {
     status = BFILTER_DISABLED;
-    bitArray.clear();
+    freeBlocks();
+}
+
+void BloomFilter::freeBlocks() {
+    blocks = nullptr;
+    storage.reset();
 }
 
 size_t BloomFilter::estimateFilterSize(size_t key_count,
@@ -54,11 +70,27 @@ size_t BloomFilter::estimateNoOfHashes(size_t key_count) {
     return round(((double) filterSize / key_count) * (log(2.0)));
 }
 
-uint64_t BloomFilter::hashDocKey(const DocKey& key, uint32_t iteration) {
+BloomFilter::Probe BloomFilter::hashDocKey(const DocKey& key) const {
     uint64_t result = 0;
-    uint32_t seed = iteration + (uint32_t(key.getDocNamespace()) * noOfHashes);
-    MURMURHASH_3(key.data(), key.size(), seed, &result);
-    return result;
+    MURMURHASH_3(key.data(),
+                 key.size(),
+                 uint32_t(key.getDocNamespace()),
+                 &result);
+
+    Probe probe;
+    probe.block = (result >> 32) % numBlocks;
+    probe.mask.fill(0);
+
+    // Derive the bit positions within the block by double hashing the low
+    // half of the hash. delta is odd and BlockBits a power of two, so the
+    // positions are distinct for up to BlockBits hashes.
+    const uint32_t h = uint32_t(result);
+    const uint32_t delta = (h >> 16) | 1;
+    for (uint32_t i = 0; i < noOfHashes; i++) {
+        const size_t bit = (h + i * delta) % BlockBits;
+        probe.mask[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+    return probe;
 }
 
 void BloomFilter::setStatus(bfilter_status_t to) {
@@ -71,7 +103,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_PENDING:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                freeBlocks();
             } else if (to == BFILTER_COMPACTING) {
                 status = to;
             }
@@ -79,7 +111,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_COMPACTING:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                freeBlocks();
             } else if (to == BFILTER_ENABLED) {
                 status = to;
             }
@@ -87,7 +119,7 @@ void BloomFilter::setStatus(bfilter_status_t to) {
         case BFILTER_ENABLED:
             if (to == BFILTER_DISABLED) {
                 status = to;
-                bitArray.clear();
+                freeBlocks();
             } else if (to == BFILTER_COMPACTING) {
                 status = to;
             }
@@ -114,14 +146,14 @@ std::string BloomFilter::getStatusString() {
 }
 
 void BloomFilter::addKey(const DocKey& key) {
-    if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
+    if ((status == BFILTER_COMPACTING || status == BFILTER_ENABLED) &&
+        blocks) {
+        const auto probe = hashDocKey(key);
+        Block& block = blocks[probe.block];
         bool overlap = true;
-        for (uint32_t i = 0; i < noOfHashes; i++) {
-            uint64_t result = hashDocKey(key, i);
-            if (overlap && bitArray[result % filterSize] == 0) {
-                overlap = false;
-            }
-            bitArray[result % filterSize] = 1;
+        for (size_t w = 0; w < WordsPerBlock; w++) {
+            overlap &= (block[w] & probe.mask[w]) == probe.mask[w];
+            block[w] |= probe.mask[w];
         }
         if (!overlap) {
             keyCounter++;
@@ -130,13 +162,19 @@ void BloomFilter::addKey(const DocKey& key) {
 }
 
 bool BloomFilter::maybeKeyExists(const DocKey& key) {
-    if (status == BFILTER_COMPACTING || status == BFILTER_ENABLED) {
-        for (uint32_t i = 0; i < noOfHashes; i++) {
-            uint64_t result = hashDocKey(key, i);
-            if (bitArray[result % filterSize] == 0) {
-                // The key does NOT exist.
-                return false;
-            }
+    if ((status == BFILTER_COMPACTING || status == BFILTER_ENABLED) &&
+        blocks) {
+        const auto probe = hashDocKey(key);
+        const Block& block = blocks[probe.block];
+        // Test every word of the block without branching, so the compiler
+        // can vectorise the loop.
+        uint64_t missing = 0;
+        for (size_t w = 0; w < WordsPerBlock; w++) {
+            missing |= probe.mask[w] & ~block[w];
+        }
+        if (missing != 0) {
+            // The key does NOT exist.
+            return false;
         }
     }
     // The key may exist.
@@ -20,8 +20,9 @@
 
 #include "config.h"
 
+#include <array>
+#include <memory>
 #include <string>
-#include <vector>
 
 #include <memcached/dockey.h>
 
@@ -37,6 +38,14 @@ enum bfilter_status_t {
  * We are to maintain the vbucket-number of these instances.
  *
  * Each vbucket will hold one such object.
+ *
+ * The filter is "blocked": the bit array is split into 64-byte (cache line)
+ * blocks, and all of the noOfHashes bits for a given key are set within a
+ * single block. A key is hashed once (64-bit MurmurHash3); the high half
+ * selects the block and the low half derives the bit positions within it.
+ * A lookup therefore costs one hash computation and one cache miss,
+ * regardless of the number of hash functions, at the cost of a slightly
+ * higher false positive rate than a classic bloom filter of the same size.
  */
 class BloomFilter {
 public:
@@ -55,10 +64,26 @@ public:
     size_t getFilterSize();
 
 protected:
+    /// Number of bits in each block (one cache line).
+    static const size_t BlockBits = 512;
+    static const size_t WordsPerBlock = BlockBits / 64;
+
+    using Block = std::array<uint64_t, WordsPerBlock>;
+
+    /// The block a key maps to, and the bits within that block to test/set.
+    struct Probe {
+        size_t block;
+        Block mask;
+    };
+
     size_t estimateFilterSize(size_t key_count, double false_positive_prob);
     size_t estimateNoOfHashes(size_t key_count);
 
-    uint64_t hashDocKey(const DocKey& key, uint32_t iteration);
+    /// Hash the given key (once) to the block and bits it occupies.
+    Probe hashDocKey(const DocKey& key) const;
+
+    /// Release the bit array (filter is no longer in use).
+    void freeBlocks();
 
     size_t filterSize;
     size_t noOfHashes;
@@ -66,7 +91,12 @@ protected:
     size_t keyCounter;
 
     bfilter_status_t status;
-    std::vector<bool> bitArray;
+
+    size_t numBlocks;
+    // Backing allocation for blocks; over-sized so that blocks can be aligned
+    // to a cache line.
+    std::unique_ptr<uint8_t[]> storage;
+    Block* blocks;
 };
 
 #endif // SRC_BLOOMFILTER_H_
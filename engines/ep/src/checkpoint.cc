@@ -301,6 +301,13 @@ const StoredDocKey Checkpoint::CheckpointStartKey("checkpoint_start", DocNamespa
 const StoredDocKey Checkpoint::CheckpointEndKey("checkpoint_end", DocNamespace::System);
 const StoredDocKey Checkpoint::SetVBucketStateKey("set_vbucket_state", DocNamespace::System);
 
+bool Checkpoint::containsItem(const Item& item) const {
+    const auto& index =
+            item.isCheckPointMetaItem() ? metaKeyIndex : keyIndex;
+    auto it = index.find(item.getKey());
+    return it != index.end() && it->second.position->get() == &item;
+}
+
 size_t Checkpoint::mergePrevCheckpoint(Checkpoint *pPrevCheckpoint) {
     size_t numNewItems = 0;
     size_t newEntryMemOverhead = 0;
@@ -344,7 +351,8 @@ size_t Checkpoint::mergePrevCheckpoint(Checkpoint *pPrevCheckpoint) {
                     ++numNewItems;
 
                     // Update new checkpoint's memory usage
-                    incrementMemConsumption((*rit)->size());
+                    incrementMemConsumption((*rit)->size() +
+                                            (*rit)->getCompressedValMemSize());
                 }
                 break;
 
@@ -382,7 +390,8 @@ size_t Checkpoint::mergePrevCheckpoint(Checkpoint *pPrevCheckpoint) {
                     ++numNewItems;
 
                     // Update new checkpoint's memory usage
-                    incrementMemConsumption((*rit)->size());
+                    incrementMemConsumption((*rit)->size() +
+                                            (*rit)->getCompressedValMemSize());
                 }
                 break;
         }
@@ -1921,6 +1930,17 @@ size_t CheckpointManager::getMemoryUsage() {
     return getMemoryUsage_UNLOCKED();
 }
 
+void CheckpointManager::notifyValueCompressed(const Item& item) {
+    const size_t bytes = item.getCompressedValMemSize();
+    LockHolder lh(queueLock);
+    for (auto* checkpoint : checkpointList) {
+        if (checkpoint->containsItem(item)) {
+            checkpoint->incrementMemConsumption(bytes);
+            return;
+        }
+    }
+}
+
 size_t CheckpointManager::getMemoryUsageOfUnrefCheckpoints() {
     LockHolder lh(queueLock);
 
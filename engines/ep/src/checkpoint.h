@@ -543,9 +543,16 @@ public:
         effectiveMemUsage += by;
     }
 
+    /**
+     * @return true if the given item (the very instance, not just an item
+     *         with the same key) is queued in this checkpoint
+     */
+    bool containsItem(const Item& item) const;
+
     /**
      * Returns the memory held by all the queued items which includes
-     * key, metadata and the blob.
+     * key, metadata and the blob (and any compressed copy of the blob
+     * cached for DCP).
      */
     size_t getMemConsumption() {
         return effectiveMemUsage;
@@ -795,6 +802,14 @@ public:
 
     size_t getMemoryUsage();
 
+    /**
+     * Account for the compressed value an item queued in one of the
+     * checkpoints has just cached (see Item::getCompressedValue()), as it
+     * lives as long as the item. Does nothing if the item isn't queued
+     * (e.g. it was read by a backfill, or has since been de-duplicated).
+     */
+    void notifyValueCompressed(const Item& item);
+
     /**
      * Return memory consumption of unreferenced checkpoints
      */
@@ -34,6 +34,7 @@
 #include <iostream>
 #include <list>
 #include <map>
+#include <unordered_map>
 #include <phosphor/phosphor.h>
 #include <platform/cb_malloc.h>
 #include <platform/checked_snprintf.h>
@@ -280,7 +281,8 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config,
                            FileOpsInterface& ops,
                            bool readOnly,
                            std::vector<std::atomic<uint64_t>>& dbFileRevMap,
-                           size_t fileRevMapSize)
+                           size_t fileRevMapSize,
+                           std::shared_ptr<CouchReadHandleCache> readHandleCache)
     : KVStore(config, readOnly),
       dbname(config.getDBName()),
       dbFileRevMap(dbFileRevMap),
@@ -288,7 +290,8 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config,
       intransaction(false),
       scanCounter(0),
       logger(config.getLogger()),
-      base_ops(ops) {
+      base_ops(ops),
+      readHandleCache(std::move(readHandleCache)) {
     createDataDir(dbname);
     statCollectingFileOps = getCouchstoreStatsOps(st.fsStats, base_ops);
     statCollectingFileOpsCompaction = getCouchstoreStatsOps(
@@ -314,7 +317,10 @@ CouchKVStore::CouchKVStore(KVStoreConfig& config, FileOpsInterface& ops)
                    ops,
                    false /*readonly*/,
                    fileRevMap,
-                   config.getMaxVBuckets()) {
+                   config.getMaxVBuckets(),
+                   std::make_shared<CouchReadHandleCache>(
+                           config.getReadHandleCacheSize(),
+                           config.getMaxVBuckets())) {
 }
 
 CouchKVStore::CouchKVStore(const CouchKVStore& copyFrom)
@@ -325,7 +331,8 @@ CouchKVStore::CouchKVStore(const CouchKVStore& copyFrom)
       numDbFiles(copyFrom.numDbFiles),
       intransaction(false),
       logger(copyFrom.logger),
-      base_ops(copyFrom.base_ops) {
+      base_ops(copyFrom.base_ops),
+      readHandleCache(copyFrom.readHandleCache) {
     // std::atomic needs to be manually copied (not copy constructor)
     for (size_t ii = 0; ii < fileRevMap.size(); ii++) {
         fileRevMap[ii].store(copyFrom.fileRevMap[ii].load());
@@ -342,16 +349,19 @@ CouchKVStore::CouchKVStore(const CouchKVStore& copyFrom)
 std::unique_ptr<CouchKVStore> CouchKVStore::makeReadOnlyStore() {
     // Not using make_unique due to the private constructor we're calling
     return std::unique_ptr<CouchKVStore>(
-            new CouchKVStore(configuration, fileRevMap));
+            new CouchKVStore(configuration, fileRevMap, readHandleCache));
 }
 
-CouchKVStore::CouchKVStore(KVStoreConfig& config,
-                           std::vector<std::atomic<uint64_t>>& dbFileRevMap)
+CouchKVStore::CouchKVStore(
+        KVStoreConfig& config,
+        std::vector<std::atomic<uint64_t>>& dbFileRevMap,
+        std::shared_ptr<CouchReadHandleCache> readHandleCache)
     : CouchKVStore(config,
                    *couchstore_get_default_file_ops(),
                    true /*readonly*/,
                    dbFileRevMap,
-                   0) {
+                   0,
+                   std::move(readHandleCache)) {
 }
 
 void CouchKVStore::initialize() {
@@ -392,6 +402,10 @@ void CouchKVStore::initialize() {
 CouchKVStore::~CouchKVStore() {
     close();
 
+    // Cached handles may have been opened by this instance (and close
+    // through it), so they can't outlive it.
+    readHandleCache->clear();
+
     for (std::vector<vbucket_state *>::iterator it = cachedVBStates.begin();
          it != cachedVBStates.end(); it++) {
         vbucket_state *vbstate = *it;
@@ -457,10 +471,8 @@ void CouchKVStore::set(const Item &itm, Callback<mutation_result> &cb) {
 }
 
 GetValue CouchKVStore::get(const DocKey& key, uint16_t vb, bool fetchDelete) {
-    Db *db = NULL;
-    uint64_t fileRev = dbFileRevMap[vb];
-    couchstore_error_t errCode = openDB(vb, fileRev, &db,
-                                        COUCHSTORE_OPEN_FLAG_RDONLY);
+    CouchReadHandleCache::Lease lease;
+    couchstore_error_t errCode = openReadOnlyDB(vb, lease);
     if (errCode != COUCHSTORE_SUCCESS) {
         ++st.numGetFailure;
         logger.log(EXTENSION_LOG_WARNING,
@@ -469,8 +481,13 @@ GetValue CouchKVStore::get(const DocKey& key, uint16_t vb, bool fetchDelete) {
         return GetValue(nullptr, couchErr2EngineErr(errCode));
     }
 
-    GetValue gv = getWithHeader(db, key, vb, GetMetaOnly::No, fetchDelete);
-    closeDatabaseHandle(db);
+    GetValue gv = getWithHeader(
+            lease.db.get(), key, vb, GetMetaOnly::No, fetchDelete);
+    // A missing key is a perfectly healthy read; anything else may have
+    // left the handle in a bad state.
+    releaseReadOnlyDB(std::move(lease),
+                      gv.getStatus() == ENGINE_SUCCESS ||
+                              gv.getStatus() == ENGINE_KEY_ENOENT);
     return gv;
 }
 
@@ -533,11 +550,8 @@ GetValue CouchKVStore::getWithHeader(void* dbHandle,
 
 void CouchKVStore::getMulti(uint16_t vb, vb_bgfetch_queue_t &itms) {
     int numItems = itms.size();
-    uint64_t fileRev = dbFileRevMap[vb];
-
-    Db *db = NULL;
-    couchstore_error_t errCode = openDB(vb, fileRev, &db,
-                                        COUCHSTORE_OPEN_FLAG_RDONLY);
+    CouchReadHandleCache::Lease lease;
+    couchstore_error_t errCode = openReadOnlyDB(vb, lease);
     if (errCode != COUCHSTORE_SUCCESS) {
         logger.log(EXTENSION_LOG_WARNING,
                    "CouchKVStore::getMulti: openDB error:%s, "
@@ -568,6 +582,7 @@ void CouchKVStore::getMulti(uint16_t vb, vb_bgfetch_queue_t &itms) {
 
     GetMultiCbCtx ctx(*this, vb, itms);
 
+    Db* db = lease.db.get();
     errCode = couchstore_docinfos_by_id(db, ids, itms.size(),
                                         0, getMultiCbC, &ctx);
     if (errCode != COUCHSTORE_SUCCESS) {
@@ -580,7 +595,7 @@ void CouchKVStore::getMulti(uint16_t vb, vb_bgfetch_queue_t &itms) {
             item.second.value.setStatus(couchErr2EngineErr(errCode));
         }
     }
-    closeDatabaseHandle(db);
+    releaseReadOnlyDB(std::move(lease), errCode == COUCHSTORE_SUCCESS);
     delete []ids;
 }
 
@@ -1068,6 +1083,7 @@ bool CouchKVStore::setVBucketState(uint16_t vbucketId,
 
         if (options == VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT) {
             errorCode = couchstore_commit(db);
+            readHandleCache->invalidate(vbucketId);
             if (errorCode != COUCHSTORE_SUCCESS) {
                 ++st.numVbSetFailure;
                 logger.log(EXTENSION_LOG_WARNING,
@@ -1143,7 +1159,8 @@ StorageProperties CouchKVStore::getStorageProperties() {
                          StorageProperties::EfficientVBDeletion::Yes,
                          StorageProperties::PersistedDeletion::Yes,
                          StorageProperties::EfficientGet::Yes,
-                         StorageProperties::ConcurrentWriteCompact::No);
+                         StorageProperties::ConcurrentWriteCompact::No,
+                         StorageProperties::GroupCommit::Yes);
     return rv;
 }
 
@@ -1482,6 +1499,38 @@ couchstore_error_t CouchKVStore::openDB(uint16_t vbucketId,
     return errorCode;
 }
 
+couchstore_error_t CouchKVStore::openReadOnlyDB(
+        uint16_t vbid, CouchReadHandleCache::Lease& lease) {
+    lease = readHandleCache->checkout(vbid, dbFileRevMap[vbid]);
+    if (lease.db) {
+        ++st.numReadHandleCacheHits;
+        return COUCHSTORE_SUCCESS;
+    }
+    ++st.numReadHandleCacheMisses;
+
+    Db* db = nullptr;
+    couchstore_error_t errCode =
+            openDB(vbid, lease.fileRev, &db, COUCHSTORE_OPEN_FLAG_RDONLY);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        return errCode;
+    }
+
+    ++st.numReadHandlesOpen;
+    lease.db = CouchReadHandleCache::Handle(db, [this](Db* db) {
+        closeDatabaseHandle(db);
+        --st.numReadHandlesOpen;
+    });
+    return COUCHSTORE_SUCCESS;
+}
+
+void CouchKVStore::releaseReadOnlyDB(CouchReadHandleCache::Lease lease,
+                                     bool reusable) {
+    if (reusable) {
+        readHandleCache->checkin(std::move(lease));
+    }
+    // Otherwise the handle is closed as the lease goes out of scope.
+}
+
 void CouchKVStore::populateFileNameMap(std::vector<std::string> &filenames,
                                        std::vector<uint16_t> *vbids) {
     std::vector<std::string>::iterator fileItr;
@@ -1781,58 +1830,68 @@ bool CouchKVStore::commit2couchstore(const Item* collectionsManifest) {
         return success;
     }
 
-    // Use the vbucket of the first item or the manifest item
-    uint16_t vbucket2flush = pendingCommitCnt
-                                     ? pendingReqsQ[0]->getVBucketId()
-                                     : collectionsManifest->getVBucketId();
-
-    // When an item and a manifest are present, vbucket2flush is read from the
-    // item. Check it matches the manifest
-    if (pendingCommitCnt && collectionsManifest &&
-        vbucket2flush != collectionsManifest->getVBucketId()) {
-        throw std::logic_error(
-                "CouchKVStore::commit2couchstore: manifest/item vbucket "
-                "mismatch vbucket2flush:" +
-                std::to_string(vbucket2flush) + " manifest vb:" +
-                std::to_string(collectionsManifest->getVBucketId()));
-    }
-
-    // Use the current fileRev, compaction can't change this until we're done
-    // flushing.
-    uint64_t fileRev = dbFileRevMap[vbucket2flush];
-
-    std::vector<Doc*> docs(pendingCommitCnt);
-    std::vector<DocInfo*> docinfos(pendingCommitCnt);
-
-    for (size_t i = 0; i < pendingCommitCnt; ++i) {
-        CouchRequest *req = pendingReqsQ[i];
-        docs[i] = (Doc *)req->getDbDoc();
-        docinfos[i] = req->getDbDocInfo();
-        if (vbucket2flush != req->getVBucketId()) {
-            throw std::logic_error(
-                    "CouchKVStore::commit2couchstore: "
-                    "mismatch between vbucket2flush (which is "
-                    + std::to_string(vbucket2flush) + ") and pendingReqsQ["
-                    + std::to_string(i) + "] (which is "
-                    + std::to_string(req->getVBucketId()) + ")");
+    // Split the transaction by vbucket (there's more than one when the
+    // flusher is group committing), preserving each vbucket's request order.
+    std::vector<std::unique_ptr<PendingVBCommit>> commits;
+    std::unordered_map<uint16_t, PendingVBCommit*> commitsByVb;
+    auto getCommit = [this, &commits, &commitsByVb](
+                             uint16_t vbid) -> PendingVBCommit& {
+        auto it = commitsByVb.find(vbid);
+        if (it != commitsByVb.end()) {
+            return *it->second;
+        }
+        // Use the current fileRev, compaction can't change this until we're
+        // done flushing.
+        commits.push_back(std::make_unique<PendingVBCommit>(
+                *this, vbid, dbFileRevMap[vbid]));
+        commitsByVb[vbid] = commits.back().get();
+        return *commits.back();
+    };
+
+    for (auto* req : pendingReqsQ) {
+        auto& commit = getCommit(req->getVBucketId());
+        commit.reqs.push_back(req);
+        commit.docs.push_back((Doc*)req->getDbDoc());
+        commit.docinfos.push_back(req->getDbDocInfo());
+    }
+    if (collectionsManifest) {
+        getCommit(collectionsManifest->getVBucketId()).collectionsManifest =
+                collectionsManifest;
+    }
+
+    // Write every vbucket before committing any of them, so that the
+    // commits (and their fsyncs) are issued back to back.
+    for (auto& commit : commits) {
+        commit->errCode = saveDocs(*commit);
+    }
+
+    size_t docsCommitted = 0;
+    for (auto& commit : commits) {
+        if (commit->errCode == COUCHSTORE_SUCCESS) {
+            commit->errCode = commitDocs(*commit);
+        }
+        if (commit->errCode == COUCHSTORE_SUCCESS) {
+            docsCommitted += commit->docs.size();
+        } else {
+            success = false;
+            logger.log(EXTENSION_LOG_WARNING,
+                       "CouchKVStore::commit2couchstore: saveDocs error:%s, "
+                       "vb:%" PRIu16 ", rev:%" PRIu64,
+                       couchstore_strerror(commit->errCode),
+                       commit->vbid,
+                       commit->fileRev);
         }
     }
-
-    kvstats_ctx kvctx(configuration);
-    kvctx.vbucket = vbucket2flush;
-    // flush all
-    couchstore_error_t errCode = saveDocs(
-            vbucket2flush, fileRev, docs, docinfos, kvctx, collectionsManifest);
-
-    if (errCode) {
-        success = false;
-        logger.log(EXTENSION_LOG_WARNING,
-                   "CouchKVStore::commit2couchstore: saveDocs error:%s, "
-                   "vb:%" PRIu16 ", rev:%" PRIu64, couchstore_strerror(errCode),
-                   vbucket2flush, fileRev);
+    if (success) {
+        st.docsCommitted = docsCommitted;
     }
 
-    commitCallback(pendingReqsQ, kvctx, errCode);
+    for (auto& commit : commits) {
+        if (Db* db = commit->db.releaseDb()) {
+            closeDatabaseHandle(db);
+        }
+        commitCallback(commit->reqs, commit->kvctx, commit->errCode);
+    }
 
     // clean up
     for (size_t i = 0; i < pendingCommitCnt; ++i) {
@@ -1862,129 +1921,129 @@ static int readDocInfos(Db *db, DocInfo *docinfo, void *ctx) {
     return 0;
 }
 
-couchstore_error_t CouchKVStore::saveDocs(uint16_t vbid,
-                                          uint64_t rev,
-                                          const std::vector<Doc*>& docs,
-                                          std::vector<DocInfo*>& docinfos,
-                                          kvstats_ctx& kvctx,
-                                          const Item* collectionsManifest) {
+couchstore_error_t CouchKVStore::saveDocs(PendingVBCommit& commit) {
     couchstore_error_t errCode;
-    uint64_t fileRev = rev;
-    DbInfo info;
-    if (rev == 0) {
+    const uint16_t vbid = commit.vbid;
+    const auto& docs = commit.docs;
+    auto& docinfos = commit.docinfos;
+    auto& kvctx = commit.kvctx;
+    if (commit.fileRev == 0) {
         throw std::invalid_argument(
                 "CouchKVStore::saveDocs: rev must be non-zero");
     }
 
-    DbHolder db(this);
-    errCode = openDB(
-            vbid, fileRev, db.getDbAddress(), COUCHSTORE_OPEN_FLAG_CREATE);
+    errCode = openDB(vbid,
+                     commit.fileRev,
+                     commit.db.getDbAddress(),
+                     COUCHSTORE_OPEN_FLAG_CREATE);
     if (errCode != COUCHSTORE_SUCCESS) {
         logger.log(EXTENSION_LOG_WARNING,
                    "CouchKVStore::saveDocs: openDB error:%s, vb:%" PRIu16
                    ", rev:%" PRIu64 ", numdocs:%" PRIu64,
                    couchstore_strerror(errCode),
                    vbid,
-                   fileRev,
+                   commit.fileRev,
                    uint64_t(docs.size()));
         return errCode;
-    } else {
-        vbucket_state *state = cachedVBStates[vbid];
-        if (state == nullptr) {
-            throw std::logic_error(
-                    "CouchKVStore::saveDocs: cachedVBStates[" +
-                    std::to_string(vbid) + "] is NULL");
-        }
+    }
 
-        uint64_t maxDBSeqno = 0;
-
-        // Only do a couchstore_save_documents if there are docs
-        if (docs.size() > 0) {
-            std::vector<sized_buf> ids(docs.size());
-            for (size_t idx = 0; idx < docs.size(); idx++) {
-                ids[idx] = docinfos[idx]->id;
-                maxDBSeqno = std::max(maxDBSeqno, docinfos[idx]->db_seq);
-                DocKey key = makeDocKey(
-                        ids[idx], configuration.shouldPersistDocNamespace());
-                kvctx.keyStats[key] =
-                        std::make_pair(false, !docinfos[idx]->deleted);
-            }
-            couchstore_docinfos_by_id(db.getDb(),
-                                      ids.data(),
-                                      (unsigned)ids.size(),
-                                      0,
-                                      readDocInfos,
-                                      &kvctx);
-
-            hrtime_t cs_begin = gethrtime();
-            uint64_t flags = COMPRESS_DOC_BODIES | COUCHSTORE_SEQUENCE_AS_IS;
-            errCode = couchstore_save_documents(db.getDb(),
-                                                docs.data(),
-                                                docinfos.data(),
-                                                (unsigned)docs.size(),
-                                                flags);
-            st.saveDocsHisto.add((gethrtime() - cs_begin) / 1000);
-            if (errCode != COUCHSTORE_SUCCESS) {
-                logger.log(EXTENSION_LOG_WARNING,
-                           "CouchKVStore::saveDocs: couchstore_save_documents "
-                           "error:%s [%s], vb:%" PRIu16 ", numdocs:%" PRIu64,
-                           couchstore_strerror(errCode),
-                           couchkvstore_strerrno(db.getDb(), errCode).c_str(),
-                           vbid,
-                           uint64_t(docs.size()));
-                return errCode;
-            }
+    vbucket_state* state = cachedVBStates[vbid];
+    if (state == nullptr) {
+        throw std::logic_error("CouchKVStore::saveDocs: cachedVBStates[" +
+                               std::to_string(vbid) + "] is NULL");
+    }
+
+    // Only do a couchstore_save_documents if there are docs
+    if (docs.size() > 0) {
+        std::vector<sized_buf> ids(docs.size());
+        for (size_t idx = 0; idx < docs.size(); idx++) {
+            ids[idx] = docinfos[idx]->id;
+            commit.maxDBSeqno =
+                    std::max(commit.maxDBSeqno, docinfos[idx]->db_seq);
+            DocKey key = makeDocKey(ids[idx],
+                                    configuration.shouldPersistDocNamespace());
+            kvctx.keyStats[key] = std::make_pair(false, !docinfos[idx]->deleted);
         }
+        couchstore_docinfos_by_id(commit.db.getDb(),
+                                  ids.data(),
+                                  (unsigned)ids.size(),
+                                  0,
+                                  readDocInfos,
+                                  &kvctx);
 
-        errCode = saveVBState(db.getDb(), *state);
+        hrtime_t cs_begin = gethrtime();
+        uint64_t flags = COMPRESS_DOC_BODIES | COUCHSTORE_SEQUENCE_AS_IS;
+        errCode = couchstore_save_documents(commit.db.getDb(),
+                                            docs.data(),
+                                            docinfos.data(),
+                                            (unsigned)docs.size(),
+                                            flags);
+        st.saveDocsHisto.add((gethrtime() - cs_begin) / 1000);
         if (errCode != COUCHSTORE_SUCCESS) {
             logger.log(EXTENSION_LOG_WARNING,
-                       "CouchKVStore::saveDocs: saveVBState error:%s [%s]",
+                       "CouchKVStore::saveDocs: couchstore_save_documents "
+                       "error:%s [%s], vb:%" PRIu16 ", numdocs:%" PRIu64,
                        couchstore_strerror(errCode),
-                       couchkvstore_strerrno(db.getDb(), errCode).c_str());
+                       couchkvstore_strerrno(commit.db.getDb(), errCode)
+                               .c_str(),
+                       vbid,
+                       uint64_t(docs.size()));
             return errCode;
         }
+    }
 
-        if (collectionsManifest) {
-            saveCollectionsManifest(*db.getDb(), *collectionsManifest);
-        }
+    errCode = saveVBState(commit.db.getDb(), *state);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "CouchKVStore::saveDocs: saveVBState error:%s [%s]",
+                   couchstore_strerror(errCode),
+                   couchkvstore_strerrno(commit.db.getDb(), errCode).c_str());
+        return errCode;
+    }
 
-        hrtime_t cs_begin = gethrtime();
-        errCode = couchstore_commit(db.getDb());
-        st.commitHisto.add((gethrtime() - cs_begin) / 1000);
-        if (errCode) {
-            logger.log(
-                    EXTENSION_LOG_WARNING,
-                    "CouchKVStore::saveDocs: couchstore_commit error:%s [%s]",
-                    couchstore_strerror(errCode),
-                    couchkvstore_strerrno(db.getDb(), errCode).c_str());
-            return errCode;
-        }
+    if (commit.collectionsManifest) {
+        saveCollectionsManifest(*commit.db.getDb(),
+                                *commit.collectionsManifest);
+    }
 
-        st.batchSize.add(docs.size());
+    return errCode;
+}
 
-        // retrieve storage system stats for file fragmentation computation
-        couchstore_db_info(db.getDb(), &info);
-        cachedSpaceUsed[vbid] = info.space_used;
-        cachedFileSize[vbid] = info.file_size;
-        cachedDeleteCount[vbid] = info.deleted_count;
-        cachedDocCount[vbid] = info.doc_count;
+couchstore_error_t CouchKVStore::commitDocs(PendingVBCommit& commit) {
+    const uint16_t vbid = commit.vbid;
+    Db* db = commit.db.getDb();
 
-        // Check seqno if we wrote documents
-        if (docs.size() > 0 && maxDBSeqno != info.last_sequence) {
-            logger.log(EXTENSION_LOG_WARNING,
-                       "CouchKVStore::saveDocs: Seqno in db header (%" PRIu64 ")"
-                       " is not matched with what was persisted (%" PRIu64 ")"
-                       " for vb:%" PRIu16,
-                       info.last_sequence, maxDBSeqno, vbid);
-        }
-        state->highSeqno = info.last_sequence;
+    hrtime_t cs_begin = gethrtime();
+    couchstore_error_t errCode = couchstore_commit(db);
+    readHandleCache->invalidate(vbid);
+    st.commitHisto.add((gethrtime() - cs_begin) / 1000);
+    if (errCode) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "CouchKVStore::commitDocs: couchstore_commit error:%s [%s]",
+                   couchstore_strerror(errCode),
+                   couchkvstore_strerrno(db, errCode).c_str());
+        return errCode;
     }
 
-    /* update stat */
-    if(errCode == COUCHSTORE_SUCCESS) {
-        st.docsCommitted = docs.size();
+    st.batchSize.add(commit.docs.size());
+
+    // retrieve storage system stats for file fragmentation computation
+    DbInfo info;
+    couchstore_db_info(db, &info);
+    cachedSpaceUsed[vbid] = info.space_used;
+    cachedFileSize[vbid] = info.file_size;
+    cachedDeleteCount[vbid] = info.deleted_count;
+    cachedDocCount[vbid] = info.doc_count;
+
+    // Check seqno if we wrote documents
+    if (commit.docs.size() > 0 && commit.maxDBSeqno != info.last_sequence) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "CouchKVStore::commitDocs: Seqno in db header (%" PRIu64 ")"
+                   " is not matched with what was persisted (%" PRIu64 ")"
+                   " for vb:%" PRIu16,
+                   info.last_sequence, commit.maxDBSeqno, vbid);
     }
+    cachedVBStates[vbid]->highSeqno = info.last_sequence;
 
     return errCode;
 }
@@ -2572,6 +2631,7 @@ RollbackResult CouchKVStore::rollback(uint16_t vbid, uint64_t rollbackSeqno,
 
     //Append the rewinded header to the database file
     errCode = couchstore_commit(newdb.getDb());
+    readHandleCache->invalidate(vbid);
 
     if (errCode != COUCHSTORE_SUCCESS) {
         return RollbackResult(false, 0, 0, 0);
@@ -2599,19 +2659,21 @@ CouchKVStore::getAllKeys(uint16_t vbid,
                          const DocKey start_key,
                          uint32_t count,
                          std::shared_ptr<Callback<const DocKey&>> cb) {
-    Db *db = NULL;
-    uint64_t rev = dbFileRevMap[vbid];
-    couchstore_error_t errCode = openDB(vbid, rev, &db,
-                                        COUCHSTORE_OPEN_FLAG_RDONLY);
+    CouchReadHandleCache::Lease lease;
+    couchstore_error_t errCode = openReadOnlyDB(vbid, lease);
+    const uint64_t rev = lease.fileRev;
     if(errCode == COUCHSTORE_SUCCESS) {
         sized_buf ref = {NULL, 0};
         ref.buf = (char*) start_key.data();
         ref.size = start_key.size();
         AllKeysCtx ctx(cb, count);
-        errCode = couchstore_all_docs(db, &ref, COUCHSTORE_NO_DELETES,
+        errCode = couchstore_all_docs(lease.db.get(), &ref,
+                                      COUCHSTORE_NO_DELETES,
                                       populateAllKeys,
                                       static_cast<void *>(&ctx));
-        closeDatabaseHandle(db);
+        releaseReadOnlyDB(std::move(lease),
+                          errCode == COUCHSTORE_SUCCESS ||
+                                  errCode == COUCHSTORE_ERROR_CANCEL);
         if (errCode == COUCHSTORE_SUCCESS ||
                 errCode == COUCHSTORE_ERROR_CANCEL)  {
             return ENGINE_SUCCESS;
@@ -2637,6 +2699,11 @@ void CouchKVStore::unlinkCouchFile(uint16_t vbucket,
         throw std::logic_error("CouchKVStore::unlinkCouchFile: Not valid on a "
                 "read-only object.");
     }
+
+    // Make sure a cached read handle doesn't keep the file (and its disk
+    // space) around.
+    readHandleCache->invalidate(vbucket);
+
     char fname[PATH_MAX];
     try {
         checked_snprintf(fname, sizeof(fname), "%s/%d.couch.%" PRIu64,
@@ -2724,6 +2791,7 @@ bool CouchKVStore::persistCollectionsManifestItem(uint16_t vbid,
 
     // commit logs error details
     errCode = couchstore_commit(db.getDb());
+    readHandleCache->invalidate(vbid);
     if (errCode != COUCHSTORE_SUCCESS) {
         return false;
     }
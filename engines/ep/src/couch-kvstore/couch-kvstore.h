@@ -30,6 +30,7 @@
 #include "configuration.h"
 #include "couch-kvstore/couch-fs-stats.h"
 #include "couch-kvstore/couch-kvstore-metadata.h"
+#include "couch-kvstore/couch-read-handle-cache.h"
 #include <platform/histogram.h>
 #include <platform/strerror.h>
 #include "logger.h"
@@ -506,26 +507,26 @@ protected:
                               couchstore_open_flags options,
                               FileOpsInterface* ops = nullptr);
 
+    struct PendingVBCommit;
+
     /**
-     * save the Documents held in docs to the file associated with vbid/rev
+     * Write the Documents of a vbucket's part of the transaction to its file,
+     * along with its vbucket state and (if any) collections manifest. The
+     * file is left open and uncommitted; see commitDocs.
+     *
+     * @param commit the vbucket's pending requests; its db is opened
      *
-     * @param vbid the vbucket file to open/write/commit
-     * @param rev the revision of the vbucket file to open/write/commit
-     * @param docs vector of Doc* to be written (can be empty)
-     * @param docsinfo vector of DocInfo* to be written (non const due to
-     *        couchstore API). Entry n corresponds to entry n of docs.
-     * @param kvctx a stats context object to update
-     * @param collectionsManifest a pointer to an item which contains the
-     *        manifest update data (can be nullptr)
+     * @returns COUCHSTORE_SUCCESS or a failure code (failure paths log)
+     */
+    couchstore_error_t saveDocs(PendingVBCommit& commit);
+
+    /**
+     * Commit the Documents written by saveDocs and update the vbucket's
+     * cached file stats.
      *
      * @returns COUCHSTORE_SUCCESS or a failure code (failure paths log)
      */
-    couchstore_error_t saveDocs(uint16_t vbid,
-                                uint64_t rev,
-                                const std::vector<Doc*>& docs,
-                                std::vector<DocInfo*>& docinfos,
-                                kvstats_ctx& kvctx,
-                                const Item* collectionsManifest);
+    couchstore_error_t commitDocs(PendingVBCommit& commit);
 
     void commitCallback(std::vector<CouchRequest *> &committedReqs,
                         kvstats_ctx &kvctx,
@@ -629,6 +630,13 @@ protected:
      */
     FileOpsInterface& base_ops;
 
+    /**
+     * Read-only Db handles kept open for reuse. Created by the RW store and
+     * shared with its RO sibling, so the RW store can invalidate the
+     * handles the RO store's readers use whenever it changes a file.
+     */
+    std::shared_ptr<CouchReadHandleCache> readHandleCache;
+
 private:
     /**
      * Construct the store, this constructor does the object initialisation and
@@ -644,12 +652,15 @@ private:
      *        read-only constructor is called, it doesn't need to resize the map
      *        as it will use a reference to the RW store's map, so 0 would be
      *        passed.
+     * @param readHandleCache the read handle cache (shared by the RW store
+     *        and its RO sibling)
      */
     CouchKVStore(KVStoreConfig& config,
                  FileOpsInterface& ops,
                  bool readOnly,
                  std::vector<std::atomic<uint64_t>>& dbFileRevMap,
-                 size_t fileRevMapSize);
+                 size_t fileRevMapSize,
+                 std::shared_ptr<CouchReadHandleCache> readHandleCache);
 
     /**
      * Construct a read-only store - private as should be called via
@@ -658,9 +669,31 @@ private:
      * @param config configuration data for the store
      * @param dbFileRevMap a reference to the map (which should be data owned by
      *        the RW store).
+     * @param readHandleCache the RW store's read handle cache
      */
     CouchKVStore(KVStoreConfig& config,
-                 std::vector<std::atomic<uint64_t>>& dbFileRevMap);
+                 std::vector<std::atomic<uint64_t>>& dbFileRevMap,
+                 std::shared_ptr<CouchReadHandleCache> readHandleCache);
+
+    /**
+     * Obtain a read-only handle for the current revision of the given
+     * vbucket's file, from the read handle cache if possible.
+     *
+     * @param vbid the vbucket to open
+     * @param [out] lease set to the handle (on success)
+     * @return COUCHSTORE_SUCCESS or the error from opening the file
+     */
+    couchstore_error_t openReadOnlyDB(uint16_t vbid,
+                                      CouchReadHandleCache::Lease& lease);
+
+    /**
+     * Hand a handle obtained through openReadOnlyDB back for reuse.
+     *
+     * @param lease the handle
+     * @param reusable false if the handle saw an error and should be closed
+     *        rather than cached
+     */
+    void releaseReadOnlyDB(CouchReadHandleCache::Lease lease, bool reusable);
 
     class DbHolder {
     public:
@@ -723,6 +756,29 @@ private:
     private:
         LocalDoc* localDoc;
     };
+
+    /**
+     * One vbucket's share of a transaction. A transaction spans several
+     * vbuckets when the flusher group commits; all of them are written
+     * (saveDocs) before any is committed (commitDocs).
+     */
+    struct PendingVBCommit {
+        PendingVBCommit(CouchKVStore& kvs, uint16_t vbid, uint64_t fileRev)
+            : vbid(vbid), fileRev(fileRev), kvctx(kvs.configuration), db(&kvs) {
+            kvctx.vbucket = vbid;
+        }
+
+        const uint16_t vbid;
+        const uint64_t fileRev;
+        std::vector<CouchRequest*> reqs;
+        std::vector<Doc*> docs;
+        std::vector<DocInfo*> docinfos;
+        const Item* collectionsManifest = nullptr;
+        kvstats_ctx kvctx;
+        DbHolder db;
+        uint64_t maxDBSeqno = 0;
+        couchstore_error_t errCode = COUCHSTORE_SUCCESS;
+    };
 };
 
 #endif  // SRC_COUCH_KVSTORE_COUCH_KVSTORE_H_
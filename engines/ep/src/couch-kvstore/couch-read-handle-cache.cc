@@ -0,0 +1,111 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "couch-kvstore/couch-read-handle-cache.h"
+
+#include <stdexcept>
+#include <string>
+
+CouchReadHandleCache::CouchReadHandleCache(size_t capacity,
+                                           size_t maxVBuckets)
+    : capacity(capacity), generations(maxVBuckets) {
+}
+
+CouchReadHandleCache::Lease CouchReadHandleCache::checkout(uint16_t vbid,
+                                                           uint64_t fileRev) {
+    if (vbid >= generations.size()) {
+        throw std::invalid_argument(
+                "CouchReadHandleCache::checkout: vbid (which is " +
+                std::to_string(vbid) + ") is out of range");
+    }
+
+    Lease result;
+    // Any stale handle is closed once we've dropped the lock.
+    Lease stale;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        auto it = index.find(vbid);
+        if (it != index.end()) {
+            if (it->second->fileRev == fileRev) {
+                result = std::move(*it->second);
+            } else {
+                stale = std::move(*it->second);
+            }
+            lru.erase(it->second);
+            index.erase(it);
+        }
+        result.vbid = vbid;
+        result.fileRev = fileRev;
+        result.generation = generations[vbid];
+    }
+    return result;
+}
+
+void CouchReadHandleCache::checkin(Lease lease) {
+    if (!lease.db || capacity == 0) {
+        return;
+    }
+
+    // Whichever handle doesn't get cached is closed once we've dropped the
+    // lock.
+    Lease evicted;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        if (lease.generation != generations[lease.vbid] ||
+            index.count(lease.vbid) != 0) {
+            evicted = std::move(lease);
+        } else {
+            if (lru.size() >= capacity) {
+                evicted = std::move(lru.back());
+                index.erase(evicted.vbid);
+                lru.pop_back();
+            }
+            lru.push_front(std::move(lease));
+            index[lru.front().vbid] = lru.begin();
+        }
+    }
+}
+
+void CouchReadHandleCache::invalidate(uint16_t vbid) {
+    Lease stale;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        if (vbid < generations.size()) {
+            ++generations[vbid];
+        }
+        auto it = index.find(vbid);
+        if (it != index.end()) {
+            stale = std::move(*it->second);
+            lru.erase(it->second);
+            index.erase(it);
+        }
+    }
+}
+
+void CouchReadHandleCache::clear() {
+    std::list<Lease> stale;
+    {
+        std::lock_guard<std::mutex> lh(mutex);
+        stale.swap(lru);
+        index.clear();
+    }
+}
+
+size_t CouchReadHandleCache::size() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return lru.size();
+}
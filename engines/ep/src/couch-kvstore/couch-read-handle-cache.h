@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libcouchstore/couch_db.h"
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * An LRU cache of read-only couchstore Db handles, keyed by vbucket and the
+ * file revision the handle was opened on.
+ *
+ * Opening a couchstore file re-reads its header, which for a background
+ * fetch of a single document can cost more than the fetch itself. Readers
+ * check a handle out of the cache (opening a new one on a miss) and check it
+ * back in when done, so a handle is only ever used by one thread at a time.
+ *
+ * A handle only sees the file as of the header it was opened with, so the
+ * writer must invalidate a vbucket whenever it commits to, replaces or
+ * removes the vbucket's file. Handles which were checked out before an
+ * invalidation are closed rather than cached when they're checked in.
+ *
+ * Shared between the RW and RO CouchKVStore instances of a shard.
+ */
+class CouchReadHandleCache {
+public:
+    /// A Db handle along with the function which closes it.
+    using Handle = std::unique_ptr<Db, std::function<void(Db*)>>;
+
+    /// A handle checked out of the cache.
+    struct Lease {
+        Handle db;
+        uint16_t vbid = 0;
+        uint64_t fileRev = 0;
+        /// The vbucket's invalidation count when the lease was taken.
+        uint64_t generation = 0;
+    };
+
+    /**
+     * @param capacity the maximum number of handles to cache (0 disables
+     *        caching)
+     * @param maxVBuckets the number of vbuckets handles may be cached for
+     */
+    CouchReadHandleCache(size_t capacity, size_t maxVBuckets);
+
+    CouchReadHandleCache(const CouchReadHandleCache&) = delete;
+    CouchReadHandleCache& operator=(const CouchReadHandleCache&) = delete;
+
+    /**
+     * Take the cached handle for the given vbucket file revision. A cached
+     * handle for any other revision of the file is stale and is closed.
+     *
+     * @return a lease whose db is nullptr on a miss; the caller should open
+     *         the file itself and store the handle in the lease.
+     */
+    Lease checkout(uint16_t vbid, uint64_t fileRev);
+
+    /**
+     * Return a handle obtained through checkout(). The handle is cached
+     * (evicting the least recently used one if the cache is full) unless
+     * the vbucket has been invalidated since it was checked out, or another
+     * handle for the vbucket has been cached in the meantime.
+     */
+    void checkin(Lease lease);
+
+    /**
+     * Close the cached handle for the given vbucket, and prevent any handle
+     * currently checked out for it from being cached.
+     */
+    void invalidate(uint16_t vbid);
+
+    /// Close all of the cached handles.
+    void clear();
+
+    /// @return the number of cached handles
+    size_t size() const;
+
+private:
+    const size_t capacity;
+
+    mutable std::mutex mutex;
+
+    /// Cached handles, most recently used first.
+    std::list<Lease> lru;
+
+    /// Index into lru by vbucket.
+    std::unordered_map<uint16_t, std::list<Lease>::iterator> index;
+
+    /// Per-vbucket count of invalidations.
+    std::vector<uint64_t> generations;
+};
@@ -94,6 +94,7 @@ BackfillManager::BackfillManager(EventuallyPersistentEngine& e)
     scanBuffer.itemsRead = 0;
     scanBuffer.maxBytes = config.getDcpScanByteLimit();
     scanBuffer.maxItems = config.getDcpScanItemLimit();
+    scanBuffer.running = false;
 
     buffer.bytesRead = 0;
     buffer.maxBytes = config.getDcpBackfillByteLimit();
@@ -164,30 +165,39 @@ void BackfillManager::schedule(VBucket& vb,
 
 bool BackfillManager::bytesCheckAndRead(size_t bytes) {
     LockHolder lh(lock);
-    if (scanBuffer.itemsRead >= scanBuffer.maxItems) {
-        return false;
-    }
+    // The scan buffer bounds one run of our task. Items which arrive while
+    // the task isn't running come from a disk scan shared with (and being
+    // run by) another connection, and only count against our buffer.
+    if (scanBuffer.running) {
+        if (scanBuffer.itemsRead >= scanBuffer.maxItems) {
+            return false;
+        }
 
-    // Always allow an item to be backfilled if the scan buffer is empty,
-    // otherwise check to see if there is room for the item.
-    if (scanBuffer.bytesRead + bytes <= scanBuffer.maxBytes ||
-        scanBuffer.bytesRead == 0) {
-        scanBuffer.bytesRead += bytes;
-    } else {
-        /* Subsequent items for this backfill will be read in next run */
-        return false;
+        // Always allow an item to be backfilled if the scan buffer is empty,
+        // otherwise check to see if there is room for the item.
+        if (scanBuffer.bytesRead + bytes <= scanBuffer.maxBytes ||
+            scanBuffer.bytesRead == 0) {
+            scanBuffer.bytesRead += bytes;
+        } else {
+            /* Subsequent items for this backfill will be read in next run */
+            return false;
+        }
     }
 
     if (buffer.bytesRead == 0 || buffer.bytesRead + bytes <= buffer.maxBytes) {
         buffer.bytesRead += bytes;
     } else {
-        scanBuffer.bytesRead -= bytes;
+        if (scanBuffer.running) {
+            scanBuffer.bytesRead -= bytes;
+        }
         buffer.full = true;
         buffer.nextReadSize = bytes;
         return false;
     }
 
-    scanBuffer.itemsRead++;
+    if (scanBuffer.running) {
+        scanBuffer.itemsRead++;
+    }
 
     return true;
 }
@@ -272,7 +282,6 @@ backfill_status_t BackfillManager::backfill() {
         for (auto a_itr = activeBackfills.begin();
              a_itr != activeBackfills.end();) {
             if ((*a_itr)->isStreamDead()) {
-                (*a_itr)->cancel();
                 toDelete.push_back(std::move(*a_itr));
                 a_itr = activeBackfills.erase(a_itr);
                 engine.getDcpConnMap().decrNumActiveSnoozingBackfills();
@@ -281,11 +290,15 @@ backfill_status_t BackfillManager::backfill() {
             }
         }
 
+        // Cancel outside of the lock; a backfill sharing its disk scan with
+        // other connections' backfills (SharedDiskScan) takes the scan's
+        // lock, which is held while items are passed to our streams.
         lh.unlock();
         bool reschedule = !toDelete.empty();
         while (!toDelete.empty()) {
             UniqueDCPBackfillPtr backfill = std::move(toDelete.front());
             toDelete.pop_front();
+            backfill->cancel();
         }
         return reschedule ? backfill_success : backfill_snooze;
     }
@@ -293,12 +306,14 @@ backfill_status_t BackfillManager::backfill() {
     UniqueDCPBackfillPtr backfill = std::move(activeBackfills.front());
     activeBackfills.pop_front();
 
+    scanBuffer.running = true;
     lh.unlock();
     backfill_status_t status = backfill->run();
     lh.lock();
 
     scanBuffer.bytesRead = 0;
     scanBuffer.itemsRead = 0;
+    scanBuffer.running = false;
 
     switch (status) {
         case backfill_success:
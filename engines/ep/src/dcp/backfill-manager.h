@@ -120,6 +120,8 @@ private:
         size_t itemsRead;
         size_t maxBytes;
         size_t maxItems;
+        //! Whether our task is running a backfill
+        bool running;
     } scanBuffer;
 };
 
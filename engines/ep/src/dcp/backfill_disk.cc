@@ -20,6 +20,9 @@
 #include "dcp/backfill_disk.h"
 #include "dcp/stream.h"
 #include "ep_engine.h"
+#include "kvstore.h"
+
+#include <algorithm>
 
 static std::string backfillStateToString(backfill_state_t state) {
     switch (state) {
@@ -117,13 +120,336 @@ void DiskCallback::callback(GetValue& val) {
     }
 }
 
+/* Forwards the cache lookups of a scan context to its SharedDiskScan */
+class SharedCacheCallback : public Callback<CacheLookup> {
+public:
+    SharedCacheCallback(SharedDiskScan& s) : scan(s) {
+    }
+
+    void callback(CacheLookup& lookup) {
+        setStatus(scan.lookup(lookup));
+    }
+
+private:
+    SharedDiskScan& scan;
+};
+
+/* Forwards the items read by a scan context to its SharedDiskScan */
+class SharedDiskCallback : public Callback<GetValue> {
+public:
+    SharedDiskCallback(SharedDiskScan& s) : scan(s) {
+    }
+
+    void callback(GetValue& val) {
+        setStatus(scan.received(val));
+    }
+
+private:
+    SharedDiskScan& scan;
+};
+
+SharedDiskScan::Subscriber::Subscriber(EventuallyPersistentEngine& e,
+                                       const active_stream_t& s,
+                                       uint64_t start)
+    : stream(s),
+      startSeqno(start),
+      lastSeqno(0),
+      stalled(false),
+      cacheCallback(e, stream),
+      diskCallback(stream) {
+}
+
+SharedDiskScan::SharedDiskScan(EventuallyPersistentEngine& e,
+                               std::shared_ptr<SharedDiskScanRegistry> registry,
+                               uint16_t vbid,
+                               ValueFilter valFilter)
+    : engine(e),
+      registry(std::move(registry)),
+      vbid(vbid),
+      valFilter(valFilter),
+      scanCtx(nullptr),
+      finished(false),
+      pausedBy(nullptr) {
+}
+
+SharedDiskScan::~SharedDiskScan() {
+    destroyScanContext_UNLOCKED();
+}
+
+bool SharedDiskScan::create(const active_stream_t& stream,
+                            uint64_t startSeqno,
+                            bool resumed) {
+    LockHolder lh(lock);
+    if (scanCtx) {
+        throw std::logic_error(
+                "SharedDiskScan::create: scan context already created for "
+                "vb:" + std::to_string(vbid));
+    }
+
+    KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
+    std::shared_ptr<Callback<GetValue> > cb(new SharedDiskCallback(*this));
+    std::shared_ptr<Callback<CacheLookup> > cl(new SharedCacheCallback(*this));
+    scanCtx = kvstore->initScanContext(
+            cb, cl, vbid, startSeqno, DocumentFilter::ALL_ITEMS, valFilter);
+    if (!scanCtx) {
+        return false;
+    }
+
+    addSubscriber_UNLOCKED(stream, startSeqno, resumed);
+    return true;
+}
+
+bool SharedDiskScan::subscribe(const active_stream_t& stream,
+                               uint64_t startSeqno,
+                               uint64_t endSeqno,
+                               ValueFilter valFilter) {
+    LockHolder lh(lock);
+    if (finished || !scanCtx || valFilter != this->valFilter) {
+        return false;
+    }
+
+    // The scan can only serve the stream if it hasn't read past the start of
+    // the stream's range yet, and reads up to the end of it.
+    const uint64_t nextSeqno =
+            std::max(scanCtx->startSeqno, scanCtx->lastReadSeqno + 1);
+    if (startSeqno < nextSeqno || endSeqno > scanCtx->maxSeqno) {
+        return false;
+    }
+
+    for (const auto& subscriber : subscribers) {
+        if (subscriber.stream.get() == stream.get()) {
+            return false;
+        }
+    }
+
+    addSubscriber_UNLOCKED(stream, startSeqno, false);
+    return true;
+}
+
+void SharedDiskScan::addSubscriber_UNLOCKED(const active_stream_t& stream,
+                                            uint64_t startSeqno,
+                                            bool resumed) {
+    subscribers.emplace_back(engine, stream, startSeqno);
+    // The marker must be queued before any item is fanned out to the
+    // stream, which can't happen while we hold the lock. A resumed backfill
+    // reads a newer snapshot of the file, so it needs a new marker too (but
+    // its remaining items were already counted).
+    if (!resumed) {
+        stream->incrBackfillRemaining(scanCtx->documentCount);
+    }
+    stream->markDiskSnapshot(startSeqno, scanCtx->maxSeqno);
+}
+
+void SharedDiskScan::unsubscribe(const ActiveStream& stream) {
+    LockHolder lh(lock);
+    subscribers.remove_if([&stream](const Subscriber& subscriber) {
+        return subscriber.stream.get() == &stream;
+    });
+    if (pausedBy == &stream) {
+        pausedBy = nullptr;
+    }
+    detached.erase(&stream);
+
+    if (subscribers.empty()) {
+        destroyScanContext_UNLOCKED();
+        finished = true;
+    }
+}
+
+SharedDiskScan::Status SharedDiskScan::scan(const ActiveStream& stream) {
+    LockHolder lh(lock);
+    if (detached.count(&stream) != 0) {
+        return Status::Detached;
+    }
+    if (finished || !scanCtx) {
+        return Status::Done;
+    }
+
+    pausedBy = nullptr;
+    KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
+    scan_error_t error = kvstore->scan(scanCtx);
+
+    if (error == scan_again) {
+        if (pausedBy != nullptr && pausedBy != &stream) {
+            // Another subscriber's buffer is full. A short pause is normal
+            // flow control, but rather than hold the rest of us up until it
+            // drains (which may be never, if its consumer stopped acking),
+            // move it off the scan once it has stalled for long enough. The
+            // item the scan paused on is read again when we resume.
+            const std::chrono::milliseconds maxStall(
+                    engine.getConfiguration().getDcpSharedScanDetachStallMs());
+            for (const auto& subscriber : subscribers) {
+                if (subscriber.stream.get() == pausedBy &&
+                    ProcessClock::now() - subscriber.stalledSince >= maxStall) {
+                    detach_UNLOCKED(*pausedBy);
+                    break;
+                }
+            }
+        }
+        return Status::Paused;
+    }
+
+    finished = true;
+    return Status::Done;
+}
+
+uint64_t SharedDiskScan::takeResumeSeqno(const ActiveStream& stream) {
+    LockHolder lh(lock);
+    auto it = detached.find(&stream);
+    if (it == detached.end()) {
+        throw std::logic_error(
+                "SharedDiskScan::takeResumeSeqno: stream is not detached "
+                "from the scan of vb:" + std::to_string(vbid));
+    }
+    const uint64_t resumeSeqno = it->second;
+    detached.erase(it);
+    return resumeSeqno;
+}
+
+void SharedDiskScan::detach_UNLOCKED(const ActiveStream& stream) {
+    for (auto it = subscribers.begin(); it != subscribers.end(); ++it) {
+        if (it->stream.get() == &stream) {
+            const uint64_t resumeSeqno =
+                    std::max(it->startSeqno, it->lastSeqno + 1);
+            LOG(EXTENSION_LOG_NOTICE,
+                "SharedDiskScan: detaching a stream which is holding up the "
+                "shared backfill scan of vb:%" PRIu16 ", it will continue "
+                "alone from seqno %" PRIu64,
+                vbid,
+                resumeSeqno);
+            detached[&stream] = resumeSeqno;
+            subscribers.erase(it);
+            break;
+        }
+    }
+    if (pausedBy == &stream) {
+        pausedBy = nullptr;
+    }
+}
+
+ENGINE_ERROR_CODE SharedDiskScan::lookup(CacheLookup& lookup) {
+    const uint64_t seqno = lookup.getBySeqno();
+    bool needValue = false;
+    for (auto& subscriber : subscribers) {
+        if (!subscriber.wants(seqno)) {
+            continue;
+        }
+
+        subscriber.cacheCallback.callback(lookup);
+        switch (subscriber.cacheCallback.getStatus()) {
+        case ENGINE_KEY_EEXISTS:
+            // Sent from memory
+            subscriber.accepted(seqno);
+            break;
+        case ENGINE_SUCCESS:
+            // Not resident, needs the value from disk
+            needValue = true;
+            break;
+        default:
+            subscriber.refused();
+            pausedBy = subscriber.stream.get();
+            return ENGINE_ENOMEM;
+        }
+    }
+
+    return needValue ? ENGINE_SUCCESS : ENGINE_KEY_EEXISTS;
+}
+
+ENGINE_ERROR_CODE SharedDiskScan::received(GetValue& val) {
+    if (!val.item) {
+        throw std::invalid_argument("SharedDiskScan::received: val is NULL");
+    }
+
+    const uint64_t seqno = val.item->getBySeqno();
+    const size_t bytes = val.item->getNBytes() + val.item->getKey().size();
+
+    size_t remaining = 0;
+    for (const auto& subscriber : subscribers) {
+        if (subscriber.wants(seqno)) {
+            ++remaining;
+        }
+    }
+
+    size_t sent = 0;
+    for (auto& subscriber : subscribers) {
+        if (!subscriber.wants(seqno)) {
+            continue;
+        }
+
+        // The last subscriber gets the item itself, the others a copy
+        // (which shares the value).
+        std::unique_ptr<Item> item;
+        if (--remaining == 0) {
+            item = std::move(val.item);
+        } else {
+            item = std::make_unique<Item>(*val.item);
+        }
+        GetValue gv(std::move(item));
+        subscriber.diskCallback.callback(gv);
+        if (subscriber.diskCallback.getStatus() != ENGINE_SUCCESS) {
+            // The scan resumes by reading this item from disk again
+            subscriber.refused();
+            pausedBy = subscriber.stream.get();
+            if (sent > 1) {
+                registry->addBytesSaved((sent - 1) * bytes);
+            }
+            return ENGINE_ENOMEM;
+        }
+        subscriber.accepted(seqno);
+        ++sent;
+    }
+
+    if (sent > 1) {
+        registry->addBytesSaved((sent - 1) * bytes);
+    }
+    return ENGINE_SUCCESS;
+}
+
+void SharedDiskScan::destroyScanContext_UNLOCKED() {
+    if (scanCtx) {
+        KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
+        kvstore->destroyScanContext(scanCtx);
+        scanCtx = nullptr;
+    }
+}
+
+std::shared_ptr<SharedDiskScan> SharedDiskScanRegistry::joinOrCreate(
+        EventuallyPersistentEngine& e,
+        const active_stream_t& stream,
+        uint64_t startSeqno,
+        uint64_t endSeqno,
+        ValueFilter valFilter) {
+    LockHolder lh(lock);
+    for (auto it = scans.begin(); it != scans.end();) {
+        auto scan = it->lock();
+        if (!scan) {
+            it = scans.erase(it);
+            continue;
+        }
+        if (scan->subscribe(stream, startSeqno, endSeqno, valFilter)) {
+            ++numJoined;
+            return scan;
+        }
+        ++it;
+    }
+
+    auto scan = std::make_shared<SharedDiskScan>(
+            e, shared_from_this(), stream->getVBucket(), valFilter);
+    if (!scan->create(stream, startSeqno)) {
+        return nullptr;
+    }
+    scans.push_back(scan);
+    return scan;
+}
+
 DCPBackfillDisk::DCPBackfillDisk(EventuallyPersistentEngine& e,
                                  const active_stream_t& s,
+                                 std::shared_ptr<SharedDiskScanRegistry> scans,
                                  uint64_t startSeqno,
                                  uint64_t endSeqno)
     : DCPBackfill(s, startSeqno, endSeqno),
       engine(e),
-      scanCtx(nullptr),
+      scans(std::move(scans)),
       state(backfill_state_init) {
 }
 
@@ -169,7 +495,6 @@ backfill_status_t DCPBackfillDisk::create() {
         return backfill_snooze;
     }
 
-    KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
     ValueFilter valFilter = ValueFilter::VALUES_DECOMPRESSED;
     if (stream->isKeyOnly()) {
         valFilter = ValueFilter::KEYS_ONLY;
@@ -179,15 +504,10 @@ backfill_status_t DCPBackfillDisk::create() {
         }
     }
 
-    std::shared_ptr<Callback<GetValue> > cb(new DiskCallback(stream));
-    std::shared_ptr<Callback<CacheLookup> > cl(
-            new CacheCallback(engine, stream));
-    scanCtx = kvstore->initScanContext(
-            cb, cl, vbid, startSeqno, DocumentFilter::ALL_ITEMS, valFilter);
+    sharedScan = scans->joinOrCreate(
+            engine, stream, startSeqno, endSeqno, valFilter);
 
-    if (scanCtx) {
-        stream->incrBackfillRemaining(scanCtx->documentCount);
-        stream->markDiskSnapshot(startSeqno, scanCtx->maxSeqno);
+    if (sharedScan) {
         transitionState(backfill_state_scanning);
     } else {
         transitionState(backfill_state_done);
@@ -197,28 +517,46 @@ backfill_status_t DCPBackfillDisk::create() {
 }
 
 backfill_status_t DCPBackfillDisk::scan() {
-    uint16_t vbid = stream->getVBucket();
-
     if (!(stream->isActive())) {
         return complete(true);
     }
 
-    KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
-    scan_error_t error = kvstore->scan(scanCtx);
-
-    if (error == scan_again) {
+    switch (sharedScan->scan(*stream)) {
+    case SharedDiskScan::Status::Paused:
+        return backfill_success;
+    case SharedDiskScan::Status::Detached:
+        return resume();
+    case SharedDiskScan::Status::Done:
+        transitionState(backfill_state_completing);
         return backfill_success;
     }
 
-    transitionState(backfill_state_completing);
+    throw std::logic_error("DCPBackfillDisk::scan: Invalid scan status");
+}
 
+backfill_status_t DCPBackfillDisk::resume() {
+    const uint64_t resumeSeqno = sharedScan->takeResumeSeqno(*stream);
+    const ValueFilter valFilter = sharedScan->getValueFilter();
+
+    // The new scan isn't offered to other streams; anyone joining it would
+    // just be held up by us again.
+    sharedScan = std::make_shared<SharedDiskScan>(
+            engine, scans, stream->getVBucket(), valFilter);
+    if (!sharedScan->create(stream, resumeSeqno, /*resumed*/ true)) {
+        sharedScan.reset();
+        transitionState(backfill_state_completing);
+    }
     return backfill_success;
 }
 
 backfill_status_t DCPBackfillDisk::complete(bool cancelled) {
     uint16_t vbid = stream->getVBucket();
-    KVStore* kvstore = engine.getKVBucket()->getROUnderlying(vbid);
-    kvstore->destroyScanContext(scanCtx);
+    if (sharedScan) {
+        // Leave the scan before completing, the stream may schedule its next
+        // backfill straight away.
+        sharedScan->unsubscribe(*stream);
+        sharedScan.reset();
+    }
 
     stream->completeBackfill();
 
@@ -22,8 +22,18 @@
 #include "callbacks.h"
 #include "dcp/backfill.h"
 
+#include <platform/processclock.h>
+#include <relaxed_atomic.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
 class EventuallyPersistentEngine;
 class ScanContext;
+class SharedDiskScanRegistry;
+enum class ValueFilter;
 
 /* The possible states of the DCPBackfillDisk */
 enum backfill_state_t {
@@ -56,17 +66,230 @@ private:
     active_stream_t stream_;
 };
 
+/**
+ * A disk scan of a vBucket which feeds the backfill of one or more DCP
+ * streams.
+ *
+ * When several streams need to backfill the same vBucket at the same time
+ * (e.g. a rebalance adding replicas while indexers are catching up), each
+ * of them reading the couchstore file separately multiplies the disk reads.
+ * Instead, a stream whose range hasn't been passed yet by an in-progress
+ * scan subscribes to it and the items read are fanned out to every
+ * subscriber.
+ *
+ * Each subscriber still goes through its own CacheCallback / DiskCallback,
+ * so the items count against its connection's backfill buffer. If any
+ * subscriber can't take an item the whole scan pauses on that item; when the
+ * scan is resumed, subscribers which already received it are skipped.
+ * A subscriber whose full buffer holds up the scan for the others for longer
+ * than dcp_shared_scan_detach_stall_ms (e.g. its consumer stopped acking) is
+ * detached from it, and its backfill carries on with a scan of its own from
+ * the first item it hasn't received. A subscriber which only pauses the scan
+ * briefly (normal flow control) stays on it.
+ *
+ * The scan is driven by the DCPBackfillDisk of whichever subscriber gets to
+ * run, serialised by the scan's lock.
+ */
+class SharedDiskScan {
+public:
+    /// The outcome of driving the scan with scan()
+    enum class Status {
+        /// The scan paused (because a subscriber's buffer is full, or it
+        /// yielded); the caller should resume it later
+        Paused,
+        /// The calling stream was detached from the scan; the caller should
+        /// continue from takeResumeSeqno() with a scan of its own
+        Detached,
+        /// The scan has read everything; the caller should complete
+        Done
+    };
+
+    SharedDiskScan(EventuallyPersistentEngine& e,
+                   std::shared_ptr<SharedDiskScanRegistry> registry,
+                   uint16_t vbid,
+                   ValueFilter valFilter);
+
+    ~SharedDiskScan();
+
+    /**
+     * Creates the scan context with the KV Store, reading items from
+     * startSeqno onwards, and subscribes the stream which asked for it.
+     *
+     * @param resumed true if the stream is continuing a backfill it was
+     *                detached from, rather than starting a new one
+     * @return false if there is nothing to scan
+     */
+    bool create(const active_stream_t& stream,
+                uint64_t startSeqno,
+                bool resumed = false);
+
+    /**
+     * Subscribes the stream to the scan if the part of the scan it needs
+     * hasn't been read yet, and sends it the disk snapshot marker.
+     *
+     * @return true if the stream was subscribed
+     */
+    bool subscribe(const active_stream_t& stream,
+                   uint64_t startSeqno,
+                   uint64_t endSeqno,
+                   ValueFilter valFilter);
+
+    /**
+     * Removes the stream from the scan. The scan context is released when
+     * the last subscriber leaves.
+     */
+    void unsubscribe(const ActiveStream& stream);
+
+    /// Reads the next chunk of the scan on behalf of the given subscriber.
+    Status scan(const ActiveStream& stream);
+
+    /**
+     * Forgets a stream which scan() reported as Detached.
+     *
+     * @return the seqno the stream's backfill should continue from
+     */
+    uint64_t takeResumeSeqno(const ActiveStream& stream);
+
+    ValueFilter getValueFilter() const {
+        return valFilter;
+    }
+
+    /**
+     * Fans the result of a cache lookup out to the subscribers.
+     *
+     * @return ENGINE_KEY_EEXISTS if no subscriber needs the value read from
+     *         disk, ENGINE_SUCCESS if some do, ENGINE_ENOMEM to pause the
+     *         scan
+     */
+    ENGINE_ERROR_CODE lookup(CacheLookup& lookup);
+
+    /**
+     * Fans an item read from disk out to the subscribers.
+     *
+     * @return ENGINE_SUCCESS, or ENGINE_ENOMEM to pause the scan
+     */
+    ENGINE_ERROR_CODE received(GetValue& val);
+
+private:
+    struct Subscriber {
+        Subscriber(EventuallyPersistentEngine& e,
+                   const active_stream_t& s,
+                   uint64_t start);
+
+        /// @return true if the item with the given seqno should be sent
+        bool wants(uint64_t seqno) const {
+            return seqno >= startSeqno && seqno > lastSeqno;
+        }
+
+        /// Records that the subscriber refused the item the scan is on
+        void refused() {
+            if (!stalled) {
+                stalled = true;
+                stalledSince = ProcessClock::now();
+            }
+        }
+
+        /// Records that the subscriber received (or skipped) the given seqno
+        void accepted(uint64_t seqno) {
+            lastSeqno = seqno;
+            stalled = false;
+        }
+
+        active_stream_t stream;
+        uint64_t startSeqno;
+        //! The last seqno this subscriber received (or skipped)
+        uint64_t lastSeqno;
+        //! Has the subscriber refused items since it last accepted one?
+        bool stalled;
+        //! When the subscriber first refused an item, if stalled
+        ProcessClock::time_point stalledSince;
+        CacheCallback cacheCallback;
+        DiskCallback diskCallback;
+    };
+
+    void addSubscriber_UNLOCKED(const active_stream_t& stream,
+                                uint64_t startSeqno,
+                                bool resumed);
+
+    /// Moves the given subscriber off the scan (see Status::Detached).
+    void detach_UNLOCKED(const ActiveStream& stream);
+
+    void destroyScanContext_UNLOCKED();
+
+    EventuallyPersistentEngine& engine;
+    const std::shared_ptr<SharedDiskScanRegistry> registry;
+    const uint16_t vbid;
+    const ValueFilter valFilter;
+
+    std::mutex lock;
+    ScanContext* scanCtx;
+    bool finished;
+    std::list<Subscriber> subscribers;
+    //! The subscriber which refused the item the scan last paused on
+    const ActiveStream* pausedBy;
+    //! Streams detached from the scan, and the seqno to continue from
+    std::map<const ActiveStream*, uint64_t> detached;
+};
+
+/**
+ * Tracks the disk scans in progress on a vBucket so that new backfills can
+ * share them, along with the statistics of that sharing.
+ */
+class SharedDiskScanRegistry
+    : public std::enable_shared_from_this<SharedDiskScanRegistry> {
+public:
+    SharedDiskScanRegistry() : numJoined(0), bytesSaved(0) {
+    }
+
+    /**
+     * Subscribes the stream to a compatible disk scan already in progress on
+     * the vBucket, or starts a new one.
+     *
+     * @return the scan the stream is subscribed to, or nullptr if there is
+     *         nothing to scan
+     */
+    std::shared_ptr<SharedDiskScan> joinOrCreate(EventuallyPersistentEngine& e,
+                                                 const active_stream_t& stream,
+                                                 uint64_t startSeqno,
+                                                 uint64_t endSeqno,
+                                                 ValueFilter valFilter);
+
+    /// Records that bytes read from disk were sent to more than one stream
+    void addBytesSaved(size_t bytes) {
+        bytesSaved.fetch_add(bytes);
+    }
+
+    /// @return the number of backfills which joined another stream's scan
+    size_t getNumJoined() const {
+        return numJoined;
+    }
+
+    /// @return the bytes which a backfill didn't have to read from disk
+    size_t getBytesSaved() const {
+        return bytesSaved;
+    }
+
+private:
+    std::mutex lock;
+    std::list<std::weak_ptr<SharedDiskScan>> scans;
+
+    Couchbase::RelaxedAtomic<size_t> numJoined;
+    Couchbase::RelaxedAtomic<size_t> bytesSaved;
+};
+
 /**
  * Concrete class that does backfill from the disk and informs the DCP stream
  * of the backfill progress.
- * This class calls asynchronous kvstore apis and manages a state machine to
- * read items in the sequential order from the disk and to call the DCP stream
+ * This class manages a state machine to read items in the sequential order
+ * from the disk (via a SharedDiskScan, which may be shared with the
+ * backfills of other streams of the same vBucket) and to call the DCP stream
  * for disk snapshot, backfill items and backfill completion.
  */
 class DCPBackfillDisk : public DCPBackfill {
 public:
     DCPBackfillDisk(EventuallyPersistentEngine& e,
                     const active_stream_t& s,
+                    std::shared_ptr<SharedDiskScanRegistry> scans,
                     uint64_t startSeqno,
                     uint64_t endSeqno);
 
@@ -80,22 +303,28 @@ public:
 
 private:
     /**
-     * Creates a scan context with the KV Store to read items in the sequential
-     * order from the disk. Backfill snapshot range is decided here.
+     * Subscribes to a disk scan of the vBucket, joining one already in
+     * progress if possible. Backfill snapshot range is decided here.
      */
     backfill_status_t create();
 
     /**
-     * Scan the disk (by calling KVStore apis) for the items in the backfill
-     * snapshot range created in the create scan context. This is an
-     * asynchronous operation, KVStore calls the CacheCallback and DiskCallback
-     * to populate the items read in the snapshot of scan.
+     * Scan the disk for the items in the backfill snapshot range. This is an
+     * asynchronous operation, the KVStore calls the CacheCallback and
+     * DiskCallback (of every subscriber of the scan) to populate the items
+     * read in the snapshot of scan.
      */
     backfill_status_t scan();
 
+    /**
+     * Continues the backfill with a scan of its own, after the stream was
+     * detached from the shared scan for holding it up.
+     */
+    backfill_status_t resume();
+
     /**
      * Handles the completion of the backfill.
-     * Destroys the scan context, indicates the completion to the stream.
+     * Leaves the shared scan, indicates the completion to the stream.
      *
      * @param cancelled indicates the if backfill finished fully or was
      *                  cancelled in between; for debug
@@ -115,7 +344,9 @@ private:
      */
     EventuallyPersistentEngine& engine;
 
-    ScanContext* scanCtx;
+    //! The disk scans in progress on the vBucket
+    std::shared_ptr<SharedDiskScanRegistry> scans;
+    std::shared_ptr<SharedDiskScan> sharedScan;
     backfill_state_t state;
     std::mutex lock;
 };
@@ -148,9 +148,21 @@ void DCPBackfillMemoryBuffered::cancel() {
 }
 
 backfill_status_t DCPBackfillMemoryBuffered::create(EphemeralVBucket& evb) {
-    /* Create range read cursor */
+    /* Create range read cursor, positioned at startSeqno */
     try {
-        rangeItr = evb.makeRangeIterator();
+        auto itr = evb.makeRangeIterator(startSeqno);
+        if (!itr) {
+            /* Another range read is in progress on the sequence list; try
+               backfilling again later rather than blocking this thread (and
+               hence the other backfills) till it completes */
+            stream->getLogger().log(
+                    EXTENSION_LOG_INFO,
+                    "Deferring the backfill for (vb %" PRIu16
+                    ") as another range read is in progress",
+                    getVBucketId());
+            return backfill_snooze;
+        }
+        rangeItr = std::move(*itr);
     } catch (const std::bad_alloc&) {
         stream->getLogger().log(
                 EXTENSION_LOG_WARNING,
@@ -162,44 +174,38 @@ backfill_status_t DCPBackfillMemoryBuffered::create(EphemeralVBucket& evb) {
         return backfill_snooze;
     }
 
-    /* Advance the cursor till start, mark snapshot and update backfill
-       remaining count */
-    while (rangeItr.curr() != rangeItr.end()) {
-        if (static_cast<uint64_t>((*rangeItr).getBySeqno()) >= startSeqno) {
-            /* Incr backfill remaining
-               [EPHE TODO]: This will be inaccurate if do not backfill till end
-                            of the iterator
-             */
-            stream->incrBackfillRemaining(rangeItr.count());
-
-            /* Determine the endSeqno of the current snapshot.
-               We want to send till requested endSeqno, but if that cannot
-               constitute a snapshot then we need to send till the point
-               which can be called as snapshot end */
-            endSeqno = std::max(
-                    endSeqno,
-                    static_cast<uint64_t>(rangeItr.getEarlySnapShotEnd()));
-
-            /* We want to send items only till the point it is necessary to do
-               so */
-            endSeqno =
-                    std::min(endSeqno, static_cast<uint64_t>(rangeItr.back()));
-
-            /* Mark disk snapshot */
-            stream->markDiskSnapshot(startSeqno, endSeqno);
-
-            /* Change the backfill state */
-            transitionState(BackfillState::Scanning);
-
-            /* Jump to scan here itself */
-            return scan();
-        }
-        ++rangeItr;
+    if (rangeItr.curr() == rangeItr.end()) {
+        /* Backfill is not needed as startSeqno > rangeItr end seqno */
+        complete(false);
+        return backfill_success;
     }
 
-    /* Backfill is not needed as startSeqno > rangeItr end seqno */
-    complete(false);
-    return backfill_success;
+    /* Determine the endSeqno of the current snapshot.
+       We want to send till requested endSeqno, but if that cannot
+       constitute a snapshot then we need to send till the point
+       which can be called as snapshot end */
+    endSeqno = std::max(endSeqno,
+                        static_cast<uint64_t>(rangeItr.getEarlySnapShotEnd()));
+
+    /* We want to send items only till the point it is necessary to do so */
+    endSeqno = std::min(endSeqno, static_cast<uint64_t>(rangeItr.back()));
+
+    /* Incr backfill remaining; the items in the iterator beyond endSeqno are
+       not sent */
+    const auto curr = static_cast<uint64_t>(rangeItr.curr());
+    stream->incrBackfillRemaining(
+            (endSeqno < curr) ? 0
+                              : std::min(rangeItr.count(),
+                                         endSeqno - curr + 1));
+
+    /* Mark disk snapshot */
+    stream->markDiskSnapshot(startSeqno, endSeqno);
+
+    /* Change the backfill state */
+    transitionState(BackfillState::Scanning);
+
+    /* Jump to scan here itself */
+    return scan();
 }
 
 backfill_status_t DCPBackfillMemoryBuffered::scan() {
@@ -231,8 +237,9 @@ backfill_status_t DCPBackfillMemoryBuffered::scan() {
                     std::move(item), BACKFILL_FROM_MEMORY, /*force*/ false)) {
             /* Try backfill again later; here we do not snooze because we
                want to check if other backfills can be run by the
-               backfillMgr */
-            stream->getLogger().log(EXTENSION_LOG_WARNING,
+               backfillMgr. This is the normal way a large backfill is
+               broken into batches, hence not a warning */
+            stream->getLogger().log(EXTENSION_LOG_DEBUG,
                                     "Deferring the backfill for (vb %d) as "
                                     "scan buffer or backfill buffer is full",
                                     getVBucketId());
@@ -30,6 +30,8 @@
  * This class calls one synchronous vBucket API to read items in the sequential
  * order from the in-memory ordered data structure and calls the DCP stream
  * for disk snapshot, backfill items and backfill completion.
+ * Note that all the items in the backfill range are copied before any of them
+ * is sent; DCPBackfillMemoryBuffered does not need the extra memory.
  */
 class DCPBackfillMemory : public DCPBackfill {
 public:
@@ -58,9 +60,12 @@ private:
  * Concrete class that does backfill from in-memory ordered data strucuture and
  * informs the DCP stream of the backfill progress.
  *
- * This class calls one synchronous vBucket API to read items in the sequential
- * order from the in-memory ordered data structure and calls the DCP stream
- * for disk snapshot, backfill items and backfill completion.
+ * This class creates a range iterator on the in-memory ordered data structure
+ * (positioned at the start seqno) and reads items one at a time, calling the
+ * DCP stream for disk snapshot, backfill items and backfill completion. When
+ * the scan or backfill buffer is full the backfill yields and resumes from the
+ * iterator's position on the next run, hence the memory used is bounded by the
+ * buffer size and not by the size of the backfill range.
  */
 class DCPBackfillMemoryBuffered : public DCPBackfill {
 public:
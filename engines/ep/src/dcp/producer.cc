@@ -484,11 +484,23 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
         }
     }
 
-    Item* itmCpy = nullptr;
+    Item* itm = nullptr;
+    // Bytes saved by compressing the value, which are acknowledged to the
+    // buffer log once the message has been accepted.
+    uint32_t compressionSavings = 0;
+    bool compressionAttempted = false;
+    bool compressionCacheHit = false;
     auto* mutationResponse = dynamic_cast<MutationProducerResponse*>(resp);
     if (mutationResponse != nullptr) {
         try {
-            itmCpy = mutationResponse->getItemCopy();
+            // The value is only modified when it's compressed, or when
+            // just the key is to be sent; otherwise send the queued item
+            // as it is rather than copying it.
+            if (enableValueCompression || mutationResponse->isKeyOnly()) {
+                itm = mutationResponse->getItemCopy();
+            } else {
+                itm = mutationResponse->getItemRef();
+            }
         } catch (const std::bad_alloc&) {
             rejectResp = resp;
             LOG(EXTENSION_LOG_WARNING,
@@ -500,24 +512,42 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
             return ENGINE_ENOMEM;
         }
 
-        if (enableValueCompression) {
+        if (enableValueCompression && !mutationResponse->isKeyOnly() &&
+            !mcbp::datatype::is_snappy(itm->getDataType()) &&
+            itm->getNBytes() > 0) {
             /**
              * If value compression is enabled, the producer will need
              * to snappy-compress the document before transmitting.
              * Compression will obviously be done only if the datatype
-             * indicates that the value isn't compressed already.
+             * indicates that the value isn't compressed already. The
+             * compressed value is kept with the queued item, so it's
+             * only compressed once however many producers stream it.
              */
-            uint32_t sizeBefore = itmCpy->getNBytes();
-            if (!itmCpy->compressValue(
-                            engine_.getDcpConnMap().getMinCompressionRatio())) {
+            const uint32_t sizeBefore = itm->getNBytes();
+            value_t compressed = mutationResponse->getItem()->
+                    getCompressedValue(compressionCacheHit);
+            compressionAttempted = true;
+            if (compressed && !compressionCacheHit) {
+                // The compressed value now lives as long as the queued
+                // item, so count it against the checkpoint holding it.
+                VBucketPtr vb = engine_.getVBucket(
+                        mutationResponse->getVBucket());
+                if (vb) {
+                    vb->checkpointManager.notifyValueCompressed(
+                            *mutationResponse->getItem());
+                }
+            }
+            if (!compressed) {
                 LOG(EXTENSION_LOG_WARNING,
                     "%s Failed to snappy compress an uncompressed value!",
                     logHeader());
-            }
-            uint32_t sizeAfter = itmCpy->getNBytes();
-
-            if (sizeAfter < sizeBefore) {
-                log.acknowledge(sizeBefore - sizeAfter);
+            } else if (compressed->vlength() <=
+                       engine_.getDcpConnMap().getMinCompressionRatio() *
+                               sizeBefore) {
+                // Only worth sending compressed if the desired compression
+                // ratio is achieved.
+                itm->setCompressedValue(compressed);
+                compressionSavings = sizeBefore - itm->getNBytes();
             }
         }
     }
@@ -534,9 +564,9 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
         }
         case DcpResponse::Event::Mutation:
         {
-            if (itmCpy == nullptr) {
+            if (itm == nullptr) {
                 throw std::logic_error(
-                    "DcpProducer::step(Mutation): itmCpy must be != nullptr");
+                    "DcpProducer::step(Mutation): itm must be != nullptr");
             }
             std::pair<const char*, uint16_t> meta{nullptr, 0};
             if (mutationResponse->getExtMetaData()) {
@@ -545,7 +575,7 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
             ret = producers->mutation(
                     getCookie(),
                     mutationResponse->getOpaque(),
-                    itmCpy,
+                    itm,
                     mutationResponse->getVBucket(),
                     *mutationResponse->getBySeqno(),
                     mutationResponse->getRevSeqno(),
@@ -558,9 +588,9 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
         }
         case DcpResponse::Event::Deletion:
         {
-            if (itmCpy == nullptr) {
+            if (itm == nullptr) {
                 throw std::logic_error(
-                    "DcpProducer::step(Deletion): itmCpy must be != nullptr");
+                    "DcpProducer::step(Deletion): itm must be != nullptr");
             }
             std::pair<const char*, uint16_t> meta{nullptr, 0};
             if (mutationResponse->getExtMetaData()) {
@@ -568,7 +598,7 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
             }
             ret = producers->deletion(getCookie(),
                                       mutationResponse->getOpaque(),
-                                      itmCpy,
+                                      itm,
                                       mutationResponse->getVBucket(),
                                       *mutationResponse->getBySeqno(),
                                       mutationResponse->getRevSeqno(),
@@ -621,8 +651,22 @@ ENGINE_ERROR_CODE DcpProducer::step(struct dcp_message_producers* producers) {
     ObjectRegistry::onSwitchThread(epe);
 
     if (ret == ENGINE_E2BIG) {
+        // The connection's send buffer is full; we'll compress (and
+        // acknowledge the savings of) the value again when it's retried.
         rejectResp = resp;
     } else {
+        if (compressionAttempted) {
+            auto& stats = engine_.getEpStats();
+            if (compressionCacheHit) {
+                ++stats.dcpCompressionCacheHits;
+            } else {
+                ++stats.dcpCompressionCacheMisses;
+            }
+            stats.dcpCompressionSavedBytes += compressionSavings;
+        }
+        if (compressionSavings > 0) {
+            log.acknowledge(compressionSavings);
+        }
         delete resp;
     }
 
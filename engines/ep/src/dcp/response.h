@@ -337,6 +337,22 @@ public:
         return new Item(*item_, keyOnly);
     }
 
+    /**
+     * Get the queued item itself rather than a copy of it, for sending the
+     * whole item (i.e. when it isn't keyOnly) without touching the value.
+     * The caller gets a reference to the item, which is dropped when the
+     * item is released through the engine (see
+     * EventuallyPersistentEngine::itemRelease).
+     */
+    Item* getItemRef() {
+        item_->acquireRawRef();
+        return item_.get();
+    }
+
+    bool isKeyOnly() const {
+        return keyOnly;
+    }
+
     uint16_t getVBucket() {
         return item_->getVBucketId();
     }
@@ -43,6 +43,7 @@
 #include "string_utils.h"
 #include "tapconnmap.h"
 #include "vb_count_visitor.h"
+#include "vbucket_bgfetch_item.h"
 #include "warmup.h"
 
 #include <JSON_checker.h>
@@ -238,33 +239,48 @@ static void EvpItemRelease(ENGINE_HANDLE* handle,
     acquireEngine(handle)->itemRelease(cookie, itm);
 }
 
-static cb::EngineErrorItemPair EvpGet(ENGINE_HANDLE* handle,
-                                      const void* cookie,
-                                      const DocKey& key,
-                                      uint16_t vbucket,
-                                      DocStateFilter documentStateFilter) {
-    get_options_t options = static_cast<get_options_t>(QUEUE_BG_FETCH |
-                                                       HONOR_STATES |
-                                                       TRACK_REFERENCE |
-                                                       DELETE_TEMP |
-                                                       HIDE_LOCKED_CAS |
-                                                       TRACK_STATISTICS);
+/**
+ * Get the options EvpGet / EvpGetMulti should use for the given document
+ * state filter.
+ *
+ * @return false if the filter isn't supported
+ */
+static bool getOptionsForFilter(DocStateFilter documentStateFilter,
+                                get_options_t& options) {
+    options = static_cast<get_options_t>(QUEUE_BG_FETCH |
+                                         HONOR_STATES |
+                                         TRACK_REFERENCE |
+                                         DELETE_TEMP |
+                                         HIDE_LOCKED_CAS |
+                                         TRACK_STATISTICS);
 
     switch (documentStateFilter) {
     case DocStateFilter::Alive:
-        break;
+        return true;
     case DocStateFilter::Deleted:
         // MB-23640 was caused by this bug as the frontend asked for
         // Alive and Deleted documents. The internals don't have a
         // way of requesting just deleted documents, and luckily for
         // us no part of our code is using this yet. Return an error
         // if anyone start using it
+        return false;
+    case DocStateFilter::AliveOrDeleted:
+        options = static_cast<get_options_t>(options | GET_DELETED_VALUE);
+        return true;
+    }
+    return false;
+}
+
+static cb::EngineErrorItemPair EvpGet(ENGINE_HANDLE* handle,
+                                      const void* cookie,
+                                      const DocKey& key,
+                                      uint16_t vbucket,
+                                      DocStateFilter documentStateFilter) {
+    get_options_t options;
+    if (!getOptionsForFilter(documentStateFilter, options)) {
         return std::make_pair(
                 cb::engine_errc::not_supported,
                 cb::unique_item_ptr{nullptr, cb::ItemDeleter{handle}});
-    case DocStateFilter::AliveOrDeleted:
-        options = static_cast<get_options_t>(options | GET_DELETED_VALUE);
-        break;
     }
 
     item* itm = nullptr;
@@ -273,6 +289,24 @@ static cb::EngineErrorItemPair EvpGet(ENGINE_HANDLE* handle,
     return cb::makeEngineErrorItemPair(cb::engine_errc(ret), itm, handle);
 }
 
+static std::vector<cb::EngineErrorItemPair> EvpGetMulti(
+        ENGINE_HANDLE* handle,
+        const void* cookie,
+        const std::vector<cb::GetMultiKey>& keys,
+        DocStateFilter documentStateFilter) {
+    get_options_t options;
+    if (!getOptionsForFilter(documentStateFilter, options)) {
+        std::vector<cb::EngineErrorItemPair> ret;
+        for (size_t ii = 0; ii < keys.size(); ++ii) {
+            ret.push_back(cb::makeEngineErrorItemPair(
+                    cb::engine_errc::not_supported));
+        }
+        return ret;
+    }
+
+    return acquireEngine(handle)->getMulti(cookie, keys, options);
+}
+
 static cb::EngineErrorItemPair EvpGetIf(ENGINE_HANDLE* handle,
                                         const void* cookie,
                                         const DocKey& key,
@@ -498,6 +532,8 @@ protocol_binary_response_status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setExpPagerStime(std::stoull(valz));
         } else if (strcmp(keyz, "exp_pager_initial_run_time") == 0) {
             getConfiguration().setExpPagerInitialRunTime(std::stoll(valz));
+        } else if (strcmp(keyz, "exp_pager_use_index") == 0) {
+            getConfiguration().setExpPagerUseIndex(cb_stob(valz));
         } else if (strcmp(keyz, "access_scanner_enabled") == 0) {
             getConfiguration().requirementsMetOrThrow("access_scanner_enabled");
             getConfiguration().setAccessScannerEnabled(cb_stob(valz));
@@ -509,6 +545,8 @@ protocol_binary_response_status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setAlogTaskTime(std::stoull(valz));
         } else if (strcmp(keyz, "pager_active_vb_pcnt") == 0) {
             getConfiguration().setPagerActiveVbPcnt(std::stoull(valz));
+        } else if (strcmp(keyz, "ht_eviction_policy") == 0) {
+            getConfiguration().setHtEvictionPolicy(valz);
         } else if (strcmp(keyz, "warmup_min_memory_threshold") == 0) {
             getConfiguration().setWarmupMinMemoryThreshold(std::stoull(valz));
         } else if (strcmp(keyz, "warmup_min_items_threshold") == 0) {
@@ -553,6 +591,12 @@ protocol_binary_response_status EventuallyPersistentEngine::setFlushParam(
             runDefragmenterTask();
         } else if (strcmp(keyz, "compaction_write_queue_cap") == 0) {
             getConfiguration().setCompactionWriteQueueCap(std::stoull(valz));
+        } else if (strcmp(keyz, "flusher_group_commit_max_vbuckets") == 0) {
+            getConfiguration().setFlusherGroupCommitMaxVbuckets(
+                    std::stoull(valz));
+        } else if (strcmp(keyz, "flusher_group_commit_max_latency") == 0) {
+            getConfiguration().setFlusherGroupCommitMaxLatency(
+                    std::stoull(valz));
         } else if (strcmp(keyz, "dcp_min_compression_ratio") == 0) {
             getConfiguration().setDcpMinCompressionRatio(std::stof(valz));
         } else if (strcmp(keyz, "access_scanner_run") == 0) {
@@ -572,8 +616,6 @@ protocol_binary_response_status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().requirementsMetOrThrow("ephemeral_metadata_purge_interval");
             getConfiguration().setEphemeralMetadataPurgeInterval(
                     std::stoull(valz));
-        } else if (strcmp(keyz, "mem_merge_count_threshold") == 0) {
-            getConfiguration().setMemMergeCountThreshold(std::stoul(valz));
         } else if (strcmp(keyz, "mem_merge_bytes_threshold") == 0) {
             getConfiguration().setMemMergeBytesThreshold(std::stoul(valz));
         } else {
@@ -1808,6 +1850,7 @@ EventuallyPersistentEngine::EventuallyPersistentEngine(
     ENGINE_HANDLE_V1::remove = EvpItemDelete;
     ENGINE_HANDLE_V1::release = EvpItemRelease;
     ENGINE_HANDLE_V1::get = EvpGet;
+    ENGINE_HANDLE_V1::get_multi = EvpGetMulti;
     ENGINE_HANDLE_V1::get_if = EvpGetIf;
     ENGINE_HANDLE_V1::get_and_touch = EvpGetAndTouch;
     ENGINE_HANDLE_V1::get_locked = EvpGetLocked;
@@ -1904,10 +1947,8 @@ public:
             engine.setMaxItemSize(value);
         } else if (key.compare("max_item_privileged_bytes") == 0) {
             engine.setMaxItemPrivilegedBytes(value);
-        } else if (key.compare("mem_merge_count_threshold") == 0) {
-            engine.stats.mem_merge_count_threshold = value;
         } else if (key.compare("mem_merge_bytes_threshold") == 0) {
-            engine.stats.mem_merge_bytes_threshold = value;
+            engine.stats.setMemMergeBytesThreshold(value);
         }
     }
 
@@ -1957,12 +1998,7 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
                 configuration.getMaxSize(), stats.mem_high_wat_percent.load()));
     }
 
-    stats.mem_merge_count_threshold = configuration.getMemMergeCountThreshold();
-    configuration.addValueChangedListener(
-            "mem_merge_count_threshold",
-            new EpEngineValueChangeListener(*this));
-
-    stats.mem_merge_bytes_threshold = configuration.getMemMergeBytesThreshold();
+    stats.setMemMergeBytesThreshold(configuration.getMemMergeBytesThreshold());
     configuration.addValueChangedListener(
             "mem_merge_bytes_threshold",
             new EpEngineValueChangeListener(*this));
@@ -2186,6 +2222,92 @@ cb::EngineErrorItemPair EventuallyPersistentEngine::get_and_touch(const void* co
     return cb::makeEngineErrorItemPair(cb::engine_errc(rv));
 }
 
+std::vector<cb::EngineErrorItemPair> EventuallyPersistentEngine::getMulti(
+        const void* cookie,
+        const std::vector<cb::GetMultiKey>& keys,
+        get_options_t options) {
+    auto* handle = reinterpret_cast<ENGINE_HANDLE*>(this);
+
+    std::vector<cb::EngineErrorItemPair> ret;
+    ret.reserve(keys.size());
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        ret.push_back(cb::makeEngineErrorItemPair(cb::engine_errc::success));
+    }
+
+    // Group the keys by vbucket, keeping their relative order
+    std::map<uint16_t, std::vector<size_t>> vbuckets;
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        vbuckets[keys[ii].vbucket].push_back(ii);
+    }
+
+    // Every operation we end up waiting for holds a reference on the batch,
+    // as do we until all of them have been issued. If an exception escapes
+    // our reference is never released, so the cookie isn't notified for a
+    // batch the core has given up on.
+    auto batch = std::make_shared<GetMultiBatch>(cookie);
+
+    bool blocked = false;
+    std::vector<DocKey> vbKeys;
+    for (const auto& vb : vbuckets) {
+        vbKeys.clear();
+        for (auto index : vb.second) {
+            vbKeys.push_back(keys[index].key);
+        }
+
+        const auto start = ProcessClock::now();
+        auto values = kvBucket->getMulti(vb.first, vbKeys, batch, options);
+        if (!values.empty()) {
+            // Keep get_cmd a per-key timing: each key of the vBucket's batch
+            // is recorded as taking its share of the batch's time.
+            const auto elapsed =
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            ProcessClock::now() - start)
+                            .count();
+            stats.getCmdHisto.add(elapsed / values.size(), values.size());
+        }
+        for (size_t ii = 0; ii < values.size(); ++ii) {
+            auto& gv = values[ii];
+            ENGINE_ERROR_CODE status = gv.getStatus();
+            if (status == ENGINE_SUCCESS) {
+                if (options & TRACK_STATISTICS) {
+                    ++stats.numOpsGet;
+                }
+                ret[vb.second[ii]] = cb::makeEngineErrorItemPair(
+                        cb::engine_errc::success, gv.item.release(), handle);
+                continue;
+            }
+
+            if (status == ENGINE_EWOULDBLOCK) {
+                blocked = true;
+            } else if ((status == ENGINE_KEY_ENOENT ||
+                        status == ENGINE_NOT_MY_VBUCKET) &&
+                       isDegradedMode()) {
+                status = ENGINE_TMPFAIL;
+            }
+            ret[vb.second[ii]] =
+                    cb::makeEngineErrorItemPair(cb::engine_errc(status));
+        }
+    }
+
+    // If everything we were waiting for has already completed, it's down to
+    // us to notify the cookie.
+    if (batch->release() && blocked) {
+        notifyIOComplete(cookie, ENGINE_SUCCESS);
+    }
+
+    return ret;
+}
+
+void EventuallyPersistentEngine::notifyIOComplete(const void* cookie,
+                                                  GetMultiBatch* batch,
+                                                  ENGINE_ERROR_CODE status) {
+    if (batch == nullptr) {
+        notifyIOComplete(cookie, status);
+    } else if (batch->release()) {
+        notifyIOComplete(cookie, ENGINE_SUCCESS);
+    }
+}
+
 cb::EngineErrorItemPair EventuallyPersistentEngine::get_if(const void* cookie,
                                                        const DocKey& key,
                                                        uint16_t vbucket,
@@ -3139,7 +3261,7 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(const void *cookie,
     add_casted_stat("ep_persist_vbstate_total",
                     epstats.totalPersistVBState, add_stat, cookie);
 
-    size_t memUsed =  stats.getTotalMemoryUsed();
+    size_t memUsed =  stats.getPreciseTotalMemoryUsed();
     add_casted_stat("mem_used", memUsed, add_stat, cookie);
     add_casted_stat("ep_mem_low_wat_percent", stats.mem_low_wat_percent,
                     add_stat, cookie);
@@ -3157,7 +3279,8 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(const void *cookie,
     add_casted_stat("ep_storedval_size", stats.totalStoredValSize,
                     add_stat, cookie);
 #if defined(HAVE_JEMALLOC) || defined(HAVE_TCMALLOC)
-    add_casted_stat("ep_storedval_overhead", stats.blobOverhead, add_stat, cookie);
+    add_casted_stat("ep_storedval_overhead", stats.storedValOverhead,
+                    add_stat, cookie);
 #else
     add_casted_stat("ep_storedval_overhead", "unknown", add_stat, cookie);
 #endif
@@ -3188,6 +3311,9 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(const void *cookie,
                     add_stat, cookie);
     add_casted_stat("ep_num_expiry_pager_runs", epstats.expiryPagerRuns,
                     add_stat, cookie);
+    add_casted_stat("ep_expiry_pager_items_visited",
+                    epstats.expiryPagerItemsVisited,
+                    add_stat, cookie);
     add_casted_stat("ep_items_rm_from_checkpoints",
                     epstats.itemsRemovedFromCheckpoints,
                     add_stat, cookie);
@@ -3387,8 +3513,11 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(const void *cookie,
 
 ENGINE_ERROR_CODE EventuallyPersistentEngine::doMemoryStats(const void *cookie,
                                                            ADD_STAT add_stat) {
-    add_casted_stat("bytes", stats.getTotalMemoryUsed(), add_stat, cookie);
-    add_casted_stat("mem_used", stats.getTotalMemoryUsed(), add_stat, cookie);
+    const size_t memUsed = stats.getPreciseTotalMemoryUsed();
+    add_casted_stat("bytes", memUsed, add_stat, cookie);
+    add_casted_stat("mem_used", memUsed, add_stat, cookie);
+    add_casted_stat("mem_used_estimate", stats.getTotalMemoryUsed(),
+                    add_stat, cookie);
     add_casted_stat("ep_kv_size", stats.currentSize, add_stat, cookie);
     add_casted_stat("ep_value_size", stats.totalValueSize, add_stat, cookie);
     add_casted_stat("ep_overhead", stats.memOverhead, add_stat, cookie);
@@ -3412,11 +3541,23 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doMemoryStats(const void *cookie,
     add_casted_stat("ep_storedval_size", stats.totalStoredValSize,
                     add_stat, cookie);
 #if defined(HAVE_JEMALLOC) || defined(HAVE_TCMALLOC)
-    add_casted_stat("ep_storedval_overhead", stats.blobOverhead, add_stat, cookie);
+    add_casted_stat("ep_storedval_overhead", stats.storedValOverhead,
+                    add_stat, cookie);
 #else
     add_casted_stat("ep_storedval_overhead", "unknown", add_stat, cookie);
 #endif
     add_casted_stat("ep_storedval_num", stats.numStoredVal, add_stat, cookie);
+
+    // Per-item metadata cost, to compare against the sizes reported by the
+    // 'sizes' tool.
+    const size_t fixedSize = configuration.getBucketType() == "ephemeral"
+                                     ? OrderedStoredValue::getKeyOffset()
+                                     : StoredValue::getKeyOffset();
+    add_casted_stat("ep_storedval_fixed_size", fixedSize, add_stat, cookie);
+    const size_t numStoredVal = stats.numStoredVal;
+    add_casted_stat("ep_storedval_avg_size",
+                    numStoredVal ? stats.totalStoredValSize / numStoredVal : 0,
+                    add_stat, cookie);
     add_casted_stat("ep_item_num", stats.numItem, add_stat, cookie);
 
     std::map<std::string, size_t> alloc_stats;
@@ -3516,7 +3657,7 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doHashStats(const void *cookie,
 
         void visitBucket(VBucketPtr &vb) override {
             uint16_t vbid = vb->getId();
-            char buf[32];
+            char buf[64];
             try {
                 checked_snprintf(buf, sizeof(buf), "vb_%d:state", vbid);
                 add_casted_stat(buf, VBucket::toString(vb->getState()),
@@ -3550,6 +3691,18 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doHashStats(const void *cookie,
                 add_casted_stat(buf, depthVisitor.size, add_stat, cookie);
                 checked_snprintf(buf, sizeof(buf), "vb_%d:resized", vbid);
                 add_casted_stat(buf, vb->ht.getNumResizes(), add_stat, cookie);
+                checked_snprintf(buf, sizeof(buf), "vb_%d:resize_target",
+                                 vbid);
+                add_casted_stat(buf, vb->ht.getResizeTargetSize(), add_stat,
+                                cookie);
+                checked_snprintf(buf, sizeof(buf),
+                                 "vb_%d:resize_chains_remaining", vbid);
+                add_casted_stat(buf, vb->ht.getResizeChainsRemaining(),
+                                add_stat, cookie);
+                checked_snprintf(buf, sizeof(buf),
+                                 "vb_%d:resize_chains_migrated", vbid);
+                add_casted_stat(buf, vb->ht.getNumResizeChainsMigrated(),
+                                add_stat, cookie);
                 checked_snprintf(buf, sizeof(buf), "vb_%d:mem_size", vbid);
                 add_casted_stat(buf, vb->ht.memSize, add_stat, cookie);
                 checked_snprintf(buf, sizeof(buf), "vb_%d:mem_size_counted",
@@ -3968,6 +4121,12 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doDcpStats(const void *cookie,
                     dcpConnMap_->getNumActiveSnoozingBackfills(), add_stat, cookie);
     add_casted_stat("ep_dcp_max_running_backfills",
                     dcpConnMap_->getMaxActiveSnoozingBackfills(), add_stat, cookie);
+    add_casted_stat("ep_dcp_compression_cache_hits",
+                    stats.dcpCompressionCacheHits, add_stat, cookie);
+    add_casted_stat("ep_dcp_compression_cache_misses",
+                    stats.dcpCompressionCacheMisses, add_stat, cookie);
+    add_casted_stat("ep_dcp_compression_saved_bytes",
+                    stats.dcpCompressionSavedBytes, add_stat, cookie);
 
     dcpConnMap_->addStats(add_stat, cookie);
     return ENGINE_SUCCESS;
@@ -4081,6 +4240,9 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doTimingStats(const void *cookie,
     add_casted_stat("checkpoint_remover", stats.checkpointRemoverHisto, add_stat, cookie);
     add_casted_stat("item_pager", stats.itemPagerHisto, add_stat, cookie);
     add_casted_stat("expiry_pager", stats.expiryPagerHisto, add_stat, cookie);
+    add_casted_stat("ht_resize_step", stats.htResizeStepHisto, add_stat, cookie);
+    add_casted_stat("ht_resize_lock_wait", stats.htResizeLockWaitHisto,
+                    add_stat, cookie);
 
     add_casted_stat("storage_age", stats.dirtyAgeHisto, add_stat, cookie);
 
@@ -4110,6 +4272,11 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doTimingStats(const void *cookie,
     add_casted_stat("disk_del", stats.diskDelHisto, add_stat, cookie);
     add_casted_stat("disk_vb_del", stats.diskVBDelHisto, add_stat, cookie);
     add_casted_stat("disk_commit", stats.diskCommitHisto, add_stat, cookie);
+    add_casted_stat("flusher_commit_items", stats.flusherCommitItemsHisto,
+                    add_stat, cookie);
+    add_casted_stat("flusher_commit_vbuckets",
+                    stats.flusherCommitVBucketsHisto,
+                    add_stat, cookie);
 
     add_casted_stat("item_alloc_sizes", stats.itemAllocSizeHisto,
                     add_stat, cookie);
@@ -163,7 +163,12 @@ public:
     void itemRelease(const void* cookie, item *itm)
     {
         (void)cookie;
-        delete (Item*)itm;
+        // DCP hands out queued items without copying them, holding a
+        // reference to them instead.
+        auto* it = reinterpret_cast<Item*>(itm);
+        if (it->releaseRawRef()) {
+            delete it;
+        }
     }
 
     ENGINE_ERROR_CODE get(const void* cookie,
@@ -190,6 +195,20 @@ public:
         return ret;
     }
 
+    /**
+     * Fetch a batch of items; see ENGINE_HANDLE_V1::get_multi.
+     *
+     * The keys are grouped by vbucket so each vbucket is only looked up
+     * (and its state lock acquired) once, and all of the background
+     * fetches needed for the batch are queued before returning. The
+     * fetches share a GetMultiBatch, so the cookie is notified once, when
+     * the last of them has completed.
+     */
+    std::vector<cb::EngineErrorItemPair> getMulti(
+            const void* cookie,
+            const std::vector<cb::GetMultiKey>& keys,
+            get_options_t options);
+
     /**
      * Fetch an item only if the specified filter predicate returns true.
      *
@@ -352,6 +371,19 @@ public:
         }
     }
 
+    /**
+     * Notify the cookie of a completed background fetch or pending op. If
+     * it was issued as part of a getMulti() batch, the cookie is only
+     * notified when the last of the batch's operations completes, and
+     * with ENGINE_SUCCESS - the keys are then retried individually and
+     * pick up any errors at that point.
+     *
+     * @param batch the batch the operation belongs to (may be null)
+     */
+    void notifyIOComplete(const void* cookie,
+                          GetMultiBatch* batch,
+                          ENGINE_ERROR_CODE status);
+
     ENGINE_ERROR_CODE reserveCookie(const void *cookie);
     ENGINE_ERROR_CODE releaseCookie(const void *cookie);
 
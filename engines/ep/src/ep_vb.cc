@@ -66,7 +66,8 @@ EPVBucket::EPVBucket(id_type i,
                                             ->getStorageProperties()
                                             .hasEfficientGet()
                                   : false),
-      shard(kvshard) {
+      shard(kvshard),
+      sharedDiskScans(std::make_shared<SharedDiskScanRegistry>()) {
 }
 
 EPVBucket::~EPVBucket() {
@@ -194,6 +195,12 @@ bool EPVBucket::hasPendingBGFetchItems() {
     return !pendingBGFetches.empty();
 }
 
+void EPVBucket::wakeBgFetcher(size_t fetches) {
+    if (multiBGFetchEnabled && getShard()) {
+        getShard()->getBgFetcher()->notifyBGEvent(fetches);
+    }
+}
+
 HighPriorityVBReqStatus EPVBucket::checkAddHighPriorityVBEntry(
         uint64_t seqnoOrChkId,
         const void* cookie,
@@ -233,7 +240,12 @@ void EPVBucket::notifyAllPendingConnsFailed(EventuallyPersistentEngine& e) {
         for (auto& bgf : pendingBGFetches) {
             vb_bgfetch_item_ctx_t& bg_itm_ctx = bgf.second;
             for (auto& bgitem : bg_itm_ctx.bgfetched_list) {
-                toNotify[bgitem->cookie] = ENGINE_NOT_MY_VBUCKET;
+                if (!bgitem->batch) {
+                    toNotify[bgitem->cookie] = ENGINE_NOT_MY_VBUCKET;
+                } else if (bgitem->batch->release()) {
+                    // Last outstanding fetch of a getMulti() batch
+                    toNotify[bgitem->cookie] = ENGINE_SUCCESS;
+                }
                 e.storeEngineSpecific(bgitem->cookie, nullptr);
                 ++num_of_deleted_pending_fetches;
             }
@@ -363,6 +375,14 @@ void EPVBucket::addStats(bool details, ADD_STAT add_stat, const void* c) {
                 getId(),
                 e.what());
         }
+        addStat("backfill_scans_shared",
+                sharedDiskScans->getNumJoined(),
+                add_stat,
+                c);
+        addStat("backfill_scan_bytes_saved",
+                sharedDiskScans->getBytesSaved(),
+                add_stat,
+                c);
     }
 }
 
@@ -483,15 +503,21 @@ void EPVBucket::bgFetch(const DocKey& key,
                         const void* cookie,
                         EventuallyPersistentEngine& engine,
                         const int bgFetchDelay,
-                        const bool isMeta) {
+                        const bool isMeta,
+                        const std::shared_ptr<GetMultiBatch>& batch) {
+    if (batch) {
+        batch->retain();
+    }
     if (multiBGFetchEnabled) {
         // schedule to the current batch of background fetch of the given
         // vbucket
         size_t bgfetch_size = queueBGFetchItem(
                 key,
-                std::make_unique<VBucketBGFetchItem>(cookie, isMeta),
+                std::make_unique<VBucketBGFetchItem>(cookie, isMeta, batch),
                 getShard()->getBgFetcher());
-        if (getShard()) {
+        // A getMulti() batch wakes the fetcher once it has queued all of
+        // its fetches (see wakeBgFetcher()).
+        if (getShard() && !batch) {
             getShard()->getBgFetcher()->notifyBGEvent();
         }
         LOG(EXTENSION_LOG_DEBUG,
@@ -503,8 +529,14 @@ void EPVBucket::bgFetch(const DocKey& key,
                 std::max(stats.maxRemainingBgJobs.load(),
                          stats.numRemainingBgJobs.load()));
         ExecutorPool* iom = ExecutorPool::get();
-        ExTask task = std::make_shared<SingleBGFetcherTask>(
-                &engine, key, getId(), cookie, isMeta, bgFetchDelay, false);
+        ExTask task = std::make_shared<SingleBGFetcherTask>(&engine,
+                                                            key,
+                                                            getId(),
+                                                            cookie,
+                                                            isMeta,
+                                                            bgFetchDelay,
+                                                            false,
+                                                            batch);
         iom->schedule(task);
         LOG(EXTENSION_LOG_DEBUG,
             "Queued a background fetch, now at %" PRIu64,
@@ -520,7 +552,8 @@ EPVBucket::addTempItemAndBGFetch(HashTable::HashBucketLock& hbl,
                                  EventuallyPersistentEngine& engine,
                                  int bgFetchDelay,
                                  bool metadataOnly,
-                                 bool isReplication) {
+                                 bool isReplication,
+                                 const std::shared_ptr<GetMultiBatch>& batch) {
     AddStatus rv = addTempStoredValue(hbl, key, isReplication);
     switch (rv) {
     case AddStatus::NoMem:
@@ -537,8 +570,12 @@ EPVBucket::addTempItemAndBGFetch(HashTable::HashBucketLock& hbl,
                 std::to_string(static_cast<uint16_t>(rv)));
 
     case AddStatus::BgFetch:
-        hbl.getHTLock().unlock();
-        bgFetch(key, cookie, engine, bgFetchDelay, metadataOnly);
+        // A getMulti() batch goes on to look up its other keys in this
+        // bucket under the same lock.
+        if (!batch) {
+            hbl.getHTLock().unlock();
+        }
+        bgFetch(key, cookie, engine, bgFetchDelay, metadataOnly, batch);
     }
     return ENGINE_EWOULDBLOCK;
 }
@@ -573,9 +610,10 @@ GetValue EPVBucket::getInternalNonResident(const DocKey& key,
                                            EventuallyPersistentEngine& engine,
                                            int bgFetchDelay,
                                            get_options_t options,
-                                           const StoredValue& v) {
+                                           const StoredValue& v,
+                                           const std::shared_ptr<GetMultiBatch>& batch) {
     if (options & QUEUE_BG_FETCH) {
-        bgFetch(key, cookie, engine, bgFetchDelay);
+        bgFetch(key, cookie, engine, bgFetchDelay, false, batch);
     } else if (options & get_options_t::ALLOW_META_ONLY) {
         // You can't both ask for a background fetch and just the meta...
         return GetValue(v.toItem(false, 0),
@@ -636,7 +674,8 @@ MutationStatus EPVBucket::insertFromWarmup(Item& itm,
             if (v->getCas() == 0) {
                 v->setCas(itm.getCas());
                 v->setFlags(itm.getFlags());
-                v->setExptime(itm.getExptime());
+                ht.unlocked_setExptime(
+                        hbl.getHTLock(), *v, itm.getExptime());
                 v->setRevSeqno(itm.getRevSeqno());
             } else {
                 return MutationStatus::InvalidCas;
@@ -56,6 +56,8 @@ public:
 
     bool hasPendingBGFetchItems() override;
 
+    void wakeBgFetcher(size_t fetches) override;
+
     HighPriorityVBReqStatus checkAddHighPriorityVBEntry(
             uint64_t seqnoOrChkId,
             const void* cookie,
@@ -93,7 +95,7 @@ public:
                                            uint64_t endSeqno) override {
         /* create a disk backfill object */
         return std::make_unique<DCPBackfillDisk>(
-                e, stream, startSeqno, endSeqno);
+                e, stream, sharedDiskScans, startSeqno, endSeqno);
     }
 
     uint64_t getPersistenceSeqno() const override {
@@ -181,16 +183,19 @@ private:
                  const void* cookie,
                  EventuallyPersistentEngine& engine,
                  int bgFetchDelay,
-                 bool isMeta = false) override;
+                 bool isMeta = false,
+                 const std::shared_ptr<GetMultiBatch>& batch = {}) override;
 
     ENGINE_ERROR_CODE
-    addTempItemAndBGFetch(HashTable::HashBucketLock& hbl,
-                          const DocKey& key,
-                          const void* cookie,
-                          EventuallyPersistentEngine& engine,
-                          int bgFetchDelay,
-                          bool metadataOnly,
-                          bool isReplication = false) override;
+    addTempItemAndBGFetch(
+            HashTable::HashBucketLock& hbl,
+            const DocKey& key,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            int bgFetchDelay,
+            bool metadataOnly,
+            bool isReplication = false,
+            const std::shared_ptr<GetMultiBatch>& batch = {}) override;
 
     /**
      * Helper function to update stats after completion of a background fetch
@@ -204,12 +209,14 @@ private:
                        const ProcessClock::time_point start,
                        const ProcessClock::time_point stop);
 
-    GetValue getInternalNonResident(const DocKey& key,
-                                    const void* cookie,
-                                    EventuallyPersistentEngine& engine,
-                                    int bgFetchDelay,
-                                    get_options_t options,
-                                    const StoredValue& v) override;
+    GetValue getInternalNonResident(
+            const DocKey& key,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            int bgFetchDelay,
+            get_options_t options,
+            const StoredValue& v,
+            const std::shared_ptr<GetMultiBatch>& batch) override;
 
     /* Indicates if multiple bg fetches are handled in a single bg fetch task */
     const bool multiBGFetchEnabled;
@@ -226,5 +233,11 @@ private:
      */
     std::atomic<uint64_t> deferredDeletionFileRevision;
 
+    /**
+     * The disk scans backfilling DCP streams from this vBucket, which
+     * concurrent backfills share when their ranges allow.
+     */
+    std::shared_ptr<SharedDiskScanRegistry> sharedDiskScans;
+
     friend class EPVBucketTest;
 };
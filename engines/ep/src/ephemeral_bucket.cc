@@ -287,6 +287,7 @@ void EphemeralBucket::appendAggregatedVBucketStats(VBucketCountVisitor& active,
             ephActive.seqlistStaleValueBytes);
     DO_STAT("vb_active_seqlist_stale_metadata_bytes",
             ephActive.seqlistStaleMetadataBytes);
+    DO_STAT("vb_active_seqlist_node_bytes", ephActive.seqlistNodeBytes);
 
     // Replica vBuckets:
     DO_STAT("vb_replica_auto_delete_count", ephReplica.autoDeleteCount);
@@ -299,6 +300,7 @@ void EphemeralBucket::appendAggregatedVBucketStats(VBucketCountVisitor& active,
             ephReplica.seqlistStaleValueBytes);
     DO_STAT("vb_replica_seqlist_stale_metadata_bytes",
             ephReplica.seqlistStaleMetadataBytes);
+    DO_STAT("vb_replica_seqlist_node_bytes", ephReplica.seqlistNodeBytes);
 
     // Pending vBuckets:
     DO_STAT("vb_pending_auto_delete_count", ephPending.autoDeleteCount);
@@ -311,6 +313,7 @@ void EphemeralBucket::appendAggregatedVBucketStats(VBucketCountVisitor& active,
             ephPending.seqlistStaleValueBytes);
     DO_STAT("vb_pending_seqlist_stale_metadata_bytes",
             ephPending.seqlistStaleMetadataBytes);
+    DO_STAT("vb_pending_seqlist_node_bytes", ephPending.seqlistNodeBytes);
 #undef DO_STAT
 }
 
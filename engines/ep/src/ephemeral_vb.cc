@@ -21,6 +21,7 @@
 #include "ephemeral_tombstone_purger.h"
 #include "failover-table.h"
 #include "linked_list.h"
+#include "skip_list.h"
 #include "stored_value_factories.h"
 #include "vbucket_bgfetch_item.h"
 #include "vbucketdeletiontask.h"
@@ -58,8 +59,14 @@ EphemeralVBucket::EphemeralVBucket(id_type i,
               purgeSeqno,
               maxCas,
               collectionsManifest),
-      seqList(std::make_unique<BasicLinkedList>(i, st)),
       backfillType(BackfillType::None) {
+    /* Get the data structure for the sequence list */
+    if (config.getEphemeralSeqlistType() == "skip_list") {
+        seqList = std::make_unique<SkipList>(i, st);
+    } else {
+        seqList = std::make_unique<BasicLinkedList>(i, st);
+    }
+
     /* Get the flow control policy */
     std::string dcpBackfillType = config.getDcpEphemeralBackfillType();
     if (!dcpBackfillType.compare("buffered")) {
@@ -149,6 +156,7 @@ void EphemeralVBucket::addStats(bool details,
                 seqList->getStaleValueBytes(),
                 add_stat,
                 c);
+        addStat("seqlist_node_bytes", seqList->getNodeBytes(), add_stat, c);
     }
 }
 
@@ -191,6 +199,13 @@ bool EphemeralVBucket::hasPendingBGFetchItems() {
             std::to_string(getId()));
 }
 
+void EphemeralVBucket::wakeBgFetcher(size_t fetches) {
+    throw std::logic_error(
+            "EphemeralVBucket::wakeBgFetcher() is not valid. "
+            "Called on vb " +
+            std::to_string(getId()));
+}
+
 HighPriorityVBReqStatus EphemeralVBucket::checkAddHighPriorityVBEntry(
         uint64_t seqnoOrChkId,
         const void* cookie,
@@ -258,8 +273,9 @@ EphemeralVBucket::inMemoryBackfill(uint64_t start, uint64_t end) {
     return seqList->rangeRead(start, end);
 }
 
-SequenceList::RangeIterator EphemeralVBucket::makeRangeIterator() {
-    return seqList->makeRangeIterator();
+boost::optional<SequenceList::RangeIterator>
+EphemeralVBucket::makeRangeIterator(seqno_t start) {
+    return seqList->makeRangeIterator(start);
 }
 
 /* Vb level backfill queue is for items in a huge snapshot (disk backfill
@@ -533,7 +549,8 @@ void EphemeralVBucket::bgFetch(const DocKey& key,
                                const void* cookie,
                                EventuallyPersistentEngine& engine,
                                const int bgFetchDelay,
-                               const bool isMeta) {
+                               const bool isMeta,
+                               const std::shared_ptr<GetMultiBatch>& batch) {
     throw std::logic_error(
             "EphemeralVBucket::bgFetch() is not valid. Called on vb " +
             std::to_string(getId()) + "for key: " +
@@ -547,7 +564,8 @@ EphemeralVBucket::addTempItemAndBGFetch(HashTable::HashBucketLock& hbl,
                                         EventuallyPersistentEngine& engine,
                                         int bgFetchDelay,
                                         bool metadataOnly,
-                                        bool isReplication) {
+                                        bool isReplication,
+                                        const std::shared_ptr<GetMultiBatch>& batch) {
     /* [EPHE TODO]: Just return error code and make all the callers handle it */
     throw std::logic_error(
             "EphemeralVBucket::addTempItemAndBGFetch() is not valid. "
@@ -562,7 +580,8 @@ GetValue EphemeralVBucket::getInternalNonResident(
         EventuallyPersistentEngine& engine,
         int bgFetchDelay,
         get_options_t options,
-        const StoredValue& v) {
+        const StoredValue& v,
+        const std::shared_ptr<GetMultiBatch>& batch) {
     /* We reach here only if the v is deleted and does not have any value */
     return GetValue();
 }
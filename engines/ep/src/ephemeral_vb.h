@@ -55,6 +55,8 @@ public:
 
     bool hasPendingBGFetchItems() override;
 
+    void wakeBgFetcher(size_t fetches) override;
+
     HighPriorityVBReqStatus checkAddHighPriorityVBEntry(
             uint64_t seqnoOrChkId,
             const void* cookie,
@@ -123,9 +125,16 @@ public:
     inMemoryBackfill(uint64_t start, uint64_t end);
 
     /**
-     * Returns a range iterator for the underlying SequenceList obj
+     * Returns a range iterator for the underlying SequenceList obj, positioned
+     * at the first item with seqno >= start.
+     *
+     * @param start seqno to seek to
+     *
+     * @return the iterator; boost::none if the SequenceList cannot have
+     *         another iterator at the moment (try again later)
      */
-    SequenceList::RangeIterator makeRangeIterator();
+    boost::optional<SequenceList::RangeIterator> makeRangeIterator(
+            seqno_t start);
 
     void dump() const override;
 
@@ -187,23 +196,28 @@ private:
                  const void* cookie,
                  EventuallyPersistentEngine& engine,
                  int bgFetchDelay,
-                 bool isMeta = false) override;
+                 bool isMeta = false,
+                 const std::shared_ptr<GetMultiBatch>& batch = {}) override;
 
     ENGINE_ERROR_CODE
-    addTempItemAndBGFetch(HashTable::HashBucketLock& hbl,
-                          const DocKey& key,
-                          const void* cookie,
-                          EventuallyPersistentEngine& engine,
-                          int bgFetchDelay,
-                          bool metadataOnly,
-                          bool isReplication = false) override;
-
-    GetValue getInternalNonResident(const DocKey& key,
-                                    const void* cookie,
-                                    EventuallyPersistentEngine& engine,
-                                    int bgFetchDelay,
-                                    get_options_t options,
-                                    const StoredValue& v) override;
+    addTempItemAndBGFetch(
+            HashTable::HashBucketLock& hbl,
+            const DocKey& key,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            int bgFetchDelay,
+            bool metadataOnly,
+            bool isReplication = false,
+            const std::shared_ptr<GetMultiBatch>& batch = {}) override;
+
+    GetValue getInternalNonResident(
+            const DocKey& key,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            int bgFetchDelay,
+            get_options_t options,
+            const StoredValue& v,
+            const std::shared_ptr<GetMultiBatch>& batch) override;
 
     /**
      * (i) Updates an already non-temp element in the sequence list (OR)
@@ -37,5 +37,6 @@ void EphemeralVBucket::CountVisitor::visitBucket(VBucketPtr& vb) {
         seqlistStaleCount += ephVB.seqList->getNumStaleItems();
         seqlistStaleValueBytes += ephVB.seqList->getStaleValueBytes();
         seqlistStaleMetadataBytes += ephVB.seqList->getStaleMetadataBytes();
+        seqlistNodeBytes += ephVB.seqList->getNodeBytes();
     }
 }
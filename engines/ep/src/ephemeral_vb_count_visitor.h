@@ -41,4 +41,5 @@ public:
     uint64_t seqlistStaleCount = 0;
     size_t seqlistStaleValueBytes = 0;
     size_t seqlistStaleMetadataBytes = 0;
+    size_t seqlistNodeBytes = 0;
 };
@@ -31,6 +31,7 @@
 #include <chrono>
 #include <queue>
 #include <sstream>
+#include <thread>
 
 std::mutex ExecutorPool::initGuard;
 std::atomic<ExecutorPool*> ExecutorPool::instance;
@@ -295,16 +296,92 @@ void ExecutorPool::doneWork(task_type_t taskType) {
     }
 }
 
+ExecutorPool::TaskLocatorReader::TaskLocatorReader(TaskLocatorShard& shard) {
+    // Register under the current epoch before loading the map. If a writer
+    // bumped the epoch meanwhile it may not wait for us, so try again.
+    while (true) {
+        const uint64_t epoch = shard.epoch.load();
+        count = &shard.readers[epoch % 2];
+        (*count)++;
+        if (shard.epoch.load() == epoch) {
+            break;
+        }
+        (*count)--;
+    }
+    map = shard.tasks.load();
+}
+
+bool ExecutorPool::findTask(size_t taskId, TaskQpair& found) {
+    TaskLocatorReader reader(getTaskLocatorShard(taskId));
+    auto itr = reader.tasks().find(taskId);
+    if (itr == reader.tasks().end()) {
+        return false;
+    }
+    found = itr->second;
+    return true;
+}
+
+std::unique_ptr<const ExecutorPool::TaskLocatorMap>
+ExecutorPool::publishTaskLocatorShard_UNLOCKED(
+        TaskLocatorShard& shard, std::unique_ptr<TaskLocatorMap> tasks) {
+    std::unique_ptr<const TaskLocatorMap> old(
+            shard.tasks.exchange(tasks.release()));
+    // Readers registering from now on see the new map; wait for those
+    // which registered before (they only do a lookup).
+    const uint64_t epoch = shard.epoch++;
+    while (shard.readers[epoch % 2] != 0) {
+        std::this_thread::yield();
+    }
+    return old;
+}
+
+size_t ExecutorPool::getNumTasks() {
+    size_t count = 0;
+    for (auto& shard : taskLocator) {
+        TaskLocatorReader reader(shard);
+        count += reader.tasks().size();
+    }
+    return count;
+}
+
+std::map<size_t, TaskQpair> ExecutorPool::copyTaskLocator() {
+    std::map<size_t, TaskQpair> copy;
+    for (auto& shard : taskLocator) {
+        TaskLocatorReader reader(shard);
+        copy.insert(reader.tasks().begin(), reader.tasks().end());
+    }
+    return copy;
+}
+
+ProcessClock::time_point ExecutorPool::getEarliestWaketime(
+        task_type_t qType) {
+    auto waketime = ProcessClock::time_point::max();
+    if (isHiPrioQset) {
+        waketime = std::min(waketime, hpTaskQ[qType]->getEarliestWaketime());
+    }
+    if (isLowPrioQset) {
+        waketime = std::min(waketime, lpTaskQ[qType]->getEarliestWaketime());
+    }
+    return waketime;
+}
+
 bool ExecutorPool::_cancel(size_t taskId, bool eraseTask) {
-    LockHolder lh(tMutex);
-    std::map<size_t, TaskQpair>::iterator itr = taskLocator.find(taskId);
-    if (itr == taskLocator.end()) {
+    // Erasing happens once per task, so (unlike cancel / wake) can afford
+    // tMutex; it serialises changes to the taskLocator and is needed to
+    // signal the erase to waiters on tMutex.
+    std::unique_ptr<const TaskLocatorMap> replaced; // freed after unlocking
+    std::unique_lock<std::mutex> tlh(tMutex, std::defer_lock);
+    if (eraseTask) {
+        tlh.lock();
+    }
+    TaskQpair tqp;
+    if (!findTask(taskId, tqp)) {
         LOG(EXTENSION_LOG_DEBUG, "Task id %" PRIu64 " not found",
             uint64_t(taskId));
         return false;
     }
 
-    ExTask task = itr->second.first;
+    ExTask task = tqp.first;
     LOG(EXTENSION_LOG_DEBUG,
         "Cancel task %.*s id %" PRIu64 " on bucket %s %s",
         int(task->getDescription().size()),
@@ -322,12 +399,16 @@ bool ExecutorPool::_cancel(size_t taskId, bool eraseTask) {
                                    "' is not dead after calling "
                                    "cancel() on it");
         }
-        taskLocator.erase(itr);
+        auto& shard = getTaskLocatorShard(taskId);
+        std::unique_ptr<TaskLocatorMap> tasks(
+                new TaskLocatorMap(*shard.tasks.load()));
+        tasks->erase(taskId);
+        replaced = publishTaskLocatorShard_UNLOCKED(shard, std::move(tasks));
         tMutex.notify_all();
     } else { // wake up the task from the TaskQ so a thread can safely erase it
              // otherwise we may race with unregisterTaskable where a unlocated
              // task runs in spite of its bucket getting unregistered
-        itr->second.second->wake(task);
+        tqp.second->wake(task);
     }
     return true;
 }
@@ -340,10 +421,9 @@ bool ExecutorPool::cancel(size_t taskId, bool eraseTask) {
 }
 
 bool ExecutorPool::_wake(size_t taskId) {
-    LockHolder lh(tMutex);
-    std::map<size_t, TaskQpair>::iterator itr = taskLocator.find(taskId);
-    if (itr != taskLocator.end()) {
-        itr->second.second->wake(itr->second.first);
+    TaskQpair tqp;
+    if (findTask(taskId, tqp)) {
+        tqp.second->wake(tqp.first);
         return true;
     }
     return false;
@@ -357,10 +437,9 @@ bool ExecutorPool::wake(size_t taskId) {
 }
 
 bool ExecutorPool::_snooze(size_t taskId, double toSleep) {
-    LockHolder lh(tMutex);
-    std::map<size_t, TaskQpair>::iterator itr = taskLocator.find(taskId);
-    if (itr != taskLocator.end()) {
-        itr->second.second->snooze(itr->second.first, toSleep);
+    TaskQpair tqp;
+    if (findTask(taskId, tqp)) {
+        tqp.second->snooze(tqp.first, toSleep);
         return true;
     }
     return false;
@@ -431,6 +510,7 @@ TaskQueue* ExecutorPool::_getTaskQueue(const Taskable& t,
 }
 
 size_t ExecutorPool::_schedule(ExTask task) {
+    std::unique_ptr<const TaskLocatorMap> replaced; // freed after unlocking
     LockHolder lh(tMutex);
     const size_t taskId = task->getId();
 
@@ -438,11 +518,15 @@ size_t ExecutorPool::_schedule(ExTask task) {
                                  GlobalTask::getTaskType(task->getTypeId()));
     TaskQpair tqp(task, q);
 
-    auto result = taskLocator.insert(std::make_pair(taskId, tqp));
-
-    if (result.second) {
-        // tqp was inserted; it was not already present. Prevents multiple
-        // copies of a task being present in the task queues.
+    auto& shard = getTaskLocatorShard(taskId);
+    const TaskLocatorMap* tasks = shard.tasks.load();
+    if (tasks->count(taskId) == 0) {
+        // Not already present. Prevents multiple copies of a task being
+        // present in the task queues.
+        std::unique_ptr<TaskLocatorMap> newTasks(new TaskLocatorMap(*tasks));
+        newTasks->insert(std::make_pair(taskId, tqp));
+        replaced =
+                publishTaskLocatorShard_UNLOCKED(shard, std::move(newTasks));
         q->schedule(task);
     }
 
@@ -485,8 +569,8 @@ void ExecutorPool::_registerTaskable(Taskable& taskable) {
         if (!(*whichQset)) {
             taskQ->reserve(numTaskSets);
             for (size_t i = 0; i < numTaskSets; ++i) {
-                taskQ->push_back(
-                        new TaskQueue(this, (task_type_t)i, queueName));
+                taskQ->push_back(new TaskQueue(
+                        this, (task_type_t)i, queueName, maxGlobalThreads));
             }
             *whichQset = true;
         }
@@ -631,31 +715,34 @@ bool ExecutorPool::_stopTaskGroup(task_gid_t taskGID,
                                   bool force) {
     bool unfinishedTask;
     bool retVal = false;
-    std::map<size_t, TaskQpair>::iterator itr;
 
     std::unique_lock<std::mutex> lh(tMutex);
     do {
         ExTask task;
         unfinishedTask = false;
-        for (itr = taskLocator.begin(); itr != taskLocator.end(); itr++) {
-            task = itr->second.first;
-            TaskQueue *q = itr->second.second;
-            if (task->getTaskable().getGID() == taskGID &&
-                (taskType == NO_TASK_TYPE || q->queueType == taskType)) {
-                LOG(EXTENSION_LOG_NOTICE,
-                    "Stopping Task id %" PRIu64 " %s %.*s",
-                    uint64_t(task->getId()),
-                    task->getTaskable().getName().c_str(),
-                    int(task->getDescription().size()),
-                    task->getDescription().data());
-                // If force flag is set during shutdown, cancel all tasks
-                // without considering the blockShutdown status of the task.
-                if (force || !task->blockShutdown) {
-                    task->cancel(); // Must be idempotent
+        // We hold tMutex, so the taskLocator can't change under us.
+        for (auto& shard : taskLocator) {
+            for (auto& pair : *shard.tasks.load()) {
+                task = pair.second.first;
+                TaskQueue* q = pair.second.second;
+                if (task->getTaskable().getGID() == taskGID &&
+                    (taskType == NO_TASK_TYPE || q->queueType == taskType)) {
+                    LOG(EXTENSION_LOG_NOTICE,
+                        "Stopping Task id %" PRIu64 " %s %.*s",
+                        uint64_t(task->getId()),
+                        task->getTaskable().getName().c_str(),
+                        int(task->getDescription().size()),
+                        task->getDescription().data());
+                    // If force flag is set during shutdown, cancel all tasks
+                    // without considering the blockShutdown status of the
+                    // task.
+                    if (force || !task->blockShutdown) {
+                        task->cancel(); // Must be idempotent
+                    }
+                    q->wake(task);
+                    unfinishedTask = true;
+                    retVal = true;
                 }
-                q->wake(task);
-                unfinishedTask = true;
-                retVal = true;
             }
         }
         if (unfinishedTask) {
@@ -685,7 +772,7 @@ void ExecutorPool::_unregisterTaskable(Taskable& taskable, bool force) {
     LockHolder lh(tMutex);
     taskOwners.erase(&taskable);
     if (!(--numBuckets)) {
-        if (taskLocator.size()) {
+        if (getNumTasks()) {
             throw std::logic_error("ExecutorPool::_unregisterTaskable: "
                     "Attempting to unregister taskable '" +
                     taskable.getName() + "' but taskLocator is not empty");
@@ -757,13 +844,6 @@ void ExecutorPool::doTaskQStat(EventuallyPersistentEngine *engine,
                 add_casted_stat(statname, hpTaskQ[i]->getReadyQueueSize(),
                                 add_stat,
                                 cookie);
-                size_t pendingQsize = hpTaskQ[i]->getPendingQueueSize();
-                if (pendingQsize > 0) {
-                    checked_snprintf(statname, sizeof(statname),
-                                     "ep_workload:%s:PendingQ",
-                                     hpTaskQ[i]->getName().c_str());
-                    add_casted_stat(statname, pendingQsize, add_stat, cookie);
-                }
             }
         }
         if (isLowPrioQset) {
@@ -780,13 +860,6 @@ void ExecutorPool::doTaskQStat(EventuallyPersistentEngine *engine,
                 add_casted_stat(statname, lpTaskQ[i]->getReadyQueueSize(),
                                 add_stat,
                                 cookie);
-                size_t pendingQsize = lpTaskQ[i]->getPendingQueueSize();
-                if (pendingQsize > 0) {
-                    checked_snprintf(statname, sizeof(statname),
-                                     "ep_workload:%s:PendingQ",
-                                     lpTaskQ[i]->getName().c_str());
-                    add_casted_stat(statname, pendingQsize, add_stat, cookie);
-                }
             }
         }
     } catch (std::exception& error) {
@@ -896,16 +969,9 @@ void ExecutorPool::doTasksStat(EventuallyPersistentEngine* engine,
     EventuallyPersistentEngine* epe =
             ObjectRegistry::onSwitchThread(NULL, true);
 
-    std::map<size_t, TaskQpair> taskLocatorCopy;
-
-    {
-        // Holding this lock will block scheduling new tasks and cancelling
-        // tasks, but threads can still take up work other than this
-        LockHolder lh(tMutex);
-
-        // Copy taskLocator
-        taskLocatorCopy = taskLocator;
-    }
+    // Copy taskLocator; each shard's lock is only held while copying it,
+    // so this blocks scheduling / cancelling tasks on that shard briefly
+    std::map<size_t, TaskQpair> taskLocatorCopy = copyTaskLocator();
 
     char statname[80] = {0};
     char prefix[] = "ep_tasks";
@@ -23,9 +23,9 @@
  * Under the covers we have a configurable number of system threads that are
  * labeled with a type (see task_type_t). These threads service all buckets.
  *
- * Each thread operates by reading from a shared TaskQueue. Each thread wakes
- * up and fetches (TaskQueue::fetchNextTask) a task for execution
- * (GlobalTask::run() is called to execute the task).
+ * Each thread operates by reading from a TaskQueue shared by the threads of
+ * its type. Each thread wakes up and fetches (TaskQueue::fetchNextTask) a
+ * task for execution (GlobalTask::run() is called to execute the task).
  *
  * The pool also has the concept of high and low priority which is achieved by
  * having two TaskQueue objects per task-type. When a thread wakes up to run
@@ -34,10 +34,12 @@
  *
  * Within a single queue itself there is also a task priority. The task priority
  * is a value where lower is better. When many tasks are ready for execution
- * they are moved to a ready queue and sorted by their priority. Thus tasks
- * with priority 0 get to go before tasks with priority 1. Only once the ready
- * queue of tasks is empty will we consider looking for more eligible tasks.
- * In this context, an eligible task is one that has a wakeTime <= now.
+ * they are moved to the ready queue of the thread which found them and sorted
+ * by their priority. Thus tasks with priority 0 get to go before tasks with
+ * priority 1. Each thread has its own ready queue; a thread whose ready queue
+ * is empty steals the highest priority task from its siblings' ready queues,
+ * and only once they are all empty will we consider looking for more eligible
+ * tasks. In this context, an eligible task is one that has a wakeTime <= now.
  *
  * === Important methods of the ExecutorPool ===
  *
@@ -58,6 +60,8 @@
  *   signaled to wake-up and perform fetching. The woken task will have to wait
  *   for any current tasks to be executed first, but it will jump ahead of other
  *   tasks as tasks that are ready to run are ordered by their priority.
+ *   Neither wake nor snooze take the pool's or the TaskQueue's mutex (the
+ *   latter only if there is a sleeping thread to signal).
  *
  * ExecutorPool::snooze(size_t taskId, double toSleep)
  *   The pool's snooze method will locate the task matching taskId and adjust
@@ -72,8 +76,13 @@
 #include "task_type.h"
 #include "taskable.h"
 
+#include <array>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 // Forward decl
 class TaskQueue;
@@ -107,6 +116,9 @@ public:
         numSleepers--;
     }
 
+    /// @return the waketime of the earliest future task of the given type
+    ProcessClock::time_point getEarliestWaketime(task_type_t qType);
+
     TaskQueue *nextTask(ExecutorThread &t, uint8_t tick);
 
     TaskQueue *getSleepQ(unsigned int curTaskType) {
@@ -195,6 +207,10 @@ public:
 
     size_t getNumReadyTasks(void) { return totReadyTasks; }
 
+    size_t getNumReadyTasks(task_type_t qType) {
+        return numReadyTasks[qType];
+    }
+
     size_t getNumSleepers(void) { return numSleepers; }
 
     size_t schedule(ExTask task);
@@ -222,6 +238,77 @@ protected:
     TaskQueue* _getTaskQueue(const Taskable& t, task_type_t qidx);
     void _stopAndJoinThreads();
 
+    typedef std::unordered_map<size_t, TaskQpair> TaskLocatorMap;
+
+    /**
+     * One shard of the task locator; tasks are spread over the shards by
+     * id. Waking, snoozing and cancelling a task (which happens at a high
+     * rate, e.g. for every DCP notification) look the task up without
+     * taking any lock: a shard's map is immutable once published, and
+     * writers (schedule and the final erase, serialised by tMutex) publish
+     * a modified copy, bump the epoch and wait for the readers registered
+     * under the previous epoch before freeing the replaced map.
+     */
+    struct TaskLocatorShard {
+        TaskLocatorShard() : tasks(new TaskLocatorMap()), epoch(0) {
+            readers[0] = 0;
+            readers[1] = 0;
+        }
+        ~TaskLocatorShard() {
+            delete tasks.load();
+        }
+
+        std::atomic<const TaskLocatorMap*> tasks;
+        std::atomic<uint64_t> epoch;
+        // readers looking at the map, by the parity of the epoch they saw
+        std::array<std::atomic<size_t>, 2> readers;
+    };
+
+    /**
+     * Registers the caller as a reader of a shard, for its lifetime, and
+     * gives access to the shard's current map.
+     */
+    class TaskLocatorReader {
+    public:
+        TaskLocatorReader(TaskLocatorShard& shard);
+        ~TaskLocatorReader() {
+            (*count)--;
+        }
+
+        const TaskLocatorMap& tasks() const {
+            return *map;
+        }
+
+    private:
+        std::atomic<size_t>* count;
+        const TaskLocatorMap* map;
+    };
+
+    TaskLocatorShard& getTaskLocatorShard(size_t taskId) {
+        return taskLocator[taskId % taskLocator.size()];
+    }
+
+    /**
+     * Look up a task without taking any lock.
+     * @return true and set 'found' if the task is in the locator
+     */
+    bool findTask(size_t taskId, TaskQpair& found);
+
+    /**
+     * Replace the map of the shard with 'tasks'; caller must hold tMutex.
+     * @return the replaced map, which no reader can see any more. It holds
+     *         references to tasks (whose destruction may schedule tasks), so
+     *         free it after releasing tMutex.
+     */
+    std::unique_ptr<const TaskLocatorMap> publishTaskLocatorShard_UNLOCKED(
+            TaskLocatorShard& shard, std::unique_ptr<TaskLocatorMap> tasks);
+
+    /// @return the number of tasks in the locator
+    size_t getNumTasks();
+
+    /// @return a copy of the task locator, ordered by task id
+    std::map<size_t, TaskQpair> copyTaskLocator();
+
     size_t numTaskSets; // safe to read lock-less not altered after creation
     size_t maxGlobalThreads;
 
@@ -229,7 +316,8 @@ protected:
     SyncObject mutex; // Thread management condition var + mutex
 
     //! A mapping of task ids to Task, TaskQ in the thread pool
-    std::map<size_t, TaskQpair> taskLocator;
+    static const size_t TASK_LOCATOR_SHARDS = 32;
+    std::array<TaskLocatorShard, TASK_LOCATOR_SHARDS> taskLocator;
 
     //A list of threads
     ThreadQ threadQ;
@@ -243,7 +331,10 @@ protected:
 
     size_t numBuckets;
 
-    SyncObject tMutex; // to serialize taskLocator, threadQ, numBuckets access
+    // to serialize threadQ, numBuckets, task queue set up access and
+    // changes to the taskLocator, and signalled when a task is erased from
+    // the taskLocator.
+    SyncObject tMutex;
 
     std::atomic<uint16_t> numSleepers; // total number of sleeping threads
     std::atomic<uint16_t> *curWorkers; // track # of active workers per TaskSet
@@ -27,6 +27,8 @@
 #include "taskqueue.h"
 #include "ep_engine.h"
 
+std::atomic<size_t> ExecutorThread::nextReadyQueueIdx(0);
+
 extern "C" {
     static void launch_executor_thread(void *arg) {
         ExecutorThread *executor = (ExecutorThread*) arg;
@@ -93,7 +93,8 @@ public:
           now(ProcessClock::now()),
           waketime(ProcessClock::time_point::max()),
           taskStart(),
-          currentTask(NULL) {
+          currentTask(NULL),
+          readyQueueIdx(nextReadyQueueIdx++) {
     }
 
     ~ExecutorThread() {
@@ -168,6 +169,11 @@ public:
         now.setTimePoint(ProcessClock::now());
     }
 
+    /// @return which of a TaskQueue's ready queues this thread owns
+    size_t getReadyQueueIdx() const {
+        return readyQueueIdx;
+    }
+
 protected:
 
     cb_thread_t thread;
@@ -188,4 +194,9 @@ protected:
     std::mutex logMutex;
     cb::RingBuffer<TaskLogEntry, TASK_LOG_SIZE> tasklog;
     cb::RingBuffer<TaskLogEntry, TASK_LOG_SIZE> slowjobs;
+
+    // Threads are handed out ready queues round-robin, so consecutively
+    // created threads (e.g. the workers of one type) get different ones.
+    const size_t readyQueueIdx;
+    static std::atomic<size_t> nextReadyQueueIdx;
 };
@@ -0,0 +1,114 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "expiry_index.h"
+
+#include "stats.h"
+
+ExpiryIndex::ExpiryIndex(EPStats& st)
+    : stats(st), numEntries(0), memUsage(0) {
+}
+
+ExpiryIndex::~ExpiryIndex() {
+    stats.memOverhead->fetch_sub(memUsage);
+}
+
+void ExpiryIndex::add(const DocKey& key, time_t exptime) {
+    std::lock_guard<std::mutex> lh(mutex);
+    auto bucket = buckets.find(exptime);
+    if (bucket == buckets.end()) {
+        bucket = buckets.emplace(exptime, std::unordered_set<StoredDocKey>())
+                         .first;
+        updateMemoryUsage(bucketSize());
+    }
+    if (bucket->second.emplace(key).second) {
+        ++numEntries;
+        updateMemoryUsage(entrySize(key));
+    }
+}
+
+void ExpiryIndex::remove(const DocKey& key, time_t exptime) {
+    std::lock_guard<std::mutex> lh(mutex);
+    auto bucket = buckets.find(exptime);
+    if (bucket == buckets.end()) {
+        return;
+    }
+    if (bucket->second.erase(StoredDocKey(key)) > 0) {
+        --numEntries;
+        updateMemoryUsage(-ssize_t(entrySize(key)));
+    }
+    if (bucket->second.empty()) {
+        buckets.erase(bucket);
+        updateMemoryUsage(-ssize_t(bucketSize()));
+    }
+}
+
+void ExpiryIndex::takeDue(time_t asOf, std::vector<StoredDocKey>& keys) {
+    std::lock_guard<std::mutex> lh(mutex);
+    auto end = buckets.lower_bound(asOf);
+    size_t freed = 0;
+    for (auto bucket = buckets.begin(); bucket != end; ++bucket) {
+        for (const auto& key : bucket->second) {
+            freed += entrySize(key);
+        }
+        freed += bucketSize();
+        keys.insert(keys.end(), bucket->second.begin(), bucket->second.end());
+        numEntries -= bucket->second.size();
+    }
+    buckets.erase(buckets.begin(), end);
+    updateMemoryUsage(-ssize_t(freed));
+}
+
+void ExpiryIndex::clear() {
+    std::lock_guard<std::mutex> lh(mutex);
+    buckets.clear();
+    numEntries = 0;
+    updateMemoryUsage(-ssize_t(memUsage));
+}
+
+size_t ExpiryIndex::size() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return numEntries;
+}
+
+size_t ExpiryIndex::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return memUsage;
+}
+
+size_t ExpiryIndex::entrySize(const DocKey& key) {
+    // A hash node (next pointer, cached hash and the StoredDocKey), its
+    // share of the bucket array, and the key (+ namespace) bytes.
+    return 2 * sizeof(void*) + sizeof(size_t) + sizeof(StoredDocKey) +
+           key.size() + 1;
+}
+
+size_t ExpiryIndex::bucketSize() {
+    // A red-black tree node (colour, parent, left & right) holding the
+    // expiry time and an empty unordered_set.
+    return 4 * sizeof(void*) + sizeof(time_t) +
+           sizeof(std::unordered_set<StoredDocKey>);
+}
+
+void ExpiryIndex::updateMemoryUsage(ssize_t delta) {
+    memUsage += delta;
+    if (delta >= 0) {
+        stats.memOverhead->fetch_add(delta);
+    } else {
+        stats.memOverhead->fetch_sub(-delta);
+    }
+}
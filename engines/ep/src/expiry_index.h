@@ -0,0 +1,91 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "storeddockey.h"
+
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+class EPStats;
+
+/**
+ * An index of the keys of a HashTable which have an expiry time, ordered by
+ * that time, allowing the expiry pager to find the items which are due to
+ * expire without visiting every item in the HashTable.
+ *
+ * Keys are held in buckets, one per expiry time (in seconds); the buckets
+ * are kept in expiry time order. The index is only a hint: an entry may be
+ * stale (the item may since have been deleted, or its expiry time changed),
+ * so the consumer must check the item itself before expiring it.
+ *
+ * The (estimated) memory used by the index is accounted in
+ * EPStats::memOverhead.
+ *
+ * Thread-safe.
+ */
+class ExpiryIndex {
+public:
+    explicit ExpiryIndex(EPStats& st);
+
+    ~ExpiryIndex();
+
+    /// Record that the item with the given key expires at exptime.
+    void add(const DocKey& key, time_t exptime);
+
+    /// Remove the entry added by add(key, exptime), if present.
+    void remove(const DocKey& key, time_t exptime);
+
+    /**
+     * Remove the entries of all of the items expiring before asOf (i.e.
+     * which StoredValue::isExpired(asOf) would consider expired) from the
+     * index.
+     *
+     * @param asOf the current time
+     * @param keys the keys of the items removed are appended to this
+     */
+    void takeDue(time_t asOf, std::vector<StoredDocKey>& keys);
+
+    /// Remove all entries.
+    void clear();
+
+    /// @return the number of entries in the index
+    size_t size() const;
+
+    /// @return the (estimated) number of bytes used by the index
+    size_t getMemoryUsage() const;
+
+private:
+    /// Estimated memory used by the entry of the given key.
+    static size_t entrySize(const DocKey& key);
+
+    /// Estimated memory used by a (empty) bucket.
+    static size_t bucketSize();
+
+    /// Adjust memUsage (and EPStats::memOverhead) by delta bytes.
+    void updateMemoryUsage(ssize_t delta);
+
+    EPStats& stats;
+    mutable std::mutex mutex;
+    std::map<time_t, std::unordered_set<StoredDocKey>> buckets;
+    size_t numEntries;
+    size_t memUsage;
+};
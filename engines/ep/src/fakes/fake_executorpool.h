@@ -77,9 +77,14 @@ public:
      * Mark all tasks as cancelled and remove the from the locator.
      */
     void cancelAndClearAll() {
+        std::vector<std::unique_ptr<const TaskLocatorMap>> replaced;
         LockHolder lh(tMutex);
         cancelAll_UNLOCKED();
-        taskLocator.clear();
+        for (auto& shard : taskLocator) {
+            replaced.push_back(publishTaskLocatorShard_UNLOCKED(
+                    shard,
+                    std::unique_ptr<TaskLocatorMap>(new TaskLocatorMap())));
+        }
     }
 
        /*
@@ -95,11 +100,13 @@ public:
      */
     void cancelByName(cb::const_char_buffer name) {
         LockHolder lh(tMutex);
-        for (auto& it : taskLocator) {
-            if (it.second.first->getDescription() == name) {
-                it.second.first->cancel();
-                // And force awake so he is "runnable"
-                it.second.second->wake(it.second.first);
+        for (auto& shard : taskLocator) {
+            for (auto it : *shard.tasks.load()) {
+                if (it.second.first->getDescription() == name) {
+                    it.second.first->cancel();
+                    // And force awake so he is "runnable"
+                    it.second.second->wake(it.second.first);
+                }
             }
         }
     }
@@ -108,20 +115,18 @@ public:
         return totReadyTasks;
     }
 
-    size_t getNumReadyTasks(task_type_t qType) {
-        return numReadyTasks[qType];
-    }
-
     std::map<size_t, TaskQpair> getTaskLocator() {
-        return taskLocator;
+        return copyTaskLocator();
     };
 
 private:
     void cancelAll_UNLOCKED() {
-        for (auto& it : taskLocator) {
-            it.second.first->cancel();
-            // And force awake so he is "runnable"
-            it.second.second->wake(it.second.first);
+        for (auto& shard : taskLocator) {
+            for (auto it : *shard.tasks.load()) {
+                it.second.first->cancel();
+                // And force awake so he is "runnable"
+                it.second.second->wake(it.second.first);
+            }
         }
     }
 };
@@ -272,6 +272,24 @@ void Flusher::flushVB(void) {
         if (store->flushVBucket(vbid) == RETRY_FLUSH_VBUCKET) {
             hpVbs.push(vbid);
         }
+    } else if (store->getFlusherGroupCommitMaxVBuckets() > 1 &&
+               store->getStorageProperties().hasGroupCommit()) {
+        // Group commit: flush as many low priority vbuckets as allowed
+        // together, re-queueing any which weren't flushed.
+        std::vector<uint16_t> vbids;
+        while (!lpVbs.empty() &&
+               vbids.size() < store->getFlusherGroupCommitMaxVBuckets()) {
+            if (doHighPriority && --numHighPriority == 0) {
+                doHighPriority = false;
+            }
+            vbids.push_back(lpVbs.front());
+            lpVbs.pop();
+        }
+        std::vector<uint16_t> requeue;
+        store->flushVBuckets(vbids, requeue);
+        for (auto vbid : requeue) {
+            lpVbs.push(vbid);
+        }
     } else {
         if (doHighPriority && --numHighPriority == 0) {
             doHighPriority = false;
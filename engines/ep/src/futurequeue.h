@@ -63,6 +63,32 @@ public:
         return queue.empty();
     }
 
+    /*
+     * Pop the top() task if its wakeTime is not after 'now'.
+     * @returns the popped task, or an empty ExTask if no task is due.
+     */
+    ExTask popDue(ProcessClock::time_point now) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.empty() || queue.top()->getWaketime() > now) {
+            return ExTask();
+        }
+        ExTask task = queue.top();
+        queue.pop();
+        return task;
+    }
+
+    /*
+     * @returns the wakeTime of the top() task, or time_point::max() if the
+     * queue is empty.
+     */
+    ProcessClock::time_point topWaketime() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.empty()) {
+            return ProcessClock::time_point::max();
+        }
+        return queue.top()->getWaketime();
+    }
+
     /*
      * Update the wakeTime of task and ensure the heap property is
      * maintained.
@@ -21,6 +21,7 @@
 #include "stats.h"
 #include "stored_value_factories.h"
 
+#include <algorithm>
 #include <cstring>
 
 static const ssize_t prime_size_table[] = {
@@ -36,10 +37,36 @@ std::ostream& operator<<(std::ostream& os, const HashTable::Position& pos) {
     return os;
 }
 
+static size_t nextPowerOfTwo(size_t n) {
+    size_t rv = 1;
+    while (rv < n) {
+        rv <<= 1;
+    }
+    return rv;
+}
+
+HashTable::TagIndex::TagIndex(size_t buckets)
+    : storage(new uint8_t[(buckets * sizeof(TagBlock)) + 63]()) {
+    auto addr = reinterpret_cast<uintptr_t>(storage.get());
+    blocks = reinterpret_cast<TagBlock*>((addr + 63) & ~uintptr_t(63));
+}
+
+HashTable::Layout HashTable::layoutFromString(const std::string& name) {
+    if (name == "chained") {
+        return Layout::Chained;
+    }
+    if (name == "tagged") {
+        return Layout::Tagged;
+    }
+    throw std::invalid_argument("HashTable::layoutFromString: unknown layout '" +
+                                name + "'");
+}
+
 HashTable::HashTable(EPStats& st,
                      std::unique_ptr<AbstractStoredValueFactory> svFactory,
                      size_t initialSize,
-                     size_t locks)
+                     size_t locks,
+                     Layout layout)
     : maxDeletedRevSeqno(0),
       numTotalItems(0),
       numNonResidentItems(0),
@@ -49,17 +76,33 @@ HashTable::HashTable(EPStats& st,
       memSize(0),
       cacheSize(0),
       metaDataMemory(0),
-      initialSize(initialSize),
-      size(initialSize),
+      layout(layout),
+      initialSize(layout == Layout::Tagged ? nextPowerOfTwo(initialSize)
+                                           : initialSize),
+      size(this->initialSize),
       n_locks(locks),
+      expiryIndex(st),
       stats(st),
       valFact(std::move(svFactory)),
       visitors(0),
       numItems(0),
       numResizes(0),
-      numTempItems(0) {
+      numTempItems(0),
+      resizeSize(0),
+      resizeCursor(0),
+      resizeActive(false),
+      numResizeChainsMigrated(0) {
     values.resize(size);
+    if (layout == Layout::Tagged) {
+        tagIndex = TagIndex(size);
+    }
     mutexes = new std::mutex[n_locks];
+    freqCounters.reserve(n_locks);
+    for (size_t ii = 0; ii < n_locks; ++ii) {
+        freqCounters.emplace_back(
+                ProbabilisticCounter<uint8_t>::defaultIncFactor,
+                uint32_t(ii + 1));
+    }
     activeState = true;
 }
 
@@ -86,6 +129,7 @@ void HashTable::clear(bool deactivate) {
                     "non-active object");
         }
     }
+    std::lock_guard<std::mutex> rlh(resizeMutex);
     MultiLockHolder mlh(mutexes, n_locks);
     clear_UNLOCKED(deactivate);
 }
@@ -96,19 +140,39 @@ void HashTable::clear_UNLOCKED(bool deactivate) {
     }
     size_t clearedMemSize = 0;
     size_t clearedValSize = 0;
-    for (int i = 0; i < (int)size; i++) {
-        while (values[i]) {
+    for (size_t i = 0; i < totalBuckets(); i++) {
+        auto& chain = chainForBucket(i);
+        while (chain) {
             // Take ownership of the StoredValue from the vector, update
             // statistics and release it.
-            auto v = std::move(values[i]);
+            auto v = std::move(chain);
             clearedMemSize += v->size();
             clearedValSize += v->valuelen();
-            values[i] = std::move(v->getNext());
+            chain = std::move(v->getNext());
+        }
+    }
+
+    // Abandon any in-progress incremental resize; the table is empty so
+    // there is nothing left to migrate. (When deactivating, the owner
+    // accounts for the whole of memorySize() itself.)
+    if (isResizing()) {
+        if (!deactivate) {
+            stats.memOverhead->fetch_sub(resizeSize * bucketOverhead());
         }
+        resizeSize.store(0);
+        resizeCursor.store(0);
+        resizeValues = table_type();
+        resizeTagIndex = TagIndex();
+        resizeActive.store(false);
+    }
+    if (layout == Layout::Tagged && !deactivate) {
+        tagIndex = TagIndex(size);
     }
 
     stats.currentSize.fetch_sub(clearedMemSize - clearedValSize);
 
+    expiryIndex.clear();
+
     datatypeCounts.fill(0);
     numTotalItems.store(0);
     numItems.store(0);
@@ -132,7 +196,23 @@ static bool isCurrently(size_t size, ssize_t a, ssize_t b) {
 }
 
 void HashTable::resize() {
+    resize(getPreferredSize());
+}
+
+size_t HashTable::getPreferredSize() {
     size_t ni = getNumInMemoryItems();
+
+    if (layout == Layout::Tagged) {
+        // Aim for TargetLoad items per bucket; only move once we are more
+        // than a factor of two (grow) or four (shrink) away from it so that
+        // the power-of-two size remains stable.
+        const size_t wanted = ni / TagBlock::TargetLoad;
+        if (wanted > 2 * size || wanted < size / 4) {
+            return std::max(initialSize, nextPowerOfTwo(wanted));
+        }
+        return size;
+    }
+
     int i(0);
     size_t new_size(0);
 
@@ -159,7 +239,14 @@ void HashTable::resize() {
         new_size = nearest(ni, prime_size_table[i-1], prime_size_table[i]);
     }
 
-    resize(new_size);
+    return new_size;
+}
+
+size_t HashTable::normaliseSize(size_t requested) const {
+    if (layout == Layout::Tagged) {
+        return nextPowerOfTwo(requested);
+    }
+    return requested;
 }
 
 void HashTable::resize(size_t newSize) {
@@ -168,54 +255,209 @@ void HashTable::resize(size_t newSize) {
                 "non-active object");
     }
 
+    newSize = normaliseSize(newSize);
+
     // Due to the way hashing works, we can't fit anything larger than
     // an int.
     if (newSize > static_cast<size_t>(std::numeric_limits<int>::max())) {
         return;
     }
 
+    std::lock_guard<std::mutex> rlh(resizeMutex);
+
     // Don't resize to the same size, either.
-    if (newSize == size) {
+    if (newSize == size && !isResizing()) {
         return;
     }
 
-    MultiLockHolder mlh(mutexes, n_locks);
     if (visitors.load() > 0) {
         // Do not allow a resize while any visitors are actually
         // processing.  The next attempt will have to pick it up.  New
-        // visitors cannot start doing meaningful work (we own all
-        // locks at this point).
+        // visitors cannot start doing meaningful work (we own the
+        // resizeMutex at this point).
         return;
     }
 
     // Get a place for the new items.
     table_type newValues(newSize);
+    TagIndex newTagIndex;
+    if (layout == Layout::Tagged) {
+        newTagIndex = TagIndex(newSize);
+    }
+
+    resizeActive.store(true);
+    MultiLockHolder mlh(mutexes, n_locks);
 
     stats.memOverhead->fetch_sub(memorySize());
     ++numResizes;
 
-    // Set the new size so all the hashy stuff works.
-    size_t oldSize = size;
-    size.store(newSize);
-
-    // Move existing records into the new space.
-    for (size_t i = 0; i < oldSize; i++) {
-        while (values[i]) {
-            // unlink the front element from the hash chain at values[i].
-            auto v = std::move(values[i]);
-            values[i] = std::move(v->getNext());
+    // Move existing records (from both bucket arrays, if an incremental
+    // resize was in progress) into the new space.
+    for (size_t i = 0; i < totalBuckets(); i++) {
+        auto& chain = chainForBucket(i);
+        while (chain) {
+            // unlink the front element from the hash chain.
+            auto v = std::move(chain);
+            chain = std::move(v->getNext());
 
             // And re-link it into the correct place in newValues.
-            int newBucket = getBucketForHash(v->getKey().hash());
+            int newBucket = bucketForHash(v->getKey().hash(), newSize);
+            if (layout == Layout::Tagged) {
+                tagBlockInsert(newTagIndex[newBucket], v.get());
+            }
             v->setNext(std::move(newValues[newBucket]));
             newValues[newBucket] = std::move(v);
         }
     }
 
-    // Finally assign the new table to values.
+    // Finally assign the new table to values and set the new size so all
+    // the hashy stuff works.
     values = std::move(newValues);
+    tagIndex = std::move(newTagIndex);
+    resizeValues = table_type();
+    resizeTagIndex = TagIndex();
+    resizeSize.store(0);
+    resizeCursor.store(0);
+    size.store(newSize);
 
     stats.memOverhead->fetch_add(memorySize());
+    resizeActive.store(false);
+}
+
+bool HashTable::beginIncrementalResize(size_t newSize) {
+    if (!isActive()) {
+        throw std::logic_error("HashTable::beginIncrementalResize: Cannot "
+                "call on a non-active object");
+    }
+
+    newSize = normaliseSize(newSize);
+
+    // Due to the way hashing works, we can't fit anything larger than
+    // an int.
+    if (newSize > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> rlh(resizeMutex);
+    if (newSize == size || isResizing() || visitors.load() > 0) {
+        return false;
+    }
+
+    // No hash bucket locks are needed to install the resize target - until
+    // resizeCursor is advanced no key maps to it.
+    resizeValues = table_type(newSize);
+    if (layout == Layout::Tagged) {
+        resizeTagIndex = TagIndex(newSize);
+    }
+    resizeCursor.store(0);
+    resizeSize.store(newSize);
+    resizeActive.store(true);
+    stats.memOverhead->fetch_add(newSize * bucketOverhead());
+    return true;
+}
+
+bool HashTable::continueIncrementalResize(size_t maxChains) {
+    std::lock_guard<std::mutex> rlh(resizeMutex);
+    if (!isResizing() || !isActive() || visitors.load() > 0) {
+        // Visitors assume the bucket layout is stable while they run; the
+        // next attempt will pick up where we left off.
+        return false;
+    }
+
+    const auto start = ProcessClock::now();
+    for (size_t moved = 0; moved < maxChains && resizeCursor < size;
+         ++moved) {
+        migrateNextChain();
+    }
+    if (resizeCursor == size) {
+        completeIncrementalResize();
+    }
+    stats.htResizeStepHisto.add(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    ProcessClock::now() - start)
+                    .count());
+    return true;
+}
+
+void HashTable::migrateNextChain() {
+    const size_t oldBucket = resizeCursor;
+    const size_t oldLock = oldBucket % n_locks;
+    const size_t target = resizeSize;
+
+    // Hold the old bucket's lock for the whole migration so that no front
+    // end thread can observe the chain half-moved. The destination buckets'
+    // locks are acquired (one at a time) while holding it; this cannot
+    // deadlock as front end threads only ever hold a single hash bucket lock,
+    // and all multi-lock holders first acquire resizeMutex.
+    std::lock_guard<std::mutex> olh(mutexes[oldLock]);
+    while (values[oldBucket]) {
+        auto v = std::move(values[oldBucket]);
+        values[oldBucket] = std::move(v->getNext());
+
+        const int newBucket = bucketForHash(v->getKey().hash(), target);
+        const size_t newLock = newBucket % n_locks;
+        std::unique_lock<std::mutex> nlh;
+        if (newLock != oldLock) {
+            nlh = std::unique_lock<std::mutex>(mutexes[newLock]);
+        }
+        if (layout == Layout::Tagged) {
+            tagBlockInsert(resizeTagIndex[newBucket], v.get());
+        }
+        v->setNext(std::move(resizeValues[newBucket]));
+        resizeValues[newBucket] = std::move(v);
+    }
+    if (layout == Layout::Tagged) {
+        tagIndex[oldBucket] = TagBlock();
+    }
+
+    // Publish the migration before releasing the old bucket's lock.
+    resizeCursor.store(oldBucket + 1);
+    ++numResizeChainsMigrated;
+}
+
+void HashTable::completeIncrementalResize() {
+    MultiLockHolder mlh(mutexes, n_locks);
+    const size_t oldSize = size;
+
+    values = std::move(resizeValues);
+    tagIndex = std::move(resizeTagIndex);
+    resizeValues = table_type();
+    resizeTagIndex = TagIndex();
+    size.store(resizeSize);
+    resizeSize.store(0);
+    resizeCursor.store(0);
+    ++numResizes;
+
+    stats.memOverhead->fetch_sub(oldSize * bucketOverhead());
+    resizeActive.store(false);
+}
+
+HashTable::HashBucketLock HashTable::getLockedBucketForHashDuringResize(int h) {
+    const auto start = ProcessClock::now();
+    auto hbl = lockBucketForHash(h);
+    stats.htResizeLockWaitHisto.add(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    ProcessClock::now() - start)
+                    .count());
+    return hbl;
+}
+
+size_t HashTable::firstBucketForLock(size_t lock) const {
+    if (lock < size) {
+        return lock;
+    }
+    return std::min(size + lock, totalBuckets());
+}
+
+size_t HashTable::nextBucketForLock(size_t bucket_num, size_t lock) const {
+    const size_t primary = size;
+    size_t next = bucket_num + n_locks;
+    if (bucket_num < primary && next >= primary) {
+        // Move on to the first bucket of the resize target (if any) which is
+        // guarded by this lock.
+        next = primary + lock;
+    }
+    return std::min(next, totalBuckets());
 }
 
 StoredValue* HashTable::find(const DocKey& key,
@@ -231,13 +473,14 @@ StoredValue* HashTable::find(const DocKey& key,
 
 std::unique_ptr<Item> HashTable::getRandomKey(long rnd) {
     /* Try to locate a partition */
-    size_t start = rnd % size;
+    const size_t buckets = totalBuckets();
+    size_t start = rnd % buckets;
     size_t curr = start;
     std::unique_ptr<Item> ret;
 
     do {
         ret = getRandomKeyFromSlot(curr++);
-        if (curr == size) {
+        if (curr == buckets) {
             curr = 0;
         }
     } while (ret == NULL && curr != start);
@@ -326,7 +569,11 @@ StoredValue* HashTable::unlocked_addNewStoredValue(const HashBucketLock& hbl,
     }
 
     // Create a new StoredValue and link it into the head of the bucket chain.
-    auto v = (*valFact)(itm, std::move(values[hbl.getBucketNum()]));
+    auto& chain = chainForBucket(hbl.getBucketNum());
+    auto v = (*valFact)(itm, std::move(chain));
+    if (layout == Layout::Tagged) {
+        tagBlockInsert(tagBlockForBucket(hbl.getBucketNum()), v.get());
+    }
     increaseMetaDataSize(stats, v->metaDataSize());
     increaseCacheSize(v->size());
 
@@ -340,9 +587,10 @@ StoredValue* HashTable::unlocked_addNewStoredValue(const HashBucketLock& hbl,
     if (v->isDeleted()) {
         ++numDeletedItems;
     }
-    values[hbl.getBucketNum()] = std::move(v);
+    updateExpiryIndex(*v, 0);
+    chain = std::move(v);
 
-    return values[hbl.getBucketNum()].get();
+    return chain.get();
 }
 
 std::pair<StoredValue*, StoredValue::UniquePtr>
@@ -364,23 +612,28 @@ HashTable::unlocked_replaceByCopy(const HashBucketLock& hbl,
     auto releasedSv = unlocked_release(hbl, vToCopy.getKey());
 
     /* Copy the StoredValue and link it into the head of the bucket chain. */
-    auto newSv = valFact->copyStoredValue(
-            vToCopy, std::move(values[hbl.getBucketNum()]));
+    auto& chain = chainForBucket(hbl.getBucketNum());
+    auto newSv = valFact->copyStoredValue(vToCopy, std::move(chain));
+    if (layout == Layout::Tagged) {
+        tagBlockInsert(tagBlockForBucket(hbl.getBucketNum()), newSv.get());
+    }
     if (newSv->isTempItem()) {
         ++numTempItems;
     } else {
         ++numItems;
         ++numTotalItems;
     }
-    values[hbl.getBucketNum()] = std::move(newSv);
+    updateExpiryIndex(*newSv, 0);
+    chain = std::move(newSv);
 
-    return {values[hbl.getBucketNum()].get(), std::move(releasedSv)};
+    return {chain.get(), std::move(releasedSv)};
 }
 
 void HashTable::unlocked_softDelete(const std::unique_lock<std::mutex>& htLock,
                                     StoredValue& v,
                                     bool onlyMarkDeleted) {
     const bool alreadyDeleted = v.isDeleted();
+    const time_t oldIndexedExptime = indexedExptime(v);
     if (!v.isResident() && !v.isDeleted() && !v.isTempItem()) {
         decrNumNonResidentItems();
     }
@@ -403,27 +656,79 @@ void HashTable::unlocked_softDelete(const std::unique_lock<std::mutex>& htLock,
     if (!alreadyDeleted) {
         ++numDeletedItems;
     }
+    updateExpiryIndex(v, oldIndexedExptime);
 }
 
 StoredValue* HashTable::unlocked_find(const DocKey& key,
                                       int bucket_num,
                                       WantsDeleted wantsDeleted,
                                       TrackReference trackReference) {
-    for (StoredValue* v = values[bucket_num].get(); v; v = v->getNext().get()) {
-        if (v->hasKey(key)) {
-            if (trackReference == TrackReference::Yes && !v->isDeleted()) {
-                v->referenced();
-            }
-            if (wantsDeleted == WantsDeleted::Yes || !v->isDeleted()) {
-                return v;
-            } else {
-                return NULL;
-            }
+    StoredValue* v = findInBucket(key, bucket_num);
+    if (v) {
+        if (trackReference == TrackReference::Yes && !v->isDeleted()) {
+            v->referenced();
+            auto& counter = freqCounters[mutexForBucket(bucket_num)];
+            v->setFreqCounterValue(
+                    counter.generateValue(v->getFreqCounterValue()));
+        }
+        if (wantsDeleted == WantsDeleted::Yes || !v->isDeleted()) {
+            return v;
         }
     }
     return NULL;
 }
 
+StoredValue* HashTable::findInBucket(const DocKey& key, size_t bucket_num) {
+    if (layout == Layout::Tagged) {
+        const TagBlock& block = tagBlockForBucket(bucket_num);
+        const uint16_t tag = tagForHash(key.hash());
+        for (size_t i = 0; i < TagBlock::Slots; ++i) {
+            if (block.tags[i] == tag && block.values[i] &&
+                block.values[i]->hasKey(key)) {
+                return block.values[i];
+            }
+        }
+        if (block.overflow == 0) {
+            // Every StoredValue in the chain is in the block.
+            return nullptr;
+        }
+    }
+
+    for (StoredValue* v = chainForBucket(bucket_num).get(); v;
+         v = v->getNext().get()) {
+        if (v->hasKey(key)) {
+            return v;
+        }
+    }
+    return nullptr;
+}
+
+void HashTable::tagBlockInsert(TagBlock& block, StoredValue* v) {
+    for (size_t i = 0; i < TagBlock::Slots; ++i) {
+        if (!block.values[i]) {
+            block.values[i] = v;
+            block.tags[i] = tagForHash(v->getKey().hash());
+            return;
+        }
+    }
+    ++block.overflow;
+}
+
+void HashTable::tagBlockRemove(TagBlock& block, const StoredValue* v) {
+    for (size_t i = 0; i < TagBlock::Slots; ++i) {
+        if (block.values[i] == v) {
+            block.values[i] = nullptr;
+            return;
+        }
+    }
+    if (block.overflow == 0) {
+        throw std::logic_error(
+                "HashTable::tagBlockRemove: StoredValue not present in "
+                "TagBlock and no overflow recorded");
+    }
+    --block.overflow;
+}
+
 void HashTable::unlocked_del(const HashBucketLock& hbl, const DocKey& key) {
     unlocked_release(hbl, key).reset();
 }
@@ -444,7 +749,7 @@ StoredValue::UniquePtr HashTable::unlocked_release(
 
     // Remove the first (should only be one) StoredValue with the given key.
     auto released = hashChainRemoveFirst(
-            values[hbl.getBucketNum()],
+            chainForBucket(hbl.getBucketNum()),
             [key](const StoredValue* v) { return v->hasKey(key); });
 
     if (!released) {
@@ -454,6 +759,14 @@ StoredValue::UniquePtr HashTable::unlocked_release(
                 "HashTable::unlocked_del: StoredValue to be deleted "
                 "not found in HashTable; possibly HashTable leak");
     }
+    if (layout == Layout::Tagged) {
+        tagBlockRemove(tagBlockForBucket(hbl.getBucketNum()), released.get());
+    }
+
+    const time_t exptime = indexedExptime(*released);
+    if (exptime != 0) {
+        expiryIndex.remove(released->getKey(), exptime);
+    }
 
     // Update statistics now the item has been removed.
     reduceCacheSize(released->size());
@@ -476,21 +789,23 @@ void HashTable::visit(HashTableVisitor &visitor) {
         return;
     }
 
-    // Acquire one (any) of the mutexes before incrementing {visitors}, this
+    // Acquire the resizeMutex before incrementing {visitors}, this
     // prevents any race between this visitor and the HashTable resizer.
     // See comments in pauseResumeVisit() for further details.
-    std::unique_lock<std::mutex> lh(mutexes[0]);
+    std::unique_lock<std::mutex> lh(resizeMutex);
     VisitorTracker vt(&visitors);
     lh.unlock();
 
     size_t visited = 0;
     for (int l = 0; isActive() && l < static_cast<int>(n_locks); l++) {
-        for (int i = l; i < static_cast<int>(size); i+= n_locks) {
+        for (int i = firstBucketForLock(l);
+             i < static_cast<int>(totalBuckets());
+             i = nextBucketForLock(i, l)) {
             // (re)acquire mutex on each HashBucket, to minimise any impact
             // on front-end threads.
             HashBucketLock lh(i, mutexes[l]);
 
-            StoredValue* v = values[i].get();
+            StoredValue* v = chainForBucket(i).get();
             if (v) {
                 // TODO: Perf: This check seems costly - do we think it's still
                 // worth keeping?
@@ -518,13 +833,17 @@ void HashTable::visitDepth(HashTableDepthVisitor &visitor) {
         return;
     }
     size_t visited = 0;
+    std::unique_lock<std::mutex> rlh(resizeMutex);
     VisitorTracker vt(&visitors);
+    rlh.unlock();
 
     for (int l = 0; l < static_cast<int>(n_locks); l++) {
         LockHolder lh(mutexes[l]);
-        for (int i = l; i < static_cast<int>(size); i+= n_locks) {
+        for (int i = firstBucketForLock(l);
+             i < static_cast<int>(totalBuckets());
+             i = nextBucketForLock(i, l)) {
             size_t depth = 0;
-            StoredValue* p = values[i].get();
+            StoredValue* p = chainForBucket(i).get();
             if (p) {
                 // TODO: Perf: This check seems costly - do we think it's still
                 // worth keeping?
@@ -567,9 +886,10 @@ HashTable::Position HashTable::pauseResumeVisit(HashTableVisitor& visitor,
     // the HashTable may be changed (by the Resizer task) between us first
     // reading it to calculate the starting hash_bucket, and then reading it
     // inside the inner for() loop. To prevent this race, we explicitly acquire
-    // (any) mutex, increment {visitors} and then release the mutex. This
-    //avoids the race as if visitors >0 then Resizer will not attempt to resize.
-    std::unique_lock<std::mutex> lh(mutexes[0]);
+    // the resizeMutex, increment {visitors} and then release the mutex. This
+    // avoids the race as if visitors >0 then Resizer will not attempt to
+    // resize (or take a step of an incremental resize).
+    std::unique_lock<std::mutex> lh(resizeMutex);
     VisitorTracker vt(&visitors);
     lh.unlock();
 
@@ -581,20 +901,21 @@ HashTable::Position HashTable::pauseResumeVisit(HashTableVisitor& visitor,
 
         // If the bucket position is *this* lock, then start from the
         // recorded bucket (as long as we haven't resized).
-        hash_bucket = lock;
+        hash_bucket = firstBucketForLock(lock);
         if (start_pos.lock == lock &&
             start_pos.ht_size == size &&
-            start_pos.hash_bucket < size) {
+            start_pos.hash_bucket < totalBuckets()) {
             hash_bucket = start_pos.hash_bucket;
         }
 
         // Iterate across all values in the hash buckets owned by this lock.
         // Note: we don't record how far into the bucket linked-list we
         // pause at; so any restart will begin from the next bucket.
-        for (; !paused && hash_bucket < size; hash_bucket += n_locks) {
+        for (; !paused && hash_bucket < totalBuckets();
+             hash_bucket = nextBucketForLock(hash_bucket, lock)) {
             HashBucketLock lh(lock, mutexes[lock]);
 
-            StoredValue* v = values[hash_bucket].get();
+            StoredValue* v = chainForBucket(hash_bucket).get();
             while (!paused && v) {
                 StoredValue* tmp = v->getNext().get();
                 paused = !visitor.visit(lh, *v);
@@ -605,7 +926,7 @@ HashTable::Position HashTable::pauseResumeVisit(HashTableVisitor& visitor,
         // If the visitor paused us before we visited all hash buckets owned
         // by this lock, we don't want to skip the remaining hash buckets, so
         // stop the outer for loop from advancing to the next lock.
-        if (paused && hash_bucket < size) {
+        if (paused && hash_bucket < totalBuckets()) {
             break;
         }
 
@@ -648,8 +969,17 @@ bool HashTable::unlocked_ejectItem(StoredValue*& vptr,
 
             // Remove the item from the hash table.
             auto removed = hashChainRemoveFirst(
-                    values[bucket_num],
+                    chainForBucket(bucket_num),
                     [vptr](const StoredValue* v) { return v == vptr; });
+            if (layout == Layout::Tagged) {
+                tagBlockRemove(tagBlockForBucket(bucket_num), removed.get());
+            }
+            // Only resident metadata is indexed; expired items on disk are
+            // left to compaction.
+            const time_t exptime = indexedExptime(*removed);
+            if (exptime != 0) {
+                expiryIndex.remove(removed->getKey(), exptime);
+            }
 
             if (removed->isResident()) {
                 ++stats.numValueEjects;
@@ -673,7 +1003,12 @@ bool HashTable::unlocked_ejectItem(StoredValue*& vptr,
 
 std::unique_ptr<Item> HashTable::getRandomKeyFromSlot(int slot) {
     auto lh = getLockedBucket(slot);
-    for (StoredValue* v = values[slot].get(); v; v = v->getNext().get()) {
+    if (static_cast<size_t>(slot) >= totalBuckets()) {
+        // Table was resized since the slot was chosen.
+        return nullptr;
+    }
+    for (StoredValue* v = chainForBucket(slot).get(); v;
+         v = v->getNext().get()) {
         if (!v->isTempItem() && !v->isDeleted() && v->isResident()) {
             return v->toItem(false, 0);
         }
@@ -701,7 +1036,9 @@ bool HashTable::unlocked_restoreValue(
         decrNumNonResidentItems();
     }
 
+    const time_t oldIndexedExptime = indexedExptime(v);
     v.restoreValue(itm);
+    updateExpiryIndex(v, oldIndexedExptime);
 
     increaseCacheSize(v.getValue()->length());
     return true;
@@ -722,7 +1059,9 @@ void HashTable::unlocked_restoreMeta(const std::unique_lock<std::mutex>& htLock,
                 "call on a non-active HT object");
     }
 
+    const time_t oldIndexedExptime = indexedExptime(v);
     v.restoreMeta(itm);
+    updateExpiryIndex(v, oldIndexedExptime);
     if (!itm.isDeleted()) {
         --numTempItems;
         ++numItems;
@@ -731,6 +1070,44 @@ void HashTable::unlocked_restoreMeta(const std::unique_lock<std::mutex>& htLock,
     }
 }
 
+void HashTable::unlocked_setExptime(const std::unique_lock<std::mutex>& htLock,
+                                    StoredValue& v,
+                                    time_t exptime) {
+    if (!htLock) {
+        throw std::invalid_argument(
+                "HashTable::unlocked_setExptime: htLock "
+                "not held");
+    }
+
+    const time_t oldIndexedExptime = indexedExptime(v);
+    v.setExptime(exptime);
+    updateExpiryIndex(v, oldIndexedExptime);
+}
+
+void HashTable::unlocked_reindexExpiry(
+        const std::unique_lock<std::mutex>& htLock, const StoredValue& v) {
+    if (!htLock) {
+        throw std::invalid_argument(
+                "HashTable::unlocked_reindexExpiry: htLock "
+                "not held");
+    }
+
+    updateExpiryIndex(v, 0);
+}
+
+void HashTable::updateExpiryIndex(const StoredValue& v,
+                                  time_t oldIndexedExptime) {
+    const time_t newIndexedExptime = indexedExptime(v);
+    if (oldIndexedExptime != 0 && oldIndexedExptime != newIndexedExptime) {
+        expiryIndex.remove(v.getKey(), oldIndexedExptime);
+    }
+    // Re-add even if unchanged: the expiry pager may have just taken the
+    // entry from the index.
+    if (newIndexedExptime != 0) {
+        expiryIndex.add(v.getKey(), newIndexedExptime);
+    }
+}
+
 void HashTable::increaseCacheSize(size_t by) {
     cacheSize.fetch_add(by);
     memSize.fetch_add(by);
@@ -752,9 +1129,11 @@ void HashTable::reduceMetaDataSize(EPStats &st, size_t by) {
 }
 
 void HashTable::setValue(const Item& itm, StoredValue& v) {
+    const time_t oldIndexedExptime = indexedExptime(v);
     reduceCacheSize(v.size());
     v.setValue(itm);
     increaseCacheSize(v.size());
+    updateExpiryIndex(v, oldIndexedExptime);
 }
 
 std::ostream& operator<<(std::ostream& os, const HashTable& ht) {
@@ -762,11 +1141,13 @@ std::ostream& operator<<(std::ostream& os, const HashTable& ht) {
        << " numInMemory:" << ht.getNumInMemoryItems()
        << " numDeleted:" << ht.getNumDeletedItems()
        << " values: " << std::endl;
-    for (const auto& chain : ht.values) {
-        if (chain) {
-            for (StoredValue* sv = chain.get(); sv != nullptr;
-                 sv = sv->getNext().get()) {
-                os << "    " << *sv << std::endl;
+    for (const auto* table : {&ht.values, &ht.resizeValues}) {
+        for (const auto& chain : *table) {
+            if (chain) {
+                for (StoredValue* sv = chain.get(); sv != nullptr;
+                     sv = sv->getNext().get()) {
+                    os << "    " << *sv << std::endl;
+                }
             }
         }
     }
@@ -18,12 +18,18 @@
 #pragma once
 
 #include "config.h"
+#include "expiry_index.h"
+#include "probabilistic_counter.h"
 #include "storeddockey.h"
 #include "stored-value.h"
 
 #include <platform/histogram.h>
 #include <platform/non_negative_counter.h>
 
+#include <array>
+#include <memory>
+#include <vector>
+
 class AbstractStoredValueFactory;
 class HashTableStatVisitor;
 class HashTableVisitor;
@@ -87,6 +93,26 @@ enum class AddStatus : uint16_t {
 class HashTable {
 public:
 
+    /**
+     * How the buckets of the HashTable are laid out.
+     */
+    enum class Layout : uint8_t {
+        /**
+         * Each bucket is the head of a chain of StoredValues; the bucket for
+         * a key is hash modulo a (prime) table size. Every probe walks the
+         * chain.
+         */
+        Chained,
+        /**
+         * As Chained, but the number of buckets is a power of two (the bucket
+         * is selected by masking a mixed hash), and each bucket additionally
+         * has a cache-line sized block of (hash tag, StoredValue*) pairs
+         * indexing its chain. A probe checks the tags in the block first, so
+         * a hit typically costs two cache misses and a miss one.
+         */
+        Tagged
+    };
+
     /**
      * Represents a position within the hashtable.
      *
@@ -147,6 +173,12 @@ public:
 
         HashBucketLock(const HashBucketLock& other) = delete;
 
+        HashBucketLock& operator=(HashBucketLock&& other) {
+            bucketNum = other.bucketNum;
+            htLock = std::move(other.htLock);
+            return *this;
+        }
+
         int getBucketNum() const {
             return bucketNum;
         }
@@ -170,21 +202,37 @@ public:
      * @param st the global stats reference
      * @param svFactory Factory to use for constructing stored values
      * @param initialSize the number of hash table buckets to initially create.
+     *        (rounded up to a power of two for the Tagged layout).
      * @param locks the number of locks in the hash table
+     * @param layout the bucket layout to use
      */
     HashTable(EPStats& st,
               std::unique_ptr<AbstractStoredValueFactory> svFactory,
               size_t initialSize,
-              size_t locks);
+              size_t locks,
+              Layout layout = Layout::Chained);
 
     ~HashTable();
 
     size_t memorySize() {
         return sizeof(HashTable)
-            + (size * sizeof(StoredValue*))
+            + ((size + resizeSize) * bucketOverhead())
             + (n_locks * sizeof(std::mutex));
     }
 
+    /**
+     * Get the bucket layout of this hash table.
+     */
+    Layout getLayout() const {
+        return layout;
+    }
+
+    /**
+     * Parse a layout name (as used by the ht_layout configuration parameter).
+     * @throws std::invalid_argument if the name is not recognised.
+     */
+    static Layout layoutFromString(const std::string& name);
+
     /**
      * Get the number of hash table buckets this hash table has.
      */
@@ -275,9 +323,75 @@ public:
 
     /**
      * Resize to the specified size.
+     *
+     * This is a blocking resize; all HashTable locks are held while every
+     * hash chain is rehashed. Any in-progress incremental resize is folded
+     * into it.
      */
     void resize(size_t to);
 
+    /**
+     * Get the number of hash table buckets which would best fit the current
+     * number of items (the size resize() would pick).
+     */
+    size_t getPreferredSize();
+
+    /**
+     * Begin an incremental resize to the specified size.
+     *
+     * A second bucket array of the new size is allocated, and hash chains
+     * are subsequently moved into it by continueIncrementalResize(); at most
+     * two hash bucket locks are held at once while doing so, hence front-end
+     * operations can continue while the resize is in progress.
+     *
+     * @param to the number of hash buckets to resize to
+     * @return true if a resize was started; false if the table is already
+     *         of the requested size, a resize is already in progress or
+     *         visitors are currently running.
+     */
+    bool beginIncrementalResize(size_t to);
+
+    /**
+     * Migrate up to maxChains hash chains into the resize target. Once all
+     * chains have been migrated the resize is completed (which briefly takes
+     * all locks to swap the bucket arrays).
+     *
+     * @param maxChains the maximum number of hash chains to migrate
+     * @return true if progress was made; false if there is no resize in
+     *         progress or it cannot proceed while visitors are running.
+     */
+    bool continueIncrementalResize(size_t maxChains);
+
+    /**
+     * Is an incremental resize currently in progress?
+     */
+    bool isResizing() const {
+        return resizeSize != 0;
+    }
+
+    /**
+     * Get the size an in-progress incremental resize is moving to (zero if no
+     * resize is in progress).
+     */
+    size_t getResizeTargetSize() const {
+        return resizeSize;
+    }
+
+    /**
+     * Get the number of hash chains an in-progress incremental resize has
+     * still to migrate.
+     */
+    size_t getResizeChainsRemaining() const {
+        return isResizing() ? size - resizeCursor : 0;
+    }
+
+    /**
+     * Get the total number of hash chains migrated by incremental resizes.
+     */
+    size_t getNumResizeChainsMigrated() const {
+        return numResizeChainsMigrated;
+    }
+
     /**
      * Find the item with the given key.
      *
@@ -410,17 +524,10 @@ public:
      * @return HashBucketLock which contains a lock and the hash bucket number
      */
     inline HashBucketLock getLockedBucketForHash(int h) {
-        while (true) {
-            if (!isActive()) {
-                throw std::logic_error("HashTable::getLockedBucket: "
-                        "Cannot call on a non-active object");
-            }
-            int bucket = getBucketForHash(h);
-            HashBucketLock rv(bucket, mutexes[mutexForBucket(bucket)]);
-            if (bucket == getBucketForHash(h)) {
-                return rv;
-            }
+        if (resizeActive) {
+            return getLockedBucketForHashDuringResize(h);
         }
+        return lockBucketForHash(h);
     }
 
     /**
@@ -438,6 +545,25 @@ public:
         return getLockedBucketForHash(key.hash());
     }
 
+    /**
+     * The bucket the given key currently maps to. Only stable while that
+     * bucket's lock is held; meant for ordering a batch of keys so those
+     * sharing a bucket can be looked up together (see isLockedBucketFor()).
+     */
+    int getBucketForKey(const DocKey& key) {
+        return getBucketForHash(key.hash());
+    }
+
+    /**
+     * Does hbl hold the lock for the bucket the given key maps to? A key
+     * can't move into or out of a bucket (by a resize) without that bucket's
+     * lock, so a true answer holds until hbl is released.
+     */
+    bool isLockedBucketFor(const HashBucketLock& hbl, const DocKey& key) {
+        return hbl.getHTLock().owns_lock() &&
+               getBucketForHash(key.hash()) == hbl.getBucketNum();
+    }
+
     /**
      * Delete a key from the cache without trying to lock the cache first
      * (Please note that you <b>MUST</b> acquire the mutex before calling
@@ -563,6 +689,56 @@ public:
                               const Item& itm,
                               StoredValue& v);
 
+    /**
+     * Change the expiry time of a StoredValue, keeping the expiry index
+     * up to date.
+     * Assumes that HT bucket lock is grabbed.
+     *
+     * @param htLock Hash table lock that must be held
+     * @param v the StoredValue to update
+     * @param exptime the new expiry time
+     */
+    void unlocked_setExptime(const std::unique_lock<std::mutex>& htLock,
+                             StoredValue& v,
+                             time_t exptime);
+
+    /**
+     * Remove the keys of the items due to expire before asOf from the
+     * expiry index. The index is only a hint; the caller must look each
+     * key up and check that the item really has expired, and should use
+     * unlocked_reindexExpiry() for any item which hasn't.
+     *
+     * @param asOf the current time
+     * @param keys the keys taken from the index are appended to this
+     */
+    void takeDueExpiries(time_t asOf, std::vector<StoredDocKey>& keys) {
+        expiryIndex.takeDue(asOf, keys);
+    }
+
+    /**
+     * (Re-)add a StoredValue taken from the expiry index by
+     * takeDueExpiries() to the index, if it has an expiry time.
+     * Assumes that HT bucket lock is grabbed.
+     */
+    void unlocked_reindexExpiry(const std::unique_lock<std::mutex>& htLock,
+                                const StoredValue& v);
+
+    /**
+     * Get the number of entries in the expiry index.
+     */
+    size_t getExpiryIndexSize() const {
+        return expiryIndex.size();
+    }
+
+    /**
+     * Get the (estimated) memory used by the expiry index entries. This is
+     * accounted in EPStats::memOverhead by the index itself rather than in
+     * memorySize(), as it changes outside of the HashTable locks.
+     */
+    size_t getExpiryIndexMemory() const {
+        return expiryIndex.getMemoryUsage();
+    }
+
     /**
      * Releases an item(StoredValue) in the hash table, but does not delete it.
      * It will pass out the removed item to the caller who can decide whether to
@@ -604,6 +780,48 @@ private:
     inline bool isActive() const { return activeState; }
     inline void setActiveState(bool newv) { activeState = newv; }
 
+    /**
+     * A cache-line sized block of (hash tag, StoredValue*) pairs indexing
+     * the chain of one bucket (Tagged layout only). The chain still owns the
+     * StoredValues; the block just allows most probes to avoid walking it.
+     */
+    struct TagBlock {
+        static const size_t Slots = 6;
+
+        //! Average number of items per bucket the Tagged layout sizes for.
+        static const size_t TargetLoad = 3;
+
+        std::array<StoredValue*, Slots> values;
+        std::array<uint16_t, Slots> tags;
+        //! Number of StoredValues in the chain which are not in {values}; if
+        //! non-zero a probe which misses in the block must walk the chain.
+        uint16_t overflow;
+        uint16_t padding;
+    };
+    static_assert(sizeof(TagBlock) == 64,
+                  "HashTable::TagBlock should occupy exactly one cache line");
+
+    /**
+     * Cache-line aligned array of TagBlocks, one per bucket.
+     */
+    class TagIndex {
+    public:
+        TagIndex() = default;
+
+        explicit TagIndex(size_t buckets);
+
+        TagBlock& operator[](size_t bucket) {
+            return blocks[bucket];
+        }
+
+    private:
+        // Over-allocated by a cache line so {blocks} can be aligned.
+        std::unique_ptr<uint8_t[]> storage;
+        TagBlock* blocks = nullptr;
+    };
+
+    const Layout layout;
+
     // The initial (and minimum) size of the HashTable.
     const size_t initialSize;
 
@@ -611,6 +829,13 @@ private:
     size_t               n_locks;
     table_type values;
     std::mutex               *mutexes;
+    // Generators used to increment the frequency counters of the items
+    // referenced in the buckets guarded by the corresponding mutex (and
+    // hence guarded by that mutex).
+    std::vector<ProbabilisticCounter<uint8_t>> freqCounters;
+    // The items with an expiry time, ordered by that time. Has its own lock
+    // as a key may move between bucket locks during a resize.
+    ExpiryIndex expiryIndex;
     EPStats&             stats;
     std::unique_ptr<AbstractStoredValueFactory> valFact;
     std::atomic<size_t>       visitors;
@@ -619,8 +844,106 @@ private:
     std::atomic<size_t>       numTempItems;
     bool                 activeState;
 
+    /*
+     * Incremental resize state.
+     *
+     * While an incremental resize is in progress the table consists of two
+     * bucket arrays: {values} (of {size} buckets) and {resizeValues} (of
+     * {resizeSize} buckets). Chains [0, resizeCursor) of {values} have already
+     * been moved into {resizeValues}; a key whose old chain has been migrated
+     * is looked up in {resizeValues} instead.
+     *
+     * Bucket numbers handed out (via HashBucketLock) are "logical": numbers
+     * in [0, size) refer to {values}, numbers in [size, size + resizeSize)
+     * refer to {resizeValues}. Each physical bucket is guarded by
+     * mutexes[physical bucket % n_locks], as in the non-resizing case.
+     */
+    table_type resizeValues;
+    TagIndex tagIndex;
+    TagIndex resizeTagIndex;
+    std::atomic<size_t> resizeSize;
+    std::atomic<size_t> resizeCursor;
+    // True while any kind of resize is in progress; used to decide if front
+    // end lock acquisition should be timed.
+    std::atomic<bool> resizeActive;
+    std::atomic<size_t> numResizeChainsMigrated;
+    // Serialises resizers against each other, against clear() and against
+    // visitors starting. Always acquired before any of {mutexes}.
+    std::mutex resizeMutex;
+
+    int bucketForHash(int h, size_t tableSize) const {
+        if (layout == Layout::Tagged) {
+            return static_cast<int>(mixHash(h) & (tableSize - 1));
+        }
+        return abs(h % static_cast<int>(tableSize));
+    }
+
+    /**
+     * Finalise a DocKey hash so that all of its bits depend on the whole key
+     * (the low bits of the DocKey hash alone are poorly distributed, which
+     * matters when selecting a bucket by masking). MurmurHash3's fmix32.
+     */
+    static uint32_t mixHash(int h) {
+        uint32_t x = static_cast<uint32_t>(h);
+        x ^= x >> 16;
+        x *= 0x85ebca6b;
+        x ^= x >> 13;
+        x *= 0xc2b2ae35;
+        x ^= x >> 16;
+        return x;
+    }
+
+    static uint16_t tagForHash(int h) {
+        return static_cast<uint16_t>(mixHash(h) >> 16);
+    }
+
+    /**
+     * Round a requested table size to one valid for this table's layout.
+     */
+    size_t normaliseSize(size_t requested) const;
+
+    /**
+     * Memory used by each bucket (chain head plus, for Tagged, TagBlock).
+     */
+    size_t bucketOverhead() const {
+        return sizeof(StoredValue*) +
+               (layout == Layout::Tagged ? sizeof(TagBlock) : 0);
+    }
+
+    /**
+     * Returns the TagBlock for the given (logical) bucket number.
+     */
+    TagBlock& tagBlockForBucket(size_t bucket_num) {
+        if (bucket_num < size) {
+            return tagIndex[bucket_num];
+        }
+        return resizeTagIndex[bucket_num - size];
+    }
+
+    /**
+     * Record v in the TagBlock of the given bucket (Tagged layout only).
+     */
+    static void tagBlockInsert(TagBlock& block, StoredValue* v);
+
+    /**
+     * Remove v from the TagBlock of the given bucket (Tagged layout only).
+     */
+    static void tagBlockRemove(TagBlock& block, const StoredValue* v);
+
+    /**
+     * Find the StoredValue with the given key in the given (logical) bucket,
+     * regardless of deleted state.
+     */
+    StoredValue* findInBucket(const DocKey& key, size_t bucket_num);
+
     int getBucketForHash(int h) {
-        return abs(h % static_cast<int>(size));
+        const int bucket = bucketForHash(h, size);
+        const size_t target = resizeSize;
+        if (target != 0 && static_cast<size_t>(bucket) < resizeCursor) {
+            // Chain already migrated - key now lives in the resize target.
+            return static_cast<int>(size) + bucketForHash(h, target);
+        }
+        return bucket;
     }
 
     inline size_t mutexForBucket(size_t bucket_num) {
@@ -628,9 +951,81 @@ private:
             throw std::logic_error("HashTable::mutexForBucket: Cannot call on a "
                     "non-active object");
         }
+        if (bucket_num >= size) {
+            bucket_num -= size;
+        }
         return bucket_num % n_locks;
     }
 
+    /**
+     * Returns the hash chain for the given (logical) bucket number.
+     * The lock for the bucket must be held.
+     */
+    StoredValue::UniquePtr& chainForBucket(size_t bucket_num) {
+        if (bucket_num < size) {
+            return values[bucket_num];
+        }
+        return resizeValues[bucket_num - size];
+    }
+
+    /**
+     * Total number of (logical) buckets, including those of an in-progress
+     * incremental resize.
+     */
+    size_t totalBuckets() const {
+        return size + resizeSize;
+    }
+
+    /**
+     * Returns the first (logical) bucket number guarded by the given lock,
+     * or totalBuckets() if there is none.
+     */
+    size_t firstBucketForLock(size_t lock) const;
+
+    /**
+     * Returns the (logical) bucket number following bucket_num which is
+     * guarded by the same lock, or totalBuckets() if there are no more.
+     */
+    size_t nextBucketForLock(size_t bucket_num, size_t lock) const;
+
+    /**
+     * Acquire the lock for the bucket the given hash maps to, retrying if the
+     * mapping changes before the lock is held.
+     */
+    inline HashBucketLock lockBucketForHash(int h) {
+        while (true) {
+            if (!isActive()) {
+                throw std::logic_error("HashTable::getLockedBucket: "
+                        "Cannot call on a non-active object");
+            }
+            int bucket = getBucketForHash(h);
+            size_t lock = mutexForBucket(bucket);
+            HashBucketLock rv(bucket, mutexes[lock]);
+            if (bucket == getBucketForHash(h) &&
+                lock == mutexForBucket(bucket)) {
+                return rv;
+            }
+        }
+    }
+
+    /**
+     * As lockBucketForHash(), but records how long the caller had to wait
+     * for the lock (while a resize is in progress).
+     */
+    HashBucketLock getLockedBucketForHashDuringResize(int h);
+
+    /**
+     * Migrate the chain at the front of {values} into {resizeValues}.
+     * resizeMutex must be held and an incremental resize in progress.
+     */
+    void migrateNextChain();
+
+    /**
+     * Swap in {resizeValues} once all chains have been migrated.
+     * resizeMutex must be held.
+     */
+    void completeIncrementalResize();
+
     std::unique_ptr<Item> getRandomKeyFromSlot(int slot);
 
     /** Searches for the first element in the specified hashChain which matches
@@ -671,6 +1066,24 @@ private:
 
     void clear_UNLOCKED(bool deactivate);
 
+    /**
+     * The expiry time under which the expiry index holds (or should hold)
+     * the given StoredValue; zero if it isn't indexed. Deleted and
+     * temporary items are never indexed.
+     */
+    static time_t indexedExptime(const StoredValue& v) {
+        if (v.isDeleted() || v.isTempItem()) {
+            return 0;
+        }
+        return v.getExptime();
+    }
+
+    /**
+     * Move the StoredValue's expiry index entry, given the expiry time it
+     * was indexed under before it was modified (see indexedExptime()).
+     */
+    void updateExpiryIndex(const StoredValue& v, time_t oldIndexedExptime);
+
     /**
      * Increase the size of the cache
      */
@@ -31,11 +31,32 @@
  */
 class ResizingVisitor : public VBucketVisitor {
 public:
-    ResizingVisitor() { }
+    ResizingVisitor(bool incremental, size_t chainsPerStep)
+        : incremental(incremental), chainsPerStep(chainsPerStep) {
+    }
 
     void visitBucket(VBucketPtr &vb) override {
-        vb->ht.resize();
+        if (!incremental) {
+            vb->ht.resize();
+            return;
+        }
+
+        if (!vb->ht.isResizing()) {
+            vb->ht.beginIncrementalResize(vb->ht.getPreferredSize());
+        }
+        // Migrate in bounded steps; front-end operations only ever wait for
+        // a single step. If a step cannot proceed (visitors running) leave
+        // the remainder for the next run of the task.
+        while (vb->ht.isResizing()) {
+            if (!vb->ht.continueIncrementalResize(chainsPerStep)) {
+                break;
+            }
+        }
     }
+
+private:
+    const bool incremental;
+    const size_t chainsPerStep;
 };
 
 HashtableResizerTask::HashtableResizerTask(KVBucketIface* s, double sleepTime)
@@ -48,11 +69,14 @@ HashtableResizerTask::HashtableResizerTask(KVBucketIface* s, double sleepTime)
 
 bool HashtableResizerTask::run(void) {
     TRACE_EVENT0("ep-engine/task", "HashtableResizerTask");
-    auto pv = std::make_unique<ResizingVisitor>();
+    auto& config = engine->getConfiguration();
+    auto pv = std::make_unique<ResizingVisitor>(
+            config.getHtResizeMode() == "incremental",
+            config.getHtResizeStepChains());
     store->visit(std::move(pv),
                  "Hashtable resizer",
                  TaskId::HashtableResizerVisitorTask);
 
-    snooze(engine->getConfiguration().getHtResizeInterval());
+    snooze(config.getHtResizeInterval());
     return true;
 }
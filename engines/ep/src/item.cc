@@ -124,9 +124,17 @@ Item::Item(const Item& other, bool copyKeyOnly)
 }
 
 Item::~Item() {
+    dropCompressedValue();
     ObjectRegistry::onDeleteItem(this);
 }
 
+void Item::dropCompressedValue() {
+    Blob* compressed = compressedValue.exchange(nullptr);
+    if (compressed != nullptr && compressed->releaseRawRef()) {
+        delete compressed;
+    }
+}
+
 std::string to_string(queue_op op) {
     switch(op) {
         case queue_op::set: return "set";
@@ -260,6 +268,40 @@ bool Item::decompressValue() {
     return true;
 }
 
+value_t Item::getCompressedValue(bool& cached) const {
+    Blob* compressed = compressedValue.load();
+    if (compressed != nullptr) {
+        cached = true;
+        return value_t(compressed);
+    }
+    cached = false;
+
+    cb::compression::Buffer deflated;
+    if (!cb::compression::deflate(cb::compression::Algorithm::Snappy,
+                                  getData(), getNBytes(), deflated)) {
+        return value_t();
+    }
+
+    compressed = Blob::New(deflated.data.get(), deflated.len,
+                           (uint8_t*)(getExtMeta()), getExtMetaLen());
+    if (compressed->getExtLen() > 0) {
+        compressed->setDataType(getDataType() |
+                                PROTOCOL_BINARY_DATATYPE_SNAPPY);
+    }
+    compressed->acquireRawRef();
+
+    // Another thread may have beaten us to it, in which case use theirs.
+    Blob* expected = nullptr;
+    if (!compressedValue.compare_exchange_strong(expected, compressed)) {
+        if (compressed->releaseRawRef()) {
+            delete compressed;
+        }
+        compressed = expected;
+        cached = true;
+    }
+    return value_t(compressed);
+}
+
 item_info Item::toItemInfo(uint64_t vb_uuid) const {
     item_info info;
     info.cas = getCas();
@@ -24,6 +24,7 @@
 #include <string.h>
 #include <utility>
 
+#include <atomic>
 #include <cstring>
 #include <string>
 
@@ -183,6 +184,29 @@ public:
     /* Snappy uncompress value and update datatype */
     bool decompressValue();
 
+    /**
+     * Get the value compressed with snappy, without modifying the item.
+     * The value is only compressed the first time this is called; the
+     * compressed Blob is kept with the item and shared with every later
+     * caller (e.g. all of the DCP producers streaming this item). The
+     * value must not already be compressed.
+     *
+     * @param[out] cached set to true if the compressed value already existed
+     * @return the compressed value (its extended meta, if any, carries the
+     *         snappy datatype), or an empty value_t if compression failed
+     */
+    value_t getCompressedValue(bool& cached) const;
+
+    /**
+     * Replace the value with a compressed form of it obtained through
+     * getCompressedValue(), and update the datatype.
+     */
+    void setCompressedValue(const value_t& compressed) {
+        const auto uncompressed = datatype;
+        setValue(compressed);
+        datatype = uncompressed | PROTOCOL_BINARY_DATATYPE_SNAPPY;
+    }
+
     const char *getData() const {
         return value.get() ? value->getData() : NULL;
     }
@@ -215,6 +239,12 @@ public:
         return value.get() ? value->getSize() : 0;
     }
 
+    /// @return the memory used by the value cached by getCompressedValue()
+    size_t getCompressedValMemSize() const {
+        const Blob* compressed = compressedValue.load();
+        return compressed ? compressed->getSize() : 0;
+    }
+
     time_t getExptime() const {
         return metaData.exptime;
     }
@@ -257,6 +287,7 @@ public:
     }
 
     void setValue(const value_t &v) {
+        dropCompressedValue();
         value.reset(v);
         // update the cached datatype
         datatype = value.get() ? value->getDataType() :
@@ -427,6 +458,9 @@ private:
         setValue(data);
     }
 
+    /// Release the compressed value cached by getCompressedValue().
+    void dropCompressedValue();
+
     /*
      * @return boolean value of whether extended meta data exists for the item.
      */
@@ -455,6 +489,10 @@ private:
     // this cached version.
     mutable protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
 
+    // The snappy-compressed value, built on demand by getCompressedValue().
+    // The item holds a reference to it (taken with acquireRawRef()).
+    mutable std::atomic<Blob*> compressedValue{nullptr};
+
     static std::atomic<uint64_t> casCounter;
     static const uint32_t metaDataSize;
     DISALLOW_ASSIGN(Item);
@@ -0,0 +1,50 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "item_eviction.h"
+
+#include <cmath>
+
+const uint64_t ItemEviction::learningPopulation;
+
+ItemEviction::ItemEviction() {
+    reset();
+}
+
+uint8_t ItemEviction::getFreqThreshold(double fraction) const {
+    if (valueCount == 0 || fraction <= 0) {
+        return 0;
+    }
+    if (fraction >= 1) {
+        return std::numeric_limits<uint8_t>::max();
+    }
+
+    const uint64_t target = uint64_t(std::ceil(fraction * valueCount));
+    uint64_t seen = 0;
+    for (size_t freq = 0; freq < freqHistogram.size(); ++freq) {
+        seen += freqHistogram[freq];
+        if (seen >= target) {
+            return uint8_t(freq);
+        }
+    }
+    return std::numeric_limits<uint8_t>::max();
+}
+
+void ItemEviction::reset() {
+    freqHistogram.fill(0);
+    valueCount = 0;
+}
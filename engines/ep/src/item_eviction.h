@@ -0,0 +1,73 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Supports the frequency based eviction policy of the item pager.
+ *
+ * Holds a histogram of the frequency counters of the items visited so far
+ * in an eviction pass. Given the fraction of items which need to be evicted
+ * the histogram provides the frequency threshold: evicting every item whose
+ * counter is at or below the threshold evicts (approximately) that fraction
+ * of the items, preferring the least frequently accessed ones. This allows
+ * the pager to free the required memory in a single pass over the
+ * HashTables.
+ */
+class ItemEviction {
+public:
+    /// The number of values to add before the threshold is meaningful.
+    static const uint64_t learningPopulation = 100;
+
+    ItemEviction();
+
+    /// Add the frequency counter of a visited item to the histogram.
+    void addFreqValue(uint8_t freq) {
+        ++freqHistogram[freq];
+        ++valueCount;
+    }
+
+    /// @return the number of values added since the last reset()
+    uint64_t getValueCount() const {
+        return valueCount;
+    }
+
+    /// @return true if enough values have been added to compute a threshold
+    bool isLearning() const {
+        return valueCount < learningPopulation;
+    }
+
+    /**
+     * Get the frequency at or below which the given fraction of the values
+     * added so far are.
+     *
+     * @param fraction the fraction of values to be evicted (0-1)
+     * @return the threshold frequency (0 if no values have been added)
+     */
+    uint8_t getFreqThreshold(double fraction) const;
+
+    void reset();
+
+private:
+    std::array<uint64_t, std::numeric_limits<uint8_t>::max() + 1>
+            freqHistogram;
+    uint64_t valueCount;
+};
@@ -21,6 +21,7 @@
 #include "dcp/dcpconnmap.h"
 #include "ep_engine.h"
 #include "ep_time.h"
+#include "item_eviction.h"
 #include "kv_bucket_iface.h"
 #include "tapconnmap.h"
 
@@ -30,6 +31,7 @@
 #include <list>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <phosphor/phosphor.h>
 #include <platform/make_unique.h>
@@ -62,19 +64,28 @@ public:
      *              visits
      * @param bias active vbuckets eviction probability bias multiplier (0-1)
      * @param phase pointer to an item_pager_phase to be set
+     * @param policy how to select the items to evict
+     * @param expiryIndex if true, the expiry pager only visits the items
+     *                    found via the HashTables' expiry indexes
      */
     PagingVisitor(KVBucketIface& s, EPStats &st, double pcnt,
                   std::shared_ptr<std::atomic<bool>> &sfin, pager_type_t caller,
                   bool pause, double bias,
-                  std::atomic<item_pager_phase>* phase) :
+                  std::atomic<item_pager_phase>* phase,
+                  HtEvictionPolicy policy = HtEvictionPolicy::TwoBitNRU,
+                  bool expiryIndex = false) :
         store(s), stats(st), percent(pcnt),
-        activeBias(bias), ejected(0),
+        activeBias(bias), ejected(0), visited(0),
         startTime(ep_real_time()), stateFinalizer(sfin), owner(caller),
         canPause(pause), completePhase(true),
         wasHighMemoryUsage(s.isMemoryUsageTooHigh()),
-        taskStart(gethrtime()), pager_phase(phase) {}
+        taskStart(gethrtime()), pager_phase(phase),
+        evictionPolicy(policy), freqThreshold(0),
+        reachedLowWatermark(false), useExpiryIndex(expiryIndex) {}
 
     bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override {
+        ++visited;
+
         // Delete expired items for an active vbucket.
         bool isExpired = (currentBucket->getState() == vbucket_state_active) &&
                          v.isExpired(startTime) && !v.isDeleted();
@@ -89,6 +100,11 @@ public:
             return true;
         }
 
+        if (evictionPolicy == HtEvictionPolicy::Frequency) {
+            visitByFrequency(lh, v);
+            return true;
+        }
+
         // always evict unreferenced items, or randomly evict referenced item
         double r = *pager_phase == PAGING_UNREFERENCED ?
             1 :
@@ -126,7 +142,13 @@ public:
         if (percent <= 0 || !pager_phase) {
             if (vBucketFilter(vb->getId())) {
                 currentBucket = vb;
-                vb->ht.visit(*this);
+                // Temporary items aren't in the expiry index, so they still
+                // need a full scan to be purged.
+                if (!useExpiryIndex || vb->ht.getNumTempItems() > 0) {
+                    vb->ht.visit(*this);
+                } else if (vb->getState() == vbucket_state_active) {
+                    visitExpiryIndex(*vb);
+                }
             }
             return;
         }
@@ -144,7 +166,14 @@ public:
 
         if (current > lower) {
             double p = (current - static_cast<double>(lower)) / current;
+            if (evictionPolicy == HtEvictionPolicy::Frequency) {
+                p = getFrequencyEvictionFraction(current - lower);
+            }
             adjustPercent(p, vb->getState());
+            if (evictionPolicy == HtEvictionPolicy::Frequency &&
+                !itemEviction.isLearning()) {
+                freqThreshold = itemEviction.getFreqThreshold(percent);
+            }
             if (vBucketFilter(vb->getId())) {
                 currentBucket = vb;
                 vb->ht.visit(*this);
@@ -184,12 +213,14 @@ public:
             stats.itemPagerHisto.add(elapsed_time);
         } else if (owner == EXPIRY_PAGER) {
             stats.expiryPagerHisto.add(elapsed_time);
+            stats.expiryPagerItemsVisited.fetch_add(visited);
         }
 
         bool inverse = false;
         (*stateFinalizer).compare_exchange_strong(inverse, true);
 
-        if (pager_phase && completePhase) {
+        if (pager_phase && completePhase &&
+            evictionPolicy == HtEvictionPolicy::TwoBitNRU) {
             if (*pager_phase == PAGING_UNREFERENCED) {
                 *pager_phase = PAGING_RANDOM;
             } else {
@@ -223,7 +254,7 @@ private:
         }
     }
 
-    void doEviction(const HashTable::HashBucketLock& lh, StoredValue* v) {
+    bool doEviction(const HashTable::HashBucketLock& lh, StoredValue* v) {
         item_eviction_policy_t policy = store.getItemEvictionPolicy();
         StoredDocKey key(v->getKey());
 
@@ -237,6 +268,94 @@ private:
             if (policy == FULL_EVICTION) {
                 currentBucket->addToFilter(key);
             }
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Expiry pager: rather than visiting every item in the HashTable, only
+     * visit the items the expiry index says are due to expire. Entries for
+     * items which turn out not to have expired (their expiry time has been
+     * changed) are put back into the index.
+     */
+    void visitExpiryIndex(VBucket& vb) {
+        std::vector<StoredDocKey> keys;
+        vb.ht.takeDueExpiries(startTime, keys);
+        for (const auto& key : keys) {
+            auto hbl = vb.ht.getLockedBucket(key);
+            StoredValue* v = vb.ht.unlocked_find(key,
+                                                 hbl.getBucketNum(),
+                                                 WantsDeleted::No,
+                                                 TrackReference::No);
+            if (!v) {
+                continue;
+            }
+            ++visited;
+            if (v->isExpired(startTime) && !v->isTempItem()) {
+                std::unique_ptr<Item> it = v->toItem(false, vb.getId());
+                expired.push_back(*it.get());
+            } else {
+                vb.ht.unlocked_reindexExpiry(hbl.getHTLock(), *v);
+            }
+        }
+    }
+
+    /**
+     * Frequency eviction policy: the items are evicted in a single pass, so
+     * rather than the fraction of all memory the fraction of the memory
+     * which eviction can actually free (values only, unless the whole item
+     * is evicted) is used to select how many items to evict.
+     */
+    double getFrequencyEvictionFraction(double bytesToFree) {
+        double evictable = static_cast<double>(
+                store.getItemEvictionPolicy() == VALUE_ONLY
+                        ? stats.totalValueSize.load()
+                        : stats.currentSize.load());
+        if (evictable <= bytesToFree) {
+            return 1.0;
+        }
+        return bytesToFree / evictable;
+    }
+
+    /**
+     * Frequency eviction policy: evict the item if its frequency counter
+     * is at or below the threshold which selects the `percent` least
+     * frequently accessed of the items seen so far in this pass. Items
+     * which stay resident have their counter aged, so items which are no
+     * longer accessed eventually become eligible.
+     */
+    void visitByFrequency(const HashTable::HashBucketLock& lh,
+                          StoredValue& v) {
+        // Skip the items eviction can't free any more memory from.
+        if (reachedLowWatermark || v.isDeleted() ||
+            (store.getItemEvictionPolicy() == VALUE_ONLY && !v.isResident())) {
+            return;
+        }
+
+        const uint8_t freq = v.getFreqCounterValue();
+        itemEviction.addFreqValue(freq);
+        if (itemEviction.isLearning()) {
+            return;
+        }
+
+        // Recomputing the threshold is a walk of the histogram, so only do
+        // it every learningPopulation items.
+        if (itemEviction.getValueCount() % ItemEviction::learningPopulation ==
+            0) {
+            freqThreshold = itemEviction.getFreqThreshold(percent);
+        }
+
+        if (freq <= freqThreshold && doEviction(lh, &v)) {
+            if (stats.getTotalMemoryUsed() <= stats.mem_low_wat) {
+                // Evicted enough - leave everything else alone.
+                reachedLowWatermark = true;
+            }
+            return;
+        }
+
+        if (freq > 0) {
+            v.setFreqCounterValue(freq - 1);
         }
     }
 
@@ -247,6 +366,7 @@ private:
     double percent;
     double activeBias;
     size_t ejected;
+    size_t visited;
     time_t startTime;
     std::shared_ptr<std::atomic<bool>> stateFinalizer;
     pager_type_t owner;
@@ -256,6 +376,14 @@ private:
     hrtime_t taskStart;
     std::atomic<item_pager_phase>* pager_phase;
     VBucketPtr currentBucket;
+
+    // State of the frequency eviction policy.
+    const HtEvictionPolicy evictionPolicy;
+    ItemEviction itemEviction;
+    uint8_t freqThreshold;
+    bool reachedLowWatermark;
+
+    const bool useExpiryIndex;
 };
 
 ItemPager::ItemPager(EventuallyPersistentEngine *e, EPStats &st) :
@@ -299,6 +427,11 @@ bool ItemPager::run(void) {
         size_t activeEvictPerc = cfg.getPagerActiveVbPcnt();
         double bias = static_cast<double>(activeEvictPerc) / 50;
 
+        HtEvictionPolicy policy = HtEvictionPolicy::TwoBitNRU;
+        if (cfg.getHtEvictionPolicy() == "frequency") {
+            policy = HtEvictionPolicy::Frequency;
+        }
+
         auto pv = std::make_unique<PagingVisitor>(*kvBucket,
                                                   stats,
                                                   toKill,
@@ -306,7 +439,8 @@ bool ItemPager::run(void) {
                                                   ITEM_PAGER,
                                                   false,
                                                   bias,
-                                                  &phase);
+                                                  &phase,
+                                                  policy);
         kvBucket->visit(std::move(pv),
                         "Item pager",
                         TaskId::ItemPagerVisitor);
@@ -367,14 +501,17 @@ bool ExpiredItemPager::run(void) {
     if ((*available).compare_exchange_strong(inverse, false)) {
         ++stats.expiryPagerRuns;
 
-        auto pv = std::make_unique<PagingVisitor>(*kvBucket,
-                                                  stats,
-                                                  -1,
-                                                  available,
-                                                  EXPIRY_PAGER,
-                                                  true,
-                                                  1,
-                                                  nullptr);
+        auto pv = std::make_unique<PagingVisitor>(
+                *kvBucket,
+                stats,
+                -1,
+                available,
+                EXPIRY_PAGER,
+                true,
+                1,
+                nullptr,
+                HtEvictionPolicy::TwoBitNRU,
+                engine->getConfiguration().isExpPagerUseIndex());
         // track spawned tasks for shutdown..
         kvBucket->visit(std::move(pv),
                         "Expired item remover",
@@ -36,6 +36,18 @@ enum item_pager_phase {
     PAGING_RANDOM
 };
 
+/**
+ * How the item pager selects the items to evict (ht_eviction_policy).
+ */
+enum class HtEvictionPolicy {
+    // Evict the items not referenced since the previous pass (2-bit NRU),
+    // then randomly selected items in a second pass.
+    TwoBitNRU,
+    // Evict the least frequently accessed items (according to their
+    // frequency counters) in a single pass.
+    Frequency
+};
+
 /**
  * Item eviction policy
  */
@@ -20,6 +20,7 @@
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
 #include <fstream>
 #include <functional>
 #include <iostream>
@@ -120,6 +121,10 @@ public:
             store.setBGFetchDelay(static_cast<uint32_t>(value));
         } else if (key.compare("compaction_write_queue_cap") == 0) {
             store.setCompactionWriteQueueCap(value);
+        } else if (key.compare("flusher_group_commit_max_vbuckets") == 0) {
+            store.setFlusherGroupCommitMaxVBuckets(value);
+        } else if (key.compare("flusher_group_commit_max_latency") == 0) {
+            store.setFlusherGroupCommitMaxLatency(value);
         } else if (key.compare("exp_pager_stime") == 0) {
             store.setExpiryPagerSleeptime(value);
         } else if (key.compare("alog_sleep_time") == 0) {
@@ -456,6 +461,13 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
     config.addValueChangedListener("compaction_write_queue_cap",
                                    new EPStoreValueChangeListener(*this));
 
+    flusherGroupCommitMaxVBuckets = config.getFlusherGroupCommitMaxVbuckets();
+    config.addValueChangedListener("flusher_group_commit_max_vbuckets",
+                                   new EPStoreValueChangeListener(*this));
+    flusherGroupCommitMaxLatency = config.getFlusherGroupCommitMaxLatency();
+    config.addValueChangedListener("flusher_group_commit_max_latency",
+                                   new EPStoreValueChangeListener(*this));
+
     config.addValueChangedListener("dcp_min_compression_ratio",
                                    new EPStoreValueChangeListener(*this));
 
@@ -584,6 +596,10 @@ void KVBucket::deleteExpiredItem(Item& it,
         ReaderLockHolder rlh(vb->getStateLock());
         if (vb->getState() == vbucket_state_active) {
             vb->deleteExpiredItem(it, startTime, source);
+        } else {
+            // The item may have been taken from the expiry index; put it
+            // back so it's expired if the vBucket becomes active again.
+            vb->reindexExpiry(it.getKey());
         }
     }
 }
@@ -905,7 +921,8 @@ ENGINE_ERROR_CODE KVBucket::deleteVBucket(uint16_t vbid, const void* c) {
 
 ENGINE_ERROR_CODE KVBucket::checkForDBExistence(DBFileId db_file_id) {
     std::string backend = engine.getConfiguration().getBackend();
-    if (backend.compare("couchdb") == 0) {
+    if (backend.compare("couchdb") == 0 ||
+        backend.compare("logstore") == 0) {
         VBucketPtr vb = vbMap.getBucket(db_file_id);
         if (!vb) {
             return ENGINE_NOT_MY_VBUCKET;
@@ -1355,7 +1372,8 @@ void KVBucket::completeBGFetch(const DocKey& key,
                                uint16_t vbucket,
                                const void* cookie,
                                ProcessClock::time_point init,
-                               bool isMeta) {
+                               bool isMeta,
+                               const std::shared_ptr<GetMultiBatch>& batch) {
     ProcessClock::time_point startTime(ProcessClock::now());
     // Go find the data
     GetValue gcb = getROUnderlying(vbucket)->get(key, vbucket, isMeta);
@@ -1366,15 +1384,15 @@ void KVBucket::completeBGFetch(const DocKey& key,
 
         VBucketPtr vb = getVBucket(vbucket);
         if (vb) {
-            VBucketBGFetchItem item{&gcb, cookie, init, isMeta};
+            VBucketBGFetchItem item{&gcb, cookie, init, isMeta, batch};
             ENGINE_ERROR_CODE status =
                     vb->completeBGFetchForSingleItem(key, item, startTime);
-            engine.notifyIOComplete(item.cookie, status);
+            engine.notifyIOComplete(item.cookie, batch.get(), status);
         } else {
             LOG(EXTENSION_LOG_INFO, "vb:%" PRIu16 " file was deleted in the "
                 "middle of a bg fetch for key{%.*s}\n", vbucket, int(key.size()),
                 key.data());
-            engine.notifyIOComplete(cookie, ENGINE_NOT_MY_VBUCKET);
+            engine.notifyIOComplete(cookie, batch.get(), ENGINE_NOT_MY_VBUCKET);
         }
     }
 
@@ -1391,7 +1409,8 @@ void KVBucket::completeBGFetchMulti(uint16_t vbId,
             auto* fetched_item = item.second;
             ENGINE_ERROR_CODE status = vb->completeBGFetchForSingleItem(
                     key, *fetched_item, startTime);
-            engine.notifyIOComplete(fetched_item->cookie, status);
+            engine.notifyIOComplete(
+                    fetched_item->cookie, fetched_item->batch.get(), status);
         }
         LOG(EXTENSION_LOG_DEBUG,
             "EP Store completes %" PRIu64 " of batched background fetch "
@@ -1400,6 +1419,7 @@ void KVBucket::completeBGFetchMulti(uint16_t vbId,
     } else {
         for (const auto& item : fetchedItems) {
             engine.notifyIOComplete(item.second->cookie,
+                                    item.second->batch.get(),
                                     ENGINE_NOT_MY_VBUCKET);
         }
         LOG(EXTENSION_LOG_WARNING,
@@ -1452,6 +1472,93 @@ GetValue KVBucket::getInternal(const DocKey& key, uint16_t vbucket,
     }
 }
 
+std::vector<GetValue> KVBucket::getMulti(
+        uint16_t vbucket,
+        const std::vector<DocKey>& keys,
+        const std::shared_ptr<GetMultiBatch>& batch,
+        get_options_t options) {
+    std::vector<GetValue> result(keys.size());
+
+    auto notMyVBucket = [this, &keys, &result]() {
+        stats.numNotMyVBuckets += keys.size();
+        for (auto& gv : result) {
+            gv.setStatus(ENGINE_NOT_MY_VBUCKET);
+        }
+        return std::move(result);
+    };
+
+    VBucketPtr vb = getVBucket(vbucket);
+    if (!vb) {
+        return notMyVBucket();
+    }
+
+    const bool honorStates = (options & HONOR_STATES);
+
+    ReaderLockHolder rlh(vb->getStateLock());
+    if (honorStates) {
+        vbucket_state_t vbState = vb->getState();
+        if (vbState == vbucket_state_dead ||
+            vbState == vbucket_state_replica) {
+            return notMyVBucket();
+        }
+        // The whole batch waits on a single pending op
+        if (vbState == vbucket_state_pending &&
+            vb->addPendingOp(batch->cookie, batch)) {
+            for (auto& gv : result) {
+                gv.setStatus(ENGINE_EWOULDBLOCK);
+            }
+            return result;
+        }
+    }
+
+    // Visit the keys in hash bucket order, so all of the keys which share a
+    // bucket are looked up under a single acquisition of its lock.
+    std::vector<std::pair<int, size_t>> order;
+    order.reserve(keys.size());
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        order.emplace_back(vb->ht.getBucketForKey(keys[ii]), ii);
+    }
+    std::sort(order.begin(), order.end());
+
+    size_t fetches = 0;
+    {
+        auto collectionsRHandle = vb->lockCollections();
+        HashTable::HashBucketLock hbl;
+        for (const auto& entry : order) {
+            const auto& key = keys[entry.second];
+            auto& gv = result[entry.second];
+            if (!collectionsRHandle.doesKeyContainValidCollection(key)) {
+                gv.setStatus(ENGINE_UNKNOWN_COLLECTION);
+                continue;
+            }
+            if (!vb->ht.isLockedBucketFor(hbl, key)) {
+                // Drop the previous bucket's lock before taking the next
+                hbl = HashTable::HashBucketLock();
+                hbl = vb->ht.getLockedBucket(key);
+            }
+            gv = vb->getInternal(hbl,
+                                 key,
+                                 batch->cookie,
+                                 engine,
+                                 bgFetchDelay,
+                                 options,
+                                 diskDeleteAll,
+                                 batch);
+            if (gv.getStatus() == ENGINE_EWOULDBLOCK &&
+                (options & QUEUE_BG_FETCH)) {
+                ++fetches;
+            }
+        }
+    }
+
+    // Hand all of the batch's fetches to the background fetcher in one go
+    if (fetches > 0) {
+        vb->wakeBgFetcher(fetches);
+    }
+
+    return result;
+}
+
 GetValue KVBucket::getRandomKey() {
     VBucketMap::id_type max = vbMap.getSize();
 
@@ -2024,7 +2131,49 @@ void KVBucket::flushOneDeleteAll() {
 }
 
 int KVBucket::flushVBucket(uint16_t vbid) {
-    KVShard *shard = vbMap.getShardByVbId(vbid);
+    std::vector<uint16_t> requeue;
+    const size_t items_flushed = flushVBuckets({vbid}, requeue);
+    if (!requeue.empty()) {
+        return RETRY_FLUSH_VBUCKET;
+    }
+    return static_cast<int>(items_flushed);
+}
+
+/**
+ * A vbucket's part of a flush, held from writing its items to the KVStore
+ * until they have been committed.
+ */
+struct VBucketFlush {
+    explicit VBucketFlush(VBucketPtr vb) : vb(std::move(vb)) {
+    }
+
+    VBucketPtr vb;
+    std::unique_lock<std::mutex> lh;
+    SystemEventFlush sef;
+    snapshot_range_t range{0, 0};
+    int itemsFlushed = 0;
+    /// True if the persistence cursor had any items for the vbucket.
+    bool hadItems = false;
+    /// True if its vbucket state couldn't be snapshotted; its items are
+    /// still part of the group's commit, but it must be flushed again.
+    bool snapshotFailed = false;
+};
+
+size_t KVBucket::flushVBuckets(const std::vector<uint16_t>& vbids,
+                               std::vector<uint16_t>& requeue) {
+    if (vbids.empty()) {
+        return 0;
+    }
+
+    KVShard *shard = vbMap.getShardByVbId(vbids.front());
+    for (auto vbid : vbids) {
+        if (vbMap.getShardByVbId(vbid) != shard) {
+            throw std::invalid_argument(
+                    "KVBucket::flushVBuckets: vb:" + std::to_string(vbid) +
+                    " is not in shard " + std::to_string(shard->getId()));
+        }
+    }
+
     if (diskDeleteAll && !deleteAllTaskCtx.delay) {
         if (shard->getId() == EP_PRIMARY_SHARD) {
             flushOneDeleteAll();
@@ -2034,18 +2183,46 @@ int KVBucket::flushVBucket(uint16_t vbid) {
         }
     }
 
-    int items_flushed = 0;
+    size_t items_flushed = 0;
     const hrtime_t flush_start = gethrtime();
+    const hrtime_t group_deadline =
+            flush_start + flusherGroupCommitMaxLatency.load() * 1000000;
+
+    KVStore* rwUnderlying = shard->getRWUnderlying();
+    std::list<PersistenceCallback*>& pcbs = rwUnderlying->getPersistenceCbList();
+    const Item* collectionsManifest = nullptr;
+    bool inTransaction = false;
+
+    // Phase 1: write each vbucket's outstanding items to the transaction,
+    // holding its lock until the items have been committed.
+    std::vector<VBucketFlush> flushes;
+    flushes.reserve(vbids.size());
+    size_t next = 0;
+    for (; next < vbids.size(); ++next) {
+        // Stop at the latency bound, or after a vbucket with a collections
+        // manifest (only one may be committed at a time).
+        if (next > 0 &&
+            (collectionsManifest || gethrtime() >= group_deadline)) {
+            break;
+        }
+
+        const uint16_t vbid = vbids[next];
+        VBucketPtr vb = vbMap.getBucket(vbid);
+        if (!vb) {
+            continue;
+        }
 
-    VBucketPtr vb = vbMap.getBucket(vbid);
-    if (vb) {
         std::unique_lock<std::mutex> lh(vb_mutexes[vbid], std::try_to_lock);
         if (!lh.owns_lock()) { // Try another bucket if this one is locked
-            return RETRY_FLUSH_VBUCKET; // to avoid blocking flusher
+            requeue.push_back(vbid); // to avoid blocking flusher
+            continue;
         }
 
+        flushes.emplace_back(vb);
+        VBucketFlush& flush = flushes.back();
+        flush.lh = std::move(lh);
+
         std::vector<queued_item> items;
-        KVStore *rwUnderlying = getRWUnderlying(vbid);
 
         while (!vb->rejectQueue.empty()) {
             items.push_back(vb->rejectQueue.front());
@@ -2056,151 +2233,194 @@ int KVBucket::flushVBucket(uint16_t vbid) {
         vb->getBackfillItems(items);
 
         // Append all items outstanding for the persistence cursor.
-        snapshot_range_t range;
         hrtime_t _begin_ = gethrtime();
-        range = vb->checkpointManager.getAllItemsForCursor(
+        flush.range = vb->checkpointManager.getAllItemsForCursor(
                 CheckpointManager::pCursorName, items);
         stats.persistenceCursorGetItemsHisto.add((gethrtime() - _begin_) / 1000);
 
-        if (!items.empty()) {
+        if (items.empty()) {
+            continue;
+        }
+        flush.hadItems = true;
+
+        if (!inTransaction) {
             while (!rwUnderlying->begin()) {
                 ++stats.beginFailed;
                 LOG(EXTENSION_LOG_WARNING, "Failed to start a transaction!!! "
                     "Retry in 1 sec ...");
                 sleep(1);
             }
-            rwUnderlying->optimizeWrites(items);
+            inTransaction = true;
+        }
+        rwUnderlying->optimizeWrites(items);
 
-            Item *prev = NULL;
-            auto vbstate = vb->getVBucketState();
-            uint64_t maxSeqno = 0;
-            range.start = std::max(range.start, vbstate.lastSnapStart);
+        Item *prev = NULL;
+        auto vbstate = vb->getVBucketState();
+        uint64_t maxSeqno = 0;
+        auto& range = flush.range;
+        range.start = std::max(range.start, vbstate.lastSnapStart);
 
-            bool mustCheckpointVBState = false;
-            std::list<PersistenceCallback*>& pcbs = rwUnderlying->getPersistenceCbList();
+        bool mustCheckpointVBState = false;
 
-            SystemEventFlush sef;
+        for (const auto& item : items) {
 
-            for (const auto& item : items) {
+            if (!item->shouldPersist()) {
+                continue;
+            }
 
-                if (!item->shouldPersist()) {
-                    continue;
-                }
+            // Pass the Item through the SystemEventFlush which may filter
+            // the item away (return Skip).
+            if (flush.sef.process(item) == ProcessStatus::Skip) {
+                // The item has no further flushing actions i.e. we've
+                // absorbed it in the process function.
+                // Update stats and carry-on
+                --stats.diskQueueSize;
+                vb->doStatsForFlushing(*item, item->size());
+                continue;
+            }
+
+            if (item->getOperation() == queue_op::set_vbucket_state) {
+                // No actual item explicitly persisted to (this op exists
+                // to ensure a commit occurs with the current vbstate);
+                // flag that we must trigger a snapshot even if there are
+                // no 'real' items in the checkpoint.
+                mustCheckpointVBState = true;
 
-                // Pass the Item through the SystemEventFlush which may filter
-                // the item away (return Skip).
-                if (sef.process(item) == ProcessStatus::Skip) {
-                    // The item has no further flushing actions i.e. we've
-                    // absorbed it in the process function.
-                    // Update stats and carry-on
-                    --stats.diskQueueSize;
-                    vb->doStatsForFlushing(*item, item->size());
-                    continue;
+                // Update queuing stats how this item has logically been
+                // processed.
+                --stats.diskQueueSize;
+                vb->doStatsForFlushing(*item, item->size());
+
+            } else if (!prev || prev->getKey() != item->getKey()) {
+                prev = item.get();
+                ++flush.itemsFlushed;
+                PersistenceCallback *cb = flushOneDelOrSet(item, vb);
+                if (cb) {
+                    pcbs.push_back(cb);
                 }
 
-                if (item->getOperation() == queue_op::set_vbucket_state) {
-                    // No actual item explicitly persisted to (this op exists
-                    // to ensure a commit occurs with the current vbstate);
-                    // flag that we must trigger a snapshot even if there are
-                    // no 'real' items in the checkpoint.
-                    mustCheckpointVBState = true;
-
-                    // Update queuing stats how this item has logically been
-                    // processed.
-                    --stats.diskQueueSize;
-                    vb->doStatsForFlushing(*item, item->size());
-
-                } else if (!prev || prev->getKey() != item->getKey()) {
-                    prev = item.get();
-                    ++items_flushed;
-                    PersistenceCallback *cb = flushOneDelOrSet(item, vb);
-                    if (cb) {
-                        pcbs.push_back(cb);
-                    }
+                maxSeqno = std::max(maxSeqno, (uint64_t)item->getBySeqno());
+                vbstate.maxCas = std::max(vbstate.maxCas, item->getCas());
+                if (item->isDeleted()) {
+                    vbstate.maxDeletedSeqno =
+                            std::max(vbstate.maxDeletedSeqno,
+                                     item->getRevSeqno());
+                }
+                ++stats.flusher_todo;
 
-                    maxSeqno = std::max(maxSeqno, (uint64_t)item->getBySeqno());
-                    vbstate.maxCas = std::max(vbstate.maxCas, item->getCas());
-                    if (item->isDeleted()) {
-                        vbstate.maxDeletedSeqno =
-                                std::max(vbstate.maxDeletedSeqno,
-                                         item->getRevSeqno());
-                    }
-                    ++stats.flusher_todo;
+            } else {
+                // Item is the same key as the previous[1] one - don't need
+                // to flush to disk.
+                // [1] Previous here really means 'next' - optimizeWrites()
+                //     above has actually re-ordered items such that items
+                //     with the same key are ordered from high->low seqno.
+                //     This means we only write the highest (i.e. newest)
+                //     item for a given key, and discard any duplicate,
+                //     older items.
+                --stats.diskQueueSize;
+                vb->doStatsForFlushing(*item, item->size());
+            }
+        }
+        items_flushed += flush.itemsFlushed;
 
-                } else {
-                    // Item is the same key as the previous[1] one - don't need
-                    // to flush to disk.
-                    // [1] Previous here really means 'next' - optimizeWrites()
-                    //     above has actually re-ordered items such that items
-                    //     with the same key are ordered from high->low seqno.
-                    //     This means we only write the highest (i.e. newest)
-                    //     item for a given key, and discard any duplicate,
-                    //     older items.
-                    --stats.diskQueueSize;
-                    vb->doStatsForFlushing(*item, item->size());
+        {
+            ReaderLockHolder rlh(vb->getStateLock());
+            if (vb->getState() == vbucket_state_active) {
+                if (maxSeqno) {
+                    range.start = maxSeqno;
+                    range.end = maxSeqno;
                 }
             }
 
+            // Update VBstate based on the changes we have just made,
+            // then tell the rwUnderlying the 'new' state
+            // (which will persisted as part of the commit() below).
+            vbstate.lastSnapStart = range.start;
+            vbstate.lastSnapEnd = range.end;
+
+            // Do we need to trigger a persist of the state?
+            // If there are no "real" items to flush, and we encountered
+            // a set_vbucket_state meta-item.
+            auto options = VBStatePersist::VBSTATE_CACHE_UPDATE_ONLY;
+            if ((flush.itemsFlushed == 0) && mustCheckpointVBState) {
+                options = VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT;
+            }
 
-            {
-                ReaderLockHolder rlh(vb->getStateLock());
-                if (vb->getState() == vbucket_state_active) {
-                    if (maxSeqno) {
-                        range.start = maxSeqno;
-                        range.end = maxSeqno;
-                    }
-                }
+            if (rwUnderlying->snapshotVBucket(vb->getId(), vbstate,
+                                              options) != true) {
+                // Any items written are committed along with the rest of
+                // the group, so keep holding the vbucket's lock until then,
+                // but it must be flushed again before it is considered
+                // persisted.
+                flush.snapshotFailed = true;
+                continue;
+            }
 
-                // Update VBstate based on the changes we have just made,
-                // then tell the rwUnderlying the 'new' state
-                // (which will persisted as part of the commit() below).
-                vbstate.lastSnapStart = range.start;
-                vbstate.lastSnapEnd = range.end;
-
-                // Do we need to trigger a persist of the state?
-                // If there are no "real" items to flush, and we encountered
-                // a set_vbucket_state meta-item.
-                auto options = VBStatePersist::VBSTATE_CACHE_UPDATE_ONLY;
-                if ((items_flushed == 0) && mustCheckpointVBState) {
-                    options = VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT;
-                }
+            if (vb->setBucketCreation(false)) {
+                LOG(EXTENSION_LOG_INFO, "VBucket %" PRIu16 " created", vbid);
+            }
+        }
 
-                if (rwUnderlying->snapshotVBucket(vb->getId(), vbstate,
-                                                  options) != true) {
-                    return RETRY_FLUSH_VBUCKET;
-                }
+        if (flush.sef.getCollectionsManifestItem()) {
+            collectionsManifest = flush.sef.getCollectionsManifestItem();
+        }
+    }
 
-                if (vb->setBucketCreation(false)) {
-                    LOG(EXTENSION_LOG_INFO, "VBucket %" PRIu16 " created", vbid);
-                }
-            }
+    // The vbuckets we didn't reach.
+    requeue.insert(requeue.end(), vbids.begin() + next, vbids.end());
 
-            /* Perform an explicit commit to disk if the commit
-             * interval reaches zero and if there is a non-zero number
-             * of items to flush.
-             * Or if there is a manifest item
-             */
-            if (items_flushed > 0 || sef.getCollectionsManifestItem()) {
-                commit(*rwUnderlying, sef.getCollectionsManifestItem());
+    // Phase 2: perform an explicit commit to disk if there is a non-zero
+    // number of items to flush, or if there is a manifest item.
+    if (items_flushed > 0 || collectionsManifest) {
+        commit(*rwUnderlying, collectionsManifest);
 
+        size_t vbsCommitted = 0;
+        for (auto& flush : flushes) {
+            if (flush.itemsFlushed > 0 ||
+                flush.sef.getCollectionsManifestItem()) {
+                ++vbsCommitted;
                 // Now the commit is complete, vBucket file must exist.
-                if (vb->setBucketCreation(false)) {
-                    LOG(EXTENSION_LOG_INFO, "VBucket %" PRIu16 " created", vbid);
+                if (flush.vb->setBucketCreation(false)) {
+                    LOG(EXTENSION_LOG_INFO,
+                        "VBucket %" PRIu16 " created",
+                        flush.vb->getId());
                 }
             }
+        }
+        stats.flusherCommitItemsHisto.add(items_flushed);
+        stats.flusherCommitVBucketsHisto.add(vbsCommitted);
+    }
+
+    // Phase 3: complete each vbucket's flush now its items are on disk.
+    if (inTransaction) {
+        hrtime_t flush_end = gethrtime();
+        uint64_t trans_time = (flush_end - flush_start) / 1000000;
+
+        lastTransTimePerItem.store((items_flushed == 0) ? 0 :
+                                   static_cast<double>(trans_time) /
+                                   static_cast<double>(items_flushed));
+        stats.cumulativeFlushTime.fetch_add(trans_time);
+        stats.flusher_todo.store(0);
+    }
+
+    if (!flushes.empty()) {
+        rwUnderlying->pendingTasks();
+    }
+
+    for (auto& flush : flushes) {
+        auto& vb = flush.vb;
+        const uint16_t vbid = vb->getId();
 
-            hrtime_t flush_end = gethrtime();
-            uint64_t trans_time = (flush_end - flush_start) / 1000000;
+        if (flush.snapshotFailed) {
+            requeue.push_back(vbid);
+            continue;
+        }
 
-            lastTransTimePerItem.store((items_flushed == 0) ? 0 :
-                                       static_cast<double>(trans_time) /
-                                       static_cast<double>(items_flushed));
-            stats.cumulativeFlushTime.fetch_add(trans_time);
-            stats.flusher_todo.store(0);
+        if (flush.hadItems) {
             stats.totalPersistVBState++;
 
             if (vb->rejectQueue.empty()) {
-                vb->setPersistedSnapshot(range.start, range.end);
+                vb->setPersistedSnapshot(flush.range.start, flush.range.end);
                 uint64_t highSeqno = rwUnderlying->getLastPersistedSeqno(vbid);
                 if (highSeqno > 0 &&
                     highSeqno != vb->getPersistenceSeqno()) {
@@ -2209,8 +2429,6 @@ int KVBucket::flushVBucket(uint16_t vbid) {
             }
         }
 
-        rwUnderlying->pendingTasks();
-
         if (vb->checkpointManager.getNumCheckpoints() > 1) {
             wakeUpCheckpointRemover();
         }
@@ -2227,7 +2445,7 @@ int KVBucket::flushVBucket(uint16_t vbid) {
                 vb->setPersistenceCheckpointId(chkid);
             }
         } else {
-            return RETRY_FLUSH_VBUCKET;
+            requeue.push_back(vbid);
         }
     }
 
@@ -155,6 +155,27 @@ public:
                            options);
     }
 
+    /**
+     * Retrieve a batch of values from a single (active) vbucket. Equivalent
+     * to calling get() for each key, but only looks up the vbucket and
+     * acquires its state lock once for the whole batch, looks up keys which
+     * share a hash bucket under one acquisition of its lock, and hands all
+     * of the background fetches needed to the fetcher in one go.
+     *
+     * @param vbucket the vbucket all of the keys belong to
+     * @param keys    the keys to fetch
+     * @param batch   the batch (and cookie) every background fetch or
+     *                pending op is registered against; the caller notifies
+     *                the cookie if it releases the batch's last reference
+     * @param options options specified for retrieval
+     *
+     * @return a GetValue per key, in the same order as keys
+     */
+    std::vector<GetValue> getMulti(uint16_t vbucket,
+                                   const std::vector<DocKey>& keys,
+                                   const std::shared_ptr<GetMultiBatch>& batch,
+                                   get_options_t options);
+
     GetValue getRandomKey(void);
 
     /**
@@ -297,12 +318,14 @@ public:
      * @param init the timestamp of when the request came in
      * @param isMeta whether the fetch is for a non-resident value or metadata of
      *               a (possibly) deleted item
+     * @param batch the getMulti() batch the fetch belongs to, if any
      */
     void completeBGFetch(const DocKey& key,
                          uint16_t vbucket,
                          const void* cookie,
                          ProcessClock::time_point init,
-                         bool isMeta);
+                         bool isMeta,
+                         const std::shared_ptr<GetMultiBatch>& batch);
     /**
      * Complete a batch of background fetch of a non resident value or metadata.
      *
@@ -615,6 +638,37 @@ public:
      */
     int flushVBucket(uint16_t vbid);
 
+    /**
+     * Group commit: flushes the items waiting for persistence in several
+     * vbuckets of the same shard in a single KVStore transaction, so they are
+     * committed together. Persistence callbacks and high priority requests
+     * are notified once for the whole group.
+     *
+     * vbuckets are added to the group in order until it has spent
+     * flusher_group_commit_max_latency writing, or one of them carries a
+     * collections manifest update (only one may be committed at a time).
+     *
+     * @param vbids The ids of the vbuckets to flush
+     * @param requeue Set to the vbuckets which must be flushed again; those
+     *        which were locked or failed, and those not reached
+     * @return The number of items flushed
+     */
+    size_t flushVBuckets(const std::vector<uint16_t>& vbids,
+                         std::vector<uint16_t>& requeue);
+
+    /// @return the maximum number of vbuckets a flusher commits together
+    size_t getFlusherGroupCommitMaxVBuckets() const {
+        return flusherGroupCommitMaxVBuckets;
+    }
+
+    void setFlusherGroupCommitMaxVBuckets(size_t to) {
+        flusherGroupCommitMaxVBuckets = to;
+    }
+
+    void setFlusherGroupCommitMaxLatency(size_t ms) {
+        flusherGroupCommitMaxLatency = ms;
+    }
+
     void commit(KVStore& kvstore, const Item* collectionsManifest);
 
     void addKVStoreStats(ADD_STAT add_stat, const void* cookie);
@@ -825,6 +879,10 @@ protected:
     size_t                          compactionWriteQueueCap;
     float                           compactionExpMemThreshold;
 
+    /* Group commit limits; see flushVBuckets */
+    std::atomic<size_t> flusherGroupCommitMaxVBuckets;
+    std::atomic<size_t> flusherGroupCommitMaxLatency; // ms
+
     /* Array of mutexes for each vbucket
      * Used by flush operations: flushVB, deleteVB, compactVB, snapshotVB */
     std::mutex                          *vb_mutexes;
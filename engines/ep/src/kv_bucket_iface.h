@@ -136,6 +136,23 @@ public:
     virtual GetValue get(const DocKey& key, uint16_t vbucket,
                          const void *cookie, get_options_t options) = 0;
 
+    /**
+     * Retrieve a batch of values from a single vbucket.
+     *
+     * @param vbucket the vbucket all of the keys belong to
+     * @param keys    the keys to fetch
+     * @param batch   the batch (and cookie) any background fetches are
+     *                registered against
+     * @param options options specified for retrieval
+     *
+     * @return a GetValue per key, in the same order as keys
+     */
+    virtual std::vector<GetValue> getMulti(
+            uint16_t vbucket,
+            const std::vector<DocKey>& keys,
+            const std::shared_ptr<GetMultiBatch>& batch,
+            get_options_t options) = 0;
+
     virtual GetValue getRandomKey(void) = 0;
 
     /**
@@ -374,12 +391,14 @@ public:
      * @param init the timestamp of when the request came in
      * @param isMeta whether the fetch is for a non-resident value or metadata of
      *               a (possibly) deleted item
+     * @param batch the getMulti() batch the fetch belongs to, if any
      */
     virtual void completeBGFetch(const DocKey& key,
                                  uint16_t vbucket,
                                  const void* cookie,
                                  ProcessClock::time_point init,
-                                 bool isMeta) = 0;
+                                 bool isMeta,
+                                 const std::shared_ptr<GetMultiBatch>& batch) = 0;
     /**
      * Complete a batch of background fetch of a non resident value or metadata.
      *
@@ -662,6 +681,16 @@ public:
      */
     virtual int flushVBucket(uint16_t vbid) = 0;
 
+    /**
+     * Flushes all items waiting for persistence in several vbuckets of the
+     * same shard, committing them together (group commit).
+     * @param vbids The ids of the vbuckets to flush
+     * @param requeue Set to the vbuckets which must be flushed again
+     * @return The number of items flushed
+     */
+    virtual size_t flushVBuckets(const std::vector<uint16_t>& vbids,
+                                 std::vector<uint16_t>& requeue) = 0;
+
     virtual void commit(KVStore& kvstore, const Item* collectionsManifest) = 0;
 
     virtual void addKVStoreStats(ADD_STAT add_stat, const void* cookie) = 0;
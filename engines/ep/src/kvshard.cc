@@ -34,7 +34,7 @@ KVShard::KVShard(uint16_t id, KVBucket& kvBucket)
       highPriorityCount(0) {
     const std::string backend = kvConfig.getBackend();
 
-    if (backend == "couchdb") {
+    if (backend == "couchdb" || backend == "logstore") {
         auto stores = KVStoreFactory::create(kvConfig);
         rwStore = std::move(stores.rw);
         roStore = std::move(stores.ro);
@@ -26,6 +26,7 @@
 #ifdef EP_USE_FORESTDB
 #include "forest-kvstore/forest-kvstore.h"
 #endif
+#include "log-kvstore/log-kvstore.h"
 #include "statwriter.h"
 #include "kvstore.h"
 #include "vbucket.h"
@@ -40,6 +41,8 @@ KVStoreConfig::KVStoreConfig(Configuration& config, uint16_t shardid)
                     config.getBackend(),
                     shardid,
                     config.isCollectionsPrototypeEnabled()) {
+    setReadHandleCacheSize(config.getCouchstoreReadHandleCacheSize());
+    setSegmentSize(config.getLogstoreSegmentSize());
 }
 
 KVStoreConfig::KVStoreConfig(uint16_t _maxVBuckets,
@@ -55,7 +58,9 @@ KVStoreConfig::KVStoreConfig(uint16_t _maxVBuckets,
       shardId(_shardId),
       logger(&global_logger),
       buffered(true),
-      persistDocNamespace(_persistDocNamespace) {
+      persistDocNamespace(_persistDocNamespace),
+      readHandleCacheSize(DefaultReadHandleCacheSize),
+      segmentSize(DefaultSegmentSize) {
 }
 
 KVStoreConfig& KVStoreConfig::setLogger(Logger& _logger) {
@@ -68,11 +73,26 @@ KVStoreConfig& KVStoreConfig::setBuffered(bool _buffered) {
     return *this;
 }
 
+KVStoreConfig& KVStoreConfig::setReadHandleCacheSize(size_t size) {
+    readHandleCacheSize = size;
+    return *this;
+}
+
+KVStoreConfig& KVStoreConfig::setSegmentSize(size_t size) {
+    segmentSize = size;
+    return *this;
+}
+
 KVStoreRWRO KVStoreFactory::create(KVStoreConfig& config) {
     if (config.getBackend().compare("couchdb") == 0) {
         auto rw = std::make_unique<CouchKVStore>(config);
         auto ro = rw->makeReadOnlyStore();
         return {rw.release(), ro.release()};
+    } else if (config.getBackend().compare("logstore") == 0) {
+        // LogKVStore serves reads and writes from the same instance (and
+        // in-memory index).
+        auto rw = std::make_unique<LogKVStore>(config);
+        return {rw.release(), nullptr};
     } else {
         throw std::invalid_argument("KVStoreFactory::create unknown backend:" +
                                     config.getBackend());
@@ -230,6 +250,12 @@ void KVStore::addStats(ADD_STAT add_stat, const void *c) {
     addStat(prefix, "failure_open",   st.numOpenFailure, add_stat, c);
     addStat(prefix, "failure_get",    st.numGetFailure,  add_stat, c);
 
+    addStat(prefix, "read_handle_cache_hits", st.numReadHandleCacheHits,
+            add_stat, c);
+    addStat(prefix, "read_handle_cache_misses", st.numReadHandleCacheMisses,
+            add_stat, c);
+    addStat(prefix, "read_handles_open", st.numReadHandlesOpen, add_stat, c);
+
     if (!isReadOnly()) {
         addStat(prefix, "failure_set",   st.numSetFailure,   add_stat, c);
         addStat(prefix, "failure_del",   st.numDelFailure,   add_stat, c);
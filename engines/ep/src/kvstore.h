@@ -337,6 +337,9 @@ public:
       io_num_write(0),
       io_read_bytes(0),
       io_write_bytes(0),
+      numReadHandleCacheHits(0),
+      numReadHandleCacheMisses(0),
+      numReadHandlesOpen(0),
       readSizeHisto(ExponentialGenerator<size_t>(1, 2), 25),
       writeSizeHisto(ExponentialGenerator<size_t>(1, 2), 25) {
     }
@@ -353,6 +356,8 @@ public:
         numDelFailure = 0;
         numOpenFailure = 0;
         numVbSetFailure = 0;
+        numReadHandleCacheHits = 0;
+        numReadHandleCacheMisses = 0;
 
         readTimeHisto.reset();
         readSizeHisto.reset();
@@ -392,6 +397,13 @@ public:
     //! Number of bytes written (key + value + application rev metadata)
     Couchbase::RelaxedAtomic<size_t> io_write_bytes;
 
+    //! Number of reads which found an open file handle in the cache
+    Couchbase::RelaxedAtomic<size_t> numReadHandleCacheHits;
+    //! Number of reads which had to open the file
+    Couchbase::RelaxedAtomic<size_t> numReadHandleCacheMisses;
+    //! Number of read-only file handles currently open (cached or in use)
+    Couchbase::RelaxedAtomic<size_t> numReadHandlesOpen;
+
     /* for flush and vb delete, no error handling in KVStore, such
      * failure should be tracked in MC-engine  */
 
@@ -468,11 +480,17 @@ public:
         No
     };
 
+    enum class GroupCommit {
+        Yes,
+        No
+    };
+
     StorageProperties(EfficientVBDump evb, EfficientVBDeletion evd, PersistedDeletion pd,
-                      EfficientGet eget, ConcurrentWriteCompact cwc)
+                      EfficientGet eget, ConcurrentWriteCompact cwc,
+                      GroupCommit gc = GroupCommit::No)
         : efficientVBDump(evb), efficientVBDeletion(evd),
           persistedDeletions(pd), efficientGet(eget),
-          concWriteCompact(cwc) {}
+          concWriteCompact(cwc), groupCommit(gc) {}
 
     /* True if we can efficiently dump a single vbucket */
     bool hasEfficientVBDump() const {
@@ -500,12 +518,19 @@ public:
         return (concWriteCompact == ConcurrentWriteCompact::Yes);
     }
 
+    /* True if a single transaction (begin ... commit) may contain items
+     * from more than one vbucket */
+    bool hasGroupCommit() const {
+        return (groupCommit == GroupCommit::Yes);
+    }
+
 private:
     EfficientVBDump efficientVBDump;
     EfficientVBDeletion efficientVBDeletion;
     PersistedDeletion persistedDeletions;
     EfficientGet efficientGet;
     ConcurrentWriteCompact concWriteCompact;
+    GroupCommit groupCommit;
 };
 
 class RollbackCB;
@@ -513,6 +538,12 @@ class Configuration;
 
 class KVStoreConfig {
 public:
+    /// Read handle cache size used unless overridden (per KVStore pair)
+    static const size_t DefaultReadHandleCacheSize = 64;
+
+    /// Log segment size used unless overridden
+    static const size_t DefaultSegmentSize = 64 * 1024 * 1024;
+
     /**
      * This constructor intialises the object from a central
      * ep-engine Configuration instance.
@@ -577,6 +608,40 @@ public:
      */
     KVStoreConfig& setBuffered(bool _buffered);
 
+    /**
+     * The maximum number of read-only file handles to keep open for reuse
+     * (0 disables the cache).
+     *
+     * Only recognised by CouchKVStore
+     */
+    size_t getReadHandleCacheSize() const {
+        return readHandleCacheSize;
+    }
+
+    /**
+     * Used to override the default size of the read handle cache.
+     *
+     * Only recognised by CouchKVStore
+     */
+    KVStoreConfig& setReadHandleCacheSize(size_t size);
+
+    /**
+     * The size (in bytes) at which a vBucket's active log segment is
+     * sealed and a new one started.
+     *
+     * Only recognised by LogKVStore
+     */
+    size_t getSegmentSize() const {
+        return segmentSize;
+    }
+
+    /**
+     * Used to override the default log segment size.
+     *
+     * Only recognised by LogKVStore
+     */
+    KVStoreConfig& setSegmentSize(size_t size);
+
     bool shouldPersistDocNamespace() const {
         return persistDocNamespace;
     }
@@ -594,6 +659,8 @@ private:
     Logger* logger;
     bool buffered;
     bool persistDocNamespace;
+    size_t readHandleCacheSize;
+    size_t segmentSize;
 };
 
 class IORequest {
@@ -345,6 +345,11 @@ size_t BasicLinkedList::getStaleMetadataBytes() const {
     return staleMetaDataSize;
 }
 
+size_t BasicLinkedList::getNodeBytes() const {
+    /* The list is intrusive; the links are in the OrderedStoredValues */
+    return 0;
+}
+
 uint64_t BasicLinkedList::getNumDeletedItems() const {
     std::lock_guard<std::mutex> lckGd(getListWriteLock());
     return numDeletedItems;
@@ -387,6 +392,24 @@ SequenceList::RangeIterator BasicLinkedList::makeRangeIterator() {
             std::make_unique<RangeIteratorLL>(*this));
 }
 
+boost::optional<SequenceList::RangeIterator>
+BasicLinkedList::makeRangeIterator(seqno_t start) {
+    /* Only 1 range read at a time; don't wait for the current one (which can
+       be a slow DCP backfill) to finish */
+    std::unique_lock<std::mutex> readLock(rangeReadLock, std::try_to_lock);
+    if (!readLock.owns_lock()) {
+        return boost::none;
+    }
+
+    boost::optional<SequenceList::RangeIterator> itr(
+            SequenceList::RangeIterator(std::make_unique<RangeIteratorLL>(
+                    *this, std::move(readLock))));
+    while ((itr->curr() != itr->end()) && (itr->curr() < start)) {
+        ++(*itr);
+    }
+    return itr;
+}
+
 void BasicLinkedList::dump() const {
     std::cerr << *this << std::endl;
 }
@@ -432,8 +455,13 @@ OrderedLL::iterator BasicLinkedList::purgeListElem(OrderedLL::iterator it) {
 }
 
 BasicLinkedList::RangeIteratorLL::RangeIteratorLL(BasicLinkedList& ll)
+    : RangeIteratorLL(ll, std::unique_lock<std::mutex>(ll.rangeReadLock)) {
+}
+
+BasicLinkedList::RangeIteratorLL::RangeIteratorLL(
+        BasicLinkedList& ll, std::unique_lock<std::mutex> readLock)
     : list(ll),
-      readLockHolder(list.rangeReadLock),
+      readLockHolder(std::move(readLock)),
       itrRange(0, 0),
       numRemaining(0),
       earlySnapShotEndSeqno(0) {
@@ -42,72 +42,6 @@ using MemberHookOption =
 /* This list will use the member hook */
 using OrderedLL = boost::intrusive::list<OrderedStoredValue, MemberHookOption>;
 
-/**
- * Class that represents a range of sequence numbers.
- * SeqRange is closed, that is, both begin and end are inclusive.
- *
- * Note: begin <= 0 is considered an default/inactive range and can be set
- *       only by ctor or by reset.
- */
-class SeqRange {
-public:
-    SeqRange(const seqno_t beginVal, const seqno_t endVal)
-        : end(endVal), begin(beginVal) {
-        if ((end < begin) || (begin < 0)) {
-            throw std::invalid_argument("Trying to create invalid SeqRange: [" +
-                                        std::to_string(begin) + ", " +
-                                        std::to_string(end) + "]");
-        }
-    }
-
-    SeqRange& operator=(const SeqRange& other) {
-        begin = other.begin;
-        end = other.end;
-        return *this;
-    }
-
-    /**
-     * Returns true if the range overlaps with another.
-     */
-    bool overlaps(const SeqRange& other) const {
-        return std::max(begin, other.begin) <= std::min(end, other.end);
-    }
-
-    /**
-     *  Returns true if the seqno falls in the range
-     */
-    bool fallsInRange(const seqno_t seqno) const {
-        return (seqno >= begin) && (seqno <= end);
-    }
-
-    void reset() {
-        begin = 0;
-        end = 0;
-    }
-
-    seqno_t getBegin() const {
-        return begin;
-    }
-
-    void setBegin(const seqno_t start) {
-        if ((start <= 0) || (start > end)) {
-            throw std::invalid_argument(
-                    "Trying to set incorrect begin " + std::to_string(start) +
-                    " on SeqRange: [" + std::to_string(begin) + ", " +
-                    std::to_string(end) + "]");
-        }
-        begin = start;
-    }
-
-    seqno_t getEnd() const {
-        return end;
-    }
-
-private:
-    seqno_t end;
-    seqno_t begin;
-};
-
 /**
  * This class implements SequenceList as a basic doubly linked list.
  * Uses boost intrusive list for doubly linked list implementation.
@@ -184,6 +118,8 @@ public:
 
     size_t getStaleMetadataBytes() const override;
 
+    size_t getNodeBytes() const override;
+
     uint64_t getNumDeletedItems() const override;
 
     uint64_t getNumItems() const override;
@@ -202,6 +138,15 @@ public:
 
     SequenceList::RangeIterator makeRangeIterator() override;
 
+    /**
+     * The linked list has no index, so the iterator is created from the
+     * beginning of the list and advanced till start (without holding the
+     * list writeLock). Returns boost::none if another range read is in
+     * progress.
+     */
+    boost::optional<SequenceList::RangeIterator> makeRangeIterator(
+            seqno_t start) override;
+
     void dump() const override;
 
 protected:
@@ -311,6 +256,14 @@ private:
     public:
         RangeIteratorLL(BasicLinkedList& ll);
 
+        /**
+         * @param ll The list to iterate
+         * @param readLock Already acquired lock on ll.rangeReadLock; the
+         *                 iterator takes over its ownership
+         */
+        RangeIteratorLL(BasicLinkedList& ll,
+                        std::unique_lock<std::mutex> readLock);
+
         ~RangeIteratorLL();
 
         OrderedStoredValue& operator*() const override;
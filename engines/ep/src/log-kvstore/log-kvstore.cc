@@ -0,0 +1,2913 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <set>
+#include <sstream>
+
+#include <cJSON.h>
+#include <phosphor/phosphor.h>
+#include <platform/dirutils.h>
+#include <platform/strerror.h>
+
+#include "common.h"
+extern "C" {
+#include "crc32.h"
+}
+#include "ep_time.h"
+#include "log-kvstore/log-kvstore.h"
+#include "vbucket.h"
+#include "vbucket_bgfetch_item.h"
+
+/*
+ * Segment file format
+ * ===================
+ *
+ * A segment is a sequence of records, each made up of a 12 byte header
+ * followed by its payload (all integers are in network byte order):
+ *
+ *     crc32 (4) | type (1) | unused (3) | payload length (4) | payload
+ *
+ * The crc covers everything following it (type to the end of the payload).
+ * Records don't refer to their position in the file, so compaction and
+ * rollback copy them verbatim.
+ *
+ *  - SegmentHeader: magic (8), vbid (2), revision (8), segment id (8).
+ *    The first record of every segment.
+ *  - Document: seqno (8), revSeqno (8), cas (8), exptime (4), flags (4),
+ *    value length (4), key length (2), datatype (1), deleted (1),
+ *    namespace (1), key, value.
+ *  - VBState: version (8), state (4), checkpointId (8), maxDeletedSeqno (8),
+ *    highSeqno (8), purgeSeqno (8), lastSnapStart (8), lastSnapEnd (8),
+ *    maxCas (8), failovers length (4), failovers.
+ *  - Manifest: version (8), seqno (8), JSON length (4), JSON.
+ *  - Commit: number of segments replaced (4), their segment ids (8 each).
+ *
+ * The records written before a Commit record form a batch, which is only
+ * applied on startup if its Commit record is intact. A Commit record
+ * written by compaction or rollback lists the segments its batch replaces.
+ *
+ * Besides the latest version of each document, a segment may hold
+ * superseded versions which rollback still needs (see compactDB). Rollback
+ * is possible down to the vBucket's purge seqno.
+ *
+ * VBState and Manifest records carry a version (per vBucket and revision,
+ * incremented with every record written); the highest version wins.
+ * For documents the highest seqno wins.
+ */
+
+namespace {
+
+/// "LOGKV001": identifies a segment file and the version of its format
+const uint64_t SegmentMagic = 0x4c4f474b56303031ull;
+
+enum class RecordType : uint8_t {
+    SegmentHeader = 1,
+    Document = 2,
+    VBState = 3,
+    Manifest = 4,
+    Commit = 5
+};
+
+const size_t RecordHeaderSize = 12;
+
+/// Anything claiming to be bigger than this is treated as corrupt
+const uint32_t MaxRecordSize = 256 * 1024 * 1024;
+
+/// Compaction and rollback write their output in chunks of (about) this size
+const size_t OutputChunkSize = 1024 * 1024;
+
+/// Compaction picks the segments where less than this fraction of the bytes
+/// is still needed
+const double CompactionLiveRatio = 0.5;
+
+/// Segments are read sequentially in chunks of (at least) this size
+const size_t ReadAheadSize = 1024 * 1024;
+
+/// Walks over the index release the vBucket's mutex after this many entries
+const size_t IndexChunkSize = 1000;
+
+/**
+ * Appends a record to a buffer.
+ */
+class RecordBuilder {
+public:
+    RecordBuilder(std::string& buffer, RecordType type)
+        : buffer(buffer), start(buffer.size()) {
+        buffer.append(RecordHeaderSize, '\0');
+        buffer[start + 4] = static_cast<char>(type);
+    }
+
+    void put8(uint8_t value) {
+        buffer.push_back(static_cast<char>(value));
+    }
+
+    void put16(uint16_t value) {
+        value = htons(value);
+        putBytes(&value, sizeof(value));
+    }
+
+    void put32(uint32_t value) {
+        value = htonl(value);
+        putBytes(&value, sizeof(value));
+    }
+
+    void put64(uint64_t value) {
+        value = htonll(value);
+        putBytes(&value, sizeof(value));
+    }
+
+    void putBytes(const void* data, size_t len) {
+        buffer.append(static_cast<const char*>(data), len);
+    }
+
+    /**
+     * Fill in the record header.
+     *
+     * @return the length of the record (including the header)
+     */
+    uint32_t finish() {
+        const uint32_t length =
+                htonl(uint32_t(buffer.size() - start - RecordHeaderSize));
+        std::memcpy(&buffer[start + 8], &length, sizeof(length));
+        const uint32_t crc = htonl(
+                crc32buf(reinterpret_cast<uint8_t*>(&buffer[start + 4]),
+                         buffer.size() - start - 4));
+        std::memcpy(&buffer[start], &crc, sizeof(crc));
+        return uint32_t(buffer.size() - start);
+    }
+
+private:
+    std::string& buffer;
+    const size_t start;
+};
+
+/**
+ * Decodes the payload of a record; every get fails once the payload is
+ * exhausted.
+ */
+class RecordParser {
+public:
+    RecordParser(const char* data, size_t size)
+        : pos(data), end(data + size) {
+    }
+
+    bool get8(uint8_t& value) {
+        if (pos == end) {
+            return false;
+        }
+        value = static_cast<uint8_t>(*pos++);
+        return true;
+    }
+
+    bool get16(uint16_t& value) {
+        if (!getRaw(&value, sizeof(value))) {
+            return false;
+        }
+        value = ntohs(value);
+        return true;
+    }
+
+    bool get32(uint32_t& value) {
+        if (!getRaw(&value, sizeof(value))) {
+            return false;
+        }
+        value = ntohl(value);
+        return true;
+    }
+
+    bool get64(uint64_t& value) {
+        if (!getRaw(&value, sizeof(value))) {
+            return false;
+        }
+        value = ntohll(value);
+        return true;
+    }
+
+    bool getBytes(const char*& data, size_t len) {
+        if (size_t(end - pos) < len) {
+            return false;
+        }
+        data = pos;
+        pos += len;
+        return true;
+    }
+
+    bool getString(std::string& value) {
+        uint32_t len;
+        const char* data;
+        if (!get32(len) || !getBytes(data, len)) {
+            return false;
+        }
+        value.assign(data, len);
+        return true;
+    }
+
+private:
+    bool getRaw(void* value, size_t len) {
+        if (size_t(end - pos) < len) {
+            return false;
+        }
+        std::memcpy(value, pos, len);
+        pos += len;
+        return true;
+    }
+
+    const char* pos;
+    const char* const end;
+};
+
+/**
+ * Validate the header and checksum of the record at the start of buf.
+ *
+ * @param buf the record
+ * @param avail the number of bytes available at buf
+ * @param type set to the type of the record
+ * @param length set to the total length of the record
+ * @return true if buf holds a complete, intact record
+ */
+bool checkRecord(const char* buf, size_t avail, RecordType& type,
+                 uint32_t& length) {
+    if (avail < RecordHeaderSize) {
+        return false;
+    }
+    uint32_t crc;
+    uint32_t payloadLength;
+    std::memcpy(&crc, buf, sizeof(crc));
+    std::memcpy(&payloadLength, buf + 8, sizeof(payloadLength));
+    payloadLength = ntohl(payloadLength);
+    if (payloadLength > MaxRecordSize ||
+        avail - RecordHeaderSize < payloadLength) {
+        return false;
+    }
+    length = uint32_t(RecordHeaderSize + payloadLength);
+    if (ntohl(crc) !=
+        crc32buf(reinterpret_cast<uint8_t*>(const_cast<char*>(buf + 4)),
+                 length - 4)) {
+        return false;
+    }
+    type = static_cast<RecordType>(buf[4]);
+    return true;
+}
+
+/**
+ * A decoded Document record. The key and value point into the buffer the
+ * record was decoded from.
+ */
+struct DocumentRecord {
+    uint64_t seqno;
+    uint64_t revSeqno;
+    uint64_t cas;
+    uint32_t exptime;
+    uint32_t flags;
+    uint8_t datatype;
+    bool deleted;
+    DocNamespace docNamespace;
+    const char* key;
+    uint16_t keyLen;
+    const char* value;
+    uint32_t valueLen;
+
+    DocKey getKey() const {
+        return DocKey(reinterpret_cast<const uint8_t*>(key), keyLen,
+                      docNamespace);
+    }
+};
+
+void encodeDocument(std::string& buffer, const Item& itm, bool deleted) {
+    RecordBuilder record(buffer, RecordType::Document);
+    record.put64(itm.getBySeqno());
+    record.put64(itm.getRevSeqno());
+    record.put64(itm.getCas());
+    // As per CouchKVStore a deletion records the time it was persisted, which
+    // is what the tombstone purger goes by.
+    record.put32(deleted ? ep_real_time() : itm.getExptime());
+    record.put32(itm.getFlags());
+    record.put32(itm.getNBytes());
+    record.put16(itm.getKey().size());
+    record.put8(itm.getDataType());
+    record.put8(deleted ? 1 : 0);
+    record.put8(static_cast<uint8_t>(itm.getKey().getDocNamespace()));
+    record.putBytes(itm.getKey().data(), itm.getKey().size());
+    if (itm.getNBytes() > 0) {
+        record.putBytes(itm.getData(), itm.getNBytes());
+    }
+    record.finish();
+}
+
+bool decodeDocument(const char* payload, size_t len, DocumentRecord& doc) {
+    RecordParser parser(payload, len);
+    uint8_t deleted;
+    uint8_t docNamespace;
+    if (!parser.get64(doc.seqno) || !parser.get64(doc.revSeqno) ||
+        !parser.get64(doc.cas) || !parser.get32(doc.exptime) ||
+        !parser.get32(doc.flags) || !parser.get32(doc.valueLen) ||
+        !parser.get16(doc.keyLen) || !parser.get8(doc.datatype) ||
+        !parser.get8(deleted) || !parser.get8(docNamespace) ||
+        !parser.getBytes(doc.key, doc.keyLen) ||
+        !parser.getBytes(doc.value, doc.valueLen)) {
+        return false;
+    }
+    doc.deleted = deleted != 0;
+    doc.docNamespace = DocNamespace(docNamespace);
+    return true;
+}
+
+void encodeVBState(std::string& buffer,
+                   uint64_t version,
+                   const vbucket_state& state) {
+    RecordBuilder record(buffer, RecordType::VBState);
+    record.put64(version);
+    record.put32(static_cast<uint32_t>(state.state));
+    record.put64(state.checkpointId);
+    record.put64(state.maxDeletedSeqno);
+    record.put64(static_cast<uint64_t>(state.highSeqno));
+    record.put64(state.purgeSeqno);
+    record.put64(state.lastSnapStart);
+    record.put64(state.lastSnapEnd);
+    record.put64(state.maxCas);
+    record.put32(state.failovers.size());
+    record.putBytes(state.failovers.data(), state.failovers.size());
+    record.finish();
+}
+
+bool decodeVBState(const char* payload,
+                   size_t len,
+                   uint64_t& version,
+                   vbucket_state& state) {
+    RecordParser parser(payload, len);
+    uint32_t vbState;
+    uint64_t highSeqno;
+    if (!parser.get64(version) || !parser.get32(vbState) ||
+        !parser.get64(state.checkpointId) ||
+        !parser.get64(state.maxDeletedSeqno) || !parser.get64(highSeqno) ||
+        !parser.get64(state.purgeSeqno) || !parser.get64(state.lastSnapStart) ||
+        !parser.get64(state.lastSnapEnd) || !parser.get64(state.maxCas) ||
+        !parser.getString(state.failovers)) {
+        return false;
+    }
+    state.state = static_cast<vbucket_state_t>(vbState);
+    state.highSeqno = static_cast<int64_t>(highSeqno);
+    return true;
+}
+
+void encodeManifest(std::string& buffer,
+                    uint64_t version,
+                    uint64_t seqno,
+                    const std::string& manifest) {
+    RecordBuilder record(buffer, RecordType::Manifest);
+    record.put64(version);
+    record.put64(seqno);
+    record.put32(manifest.size());
+    record.putBytes(manifest.data(), manifest.size());
+    record.finish();
+}
+
+void encodeCommit(std::string& buffer,
+                  const std::vector<uint64_t>& superseded = {}) {
+    RecordBuilder record(buffer, RecordType::Commit);
+    record.put32(superseded.size());
+    for (auto segmentId : superseded) {
+        record.put64(segmentId);
+    }
+    record.finish();
+}
+
+std::string getSegmentFileName(const std::string& dbname,
+                               uint16_t vbid,
+                               uint64_t rev,
+                               uint64_t segmentId) {
+    return dbname + "/" + std::to_string(vbid) + ".logkv." +
+           std::to_string(rev) + "." + std::to_string(segmentId);
+}
+
+bool parseNumber(const std::string& str, uint64_t& value) {
+    if (str.empty() || str.size() > 19 ||
+        !std::all_of(str.begin(), str.end(), [](char c) {
+            return std::isdigit(static_cast<unsigned char>(c));
+        })) {
+        return false;
+    }
+    value = std::stoull(str);
+    return true;
+}
+
+/**
+ * Parse a segment file name (<vbid>.logkv.<revision>.<segment id>).
+ */
+bool parseSegmentFileName(const std::string& name,
+                          uint16_t& vbid,
+                          uint64_t& rev,
+                          uint64_t& segmentId) {
+    const auto first = name.find('.');
+    if (first == std::string::npos ||
+        name.compare(first, 7, ".logkv.") != 0) {
+        return false;
+    }
+    const auto last = name.find('.', first + 7);
+    if (last == std::string::npos) {
+        return false;
+    }
+    uint64_t id;
+    if (!parseNumber(name.substr(0, first), id) ||
+        id > std::numeric_limits<uint16_t>::max() ||
+        !parseNumber(name.substr(first + 7, last - first - 7), rev) ||
+        !parseNumber(name.substr(last + 1), segmentId)) {
+        return false;
+    }
+    vbid = uint16_t(id);
+    return true;
+}
+
+std::unique_ptr<Item> makeItem(const DocumentRecord& doc,
+                               uint16_t vbid,
+                               GetMetaOnly metaOnly) {
+    uint8_t extMeta = doc.datatype;
+    auto it = std::make_unique<Item>(
+            doc.getKey(),
+            doc.flags,
+            doc.exptime,
+            metaOnly == GetMetaOnly::Yes ? nullptr : doc.value,
+            doc.valueLen,
+            &extMeta,
+            EXT_META_LEN,
+            doc.cas,
+            doc.seqno,
+            vbid,
+            doc.revSeqno);
+    if (doc.deleted) {
+        it->setDeleted();
+    }
+    return it;
+}
+
+} // anonymous namespace
+
+/**
+ * One file of a vBucket's log.
+ */
+class LogKVStore::Segment {
+public:
+    Segment(LogKVStore& store,
+            std::string fileName,
+            uint64_t id,
+            couch_file_handle handle,
+            uint64_t size)
+        : fileName(std::move(fileName)),
+          id(id),
+          size(size),
+          lastWrite(ep_real_time()),
+          obsolete(false),
+          store(store),
+          handle(handle) {
+    }
+
+    ~Segment() {
+        couchstore_error_info_t errinfo;
+        store.ops.close(&errinfo, handle);
+        store.ops.destructor(handle);
+        ++store.st.numClose;
+        if (obsolete) {
+            store.removeFile(fileName);
+        }
+    }
+
+    /// @return true if all nbytes could be read
+    bool read(char* buf, size_t nbytes, uint64_t offset, FileStats& stats) {
+        couchstore_error_info_t errinfo;
+        size_t done = 0;
+        while (done < nbytes) {
+            ssize_t n = store.ops.pread(
+                    &errinfo, handle, buf + done, nbytes - done, offset + done);
+            if (n <= 0) {
+                break;
+            }
+            done += n;
+        }
+        stats.totalBytesRead += done;
+        return done == nbytes;
+    }
+
+    bool write(const char* buf, size_t nbytes, uint64_t offset,
+               FileStats& stats) {
+        couchstore_error_info_t errinfo;
+        size_t done = 0;
+        while (done < nbytes) {
+            ssize_t n = store.ops.pwrite(
+                    &errinfo, handle, buf + done, nbytes - done, offset + done);
+            if (n <= 0) {
+                break;
+            }
+            done += n;
+        }
+        stats.totalBytesWritten += done;
+        lastWrite = ep_real_time();
+        return done == nbytes;
+    }
+
+    bool sync(FileStats& stats) {
+        couchstore_error_info_t errinfo;
+        hrtime_t start = gethrtime();
+        couchstore_error_t errCode = store.ops.sync(&errinfo, handle);
+        stats.syncTimeHisto.add((gethrtime() - start) / 1000);
+        return errCode == COUCHSTORE_SUCCESS;
+    }
+
+    const std::string fileName;
+    const uint64_t id;
+
+    /// Bytes of intact records (the offset of the next append)
+    std::atomic<uint64_t> size;
+
+    /// When the segment was last written to (or opened); no record in it
+    /// was written after this
+    std::atomic<time_t> lastWrite;
+
+    /// Set once the segment has been replaced; the file is removed when the
+    /// last reference (e.g. from a scan) is dropped.
+    std::atomic<bool> obsolete;
+
+private:
+    LogKVStore& store;
+    couch_file_handle handle;
+};
+
+/**
+ * Reads the records of a segment in order, through a read-ahead buffer.
+ */
+class LogKVStore::SegmentReader {
+public:
+    SegmentReader(Segment& segment, uint64_t end, FileStats& stats)
+        : segment(segment),
+          end(end),
+          stats(stats),
+          bufferOffset(0),
+          pos(0) {
+    }
+
+    /**
+     * Read the next record.
+     *
+     * @param type set to the type of the record
+     * @param offset set to the offset of the record in the segment
+     * @param data set to the record (valid until the next call)
+     * @param length set to the length of the record (including its header)
+     * @return false at the end of the segment, or at the first record which
+     *         is incomplete or fails its checksum
+     */
+    bool next(RecordType& type,
+              uint64_t& offset,
+              const char*& data,
+              uint32_t& length) {
+        if (!fill(RecordHeaderSize)) {
+            return false;
+        }
+        uint32_t payloadLength;
+        std::memcpy(&payloadLength,
+                    buffer.data() + (pos - bufferOffset) + 8,
+                    sizeof(payloadLength));
+        payloadLength = ntohl(payloadLength);
+        if (payloadLength > MaxRecordSize ||
+            !fill(RecordHeaderSize + payloadLength)) {
+            return false;
+        }
+        data = buffer.data() + (pos - bufferOffset);
+        if (!checkRecord(data,
+                         RecordHeaderSize + payloadLength,
+                         type,
+                         length)) {
+            return false;
+        }
+        offset = pos;
+        pos += length;
+        return true;
+    }
+
+private:
+    /// Make sure the buffer holds the nbytes following pos
+    bool fill(size_t nbytes) {
+        if (pos + nbytes <= bufferOffset + buffer.size()) {
+            return true;
+        }
+        if (pos + nbytes > end) {
+            return false;
+        }
+        const size_t readLength =
+                size_t(std::min(uint64_t(std::max(nbytes, ReadAheadSize)),
+                                end - pos));
+        buffer.resize(readLength);
+        bufferOffset = pos;
+        if (!segment.read(buffer.data(), readLength, pos, stats)) {
+            buffer.clear();
+            return false;
+        }
+        return true;
+    }
+
+    Segment& segment;
+    const uint64_t end;
+    FileStats& stats;
+    std::vector<char> buffer;
+    uint64_t bufferOffset;
+    uint64_t pos;
+};
+
+/**
+ * A vBucket's log: its segments and the index over them.
+ *
+ * Lock ordering is compactionMutex -> writeMutex -> mutex.
+ */
+class LogKVStore::VBucketLog {
+public:
+    using IndexMap = std::unordered_map<StoredDocKey, IndexEntry>;
+
+    /**
+     * Orders index entries by key (then namespace). byKey can be searched
+     * with a StoredDocKey, or with a DocKey which compares by bytes only (so
+     * lower_bound finds the key in its first namespace).
+     */
+    struct KeyOrder {
+        using is_transparent = void;
+
+        bool operator()(const IndexMap::value_type* a,
+                        const IndexMap::value_type* b) const {
+            return less(a->first, b->first);
+        }
+
+        bool operator()(const IndexMap::value_type* a,
+                        const StoredDocKey& b) const {
+            return less(a->first, b);
+        }
+
+        bool operator()(const StoredDocKey& a,
+                        const IndexMap::value_type* b) const {
+            return less(a, b->first);
+        }
+
+        bool operator()(const IndexMap::value_type* a, const DocKey& b) const {
+            return compare(a->first, b) < 0;
+        }
+
+        bool operator()(const DocKey& a, const IndexMap::value_type* b) const {
+            return compare(a, b->first) < 0;
+        }
+
+        static bool less(const StoredDocKey& a, const StoredDocKey& b) {
+            const int cmp = compare(a, b);
+            if (cmp != 0) {
+                return cmp < 0;
+            }
+            return a.getDocNamespace() < b.getDocNamespace();
+        }
+
+        template <class A, class B>
+        static int compare(const A& a, const B& b) {
+            const int cmp = std::memcmp(
+                    a.data(), b.data(), std::min(a.size(), b.size()));
+            if (cmp != 0) {
+                return cmp;
+            }
+            return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+        }
+    };
+
+    /**
+     * The superseded versions of documents a segment holds for rollback.
+     * All of them may be dropped once a version superseded at seqno
+     * supersededAt, by a document written at the time written, may be.
+     */
+    struct History {
+        void add(uint64_t nbytes, uint64_t seqno, time_t time) {
+            bytes += nbytes;
+            supersededAt = std::max(supersededAt, seqno);
+            written = std::max(written, time);
+        }
+
+        uint64_t bytes = 0;
+        uint64_t supersededAt = 0;
+        time_t written = 0;
+    };
+
+    /// Clear the index and forget the segments (keeping rev)
+    void clear() {
+        segments.clear();
+        active.reset();
+        liveBytes.clear();
+        history.clear();
+        index.clear();
+        bySeqno.clear();
+        byKey.clear();
+        numLive = 0;
+        numDeleted = 0;
+        nextSegmentId = 1;
+        stateVersion = 0;
+        manifest.clear();
+        manifestVersion = 0;
+        manifestSeqno = 0;
+        ++generation;
+    }
+
+    uint64_t getHighSeqno() const {
+        return bySeqno.empty() ? 0 : bySeqno.rbegin()->first;
+    }
+
+    /// Record that the version of a document at superseded is history
+    void addHistory(const IndexEntry& superseded, const IndexEntry& by) {
+        history[superseded.segment].add(superseded.length,
+                                        by.seqno,
+                                        segments.at(by.segment)->lastWrite);
+    }
+
+    /// Serialises compaction and rollback of the vBucket
+    std::mutex compactionMutex;
+
+    /// Serialises appends (and the members only used when appending)
+    std::mutex writeMutex;
+
+    /// Guards the index, segment map and counters
+    std::mutex mutex;
+
+    uint64_t rev = 1;
+
+    // Guarded by writeMutex
+    std::shared_ptr<Segment> active;
+    uint64_t nextSegmentId = 1;
+    uint64_t stateVersion = 0;
+
+    // Guarded by mutex (and writeMutex when changed by a writer)
+    std::map<uint64_t, std::shared_ptr<Segment>> segments;
+    /// Bytes of each segment referenced by the index
+    std::map<uint64_t, uint64_t> liveBytes;
+    /// The history held by each segment. For the segments loaded on startup
+    /// the superseding documents are taken to be written when loaded.
+    std::map<uint64_t, History> history;
+    IndexMap index;
+    std::map<uint64_t, const StoredDocKey*> bySeqno;
+    /// The index's entries in key order (for getAllKeys)
+    std::set<const IndexMap::value_type*, KeyOrder> byKey;
+    size_t numLive = 0;
+    size_t numDeleted = 0;
+    std::string manifest;
+    uint64_t manifestVersion = 0;
+    uint64_t manifestSeqno = 0;
+    /// Changed whenever the log is replaced wholesale
+    uint64_t generation = 0;
+    /// The scans in progress, which keep the versions they need when the
+    /// index moves on (see ScanSnapshot)
+    std::set<ScanSnapshot*> scans;
+};
+
+class LogKVStore::LogRequest : public IORequest {
+public:
+    LogRequest(const Item& itm, MutationRequestCallback& cb, bool del)
+        : IORequest(itm.getVBucketId(), cb, del, itm.getKey()),
+          seqno(itm.getBySeqno()) {
+        encodeDocument(record, itm, del);
+        dataSize = itm.getNBytes();
+    }
+
+    size_t getNBytes() const {
+        return dataSize;
+    }
+
+    const uint64_t seqno;
+
+    /// The encoded Document record
+    std::string record;
+};
+
+/**
+ * The result of replaying the committed records of a vBucket's segments.
+ */
+struct LogKVStore::ReplayState {
+    /// Documents, states and manifests above this seqno are ignored
+    uint64_t maxSeqno = std::numeric_limits<uint64_t>::max();
+
+    bool haveState = false;
+    vbucket_state state;
+    uint64_t stateVersion = 0;
+    uint64_t purgeSeqno = 0;
+
+    std::string manifest;
+    uint64_t manifestVersion = 0;
+    uint64_t manifestSeqno = 0;
+
+    /// The segments replaced by compaction or rollback
+    std::set<uint64_t> superseded;
+};
+
+/**
+ * The log of a vBucket as of the start of a scan.
+ *
+ * Rather than copying the index up front, a scan reads the live index in
+ * batches. Whenever a version at or below the scan's maxSeqno drops out of
+ * the index (superseded by a later version, or purged by compaction) it is
+ * moved to the scan's superseded map, along with a reference to its segment
+ * which keeps the segment's file around. The live index plus the superseded
+ * map is then exactly the log as it was when the scan started. Entries are
+ * dropped from the map once the scan has passed them.
+ */
+struct LogKVStore::ScanSnapshot {
+    /// The log's generation when the scan started; the scan can't continue
+    /// once the log has been replaced (see VBucketLog::generation)
+    uint64_t generation;
+
+    /// The highest seqno in the log when the scan started
+    uint64_t maxSeqno;
+
+    /// Guarded by the log's mutex
+    std::map<uint64_t, std::pair<IndexEntry, std::shared_ptr<Segment>>>
+            superseded;
+};
+
+LogKVStore::LogKVStore(KVStoreConfig& config)
+    : LogKVStore(config, *couchstore_get_default_file_ops()) {
+}
+
+LogKVStore::LogKVStore(KVStoreConfig& config, FileOpsInterface& ops)
+    : KVStore(config),
+      dbname(config.getDBName()),
+      ops(ops),
+      logger(config.getLogger()),
+      intransaction(false),
+      scanCounter(0) {
+    createDataDir(dbname);
+
+    const size_t numVbs = configuration.getMaxVBuckets();
+    logs.reserve(numVbs);
+    for (size_t vbid = 0; vbid < numVbs; ++vbid) {
+        logs.push_back(std::make_unique<VBucketLog>());
+    }
+    cachedDocCount.assign(numVbs, Couchbase::RelaxedAtomic<size_t>(0));
+    cachedDeleteCount.assign(numVbs, Couchbase::RelaxedAtomic<size_t>(0));
+    cachedFileSize.assign(numVbs, Couchbase::RelaxedAtomic<uint64_t>(0));
+    cachedSpaceUsed.assign(numVbs, Couchbase::RelaxedAtomic<uint64_t>(0));
+    cachedVBStates.assign(numVbs, nullptr);
+
+    initialize();
+}
+
+LogKVStore::~LogKVStore() {
+    // Segments remove their files (via pendingFileDeletions) on
+    // destruction, so must go before the rest of the members.
+    scans.clear();
+    logs.clear();
+
+    for (auto& vbstate : cachedVBStates) {
+        delete vbstate;
+        vbstate = nullptr;
+    }
+}
+
+void LogKVStore::initialize() {
+    // vbid -> revision -> segment ids
+    std::map<uint16_t, std::map<uint64_t, std::vector<uint64_t>>> found;
+    for (const auto& file : cb::io::findFilesContaining(dbname, ".logkv.")) {
+        uint16_t vbid;
+        uint64_t rev;
+        uint64_t segmentId;
+        if (!parseSegmentFileName(
+                    cb::io::basename(file), vbid, rev, segmentId) ||
+            vbid >= logs.size()) {
+            continue;
+        }
+        // The vBuckets of the other shards are loaded by their own
+        // instances.
+        if (vbid % configuration.getMaxShards() !=
+            configuration.getShardId()) {
+            continue;
+        }
+        found[vbid][rev].push_back(segmentId);
+    }
+
+    for (auto& vb : found) {
+        const uint16_t vbid = vb.first;
+        auto& revs = vb.second;
+
+        // Only the latest revision is current, any others belong to
+        // deleted incarnations of the vBucket.
+        const uint64_t rev = revs.rbegin()->first;
+        for (const auto& stale : revs) {
+            if (stale.first == rev) {
+                continue;
+            }
+            for (auto segmentId : stale.second) {
+                removeFile(getSegmentFileName(
+                        dbname, vbid, stale.first, segmentId));
+            }
+        }
+
+        auto& segmentIds = revs.rbegin()->second;
+        std::sort(segmentIds.begin(), segmentIds.end());
+        if (loadVBucket(vbid, rev, segmentIds)) {
+            ++st.numLoadedVb;
+        }
+    }
+}
+
+bool LogKVStore::loadVBucket(uint16_t vbid,
+                             uint64_t rev,
+                             const std::vector<uint64_t>& segmentIds) {
+    auto& log = *logs[vbid];
+    log.rev = rev;
+    log.nextSegmentId = segmentIds.back() + 1;
+
+    // Replay the newest segments first, so that we know which of the older
+    // ones have been superseded (by compaction or rollback) before getting
+    // to them.
+    ReplayState replay;
+    for (auto it = segmentIds.rbegin(); it != segmentIds.rend(); ++it) {
+        const auto fileName = getSegmentFileName(dbname, vbid, rev, *it);
+        if (replay.superseded.count(*it)) {
+            removeFile(fileName);
+            continue;
+        }
+
+        auto segment = openSegment(fileName, *it, false, st.fsStats);
+        if (!segment) {
+            logger.log(EXTENSION_LOG_WARNING,
+                       "LogKVStore::loadVBucket: Failed to open segment "
+                       "%s, vb:%" PRIu16 " will not be loaded",
+                       fileName.c_str(),
+                       vbid);
+            log.clear();
+            return false;
+        }
+
+        log.segments[segment->id] = segment;
+        if (!replaySegment(log, vbid, *segment, replay)) {
+            // Nothing in the segment was ever committed.
+            logger.log(EXTENSION_LOG_NOTICE,
+                       "LogKVStore::loadVBucket: Removing segment %s "
+                       "without any committed records, vb:%" PRIu16,
+                       fileName.c_str(),
+                       vbid);
+            log.segments.erase(segment->id);
+            log.liveBytes.erase(segment->id);
+            log.history.erase(segment->id);
+            segment->obsolete = true;
+        }
+    }
+
+    if (log.segments.empty()) {
+        log.clear();
+        return false;
+    }
+
+    // Drop anything superseded by a segment replayed after it.
+    for (auto it = log.segments.begin(); it != log.segments.end();) {
+        if (replay.superseded.count(it->first)) {
+            it->second->obsolete = true;
+            log.liveBytes.erase(it->first);
+            log.history.erase(it->first);
+            it = log.segments.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = log.index.begin(); it != log.index.end();) {
+        if (replay.superseded.count(it->second.segment)) {
+            log.bySeqno.erase(it->second.seqno);
+            log.byKey.erase(&*it);
+            if (it->second.deleted) {
+                --log.numDeleted;
+            } else {
+                --log.numLive;
+            }
+            it = log.index.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (replay.haveState) {
+        replay.state.highSeqno =
+                std::max(replay.state.highSeqno, int64_t(log.getHighSeqno()));
+        replay.state.purgeSeqno = replay.purgeSeqno;
+    } else {
+        logger.log(EXTENSION_LOG_NOTICE,
+                   "LogKVStore::loadVBucket: No vbucket state found, "
+                   "vb:%" PRIu16 ", treating as dead",
+                   vbid);
+        replay.state = vbucket_state(vbucket_state_dead,
+                                     0,
+                                     0,
+                                     log.getHighSeqno(),
+                                     replay.purgeSeqno,
+                                     0,
+                                     0,
+                                     0,
+                                     "");
+    }
+    delete cachedVBStates[vbid];
+    cachedVBStates[vbid] = new vbucket_state(replay.state);
+
+    log.stateVersion = std::max(replay.stateVersion, replay.manifestVersion);
+    log.manifest = std::move(replay.manifest);
+    log.manifestVersion = replay.manifestVersion;
+    log.manifestSeqno = replay.manifestSeqno;
+
+    cachedDocCount[vbid] = log.numLive;
+    cachedDeleteCount[vbid] = log.numDeleted;
+    updateFileStats(vbid, log);
+    return true;
+}
+
+bool LogKVStore::replaySegment(VBucketLog& log,
+                               uint16_t vbid,
+                               Segment& segment,
+                               ReplayState& replay) {
+    SegmentReader reader(segment, segment.size, st.fsStats);
+    RecordType type;
+    uint64_t offset;
+    const char* data;
+    uint32_t length;
+
+    if (!reader.next(type, offset, data, length) ||
+        type != RecordType::SegmentHeader) {
+        return false;
+    }
+    RecordParser header(data + RecordHeaderSize, length - RecordHeaderSize);
+    uint64_t magic;
+    uint16_t headerVbid;
+    if (!header.get64(magic) || magic != SegmentMagic ||
+        !header.get16(headerVbid) || headerVbid != vbid) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::replaySegment: Invalid segment header in %s",
+                   segment.fileName.c_str());
+        return false;
+    }
+
+    // The records of the current batch, applied when its commit is read
+    std::vector<std::pair<StoredDocKey, IndexEntry>> docs;
+    bool haveState = false;
+    vbucket_state state;
+    uint64_t stateVersion = 0;
+    std::string manifest;
+    uint64_t manifestVersion = 0;
+    uint64_t manifestSeqno = 0;
+
+    bool committed = false;
+    uint64_t committedEnd = offset + length;
+    while (reader.next(type, offset, data, length)) {
+        const char* payload = data + RecordHeaderSize;
+        const size_t payloadLength = length - RecordHeaderSize;
+        bool valid = true;
+        switch (type) {
+        case RecordType::Document: {
+            DocumentRecord doc;
+            valid = decodeDocument(payload, payloadLength, doc);
+            if (valid && doc.seqno <= replay.maxSeqno) {
+                docs.emplace_back(
+                        StoredDocKey(doc.getKey()),
+                        IndexEntry{
+                                doc.seqno, segment.id, offset, length,
+                                doc.deleted});
+            }
+            break;
+        }
+        case RecordType::VBState: {
+            vbucket_state recordState;
+            uint64_t version;
+            valid = decodeVBState(payload, payloadLength, version, recordState);
+            if (valid && uint64_t(recordState.highSeqno) <= replay.maxSeqno &&
+                (!haveState || version > stateVersion)) {
+                haveState = true;
+                state = recordState;
+                stateVersion = version;
+            }
+            break;
+        }
+        case RecordType::Manifest: {
+            RecordParser parser(payload, payloadLength);
+            uint64_t version;
+            uint64_t seqno;
+            std::string json;
+            valid = parser.get64(version) && parser.get64(seqno) &&
+                    parser.getString(json);
+            if (valid && seqno <= replay.maxSeqno &&
+                version > manifestVersion) {
+                manifest = std::move(json);
+                manifestVersion = version;
+                manifestSeqno = seqno;
+            }
+            break;
+        }
+        case RecordType::Commit: {
+            RecordParser parser(payload, payloadLength);
+            uint32_t numSuperseded;
+            std::vector<uint64_t> superseded;
+            valid = parser.get32(numSuperseded);
+            for (uint32_t ii = 0; valid && ii < numSuperseded; ++ii) {
+                uint64_t segmentId;
+                valid = parser.get64(segmentId);
+                superseded.push_back(segmentId);
+            }
+            if (!valid) {
+                break;
+            }
+            for (const auto& doc : docs) {
+                bool existed;
+                applyIndexUpdate(log, doc.first, doc.second, existed);
+            }
+            docs.clear();
+            if (haveState) {
+                replay.purgeSeqno =
+                        std::max(replay.purgeSeqno, state.purgeSeqno);
+                if (!replay.haveState || stateVersion > replay.stateVersion) {
+                    replay.haveState = true;
+                    replay.state = state;
+                    replay.stateVersion = stateVersion;
+                }
+                haveState = false;
+            }
+            if (manifestVersion > replay.manifestVersion) {
+                replay.manifest = std::move(manifest);
+                replay.manifestVersion = manifestVersion;
+                replay.manifestSeqno = manifestSeqno;
+            }
+            manifestVersion = 0;
+            replay.superseded.insert(superseded.begin(), superseded.end());
+            committed = true;
+            committedEnd = offset + length;
+            break;
+        }
+        case RecordType::SegmentHeader:
+            valid = false;
+            break;
+        }
+        if (!valid) {
+            logger.log(EXTENSION_LOG_WARNING,
+                       "LogKVStore::replaySegment: Invalid record "
+                       "(type:%d) at offset %" PRIu64 " in %s",
+                       int(type),
+                       offset,
+                       segment.fileName.c_str());
+            break;
+        }
+    }
+
+    if (committedEnd < segment.size) {
+        // Typically a batch which was being written when we crashed.
+        logger.log(EXTENSION_LOG_NOTICE,
+                   "LogKVStore::replaySegment: Ignoring %" PRIu64 " bytes of "
+                   "uncommitted data at the end of %s",
+                   uint64_t(segment.size - committedEnd),
+                   segment.fileName.c_str());
+        segment.size = committedEnd;
+    }
+    return committed;
+}
+
+std::shared_ptr<LogKVStore::Segment> LogKVStore::openSegment(
+        const std::string& fileName,
+        uint64_t id,
+        bool create,
+        FileStats& stats) {
+    couchstore_error_info_t errinfo;
+    couch_file_handle handle = ops.constructor(&errinfo);
+    if (handle == nullptr) {
+        ++st.numOpenFailure;
+        return nullptr;
+    }
+
+    int flags = O_RDWR;
+    if (create) {
+        flags |= O_CREAT | O_TRUNC;
+    }
+    couchstore_error_t errCode =
+            ops.open(&errinfo, &handle, fileName.c_str(), flags);
+    if (errCode != COUCHSTORE_SUCCESS) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::openSegment: open error:%s, file:%s",
+                   couchstore_strerror(errCode),
+                   fileName.c_str());
+        ops.destructor(handle);
+        ++st.numOpenFailure;
+        return nullptr;
+    }
+    ++st.numOpen;
+
+    cs_off_t size = ops.goto_eof(&errinfo, handle);
+    auto segment = std::make_shared<Segment>(
+            *this, fileName, id, handle, size < 0 ? 0 : uint64_t(size));
+    if (size < 0) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::openSegment: Failed to get the size of %s",
+                   fileName.c_str());
+        return nullptr;
+    }
+    return segment;
+}
+
+std::shared_ptr<LogKVStore::Segment> LogKVStore::createSegment(
+        VBucketLog& log, uint16_t vbid, FileStats& stats) {
+    const uint64_t id = log.nextSegmentId++;
+    auto segment = openSegment(
+            getSegmentFileName(dbname, vbid, log.rev, id), id, true, stats);
+    if (!segment) {
+        return nullptr;
+    }
+
+    std::string header;
+    RecordBuilder record(header, RecordType::SegmentHeader);
+    record.put64(SegmentMagic);
+    record.put16(vbid);
+    record.put64(log.rev);
+    record.put64(id);
+    record.finish();
+    if (!segment->write(header.data(), header.size(), 0, stats)) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::createSegment: Failed to write the header "
+                   "of %s",
+                   segment->fileName.c_str());
+        segment->obsolete = true;
+        return nullptr;
+    }
+    segment->size = header.size();
+
+    std::lock_guard<std::mutex> lh(log.mutex);
+    log.segments[id] = segment;
+    return segment;
+}
+
+bool LogKVStore::append(VBucketLog& log,
+                        uint16_t vbid,
+                        const std::string& data,
+                        uint64_t& offset,
+                        std::shared_ptr<Segment>& segment) {
+    if (log.active && log.active->size >= configuration.getSegmentSize()) {
+        // Seal it; compaction can now pick it up.
+        log.active.reset();
+    }
+    if (!log.active) {
+        log.active = createSegment(log, vbid, st.fsStats);
+        if (!log.active) {
+            return false;
+        }
+    }
+
+    segment = log.active;
+    offset = segment->size;
+    if (!segment->write(data.data(), data.size(), offset, st.fsStats)) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::append: write error:%s, vb:%" PRIu16
+                   ", file:%s",
+                   cb_strerror().c_str(),
+                   vbid,
+                   segment->fileName.c_str());
+        // The write may have left a partial record behind; carry on in a
+        // new segment (replay stops at the damaged record).
+        log.active.reset();
+        return false;
+    }
+    segment->size += data.size();
+    return true;
+}
+
+bool LogKVStore::writeState(VBucketLog& log,
+                            uint16_t vbid,
+                            const vbucket_state* state,
+                            const Item* collectionsManifest,
+                            bool doSync) {
+    std::string buffer;
+    if (state) {
+        encodeVBState(buffer, ++log.stateVersion, *state);
+    }
+    std::string manifest;
+    if (collectionsManifest) {
+        manifest = serialiseManifest(*collectionsManifest);
+        encodeManifest(buffer,
+                       ++log.stateVersion,
+                       collectionsManifest->getBySeqno(),
+                       manifest);
+    }
+    encodeCommit(buffer);
+
+    uint64_t offset;
+    std::shared_ptr<Segment> segment;
+    if (!append(log, vbid, buffer, offset, segment)) {
+        return false;
+    }
+    if (doSync && !segment->sync(st.fsStats)) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::writeState: sync error:%s, vb:%" PRIu16
+                   ", file:%s",
+                   cb_strerror().c_str(),
+                   vbid,
+                   segment->fileName.c_str());
+        log.active.reset();
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lh(log.mutex);
+    if (collectionsManifest) {
+        log.manifest = std::move(manifest);
+        log.manifestVersion = log.stateVersion;
+        log.manifestSeqno = collectionsManifest->getBySeqno();
+    }
+    updateFileStats(vbid, log);
+    return true;
+}
+
+std::string LogKVStore::serialiseManifest(const Item& collectionsManifest) {
+    cb::const_char_buffer buffer(collectionsManifest.getData(),
+                                 collectionsManifest.getNBytes());
+    return Collections::VB::Manifest::serialToJson(
+            SystemEvent(collectionsManifest.getFlags()),
+            buffer,
+            collectionsManifest.getBySeqno());
+}
+
+void LogKVStore::applyIndexUpdate(VBucketLog& log,
+                                  const StoredDocKey& key,
+                                  const IndexEntry& entry,
+                                  bool& existed) {
+    auto res = log.index.emplace(key, entry);
+    if (!res.second) {
+        IndexEntry& current = res.first->second;
+        existed = !current.deleted;
+        if (current.seqno >= entry.seqno) {
+            // Replaying an older version of the document.
+            if (current.seqno > entry.seqno) {
+                log.addHistory(entry, current);
+            }
+            return;
+        }
+        retireIndexEntry(log, current);
+        log.addHistory(current, entry);
+        log.bySeqno.erase(current.seqno);
+        log.liveBytes[current.segment] -= current.length;
+        if (current.deleted) {
+            --log.numDeleted;
+        } else {
+            --log.numLive;
+        }
+        current = entry;
+    } else {
+        existed = false;
+        log.byKey.insert(&*res.first);
+    }
+
+    log.bySeqno[entry.seqno] = &res.first->first;
+    log.liveBytes[entry.segment] += entry.length;
+    if (entry.deleted) {
+        ++log.numDeleted;
+    } else {
+        ++log.numLive;
+    }
+}
+
+void LogKVStore::eraseIndexEntry(VBucketLog& log,
+                                 std::unordered_map<StoredDocKey,
+                                                    IndexEntry>::iterator it) {
+    retireIndexEntry(log, it->second);
+    log.bySeqno.erase(it->second.seqno);
+    log.byKey.erase(&*it);
+    log.liveBytes[it->second.segment] -= it->second.length;
+    if (it->second.deleted) {
+        --log.numDeleted;
+    } else {
+        --log.numLive;
+    }
+    log.index.erase(it);
+}
+
+void LogKVStore::retireIndexEntry(VBucketLog& log, const IndexEntry& entry) {
+    for (auto* scan : log.scans) {
+        if (scan->generation == log.generation &&
+            entry.seqno <= scan->maxSeqno) {
+            scan->superseded.emplace(
+                    entry.seqno,
+                    std::make_pair(entry, log.segments.at(entry.segment)));
+        }
+    }
+}
+
+void LogKVStore::dropSegments(VBucketLog& log) {
+    std::lock_guard<std::mutex> lh(log.mutex);
+    for (auto& segment : log.segments) {
+        segment.second->obsolete = true;
+    }
+    log.clear();
+}
+
+void LogKVStore::updateFileStats(uint16_t vbid, const VBucketLog& log) {
+    uint64_t fileSize = 0;
+    uint64_t spaceUsed = 0;
+    for (const auto& segment : log.segments) {
+        fileSize += segment.second->size;
+    }
+    for (const auto& live : log.liveBytes) {
+        spaceUsed += live.second;
+    }
+    for (const auto& history : log.history) {
+        spaceUsed += history.second.bytes;
+    }
+    cachedFileSize[vbid] = fileSize;
+    cachedSpaceUsed[vbid] = spaceUsed;
+}
+
+void LogKVStore::removeFile(const std::string& fileName) {
+    if (remove(fileName.c_str()) == -1 && errno != ENOENT) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::removeFile: remove error:%s, file:%s",
+                   cb_strerror().c_str(),
+                   fileName.c_str());
+        std::string file_str = fileName;
+        pendingFileDeletions.push(file_str);
+    }
+}
+
+void LogKVStore::reset(uint16_t vbucketId) {
+    if (isReadOnly()) {
+        throw std::logic_error("LogKVStore::reset: Not valid on a read-only "
+                               "object.");
+    }
+
+    vbucket_state* state = cachedVBStates[vbucketId];
+    if (!state) {
+        throw std::invalid_argument("LogKVStore::reset: No entry in cached "
+                                    "states for vbucket " +
+                                    std::to_string(vbucketId));
+    }
+
+    auto& log = *logs[vbucketId];
+    std::lock_guard<std::mutex> lh(log.writeMutex);
+    state->reset();
+    dropSegments(log);
+    ++log.rev;
+
+    cachedDocCount[vbucketId] = 0;
+    cachedDeleteCount[vbucketId] = 0;
+    cachedFileSize[vbucketId] = 0;
+    cachedSpaceUsed[vbucketId] = 0;
+
+    if (!writeState(log, vbucketId, state, nullptr, true)) {
+        ++st.numVbSetFailure;
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::reset: Failed to persist the state of "
+                   "vb:%" PRIu16,
+                   vbucketId);
+    }
+}
+
+bool LogKVStore::begin() {
+    if (isReadOnly()) {
+        throw std::logic_error("LogKVStore::begin: Not valid on a read-only "
+                               "object.");
+    }
+    intransaction = true;
+    return intransaction;
+}
+
+bool LogKVStore::commit(const Item* collectionsManifest) {
+    TRACE_EVENT("ep-engine/log-kvstore", "commit",
+                this->configuration.getShardId());
+
+    if (isReadOnly()) {
+        throw std::logic_error("LogKVStore::commit: Not valid on a read-only "
+                               "object.");
+    }
+
+    if (intransaction) {
+        if (commitLog(collectionsManifest)) {
+            intransaction = false;
+        }
+    }
+
+    return !intransaction;
+}
+
+void LogKVStore::rollback() {
+    if (isReadOnly()) {
+        throw std::logic_error("LogKVStore::rollback: Not valid on a "
+                               "read-only object.");
+    }
+    if (intransaction) {
+        intransaction = false;
+    }
+}
+
+StorageProperties LogKVStore::getStorageProperties() {
+    StorageProperties rv(StorageProperties::EfficientVBDump::Yes,
+                         StorageProperties::EfficientVBDeletion::Yes,
+                         StorageProperties::PersistedDeletion::Yes,
+                         StorageProperties::EfficientGet::Yes,
+                         StorageProperties::ConcurrentWriteCompact::Yes,
+                         StorageProperties::GroupCommit::Yes);
+    return rv;
+}
+
+void LogKVStore::set(const Item& itm, Callback<mutation_result>& cb) {
+    if (isReadOnly()) {
+        throw std::logic_error("LogKVStore::set: Not valid on a read-only "
+                               "object.");
+    }
+    if (!intransaction) {
+        throw std::invalid_argument("LogKVStore::set: intransaction must be "
+                                    "true to perform a set operation.");
+    }
+
+    MutationRequestCallback requestcb;
+    requestcb.setCb = &cb;
+    pendingReqsQ.push_back(std::make_unique<LogRequest>(itm, requestcb, false));
+}
+
+void LogKVStore::del(const Item& itm, Callback<int>& cb) {
+    if (isReadOnly()) {
+        throw std::logic_error("LogKVStore::del: Not valid on a read-only "
+                               "object.");
+    }
+    if (!intransaction) {
+        throw std::invalid_argument("LogKVStore::del: intransaction must be "
+                                    "true to perform a delete operation.");
+    }
+
+    MutationRequestCallback requestcb;
+    requestcb.delCb = &cb;
+    pendingReqsQ.push_back(std::make_unique<LogRequest>(itm, requestcb, true));
+}
+
+bool LogKVStore::commitLog(const Item* collectionsManifest) {
+    if (pendingReqsQ.empty() && !collectionsManifest) {
+        return true;
+    }
+
+    struct PendingVBCommit {
+        PendingVBCommit(uint16_t vbid) : vbid(vbid) {
+        }
+
+        const uint16_t vbid;
+        std::vector<LogRequest*> reqs;
+        const Item* collectionsManifest = nullptr;
+        std::shared_ptr<Segment> segment;
+        uint64_t offset = 0;
+        int64_t highSeqno = 0;
+        bool success = false;
+    };
+
+    // Split the transaction by vbucket (there's more than one when the
+    // flusher is group committing), preserving each vbucket's request order.
+    std::vector<PendingVBCommit> commits;
+    std::unordered_map<uint16_t, size_t> commitsByVb;
+    auto getCommit = [&commits, &commitsByVb](uint16_t vbid)
+            -> PendingVBCommit& {
+        auto it = commitsByVb.find(vbid);
+        if (it != commitsByVb.end()) {
+            return commits[it->second];
+        }
+        commitsByVb[vbid] = commits.size();
+        commits.emplace_back(vbid);
+        return commits.back();
+    };
+    for (auto& req : pendingReqsQ) {
+        getCommit(req->getVBucketId()).reqs.push_back(req.get());
+    }
+    if (collectionsManifest) {
+        getCommit(collectionsManifest->getVBucketId()).collectionsManifest =
+                collectionsManifest;
+    }
+
+    // Append every vbucket's batch before syncing any of them, so that the
+    // syncs are issued back to back. Each vbucket's write lock is held until
+    // its batch has been applied to the index.
+    std::vector<std::unique_lock<std::mutex>> writeLocks;
+    for (auto& commit : commits) {
+        auto& log = *logs.at(commit.vbid);
+        writeLocks.emplace_back(log.writeMutex);
+
+        vbucket_state* state = cachedVBStates[commit.vbid];
+        if (state == nullptr) {
+            throw std::logic_error("LogKVStore::commitLog: cachedVBStates[" +
+                                   std::to_string(commit.vbid) +
+                                   "] is NULL");
+        }
+
+        hrtime_t start = gethrtime();
+        std::string buffer;
+        commit.highSeqno = state->highSeqno;
+        for (auto* req : commit.reqs) {
+            buffer.append(req->record);
+            commit.highSeqno =
+                    std::max(commit.highSeqno, int64_t(req->seqno));
+        }
+        vbucket_state newState(*state);
+        newState.highSeqno = commit.highSeqno;
+        encodeVBState(buffer, ++log.stateVersion, newState);
+        std::string manifest;
+        if (commit.collectionsManifest) {
+            manifest = serialiseManifest(*commit.collectionsManifest);
+            encodeManifest(buffer,
+                           ++log.stateVersion,
+                           commit.collectionsManifest->getBySeqno(),
+                           manifest);
+        }
+        encodeCommit(buffer);
+
+        commit.success = append(
+                log, commit.vbid, buffer, commit.offset, commit.segment);
+        st.saveDocsHisto.add((gethrtime() - start) / 1000);
+    }
+
+    bool success = true;
+    size_t docsCommitted = 0;
+    for (auto& commit : commits) {
+        auto& log = *logs[commit.vbid];
+        if (commit.success) {
+            hrtime_t start = gethrtime();
+            commit.success = commit.segment->sync(st.fsStats);
+            st.commitHisto.add((gethrtime() - start) / 1000);
+            if (!commit.success) {
+                logger.log(EXTENSION_LOG_WARNING,
+                           "LogKVStore::commitLog: sync error:%s, "
+                           "vb:%" PRIu16 ", file:%s",
+                           cb_strerror().c_str(),
+                           commit.vbid,
+                           commit.segment->fileName.c_str());
+                log.active.reset();
+            }
+        }
+        if (!commit.success) {
+            success = false;
+            logger.log(EXTENSION_LOG_WARNING,
+                       "LogKVStore::commitLog: Failed to persist %" PRIu64
+                       " documents, vb:%" PRIu16 ", rev:%" PRIu64,
+                       uint64_t(commit.reqs.size()),
+                       commit.vbid,
+                       log.rev);
+        } else {
+            docsCommitted += commit.reqs.size();
+            st.batchSize.add(commit.reqs.size());
+        }
+    }
+    if (success) {
+        st.docsCommitted = docsCommitted;
+    }
+
+    // Now the batches are durable, make them visible.
+    for (size_t ii = 0; ii < commits.size(); ++ii) {
+        auto& commit = commits[ii];
+        auto& log = *logs[commit.vbid];
+        kvstats_ctx kvctx(configuration);
+        if (commit.success) {
+            std::lock_guard<std::mutex> lh(log.mutex);
+            uint64_t offset = commit.offset;
+            for (auto* req : commit.reqs) {
+                const IndexEntry entry{req->seqno,
+                                       commit.segment->id,
+                                       offset,
+                                       uint32_t(req->record.size()),
+                                       req->isDelete()};
+                offset += req->record.size();
+                bool existed;
+                applyIndexUpdate(log, req->getKey(), entry, existed);
+                kvctx.keyStats[req->getKey()] =
+                        std::make_pair(existed, !req->isDelete());
+            }
+            if (commit.collectionsManifest) {
+                log.manifest =
+                        serialiseManifest(*commit.collectionsManifest);
+                log.manifestVersion = log.stateVersion;
+                log.manifestSeqno = commit.collectionsManifest->getBySeqno();
+            }
+            cachedVBStates[commit.vbid]->highSeqno = commit.highSeqno;
+            cachedDocCount[commit.vbid] = log.numLive;
+            cachedDeleteCount[commit.vbid] = log.numDeleted;
+            updateFileStats(commit.vbid, log);
+        }
+        writeLocks[ii].unlock();
+        commitCallback(commit.reqs, kvctx, commit.success);
+    }
+
+    pendingReqsQ.clear();
+    return success;
+}
+
+void LogKVStore::commitCallback(const std::vector<LogRequest*>& committedReqs,
+                                kvstats_ctx& kvctx,
+                                bool success) {
+    for (auto* req : committedReqs) {
+        const size_t dataSize = req->getNBytes();
+        const size_t keySize = req->getKey().size();
+        /* update ep stats */
+        ++st.io_num_write;
+        st.io_write_bytes += (keySize + dataSize);
+
+        const bool existed = kvctx.keyStats[req->getKey()].first;
+        if (req->isDelete()) {
+            int rv = MUTATION_FAILED;
+            if (success) {
+                // 1 if the deletion is for an existing item on disk
+                rv = existed ? 1 : 0;
+                st.delTimeHisto.add(req->getDelta() / 1000);
+            } else {
+                ++st.numDelFailure;
+            }
+            req->getDelCallback()->callback(rv);
+        } else {
+            int rv = success ? MUTATION_SUCCESS : MUTATION_FAILED;
+            if (success) {
+                st.writeTimeHisto.add(req->getDelta() / 1000);
+                st.writeSizeHisto.add(dataSize + keySize);
+            } else {
+                ++st.numSetFailure;
+            }
+            mutation_result p(rv, !existed);
+            req->getSetCallback()->callback(p);
+        }
+    }
+}
+
+bool LogKVStore::lookup(VBucketLog& log,
+                        const DocKey& key,
+                        IndexEntry& entry,
+                        std::shared_ptr<Segment>& segment) {
+    std::lock_guard<std::mutex> lh(log.mutex);
+    auto it = log.index.find(StoredDocKey(key));
+    if (it == log.index.end()) {
+        return false;
+    }
+    entry = it->second;
+    segment = log.segments.at(entry.segment);
+    return true;
+}
+
+GetValue LogKVStore::fetchDoc(Segment& segment,
+                              const IndexEntry& entry,
+                              uint16_t vbid,
+                              GetMetaOnly metaOnly) {
+    std::vector<char> buffer(entry.length);
+    RecordType type;
+    uint32_t length;
+    DocumentRecord doc;
+    if (!segment.read(buffer.data(), entry.length, entry.offset, st.fsStats) ||
+        !checkRecord(buffer.data(), entry.length, type, length) ||
+        type != RecordType::Document ||
+        !decodeDocument(buffer.data() + RecordHeaderSize,
+                        length - RecordHeaderSize,
+                        doc)) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::fetchDoc: Failed to read the document at "
+                   "offset %" PRIu64 " of %s, vb:%" PRIu16
+                   ", seqno:%" PRIu64,
+                   entry.offset,
+                   segment.fileName.c_str(),
+                   vbid,
+                   entry.seqno);
+        return GetValue(nullptr, ENGINE_TMPFAIL);
+    }
+
+    try {
+        GetValue rv(makeItem(doc, vbid, metaOnly));
+        // update ep-engine IO stats
+        ++st.io_num_read;
+        st.io_read_bytes += doc.keyLen;
+        if (metaOnly == GetMetaOnly::No) {
+            st.io_read_bytes += doc.valueLen;
+        }
+        return rv;
+    } catch (const std::bad_alloc&) {
+        return GetValue(nullptr, ENGINE_ENOMEM);
+    }
+}
+
+GetValue LogKVStore::get(const DocKey& key, uint16_t vb, bool fetchDelete) {
+    return getWithHeader(
+            logs.at(vb).get(), key, vb, GetMetaOnly::No, fetchDelete);
+}
+
+GetValue LogKVStore::getWithHeader(void* dbHandle,
+                                   const DocKey& key,
+                                   uint16_t vb,
+                                   GetMetaOnly getMetaOnly,
+                                   bool fetchDelete) {
+    auto& log = *static_cast<VBucketLog*>(dbHandle);
+    hrtime_t start = gethrtime();
+
+    IndexEntry entry;
+    std::shared_ptr<Segment> segment;
+    if (!lookup(log, key, entry, segment)) {
+        ++st.numGetFailure;
+        return GetValue(nullptr, ENGINE_KEY_ENOENT);
+    }
+
+    GetValue rv = fetchDoc(*segment, entry, vb, getMetaOnly);
+    if (rv.getStatus() == ENGINE_SUCCESS) {
+        st.readTimeHisto.add((gethrtime() - start) / 1000);
+        st.readSizeHisto.add(key.size() + rv.item->getNBytes());
+    } else {
+        ++st.numGetFailure;
+    }
+    return rv;
+}
+
+void LogKVStore::getMulti(uint16_t vb, vb_bgfetch_queue_t& itms) {
+    auto& log = *logs.at(vb);
+
+    struct Fetch {
+        vb_bgfetch_item_ctx_t* ctx;
+        IndexEntry entry;
+        std::shared_ptr<Segment> segment;
+    };
+    std::vector<Fetch> fetches;
+    fetches.reserve(itms.size());
+
+    // Look all of the keys up under a single acquisition of the lock.
+    {
+        std::lock_guard<std::mutex> lh(log.mutex);
+        for (auto& item : itms) {
+            auto it = log.index.find(item.first);
+            if (it == log.index.end()) {
+                item.second.value.setStatus(ENGINE_KEY_ENOENT);
+                continue;
+            }
+            fetches.push_back(
+                    {&item.second, it->second, log.segments.at(
+                                                       it->second.segment)});
+        }
+    }
+
+    // Read them in file order.
+    std::sort(fetches.begin(),
+              fetches.end(),
+              [](const Fetch& a, const Fetch& b) {
+                  return std::tie(a.entry.segment, a.entry.offset) <
+                         std::tie(b.entry.segment, b.entry.offset);
+              });
+
+    for (auto& fetch : fetches) {
+        auto& ctx = *fetch.ctx;
+        ctx.value = fetchDoc(*fetch.segment, fetch.entry, vb, ctx.isMetaOnly);
+        if (ctx.value.getStatus() != ENGINE_SUCCESS &&
+            ctx.isMetaOnly == GetMetaOnly::No) {
+            ++st.numGetFailure;
+        }
+        for (auto& bgfetch : ctx.bgfetched_list) {
+            bgfetch->value = &ctx.value;
+            st.readTimeHisto.add(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            ProcessClock::now() - bgfetch->initTime)
+                            .count());
+            if (ctx.value.getStatus() == ENGINE_SUCCESS) {
+                st.readSizeHisto.add(ctx.value.item->getKey().size() +
+                                     ctx.value.item->getNBytes());
+            }
+        }
+    }
+}
+
+void LogKVStore::delVBucket(uint16_t vbucket, uint64_t fileRev) {
+    if (isReadOnly()) {
+        throw std::logic_error("LogKVStore::delVBucket: Not valid on a "
+                               "read-only object.");
+    }
+
+    auto& log = *logs.at(vbucket);
+    {
+        std::lock_guard<std::mutex> lh(log.writeMutex);
+        if (log.rev == fileRev) {
+            dropSegments(log);
+            updateFileStats(vbucket, log);
+            return;
+        }
+    }
+
+    // An earlier revision, whose segments we no longer track.
+    const auto prefix = dbname + "/" + std::to_string(vbucket) + ".logkv." +
+                        std::to_string(fileRev) + ".";
+    for (const auto& file : cb::io::findFilesWithPrefix(prefix)) {
+        removeFile(file);
+    }
+}
+
+std::vector<vbucket_state*> LogKVStore::listPersistedVbuckets() {
+    return cachedVBStates;
+}
+
+void LogKVStore::getPersistedStats(std::map<std::string, std::string>& stats) {
+    std::ifstream session_stats(dbname + "/stats.json", std::ios::binary);
+    if (!session_stats) {
+        return;
+    }
+
+    std::stringstream buffer;
+    buffer << session_stats.rdbuf();
+    cJSON* json_obj = cJSON_Parse(buffer.str().c_str());
+    if (!json_obj) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::getPersistedStats: Failed to parse the "
+                   "session stats json doc!!!");
+        return;
+    }
+
+    int json_arr_size = cJSON_GetArraySize(json_obj);
+    for (int i = 0; i < json_arr_size; ++i) {
+        cJSON* obj = cJSON_GetArrayItem(json_obj, i);
+        if (obj) {
+            stats[obj->string] = obj->valuestring ? obj->valuestring : "";
+        }
+    }
+    cJSON_Delete(json_obj);
+}
+
+bool LogKVStore::snapshotVBucket(uint16_t vbucketId,
+                                 const vbucket_state& vbstate,
+                                 VBStatePersist options) {
+    if (isReadOnly()) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::snapshotVBucket: cannot be performed on a "
+                   "read-only KVStore instance");
+        return false;
+    }
+
+    hrtime_t start = gethrtime();
+
+    auto& log = *logs.at(vbucketId);
+    {
+        // Compaction reads the cached state under the write lock.
+        std::lock_guard<std::mutex> lh(log.writeMutex);
+        if (updateCachedVBState(vbucketId, vbstate) &&
+            (options == VBStatePersist::VBSTATE_PERSIST_WITHOUT_COMMIT ||
+             options == VBStatePersist::VBSTATE_PERSIST_WITH_COMMIT)) {
+            // Both write a commit record; only WITH_COMMIT waits for it to
+            // be durable.
+            if (!writeState(log,
+                            vbucketId,
+                            cachedVBStates[vbucketId],
+                            nullptr,
+                            options ==
+                                    VBStatePersist::
+                                            VBSTATE_PERSIST_WITH_COMMIT)) {
+                ++st.numVbSetFailure;
+                logger.log(EXTENSION_LOG_WARNING,
+                           "LogKVStore::snapshotVBucket: writeState failed "
+                           "state:%s, vb:%" PRIu16,
+                           VBucket::toString(vbstate.state),
+                           vbucketId);
+                return false;
+            }
+        }
+    }
+
+    LOG(EXTENSION_LOG_DEBUG,
+        "LogKVStore::snapshotVBucket: Snapshotted vbucket:%" PRIu16 " state:%s",
+        vbucketId,
+        vbstate.toJSON().c_str());
+
+    st.snapshotHisto.add((gethrtime() - start) / 1000);
+
+    return true;
+}
+
+bool LogKVStore::compactDB(compaction_ctx* hook_ctx) {
+    if (isReadOnly()) {
+        throw std::logic_error("LogKVStore::compactDB: Cannot perform "
+                               "on a read-only instance.");
+    }
+    TRACE_EVENT("ep-engine/log-kvstore", "compactDB",
+                this->configuration.getShardId());
+
+    hrtime_t start = gethrtime();
+    const uint16_t vbid = hook_ctx->db_file_id;
+    hook_ctx->config = &configuration;
+    // An entry is expected for every vbucket compacted (see
+    // KVBucket::compactInternal).
+    uint64_t maxPurgedSeqno = hook_ctx->max_purged_seq[vbid];
+
+    auto& log = *logs.at(vbid);
+    std::lock_guard<std::mutex> compactionLock(log.compactionMutex);
+
+    std::map<uint64_t, std::shared_ptr<Segment>> inputs;
+    std::shared_ptr<Segment> output;
+    uint64_t generation;
+    uint64_t sealedHighSeqno;
+    uint64_t purgeSeqno;
+    std::unique_ptr<vbucket_state> state;
+    uint64_t stateVersion;
+    std::string manifest;
+    uint64_t manifestVersion;
+    uint64_t manifestSeqno;
+
+    // A version superseded at seqno supersededAt (by a document written at
+    // the time written) is kept for rollback unless it's below the purge
+    // seqno, or superseded by a document old enough for its tombstone to be
+    // purged (which moves the purge seqno up to supersededAt). As with
+    // tombstones, the item with the highest seqno always keeps its history.
+    auto historyExpired = [&](uint64_t supersededAt, time_t written) {
+        return supersededAt <= purgeSeqno ||
+               (supersededAt != sealedHighSeqno &&
+                (hook_ctx->drop_deletes ||
+                 (uint64_t(written) < hook_ctx->purge_before_ts &&
+                  (!hook_ctx->purge_before_seq ||
+                   supersededAt <= hook_ctx->purge_before_seq))));
+    };
+
+    {
+        std::lock_guard<std::mutex> wlh(log.writeMutex);
+        {
+            std::lock_guard<std::mutex> lh(log.mutex);
+            if (cachedVBStates[vbid]) {
+                state = std::make_unique<vbucket_state>(*cachedVBStates[vbid]);
+            }
+            sealedHighSeqno = log.getHighSeqno();
+            purgeSeqno = std::max(maxPurgedSeqno,
+                                  state ? state->purgeSeqno : uint64_t(0));
+
+            // Only rewrite the segments where most of the bytes are no
+            // longer needed (all of them when dropping deletes).
+            for (const auto& segment : log.segments) {
+                uint64_t needed = log.liveBytes[segment.first];
+                auto history = log.history.find(segment.first);
+                if (history != log.history.end() &&
+                    !historyExpired(history->second.supersededAt,
+                                    history->second.written)) {
+                    needed += history->second.bytes;
+                }
+                if (hook_ctx->drop_deletes ||
+                    needed < segment.second->size * CompactionLiveRatio) {
+                    inputs.insert(segment);
+                }
+            }
+            if (inputs.empty()) {
+                return true;
+            }
+            generation = log.generation;
+            stateVersion = ++log.stateVersion;
+            manifest = log.manifest;
+            manifestVersion = log.manifestVersion;
+            manifestSeqno = log.manifestSeqno;
+        }
+
+        // Seal the active segment if it's being compacted; the flusher
+        // carries on in a new segment.
+        if (log.active && inputs.count(log.active->id)) {
+            log.active.reset();
+        }
+        output = createSegment(log, vbid, st.fsStatsCompaction);
+        if (!output) {
+            return false;
+        }
+    }
+
+    struct Move {
+        StoredDocKey key;
+        IndexEntry from;
+        IndexEntry to;
+    };
+    std::vector<Move> moves;
+    std::vector<std::pair<StoredDocKey, IndexEntry>> drops;
+    std::string buffer;
+    VBucketLog::History outputHistory;
+
+    // Write out the buffered records, then point the index at them (unless
+    // the documents have changed in the meantime). Until the output's
+    // commit record is written the inputs remain authoritative on disk.
+    auto flush = [&]() -> bool {
+        const uint64_t offset = output->size;
+        if (!buffer.empty()) {
+            if (!output->write(buffer.data(),
+                               buffer.size(),
+                               offset,
+                               st.fsStatsCompaction)) {
+                logger.log(EXTENSION_LOG_WARNING,
+                           "LogKVStore::compactDB: write error:%s, "
+                           "vb:%" PRIu16 ", file:%s",
+                           cb_strerror().c_str(),
+                           vbid,
+                           output->fileName.c_str());
+                return false;
+            }
+            output->size += buffer.size();
+            buffer.clear();
+        }
+
+        std::lock_guard<std::mutex> lh(log.mutex);
+        if (log.generation != generation) {
+            return false;
+        }
+        for (const auto& move : moves) {
+            auto it = log.index.find(move.key);
+            if (it != log.index.end() &&
+                it->second.segment == move.from.segment &&
+                it->second.offset == move.from.offset) {
+                log.liveBytes[move.from.segment] -= move.from.length;
+                log.liveBytes[move.to.segment] += move.to.length;
+                it->second = move.to;
+            }
+        }
+        for (const auto& drop : drops) {
+            auto it = log.index.find(drop.first);
+            if (it != log.index.end() &&
+                it->second.segment == drop.second.segment &&
+                it->second.offset == drop.second.offset) {
+                eraseIndexEntry(log, it);
+            }
+        }
+        moves.clear();
+        drops.clear();
+        return true;
+    };
+
+    bool success = true;
+    for (auto& input : inputs) {
+        Segment& segment = *input.second;
+        SegmentReader reader(segment, segment.size, st.fsStatsCompaction);
+        RecordType type;
+        uint64_t offset;
+        const char* data;
+        uint32_t length;
+        while (success && reader.next(type, offset, data, length)) {
+            DocumentRecord doc;
+            if (type != RecordType::Document ||
+                !decodeDocument(data + RecordHeaderSize,
+                                length - RecordHeaderSize,
+                                doc)) {
+                // The state and manifest are re-written below.
+                continue;
+            }
+
+            StoredDocKey key(doc.getKey());
+            const IndexEntry from{
+                    doc.seqno, segment.id, offset, length, doc.deleted};
+            bool current = false;
+            uint64_t supersededAt = 0;
+            time_t written = 0;
+            {
+                std::lock_guard<std::mutex> lh(log.mutex);
+                auto it = log.index.find(key);
+                if (it != log.index.end()) {
+                    current = it->second.segment == segment.id &&
+                              it->second.offset == offset;
+                    supersededAt = it->second.seqno;
+                    written = log.segments.at(it->second.segment)->lastWrite;
+                }
+            }
+
+            if (!current) {
+                if (supersededAt <= doc.seqno) {
+                    // Purged (along with its history), or a copy left
+                    // behind by a compaction which failed.
+                    continue;
+                }
+                if (historyExpired(supersededAt, written)) {
+                    if (supersededAt > purgeSeqno) {
+                        maxPurgedSeqno = std::max(maxPurgedSeqno, supersededAt);
+                    }
+                    continue;
+                }
+                // Rollback may still need it.
+                buffer.append(data, length);
+                outputHistory.add(length, supersededAt, written);
+                if (buffer.size() >= OutputChunkSize) {
+                    success = flush();
+                }
+                continue;
+            }
+
+            if (doc.deleted) {
+                // As per CouchKVStore, the item with the highest seqno is
+                // always kept.
+                if (doc.seqno != sealedHighSeqno &&
+                    (hook_ctx->drop_deletes ||
+                     (doc.exptime < hook_ctx->purge_before_ts &&
+                      (!hook_ctx->purge_before_seq ||
+                       doc.seqno <= hook_ctx->purge_before_seq)))) {
+                    maxPurgedSeqno = std::max(maxPurgedSeqno, doc.seqno);
+                    drops.emplace_back(std::move(key), from);
+                    continue;
+                }
+            } else {
+                time_t currtime = ep_real_time();
+                if (doc.exptime && time_t(doc.exptime) < currtime &&
+                    hook_ctx->expiryCallback) {
+                    auto it = makeItem(doc, vbid, GetMetaOnly::No);
+                    hook_ctx->expiryCallback->callback(*it, currtime);
+                }
+            }
+
+            if (hook_ctx->bloomFilterCallback) {
+                uint16_t vbucketId = vbid;
+                bool deleted = doc.deleted;
+                hook_ctx->bloomFilterCallback->callback(
+                        vbucketId, doc.getKey(), deleted);
+            }
+
+            const IndexEntry to{doc.seqno,
+                                output->id,
+                                output->size + buffer.size(),
+                                length,
+                                doc.deleted};
+            buffer.append(data, length);
+            moves.push_back({std::move(key), from, to});
+            if (buffer.size() >= OutputChunkSize) {
+                success = flush();
+            }
+        }
+        if (!success) {
+            break;
+        }
+    }
+
+    if (success) {
+        if (state) {
+            state->purgeSeqno = std::max(state->purgeSeqno, maxPurgedSeqno);
+            encodeVBState(buffer, stateVersion, *state);
+        }
+        if (manifestVersion) {
+            encodeManifest(buffer, manifestVersion, manifestSeqno, manifest);
+        }
+        std::vector<uint64_t> superseded;
+        for (const auto& input : inputs) {
+            superseded.push_back(input.first);
+        }
+        encodeCommit(buffer, superseded);
+        success = flush() && output->sync(st.fsStatsCompaction);
+    }
+
+    if (!success) {
+        // Whatever made it into the output is still referenced by the index
+        // (and the inputs are intact), a later compaction will pick it up.
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::compactDB: Failed to compact vb:%" PRIu16,
+                   vbid);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> wlh(log.writeMutex);
+        std::lock_guard<std::mutex> lh(log.mutex);
+        if (log.generation != generation) {
+            return false;
+        }
+        for (const auto& input : inputs) {
+            input.second->obsolete = true;
+            log.segments.erase(input.first);
+            log.liveBytes.erase(input.first);
+            log.history.erase(input.first);
+        }
+        if (outputHistory.bytes) {
+            // Adding to whatever the flusher superseded in the meantime.
+            auto& history = log.history[output->id];
+            history.add(outputHistory.bytes,
+                        outputHistory.supersededAt,
+                        outputHistory.written);
+        }
+
+        vbucket_state* cachedState = cachedVBStates[vbid];
+        if (cachedState) {
+            cachedState->purgeSeqno =
+                    std::max(cachedState->purgeSeqno, maxPurgedSeqno);
+        }
+        cachedDocCount[vbid] = log.numLive;
+        cachedDeleteCount[vbid] = log.numDeleted;
+        updateFileStats(vbid, log);
+    }
+    hook_ctx->max_purged_seq[vbid] = maxPurgedSeqno;
+
+    st.compactHisto.add((gethrtime() - start) / 1000);
+
+    return true;
+}
+
+vbucket_state* LogKVStore::getVBucketState(uint16_t vbid) {
+    return cachedVBStates[vbid];
+}
+
+size_t LogKVStore::getNumPersistedDeletes(uint16_t vbid) {
+    return cachedDeleteCount.at(vbid);
+}
+
+DBFileInfo LogKVStore::getDbFileInfo(uint16_t vbid) {
+    return DBFileInfo{cachedFileSize.at(vbid), cachedSpaceUsed.at(vbid)};
+}
+
+DBFileInfo LogKVStore::getAggrDbFileInfo() {
+    DBFileInfo kvsFileInfo;
+    for (size_t vbid = 0; vbid < logs.size(); vbid++) {
+        kvsFileInfo.fileSize += cachedFileSize[vbid].load();
+        kvsFileInfo.spaceUsed += cachedSpaceUsed[vbid].load();
+    }
+    return kvsFileInfo;
+}
+
+size_t LogKVStore::getNumItems(uint16_t vbid,
+                               uint64_t min_seq,
+                               uint64_t max_seq) {
+    auto& log = *logs.at(vbid);
+    size_t count = 0;
+    uint64_t next = min_seq;
+    while (true) {
+        std::lock_guard<std::mutex> lh(log.mutex);
+        if (log.bySeqno.empty()) {
+            return count;
+        }
+        if (next <= log.bySeqno.begin()->first &&
+            max_seq >= log.bySeqno.rbegin()->first) {
+            // The rest of the log.
+            return count + log.bySeqno.size();
+        }
+        auto it = log.bySeqno.lower_bound(next);
+        for (size_t ii = 0; ii < IndexChunkSize; ++ii, ++it) {
+            if (it == log.bySeqno.end() || it->first > max_seq) {
+                return count;
+            }
+            ++count;
+        }
+        if (it == log.bySeqno.end() || it->first > max_seq) {
+            return count;
+        }
+        // Let writers in before counting the rest.
+        next = it->first;
+    }
+}
+
+size_t LogKVStore::getItemCount(uint16_t vbid) {
+    return cachedDocCount.at(vbid);
+}
+
+RollbackResult LogKVStore::rollback(uint16_t vbid,
+                                    uint64_t rollbackSeqno,
+                                    std::shared_ptr<RollbackCB> cb) {
+    auto& log = *logs.at(vbid);
+    std::lock_guard<std::mutex> compactionLock(log.compactionMutex);
+    std::lock_guard<std::mutex> writeLock(log.writeMutex);
+
+    vbucket_state* current = cachedVBStates[vbid];
+    if (!current) {
+        return RollbackResult(false, 0, 0, 0);
+    }
+    const uint64_t purgeSeqno = current->purgeSeqno;
+    if (rollbackSeqno < purgeSeqno) {
+        // Compaction only keeps the history above the purge seqno.
+        logger.log(EXTENSION_LOG_NOTICE,
+                   "LogKVStore::rollback: vb:%" PRIu16 " has been purged "
+                   "up to seqno %" PRIu64 ", cannot roll back to %" PRIu64,
+                   vbid,
+                   purgeSeqno,
+                   rollbackSeqno);
+        return RollbackResult(false, 0, 0, 0);
+    }
+
+    std::map<uint64_t, std::shared_ptr<Segment>> segments;
+    std::vector<std::pair<StoredDocKey, uint64_t>> rolledBack;
+    {
+        std::lock_guard<std::mutex> lh(log.mutex);
+        for (auto it = log.bySeqno.upper_bound(rollbackSeqno);
+             it != log.bySeqno.end();
+             ++it) {
+            rolledBack.emplace_back(*it->second, it->first);
+        }
+        if ((log.bySeqno.size() / 2) <= rolledBack.size()) {
+            // rollback is greater than 50%, reset the vbucket and send the
+            // entire snapshot
+            return RollbackResult(false, 0, 0, 0);
+        }
+        segments = log.segments;
+    }
+
+    // Rebuild the vbucket as of rollbackSeqno from the (committed) records
+    // of its segments, which still hold the versions superseded since.
+    VBucketLog rebuilt;
+    rebuilt.rev = log.rev;
+    rebuilt.segments = segments;
+    ReplayState replay;
+    replay.maxSeqno = rollbackSeqno;
+    for (auto& segment : segments) {
+        replaySegment(rebuilt, vbid, *segment.second, replay);
+    }
+
+    vbucket_state& state = replay.state;
+    if (!replay.haveState) {
+        // The states written up to rollbackSeqno were compacted away; carry
+        // on from the current one, with the snapshot ending at the rollback
+        // point.
+        state = *current;
+        state.highSeqno = rebuilt.getHighSeqno();
+        state.lastSnapStart = state.highSeqno;
+        state.lastSnapEnd = state.highSeqno;
+    }
+
+    cb->setDbHeader(&rebuilt);
+    for (const auto& doc : rolledBack) {
+        auto it = std::make_unique<Item>(
+                doc.first, 0, 0, nullptr, 0, nullptr, 0, 0, doc.second, vbid);
+        GetValue gv(std::move(it), ENGINE_SUCCESS, -1, true);
+        cb->callback(gv);
+        if (cb->getStatus() == ENGINE_ENOMEM) {
+            return RollbackResult(false, 0, 0, 0);
+        }
+    }
+
+    // Persist the rebuilt vbucket as a single segment which supersedes all
+    // of the existing ones, keeping the history a later rollback may need.
+    auto output = createSegment(log, vbid, st.fsStats);
+    if (!output) {
+        return RollbackResult(false, 0, 0, 0);
+    }
+    std::string buffer;
+    VBucketLog::History outputHistory;
+    auto write = [&output, &buffer, this]() {
+        if (!output->write(
+                    buffer.data(), buffer.size(), output->size, st.fsStats)) {
+            return false;
+        }
+        output->size += buffer.size();
+        buffer.clear();
+        return true;
+    };
+    bool success = true;
+    size_t numIndexed = 0;
+    for (auto& input : segments) {
+        Segment& segment = *input.second;
+        SegmentReader reader(segment, segment.size, st.fsStats);
+        RecordType type;
+        uint64_t offset;
+        const char* data;
+        uint32_t length;
+        while (success && reader.next(type, offset, data, length)) {
+            DocumentRecord doc;
+            if (type != RecordType::Document ||
+                !decodeDocument(data + RecordHeaderSize,
+                                length - RecordHeaderSize,
+                                doc) ||
+                doc.seqno > rollbackSeqno) {
+                continue;
+            }
+            auto it = rebuilt.index.find(StoredDocKey(doc.getKey()));
+            if (it == rebuilt.index.end()) {
+                continue;
+            }
+            IndexEntry& entry = it->second;
+            if (entry.segment == segment.id && entry.offset == offset) {
+                entry.segment = output->id;
+                entry.offset = output->size + buffer.size();
+                ++numIndexed;
+            } else if (entry.seqno > doc.seqno && entry.seqno > purgeSeqno) {
+                // Kept as compaction would.
+                outputHistory.add(length, entry.seqno, 0);
+            } else {
+                continue;
+            }
+            buffer.append(data, length);
+            if (buffer.size() >= OutputChunkSize) {
+                success = write();
+            }
+        }
+        if (!success) {
+            break;
+        }
+    }
+    if (success && numIndexed != rebuilt.index.size()) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::rollback: Only found %" PRIu64 " of %" PRIu64
+                   " documents in the segments of vb:%" PRIu16,
+                   uint64_t(numIndexed),
+                   uint64_t(rebuilt.index.size()),
+                   vbid);
+        success = false;
+    }
+    // No superseding document was written after now.
+    outputHistory.written = ep_real_time();
+
+    const uint64_t highSeqno =
+            std::max(uint64_t(state.highSeqno), rebuilt.getHighSeqno());
+    state.highSeqno = highSeqno;
+    state.purgeSeqno = purgeSeqno;
+    if (success) {
+        encodeVBState(buffer, ++log.stateVersion, state);
+        if (replay.manifestVersion) {
+            encodeManifest(buffer,
+                           ++log.stateVersion,
+                           replay.manifestSeqno,
+                           replay.manifest);
+        }
+        std::vector<uint64_t> superseded;
+        for (const auto& segment : segments) {
+            superseded.push_back(segment.first);
+        }
+        encodeCommit(buffer, superseded);
+        success = write() && output->sync(st.fsStats);
+    }
+    if (!success) {
+        logger.log(EXTENSION_LOG_WARNING,
+                   "LogKVStore::rollback: Failed to write %s, vb:%" PRIu16,
+                   output->fileName.c_str(),
+                   vbid);
+        std::lock_guard<std::mutex> lh(log.mutex);
+        log.segments.erase(output->id);
+        output->obsolete = true;
+        return RollbackResult(false, 0, 0, 0);
+    }
+
+    {
+        std::lock_guard<std::mutex> lh(log.mutex);
+        for (auto& segment : log.segments) {
+            if (segment.first != output->id) {
+                segment.second->obsolete = true;
+            }
+        }
+        log.segments.clear();
+        log.segments[output->id] = output;
+        log.active.reset();
+        log.index = std::move(rebuilt.index);
+        log.bySeqno = std::move(rebuilt.bySeqno);
+        log.byKey = std::move(rebuilt.byKey);
+        log.liveBytes.clear();
+        for (const auto& doc : log.index) {
+            log.liveBytes[output->id] += doc.second.length;
+        }
+        log.history.clear();
+        if (outputHistory.bytes) {
+            log.history[output->id] = outputHistory;
+        }
+        log.numLive = rebuilt.numLive;
+        log.numDeleted = rebuilt.numDeleted;
+        log.manifest = std::move(replay.manifest);
+        log.manifestVersion = log.stateVersion;
+        log.manifestSeqno = replay.manifestSeqno;
+        ++log.generation;
+
+        delete cachedVBStates[vbid];
+        cachedVBStates[vbid] = new vbucket_state(state);
+        cachedDocCount[vbid] = log.numLive;
+        cachedDeleteCount[vbid] = log.numDeleted;
+        updateFileStats(vbid, log);
+    }
+
+    return RollbackResult(
+            true, state.highSeqno, state.lastSnapStart, state.lastSnapEnd);
+}
+
+void LogKVStore::pendingTasks() {
+    if (isReadOnly()) {
+        throw std::logic_error("LogKVStore::pendingTasks: Not valid on a "
+                               "read-only object.");
+    }
+
+    if (!pendingFileDeletions.empty()) {
+        std::queue<std::string> queue;
+        pendingFileDeletions.getAll(queue);
+
+        while (!queue.empty()) {
+            std::string filename_str = queue.front();
+            if (remove(filename_str.c_str()) == -1) {
+                logger.log(EXTENSION_LOG_WARNING,
+                           "LogKVStore::pendingTasks: "
+                           "remove error:%d, file%s",
+                           errno,
+                           filename_str.c_str());
+                if (errno != ENOENT) {
+                    pendingFileDeletions.push(filename_str);
+                }
+            }
+            queue.pop();
+        }
+    }
+}
+
+bool LogKVStore::getStat(const char* name, size_t& value) {
+    if (strcmp("io_total_read_bytes", name) == 0) {
+        value = st.fsStats.totalBytesRead.load() +
+                st.fsStatsCompaction.totalBytesRead.load();
+        return true;
+    } else if (strcmp("io_total_write_bytes", name) == 0) {
+        value = st.fsStats.totalBytesWritten.load() +
+                st.fsStatsCompaction.totalBytesWritten.load();
+        return true;
+    } else if (strcmp("io_compaction_read_bytes", name) == 0) {
+        value = st.fsStatsCompaction.totalBytesRead;
+        return true;
+    } else if (strcmp("io_compaction_write_bytes", name) == 0) {
+        value = st.fsStatsCompaction.totalBytesWritten;
+        return true;
+    }
+
+    return false;
+}
+
+ENGINE_ERROR_CODE LogKVStore::getAllKeys(
+        uint16_t vbid,
+        const DocKey start_key,
+        uint32_t count,
+        std::shared_ptr<Callback<const DocKey&>> cb) {
+    auto& log = *logs.at(vbid);
+    std::vector<StoredDocKey> keys;
+    // Where the next chunk starts
+    std::unique_ptr<StoredDocKey> next;
+    while (keys.size() < count) {
+        std::lock_guard<std::mutex> lh(log.mutex);
+        auto it = next ? log.byKey.lower_bound(*next)
+                       : log.byKey.lower_bound(start_key);
+        for (size_t ii = 0;
+             ii < IndexChunkSize && it != log.byKey.end() &&
+             keys.size() < count;
+             ++ii, ++it) {
+            if (!(*it)->second.deleted) {
+                keys.push_back((*it)->first);
+            }
+        }
+        if (it == log.byKey.end()) {
+            break;
+        }
+        // Let writers in before carrying on from here.
+        next = std::make_unique<StoredDocKey>((*it)->first);
+    }
+
+    for (const auto& key : keys) {
+        cb->callback(key);
+    }
+    return ENGINE_SUCCESS;
+}
+
+ScanContext* LogKVStore::initScanContext(
+        std::shared_ptr<Callback<GetValue>> cb,
+        std::shared_ptr<Callback<CacheLookup>> cl,
+        uint16_t vbid,
+        uint64_t startSeqno,
+        DocumentFilter options,
+        ValueFilter valOptions) {
+    auto& log = *logs.at(vbid);
+    auto snapshot = std::make_unique<ScanSnapshot>();
+    {
+        std::lock_guard<std::mutex> lh(log.mutex);
+        if (log.segments.empty()) {
+            logger.log(EXTENSION_LOG_WARNING,
+                       "LogKVStore::initScanContext: No data for "
+                       "vb:%" PRIu16 " rev:%" PRIu64,
+                       vbid,
+                       log.rev);
+            return NULL;
+        }
+        snapshot->generation = log.generation;
+        snapshot->maxSeqno = log.getHighSeqno();
+        log.scans.insert(snapshot.get());
+    }
+    const uint64_t maxSeqno = snapshot->maxSeqno;
+
+    // Count the snapshot (rather than the live index, which may already
+    // have moved on), a chunk at a time. Each chunk counts the live and
+    // superseded entries of a seqno range under the same lock, so a version
+    // being superseded in between is counted exactly once.
+    uint64_t count = 0;
+    uint64_t next = startSeqno;
+    while (next <= maxSeqno) {
+        std::lock_guard<std::mutex> lh(log.mutex);
+        auto it = log.bySeqno.lower_bound(next);
+        for (size_t ii = 0; ii < IndexChunkSize && it != log.bySeqno.end() &&
+                            it->first <= maxSeqno;
+             ++ii, ++it) {
+            ++count;
+        }
+        const uint64_t end = (it == log.bySeqno.end() || it->first > maxSeqno)
+                                     ? maxSeqno + 1
+                                     : it->first;
+        for (auto old = snapshot->superseded.lower_bound(next);
+             old != snapshot->superseded.end() && old->first < end;
+             ++old) {
+            ++count;
+        }
+        next = end;
+    }
+
+    size_t scanId = scanCounter++;
+
+    {
+        std::lock_guard<std::mutex> lh(scanLock);
+        scans[scanId] = std::move(snapshot);
+    }
+
+    ScanContext* sctx = new ScanContext(cb,
+                                        cl,
+                                        vbid,
+                                        scanId,
+                                        startSeqno,
+                                        maxSeqno,
+                                        options,
+                                        valOptions,
+                                        count,
+                                        configuration);
+    sctx->logger = &logger;
+    return sctx;
+}
+
+scan_error_t LogKVStore::scan(ScanContext* ctx) {
+    if (!ctx) {
+        return scan_failed;
+    }
+
+    if (ctx->lastReadSeqno == ctx->maxSeqno) {
+        return scan_success;
+    }
+
+    ScanSnapshot* snapshot;
+    {
+        std::lock_guard<std::mutex> lh(scanLock);
+        auto itr = scans.find(ctx->scanId);
+        if (itr == scans.end()) {
+            return scan_failed;
+        }
+        snapshot = itr->second.get();
+    }
+
+    uint64_t start = ctx->startSeqno;
+    if (ctx->lastReadSeqno != 0) {
+        start = ctx->lastReadSeqno + 1;
+    }
+
+    auto& log = *logs.at(ctx->vbid);
+    const bool onlyKeys = ctx->valFilter == ValueFilter::KEYS_ONLY;
+    std::vector<std::pair<IndexEntry, std::shared_ptr<Segment>>> batch;
+    std::vector<char> buffer;
+    while (start <= ctx->maxSeqno) {
+        // Take the next batch from the index, then read it without the lock.
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lh(log.mutex);
+            if (log.generation != snapshot->generation) {
+                logger.log(EXTENSION_LOG_WARNING,
+                           "LogKVStore::scan: vb:%" PRIu16
+                           " was replaced during the scan",
+                           ctx->vbid);
+                return scan_failed;
+            }
+            // Everything below start has been passed to the callbacks.
+            auto& superseded = snapshot->superseded;
+            superseded.erase(superseded.begin(),
+                             superseded.lower_bound(start));
+
+            // Merge the live index with the versions superseded since the
+            // scan started (the two never have a seqno in common).
+            auto it = log.bySeqno.lower_bound(start);
+            auto old = superseded.begin();
+            while (batch.size() < IndexChunkSize) {
+                const bool haveLive = it != log.bySeqno.end() &&
+                                      it->first <= ctx->maxSeqno;
+                const bool haveOld = old != superseded.end();
+                if (!haveLive && !haveOld) {
+                    break;
+                }
+                std::pair<IndexEntry, std::shared_ptr<Segment>> item;
+                if (haveOld && (!haveLive || old->first < it->first)) {
+                    item = old->second;
+                    ++old;
+                } else {
+                    const IndexEntry& entry = log.index.at(*it->second);
+                    item = std::make_pair(entry,
+                                          log.segments.at(entry.segment));
+                    ++it;
+                }
+                if (item.first.deleted &&
+                    ctx->docFilter == DocumentFilter::NO_DELETES) {
+                    continue;
+                }
+                batch.push_back(std::move(item));
+            }
+
+            start = ctx->maxSeqno + 1;
+            if (it != log.bySeqno.end() && it->first <= ctx->maxSeqno) {
+                start = it->first;
+            }
+            if (old != superseded.end()) {
+                start = std::min(start, old->first);
+            }
+        }
+
+        for (const auto& item : batch) {
+            const IndexEntry& entry = item.first;
+            buffer.resize(entry.length);
+            RecordType type;
+            uint32_t length;
+            DocumentRecord doc;
+            Segment& segment = *item.second;
+            if (!segment.read(buffer.data(), entry.length, entry.offset,
+                              st.fsStats) ||
+                !checkRecord(buffer.data(), entry.length, type, length) ||
+                type != RecordType::Document ||
+                !decodeDocument(buffer.data() + RecordHeaderSize,
+                                length - RecordHeaderSize,
+                                doc)) {
+                logger.log(EXTENSION_LOG_WARNING,
+                           "LogKVStore::scan: Failed to read the document at "
+                           "offset %" PRIu64 " of %s, vb:%" PRIu16
+                           ", seqno:%" PRIu64,
+                           entry.offset,
+                           segment.fileName.c_str(),
+                           ctx->vbid,
+                           entry.seqno);
+                return scan_failed;
+            }
+
+            CacheLookup lookup(doc.getKey(), doc.seqno, ctx->vbid);
+            ctx->lookup->callback(lookup);
+            if (ctx->lookup->getStatus() == ENGINE_KEY_EEXISTS) {
+                ctx->lastReadSeqno = doc.seqno;
+                continue;
+            } else if (ctx->lookup->getStatus() == ENGINE_ENOMEM) {
+                return scan_again;
+            }
+
+            if (onlyKeys) {
+                doc.valueLen = 0;
+            } else if (doc.valueLen == 0) {
+                // No data, it cannot have a datatype!
+                doc.datatype = PROTOCOL_BINARY_RAW_BYTES;
+            }
+            GetValue rv(makeItem(doc, ctx->vbid, GetMetaOnly::No),
+                        ENGINE_SUCCESS,
+                        -1,
+                        onlyKeys);
+            ctx->callback->callback(rv);
+            if (ctx->callback->getStatus() == ENGINE_ENOMEM) {
+                return scan_again;
+            }
+
+            ctx->lastReadSeqno = doc.seqno;
+        }
+    }
+    return scan_success;
+}
+
+void LogKVStore::destroyScanContext(ScanContext* ctx) {
+    if (!ctx) {
+        return;
+    }
+
+    std::unique_ptr<ScanSnapshot> snapshot;
+    {
+        std::lock_guard<std::mutex> lh(scanLock);
+        auto itr = scans.find(ctx->scanId);
+        if (itr != scans.end()) {
+            snapshot = std::move(itr->second);
+            scans.erase(itr);
+        }
+    }
+    if (snapshot) {
+        auto& log = *logs.at(ctx->vbid);
+        std::lock_guard<std::mutex> lh(log.mutex);
+        log.scans.erase(snapshot.get());
+    }
+    delete ctx;
+}
+
+bool LogKVStore::persistCollectionsManifestItem(uint16_t vbid,
+                                                const Item& manifestItem) {
+    auto& log = *logs.at(vbid);
+    std::lock_guard<std::mutex> lh(log.writeMutex);
+    // writeState logs error details
+    return writeState(log, vbid, nullptr, &manifestItem, true);
+}
+
+std::string LogKVStore::getCollectionsManifest(uint16_t vbid) {
+    auto& log = *logs.at(vbid);
+    std::lock_guard<std::mutex> lh(log.mutex);
+    return log.manifest;
+}
+
+void LogKVStore::incrementRevision(uint16_t vbid) {
+    auto& log = *logs.at(vbid);
+    std::lock_guard<std::mutex> wlh(log.writeMutex);
+    std::lock_guard<std::mutex> lh(log.mutex);
+    // The segments of the current revision are left for delVBucket.
+    log.clear();
+    ++log.rev;
+    updateFileStats(vbid, log);
+}
+
+uint64_t LogKVStore::prepareToDelete(uint16_t vbid) {
+    // Clear the stats so it looks empty (real deletion of the disk data occurs
+    // later)
+    cachedDocCount[vbid] = 0;
+    cachedDeleteCount[vbid] = 0;
+    cachedFileSize[vbid] = 0;
+    cachedSpaceUsed[vbid] = 0;
+    std::lock_guard<std::mutex> lh(logs.at(vbid)->writeMutex);
+    return logs[vbid]->rev;
+}
+
+/* end of log-kvstore.cc */
@@ -0,0 +1,310 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "libcouchstore/couch_db.h"
+#include <relaxed_atomic.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "atomicqueue.h"
+#include "item.h"
+#include "kvstore.h"
+#include "logger.h"
+
+/**
+ * KVStore using an append-only, segmented log per vBucket with an in-memory
+ * hash index (key -> location of the latest version of the document).
+ *
+ * Each vBucket is stored in a series of segment files named
+ * <dbname>/<vbid>.logkv.<revision>.<segment id>. Every write (documents, the
+ * vBucket state and the collections manifest) is appended to the vBucket's
+ * active segment as a checksummed record; each flusher batch ends with a
+ * commit record and is synced with a single fsync, so a batch is either
+ * wholly visible after a crash or not at all. Once the active segment grows
+ * past the configured segment size it is sealed and a new one is started.
+ *
+ * Reads look the key up in the index and issue a single pread. A by-seqno
+ * ordered view of the index provides DCP backfill and rollback, and a by-key
+ * one provides getAllKeys. Backfills stream from the index in batches rather
+ * than copying it, so they don't hold up the flusher.
+ *
+ * Compaction copies the records still needed from the segments where most
+ * of the bytes no longer are into a new segment (dropping purgeable
+ * tombstones and the overwritten versions rollback no longer needs, and
+ * notifying expired items) and then deletes those segments. The flusher can
+ * keep appending to the active segment while this happens.
+ *
+ * On startup the index is rebuilt by replaying the committed records of
+ * each vBucket's segments. Each instance only loads the vBuckets belonging
+ * to its shard.
+ */
+class LogKVStore : public KVStore {
+public:
+    /**
+     * Constructor - creates a read/write LogKVStore
+     *
+     * @param config    Configuration information
+     */
+    LogKVStore(KVStoreConfig& config);
+
+    /**
+     * Alternate constructor for injecting base FileOps
+     *
+     * @param config    Configuration information
+     * @param ops       Couchstore FileOps implementation to be used
+     */
+    LogKVStore(KVStoreConfig& config, FileOpsInterface& ops);
+
+    ~LogKVStore();
+
+    void reset(uint16_t vbucketId) override;
+
+    bool begin() override;
+
+    bool commit(const Item* collectionsManifest) override;
+
+    void rollback() override;
+
+    StorageProperties getStorageProperties() override;
+
+    void set(const Item& itm, Callback<mutation_result>& cb) override;
+
+    GetValue get(const DocKey& key,
+                 uint16_t vb,
+                 bool fetchDelete = false) override;
+
+    /**
+     * Retrieve the document with a given key.
+     *
+     * @param dbHandle the vBucket log to read from (see RollbackCB)
+     */
+    GetValue getWithHeader(void* dbHandle,
+                           const DocKey& key,
+                           uint16_t vb,
+                           GetMetaOnly getMetaOnly,
+                           bool fetchDelete = false) override;
+
+    void getMulti(uint16_t vb, vb_bgfetch_queue_t& itms) override;
+
+    uint16_t getNumVbsPerFile() override {
+        return 1;
+    }
+
+    void del(const Item& itm, Callback<int>& cb) override;
+
+    void delVBucket(uint16_t vbucket, uint64_t fileRev) override;
+
+    std::vector<vbucket_state*> listPersistedVbuckets() override;
+
+    void getPersistedStats(std::map<std::string, std::string>& stats) override;
+
+    bool snapshotVBucket(uint16_t vbucketId,
+                         const vbucket_state& vbstate,
+                         VBStatePersist options) override;
+
+    bool compactDB(compaction_ctx* ctx) override;
+
+    uint16_t getDBFileId(const protocol_binary_request_compact_db& req) override {
+        return ntohs(req.message.header.request.vbucket);
+    }
+
+    vbucket_state* getVBucketState(uint16_t vbid) override;
+
+    size_t getNumPersistedDeletes(uint16_t vbid) override;
+
+    DBFileInfo getDbFileInfo(uint16_t vbid) override;
+
+    DBFileInfo getAggrDbFileInfo() override;
+
+    size_t getNumItems(uint16_t vbid,
+                       uint64_t min_seq,
+                       uint64_t max_seq) override;
+
+    size_t getItemCount(uint16_t vbid) override;
+
+    /**
+     * Rollback the vBucket to the given seqno.
+     *
+     * Not possible to a seqno below the vBucket's purge seqno (compaction
+     * only keeps the overwritten versions above it).
+     */
+    RollbackResult rollback(uint16_t vbid,
+                            uint64_t rollbackSeqno,
+                            std::shared_ptr<RollbackCB> cb) override;
+
+    void pendingTasks() override;
+
+    bool getStat(const char* name, size_t& value) override;
+
+    ENGINE_ERROR_CODE getAllKeys(
+            uint16_t vbid,
+            const DocKey start_key,
+            uint32_t count,
+            std::shared_ptr<Callback<const DocKey&>> cb) override;
+
+    ScanContext* initScanContext(std::shared_ptr<Callback<GetValue>> cb,
+                                 std::shared_ptr<Callback<CacheLookup>> cl,
+                                 uint16_t vbid,
+                                 uint64_t startSeqno,
+                                 DocumentFilter options,
+                                 ValueFilter valOptions) override;
+
+    scan_error_t scan(ScanContext* sctx) override;
+
+    void destroyScanContext(ScanContext* ctx) override;
+
+    bool persistCollectionsManifestItem(uint16_t vbid,
+                                        const Item& manifestItem) override;
+
+    std::string getCollectionsManifest(uint16_t vbid) override;
+
+    void incrementRevision(uint16_t vbid) override;
+
+    uint64_t prepareToDelete(uint16_t vbid) override;
+
+private:
+    class Segment;
+    class SegmentReader;
+    class VBucketLog;
+    class LogRequest;
+    struct ReplayState;
+    struct ScanSnapshot;
+
+    /// Where (the latest version of) a document lives in a vBucket's log.
+    struct IndexEntry {
+        uint64_t seqno;
+        uint64_t segment;
+        uint64_t offset;
+        uint32_t length;
+        bool deleted;
+    };
+
+    void initialize();
+
+    /// Load the given segments of a vBucket, rebuilding its index
+    bool loadVBucket(uint16_t vbid,
+                     uint64_t rev,
+                     const std::vector<uint64_t>& segmentIds);
+
+    /**
+     * Apply the committed records of a segment to the log.
+     *
+     * @return true if the segment contained any committed records
+     */
+    bool replaySegment(VBucketLog& log,
+                       uint16_t vbid,
+                       Segment& segment,
+                       ReplayState& replay);
+
+    std::shared_ptr<Segment> openSegment(const std::string& fileName,
+                                         uint64_t id,
+                                         bool create,
+                                         FileStats& stats);
+
+    std::shared_ptr<Segment> createSegment(VBucketLog& log,
+                                           uint16_t vbid,
+                                           FileStats& stats);
+
+    /// Append data to the active segment (starting a new one if needed)
+    bool append(VBucketLog& log,
+                uint16_t vbid,
+                const std::string& data,
+                uint64_t& offset,
+                std::shared_ptr<Segment>& segment);
+
+    /// Append (and commit) a vBucket state and/or collections manifest
+    bool writeState(VBucketLog& log,
+                    uint16_t vbid,
+                    const vbucket_state* state,
+                    const Item* collectionsManifest,
+                    bool doSync);
+
+    static std::string serialiseManifest(const Item& collectionsManifest);
+
+    bool commitLog(const Item* collectionsManifest);
+
+    void commitCallback(const std::vector<LogRequest*>& committedReqs,
+                        kvstats_ctx& kvctx,
+                        bool success);
+
+    bool lookup(VBucketLog& log,
+                const DocKey& key,
+                IndexEntry& entry,
+                std::shared_ptr<Segment>& segment);
+
+    GetValue fetchDoc(Segment& segment,
+                      const IndexEntry& entry,
+                      uint16_t vbid,
+                      GetMetaOnly metaOnly);
+
+    /**
+     * Point the index at a (newer) version of a document.
+     *
+     * @param existed set to true if a live version of the document was
+     *        indexed
+     */
+    void applyIndexUpdate(VBucketLog& log,
+                          const StoredDocKey& key,
+                          const IndexEntry& entry,
+                          bool& existed);
+
+    void eraseIndexEntry(
+            VBucketLog& log,
+            std::unordered_map<StoredDocKey, IndexEntry>::iterator it);
+
+    /// Hand an entry about to leave the index to the scans which need it
+    void retireIndexEntry(VBucketLog& log, const IndexEntry& entry);
+
+    /// Discard all of the segments of the vBucket (removing their files)
+    void dropSegments(VBucketLog& log);
+
+    void updateFileStats(uint16_t vbid, const VBucketLog& log);
+
+    void removeFile(const std::string& fileName);
+
+    const std::string dbname;
+
+    FileOpsInterface& ops;
+
+    Logger& logger;
+
+    /// Per-vBucket logs, allocated up front for every vBucket
+    std::vector<std::unique_ptr<VBucketLog>> logs;
+
+    std::vector<std::unique_ptr<LogRequest>> pendingReqsQ;
+    bool intransaction;
+
+    std::vector<Couchbase::RelaxedAtomic<size_t>> cachedDeleteCount;
+    std::vector<Couchbase::RelaxedAtomic<uint64_t>> cachedFileSize;
+    std::vector<Couchbase::RelaxedAtomic<uint64_t>> cachedSpaceUsed;
+
+    /* all open scans, keyed by ScanContext::scanId */
+    std::mutex scanLock;
+    std::map<size_t, std::unique_ptr<ScanSnapshot>> scans;
+    std::atomic<size_t> scanCounter;
+
+    /* deleted segment files which could not be removed yet */
+    AtomicQueue<std::string> pendingFileDeletions;
+};
@@ -0,0 +1,104 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+/**
+ * An integer of type T stored in only `Bytes` bytes, with an alignment of 1.
+ *
+ * Used to shrink fixed-size objects which hold many integers whose range in
+ * practice is much smaller than their type (for example seqnos, which are
+ * 64-bit but can never realistically exceed 2^47). Behaves like a T for
+ * reads (implicit conversion) and assignment; assigning a value outside of
+ * the representable range throws std::out_of_range rather than silently
+ * truncating.
+ *
+ * Signed types are stored in two's complement and sign-extended on load, so
+ * small negative values (e.g. the special StoredValue bySeqno states)
+ * round-trip.
+ */
+template <typename T, size_t Bytes>
+class PackedInteger {
+public:
+    static_assert(std::is_integral<T>::value,
+                  "PackedInteger: T must be an integral type");
+    static_assert(Bytes > 0 && Bytes < sizeof(T),
+                  "PackedInteger: Bytes must be less than sizeof(T)");
+
+    static const size_t Bits = Bytes * 8;
+
+    PackedInteger() : PackedInteger(0) {
+    }
+
+    PackedInteger(T v) {
+        store(v);
+    }
+
+    PackedInteger& operator=(T v) {
+        store(v);
+        return *this;
+    }
+
+    operator T() const {
+        return load();
+    }
+
+    /// Smallest value which can be stored.
+    static constexpr T min() {
+        return std::is_signed<T>::value ? T(-(int64_t(1) << (Bits - 1))) : 0;
+    }
+
+    /// Largest value which can be stored.
+    static constexpr T max() {
+        return std::is_signed<T>::value ? T((uint64_t(1) << (Bits - 1)) - 1)
+                                        : T((uint64_t(1) << Bits) - 1);
+    }
+
+private:
+    void store(T v) {
+        if ((std::is_signed<T>::value && v < min()) || v > max()) {
+            throw std::out_of_range("PackedInteger::store: value (which is " +
+                                    std::to_string(v) +
+                                    ") does not fit in " +
+                                    std::to_string(Bits) + " bits");
+        }
+        const auto u = static_cast<uint64_t>(v);
+        for (size_t i = 0; i < Bytes; ++i) {
+            bytes[i] = static_cast<uint8_t>(u >> (8 * i));
+        }
+    }
+
+    T load() const {
+        uint64_t u = 0;
+        for (size_t i = 0; i < Bytes; ++i) {
+            u |= uint64_t(bytes[i]) << (8 * i);
+        }
+        if (std::is_signed<T>::value && (u >> (Bits - 1)) & 1) {
+            // Sign-extend.
+            u |= ~uint64_t(0) << Bits;
+        }
+        return static_cast<T>(u);
+    }
+
+    uint8_t bytes[Bytes];
+};
@@ -0,0 +1,82 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+/**
+ * A logarithmic (Morris-style) counter, which allows a small integer type to
+ * count a much larger number of events.
+ *
+ * generateValue() returns the counter incremented by one with probability
+ * 1 / (counterValue * incFactor + 1), so the larger the counter gets the
+ * less likely it is to be incremented. With the default incFactor an 8-bit
+ * counter saturates after roughly 65,000 increments.
+ *
+ * The counter value itself is owned by the caller; this class only holds
+ * the state of the (xorshift) random number generator. It is not
+ * thread-safe - callers must serialise calls to generateValue() on the same
+ * instance.
+ */
+template <typename T>
+class ProbabilisticCounter {
+public:
+    static constexpr double defaultIncFactor = 2.0;
+
+    ProbabilisticCounter(double incFactor = defaultIncFactor,
+                         uint32_t seed = 1)
+        : incFactor(incFactor), state(seed != 0 ? seed : 1) {
+    }
+
+    /**
+     * @param counterValue the current value of the counter
+     * @return the new value of the counter (counterValue or
+     *         counterValue + 1)
+     */
+    T generateValue(T counterValue) {
+        if (counterValue == std::numeric_limits<T>::max()) {
+            return counterValue;
+        }
+        if (isIncremented(counterValue)) {
+            return counterValue + 1;
+        }
+        return counterValue;
+    }
+
+private:
+    bool isIncremented(T counterValue) {
+        const double divisor = (double(counterValue) * incFactor) + 1.0;
+        return nextRandom() < (1.0 / divisor);
+    }
+
+    /// @return a pseudo-random number in the range [0, 1)
+    double nextRandom() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return double(state) / (double(std::numeric_limits<uint32_t>::max()) +
+                                1.0);
+    }
+
+    const double incFactor;
+    uint32_t state;
+};
+
+template <typename T>
+constexpr double ProbabilisticCounter<T>::defaultIncFactor;
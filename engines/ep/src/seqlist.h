@@ -25,7 +25,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <mutex>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 #include "config.h"
@@ -33,9 +36,77 @@
 #include "memcached/engine_error.h"
 #include "stored-value.h"
 
+#include <boost/optional/optional.hpp>
+
 /* [EPHE TODO]: Check if uint64_t can be used instead */
 using seqno_t = int64_t;
 
+/**
+ * Class that represents a range of sequence numbers.
+ * SeqRange is closed, that is, both begin and end are inclusive.
+ *
+ * Note: begin <= 0 is considered an default/inactive range and can be set
+ *       only by ctor or by reset.
+ */
+class SeqRange {
+public:
+    SeqRange(const seqno_t beginVal, const seqno_t endVal)
+        : end(endVal), begin(beginVal) {
+        if ((end < begin) || (begin < 0)) {
+            throw std::invalid_argument("Trying to create invalid SeqRange: [" +
+                                        std::to_string(begin) + ", " +
+                                        std::to_string(end) + "]");
+        }
+    }
+
+    SeqRange& operator=(const SeqRange& other) {
+        begin = other.begin;
+        end = other.end;
+        return *this;
+    }
+
+    /**
+     * Returns true if the range overlaps with another.
+     */
+    bool overlaps(const SeqRange& other) const {
+        return std::max(begin, other.begin) <= std::min(end, other.end);
+    }
+
+    /**
+     *  Returns true if the seqno falls in the range
+     */
+    bool fallsInRange(const seqno_t seqno) const {
+        return (seqno >= begin) && (seqno <= end);
+    }
+
+    void reset() {
+        begin = 0;
+        end = 0;
+    }
+
+    seqno_t getBegin() const {
+        return begin;
+    }
+
+    void setBegin(const seqno_t start) {
+        if ((start <= 0) || (start > end)) {
+            throw std::invalid_argument(
+                    "Trying to set incorrect begin " + std::to_string(start) +
+                    " on SeqRange: [" + std::to_string(begin) + ", " +
+                    std::to_string(end) + "]");
+        }
+        begin = start;
+    }
+
+    seqno_t getEnd() const {
+        return end;
+    }
+
+private:
+    seqno_t end;
+    seqno_t begin;
+};
+
 /**
  * SequenceList is the abstract base class for the classes that hold ordered
  * sequence of items in memory. To store/retreive items sequencially in memory,
@@ -71,8 +142,10 @@ protected:
      * (b) Iterator cannot be invalidated while in use.
      * (c) Reading all the items from the iterator results in point-in-time
      *     snapshot.
-     * (d) Only 1 iterator can be created for now.
-     * (e) Currently iterator can be created only from start till end
+     * (d) Whether more than one iterator can exist at a time depends on the
+     *     implementation (see the derived classes).
+     * (e) Iterator runs till the end of the list; it starts at the beginning
+     *     of the list or at the first item at or after a requested seqno.
      */
     class RangeIteratorImpl {
     public:
@@ -154,8 +227,10 @@ public:
      * Note: (a) Do not hold the iterator for long, as it will result in stale
      *           items in list and hence increased memory usage.
      *       (b) Make sure to delete the iterator after using it.
-     *       (c) For now, we allow on one RangeIterator. Try to create more
-     *           iterators will result in the create call(s) being blocked.
+     *       (c) BasicLinkedList allows only one RangeIterator at a time;
+     *           trying to create more iterators will result in the create
+     *           call(s) being blocked (or, for makeRangeIterator(start),
+     *           failing). SkipList allows any number of concurrent iterators.
      */
     class RangeIterator {
     public:
@@ -354,6 +429,12 @@ public:
      */
     virtual size_t getStaleMetadataBytes() const = 0;
 
+    /**
+     * Return the count of bytes of the list's own structures (any nodes
+     * allocated in addition to the OrderedStoredValues).
+     */
+    virtual size_t getNodeBytes() const = 0;
+
     /**
      * Returns the number of deleted items in the list.
      *
@@ -405,6 +486,24 @@ public:
      */
     virtual SequenceList::RangeIterator makeRangeIterator() = 0;
 
+    /**
+     * Returns a range iterator for the underlying SequenceList obj, positioned
+     * at the first item with seqno >= start. Items before start are not part
+     * of the iterator's snapshot (and hence can be updated / purged while it
+     * is in use).
+     *
+     * Unlike makeRangeIterator() this does not wait if the list cannot have
+     * another iterator at the moment; so that callers like a DCP backfill
+     * task can retry later instead of blocking their thread.
+     *
+     * @param start seqno to seek to
+     *
+     * @return the iterator; boost::none if the list cannot have another
+     *         iterator now
+     */
+    virtual boost::optional<SequenceList::RangeIterator> makeRangeIterator(
+            seqno_t start) = 0;
+
     /**
      * Debug - prints a representation of the list to stderr.
      */
@@ -70,6 +70,8 @@ int main(int, char **) {
 
     display("GIGANTOR", GIGANTOR);
     display("Stored Value", sizeof(StoredValue));
+    display("Stored Value key offset", StoredValue::getKeyOffset());
+    display("Ordered Stored Value", sizeof(OrderedStoredValue));
 
     display("Blob", sizeof(Blob));
     display("value_t", sizeof(value_t));
@@ -0,0 +1,662 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "skip_list.h"
+
+#include "stats.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <new>
+
+SkipList::Node::Node(OrderedStoredValue* osv, size_t height)
+    : osv(osv), height(height) {
+    std::fill_n(&next(0), height, nullptr);
+}
+
+SkipList::Node* SkipList::Node::create(OrderedStoredValue* osv,
+                                       size_t height) {
+    static_assert(alignof(Node*) <= alignof(Node),
+                  "SkipList::Node: links would be misaligned");
+    return new (::operator new(allocationSize(height))) Node(osv, height);
+}
+
+void SkipList::Node::destroy(Node* node) {
+    node->~Node();
+    ::operator delete(node);
+}
+
+SkipList::SkipList(uint16_t vbucketId, EPStats& st)
+    : SequenceList(),
+      head(Node::create(nullptr, maxLevel)),
+      height(1),
+      numNodes(0),
+      staleSize(0),
+      staleMetaDataSize(0),
+      nodeSize(Node::allocationSize(maxLevel)),
+      randomState(vbucketId + 1),
+      highSeqno(0),
+      highestDedupedSeqno(0),
+      highestPurgedDeletedSeqno(0),
+      numStaleItems(0),
+      numDeletedItems(0),
+      vbid(vbucketId),
+      st(st) {
+    tails.fill(head);
+    st.memOverhead->fetch_add(nodeSize);
+}
+
+SkipList::~SkipList() {
+    /* Delete stale items here, other items are deleted by the hash
+       table */
+    std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+    Node* node = head->next(0);
+    while (node) {
+        Node* next = node->next(0);
+        if (node->osv->isStale(writeGuard)) {
+            st.currentSize.fetch_sub(node->osv->metaDataSize());
+            StoredValue::UniquePtr stale(node->osv);
+        }
+        Node::destroy(node);
+        node = next;
+    }
+    Node::destroy(head);
+    st.memOverhead->fetch_sub(nodeSize);
+}
+
+seqno_t SkipList::seqnoOf(const Node* node) {
+    const seqno_t seqno = node->osv->getBySeqno();
+    return (seqno < 0) ? std::numeric_limits<seqno_t>::max() : seqno;
+}
+
+SkipList::Node* SkipList::findNode(std::lock_guard<std::mutex>& writeGuard,
+                                   seqno_t seqno,
+                                   NodeArray& preds) {
+    /* Start from the highest level and drop down a level each time the next
+       node on the current level is past the seqno */
+    Node* node = head;
+    for (size_t level = height; level-- > 0;) {
+        while (node->next(level) && (seqnoOf(node->next(level)) < seqno)) {
+            node = node->next(level);
+        }
+        preds[level] = node;
+    }
+    return node->next(0);
+}
+
+size_t SkipList::randomHeight() {
+    /* xorshift32 */
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    /* Each pair of zero bits promotes the node by one level */
+    uint32_t bits = randomState;
+    size_t nodeHeight = 1;
+    while ((nodeHeight < maxLevel) && ((bits & 0x3) == 0)) {
+        ++nodeHeight;
+        bits >>= 2;
+    }
+    return nodeHeight;
+}
+
+void SkipList::linkAtTail(std::lock_guard<std::mutex>& writeGuard,
+                          Node& node) {
+    for (size_t level = 0; level < node.height; ++level) {
+        node.next(level) = nullptr;
+        tails[level]->next(level) = &node;
+        tails[level] = &node;
+    }
+    height = std::max(height, node.height);
+    ++numNodes;
+}
+
+void SkipList::unlink(std::lock_guard<std::mutex>& writeGuard,
+                      Node& node,
+                      NodeArray& preds) {
+    for (size_t level = 0; level < node.height; ++level) {
+        preds[level]->next(level) = node.next(level);
+        if (tails[level] == &node) {
+            tails[level] = preds[level];
+        }
+    }
+    while ((height > 1) && !head->next(height - 1)) {
+        --height;
+    }
+    --numNodes;
+}
+
+bool SkipList::inReadRange(seqno_t seqno, const SeqRange* exclude) const {
+    for (const auto* range : readRanges) {
+        if ((range != exclude) && range->fallsInRange(seqno)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SkipList::unregisterReadRange(const SeqRange& range) {
+    auto it = std::find(readRanges.begin(), readRanges.end(), &range);
+    if (it != readRanges.end()) {
+        readRanges.erase(it);
+    }
+}
+
+void SkipList::appendToList(std::lock_guard<std::mutex>& seqLock,
+                            std::lock_guard<std::mutex>& writeLock,
+                            OrderedStoredValue& v) {
+    Node* node = Node::create(&v, randomHeight());
+    const size_t size = Node::allocationSize(node->height);
+    nodeSize.fetch_add(size);
+    st.memOverhead->fetch_add(size);
+    linkAtTail(writeLock, *node);
+}
+
+SequenceList::UpdateStatus SkipList::updateListElem(
+        std::lock_guard<std::mutex>& seqLock,
+        std::lock_guard<std::mutex>& writeLock,
+        OrderedStoredValue& v) {
+    {
+        /* Lock that needed for consistent read of 'readRanges' */
+        std::lock_guard<SpinLock> lh(rangeLock);
+
+        if (inReadRange(v.getBySeqno())) {
+            /* A range read is in middle of a point-in-time snapshot, hence we
+               cannot move the element to the end of the list. Return a temp
+               failure */
+            return UpdateStatus::Append;
+        }
+    }
+
+    /* Since there is no other reads or writes happenning in this range, we can
+       move the item to the end of the list */
+    NodeArray preds;
+    Node* node = findNode(writeLock, v.getBySeqno(), preds);
+    if (!node || (node->osv != &v)) {
+        throw std::logic_error(
+                "SkipList::updateListElem(): vb " + std::to_string(vbid) +
+                "; OrderedStoredValue with seqno " +
+                std::to_string(v.getBySeqno()) + " is not in the list");
+    }
+    unlink(writeLock, *node, preds);
+    linkAtTail(writeLock, *node);
+
+    return UpdateStatus::Success;
+}
+
+std::tuple<ENGINE_ERROR_CODE, std::vector<UniqueItemPtr>, seqno_t>
+SkipList::rangeRead(seqno_t start, seqno_t end) {
+    if ((start > end) || (start <= 0)) {
+        LOG(EXTENSION_LOG_WARNING,
+            "SkipList::rangeRead(): "
+            "(vb:%d) ERANGE: start %" PRIi64 " > end %" PRIi64,
+            vbid,
+            start,
+            end);
+        return std::make_tuple(ENGINE_ERANGE, std::vector<UniqueItemPtr>(), 0);
+    }
+
+    Node* node;
+    Node* last;
+    SeqRange range(0, 0);
+    {
+        std::lock_guard<std::mutex> listWriteLg(getListWriteLock());
+        std::lock_guard<SpinLock> lh(rangeLock);
+        if (start > highSeqno) {
+            LOG(EXTENSION_LOG_WARNING,
+                "SkipList::rangeRead(): "
+                "(vb:%d) ERANGE: start %" PRIi64 " > highSeqno %" PRIi64,
+                vbid,
+                start,
+                static_cast<seqno_t>(highSeqno));
+            /* If the request is for an invalid range, return before iterating
+               through the list */
+            return std::make_tuple(
+                    ENGINE_ERANGE, std::vector<UniqueItemPtr>(), 0);
+        }
+
+        end = std::min(end, static_cast<seqno_t>(highSeqno));
+        end = std::max(end, static_cast<seqno_t>(highestDedupedSeqno));
+
+        /* Seek to the first and the last element in the range; we must not
+           follow the links beyond the last element as they are not protected
+           by the range */
+        NodeArray preds;
+        node = findNode(listWriteLg, start, preds);
+        findNode(listWriteLg, end + 1, preds);
+        last = preds[0];
+        if (!node || (last == head) || (seqnoOf(node) > end)) {
+            return std::make_tuple(
+                    ENGINE_SUCCESS, std::vector<UniqueItemPtr>(), end);
+        }
+
+        /* Mark the read range */
+        range = SeqRange(seqnoOf(node), seqnoOf(last));
+        readRanges.push_back(&range);
+    }
+
+    /* Read items in the range */
+    std::vector<UniqueItemPtr> items;
+
+    while (true) {
+        /* Check if this OSV has been made stale and has been superseded by a
+         * newer version. If it has, and the replacement is /also/ in the range
+         * we are reading, we should skip this item to avoid duplicates */
+        StoredValue* replacement;
+        {
+            std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+            replacement = node->osv->getReplacementIfStale(writeGuard);
+        }
+
+        if (!replacement ||
+            replacement->toOrderedStoredValue()->getBySeqno() > end) {
+            try {
+                items.push_back(UniqueItemPtr(node->osv->toItem(false, vbid)));
+            } catch (const std::bad_alloc&) {
+                LOG(EXTENSION_LOG_WARNING,
+                    "SkipList::rangeRead(): "
+                    "(vb %d) ENOMEM while trying to copy "
+                    "item with seqno %" PRIi64 "before streaming it",
+                    vbid,
+                    node->osv->getBySeqno());
+                std::lock_guard<SpinLock> lh(rangeLock);
+                unregisterReadRange(range);
+                return std::make_tuple(
+                        ENGINE_ENOMEM, std::vector<UniqueItemPtr>(), 0);
+            }
+        }
+
+        if (node == last) {
+            break;
+        }
+        node = node->next(0);
+
+        /* As we move we reduce the range being read on the list */
+        std::lock_guard<SpinLock> lh(rangeLock);
+        range.setBegin(seqnoOf(node));
+    }
+
+    /* Done with range read, remove the range */
+    {
+        std::lock_guard<SpinLock> lh(rangeLock);
+        unregisterReadRange(range);
+    }
+
+    /* Return all the range read items */
+    return std::make_tuple(ENGINE_SUCCESS, std::move(items), end);
+}
+
+void SkipList::updateHighSeqno(std::lock_guard<std::mutex>& listWriteLg,
+                               const OrderedStoredValue& v) {
+    if (v.getBySeqno() < 1) {
+        throw std::invalid_argument("SkipList::updateHighSeqno(): vb " +
+                                    std::to_string(vbid) +
+                                    "; Cannot set the highSeqno to a value " +
+                                    std::to_string(v.getBySeqno()) +
+                                    " which is < 1");
+    }
+    highSeqno = v.getBySeqno();
+}
+
+void SkipList::updateHighestDedupedSeqno(
+        std::lock_guard<std::mutex>& listWriteLg, const OrderedStoredValue& v) {
+    if (v.getBySeqno() < 1) {
+        throw std::invalid_argument(
+                "SkipList::updateHighestDedupedSeqno(): vb " +
+                std::to_string(vbid) +
+                "; Cannot set the highestDedupedSeqno to "
+                "a value " +
+                std::to_string(v.getBySeqno()) + " which is < 1");
+    }
+    highestDedupedSeqno = v.getBySeqno();
+}
+
+void SkipList::markItemStale(std::lock_guard<std::mutex>& listWriteLg,
+                             StoredValue::UniquePtr ownedSv,
+                             StoredValue* newSv) {
+    /* Release the StoredValue as SkipList does not want it to be of owned
+       type */
+    StoredValue* v = ownedSv.release();
+
+    /* Update the stats tracking the memory owned by the list */
+    staleSize.fetch_add(v->size());
+    staleMetaDataSize.fetch_add(v->metaDataSize());
+    st.currentSize.fetch_add(v->metaDataSize());
+
+    ++numStaleItems;
+    v->toOrderedStoredValue()->markStale(listWriteLg, newSv);
+}
+
+size_t SkipList::purgeTombstones() {
+    // Purge items marked as stale from the list.
+    //
+    // Like BasicLinkedList::purgeTombstones() we want to avoid blocking
+    // front-end writes, so the writeLock is only held while looking at (and
+    // possibly unlinking) a single element. Unlike BasicLinkedList we do not
+    // need to stop range reads while purging: we register a range from the
+    // element being looked at till the end of the list (so that the element
+    // and the ones after it are not moved by updateListElem() while we don't
+    // hold the writeLock), and skip stale elements which are in the range of
+    // any reader.
+    std::unique_lock<std::mutex> purgeGuard(purgeLock, std::try_to_lock);
+    if (!purgeGuard) {
+        // Another purge is running.
+        return 0;
+    }
+
+    Node* node;
+    Node* last;
+    SeqRange purgeRange(0, 0);
+    {
+        std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+        if (numNodes == 0) {
+            // Nothing in sequence list - nothing to purge.
+            return 0;
+        }
+        node = head->next(0);
+        last = tails[0];
+        if ((node != last) && (last->osv->getBySeqno() < 0)) {
+            // The last element does not have a seqno yet (such an element is
+            // guaranteed to not be stale); don't consider it.
+            NodeArray preds;
+            findNode(writeGuard, seqnoOf(last), preds);
+            last = preds[0];
+        }
+        std::lock_guard<SpinLock> rangeGuard(rangeLock);
+        purgeRange = SeqRange(seqnoOf(node), seqnoOf(last));
+        readRanges.push_back(&purgeRange);
+    }
+
+    size_t purgedCount = 0;
+    while (node) {
+        Node* next = nullptr;
+        StoredValue::UniquePtr purged;
+        {
+            std::lock_guard<std::mutex> writeGuard(getListWriteLock());
+            if (node != last) {
+                next = node->next(0);
+            }
+
+            bool purge = false;
+            {
+                std::lock_guard<SpinLock> rangeGuard(rangeLock);
+                if (node->osv->isStale(writeGuard)) {
+                    purge = !inReadRange(seqnoOf(node), &purgeRange);
+                }
+                if (next) {
+                    purgeRange.setBegin(seqnoOf(next));
+                } else {
+                    unregisterReadRange(purgeRange);
+                }
+            }
+
+            if (purge) {
+                NodeArray preds;
+                findNode(writeGuard, seqnoOf(node), preds);
+                unlink(writeGuard, *node, preds);
+                purged.reset(node->osv);
+                const size_t size = Node::allocationSize(node->height);
+                nodeSize.fetch_sub(size);
+                st.memOverhead->fetch_sub(size);
+                Node::destroy(node);
+            }
+        }
+
+        if (purged) {
+            purgeListElem(std::move(purged));
+            ++purgedCount;
+        }
+        node = next;
+    }
+
+    return purgedCount;
+}
+
+void SkipList::purgeListElem(StoredValue::UniquePtr purged) {
+    /* Update the stats tracking the memory owned by the list */
+    staleSize.fetch_sub(purged->size());
+    staleMetaDataSize.fetch_sub(purged->metaDataSize());
+    st.currentSize.fetch_sub(purged->metaDataSize());
+
+    // Similary for the item counts:
+    --numStaleItems;
+    if (purged->isDeleted()) {
+        --numDeletedItems;
+        highestPurgedDeletedSeqno = std::max(seqno_t(highestPurgedDeletedSeqno),
+                                             purged->getBySeqno());
+    }
+}
+
+void SkipList::updateNumDeletedItems(bool oldDeleted, bool newDeleted) {
+    if (oldDeleted && !newDeleted) {
+        --numDeletedItems;
+    } else if (!oldDeleted && newDeleted) {
+        ++numDeletedItems;
+    }
+}
+
+uint64_t SkipList::getNumStaleItems() const {
+    return numStaleItems;
+}
+
+size_t SkipList::getStaleValueBytes() const {
+    return staleSize;
+}
+
+size_t SkipList::getStaleMetadataBytes() const {
+    return staleMetaDataSize;
+}
+
+size_t SkipList::getNodeBytes() const {
+    return nodeSize;
+}
+
+uint64_t SkipList::getNumDeletedItems() const {
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    return numDeletedItems;
+}
+
+uint64_t SkipList::getNumItems() const {
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    return numNodes;
+}
+
+uint64_t SkipList::getHighSeqno() const {
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    return highSeqno;
+}
+
+uint64_t SkipList::getHighestDedupedSeqno() const {
+    std::lock_guard<std::mutex> lckGd(getListWriteLock());
+    return highestDedupedSeqno;
+}
+
+seqno_t SkipList::getHighestPurgedDeletedSeqno() const {
+    return highestPurgedDeletedSeqno;
+}
+
+uint64_t SkipList::getRangeReadBegin() const {
+    std::lock_guard<SpinLock> lh(rangeLock);
+    seqno_t begin = 0;
+    for (const auto* range : readRanges) {
+        if ((begin == 0) || (range->getBegin() < begin)) {
+            begin = range->getBegin();
+        }
+    }
+    return begin;
+}
+
+uint64_t SkipList::getRangeReadEnd() const {
+    std::lock_guard<SpinLock> lh(rangeLock);
+    seqno_t end = 0;
+    for (const auto* range : readRanges) {
+        end = std::max(end, range->getEnd());
+    }
+    return end;
+}
+
+std::mutex& SkipList::getListWriteLock() const {
+    return writeLock;
+}
+
+SequenceList::RangeIterator SkipList::makeRangeIterator() {
+    return SequenceList::RangeIterator(
+            std::make_unique<RangeIteratorSL>(*this, 1));
+}
+
+boost::optional<SequenceList::RangeIterator> SkipList::makeRangeIterator(
+        seqno_t start) {
+    /* Any number of iterators can be created, hence never fails */
+    return SequenceList::RangeIterator(
+            std::make_unique<RangeIteratorSL>(*this, start));
+}
+
+void SkipList::dump() const {
+    std::cerr << *this << std::endl;
+}
+
+std::ostream& operator<<(std::ostream& os, const SkipList& sl) {
+    os << "SkipList[" << &sl << "] with numItems:" << sl.numNodes
+       << " height:" << sl.height << " deletedItems:" << sl.numDeletedItems
+       << " staleItems:" << sl.getNumStaleItems()
+       << " highPurgeSeqno:" << sl.getHighestPurgedDeletedSeqno()
+       << " elements:[" << std::endl;
+    size_t count = 0;
+    for (auto* node = sl.head->next(0); node; node = node->next(0)) {
+        os << "    " << *node->osv << std::endl;
+        ++count;
+    }
+    os << "] (count:" << count << ")";
+    return os;
+}
+
+SkipList::RangeIteratorSL::RangeIteratorSL(SkipList& sl, seqno_t start)
+    : list(sl),
+      currNode(nullptr),
+      readRange(0, 0),
+      itrRange(0, 0),
+      numRemaining(0),
+      earlySnapShotEndSeqno(0) {
+    std::lock_guard<std::mutex> listWriteLg(list.getListWriteLock());
+    if (list.highSeqno < 1) {
+        /* No items; iterator range is at default (0, 0) */
+        return;
+    }
+
+    /* The last element which can be read; skip an element which does not
+       have a seqno yet (see BasicLinkedList::purgeTombstones()) */
+    NodeArray preds;
+    Node* lastNode = list.tails[0];
+    if (lastNode->osv->getBySeqno() < 0) {
+        list.findNode(listWriteLg, seqnoOf(lastNode), preds);
+        lastNode = preds[0];
+    }
+
+    /* Seek to the first element to be read */
+    currNode = list.findNode(listWriteLg, start, preds);
+    if (!currNode || (lastNode == list.head) ||
+        (seqnoOf(currNode) > seqnoOf(lastNode))) {
+        /* All items are before start; iterator range is at default (0, 0) */
+        currNode = nullptr;
+        return;
+    }
+
+    const seqno_t first = seqnoOf(currNode);
+    const seqno_t last = seqnoOf(lastNode);
+
+    /* Number of items that can be iterated over */
+    numRemaining = (currNode == list.head->next(0))
+                           ? list.numNodes
+                           : std::min(uint64_t(list.numNodes),
+                                      uint64_t(last - first + 1));
+
+    /* The minimum seqno in the iterator that must be read to get a consistent
+       read snapshot */
+    earlySnapShotEndSeqno = list.highestDedupedSeqno;
+
+    /* Mark the snapshot range on the list. The range that can be read by the
+       iterator is inclusive of the start and the end. */
+    readRange = SeqRange(first, last);
+    {
+        std::lock_guard<SpinLock> lh(list.rangeLock);
+        list.readRanges.push_back(&readRange);
+    }
+
+    /* As in BasicLinkedList::RangeIteratorLL, the end of the iterator range
+       is one higher than the last seqno that can be read */
+    itrRange = SeqRange(first, last + 1);
+}
+
+SkipList::RangeIteratorSL::~RangeIteratorSL() {
+    std::lock_guard<SpinLock> lh(list.rangeLock);
+    list.unregisterReadRange(readRange);
+}
+
+OrderedStoredValue& SkipList::RangeIteratorSL::operator*() const {
+    if (curr() >= end()) {
+        /* We can't read beyond the range end */
+        throw std::out_of_range(
+                "SkipList::RangeIteratorSL::operator*()"
+                ": Trying to read beyond range end seqno " +
+                std::to_string(end()));
+    }
+    return *currNode->osv;
+}
+
+SkipList::RangeIteratorSL& SkipList::RangeIteratorSL::operator++() {
+    if (curr() >= end()) {
+        throw std::out_of_range(
+                "SkipList::RangeIteratorSL::operator++()"
+                ": Trying to move the iterator beyond range end"
+                " seqno " +
+                std::to_string(end()));
+    }
+
+    --numRemaining;
+
+    /* Check if the iterator is pointing to the last element. Increment beyond
+       the last element indicates the end of the iteration */
+    if (curr() == back()) {
+        /* Remove the range as soon as the iteration ends, so that clients
+           which hold on to the iterator obj do not restrict the list */
+        {
+            std::lock_guard<SpinLock> lh(list.rangeLock);
+            list.unregisterReadRange(readRange);
+        }
+
+        /* Update the begin to end() so the client can see that the iteration
+           has ended */
+        itrRange.setBegin(end());
+        return *this;
+    }
+
+    currNode = currNode->next(0);
+    {
+        /* As the iterator moves we reduce the snapshot range being read on the
+           list. This helps reduce the stale items in the list during heavy
+           update load from the front end */
+        std::lock_guard<SpinLock> lh(list.rangeLock);
+        readRange.setBegin(seqnoOf(currNode));
+    }
+
+    /* Also update the current range stored in the iterator obj */
+    itrRange.setBegin(seqnoOf(currNode));
+
+    return *this;
+}
@@ -0,0 +1,388 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/**
+ * This header file contains the class definition of the skip list
+ * implementation of the abstract class SequenceList
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include "atomic.h"
+#include "monotonic.h"
+#include "seqlist.h"
+#include "stored-value.h"
+
+#include <platform/non_negative_counter.h>
+#include <relaxed_atomic.h>
+
+#include <array>
+#include <vector>
+
+/**
+ * This class implements SequenceList as a skip list ordered by seqno.
+ *
+ * Unlike BasicLinkedList the list elements are (non-intrusive) nodes which
+ * point to the OrderedStoredValues; the OrderedStoredValue is shared between
+ * the HashTable and the SkipList with the same ownership rules as described
+ * in BasicLinkedList.
+ *
+ * Level 0 of the skip list links all the elements in seqno order; each
+ * element is also linked on a random number of higher levels (each level
+ * with 1/4 of the elements of the level below), which allows seeking to a
+ * seqno in O(log n). Elements are only ever appended at the end, or moved
+ * to the end when they are updated, hence the list remains sorted by seqno.
+ *
+ * Range reads:
+ * ============
+ * Any number of range reads (rangeRead() and RangeIterators) can run
+ * concurrently. Each of them registers the range of seqnos it is reading in
+ * 'readRanges'; elements which fall in any registered range are not moved
+ * (updateListElem() returns UpdateStatus::Append) or purged. Readers only
+ * follow the level 0 links between elements in their range, which are not
+ * modified while the range is registered, and hence iterate the list without
+ * taking the writeLock. As in BasicLinkedList the registered range of an
+ * iterator shrinks as it advances.
+ *
+ * purgeTombstones() registers its own range too (so that the element it is
+ * looking at does not move under it), and simply skips stale elements which
+ * fall in the range of a reader; they are purged by a subsequent run.
+ *
+ * Ordering/Hierarchy of Locks:
+ * ===========================
+ * purgeLock ==> writeLock ==> rangeLock is the valid lock hierarchy.
+ *
+ * 'writeLock' and 'rangeLock' are held for short durations, typically for
+ * single list element writes and reads (or a seek). 'purgeLock' is held for
+ * the duration of a purgeTombstones() run.
+ */
+class SkipList : public SequenceList {
+public:
+    SkipList(uint16_t vbucketId, EPStats& st);
+
+    ~SkipList();
+
+    void appendToList(std::lock_guard<std::mutex>& seqLock,
+                      std::lock_guard<std::mutex>& writeLock,
+                      OrderedStoredValue& v) override;
+
+    SequenceList::UpdateStatus updateListElem(
+            std::lock_guard<std::mutex>& seqLock,
+            std::lock_guard<std::mutex>& writeLock,
+            OrderedStoredValue& v) override;
+
+    std::tuple<ENGINE_ERROR_CODE, std::vector<UniqueItemPtr>, seqno_t>
+    rangeRead(seqno_t start, seqno_t end) override;
+
+    void updateHighSeqno(std::lock_guard<std::mutex>& listWriteLg,
+                         const OrderedStoredValue& v) override;
+
+    void updateHighestDedupedSeqno(std::lock_guard<std::mutex>& listWriteLg,
+                                   const OrderedStoredValue& v) override;
+
+    void markItemStale(std::lock_guard<std::mutex>& listWriteLg,
+                       StoredValue::UniquePtr ownedSv,
+                       StoredValue* newSv) override;
+
+    size_t purgeTombstones() override;
+
+    void updateNumDeletedItems(bool oldDeleted, bool newDeleted) override;
+
+    uint64_t getNumStaleItems() const override;
+
+    size_t getStaleValueBytes() const override;
+
+    size_t getStaleMetadataBytes() const override;
+
+    size_t getNodeBytes() const override;
+
+    uint64_t getNumDeletedItems() const override;
+
+    uint64_t getNumItems() const override;
+
+    uint64_t getHighSeqno() const override;
+
+    uint64_t getHighestDedupedSeqno() const override;
+
+    seqno_t getHighestPurgedDeletedSeqno() const override;
+
+    /**
+     * Returns the lowest begin of all the range reads in progress.
+     */
+    uint64_t getRangeReadBegin() const override;
+
+    /**
+     * Returns the highest end of all the range reads in progress.
+     */
+    uint64_t getRangeReadEnd() const override;
+
+    std::mutex& getListWriteLock() const override;
+
+    SequenceList::RangeIterator makeRangeIterator() override;
+
+    boost::optional<SequenceList::RangeIterator> makeRangeIterator(
+            seqno_t start) override;
+
+    void dump() const override;
+
+protected:
+    /* Maximum number of levels; with a promotion probability of 1/4 this is
+       enough for 2^32 elements */
+    static const size_t maxLevel = 16;
+
+    /**
+     * A list element. The node and its links (one for each level it is
+     * linked on) are a single allocation of allocationSize(height) bytes;
+     * nodes are made by create() and freed by destroy().
+     */
+    struct Node {
+        static Node* create(OrderedStoredValue* osv, size_t height);
+
+        static void destroy(Node* node);
+
+        static size_t allocationSize(size_t height) {
+            return sizeof(Node) + height * sizeof(Node*);
+        }
+
+        /* Next node on the given level (which must be < height) */
+        Node*& next(size_t level) {
+            return reinterpret_cast<Node**>(this + 1)[level];
+        }
+
+        Node* next(size_t level) const {
+            return reinterpret_cast<Node* const*>(this + 1)[level];
+        }
+
+        /* The list element; nullptr only for the head */
+        OrderedStoredValue* osv;
+
+        /* Number of levels the node is linked on */
+        const size_t height;
+
+    private:
+        Node(OrderedStoredValue* osv, size_t height);
+    };
+
+    using NodeArray = std::array<Node*, maxLevel>;
+
+    /**
+     * Returns the seqno of the element held by the node. The last element may
+     * not yet have a seqno (see BasicLinkedList::purgeTombstones()); it is
+     * treated as the highest seqno.
+     */
+    static seqno_t seqnoOf(const Node* node);
+
+    /**
+     * Finds the first node with a seqno >= the given seqno.
+     *
+     * @param writeGuard The locked writeLock
+     * @param seqno seqno to seek to
+     * @param preds Set to the last node before the found node on each level
+     *
+     * @return the found node; nullptr if all nodes are < seqno
+     */
+    Node* findNode(std::lock_guard<std::mutex>& writeGuard,
+                   seqno_t seqno,
+                   NodeArray& preds);
+
+    /* Head of the list; linked on all the levels */
+    Node* head;
+
+    /* Last node on each level (head if a level is empty) */
+    NodeArray tails;
+
+    /* Number of levels that have any nodes (at least 1) */
+    size_t height;
+
+    /* Number of elements in the list */
+    size_t numNodes;
+
+    /**
+     * Lock that serializes writes (append, update, purgeTombstones) on the
+     * list + the updation of the corresponding highSeqno or the
+     * highestDedupedSeqno atomic
+     */
+    mutable std::mutex writeLock;
+
+    /**
+     * Ranges of the range reads (and of the purge) in progress. Elements in
+     * any of the ranges must not be moved or purged.
+     */
+    std::vector<const SeqRange*> readRanges;
+
+    /**
+     * Lock that protects readRanges (and the ranges in it).
+     * We use spinlock here since the lock is held only for very small time
+     * periods.
+     */
+    mutable SpinLock rangeLock;
+
+    /* Serializes purgeTombstones() runs */
+    std::mutex purgeLock;
+
+    /* Overall memory consumed by (stale) OrderedStoredValues owned by the
+       list */
+    Couchbase::RelaxedAtomic<size_t> staleSize;
+
+    /* Metadata memory consumed by (stale) OrderedStoredValues owned by the
+       list */
+    Couchbase::RelaxedAtomic<size_t> staleMetaDataSize;
+
+    /* Memory consumed by the nodes (including the head) */
+    Couchbase::RelaxedAtomic<size_t> nodeSize;
+
+private:
+    /**
+     * Returns the number of levels for a new node: 1, and one more with
+     * probability 1/4 for every level above. Guarded by writeLock.
+     */
+    size_t randomHeight();
+
+    /* Links the node at the end of the list on all its levels */
+    void linkAtTail(std::lock_guard<std::mutex>& writeGuard, Node& node);
+
+    /* Unlinks the node from all its levels; preds as found by findNode() */
+    void unlink(std::lock_guard<std::mutex>& writeGuard,
+                Node& node,
+                NodeArray& preds);
+
+    /* Returns true if the seqno falls in any range except 'exclude'.
+       rangeLock must be held */
+    bool inReadRange(seqno_t seqno, const SeqRange* exclude = nullptr) const;
+
+    /* Removes the range from readRanges. rangeLock must be held */
+    void unregisterReadRange(const SeqRange& range);
+
+    /* Updates the stats for a stale element that has been unlinked from the
+       list and deletes it */
+    void purgeListElem(StoredValue::UniquePtr purged);
+
+    /* State of the (xorshift) random number generator for randomHeight() */
+    uint32_t randomState;
+
+    /**
+     * We need to keep track of the highest seqno separately because there is a
+     * small window wherein the last element of the list (though in correct
+     * order) does not have a seqno.
+     *
+     * highseqno is monotonically increasing and is reset to a lower value
+     * only in case of a rollback.
+     *
+     * Guarded by writeLock.
+     */
+    Monotonic<seqno_t> highSeqno;
+
+    /**
+     * We need to this to send out point-in-time snapshots in range read
+     *
+     * highestDedupedSeqno is monotonically increasing and is reset to a lower
+     * value only in case of a rollback.
+     */
+    Monotonic<seqno_t> highestDedupedSeqno;
+
+    /**
+     * The sequence number of the highest purged element.
+     *
+     * This should be non-decrementing, apart from a rollback where it will be
+     * reset.
+     */
+    Monotonic<seqno_t> highestPurgedDeletedSeqno;
+
+    /**
+     * Indicates the number of elements in the list that are stale (old,
+     * duplicate values). Stale items are owned by the list and hence must
+     * periodically clean them up.
+     */
+    cb::NonNegativeCounter<uint64_t> numStaleItems;
+
+    /**
+     * Indicates the number of logically deleted items in the list.
+     */
+    cb::NonNegativeCounter<uint64_t> numDeletedItems;
+
+    /* Used only to log debug messages */
+    const uint16_t vbid;
+
+    /* Ep engine stats handle to track stats */
+    EPStats& st;
+
+    friend std::ostream& operator<<(std::ostream& os, const SkipList& sl);
+
+    class RangeIteratorSL : public SequenceList::RangeIteratorImpl {
+    public:
+        RangeIteratorSL(SkipList& sl, seqno_t start);
+
+        ~RangeIteratorSL();
+
+        OrderedStoredValue& operator*() const override;
+
+        RangeIteratorSL& operator++() override;
+
+        seqno_t curr() const override {
+            return itrRange.getBegin();
+        }
+
+        seqno_t end() const override {
+            return itrRange.getEnd();
+        }
+
+        seqno_t back() const override {
+            return itrRange.getEnd() - 1;
+        }
+
+        /**
+         * Unless the iterator started at the beginning of the list this is an
+         * upper bound, as the list does not track the position of its
+         * elements.
+         */
+        uint64_t count() const override {
+            return numRemaining;
+        }
+
+        seqno_t getEarlySnapShotEnd() const override {
+            return earlySnapShotEndSeqno;
+        }
+
+    private:
+        /* Ref to SkipList object which is iterated by this iterator */
+        SkipList& list;
+
+        /* The current node pointed by the iterator */
+        Node* currNode;
+
+        /* Range registered on the list; reset once the iteration ends */
+        SeqRange readRange;
+
+        /* Current range of the iterator (end is one past the last seqno) */
+        SeqRange itrRange;
+
+        /* Number of items that can be iterated over by this (forward only)
+           iterator at that instance */
+        uint64_t numRemaining;
+
+        /* Indicates the minimum seqno in the iterator that can give a
+           consistent read snapshot */
+        seqno_t earlySnapShotEndSeqno;
+    };
+
+    friend class RangeIteratorSL;
+};
+
+/// Outputs a textual description of the SkipList
+std::ostream& operator<<(std::ostream& os, const SkipList& sl);
@@ -17,54 +17,119 @@
 
 #include "stats.h"
 
-void EPStats::memAllocated(size_t sz) {
-    if (isShutdown) {
-        return;
-    }
+#include <algorithm>
 
-    if (localMemCounter.get() == nullptr) {
-        // this HAS to be a non-bucket allocation
-        // or else the callbacks would try to call this
-        // function again & it would become an infinite loop
-        SystemAllocationGuard system_alloc_guard;
-        localMemCounter.set(new TLMemCounter());
-    }
+constexpr double EPStats::memUsedMaxErrorRatio;
 
-    if (0 == sz) {
+void EPStats::memAllocated(size_t sz) {
+    if (isShutdown || 0 == sz) {
         return;
     }
-
-    localMemCounter.get()->used += sz;
-    mergeMemCounter();
+    updateMemUsed(sz);
 }
 
 void EPStats::memDeallocated(size_t sz) {
-    if (isShutdown) {
+    if (isShutdown || 0 == sz) {
         return;
     }
+    updateMemUsed(-static_cast<long long>(sz));
+}
 
-    if (localMemCounter.get() == nullptr) {
+EPStats::TLMemCounter& EPStats::getLocalMemCounter() {
+    auto* counter = localMemCounter.get();
+    if (counter == nullptr) {
         // this HAS to be a non-bucket allocation
         // or else the callbacks would try to call this
         // function again & it would become an infinite loop
         SystemAllocationGuard system_alloc_guard;
-        localMemCounter.set(new TLMemCounter());
+        std::lock_guard<std::mutex> lh(memCountersMutex);
+        memCounters.emplace_back(std::make_unique<TLMemCounter>(*this));
+        counter = memCounters.back().get();
+        localMemCounter.set(counter);
+        updateMemMergeThreshold(lh);
     }
+    return *counter;
+}
 
-    if (0 == sz) {
+void EPStats::updateMemUsed(long long delta) {
+    auto& counter = getLocalMemCounter();
+    // Only this thread modifies the counter, so a (relaxed) load and store
+    // is sufficient - no locked RMW on the allocation path. The shared
+    // totalMemory is only touched once the counter has accumulated
+    // memMergeThreshold bytes, which bounds what all the counters together
+    // may hold back from it (see getMemUsedMaxError()).
+    const auto used = counter.used.load(std::memory_order_relaxed) + delta;
+    if (std::abs(used) >=
+        (long long)memMergeThreshold.load(std::memory_order_relaxed)) {
+        counter.used.store(0, std::memory_order_relaxed);
+        totalMemory->fetch_add(used);
+    } else {
+        counter.used.store(used, std::memory_order_relaxed);
+    }
+}
+
+void EPStats::releaseMemCounter(void* ptr) {
+    if (ptr == nullptr) {
         return;
     }
+    // This HAS to be a non-bucket deallocation or else the callbacks could
+    // try to update the counter being deleted
+    SystemAllocationGuard system_alloc_guard;
+    auto* counter = static_cast<TLMemCounter*>(ptr);
+    auto& stats = counter->stats;
+    std::lock_guard<std::mutex> lh(stats.memCountersMutex);
+    // Don't lose what the exiting thread had not yet merged.
+    stats.totalMemory->fetch_add(
+            counter->used.load(std::memory_order_relaxed));
+    stats.memCounters.erase(
+            std::find_if(stats.memCounters.begin(),
+                         stats.memCounters.end(),
+                         [counter](const std::unique_ptr<TLMemCounter>& c) {
+                             return c.get() == counter;
+                         }));
+    stats.updateMemMergeThreshold(lh);
+}
+
+void EPStats::updateMemMergeThreshold(const std::lock_guard<std::mutex>& lh) {
+    // Share the error allowed for the whole bucket equally between the
+    // threads. A threshold of 0 merges every change.
+    const double maxError = maxDataSize.load() * memUsedMaxErrorRatio;
+    const double share = maxError / std::max(size_t(1), memCounters.size());
+    memMergeThreshold.store(
+            static_cast<size_t>(std::min(
+                    share, static_cast<double>(mem_merge_bytes_threshold))));
+}
+
+void EPStats::setMaxDataSize(size_t size) {
+    if (size > 0) {
+        maxDataSize.store(size);
+        std::lock_guard<std::mutex> lh(memCountersMutex);
+        updateMemMergeThreshold(lh);
+    }
+}
+
+void EPStats::setMemMergeBytesThreshold(size_t threshold) {
+    std::lock_guard<std::mutex> lh(memCountersMutex);
+    mem_merge_bytes_threshold = threshold;
+    updateMemMergeThreshold(lh);
+}
 
-    localMemCounter.get()->used -= sz;
-    mergeMemCounter();
+size_t EPStats::getMemUsedMaxError() {
+    std::lock_guard<std::mutex> lh(memCountersMutex);
+    return memMergeThreshold.load() * std::max(size_t(1), memCounters.size());
 }
 
-void EPStats::mergeMemCounter(bool force) {
-    auto& counter = *(localMemCounter.get());
-    counter.count++;
-    if (force || counter.count % mem_merge_count_threshold == 0 ||
-        std::abs(counter.used) > (long)mem_merge_bytes_threshold) {
-        totalMemory->fetch_add(counter.used);
-        counter.used = 0;
+size_t EPStats::getPreciseTotalMemoryUsed() {
+    if (!memoryTrackerEnabled.load()) {
+        return getTotalMemoryUsed();
+    }
+    long long val;
+    {
+        std::lock_guard<std::mutex> lh(memCountersMutex);
+        val = totalMemory->load();
+        for (const auto& counter : memCounters) {
+            val += counter->used.load(std::memory_order_relaxed);
+        }
     }
-}
\ No newline at end of file
+    return val >= 0 ? val : 0;
+}
@@ -23,6 +23,9 @@
 #include <memcached/engine.h>
 
 #include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <platform/cacheline_padded.h>
 #include <platform/histogram.h>
@@ -98,6 +101,7 @@ public:
         cursorsDropped(0),
         pagerRuns(0),
         expiryPagerRuns(0),
+        expiryPagerItemsVisited(0),
         itemsRemovedFromCheckpoints(0),
         numValueEjects(0),
         numFailedEjects(0),
@@ -135,6 +139,9 @@ public:
         bgMaxLoad(0),
         vbucketDelMaxWalltime(0),
         vbucketDelTotWalltime(0),
+        dcpCompressionCacheHits(0),
+        dcpCompressionCacheMisses(0),
+        dcpCompressionSavedBytes(0),
         numTapFetched(0),
         numTapBGFetched(0),
         numTapBGFetchRequeued(0),
@@ -173,19 +180,13 @@ public:
         defragNumMoved(0),
         dirtyAgeHisto(GrowingWidthGenerator<hrtime_t>(0, ONE_SECOND, 1.4), 25),
         diskCommitHisto(GrowingWidthGenerator<hrtime_t>(0, ONE_SECOND, 1.4), 25),
+        flusherCommitItemsHisto(ExponentialGenerator<size_t>(1, 2), 25),
+        flusherCommitVBucketsHisto(ExponentialGenerator<size_t>(1, 2), 11),
         mlogCompactorHisto(GrowingWidthGenerator<hrtime_t>(0, ONE_SECOND, 1.4), 25),
         timingLog(NULL),
-        mem_merge_count_threshold(1),
         mem_merge_bytes_threshold(0),
-        localMemCounter([](void* ptr) -> void {
-                if (ptr != nullptr) {
-                    // This HAS to be a non-bucket deallocation
-                    // or else the callbacks could try to update counters
-                    // that no longer exist
-                    SystemAllocationGuard system_alloc_guard;
-                    delete (TLMemCounter*)ptr;
-                }
-            }),
+        memMergeThreshold(0),
+        localMemCounter(releaseMemCounter),
         maxDataSize(DEFAULT_MAX_DATA_SIZE) {}
 
     ~EPStats() {
@@ -196,12 +197,15 @@ public:
         return maxDataSize.load();
     }
 
-    void setMaxDataSize(size_t size) {
-        if (size > 0) {
-            maxDataSize.store(size);
-        }
-    }
+    void setMaxDataSize(size_t size);
 
+    /**
+     * Memory used by this bucket. Cheap (a single load) but, when memory
+     * tracking is enabled, may differ from the exact figure by the changes
+     * not yet merged in from the thread-local counters. That difference is
+     * bounded by getMemUsedMaxError().
+     * Suitable for quota checks on the front-end path.
+     */
     size_t getTotalMemoryUsed() {
         if (memoryTrackerEnabled.load()) {
             auto val = totalMemory->load();
@@ -210,18 +214,41 @@ public:
         return currentSize.load() + memOverhead->load();
     }
 
+    /**
+     * Exact memory used by this bucket, including changes still held in the
+     * thread-local counters. Reads every thread's counter, so should only be
+     * used where precision matters more than cost (e.g. stats).
+     */
+    size_t getPreciseTotalMemoryUsed();
+
+    /**
+     * Bound on the difference between getTotalMemoryUsed() and
+     * getPreciseTotalMemoryUsed(): memUsedMaxErrorRatio of the quota, or
+     * mem_merge_bytes_threshold per thread if that is smaller.
+     *
+     * A thread's counter is held to the (per-thread share of the) bound on
+     * each of its updates; when more threads start accounting memory the
+     * counters of the existing threads are brought within their new share
+     * on their next update.
+     */
+    size_t getMemUsedMaxError();
+
+    /// Sets the largest amount a thread may accumulate before merging.
+    void setMemMergeBytesThreshold(size_t threshold);
+
+    /**
+     * Largest difference between getTotalMemoryUsed() and the exact memory
+     * used, as a fraction of the quota, over all threads. Keeps the quota
+     * checks (hasAvailableSpace) and the item pager within a fixed margin.
+     */
+    static constexpr double memUsedMaxErrorRatio = 0.01;
+
     // account for allocated mem
     void memAllocated(size_t sz);
 
     // account for deallocated mem
     void memDeallocated(size_t sz);
 
-    // merge accumulated local memory to the bucket variable
-    // the boolean force, if set to true, will skip checking
-    // threshold constraints and merge the local counters
-    // immediately
-    void mergeMemCounter(bool force = false);
-
     //! Number of keys warmed up during key-only loading.
     Counter warmedUpKeys;
     //! Number of key-values warmed up during data loading.
@@ -314,6 +341,8 @@ public:
     Counter pagerRuns;
     //! Number of times the expiry pager runs for purging expired items
     Counter expiryPagerRuns;
+    //! Number of items the expiry pager has visited (checked for expiry)
+    Counter expiryPagerItemsVisited;
     //! Number of items removed from closed unreferenced checkpoints.
     Counter itemsRemovedFromCheckpoints;
     //! Number of times a value is ejected
@@ -421,6 +450,20 @@ public:
     Histogram<hrtime_t> itemPagerHisto;
     //! Histogram of expiry pager run times
     Histogram<hrtime_t> expiryPagerHisto;
+    //! Histogram of incremental HashTable resize step run times
+    Histogram<hrtime_t> htResizeStepHisto;
+    //! Histogram of time front-end ops waited for a HashTable bucket lock
+    //! while a resize was in progress
+    Histogram<hrtime_t> htResizeLockWaitHisto;
+
+    /* DCP value compression stats */
+    //! Number of values DCP producers sent compressed using a value another
+    //! producer had already compressed
+    Counter dcpCompressionCacheHits;
+    //! Number of values DCP producers had to compress themselves
+    Counter dcpCompressionCacheMisses;
+    //! Total bytes saved by the values DCP producers sent compressed
+    Counter dcpCompressionSavedBytes;
 
     /* TAP related stats */
     //! The total number of tap events sent (not including noops)
@@ -583,6 +626,10 @@ public:
     //! Histogram of disk commits
     Histogram<hrtime_t> diskCommitHisto;
 
+    //! Histograms of the number of items and vbuckets in each flusher commit
+    Histogram<size_t> flusherCommitItemsHisto;
+    Histogram<size_t> flusherCommitVBucketsHisto;
+
     //! Histogram of mutation log compactor
     Histogram<hrtime_t> mlogCompactorHisto;
 
@@ -635,6 +682,9 @@ public:
         pendingOpsTotal.store(0);
         pendingOpsMax.store(0);
         pendingOpsMaxDuration.store(0);
+        dcpCompressionCacheHits.store(0);
+        dcpCompressionCacheMisses.store(0);
+        dcpCompressionSavedBytes.store(0);
         numTapFetched.store(0);
         vbucketDelMaxWalltime.store(0);
         vbucketDelTotWalltime.store(0);
@@ -653,6 +703,8 @@ public:
         checkpointRemoverHisto.reset();
         itemPagerHisto.reset();
         expiryPagerHisto.reset();
+        htResizeStepHisto.reset();
+        htResizeLockWaitHisto.reset();
         tapBgWaitHisto.reset();
         tapBgLoadHisto.reset();
         getVbucketCmdHisto.reset();
@@ -672,6 +724,8 @@ public:
         diskDelHisto.reset();
         diskVBDelHisto.reset();
         diskCommitHisto.reset();
+        flusherCommitItemsHisto.reset();
+        flusherCommitVBucketsHisto.reset();
         itemAllocSizeHisto.reset();
         dirtyAgeHisto.reset();
         mlogCompactorHisto.reset();
@@ -683,20 +737,52 @@ public:
     // Used by stats logging infrastructure.
     std::ostream *timingLog;
 
-    //! These 2 thresholds define when the thread local
-    //  mem counters are merged to the bucket counter
-    size_t mem_merge_count_threshold;
-    size_t mem_merge_bytes_threshold;
-
 private:
+    /**
+     * Memory allocated / deallocated by one thread, not yet merged into
+     * totalMemory.
+     */
     struct TLMemCounter {
-        // accumulated mem
-        long long used = 0;
+        TLMemCounter(EPStats& stats) : stats(stats) {
+        }
 
-        // no.of times mem accounting has happened
-        size_t count = 0;
+        // accumulated mem. Only modified by the owning thread; atomic so
+        // that getPreciseTotalMemoryUsed() can read it from other threads.
+        std::atomic<long long> used{0};
+
+        EPStats& stats;
     };
 
+    TLMemCounter& getLocalMemCounter();
+
+    void updateMemUsed(long long delta);
+
+    // Thread exit callback for localMemCounter; merges the counter into
+    // totalMemory and frees it.
+    static void releaseMemCounter(void* ptr);
+
+    // Recalculate memMergeThreshold from the quota, the number of counters
+    // and mem_merge_bytes_threshold.
+    void updateMemMergeThreshold(const std::lock_guard<std::mutex>& lh);
+
+    //! Configured upper limit on what a thread may accumulate before it is
+    //! merged into totalMemory.
+    size_t mem_merge_bytes_threshold;
+
+    //! Per-thread merge threshold in use: mem_merge_bytes_threshold, lowered
+    //! so that the counters of all threads together stay within
+    //! memUsedMaxErrorRatio of the quota. Guarded by memCountersMutex for
+    //! writes.
+    std::atomic<size_t> memMergeThreshold;
+
+    //! Counters of all the threads which have accounted memory to this
+    //! bucket. Only locked when a thread first accounts memory / exits, and
+    //! by getPreciseTotalMemoryUsed().
+    std::mutex memCountersMutex;
+    std::vector<std::unique_ptr<TLMemCounter>> memCounters;
+
+    //! Must be declared after memCounters; deleting the key first ensures no
+    //! thread exit callback can run on a destroyed counter.
     ThreadLocalPtr<TLMemCounter> localMemCounter;
 
     //! Max allowable memory size.
@@ -31,6 +31,28 @@ const int64_t StoredValue::state_deleted_key = -3;
 const int64_t StoredValue::state_non_existent_key = -4;
 const int64_t StoredValue::state_temp_init = -5;
 const int64_t StoredValue::state_collection_open = -6;
+const uint8_t StoredValue::initialFreqCount;
+
+#if defined(__GNUC__)
+namespace {
+// The key of a StoredValue lives in the tail padding directly after its
+// last member, 'stale' (see getKeyOffset()). A member of a derived class is
+// laid out straight after the last member of its (non-POD) base, so the
+// offset of 'sentinel' is where StoredValue's own data ends. If a member is
+// ever added after 'stale' the key would overlap it; this catches that.
+struct StoredValueEndSentinel : public StoredValue {
+    uint8_t sentinel;
+};
+} // anonymous namespace
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+static_assert(offsetof(StoredValueEndSentinel, sentinel) ==
+                      StoredValue::getKeyOffset(),
+              "StoredValue: 'stale' must be the last member, as the key is "
+              "stored immediately after it");
+#pragma GCC diagnostic pop
+#endif
 
 StoredValue::StoredValue(const Item& itm,
                          UniquePtr n,
@@ -40,16 +62,21 @@ StoredValue::StoredValue(const Item& itm,
       chain_next_or_replacement(std::move(n)),
       cas(itm.getCas()),
       revSeqno(itm.getRevSeqno()),
-      bySeqno(itm.getBySeqno()),
       lock_expiry_or_delete_time(0),
       exptime(itm.getExptime()),
       flags(itm.getFlags()),
+      bySeqno(itm.getBySeqno()),
       datatype(itm.getDataType()),
       deleted(itm.isDeleted()),
       newCacheItem(true),
       isOrdered(isOrdered),
       nru(itm.getNRUValue()),
+      freqCounter(initialFreqCount),
       stale(false) {
+    static_assert(
+            getKeyOffset() == offsetof(StoredValue, stale) + sizeof(stale),
+            "StoredValue: the key must start directly after 'stale'");
+
     // Placement-new the key which lives in memory directly after this
     // object.
     new (key()) SerialisedDocKey(itm.getKey());
@@ -78,16 +105,17 @@ StoredValue::StoredValue(const StoredValue& other,
       chain_next_or_replacement(std::move(n)),
       cas(other.cas),
       revSeqno(other.revSeqno),
-      bySeqno(other.bySeqno),
       lock_expiry_or_delete_time(other.lock_expiry_or_delete_time),
       exptime(other.exptime),
       flags(other.flags),
+      bySeqno(other.bySeqno),
       datatype(other.datatype),
       _isDirty(other._isDirty),
       deleted(other.deleted),
       newCacheItem(other.newCacheItem),
       isOrdered(other.isOrdered),
       nru(other.nru),
+      freqCounter(other.freqCounter),
       stale(false) {
     // Placement-new the key which lives in memory directly after this
     // object.
@@ -142,6 +170,7 @@ void StoredValue::restoreValue(const Item& itm) {
         revSeqno = itm.getRevSeqno();
         bySeqno = itm.getBySeqno();
         nru = INITIAL_NRU_VALUE;
+        freqCounter = initialFreqCount;
     }
     datatype = itm.getDataType();
     deleted = itm.isDeleted();
@@ -187,7 +216,7 @@ void StoredValue::setMutationMemoryThreshold(double memThreshold) {
 bool StoredValue::hasAvailableSpace(EPStats &st, const Item &itm,
                                     bool isReplication) {
     double newSize = static_cast<double>(st.getTotalMemoryUsed() +
-                                         sizeof(StoredValue) + itm.getKey().size());
+                                         getKeyOffset() + itm.getKey().size());
     double maxSize = static_cast<double>(st.getMaxDataSize());
     if (isReplication) {
         return newSize <= (maxSize * st.replicationThrottleThreshold);
@@ -197,8 +226,9 @@ bool StoredValue::hasAvailableSpace(EPStats &st, const Item &itm,
 }
 
 size_t StoredValue::getRequiredStorage(const Item& item) {
-    return sizeof(StoredValue) +
-           SerialisedDocKey::getObjectSize(item.getKey().size());
+    return std::max(sizeof(StoredValue),
+                    getKeyOffset() + SerialisedDocKey::getObjectSize(
+                                             item.getKey().size()));
 }
 
 std::unique_ptr<Item> StoredValue::toItem(bool lck, uint16_t vbucket) const {
@@ -208,7 +238,7 @@ std::unique_ptr<Item> StoredValue::toItem(bool lck, uint16_t vbucket) const {
                                    getExptime(),
                                    value,
                                    lck ? static_cast<uint64_t>(-1) : getCas(),
-                                   bySeqno,
+                                   getBySeqno(),
                                    vbucket,
                                    getRevSeqno());
 
@@ -21,11 +21,15 @@
 
 #include "blob.h"
 #include "item_pager.h"
+#include "packed_integer.h"
 #include "storeddockey.h"
 #include "utility.h"
 
 #include <boost/intrusive/list.hpp>
 
+#include <algorithm>
+#include <cstddef>
+
 class Item;
 class OrderedStoredValue;
 
@@ -44,9 +48,12 @@ class OrderedStoredValue;
  * chaining of StoredValues which hash to the same hash bucket.
  *
  * The key of the item is of variable length (from 1 to ~256 bytes). As an
- * optimization, we allocate the key directly after the fixed size of
- * StoredValue, so StoredValue and its key are contiguous in memory. This saves
- * us the cost of an indirection compared to storing the key out-of-line, and
+ * optimization, we allocate the key directly after the last fixed field of
+ * StoredValue, so StoredValue and its key are contiguous in memory. The key
+ * starts inside what would otherwise be the tail padding of the object (see
+ * getKeyOffset()), so short keys cost little more than the fixed fields.
+ * This saves us the cost of an indirection compared to storing the key
+ * out-of-line, and
  * the space of a pointer in StoredValue to point to the out-of-line
  * allocation. It does, however complicate the management of StoredValue
  * objects as they are now variable-sized - they must be created using a
@@ -66,6 +73,7 @@ class OrderedStoredValue;
  *     fixed {   | CAS               |
  *    length {   | revSeqno          |
  *           {   | ...               |
+ *           {   | bySeqno (48 bit)  |
  *           {   | datatype          |
  *           {   | internal flags: isDirty, deleted, isOrderedStoredValue ...
  *               + - - - - - - - - - +
@@ -135,6 +143,22 @@ public:
 
     void referenced();
 
+    /// The frequency counter a newly created item starts with.
+    static const uint8_t initialFreqCount = 4;
+
+    /**
+     * Get the (logarithmic) access frequency counter of this item, as
+     * maintained by the HashTable and used by the frequency eviction
+     * policy.
+     */
+    uint8_t getFreqCounterValue() const {
+        return freqCounter;
+    }
+
+    void setFreqCounterValue(uint8_t value) {
+        freqCounter = value;
+    }
+
     /**
      * Mark this item as needing to be persisted.
      */
@@ -585,6 +609,16 @@ public:
     /// Return how many bytes are need to store Item as a StoredValue
     static size_t getRequiredStorage(const Item& item);
 
+    /**
+     * Offset (in bytes) from the start of a StoredValue at which its key is
+     * stored - i.e. the number of bytes of fixed-length metadata per
+     * StoredValue. This is less than sizeof(StoredValue), as the key
+     * occupies the tail padding after the last member.
+     */
+    static constexpr size_t getKeyOffset() {
+        return offsetof(StoredValue, stale) + sizeof(stale);
+    }
+
 protected:
     /**
      * Constructor - protected as allocation needs to be done via
@@ -656,12 +690,18 @@ protected:
     // only the newer version if so.
     UniquePtr chain_next_or_replacement; // 8 bytes
     uint64_t           cas;            //!< CAS identifier.
+    // revSeqno is kept 64-bit: it is set by the client / XDCR (via
+    // SetWithMeta / DelWithMeta) and read from disk at warmup, so any
+    // value is valid.
     uint64_t           revSeqno;       //!< Revision id sequence number
-    int64_t            bySeqno;        //!< By sequence id number
     /// For alive items: GETL lock expiration. For deleted items: delete time.
     rel_time_t         lock_expiry_or_delete_time;
     uint32_t           exptime;        //!< Expiration time of this item.
     uint32_t           flags;          // 4 bytes
+    // bySeqno is stored in 48 bits (6 bytes); it is assigned by the active
+    // vBucket, which cannot realistically perform 2^47 mutations. Placed
+    // after the 4 byte members so it doesn't need any alignment padding.
+    PackedInteger<int64_t, 6> bySeqno; //!< By sequence id number
     protocol_binary_datatype_t datatype; // 1 byte
     bool               _isDirty  :  1; // 1 bit
     bool               deleted   :  1;
@@ -670,6 +710,10 @@ protected:
     uint8_t            nru       :  2; //!< True if referenced since last sweep
     bool unused : 2; // Unused bits in first byte of bitfields.
 
+    // Access frequency counter (see ProbabilisticCounter). Must precede
+    // stale, as the key starts immediately after stale (see getKeyOffset()).
+    uint8_t freqCounter;
+
     // Indicates if a newer instance of the item is added. Logically part of
     // OSV, but is physically located in SV as there are spare bytes here.
     // Guarded by the SequenceList's writeLock.
@@ -756,6 +800,15 @@ public:
     /// Return how many bytes are need to store Item as an OrderedStoredValue
     static size_t getRequiredStorage(const Item& item);
 
+    /**
+     * Offset of the key of an OrderedStoredValue. Unlike StoredValue the key
+     * follows the (pointer-aligned) seqno_hook, so there is no tail padding
+     * to reuse.
+     */
+    static constexpr size_t getKeyOffset() {
+        return sizeof(OrderedStoredValue);
+    }
+
     /**
      * Return the time the item was deleted. Only valid for deleted items.
      */
@@ -821,7 +874,8 @@ SerialisedDocKey* StoredValue::key() {
     if (isOrdered) {
         return static_cast<OrderedStoredValue*>(this)->key();
     } else {
-        return reinterpret_cast<SerialisedDocKey*>(this + 1);
+        return reinterpret_cast<SerialisedDocKey*>(
+                reinterpret_cast<uint8_t*>(this) + getKeyOffset());
     }
 }
 
@@ -831,5 +885,7 @@ size_t StoredValue::getObjectSize() const {
     if (isOrdered) {
         return sizeof(OrderedStoredValue) + getKey().getObjectSize();
     }
-    return sizeof(*this) + getKey().getObjectSize();
+    // The key may start in the tail padding, but the allocation is never
+    // smaller than the object itself.
+    return std::max(sizeof(*this), getKeyOffset() + getKey().getObjectSize());
 }
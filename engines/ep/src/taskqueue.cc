@@ -20,12 +20,19 @@
 #include "executorpool.h"
 #include "executorthread.h"
 
+#include <algorithm>
 #include <cmath>
 
-TaskQueue::TaskQueue(ExecutorPool *m, task_type_t t, const char *nm) :
-    name(nm), queueType(t), manager(m), sleepers(0)
-{
-    // EMPTY
+TaskQueue::TaskQueue(ExecutorPool* m,
+                     task_type_t t,
+                     const char* nm,
+                     size_t numReadyQueues)
+    : name(nm), queueType(t), manager(m), sleepers(0) {
+    numReadyQueues = std::max(numReadyQueues, size_t(1));
+    readyQueues.reserve(numReadyQueues);
+    for (size_t i = 0; i < numReadyQueues; ++i) {
+        readyQueues.emplace_back(new ReadyQueue());
+    }
 }
 
 TaskQueue::~TaskQueue() {
@@ -37,32 +44,73 @@ const std::string TaskQueue::getName() const {
 }
 
 size_t TaskQueue::getReadyQueueSize() {
-    LockHolder lh(mutex);
-    return readyQueue.size();
+    size_t size = 0;
+    for (auto& readyQ : readyQueues) {
+        size += readyQ->size;
+    }
+    return size;
 }
 
 size_t TaskQueue::getFutureQueueSize() {
-    LockHolder lh(mutex);
     return futureQueue.size();
 }
 
-size_t TaskQueue::getPendingQueueSize() {
-    LockHolder lh(mutex);
-    return pendingQueue.size();
-}
-
-ExTask TaskQueue::_popReadyTask(void) {
-    ExTask t = readyQueue.top();
-    readyQueue.pop();
+ExTask TaskQueue::_popReadyTask(ReadyQueue& readyQ) {
+    LockHolder lh(readyQ.mutex);
+    if (readyQ.tasks.empty()) {
+        return ExTask();
+    }
+    ExTask t = readyQ.tasks.top();
+    readyQ.tasks.pop();
+    readyQ.size--;
     manager->lessWork(queueType);
     return t;
 }
 
+ExTask TaskQueue::_stealReadyTask(ReadyQueue& readyQ) {
+    while (true) {
+        // Find the sibling whose top task has the highest priority ...
+        ReadyQueue* victim = nullptr;
+        ExTask best;
+        for (auto& other : readyQueues) {
+            if (other.get() == &readyQ || other->size == 0) {
+                continue;
+            }
+            LockHolder lh(other->mutex);
+            if (other->tasks.empty()) {
+                continue;
+            }
+            ExTask top = other->tasks.top();
+            if (!best || CompareByPriority()(best, top)) {
+                best = top;
+                victim = other.get();
+            }
+        }
+        if (!victim) {
+            return ExTask();
+        }
+        // ... and take its top task, unless its owner emptied it meanwhile.
+        ExTask t = _popReadyTask(*victim);
+        if (t) {
+            return t;
+        }
+    }
+}
+
 void TaskQueue::doWake(size_t &numToWake) {
     LockHolder lh(mutex);
     _doWake_UNLOCKED(numToWake);
 }
 
+void TaskQueue::wakeSleepers(size_t& numToWake) {
+    // A thread increments sleepers (with mutex held) before it re-checks
+    // for work and waits, so if there are none here then any thread going
+    // to sleep will see the work we have just made available.
+    if (numToWake && sleepers) {
+        doWake(numToWake);
+    }
+}
+
 void TaskQueue::_doWake_UNLOCKED(size_t &numToWake) {
     if (sleepers && numToWake)  {
         if (numToWake < sleepers) {
@@ -76,8 +124,7 @@ void TaskQueue::_doWake_UNLOCKED(size_t &numToWake) {
     }
 }
 
-bool TaskQueue::_doSleep(ExecutorThread &t,
-                         std::unique_lock<std::mutex>& lock) {
+bool TaskQueue::_doSleep(ExecutorThread &t) {
     t.updateCurrentTime();
     if (t.getCurTime() < t.getWaketime() && manager->trySleep(queueType)) {
         // Atomically switch from running to sleeping; iff we were previously
@@ -87,17 +134,30 @@ bool TaskQueue::_doSleep(ExecutorThread &t,
                                              EXECUTOR_SLEEPING)) {
             return false;
         }
-        sleepers++;
-        // zzz....
-        const auto snooze = t.getWaketime() - t.getCurTime();
-
-        if (snooze > std::chrono::seconds((int)round(MIN_SLEEP_TIME))) {
-            mutex.wait_for(lock, MIN_SLEEP_TIME);
-        } else {
-            mutex.wait_for(lock, snooze);
+        {
+            std::unique_lock<std::mutex> lh(mutex);
+            sleepers++;
+            // Work may have been made ready, a task woken or this thread
+            // stopped since we last looked; wakers only take the mutex once
+            // they see a sleeper, so re-check now that we are one.
+            const auto waketime =
+                    std::min(t.getWaketime(),
+                             manager->getEarliestWaketime(queueType));
+            if (t.state == EXECUTOR_SLEEPING && waketime > t.getCurTime() &&
+                !manager->getNumReadyTasks(queueType)) {
+                // zzz....
+                const auto snooze = waketime - t.getCurTime();
+
+                if (snooze >
+                    std::chrono::seconds((int)round(MIN_SLEEP_TIME))) {
+                    mutex.wait_for(lh, MIN_SLEEP_TIME);
+                } else {
+                    mutex.wait_for(lh, snooze);
+                }
+            }
+            // ... woke!
+            sleepers--;
         }
-        // ... woke!
-        sleepers--;
         manager->woke();
 
         // Finished our sleep, atomically switch back to running iff we were
@@ -114,40 +174,38 @@ bool TaskQueue::_doSleep(ExecutorThread &t,
 }
 
 bool TaskQueue::_fetchNextTask(ExecutorThread &t, bool toSleep) {
-    bool ret = false;
-    std::unique_lock<std::mutex> lh(mutex);
-
-    if (toSleep && !_doSleep(t, lh)) {
-        return ret; // shutting down
+    if (toSleep && !_doSleep(t)) {
+        return false; // shutting down
     }
 
-    size_t numToWake = _moveReadyTasks(t.getCurTime());
+    ReadyQueue& readyQ =
+            *readyQueues[t.getReadyQueueIdx() % readyQueues.size()];
 
-    if (!futureQueue.empty() && t.taskType == queueType &&
-        futureQueue.top()->getWaketime() < t.getWaketime()) {
-        // record earliest waketime
-        t.setWaketime(futureQueue.top()->getWaketime());
+    // Run what is already ready (ours first, then our siblings') before
+    // looking for more eligible tasks.
+    size_t numToWake = 0;
+    ExTask task = _popReadyTask(readyQ);
+    if (!task) {
+        task = _stealReadyTask(readyQ);
     }
-
-    if (!readyQueue.empty() && readyQueue.top()->isdead()) {
-        t.setCurrentTask(_popReadyTask()); // clean out dead tasks first
-        ret = true;
-    } else if (!readyQueue.empty() || !pendingQueue.empty()) {
-        // we must consider any pending tasks too. To ensure prioritized run
-        // order, the function below will push any pending task back into the
-        // readyQueue (sorted by priority)
-        _checkPendingQueue();
-        ExTask tid = _popReadyTask(); // and pop out the top task
-        t.setCurrentTask(tid);
-        ret = true;
-    } else { // Let the task continue waiting in pendingQueue
-        numToWake = numToWake ? numToWake - 1 : 0; // 1 fewer task ready
+    if (!task) {
+        numToWake = _moveReadyTasks(readyQ, t.getCurTime());
+        task = _popReadyTask(readyQ);
     }
 
-    _doWake_UNLOCKED(numToWake);
-    lh.unlock();
+    const auto earliest = futureQueue.topWaketime();
+    if (t.taskType == queueType && earliest < t.getWaketime()) {
+        // record earliest waketime
+        t.setWaketime(earliest);
+    }
 
-    return ret;
+    // Other threads steal the rest of the tasks we moved.
+    manager->getSleepQ(queueType)->wakeSleepers(numToWake);
+    if (!task) {
+        return false;
+    }
+    t.setCurrentTask(task);
+    return true;
 }
 
 bool TaskQueue::fetchNextTask(ExecutorThread &thread, bool toSleep) {
@@ -157,43 +215,25 @@ bool TaskQueue::fetchNextTask(ExecutorThread &thread, bool toSleep) {
     return rv;
 }
 
-size_t TaskQueue::_moveReadyTasks(const ProcessClock::time_point tv) {
-    if (!readyQueue.empty()) {
-        return 0;
-    }
-
+size_t TaskQueue::_moveReadyTasks(ReadyQueue& readyQ,
+                                  const ProcessClock::time_point tv) {
     size_t numReady = 0;
-    while (!futureQueue.empty()) {
-        ExTask tid = futureQueue.top();
-        if (tid->getWaketime() <= tv) {
-            futureQueue.pop();
-            readyQueue.push(tid);
-            numReady++;
-        } else {
-            break;
-        }
+    while (ExTask tid = futureQueue.popDue(tv)) {
+        LockHolder lh(readyQ.mutex);
+        readyQ.tasks.push(tid);
+        readyQ.size++;
+        // Count it before it can be stolen (and lessWork() called).
+        manager->addWork(1, queueType);
+        numReady++;
     }
 
-    manager->addWork(numReady, queueType);
-
     // Current thread will pop one task, so wake up one less thread
     return numReady ? numReady - 1 : 0;
 }
 
-void TaskQueue::_checkPendingQueue(void) {
-    if (!pendingQueue.empty()) {
-        ExTask runnableTask = pendingQueue.front();
-        readyQueue.push(runnableTask);
-        manager->addWork(1, queueType);
-        pendingQueue.pop_front();
-    }
-}
-
 ProcessClock::time_point TaskQueue::_reschedule(ExTask &task) {
-    LockHolder lh(mutex);
-
     futureQueue.push(task);
-    return futureQueue.top()->getWaketime();
+    return futureQueue.topWaketime();
 }
 
 ProcessClock::time_point TaskQueue::reschedule(ExTask &task) {
@@ -204,45 +244,40 @@ ProcessClock::time_point TaskQueue::reschedule(ExTask &task) {
 }
 
 void TaskQueue::_schedule(ExTask &task) {
-    TaskQueue* sleepQ;
     size_t numToWake = 1;
 
-    {
-        LockHolder lh(mutex);
-
-        // If we are rescheduling a previously cancelled task, we should reset
-        // the task state to the initial value of running.
-        bool changed_state = task->setState(TASK_RUNNING, TASK_DEAD);
-
-        /* This test is to confirm that we are not changing existing
-         * behaviour by resetting dead tasks to running when rescheduling an
-         * existing task. Will be removed (MB-23797).
-         */
-        if (changed_state) {
-            if (task->getTypeId() != TaskId::ItemPager) {
-                throw std::logic_error(
-                        "Unexpected task was scheduled while DEAD "
-                        "queue:{" + name + "} "
-                        "taskId:{" + std::to_string(task->getId()) + "} "
-                        "taskName:{" +
-                        GlobalTask::getTaskName(task->getTypeId()) + "}");
-            }
+    // If we are rescheduling a previously cancelled task, we should reset
+    // the task state to the initial value of running.
+    bool changed_state = task->setState(TASK_RUNNING, TASK_DEAD);
+
+    /* This test is to confirm that we are not changing existing
+     * behaviour by resetting dead tasks to running when rescheduling an
+     * existing task. Will be removed (MB-23797).
+     */
+    if (changed_state) {
+        if (task->getTypeId() != TaskId::ItemPager) {
+            throw std::logic_error(
+                    "Unexpected task was scheduled while DEAD "
+                    "queue:{" + name + "} "
+                    "taskId:{" + std::to_string(task->getId()) + "} "
+                    "taskName:{" +
+                    GlobalTask::getTaskName(task->getTypeId()) + "}");
         }
+    }
 
-        futureQueue.push(task);
+    futureQueue.push(task);
 
-        LOG(EXTENSION_LOG_DEBUG,
-            "%s: Schedule a task \"%.*s\" id %" PRIu64,
-            name.c_str(),
-            int(task->getDescription().size()),
-            task->getDescription().data(),
-            uint64_t(task->getId()));
+    LOG(EXTENSION_LOG_DEBUG,
+        "%s: Schedule a task \"%.*s\" id %" PRIu64,
+        name.c_str(),
+        int(task->getDescription().size()),
+        task->getDescription().data(),
+        uint64_t(task->getId()));
 
-        sleepQ = manager->getSleepQ(queueType);
-        _doWake_UNLOCKED(numToWake);
-    }
+    TaskQueue* sleepQ = manager->getSleepQ(queueType);
+    wakeSleepers(numToWake);
     if (this != sleepQ) {
-        sleepQ->doWake(numToWake);
+        sleepQ->wakeSleepers(numToWake);
     }
 }
 
@@ -254,50 +289,22 @@ void TaskQueue::schedule(ExTask &task) {
 
 void TaskQueue::_wake(ExTask &task) {
     const ProcessClock::time_point now = ProcessClock::now();
-    TaskQueue* sleepQ;
-    // One task is being made ready regardless of the queue it's in.
     size_t readyCount = 1;
-    {
-        LockHolder lh(mutex);
-        LOG(EXTENSION_LOG_DEBUG,
-            "%s: Wake a task \"%.*s\" id %" PRIu64,
-            name.c_str(),
-            int(task->getDescription().size()),
-            task->getDescription().data(),
-            uint64_t(task->getId()));
-
-        std::queue<ExTask> notReady;
-        // Wake thread-count-serialized tasks too
-        for (std::list<ExTask>::iterator it = pendingQueue.begin();
-             it != pendingQueue.end();) {
-            ExTask tid = *it;
-            if (tid->getId() == task->getId() || tid->isdead()) {
-                notReady.push(tid);
-                it = pendingQueue.erase(it);
-            } else {
-                it++;
-            }
-        }
-
-        futureQueue.updateWaketime(task, now);
-        task->setState(TASK_RUNNING, TASK_SNOOZED);
 
-        while (!notReady.empty()) {
-            ExTask tid = notReady.front();
-            if (tid->getWaketime() <= now || tid->isdead()) {
-                readyCount++;
-            }
+    LOG(EXTENSION_LOG_DEBUG,
+        "%s: Wake a task \"%.*s\" id %" PRIu64,
+        name.c_str(),
+        int(task->getDescription().size()),
+        task->getDescription().data(),
+        uint64_t(task->getId()));
 
-            // MB-18453: Only push to the futureQueue
-            futureQueue.push(tid);
-            notReady.pop();
-        }
+    futureQueue.updateWaketime(task, now);
+    task->setState(TASK_RUNNING, TASK_SNOOZED);
 
-        _doWake_UNLOCKED(readyCount);
-        sleepQ = manager->getSleepQ(queueType);
-    }
+    TaskQueue* sleepQ = manager->getSleepQ(queueType);
+    wakeSleepers(readyCount);
     if (this != sleepQ) {
-        sleepQ->doWake(readyCount);
+        sleepQ->wakeSleepers(readyCount);
     }
 }
 
@@ -25,24 +25,45 @@
 
 #include <platform/processclock.h>
 
-#include <list>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <vector>
 
 class ExecutorPool;
 class ExecutorThread;
 
+/*
+ * A TaskQueue holds the tasks of one task type (and bucket priority).
+ *
+ * Tasks wait in the futureQueue (sorted by waketime) until they are due.
+ * Due tasks are then moved into the ready queue of the thread that found
+ * them; each thread has its own ready queue (sorted by task priority, with
+ * its own lock) and runs tasks from it, stealing the highest priority task
+ * from a sibling's ready queue when its own is empty.
+ *
+ * Scheduling, waking and snoozing a task only touch the futureQueue; the
+ * queue's mutex is only taken to put a thread to sleep and, when there are
+ * sleeping threads, to wake them.
+ */
 class TaskQueue {
     friend class ExecutorPool;
 public:
-    TaskQueue(ExecutorPool *m, task_type_t t, const char *nm);
+    /**
+     * @param numReadyQueues number of per-thread ready queues; threads are
+     *        assigned to them by ExecutorThread::getReadyQueueIdx().
+     */
+    TaskQueue(ExecutorPool* m,
+              task_type_t t,
+              const char* nm,
+              size_t numReadyQueues);
     ~TaskQueue();
 
     void schedule(ExTask &task);
 
     ProcessClock::time_point reschedule(ExTask &task);
 
-    void checkPendingQueue(void);
-
     void doWake(size_t &numToWake);
 
     bool fetchNextTask(ExecutorThread &thread, bool toSleep);
@@ -55,41 +76,56 @@ public:
 
     const task_type_t getQueueType() const { return queueType; }
 
+    /// @return the number of tasks in all of the threads' ready queues
     size_t getReadyQueueSize();
 
     size_t getFutureQueueSize();
 
-    size_t getPendingQueueSize();
+    /// @return the waketime of the earliest task in the futureQueue
+    ProcessClock::time_point getEarliestWaketime() {
+        return futureQueue.topWaketime();
+    }
 
     void snooze(ExTask& task, const double secs) {
         futureQueue.snooze(task, secs);
     }
 
 private:
+    /// A thread's ready queue; only accessed with its mutex held.
+    struct ReadyQueue {
+        std::mutex mutex;
+        // sorted by task priority.
+        std::priority_queue<ExTask, std::deque<ExTask>, CompareByPriority>
+                tasks;
+        // tasks.size(), readable without the mutex to skip empty queues.
+        std::atomic<size_t> size{0};
+    };
+
     void _schedule(ExTask &task);
     ProcessClock::time_point _reschedule(ExTask &task);
-    void _checkPendingQueue(void);
     bool _fetchNextTask(ExecutorThread &thread, bool toSleep);
     void _wake(ExTask &task);
-    bool _doSleep(ExecutorThread &thread, std::unique_lock<std::mutex>& lock);
+    bool _doSleep(ExecutorThread &thread);
     void _doWake_UNLOCKED(size_t &numToWake);
-    size_t _moveReadyTasks(const ProcessClock::time_point tv);
-    ExTask _popReadyTask(void);
-
-    SyncObject mutex;
+    /// Wakes up to numToWake sleeping threads; only locks if there are any.
+    void wakeSleepers(size_t& numToWake);
+    size_t _moveReadyTasks(ReadyQueue& readyQ,
+                           const ProcessClock::time_point tv);
+    ExTask _popReadyTask(ReadyQueue& readyQ);
+    ExTask _stealReadyTask(ReadyQueue& readyQ);
+
+    SyncObject mutex; // for sleeping threads
     const std::string name;
     task_type_t queueType;
     ExecutorPool *manager;
-    size_t sleepers; // number of threads sleeping in this taskQueue
+    // number of threads sleeping in this taskQueue; only incremented with
+    // mutex held.
+    std::atomic<size_t> sleepers;
 
-    // sorted by task priority.
-    std::priority_queue<ExTask, std::deque<ExTask>,
-                        CompareByPriority> readyQueue;
+    std::vector<std::unique_ptr<ReadyQueue>> readyQueues;
 
     // sorted by waketime.
     FutureQueue<> futureQueue;
-
-    std::list<ExTask> pendingQueue;
 };
 
 #endif  // SRC_TASKQUEUE_H_
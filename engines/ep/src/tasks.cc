@@ -71,8 +71,8 @@ bool VKeyStatBGFetchTask::run() {
 
 bool SingleBGFetcherTask::run() {
     TRACE_EVENT("ep-engine/task", "SingleBGFetcherTask", cookie, vbucket);
-    engine->getKVBucket()->completeBGFetch(key, vbucket, cookie, init,
-                                           metaFetch);
+    engine->getKVBucket()->completeBGFetch(
+            key, vbucket, cookie, init, metaFetch, batch);
     return false;
 }
 
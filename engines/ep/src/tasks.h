@@ -28,6 +28,7 @@
 #include <string>
 
 class EventuallyPersistentEngine;
+class GetMultiBatch;
 
 /**
  * A task for persisting items to disk.
@@ -183,7 +184,8 @@ public:
                         const void* c,
                         bool isMeta,
                         int sleeptime = 0,
-                        bool completeBeforeShutdown = false)
+                        bool completeBeforeShutdown = false,
+                        std::shared_ptr<GetMultiBatch> batch = {})
         : GlobalTask(e,
                      TaskId::SingleBGFetcherTask,
                      sleeptime,
@@ -192,6 +194,7 @@ public:
           vbucket(vbid),
           cookie(c),
           metaFetch(isMeta),
+          batch(std::move(batch)),
           init(ProcessClock::now()),
           description("Fetching item from disk: key{" +
                       std::string(key.c_str()) + "}, vb:" +
@@ -209,6 +212,7 @@ private:
     const uint16_t vbucket;
     const void*                cookie;
     bool                       metaFetch;
+    std::shared_ptr<GetMultiBatch> batch;
     ProcessClock::time_point   init;
     const std::string description;
 };
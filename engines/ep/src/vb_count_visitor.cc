@@ -30,7 +30,7 @@ void VBucketCountVisitor::visitBucket(VBucketPtr& vb) {
     }
 
     if (desired_state != vbucket_state_dead) {
-        htMemory += vb->ht.memorySize();
+        htMemory += vb->ht.memorySize() + vb->ht.getExpiryIndexMemory();
         htItemMemory += vb->ht.getItemMemory();
         htCacheSize += vb->ht.cacheSize;
         numEjects += vb->ht.getNumEjects();
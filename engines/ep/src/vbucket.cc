@@ -32,6 +32,7 @@
 #include "failover-table.h"
 #include "flusher.h"
 #include "pre_link_document_context.h"
+#include "vbucket_bgfetch_item.h"
 #include "vbucketdeletiontask.h"
 
 #define STATWRITER_NAMESPACE vbucket
@@ -151,7 +152,11 @@ VBucket::VBucket(id_type i,
                  uint64_t purgeSeqno,
                  uint64_t maxCas,
                  const std::string& collectionsManifest)
-    : ht(st, std::move(valFact), config.getHtSize(), config.getHtLocks()),
+    : ht(st,
+         std::move(valFact),
+         config.getHtSize(),
+         config.getHtLocks(),
+         HashTable::layoutFromString(config.getHtLayout())),
       checkpointManager(st,
                         i,
                         chkConfig,
@@ -237,6 +242,26 @@ VBucket::~VBucket() {
     LOG(EXTENSION_LOG_INFO, "Destroying vbucket %d\n", id);
 }
 
+bool VBucket::addPendingOp(const void* cookie,
+                           std::shared_ptr<GetMultiBatch> batch) {
+    LockHolder lh(pendingOpLock);
+    if (state != vbucket_state_pending) {
+        // State transitioned while we were waiting.
+        return false;
+    }
+    // Start a timer when enqueuing the first client.
+    if (pendingOps.empty()) {
+        pendingOpsStart = gethrtime();
+    }
+    if (batch) {
+        batch->retain();
+    }
+    pendingOps.push_back({cookie, std::move(batch)});
+    ++stats.pendingOps;
+    ++stats.pendingOpsTotal;
+    return true;
+}
+
 void VBucket::fireAllOps(EventuallyPersistentEngine &engine,
                          ENGINE_ERROR_CODE code) {
     std::unique_lock<std::mutex> lh(pendingOpLock);
@@ -257,12 +282,13 @@ void VBucket::fireAllOps(EventuallyPersistentEngine &engine,
     atomic_setIfBigger(stats.pendingOpsMax, pendingOps.size());
 
     while (!pendingOps.empty()) {
-        const void *pendingOperation = pendingOps.back();
+        PendingOp pendingOperation = std::move(pendingOps.back());
         pendingOps.pop_back();
         // We don't want to hold the pendingOpLock when
         // calling notifyIOComplete.
         lh.unlock();
-        engine.notifyIOComplete(pendingOperation, code);
+        engine.notifyIOComplete(
+                pendingOperation.cookie, pendingOperation.batch.get(), code);
         lh.lock();
     }
 
@@ -1321,6 +1347,9 @@ void VBucket::deleteExpiredItem(const Item& it,
             key, hbl.getBucketNum(), WantsDeleted::Yes, TrackReference::No);
     if (v) {
         if (v->getCas() != it.getCas()) {
+            // The item has changed since the expiry pager took it from the
+            // expiry index; make sure it's still indexed.
+            ht.unlocked_reindexExpiry(hbl.getHTLock(), *v);
             return;
         }
 
@@ -1342,6 +1371,8 @@ void VBucket::deleteExpiredItem(const Item& it,
             // inversions arising from notifyNewSeqno() call
             hbl.getHTLock().unlock();
             notifyNewSeqno(notifyCtx);
+        } else {
+            ht.unlocked_reindexExpiry(hbl.getHTLock(), *v);
         }
     } else {
         if (eviction == FULL_EVICTION) {
@@ -1373,6 +1404,15 @@ void VBucket::deleteExpiredItem(const Item& it,
     incExpirationStat(source);
 }
 
+void VBucket::reindexExpiry(const DocKey& key) {
+    auto hbl = ht.getLockedBucket(key);
+    StoredValue* v = ht.unlocked_find(
+            key, hbl.getBucketNum(), WantsDeleted::No, TrackReference::No);
+    if (v) {
+        ht.unlocked_reindexExpiry(hbl.getHTLock(), *v);
+    }
+}
+
 ENGINE_ERROR_CODE VBucket::add(Item& itm,
                                const void* cookie,
                                EventuallyPersistentEngine& engine,
@@ -1449,7 +1489,7 @@ std::pair<MutationStatus, GetValue> VBucket::processGetAndUpdateTtl(
         auto bySeqNo = v->getBySeqno();
         if (exptime_mutated) {
             v->markDirty();
-            v->setExptime(exptime);
+            ht.unlocked_setExptime(hbl.getHTLock(), *v, exptime);
             v->setRevSeqno(v->getRevSeqno() + 1);
         }
 
@@ -1524,12 +1564,30 @@ GetValue VBucket::getInternal(const DocKey& key,
                               int bgFetchDelay,
                               get_options_t options,
                               bool diskFlushAll) {
+    auto hbl = ht.getLockedBucket(key);
+    return getInternal(hbl,
+                       key,
+                       cookie,
+                       engine,
+                       bgFetchDelay,
+                       options,
+                       diskFlushAll,
+                       nullptr);
+}
+
+GetValue VBucket::getInternal(HashTable::HashBucketLock& hbl,
+                              const DocKey& key,
+                              const void* cookie,
+                              EventuallyPersistentEngine& engine,
+                              int bgFetchDelay,
+                              get_options_t options,
+                              bool diskFlushAll,
+                              const std::shared_ptr<GetMultiBatch>& batch) {
     const TrackReference trackReference = (options & TRACK_REFERENCE)
                                                   ? TrackReference::Yes
                                                   : TrackReference::No;
     const bool metadataOnly = (options & ALLOW_META_ONLY);
     const bool getDeletedValue = (options & GET_DELETED_VALUE);
-    auto hbl = ht.getLockedBucket(key);
     StoredValue* v = fetchValidValue(
             hbl, key, WantsDeleted::Yes, trackReference, QueueExpired::Yes);
     if (v) {
@@ -1549,7 +1607,7 @@ GetValue VBucket::getInternal(const DocKey& key,
         // If the value is not resident (and it was requested), wait for it...
         if (!v->isResident() && !metadataOnly) {
             return getInternalNonResident(
-                    key, cookie, engine, bgFetchDelay, options, *v);
+                    key, cookie, engine, bgFetchDelay, options, *v, batch);
         }
 
         // Should we hide (return -1) for the items' CAS?
@@ -1569,8 +1627,14 @@ GetValue VBucket::getInternal(const DocKey& key,
             ENGINE_ERROR_CODE ec = ENGINE_EWOULDBLOCK;
             if (options &
                 QUEUE_BG_FETCH) { // Full eviction and need a bg fetch.
-                ec = addTempItemAndBGFetch(
-                        hbl, key, cookie, engine, bgFetchDelay, metadataOnly);
+                ec = addTempItemAndBGFetch(hbl,
+                                           key,
+                                           cookie,
+                                           engine,
+                                           bgFetchDelay,
+                                           metadataOnly,
+                                           false,
+                                           batch);
             }
             return GetValue(NULL, ec, -1, true);
         } else {
@@ -1821,9 +1885,13 @@ void VBucket::_addStats(bool details, ADD_STAT add_stat, const void* c) {
         addStat("num_items", numItems, add_stat, c);
         addStat("num_temp_items", tempItems, add_stat, c);
         addStat("num_non_resident", getNumNonResidentItems(), add_stat, c);
-        addStat("ht_memory", ht.memorySize(), add_stat, c);
+        addStat("ht_memory",
+                ht.memorySize() + ht.getExpiryIndexMemory(),
+                add_stat,
+                c);
         addStat("ht_item_memory", ht.getItemMemory(), add_stat, c);
         addStat("ht_cache_size", ht.cacheSize.load(), add_stat, c);
+        addStat("ht_expiry_index_size", ht.getExpiryIndexSize(), add_stat, c);
         addStat("ht_size", ht.getSize(), add_stat, c);
         addStat("num_ejects", ht.getNumEjects(), add_stat, c);
         addStat("ops_create", opsCreate.load(), add_stat, c);
@@ -2103,7 +2171,7 @@ VBucket::processSoftDelete(const HashTable::HashBucketLock& hbl,
     if (use_meta) {
         v.setCas(metadata.cas);
         v.setFlags(metadata.flags);
-        v.setExptime(metadata.exptime);
+        ht.unlocked_setExptime(hbl.getHTLock(), v, metadata.exptime);
     }
 
     v.setRevSeqno(metadata.revSeqno);
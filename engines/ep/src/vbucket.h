@@ -42,6 +42,7 @@ class EventuallyPersistentEngine;
 class DCPBackfill;
 class RollbackResult;
 class VBucketBGFetchItem;
+class GetMultiBatch;
 
 /**
  * The following will be used to identify
@@ -308,21 +309,16 @@ public:
      */
     void handlePreExpiry(StoredValue& v);
 
-    bool addPendingOp(const void *cookie) {
-        LockHolder lh(pendingOpLock);
-        if (state != vbucket_state_pending) {
-            // State transitioned while we were waiting.
-            return false;
-        }
-        // Start a timer when enqueuing the first client.
-        if (pendingOps.empty()) {
-            pendingOpsStart = gethrtime();
-        }
-        pendingOps.push_back(cookie);
-        ++stats.pendingOps;
-        ++stats.pendingOpsTotal;
-        return true;
-    }
+    /**
+     * Park an operation until the (pending) vbucket changes state.
+     *
+     * @param cookie the cookie to notify when it does
+     * @param batch if non-null, the getMulti() batch the operation belongs
+     *        to; a reference on it is held until the op is fired
+     * @return false if the vbucket is no longer pending
+     */
+    bool addPendingOp(const void* cookie,
+                      std::shared_ptr<GetMultiBatch> batch = {});
 
     void doStatsForQueueing(const Item& item, size_t itemBytes);
     void doStatsForFlushing(const Item& item, size_t itemBytes);
@@ -850,6 +846,15 @@ public:
                            time_t startTime,
                            ExpireBy source);
 
+    /**
+     * Put the item with the given key back into the HashTable's expiry
+     * index (if it has an expiry time), after it was taken from the index
+     * but not expired.
+     *
+     * @param key the key of the item
+     */
+    void reindexExpiry(const DocKey& key);
+
     /**
      * Evict a key from memory.
      *
@@ -943,6 +948,36 @@ public:
                          get_options_t options,
                          bool diskFlushAll);
 
+    /**
+     * As getInternal() above, but with the key's hash bucket already locked
+     * by the caller, so a batch of keys which share a bucket can be looked
+     * up under a single acquisition of its lock. The lock is still held on
+     * return.
+     *
+     * @param hbl the lock for the key's hash bucket
+     * @param batch the getMulti() batch any background fetch is registered
+     *        against (may be null). Such fetches don't wake the background
+     *        fetcher; call
+     *        wakeBgFetcher() once all of the batch's keys have been looked
+     *        up.
+     */
+    GetValue getInternal(HashTable::HashBucketLock& hbl,
+                         const DocKey& key,
+                         const void* cookie,
+                         EventuallyPersistentEngine& engine,
+                         int bgFetchDelay,
+                         get_options_t options,
+                         bool diskFlushAll,
+                         const std::shared_ptr<GetMultiBatch>& batch);
+
+    /**
+     * Wake the background fetcher for fetches queued on behalf of a
+     * getMulti() batch, so they are all picked up in one go.
+     *
+     * @param fetches the number of fetches queued
+     */
+    virtual void wakeBgFetcher(size_t fetches) = 0;
+
     /**
      * Retrieve the meta data for given key
      *
@@ -1458,6 +1493,9 @@ private:
      * @param metadataOnly whether the fetch is for a non-resident value or
      *                     metadata of a (possibly) deleted item
      * @param isReplication indicates if the call is for a replica vbucket
+     * @param batch the getMulti() batch the fetch belongs to, if any. The
+     *              hash bucket lock is only released early (before queueing
+     *              the fetch) when there isn't one.
      *
      * @return ENGINE_ERROR_CODE status notified to be to the front end
      */
@@ -1468,7 +1506,8 @@ private:
             EventuallyPersistentEngine& engine,
             int bgFetchDelay,
             bool metadataOnly,
-            bool isReplication = false) = 0;
+            bool isReplication = false,
+            const std::shared_ptr<GetMultiBatch>& batch = {}) = 0;
 
     /**
      * Enqueue a background fetch for a key.
@@ -1479,12 +1518,14 @@ private:
      * @param bgFetchDelay Delay in secs before we run the bgFetch task
      * @param isMeta whether the fetch is for a non-resident value or metadata
      *               of a (possibly) deleted item
+     * @param batch the getMulti() batch the fetch belongs to, if any
      */
     virtual void bgFetch(const DocKey& key,
                          const void* cookie,
                          EventuallyPersistentEngine& engine,
                          int bgFetchDelay,
-                         bool isMeta = false) = 0;
+                         bool isMeta = false,
+                         const std::shared_ptr<GetMultiBatch>& batch = {}) = 0;
 
     /**
      * Get metadata and value for a non-resident key
@@ -1495,15 +1536,18 @@ private:
      * @param bgFetchDelay Delay in secs before we run the bgFetch task
      * @param options flags indicating some retrieval related info
      * @param v reference to the stored value of the non-resident key
+     * @param batch the getMulti() batch any background fetch belongs to
      *
      * @return the result of the operation
      */
-    virtual GetValue getInternalNonResident(const DocKey& key,
-                                            const void* cookie,
-                                            EventuallyPersistentEngine& engine,
-                                            int bgFetchDelay,
-                                            get_options_t options,
-                                            const StoredValue& v) = 0;
+    virtual GetValue getInternalNonResident(
+            const DocKey& key,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            int bgFetchDelay,
+            get_options_t options,
+            const StoredValue& v,
+            const std::shared_ptr<GetMultiBatch>& batch) = 0;
 
     /**
      * Update the revision seqno of a newly StoredValue item.
@@ -1539,7 +1583,11 @@ private:
     cb::RWLock                      stateLock;
     vbucket_state_t                 initialState;
     std::mutex                           pendingOpLock;
-    std::vector<const void*>        pendingOps;
+    struct PendingOp {
+        const void* cookie;
+        std::shared_ptr<GetMultiBatch> batch;
+    };
+    std::vector<PendingOp>          pendingOps;
     hrtime_t                        pendingOpsStart;
     uint64_t                        purge_seqno;
     std::atomic<bool>               takeover_backed_up;
@@ -21,19 +21,62 @@
 
 #include "item.h"
 
+#include <atomic>
+#include <memory>
+
+/**
+ * The background fetches (and pending vbucket op) issued by a single
+ * getMulti() call. Each of them holds a reference on the batch, as does the
+ * issuing call until it has queued all of them; the cookie is notified once,
+ * by whoever releases the last reference, rather than once per key.
+ */
+class GetMultiBatch {
+public:
+    explicit GetMultiBatch(const void* c) : cookie(c) {
+    }
+
+    /// Register another operation the batch has to wait for.
+    void retain() {
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Release one operation (or the issuer's reference).
+     *
+     * @return true if that was the last one, in which case the caller is
+     *         responsible for notifying the cookie
+     */
+    bool release() {
+        return outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    const void* const cookie;
+
+private:
+    // Starts at one - the reference held by the issuer.
+    std::atomic<size_t> outstanding{1};
+};
+
 class VBucketBGFetchItem {
 public:
-    VBucketBGFetchItem(const void* c, bool meta_only)
-        : cookie(c), initTime(ProcessClock::now()), metaDataOnly(meta_only) {
+    VBucketBGFetchItem(const void* c,
+                       bool meta_only,
+                       std::shared_ptr<GetMultiBatch> batch_ = {})
+        : cookie(c),
+          initTime(ProcessClock::now()),
+          metaDataOnly(meta_only),
+          batch(std::move(batch_)) {
     }
     VBucketBGFetchItem(GetValue* value_,
                        const void* c,
                        const ProcessClock::time_point& init_time,
-                       bool meta_only)
+                       bool meta_only,
+                       std::shared_ptr<GetMultiBatch> batch_ = {})
         : value(value_),
           cookie(c),
           initTime(init_time),
-          metaDataOnly(meta_only) {
+          metaDataOnly(meta_only),
+          batch(std::move(batch_)) {
     }
 
     ~VBucketBGFetchItem() {
@@ -43,6 +86,8 @@ public:
     const void* cookie;
     ProcessClock::time_point initTime;
     bool metaDataOnly;
+    /// The getMulti() batch this fetch belongs to, if any.
+    std::shared_ptr<GetMultiBatch> batch;
 };
 
 struct vb_bgfetch_item_ctx_t {
@@ -1045,14 +1045,16 @@ struct Ret_vals {
 
 /*
  * Performs a single DCP latency / bandwidth test with the given parameters.
- * Returns vectors of item timings and recived bytes.
+ * Returns vectors of item timings and recived bytes, and sets duration to
+ * the time from the first item being stored to the last one being received.
  */
 static std::pair<std::vector<hrtime_t>,
                  std::vector<size_t>>
 single_dcp_latency_bw_test(ENGINE_HANDLE *h, ENGINE_HANDLE_V1 *h1,
                            uint16_t vb, size_t item_count,
                            Doc_format typeOfData, const std::string& name,
-                           uint32_t opaque, bool retrieveCompressed) {
+                           uint32_t opaque, bool retrieveCompressed,
+                           hrtime_t& duration) {
     std::vector<size_t> received;
 
     check(set_vbucket_state(h, h1, vb, vbucket_state_active),
@@ -1071,6 +1073,12 @@ single_dcp_latency_bw_test(ENGINE_HANDLE *h, ENGINE_HANDLE_V1 *h1,
     load_thread.join();
     dcp_thread.join();
 
+    duration = 0;
+    if (!insert_times.empty() && !recv_times.empty() &&
+        recv_times.back() > insert_times.front()) {
+        duration = recv_times.back() - insert_times.front();
+    }
+
     std::vector<hrtime_t> timings;
     for (size_t j = 0; j < insert_times.size(); ++j) {
         if (insert_times[j] < recv_times[j]) {
@@ -1098,19 +1106,28 @@ static enum test_result perf_dcp_latency_and_bandwidth(ENGINE_HANDLE *h,
 
     std::vector<struct Ret_vals> iterations;
 
+    // Time taken to stream all of the items for each variant, used to
+    // report throughput.
+    std::vector<std::pair<std::string, hrtime_t>> durations;
+    hrtime_t duration;
+
     // For Loader & DCP client to get documents as is from vbucket 0
     auto as_is_results =
             single_dcp_latency_bw_test(h, h1, /*vb*/0, item_count, typeOfData,
-                                       "As_is", /*opaque*/0xFFFFFF00, false);
+                                       "As_is", /*opaque*/0xFFFFFF00, false,
+                                       duration);
     all_timings.push_back({"As_is", &as_is_results.first});
     all_sizes.push_back({"As_s", &as_is_results.second});
+    durations.push_back({"As_is", duration});
 
     // For Loader & DCP client to get documents compressed from vbucket 1
     auto compress_results =
             single_dcp_latency_bw_test(h, h1, /*vb*/1, item_count, typeOfData,
-                                      "Compress", /*opaque*/0xFF000000, true);
+                                      "Compress", /*opaque*/0xFF000000, true,
+                                      duration);
     all_timings.push_back({"Compress", &compress_results.first});
     all_sizes.push_back({"Compress", &compress_results.second});
+    durations.push_back({"Compress", duration});
 
     printf("\n\n");
 
@@ -1127,6 +1144,24 @@ static enum test_result perf_dcp_latency_and_bandwidth(ENGINE_HANDLE *h,
     fillLineWith('=', 88-printed);
 
     output_result(title, "Latency", all_timings, "µs");
+
+    fillLineWith('=', 86);
+
+    printed = printf("=== %s Throughput - %zu items", title.c_str(),
+                     item_count);
+    fillLineWith('=', 86-printed);
+
+    for (size_t ii = 0; ii < durations.size(); ++ii) {
+        const double seconds = durations[ii].second / 1e9;
+        const auto& sizes = *all_sizes[ii].second;
+        const double bytes =
+                std::accumulate(sizes.begin(), sizes.end(), 0.0);
+        if (seconds > 0) {
+            printf("%-22s %12.0f items/s %10.2f MB/s\n",
+                   durations[ii].first.c_str(), item_count / seconds,
+                   bytes / seconds / (1024 * 1024));
+        }
+    }
     printf("\n\n");
 
     return SUCCESS;
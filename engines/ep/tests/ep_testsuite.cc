@@ -71,7 +71,7 @@
 // away ;)
 typedef void (*UNLOCK_COOKIE_T)(const void *cookie);
 
-#define IMMEDIATE_MEM_STATS ";mem_merge_count_threshold=1"
+#define IMMEDIATE_MEM_STATS ";mem_merge_bytes_threshold=1"
 #define MULTI_DISPATCHER_CONFIG \
     "ht_size=129;ht_locks=3;chk_remover_stime=1;chk_period=60"
 
@@ -6121,6 +6121,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ro_0:io_write_bytes",
                 "ro_0:numLoadedVb",
                 "ro_0:open",
+                "ro_0:read_handle_cache_hits",
+                "ro_0:read_handle_cache_misses",
+                "ro_0:read_handles_open",
                 "ro_1:backend_type",
                 "ro_1:close",
                 "ro_1:failure_get",
@@ -6135,6 +6138,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ro_1:io_write_bytes",
                 "ro_1:numLoadedVb",
                 "ro_1:open",
+                "ro_1:read_handle_cache_hits",
+                "ro_1:read_handle_cache_misses",
+                "ro_1:read_handles_open",
                 "ro_2:backend_type",
                 "ro_2:close",
                 "ro_2:failure_get",
@@ -6149,6 +6155,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ro_2:io_write_bytes",
                 "ro_2:numLoadedVb",
                 "ro_2:open",
+                "ro_2:read_handle_cache_hits",
+                "ro_2:read_handle_cache_misses",
+                "ro_2:read_handles_open",
                 "ro_3:backend_type",
                 "ro_3:close",
                 "ro_3:failure_get",
@@ -6162,7 +6171,10 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ro_3:io_total_write_bytes",
                 "ro_3:io_write_bytes",
                 "ro_3:numLoadedVb",
-                "ro_3:open"
+                "ro_3:open",
+                "ro_3:read_handle_cache_hits",
+                "ro_3:read_handle_cache_misses",
+                "ro_3:read_handles_open"
     };
 
     std::vector<std::string> rwKVStoreStats = {
@@ -6184,6 +6196,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "rw_0:lastCommDocs",
                 "rw_0:numLoadedVb",
                 "rw_0:open",
+                "rw_0:read_handle_cache_hits",
+                "rw_0:read_handle_cache_misses",
+                "rw_0:read_handles_open",
                 "rw_1:backend_type",
                 "rw_1:close",
                 "rw_1:failure_del",
@@ -6202,6 +6217,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "rw_1:lastCommDocs",
                 "rw_1:numLoadedVb",
                 "rw_1:open",
+                "rw_1:read_handle_cache_hits",
+                "rw_1:read_handle_cache_misses",
+                "rw_1:read_handles_open",
                 "rw_2:backend_type",
                 "rw_2:close",
                 "rw_2:failure_del",
@@ -6220,6 +6238,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "rw_2:lastCommDocs",
                 "rw_2:numLoadedVb",
                 "rw_2:open",
+                "rw_2:read_handle_cache_hits",
+                "rw_2:read_handle_cache_misses",
+                "rw_2:read_handles_open",
                 "rw_3:backend_type",
                 "rw_3:close",
                 "rw_3:failure_del",
@@ -6237,7 +6258,10 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "rw_3:io_write_bytes",
                 "rw_3:lastCommDocs",
                 "rw_3:numLoadedVb",
-                "rw_3:open"
+                "rw_3:open",
+                "rw_3:read_handle_cache_hits",
+                "rw_3:read_handle_cache_misses",
+                "rw_3:read_handles_open"
     };
 
     std::string backend = get_str_stat(h, h1, "ep_backend");
@@ -6265,6 +6289,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
         },
         {"dcp",
             {
+                "ep_dcp_compression_cache_hits",
+                "ep_dcp_compression_cache_misses",
+                "ep_dcp_compression_saved_bytes",
                 "ep_dcp_count",
                 "ep_dcp_dead_conn_count",
                 "ep_dcp_items_remaining",
@@ -6287,6 +6314,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "vb_0:mem_size_counted",
                 "vb_0:min_depth",
                 "vb_0:reported",
+                "vb_0:resize_chains_migrated",
+                "vb_0:resize_chains_remaining",
+                "vb_0:resize_target",
                 "vb_0:resized",
                 "vb_0:size",
                 "vb_0:state"
@@ -6308,6 +6338,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "vb_0:drift_behind_threshold_exceeded",
                 "vb_0:high_seqno",
                 "vb_0:ht_cache_size",
+                "vb_0:ht_expiry_index_size",
                 "vb_0:ht_item_memory",
                 "vb_0:ht_memory",
                 "vb_0:ht_size",
@@ -6434,6 +6465,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_conflict_resolution_type",
                 "ep_connection_manager_interval",
                 "ep_couch_bucket",
+                "ep_couchstore_read_handle_cache_size",
                 "ep_cursor_dropping_lower_mark",
                 "ep_cursor_dropping_upper_mark",
                 "ep_data_traffic_enabled",
@@ -6456,6 +6488,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_dcp_consumer_process_buffered_messages_batch_size",
                 "ep_dcp_scan_byte_limit",
                 "ep_dcp_scan_item_limit",
+                "ep_dcp_shared_scan_detach_stall_ms",
                 "ep_dcp_takeover_max_time",
                 "ep_dcp_value_compression_enabled",
                 "ep_defragmenter_age_threshold",
@@ -6466,18 +6499,26 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_exp_pager_enabled",
                 "ep_exp_pager_initial_run_time",
                 "ep_exp_pager_stime",
+                "ep_exp_pager_use_index",
                 "ep_failpartialwarmup",
                 "ep_flushall_enabled",
+                "ep_flusher_group_commit_max_latency",
+                "ep_flusher_group_commit_max_vbuckets",
                 "ep_getl_default_timeout",
                 "ep_getl_max_timeout",
                 "ep_hlc_drift_ahead_threshold_us",
                 "ep_hlc_drift_behind_threshold_us",
+                "ep_ht_eviction_policy",
+                "ep_ht_layout",
                 "ep_ht_locks",
                 "ep_ht_resize_interval",
+                "ep_ht_resize_mode",
+                "ep_ht_resize_step_chains",
                 "ep_ht_size",
                 "ep_initfile",
                 "ep_item_num_based_new_chk",
                 "ep_keep_closed_chks",
+                "ep_logstore_segment_size",
                 "ep_max_checkpoints",
                 "ep_max_failover_entries",
                 "ep_max_item_privileged_bytes",
@@ -6494,7 +6535,6 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_mem_high_wat",
                 "ep_mem_low_wat",
                 "ep_mem_merge_bytes_threshold",
-                "ep_mem_merge_count_threshold",
                 "ep_mutation_mem_threshold",
                 "ep_num_auxio_threads",
                 "ep_num_nonio_threads",
@@ -6604,6 +6644,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_conflict_resolution_type",
                 "ep_connection_manager_interval",
                 "ep_couch_bucket",
+                "ep_couchstore_read_handle_cache_size",
                 "ep_cursor_dropping_lower_mark",
                 "ep_cursor_dropping_lower_threshold",
                 "ep_cursor_dropping_upper_mark",
@@ -6629,6 +6670,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_dcp_producer_snapshot_marker_yield_limit",
                 "ep_dcp_scan_byte_limit",
                 "ep_dcp_scan_item_limit",
+                "ep_dcp_shared_scan_detach_stall_ms",
                 "ep_dcp_takeover_max_time",
                 "ep_dcp_value_compression_enabled",
                 "ep_defragmenter_age_threshold",
@@ -6647,20 +6689,28 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_exp_pager_enabled",
                 "ep_exp_pager_initial_run_time",
                 "ep_exp_pager_stime",
+                "ep_exp_pager_use_index",
                 "ep_expired_access",
                 "ep_expired_compactor",
                 "ep_expired_pager",
+                "ep_expiry_pager_items_visited",
                 "ep_expiry_pager_task_time",
                 "ep_failpartialwarmup",
                 "ep_flush_all",
                 "ep_flush_duration_total",
                 "ep_flushall_enabled",
+                "ep_flusher_group_commit_max_latency",
+                "ep_flusher_group_commit_max_vbuckets",
                 "ep_getl_default_timeout",
                 "ep_getl_max_timeout",
                 "ep_hlc_drift_ahead_threshold_us",
                 "ep_hlc_drift_behind_threshold_us",
+                "ep_ht_eviction_policy",
+                "ep_ht_layout",
                 "ep_ht_locks",
                 "ep_ht_resize_interval",
+                "ep_ht_resize_mode",
+                "ep_ht_resize_step_chains",
                 "ep_ht_size",
                 "ep_initfile",
                 "ep_io_compaction_read_bytes",
@@ -6672,6 +6722,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_items_rm_from_checkpoints",
                 "ep_keep_closed_chks",
                 "ep_kv_size",
+                "ep_logstore_segment_size",
                 "ep_max_bg_remaining_jobs",
                 "ep_max_checkpoints",
                 "ep_max_failover_entries",
@@ -6691,7 +6742,6 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                 "ep_mem_low_wat",
                 "ep_mem_low_wat_percent",
                 "ep_mem_merge_bytes_threshold",
-                "ep_mem_merge_count_threshold",
                 "ep_mem_tracker_enabled",
                 "ep_meta_data_disk",
                 "ep_meta_data_memory",
@@ -6926,6 +6976,8 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
         auto& vb_details = statsKeys.at("vbucket-details 0");
         vb_details.push_back("vb_0:db_data_size");
         vb_details.push_back("vb_0:db_file_size");
+        vb_details.push_back("vb_0:backfill_scans_shared");
+        vb_details.push_back("vb_0:backfill_scan_bytes_saved");
 
         auto& config_stats = statsKeys.at("config");
 
@@ -6958,6 +7010,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                          {"ep_ephemeral_full_policy",
                           "ep_ephemeral_metadata_purge_age",
                           "ep_ephemeral_metadata_purge_interval",
+                          "ep_ephemeral_seqlist_type",
 
                           "vb_active_auto_delete_count",
                           "vb_active_seqlist_count",
@@ -6966,6 +7019,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                           "vb_active_seqlist_stale_count",
                           "vb_active_seqlist_stale_value_bytes",
                           "vb_active_seqlist_stale_metadata_bytes",
+                          "vb_active_seqlist_node_bytes",
 
                           "vb_replica_auto_delete_count",
                           "vb_replica_seqlist_count",
@@ -6974,6 +7028,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                           "vb_replica_seqlist_stale_count",
                           "vb_replica_seqlist_stale_value_bytes",
                           "vb_replica_seqlist_stale_metadata_bytes",
+                          "vb_replica_seqlist_node_bytes",
 
                           "vb_pending_auto_delete_count",
                           "vb_pending_seqlist_count",
@@ -6981,7 +7036,8 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                           "vb_pending_seqlist_read_range_count",
                           "vb_pending_seqlist_stale_count",
                           "vb_pending_seqlist_stale_value_bytes",
-                          "vb_pending_seqlist_stale_metadata_bytes"});
+                          "vb_pending_seqlist_stale_metadata_bytes",
+                          "vb_pending_seqlist_node_bytes"});
 
         auto& vb_details = statsKeys.at("vbucket-details 0");
         vb_details.insert(vb_details.end(),
@@ -6990,6 +7046,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                            "vb_0:seqlist_deleted_count",
                            "vb_0:seqlist_high_seqno",
                            "vb_0:seqlist_highest_deduped_seqno",
+                           "vb_0:seqlist_node_bytes",
                            "vb_0:seqlist_range_read_begin",
                            "vb_0:seqlist_range_read_count",
                            "vb_0:seqlist_range_read_end",
@@ -7001,7 +7058,8 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
         config_stats.insert(config_stats.end(),
                             {"ep_ephemeral_full_policy",
                              "ep_ephemeral_metadata_purge_age",
-                             "ep_ephemeral_metadata_purge_interval"});
+                             "ep_ephemeral_metadata_purge_interval",
+                             "ep_ephemeral_seqlist_type"});
     }
 
     if (isTapEnabled(h, h1)) {
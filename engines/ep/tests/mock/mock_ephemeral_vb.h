@@ -22,6 +22,7 @@
 #pragma once
 
 #include "../mock/mock_basic_ll.h"
+#include "../mock/mock_skip_list.h"
 #include "config.h"
 #include "ephemeral_vb.h"
 
@@ -54,42 +55,68 @@ public:
                            std::move(newSeqnoCb),
                            config,
                            evictionPolicy) {
-        /* we want MockBasicLinkedList instead to call certain non-public
-           APIs of BasicLinkedList in ephemeral vbucket */
-        this->seqList = std::make_unique<MockBasicLinkedList>(st);
-        mockLL = dynamic_cast<MockBasicLinkedList*>((this->seqList).get());
+        /* we want MockBasicLinkedList (or MockSkipList) instead to call
+           certain non-public APIs of the list in ephemeral vbucket */
+        if (config.getEphemeralSeqlistType() == "skip_list") {
+            this->seqList = std::make_unique<MockSkipList>(st);
+            mockSL = dynamic_cast<MockSkipList*>((this->seqList).get());
+        } else {
+            this->seqList = std::make_unique<MockBasicLinkedList>(st);
+            mockLL = dynamic_cast<MockBasicLinkedList*>((this->seqList).get());
+        }
     }
 
     /* Register fake read range for testing */
     void registerFakeReadRange(seqno_t start, seqno_t end) {
-        mockLL->registerFakeReadRange(start, end);
+        if (mockSL) {
+            mockSL->registerFakeReadRange(start, end);
+        } else {
+            mockLL->registerFakeReadRange(start, end);
+        }
     }
 
     void resetReadRange() {
-        mockLL->resetReadRange();
+        if (mockSL) {
+            mockSL->resetReadRange();
+        } else {
+            mockLL->resetReadRange();
+        }
+    }
+
+    std::vector<seqno_t> public_getAllSeqnoForVerification() const {
+        return mockSL ? mockSL->getAllSeqnoForVerification()
+                      : mockLL->getAllSeqnoForVerification();
     }
 
     int public_getNumStaleItems() {
-        return mockLL->getNumStaleItems();
+        return seqList->getNumStaleItems();
     }
 
     int public_getNumListItems() {
-        return mockLL->getNumItems();
+        return seqList->getNumItems();
     }
 
     int public_getNumListDeletedItems() {
-        return mockLL->getNumDeletedItems();
+        return seqList->getNumDeletedItems();
     }
 
     uint64_t public_getListHighSeqno() const {
-        return mockLL->getHighSeqno();
+        return seqList->getHighSeqno();
+    }
+
+    /* The sequence list, of either type */
+    SequenceList* getList() {
+        return seqList.get();
     }
 
+    /* The linked list; nullptr if the vbucket uses a skip list */
     MockBasicLinkedList* getLL() {
         return mockLL;
     }
 
 private:
-    /* non owning ptr to the linkedlist in the ephemeral vbucket obj */
-    MockBasicLinkedList* mockLL;
+    /* non owning ptr to the list in the ephemeral vbucket obj; only one of
+       them is set, depending on ephemeral_seqlist_type */
+    MockBasicLinkedList* mockLL = nullptr;
+    MockSkipList* mockSL = nullptr;
 };
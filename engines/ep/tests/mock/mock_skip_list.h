@@ -0,0 +1,107 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Mock of the SkipList class. Wraps the real SkipList class and provides
+ * access to functions like getAllSeqnoForVerification().
+ */
+#pragma once
+
+#include "config.h"
+#include "skip_list.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class MockSkipList : public SkipList {
+public:
+    MockSkipList(EPStats& st) : SkipList(0, st) {
+    }
+
+    ~MockSkipList() {
+        resetReadRange();
+    }
+
+    std::vector<seqno_t> getAllSeqnoForVerification() const {
+        std::vector<seqno_t> allSeqnos;
+        std::lock_guard<std::mutex> lckGd(writeLock);
+
+        for (auto* node = head->next(0); node; node = node->next(0)) {
+            allSeqnos.push_back(node->osv->getBySeqno());
+        }
+        return allSeqnos;
+    }
+
+    /**
+     * Checks that every level is sorted by seqno, only links nodes which are
+     * on level 0 and ends at the recorded tail.
+     */
+    bool verifyLevels() const {
+        std::lock_guard<std::mutex> lckGd(writeLock);
+        std::vector<const Node*> level0;
+        for (auto* node = head->next(0); node; node = node->next(0)) {
+            level0.push_back(node);
+        }
+        if (level0.size() != numNodes) {
+            return false;
+        }
+
+        for (size_t level = 0; level < maxLevel; ++level) {
+            const Node* prev = head;
+            auto pos = level0.begin();
+            for (auto* node = head->next(level); node; node = node->next(level)) {
+                pos = std::find(pos, level0.end(), node);
+                if ((pos == level0.end()) || (level >= height) ||
+                    ((prev != head) && (seqnoOf(prev) >= seqnoOf(node)))) {
+                    return false;
+                }
+                prev = node;
+            }
+            if (tails[level] != prev) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t getNumReadRanges() const {
+        std::lock_guard<SpinLock> lh(rangeLock);
+        return readRanges.size();
+    }
+
+    /* Register fake read range for testing */
+    void registerFakeReadRange(seqno_t start, seqno_t end) {
+        std::lock_guard<SpinLock> lh(rangeLock);
+        fakeReadRange = std::make_unique<SeqRange>(start, end);
+        readRanges.push_back(fakeReadRange.get());
+    }
+
+    void resetReadRange() {
+        std::lock_guard<SpinLock> lh(rangeLock);
+        if (fakeReadRange) {
+            readRanges.erase(std::find(readRanges.begin(),
+                                       readRanges.end(),
+                                       fakeReadRange.get()));
+            fakeReadRange.reset();
+        }
+    }
+
+private:
+    std::unique_ptr<SeqRange> fakeReadRange;
+};
@@ -17,227 +17,38 @@
 
 #include "config.h"
 
-#include <gtest/gtest.h>
-#include <platform/cb_malloc.h>
-
 #include "../mock/mock_basic_ll.h"
-#include "hash_table.h"
-#include "item.h"
-#include "linked_list.h"
-#include "stats.h"
-#include "stored_value_factories.h"
-#include "tests/module_tests/test_helpers.h"
+#include "../mock/mock_skip_list.h"
+#include "seqlist_test.h"
 
 #include <limits>
 #include <vector>
 
-static EPStats global_stats;
-
-class BasicLinkedListTest : public ::testing::Test {
-public:
-    BasicLinkedListTest() : ht(global_stats, makeFactory(), 2, 1) {
-    }
-
-    static std::unique_ptr<AbstractStoredValueFactory> makeFactory() {
-        return std::make_unique<OrderedStoredValueFactory>(global_stats);
-    }
-
-protected:
-    void SetUp() {
-        basicLL = std::make_unique<MockBasicLinkedList>(global_stats);
-    }
-
-    void TearDown() {
-        /* Like in a vbucket we want the list to be erased before HashTable is
-           is destroyed. */
-        basicLL.reset();
-    }
-
-    /**
-     * Adds 'numItems' number of new items to the linked list, from startSeqno.
-     * Items to have key as keyPrefixXX, XX being the seqno.
-     *
-     * Returns the vector of seqnos added.
-     */
-    std::vector<seqno_t> addNewItemsToList(seqno_t startSeqno,
-                                           const std::string& keyPrefix,
-                                           const int numItems) {
-        const seqno_t last = startSeqno + numItems;
-        const std::string val("data");
-        OrderedStoredValue* sv;
-        std::vector<seqno_t> expectedSeqno;
-
-        /* Get a fake sequence lock */
-        std::mutex fakeSeqLock;
-        std::lock_guard<std::mutex> lg(fakeSeqLock);
-
-        for (seqno_t i = startSeqno; i < last; ++i) {
-            StoredDocKey key = makeStoredDocKey(keyPrefix + std::to_string(i));
-            Item item(key,
-                      0,
-                      0,
-                      val.data(),
-                      val.length(),
-                      /*ext_meta*/ nullptr,
-                      /*ext_len*/ 0,
-                      /*theCas*/ 0,
-                      /*bySeqno*/ i);
-            EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
-
-            sv = ht.find(key, TrackReference::Yes, WantsDeleted::No)
-                         ->toOrderedStoredValue();
-
-            std::lock_guard<std::mutex> listWriteLg(
-                    basicLL->getListWriteLock());
-            basicLL->appendToList(lg, listWriteLg, *sv);
-            basicLL->updateHighSeqno(listWriteLg, *sv);
-            expectedSeqno.push_back(i);
-        }
-        return expectedSeqno;
-    }
-
-    /**
-     * Adds one item without a seqno to the linked list
-     */
-    void addItemWithoutSeqno(const std::string& key) {
-        const std::string val("data");
-
-        /* Get a fake sequence lock */
-        std::mutex fakeSeqLock;
-        std::lock_guard<std::mutex> lg(fakeSeqLock);
-
-        StoredDocKey sKey = makeStoredDocKey(key);
-        Item item(sKey, 0, 0, sKey.data(), sKey.size());
-
-        EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
-
-        OrderedStoredValue* sv =
-                ht.find(sKey, TrackReference::Yes, WantsDeleted::No)
-                        ->toOrderedStoredValue();
-
-        std::lock_guard<std::mutex> listWriteLg(basicLL->getListWriteLock());
-        basicLL->appendToList(lg, listWriteLg, *sv);
-    }
-
-    /**
-     * Updates an existing item with key == key and assigns it a seqno of
-     * highSeqno + 1. To be called when there is no range read.
-     */
-    void updateItem(seqno_t highSeqno, const std::string& key) {
-        /* Get a fake sequence lock */
-        std::mutex fakeSeqLock;
-        std::lock_guard<std::mutex> lg(fakeSeqLock);
-
-        OrderedStoredValue* osv = ht.find(makeStoredDocKey(key),
-                                          TrackReference::No,
-                                          WantsDeleted::Yes)
-                                          ->toOrderedStoredValue();
-
-        std::lock_guard<std::mutex> listWriteLg(basicLL->getListWriteLock());
-        EXPECT_EQ(SequenceList::UpdateStatus::Success,
-                  basicLL->updateListElem(lg, listWriteLg, *osv));
-        osv->setBySeqno(highSeqno + 1);
-        basicLL->updateHighSeqno(listWriteLg, *osv);
-    }
-
-    /**
-     * Updates an existing item with key == key.
-     * To be called when there is range read.
-     */
-    void updateItemDuringRangeRead(seqno_t highSeqno, const std::string& key) {
-        const std::string val("data");
-
-        /* Get a fake sequence lock */
-        std::mutex fakeSeqLock;
-        std::lock_guard<std::mutex> lg(fakeSeqLock);
-
-        OrderedStoredValue* osv = ht.find(makeStoredDocKey(key),
-                                          TrackReference::No,
-                                          WantsDeleted::Yes)
-                                          ->toOrderedStoredValue();
-
-        std::lock_guard<std::mutex> listWriteLg(basicLL->getListWriteLock());
-        EXPECT_EQ(SequenceList::UpdateStatus::Append,
-                  basicLL->updateListElem(lg, listWriteLg, *osv));
-
-        /* Release the current sv from the HT */
-        StoredDocKey sKey = makeStoredDocKey(key);
-        auto hbl = ht.getLockedBucket(sKey);
-        auto ownedSv = ht.unlocked_release(hbl, osv->getKey());
-
-        /* Add a new storedvalue for the append */
-        Item itm(sKey,
-                 0,
-                 0,
-                 val.data(),
-                 val.length(),
-                 /*ext_meta*/ nullptr,
-                 /*ext_len*/ 0,
-                 /*theCas*/ 0,
-                 /*bySeqno*/ highSeqno + 1);
-        auto* newSv = ht.unlocked_addNewStoredValue(hbl, itm);
-        basicLL->markItemStale(listWriteLg, std::move(ownedSv), newSv);
-
-        basicLL->appendToList(
-                lg, listWriteLg, *(newSv->toOrderedStoredValue()));
-        basicLL->updateHighSeqno(listWriteLg, *(newSv->toOrderedStoredValue()));
-    }
-
-    /**
-     * Deletes an existing item with key == key, puts it onto the linked list
-     * and assigns it a seqno of highSeqno + 1.
-     * To be called when there is no range read.
-     */
-    void softDeleteItem(seqno_t highSeqno, const std::string& key) {
-        { /* hbl lock scope */
-            auto hbl = ht.getLockedBucket(makeStoredDocKey(key));
-            StoredValue* sv = ht.unlocked_find(makeStoredDocKey(key),
-                                               hbl.getBucketNum(),
-                                               WantsDeleted::Yes,
-                                               TrackReference::No);
-
-            ht.unlocked_softDelete(
-                    hbl.getHTLock(), *sv, /* onlyMarkDeleted */ false);
-        }
-
-        updateItem(highSeqno, key);
-    }
-
-    /**
-     * Release a StoredValue with 'key' from the hash table
-     */
-    StoredValue::UniquePtr releaseFromHashTable(const std::string& key) {
-        auto hbl = ht.getLockedBucket(makeStoredDocKey(key));
-        return ht.unlocked_release(hbl, makeStoredDocKey(key));
-    }
+/* The tests below are run against every SequenceList implementation */
+typedef ::testing::Types<MockBasicLinkedList, MockSkipList> SequenceListTypes;
+TYPED_TEST_CASE(SequenceListTest, SequenceListTypes);
 
-    /* We need a HashTable because StoredValue is created only in the HashTable
-       and then put onto the sequence list */
-    HashTable ht;
-    std::unique_ptr<MockBasicLinkedList> basicLL;
-};
-
-TEST_F(BasicLinkedListTest, SetItems) {
+TYPED_TEST(SequenceListTest, SetItems) {
     const int numItems = 3;
 
     /* Add 3 new items */
     std::vector<seqno_t> expectedSeqno =
-            addNewItemsToList(1, std::string("key"), numItems);
+            this->addNewItemsToList(1, std::string("key"), numItems);
 
-    EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
+    EXPECT_EQ(expectedSeqno, this->seqList->getAllSeqnoForVerification());
 }
 
-TEST_F(BasicLinkedListTest, TestRangeRead) {
+TYPED_TEST(SequenceListTest, TestRangeRead) {
     const int numItems = 3;
 
     /* Add 3 new items */
-    addNewItemsToList(1, std::string("key"), numItems);
+    this->addNewItemsToList(1, std::string("key"), numItems);
 
     /* Now do a range read */
     ENGINE_ERROR_CODE status;
     std::vector<UniqueItemPtr> items;
     seqno_t endSeqno;
-    std::tie(status, items, endSeqno) = basicLL->rangeRead(1, numItems);
+    std::tie(status, items, endSeqno) = this->seqList->rangeRead(1, numItems);
 
     EXPECT_EQ(ENGINE_SUCCESS, status);
     EXPECT_EQ(numItems, items.size());
@@ -245,18 +56,18 @@ TEST_F(BasicLinkedListTest, TestRangeRead) {
     EXPECT_EQ(numItems, endSeqno);
 }
 
-TEST_F(BasicLinkedListTest, TestRangeReadTillInf) {
+TYPED_TEST(SequenceListTest, TestRangeReadTillInf) {
     const int numItems = 3;
 
     /* Add 3 new items */
-    addNewItemsToList(1, std::string("key"), numItems);
+    this->addNewItemsToList(1, std::string("key"), numItems);
 
     /* Now do a range read */
     ENGINE_ERROR_CODE status;
     std::vector<UniqueItemPtr> items;
     seqno_t endSeqno;
     std::tie(status, items, endSeqno) =
-            basicLL->rangeRead(1, std::numeric_limits<seqno_t>::max());
+            this->seqList->rangeRead(1, std::numeric_limits<seqno_t>::max());
 
     EXPECT_EQ(ENGINE_SUCCESS, status);
     EXPECT_EQ(numItems, items.size());
@@ -264,17 +75,17 @@ TEST_F(BasicLinkedListTest, TestRangeReadTillInf) {
     EXPECT_EQ(numItems, endSeqno);
 }
 
-TEST_F(BasicLinkedListTest, TestRangeReadFromMid) {
+TYPED_TEST(SequenceListTest, TestRangeReadFromMid) {
     const int numItems = 3;
 
     /* Add 3 new items */
-    addNewItemsToList(1, std::string("key"), numItems);
+    this->addNewItemsToList(1, std::string("key"), numItems);
 
     /* Now do a range read */
     ENGINE_ERROR_CODE status;
     std::vector<UniqueItemPtr> items;
     seqno_t endSeqno;
-    std::tie(status, items, endSeqno) = basicLL->rangeRead(2, numItems);
+    std::tie(status, items, endSeqno) = this->seqList->rangeRead(2, numItems);
 
     EXPECT_EQ(ENGINE_SUCCESS, status);
     EXPECT_EQ(numItems - 1, items.size());
@@ -282,17 +93,18 @@ TEST_F(BasicLinkedListTest, TestRangeReadFromMid) {
     EXPECT_EQ(numItems, endSeqno);
 }
 
-TEST_F(BasicLinkedListTest, TestRangeReadStopBeforeEnd) {
+TYPED_TEST(SequenceListTest, TestRangeReadStopBeforeEnd) {
     const int numItems = 3;
 
     /* Add 3 new items */
-    addNewItemsToList(1, std::string("key"), numItems);
+    this->addNewItemsToList(1, std::string("key"), numItems);
 
     /* Now request for a range read of just 2 items */
     ENGINE_ERROR_CODE status;
     std::vector<UniqueItemPtr> items;
     seqno_t endSeqno;
-    std::tie(status, items, endSeqno) = basicLL->rangeRead(1, numItems - 1);
+    std::tie(status, items, endSeqno) =
+            this->seqList->rangeRead(1, numItems - 1);
 
     EXPECT_EQ(ENGINE_SUCCESS, status);
     EXPECT_EQ(numItems - 1, items.size());
@@ -300,181 +112,195 @@ TEST_F(BasicLinkedListTest, TestRangeReadStopBeforeEnd) {
     EXPECT_EQ(numItems - 1, endSeqno);
 }
 
-TEST_F(BasicLinkedListTest, TestRangeReadNegatives) {
+TYPED_TEST(SequenceListTest, TestRangeReadNegatives) {
     const int numItems = 3;
 
     /* Add 3 new items */
-    addNewItemsToList(1, std::string("key"), numItems);
+    this->addNewItemsToList(1, std::string("key"), numItems);
 
     ENGINE_ERROR_CODE status;
     std::vector<UniqueItemPtr> items;
 
     /* Now do a range read with start > end */
-    std::tie(status, items, std::ignore) = basicLL->rangeRead(2, 1);
+    std::tie(status, items, std::ignore) = this->seqList->rangeRead(2, 1);
     EXPECT_EQ(ENGINE_ERANGE, status);
 
     /* Now do a range read with start > highSeqno */
     std::tie(status, items, std::ignore) =
-            basicLL->rangeRead(numItems + 1, numItems + 2);
+            this->seqList->rangeRead(numItems + 1, numItems + 2);
     EXPECT_EQ(ENGINE_ERANGE, status);
 }
 
-TEST_F(BasicLinkedListTest, UpdateFirstElem) {
+TYPED_TEST(SequenceListTest, UpdateFirstElem) {
     const int numItems = 3;
     const std::string keyPrefix("key");
 
     /* Add 3 new items */
-    addNewItemsToList(1, keyPrefix, numItems);
+    this->addNewItemsToList(1, keyPrefix, numItems);
 
     /* Update the first item in the list */
-    updateItem(numItems, keyPrefix + std::to_string(1));
+    EXPECT_EQ(SequenceList::UpdateStatus::Success,
+              this->updateItem(numItems, keyPrefix + std::to_string(1)));
 
     /* Check if the updated element has moved to the end */
     std::vector<seqno_t> expectedSeqno = {2, 3, 4};
-    EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
+    EXPECT_EQ(expectedSeqno, this->seqList->getAllSeqnoForVerification());
 }
 
-TEST_F(BasicLinkedListTest, UpdateMiddleElem) {
+TYPED_TEST(SequenceListTest, UpdateMiddleElem) {
     const int numItems = 3;
     const std::string keyPrefix("key");
 
     /* Add 3 new items */
-    addNewItemsToList(1, keyPrefix, numItems);
+    this->addNewItemsToList(1, keyPrefix, numItems);
 
     /* Update a middle item in the list */
-    updateItem(numItems, keyPrefix + std::to_string(numItems - 1));
+    EXPECT_EQ(SequenceList::UpdateStatus::Success,
+              this->updateItem(numItems,
+                               keyPrefix + std::to_string(numItems - 1)));
 
     /* Check if the updated element has moved to the end */
     std::vector<seqno_t> expectedSeqno = {1, 3, 4};
-    EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
+    EXPECT_EQ(expectedSeqno, this->seqList->getAllSeqnoForVerification());
 }
 
-TEST_F(BasicLinkedListTest, UpdateLastElem) {
+TYPED_TEST(SequenceListTest, UpdateLastElem) {
     const int numItems = 3;
     const std::string keyPrefix("key");
 
     /* Add 3 new items */
-    addNewItemsToList(1, keyPrefix, numItems);
+    this->addNewItemsToList(1, keyPrefix, numItems);
 
     /* Update the last item in the list */
-    updateItem(numItems, keyPrefix + std::to_string(numItems));
+    EXPECT_EQ(SequenceList::UpdateStatus::Success,
+              this->updateItem(numItems,
+                               keyPrefix + std::to_string(numItems)));
 
     /* Check if the updated element has moved to the end */
     std::vector<seqno_t> expectedSeqno = {1, 2, 4};
-    EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
+    EXPECT_EQ(expectedSeqno, this->seqList->getAllSeqnoForVerification());
 }
 
-TEST_F(BasicLinkedListTest, WriteNewAfterUpdate) {
+TYPED_TEST(SequenceListTest, WriteNewAfterUpdate) {
     const int numItems = 3;
     const std::string keyPrefix("key");
 
     /* Add 3 new items */
-    addNewItemsToList(1, keyPrefix, numItems);
+    this->addNewItemsToList(1, keyPrefix, numItems);
 
     /* Update an item in the list */
-    updateItem(numItems, keyPrefix + std::to_string(numItems - 1));
+    EXPECT_EQ(SequenceList::UpdateStatus::Success,
+              this->updateItem(numItems,
+                               keyPrefix + std::to_string(numItems - 1)));
 
     /* Add a new item after update */
-    addNewItemsToList(
+    this->addNewItemsToList(
             numItems + /* +1 is update, another +1 for next */ 2, keyPrefix, 1);
 
     /* Check if the new element is added correctly */
     std::vector<seqno_t> expectedSeqno = {1, 3, 4, 5};
-    EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
+    EXPECT_EQ(expectedSeqno, this->seqList->getAllSeqnoForVerification());
 }
 
-TEST_F(BasicLinkedListTest, UpdateDuringRangeRead) {
+TYPED_TEST(SequenceListTest, UpdateDuringRangeRead) {
     const int numItems = 3;
     const std::string keyPrefix("key");
 
     /* Add 3 new items */
-    addNewItemsToList(1, keyPrefix, numItems);
+    this->addNewItemsToList(1, keyPrefix, numItems);
 
-    basicLL->registerFakeReadRange(1, numItems);
+    this->seqList->registerFakeReadRange(1, numItems);
 
     /* Update an item in the list when a fake range read is happening */
-    updateItemDuringRangeRead(numItems,
-                              keyPrefix + std::to_string(numItems - 1));
+    EXPECT_EQ(SequenceList::UpdateStatus::Append,
+              this->updateItem(numItems,
+                               keyPrefix + std::to_string(numItems - 1)));
 
     /* Check if the new element is added correctly */
     std::vector<seqno_t> expectedSeqno = {1, 2, 3, 4};
-    EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
+    EXPECT_EQ(expectedSeqno, this->seqList->getAllSeqnoForVerification());
 }
 
-TEST_F(BasicLinkedListTest, DeletedItem) {
+TYPED_TEST(SequenceListTest, DeletedItem) {
     const std::string keyPrefix("key");
     const int numItems = 1;
 
-    int numDeleted = basicLL->getNumDeletedItems();
+    int numDeleted = this->seqList->getNumDeletedItems();
 
     /* Add an item */
-    addNewItemsToList(numItems, keyPrefix, 1);
+    this->addNewItemsToList(numItems, keyPrefix, 1);
 
     /* Delete the item */
-    softDeleteItem(numItems, keyPrefix + std::to_string(numItems));
-    basicLL->updateNumDeletedItems(false, true);
+    this->softDeleteItem(numItems, keyPrefix + std::to_string(numItems));
+    this->seqList->updateNumDeletedItems(false, true);
 
     /* Check if the delete is added correctly */
     std::vector<seqno_t> expectedSeqno = {numItems + 1};
-    EXPECT_EQ(expectedSeqno, basicLL->getAllSeqnoForVerification());
-    EXPECT_EQ(numDeleted + 1, basicLL->getNumDeletedItems());
+    EXPECT_EQ(expectedSeqno, this->seqList->getAllSeqnoForVerification());
+    EXPECT_EQ(numDeleted + 1, this->seqList->getNumDeletedItems());
 }
 
-TEST_F(BasicLinkedListTest, MarkStale) {
+TYPED_TEST(SequenceListTest, MarkStale) {
     const std::string keyPrefix("key");
     const int numItems = 1;
 
     /* To begin with we expect 0 stale items */
-    EXPECT_EQ(0, basicLL->getNumStaleItems());
+    EXPECT_EQ(0, this->seqList->getNumStaleItems());
 
     /* Add an item */
-    addNewItemsToList(numItems, keyPrefix, 1);
+    this->addNewItemsToList(numItems, keyPrefix, 1);
 
     /* Release the item from the hash table */
-    auto ownedSv = releaseFromHashTable(keyPrefix + std::to_string(numItems));
+    auto ownedSv =
+            this->releaseFromHashTable(keyPrefix + std::to_string(numItems));
     OrderedStoredValue* nonOwnedSvPtr = ownedSv.get()->toOrderedStoredValue();
     size_t svSize = ownedSv->size();
     size_t svMetaDataSize = ownedSv->metaDataSize();
 
     // obtain a replacement SV
-    addNewItemsToList(numItems + 1, keyPrefix, 1);
+    this->addNewItemsToList(numItems + 1, keyPrefix, 1);
     OrderedStoredValue* replacement =
-            ht.find(makeStoredDocKey(keyPrefix + std::to_string(numItems + 1)),
-                    TrackReference::No,
-                    WantsDeleted::Yes)
+            this->ht
+                    .find(makeStoredDocKey(keyPrefix +
+                                           std::to_string(numItems + 1)),
+                          TrackReference::No,
+                          WantsDeleted::Yes)
                     ->toOrderedStoredValue();
 
     /* Mark the item stale */
     {
-        std::lock_guard<std::mutex> writeGuard(basicLL->getListWriteLock());
-        basicLL->markItemStale(writeGuard, std::move(ownedSv), replacement);
+        std::lock_guard<std::mutex> writeGuard(
+                this->seqList->getListWriteLock());
+        this->seqList->markItemStale(
+                writeGuard, std::move(ownedSv), replacement);
     }
 
     /* Check if the StoredValue is marked stale */
     {
-        std::lock_guard<std::mutex> writeGuard(basicLL->getListWriteLock());
+        std::lock_guard<std::mutex> writeGuard(
+                this->seqList->getListWriteLock());
         EXPECT_TRUE(nonOwnedSvPtr->isStale(writeGuard));
     }
 
     /* Check if the stale count incremented to 1 */
-    EXPECT_EQ(1, basicLL->getNumStaleItems());
+    EXPECT_EQ(1, this->seqList->getNumStaleItems());
 
     /* Check if the total item count in the linked list is 2 */
-    EXPECT_EQ(2, basicLL->getNumItems());
+    EXPECT_EQ(2, this->seqList->getNumItems());
 
     /* Check memory usage of the list as it owns the stale item */
-    EXPECT_EQ(svSize, basicLL->getStaleValueBytes());
-    EXPECT_EQ(svMetaDataSize, basicLL->getStaleMetadataBytes());
+    EXPECT_EQ(svSize, this->seqList->getStaleValueBytes());
+    EXPECT_EQ(svMetaDataSize, this->seqList->getStaleMetadataBytes());
 }
 
-TEST_F(BasicLinkedListTest, RangeIterator) {
+TYPED_TEST(SequenceListTest, RangeIterator) {
     const int numItems = 3;
 
     /* Add 3 new items */
     std::vector<seqno_t> expectedSeqno =
-            addNewItemsToList(1, std::string("key"), numItems);
+            this->addNewItemsToList(1, std::string("key"), numItems);
 
-    auto itr = basicLL->makeRangeIterator();
+    auto itr = this->seqList->makeRangeIterator();
 
     std::vector<seqno_t> actualSeqno;
 
@@ -486,19 +312,19 @@ TEST_F(BasicLinkedListTest, RangeIterator) {
     EXPECT_EQ(expectedSeqno, actualSeqno);
 }
 
-TEST_F(BasicLinkedListTest, RangeIteratorNoItems) {
-    auto itr = basicLL->makeRangeIterator();
+TYPED_TEST(SequenceListTest, RangeIteratorNoItems) {
+    auto itr = this->seqList->makeRangeIterator();
     /* Since there are no items in the list to iterate over, we expect itr start
        to be end */
     EXPECT_EQ(itr.curr(), itr.end());
 }
 
-TEST_F(BasicLinkedListTest, RangeIteratorSingleItem) {
+TYPED_TEST(SequenceListTest, RangeIteratorSingleItem) {
     /* Add an item */
     std::vector<seqno_t> expectedSeqno =
-            addNewItemsToList(1, std::string("key"), 1);
+            this->addNewItemsToList(1, std::string("key"), 1);
 
-    auto itr = basicLL->makeRangeIterator();
+    auto itr = this->seqList->makeRangeIterator();
 
     std::vector<seqno_t> actualSeqno;
     /* Read all the items with the iterator */
@@ -509,14 +335,14 @@ TEST_F(BasicLinkedListTest, RangeIteratorSingleItem) {
     EXPECT_EQ(expectedSeqno, actualSeqno);
 }
 
-TEST_F(BasicLinkedListTest, RangeIteratorOverflow) {
+TYPED_TEST(SequenceListTest, RangeIteratorOverflow) {
     const int numItems = 1;
     bool caughtOutofRangeExcp = false;
 
     /* Add an item */
-    addNewItemsToList(1, std::string("key"), numItems);
+    this->addNewItemsToList(1, std::string("key"), numItems);
 
-    auto itr = basicLL->makeRangeIterator();
+    auto itr = this->seqList->makeRangeIterator();
 
     /* Iterator till end */
     while (itr.curr() != itr.end()) {
@@ -532,17 +358,17 @@ TEST_F(BasicLinkedListTest, RangeIteratorOverflow) {
     EXPECT_TRUE(caughtOutofRangeExcp);
 }
 
-TEST_F(BasicLinkedListTest, RangeIteratorDeletion) {
+TYPED_TEST(SequenceListTest, RangeIteratorDeletion) {
     const int numItems = 3;
 
     /* Add 3 new items */
     std::vector<seqno_t> expectedSeqno =
-            addNewItemsToList(1, std::string("key"), numItems);
+            this->addNewItemsToList(1, std::string("key"), numItems);
 
     /* Check if second range reader can read items after the first one is
        deleted */
     for (int i = 0; i < 2; ++i) {
-        auto itr = basicLL->makeRangeIterator();
+        auto itr = this->seqList->makeRangeIterator();
         std::vector<seqno_t> actualSeqno;
 
         /* Read all the items with the iterator */
@@ -556,15 +382,15 @@ TEST_F(BasicLinkedListTest, RangeIteratorDeletion) {
     }
 }
 
-TEST_F(BasicLinkedListTest, RangeIteratorAddNewItemDuringRead) {
+TYPED_TEST(SequenceListTest, RangeIteratorAddNewItemDuringRead) {
     const int numItems = 3;
 
     /* Add 3 new items */
     std::vector<seqno_t> expectedSeqno =
-            addNewItemsToList(1, std::string("key"), numItems);
+            this->addNewItemsToList(1, std::string("key"), numItems);
 
     {
-        auto itr = basicLL->makeRangeIterator();
+        auto itr = this->seqList->makeRangeIterator();
 
         std::vector<seqno_t> actualSeqno;
 
@@ -573,7 +399,8 @@ TEST_F(BasicLinkedListTest, RangeIteratorAddNewItemDuringRead) {
         ++itr;
 
         /* Add a new item */
-        addNewItemsToList(numItems + 1 /* start */, std::string("key"), 1);
+        this->addNewItemsToList(
+                numItems + 1 /* start */, std::string("key"), 1);
 
         /* Read the other items */
         while (itr.curr() != itr.end()) {
@@ -589,7 +416,7 @@ TEST_F(BasicLinkedListTest, RangeIteratorAddNewItemDuringRead) {
     expectedSeqno.push_back(numItems + 1);
 
     {
-        auto itr = basicLL->makeRangeIterator();
+        auto itr = this->seqList->makeRangeIterator();
         std::vector<seqno_t> actualSeqno;
 
         /* Read the other items */
@@ -601,16 +428,16 @@ TEST_F(BasicLinkedListTest, RangeIteratorAddNewItemDuringRead) {
     }
 }
 
-TEST_F(BasicLinkedListTest, RangeIteratorUpdateItemDuringRead) {
+TYPED_TEST(SequenceListTest, RangeIteratorUpdateItemDuringRead) {
     const int numItems = 3;
     const std::string keyPrefix("key");
 
     /* Add 3 new items */
     std::vector<seqno_t> expectedSeqno =
-            addNewItemsToList(1, keyPrefix, numItems);
+            this->addNewItemsToList(1, keyPrefix, numItems);
 
     {
-        auto itr = basicLL->makeRangeIterator();
+        auto itr = this->seqList->makeRangeIterator();
 
         std::vector<seqno_t> actualSeqno;
 
@@ -619,8 +446,9 @@ TEST_F(BasicLinkedListTest, RangeIteratorUpdateItemDuringRead) {
         ++itr;
 
         /* Update an item */
-        updateItemDuringRangeRead(numItems /*highSeqno*/,
-                                  keyPrefix + std::to_string(2));
+        EXPECT_EQ(SequenceList::UpdateStatus::Append,
+                  this->updateItem(numItems /*highSeqno*/,
+                                   keyPrefix + std::to_string(2)));
 
         /* Read the other items */
         while (itr.curr() != itr.end()) {
@@ -636,7 +464,7 @@ TEST_F(BasicLinkedListTest, RangeIteratorUpdateItemDuringRead) {
     expectedSeqno.push_back(numItems + 1);
 
     {
-        auto itr = basicLL->makeRangeIterator();
+        auto itr = this->seqList->makeRangeIterator();
         std::vector<seqno_t> actualSeqno;
 
         /* Read the other items */
@@ -651,18 +479,18 @@ TEST_F(BasicLinkedListTest, RangeIteratorUpdateItemDuringRead) {
 /* Creates 2 range iterators such that iterator2 is created after iterator1
    has read all items, and has hence released the rangeReadLock, but before
    iterator1 is deleted */
-TEST_F(BasicLinkedListTest, MultipleRangeIterator_MB24474) {
+TYPED_TEST(SequenceListTest, MultipleRangeIterator_MB24474) {
     const int numItems = 3;
     const std::string keyPrefix("key");
 
     /* Add 3 items */
     std::vector<seqno_t> expectedSeqno =
-            addNewItemsToList(1, keyPrefix, numItems);
+            this->addNewItemsToList(1, keyPrefix, numItems);
 
     /* Create a 'RangeIterator' on the heap so that it can be deleted before
        the function scope ends */
     auto itr1 = std::make_unique<SequenceList::RangeIterator>(
-            basicLL->makeRangeIterator());
+            this->seqList->makeRangeIterator());
 
     /* Read all items */
     std::vector<seqno_t> actualSeqno;
@@ -673,7 +501,7 @@ TEST_F(BasicLinkedListTest, MultipleRangeIterator_MB24474) {
 
     /* Create another 'RangeIterator' after all items are read from itr1, but
        before itr1 is deleted */
-    auto itr2 = basicLL->makeRangeIterator();
+    auto itr2 = this->seqList->makeRangeIterator();
     itr1.reset();
 
     /* Now read the items after itr1 is deleted */
@@ -685,7 +513,7 @@ TEST_F(BasicLinkedListTest, MultipleRangeIterator_MB24474) {
     EXPECT_EQ(expectedSeqno, actualSeqno);
 }
 
-TEST_F(BasicLinkedListTest, RangeReadStopsOnInvalidSeqno) {
+TYPED_TEST(SequenceListTest, RangeReadStopsOnInvalidSeqno) {
     /* MB-24376: rangeRead has to stop if it encounters an OSV with a seqno of
      * -1; this item is definitely past the end of the rangeRead, and has not
      * yet had its seqno updated in queueDirty */
@@ -693,16 +521,50 @@ TEST_F(BasicLinkedListTest, RangeReadStopsOnInvalidSeqno) {
     const std::string keyPrefix("key");
 
     /* Add 2 new items */
-    addNewItemsToList(1, keyPrefix, numItems);
+    this->addNewItemsToList(1, keyPrefix, numItems);
 
     /* Add a key that does not yet have a vaild seqno (say -1) */
-    addItemWithoutSeqno("key3");
+    this->addItemWithoutSeqno("key3");
 
-    EXPECT_EQ(-1, basicLL->getSeqList().back().getBySeqno());
+    EXPECT_EQ(-1, this->seqList->getAllSeqnoForVerification().back());
 
-    auto res = basicLL->rangeRead(1, std::numeric_limits<seqno_t>::max());
+    auto res = this->seqList->rangeRead(1,
+                                        std::numeric_limits<seqno_t>::max());
 
     EXPECT_EQ(ENGINE_SUCCESS, std::get<0>(res));
     EXPECT_EQ(numItems, std::get<1>(res).size());
     EXPECT_EQ(numItems, std::get<2>(res));
 }
+
+/* Tests of behaviour specific to the BasicLinkedList */
+class BasicLinkedListTest : public SequenceListTest<MockBasicLinkedList> {};
+
+TEST_F(BasicLinkedListTest, RangeIteratorSeek) {
+    const int numItems = 5;
+    const std::string keyPrefix("key");
+
+    /* Add 5 items */
+    std::vector<seqno_t> expectedSeqno =
+            addNewItemsToList(1, keyPrefix, numItems);
+
+    {
+        /* Only one iterator at a time; seeking iterator is not created (rather
+           than blocking) while another one exists */
+        auto itr1 = seqList->makeRangeIterator();
+        EXPECT_FALSE(seqList->makeRangeIterator(3));
+    }
+
+    auto itr = seqList->makeRangeIterator(3);
+    ASSERT_TRUE(itr);
+    EXPECT_EQ(3, seqList->getRangeReadBegin());
+    EXPECT_EQ(numItems - 2, itr->count());
+
+    /* Read all items from seqno 3 */
+    std::vector<seqno_t> actualSeqno;
+    for (; itr->curr() != itr->end(); ++(*itr)) {
+        actualSeqno.push_back((**itr).getBySeqno());
+    }
+    EXPECT_EQ(std::vector<seqno_t>(expectedSeqno.begin() + 2,
+                                   expectedSeqno.end()),
+              actualSeqno);
+}
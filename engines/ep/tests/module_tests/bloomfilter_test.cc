@@ -14,7 +14,7 @@
  *   limitations under the License.
  */
 
-#include <unordered_set>
+#include <bitset>
 
 #include <gtest/gtest.h>
 
@@ -35,24 +35,27 @@ public:
  * for all namespaces, not checking for distribution quality etc...
  */
 TEST_P(BloomFilterDocKeyTest, check_hashing) {
-    if (std::get<0>(GetParam()) != std::get<1>(GetParam())) {
-        auto key1 = StoredDocKey("key", std::get<0>(GetParam()));
-        auto key2 = StoredDocKey("key", std::get<1>(GetParam()));
-        std::unordered_set<uint64_t> key1_hashes;
-        std::unordered_set<uint64_t> key2_hashes;
+    auto key1 = StoredDocKey("key", std::get<0>(GetParam()));
+    auto key2 = StoredDocKey("key", std::get<1>(GetParam()));
+    const auto probe1 = hashDocKey(key1);
+    const auto probe2 = hashDocKey(key2);
 
-        // Always insert the first two hashes then check every subsequent hash
-        // has no match in the set.
-        key1_hashes.insert(hashDocKey(key1, 0));
-        key2_hashes.insert(hashDocKey(key2, 0));
-        for (size_t i = 1; i < noOfHashes; i++)  {
-            EXPECT_EQ(0, key1_hashes.count(hashDocKey(key1, i)));
-            EXPECT_EQ(0, key2_hashes.count(hashDocKey(key1, i)));
-            EXPECT_EQ(0, key1_hashes.count(hashDocKey(key2, i)));
-            EXPECT_EQ(0, key2_hashes.count(hashDocKey(key2, i)));
-            key1_hashes.insert(hashDocKey(key1, i));
-            key2_hashes.insert(hashDocKey(key2, i));
+    // Every hash function must set a distinct bit within the key's block.
+    for (const auto& probe : {probe1, probe2}) {
+        EXPECT_LT(probe.block, numBlocks);
+        size_t bits = 0;
+        for (auto word : probe.mask) {
+            bits += std::bitset<64>(word).count();
         }
+        EXPECT_EQ(noOfHashes, bits);
+    }
+
+    if (std::get<0>(GetParam()) != std::get<1>(GetParam())) {
+        EXPECT_TRUE(probe1.block != probe2.block ||
+                    probe1.mask != probe2.mask);
+    } else {
+        EXPECT_EQ(probe1.block, probe2.block);
+        EXPECT_EQ(probe1.mask, probe2.mask);
     }
 }
 
@@ -89,3 +92,31 @@ INSTANTIATE_TEST_CASE_P(
         BloomFilterDocKeyTest,
         ::testing::Combine(::testing::ValuesIn(allDocNamespaces),
                            ::testing::ValuesIn(allDocNamespaces)), );
+
+// Check the filter is sized in whole blocks, has no false negatives and a
+// false positive rate close to the one requested.
+TEST(BloomFilterTest, falsePositiveRate) {
+    const size_t keyCount = 10000;
+    BloomFilter filter(keyCount, 0.01, BFILTER_ENABLED);
+    EXPECT_EQ(0, filter.getFilterSize() % 512);
+
+    for (size_t i = 0; i < keyCount; ++i) {
+        filter.addKey(makeStoredDocKey("key_" + std::to_string(i)));
+    }
+    for (size_t i = 0; i < keyCount; ++i) {
+        EXPECT_TRUE(filter.maybeKeyExists(
+                makeStoredDocKey("key_" + std::to_string(i))));
+    }
+
+    size_t falsePositives = 0;
+    const size_t misses = 100000;
+    for (size_t i = 0; i < misses; ++i) {
+        if (filter.maybeKeyExists(
+                    makeStoredDocKey("miss_" + std::to_string(i)))) {
+            ++falsePositives;
+        }
+    }
+    // A blocked filter has a slightly higher false positive rate than the
+    // classic one for the same size; allow up to double the target.
+    EXPECT_LT(double(falsePositives) / misses, 0.02);
+}
@@ -1231,3 +1231,38 @@ TYPED_TEST(CheckpointTest,
     // Test - second item (duplicate key) should return false.
     EXPECT_FALSE(this->queueNewItem("key"));
 }
+
+// A compressed value cached by a queued item (for DCP) is counted in the
+// memory usage of the checkpoint holding the item, but only once, and not
+// for items which aren't queued.
+TYPED_TEST(CheckpointTest, CompressedValueCountsTowardsMemoryUsage) {
+    std::string valueData(1024, 'x');
+    queued_item qi{new Item(makeStoredDocKey("key"),
+                            0,
+                            0,
+                            valueData.c_str(),
+                            valueData.size())};
+    qi->setVBucketId(this->vbucket->getId());
+    ASSERT_TRUE(this->manager->queueDirty(*this->vbucket,
+                                          qi,
+                                          GenerateBySeqno::Yes,
+                                          GenerateCas::Yes,
+                                          /*preLinkDocCtx*/ nullptr));
+    const size_t memUsage = this->manager->getMemoryUsage();
+
+    bool cached = true;
+    ASSERT_TRUE(qi->getCompressedValue(cached));
+    ASSERT_FALSE(cached);
+    ASSERT_GT(qi->getCompressedValMemSize(), 0);
+    this->manager->notifyValueCompressed(*qi);
+    EXPECT_EQ(memUsage + qi->getCompressedValMemSize(),
+              this->manager->getMemoryUsage());
+
+    // An item with the same key which isn't the queued one (e.g. one read
+    // by a backfill) isn't counted.
+    Item copy(*qi);
+    ASSERT_TRUE(copy.getCompressedValue(cached));
+    this->manager->notifyValueCompressed(copy);
+    EXPECT_EQ(memUsage + qi->getCompressedValMemSize(),
+              this->manager->getMemoryUsage());
+}
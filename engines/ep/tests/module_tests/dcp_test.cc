@@ -96,6 +96,11 @@ class StreamTest : public DCPTest,
 protected:
     void SetUp() override {
         bucketType = GetParam();
+        if (bucketType == "ephemeral_skip_list") {
+            /* An ephemeral bucket keeping its items in a SkipList */
+            bucketType = "ephemeral";
+            config_string += "ephemeral_seqlist_type=skip_list";
+        }
         DCPTest::SetUp();
         vb0 = engine->getVBucket(0);
         EXPECT_TRUE(vb0) << "Failed to get valid VBucket object for id 0";
@@ -486,6 +491,92 @@ TEST_P(StreamTest, BackfillOnly) {
                items are read correctly */
 }
 
+/* A backfill from memory holds a range read on the sequence list while it
+   yields on a full backfill buffer. A second backfill on the same vbucket
+   must snooze rather than block, and must run to completion once the first
+   backfill is done. (A skip list allows concurrent range reads.) */
+TEST_P(StreamTest, BackfillMemorySnoozesOnConcurrentRangeRead) {
+    if (bucketType != "ephemeral" ||
+        engine->getConfiguration().getEphemeralSeqlistType() != "linked_list") {
+        return;
+    }
+
+    /* Add 3 items */
+    int numItems = 3;
+    for (int i = 0; i < numItems; ++i) {
+        std::string key("key" + std::to_string(i));
+        store_item(vbid, key, "value");
+    }
+
+    /* Remove the checkpoint so that the DCP streams have to backfill */
+    auto& ckpt_mgr = vb0->checkpointManager;
+    ckpt_mgr.createNewCheckpoint();
+    {
+        bool new_ckpt_created;
+        std::chrono::microseconds uSleepTime(128);
+        while (static_cast<size_t>(numItems) !=
+               ckpt_mgr.removeClosedUnrefCheckpoints(*vb0, new_ckpt_created)) {
+            uSleepTime = decayingSleep(uSleepTime);
+        }
+    }
+
+    /* Set up two DCP streams on the same vbucket. AuxIO threads are zero,
+       hence the backfills scheduled by the streams do not run and we drive
+       our own backfills below */
+    setup_dcp_stream();
+    MockActiveStream* mock_stream1 =
+            static_cast<MockActiveStream*>(stream.get());
+    stream_t stream2 = new MockActiveStream(engine,
+                                            producer,
+                                            /*flags*/ 0,
+                                            /*opaque*/ 0,
+                                            *vb0,
+                                            /*st_seqno*/ 0,
+                                            /*en_seqno*/ ~0,
+                                            /*vb_uuid*/ 0xabcd,
+                                            /*snap_start_seqno*/ 0,
+                                            /*snap_end_seqno*/ ~0,
+                                            /*isKeyOnly*/ false);
+    MockActiveStream* mock_stream2 =
+            static_cast<MockActiveStream*>(stream2.get());
+    mock_stream1->transitionStateToBackfilling();
+    mock_stream2->transitionStateToBackfilling();
+    ASSERT_TRUE(mock_stream1->isBackfilling());
+    ASSERT_TRUE(mock_stream2->isBackfilling());
+
+    auto evb = std::dynamic_pointer_cast<EphemeralVBucket>(vb0);
+    active_stream_t aStream1 = dynamic_cast<ActiveStream*>(stream.get());
+    active_stream_t aStream2 = dynamic_cast<ActiveStream*>(stream2.get());
+    DCPBackfillMemoryBuffered backfill2(evb, aStream2, 1, numItems);
+    {
+        /* With a tiny backfill buffer the first backfill yields after one
+           item, holding on to its range read */
+        producer->setBackfillBufferSize(1);
+        DCPBackfillMemoryBuffered backfill1(evb, aStream1, 1, numItems);
+        EXPECT_EQ(backfill_success, backfill1.run());
+        EXPECT_EQ(1, mock_stream1->getLastReadSeqno());
+
+        /* The second backfill cannot get a range read and snoozes */
+        EXPECT_EQ(backfill_snooze, backfill2.run());
+        EXPECT_EQ(0, mock_stream2->getNumBackfillItems());
+
+        /* Let the first backfill run to completion */
+        producer->setBackfillBufferSize(20 * 1024 * 1024);
+        EXPECT_EQ(backfill_success, backfill1.run());
+        EXPECT_EQ(backfill_finished, backfill1.run());
+        EXPECT_EQ(numItems, mock_stream1->getNumBackfillItems());
+    }
+
+    /* Once the first backfill is gone the second one completes */
+    EXPECT_EQ(backfill_success, backfill2.run());
+    EXPECT_EQ(backfill_finished, backfill2.run());
+    EXPECT_EQ(numItems, mock_stream2->getLastReadSeqno());
+    EXPECT_EQ(numItems, mock_stream2->getNumBackfillItems());
+
+    mock_stream2->setDead(END_STREAM_OK);
+    producer->closeAllStreams();
+}
+
 /* Stream items from a DCP backfill with very small backfill buffer.
    However small the backfill buffer is, backfill must not stop, it must
    proceed to completion eventually */
@@ -1606,7 +1697,9 @@ TEST_F(ConnectionTest, test_mb24424_mutationResponse) {
 // Test cases which run in both Full and Value eviction
 INSTANTIATE_TEST_CASE_P(PersistentAndEphemeral,
                         StreamTest,
-                        ::testing::Values("persistent", "ephemeral"),
+                        ::testing::Values("persistent",
+                                          "ephemeral",
+                                          "ephemeral_skip_list"),
                         [](const ::testing::TestParamInfo<std::string>& info) {
                             return info.param;
                         });
@@ -1614,7 +1707,9 @@ INSTANTIATE_TEST_CASE_P(PersistentAndEphemeral,
 // Test cases which run in both Full and Value eviction
 INSTANTIATE_TEST_CASE_P(PersistentAndEphemeral,
                         CacheCallbackTest,
-                        ::testing::Values("persistent", "ephemeral"),
+                        ::testing::Values("persistent",
+                                          "ephemeral",
+                                          "ephemeral_skip_list"),
                         [](const ::testing::TestParamInfo<std::string>& info) {
                             return info.param;
                         });
@@ -53,6 +53,8 @@ TEST_F(EphemeralBucketStatTest, VBSeqlistStats) {
     EXPECT_EQ("0", stats.at("vb_0:seqlist_stale_count"));
     EXPECT_EQ("0", stats.at("vb_0:seqlist_stale_value_bytes"));
     EXPECT_EQ("0", stats.at("vb_0:seqlist_stale_metadata_bytes"));
+    EXPECT_EQ("0", stats.at("vb_0:seqlist_node_bytes"))
+        << "The linked list has no nodes of its own";
 
     // Trigger the "automatic" deletion of an item by paging it out.
     auto vb = store->getVBucket(vbid);
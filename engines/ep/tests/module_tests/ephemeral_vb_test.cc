@@ -30,9 +30,18 @@
 
 #include <thread>
 
-class EphemeralVBucketTest : public VBucketTest {
+/**
+ * Test fixture for EphemeralVBucket tests.
+ *
+ * Parameterised on the type of sequence list (ephemeral_seqlist_type) to use.
+ */
+class EphemeralVBucketTest
+        : public VBucketTestBase,
+          public ::testing::WithParamInterface<std::string> {
 protected:
     void SetUp() {
+        config.setEphemeralSeqlistType(GetParam());
+
         /* to test ephemeral vbucket specific stuff */
         mockEpheVB = new MockEphemeralVBucket(0,
                                               vbucket_state_active,
@@ -66,7 +75,7 @@ protected:
 
 // Verify that attempting to pageOut an item twice has no effect the second
 // time.
-TEST_F(EphemeralVBucketTest, DoublePageOut) {
+TEST_P(EphemeralVBucketTest, DoublePageOut) {
     auto key = makeStoredDocKey("key");
     ASSERT_EQ(AddStatus::Success, addOne(key));
     ASSERT_EQ(1, vbucket->getNumItems());
@@ -89,7 +98,7 @@ TEST_F(EphemeralVBucketTest, DoublePageOut) {
 
 // Verify that we can pageOut deleted items which have a value associated with
 // them - and afterwards the value is null.
-TEST_F(EphemeralVBucketTest, PageOutAfterDeleteWithValue) {
+TEST_P(EphemeralVBucketTest, PageOutAfterDeleteWithValue) {
     // Add an item which is marked as deleted, but has a body (e.g. system
     // XATTR).
     auto key = makeStoredDocKey("key");
@@ -114,7 +123,7 @@ TEST_F(EphemeralVBucketTest, PageOutAfterDeleteWithValue) {
 
 // NRU: check the seqlist has correct statistics for a create, pageout,
 // and (re)create of the same key.
-TEST_F(EphemeralVBucketTest, CreatePageoutCreate) {
+TEST_P(EphemeralVBucketTest, CreatePageoutCreate) {
     auto key = makeStoredDocKey("key");
 
     // Add a key, then page out.
@@ -125,13 +134,13 @@ TEST_F(EphemeralVBucketTest, CreatePageoutCreate) {
     }
     // Sanity check - should have just the one deleted item.
     ASSERT_EQ(0, vbucket->getNumItems());
-    ASSERT_EQ(1, mockEpheVB->getLL()->getNumDeletedItems());
+    ASSERT_EQ(1, mockEpheVB->public_getNumListDeletedItems());
 
     // Test: Set the key again.
     ASSERT_EQ(MutationStatus::WasDirty, setOne(key));
 
     EXPECT_EQ(1, vbucket->getNumItems());
-    EXPECT_EQ(0, mockEpheVB->getLL()->getNumDeletedItems());
+    EXPECT_EQ(0, mockEpheVB->public_getNumListDeletedItems());
 
     // Finally for good measure, delete again and check the numbers are correct.
     {
@@ -139,10 +148,10 @@ TEST_F(EphemeralVBucketTest, CreatePageoutCreate) {
         EXPECT_TRUE(vbucket->pageOut(lock_sv.first, lock_sv.second));
     }
     EXPECT_EQ(0, vbucket->getNumItems());
-    EXPECT_EQ(1, mockEpheVB->getLL()->getNumDeletedItems());
+    EXPECT_EQ(1, mockEpheVB->public_getNumListDeletedItems());
 }
 
-TEST_F(EphemeralVBucketTest, SetItems) {
+TEST_P(EphemeralVBucketTest, SetItems) {
     const int numItems = 3;
 
     auto keys = generateKeys(numItems);
@@ -152,7 +161,7 @@ TEST_F(EphemeralVBucketTest, SetItems) {
     EXPECT_EQ(numItems, vbucket->getHighSeqno());
 }
 
-TEST_F(EphemeralVBucketTest, UpdateItems) {
+TEST_P(EphemeralVBucketTest, UpdateItems) {
     /* Add 3 items and then update all of them */
     const int numItems = 3;
 
@@ -166,7 +175,7 @@ TEST_F(EphemeralVBucketTest, UpdateItems) {
     EXPECT_EQ(numItems, vbucket->getNumItems());
 }
 
-TEST_F(EphemeralVBucketTest, SoftDelete) {
+TEST_P(EphemeralVBucketTest, SoftDelete) {
     /* Add 3 items and then delete all of them */
     const int numItems = 3;
 
@@ -180,7 +189,7 @@ TEST_F(EphemeralVBucketTest, SoftDelete) {
     EXPECT_EQ(0, vbucket->getNumItems());
 }
 
-TEST_F(EphemeralVBucketTest, AddItems) {
+TEST_P(EphemeralVBucketTest, AddItems) {
     const int numItems = 3;
 
     auto keys = generateKeys(numItems);
@@ -189,7 +198,7 @@ TEST_F(EphemeralVBucketTest, AddItems) {
     EXPECT_EQ(numItems, vbucket->getHighSeqno());
 }
 
-TEST_F(EphemeralVBucketTest, AddTempItem) {
+TEST_P(EphemeralVBucketTest, AddTempItem) {
     /* Add temp item */
     EXPECT_EQ(AddStatus::BgFetch, addOneTemp(makeStoredDocKey("one")));
 
@@ -205,7 +214,7 @@ TEST_F(EphemeralVBucketTest, AddTempItem) {
     EXPECT_EQ(0, mockEpheVB->public_getListHighSeqno());
 }
 
-TEST_F(EphemeralVBucketTest, AddTempItemAndUpdate) {
+TEST_P(EphemeralVBucketTest, AddTempItemAndUpdate) {
     const StoredDocKey k = makeStoredDocKey("one");
 
     /* Add temp item */
@@ -227,7 +236,7 @@ TEST_F(EphemeralVBucketTest, AddTempItemAndUpdate) {
     EXPECT_EQ(1, mockEpheVB->public_getListHighSeqno());
 }
 
-TEST_F(EphemeralVBucketTest, AddTempItemAndSoftDelete) {
+TEST_P(EphemeralVBucketTest, AddTempItemAndSoftDelete) {
     const StoredDocKey k = makeStoredDocKey("one");
 
     /* Add temp item */
@@ -251,7 +260,7 @@ TEST_F(EphemeralVBucketTest, AddTempItemAndSoftDelete) {
     EXPECT_EQ(1, mockEpheVB->public_getListHighSeqno());
 }
 
-TEST_F(EphemeralVBucketTest, Backfill) {
+TEST_P(EphemeralVBucketTest, Backfill) {
     /* Add 3 items and get them by backfill */
     const int numItems = 3;
 
@@ -263,7 +272,7 @@ TEST_F(EphemeralVBucketTest, Backfill) {
     EXPECT_EQ(numItems, std::get<1>(res).size());
 }
 
-TEST_F(EphemeralVBucketTest, UpdateDuringBackfill) {
+TEST_P(EphemeralVBucketTest, UpdateDuringBackfill) {
     /* Add 5 items and then update all of them */
     const int numItems = 5;
 
@@ -294,7 +303,7 @@ TEST_F(EphemeralVBucketTest, UpdateDuringBackfill) {
               mockEpheVB->public_getNumListItems());
 }
 
-TEST_F(EphemeralVBucketTest, GetAndUpdateTtl) {
+TEST_P(EphemeralVBucketTest, GetAndUpdateTtl) {
     const int numItems = 2;
 
     /* Add 2 keys */
@@ -337,7 +346,7 @@ TEST_F(EphemeralVBucketTest, GetAndUpdateTtl) {
     /* There should be 1 stale item */
     EXPECT_EQ(1, mockEpheVB->public_getNumStaleItems());
 
-    auto seqNoVec = mockEpheVB->getLL()->getAllSeqnoForVerification();
+    auto seqNoVec = mockEpheVB->public_getAllSeqnoForVerification();
     seqno_t prevSeqNo = 0;
 
     for (const auto& seqNo : seqNoVec) {
@@ -346,7 +355,7 @@ TEST_F(EphemeralVBucketTest, GetAndUpdateTtl) {
     }
 }
 
-TEST_F(EphemeralVBucketTest, SoftDeleteDuringBackfill) {
+TEST_P(EphemeralVBucketTest, SoftDeleteDuringBackfill) {
     /* Add 5 items and then soft delete all of them */
     const int numItems = 5;
 
@@ -389,7 +398,7 @@ protected:
 };
 
 // Check an empty seqList is handled correctly.
-TEST_F(EphTombstoneTest, ZeroElementPurge) {
+TEST_P(EphTombstoneTest, ZeroElementPurge) {
     // Create a new empty VB (using parent class SetUp).
     EphemeralVBucketTest::SetUp();
     ASSERT_EQ(0, mockEpheVB->public_getNumListItems());
@@ -398,7 +407,7 @@ TEST_F(EphTombstoneTest, ZeroElementPurge) {
 }
 
 // Check a seqList with one element is handled correctly.
-TEST_F(EphTombstoneTest, OneElementPurge) {
+TEST_P(EphTombstoneTest, OneElementPurge) {
     // Create a new empty VB (using parent class SetUp).
     EphemeralVBucketTest::SetUp();
     ASSERT_EQ(MutationStatus::WasClean, setOne(makeStoredDocKey("one")));
@@ -408,14 +417,14 @@ TEST_F(EphTombstoneTest, OneElementPurge) {
 }
 
 // Check that nothing is purged if no items are stale.
-TEST_F(EphTombstoneTest, NoPurgeIfNoneStale) {
+TEST_P(EphTombstoneTest, NoPurgeIfNoneStale) {
     // Run purger - nothing should be removed.
     EXPECT_EQ(0, mockEpheVB->purgeTombstones(0));
     EXPECT_EQ(keys.size(), vbucket->getNumItems());
 }
 
 // Check that deletes are not purged if they are not old enough.
-TEST_F(EphTombstoneTest, NoPurgeIfNoneOldEnough) {
+TEST_P(EphTombstoneTest, NoPurgeIfNoneOldEnough) {
     // Delete the first item "now"
     softDeleteOne(keys.at(0), MutationStatus::WasDirty);
     ASSERT_EQ(2, vbucket->getNumItems());
@@ -432,7 +441,7 @@ TEST_F(EphTombstoneTest, NoPurgeIfNoneOldEnough) {
 }
 
 // Check that items should be purged when they are old enough.
-TEST_F(EphTombstoneTest, OnePurgeIfDeletedItemOld) {
+TEST_P(EphTombstoneTest, OnePurgeIfDeletedItemOld) {
     // Delete the first item "now"
     softDeleteOne(keys.at(0), MutationStatus::WasDirty);
     ASSERT_EQ(2, vbucket->getNumItems());
@@ -464,7 +473,7 @@ TEST_F(EphTombstoneTest, OnePurgeIfDeletedItemOld) {
 }
 
 // Check that deleted items can be purged immediately.
-TEST_F(EphTombstoneTest, ImmediateDeletedPurge) {
+TEST_P(EphTombstoneTest, ImmediateDeletedPurge) {
     // Advance to non-zero time.
     TimeTraveller jamesCole(10);
 
@@ -485,8 +494,11 @@ TEST_F(EphTombstoneTest, ImmediateDeletedPurge) {
     EXPECT_NE(nullptr, findValue(keys.at(2)));
 }
 
+// Tombstone purging tests which look into the BasicLinkedList.
+class EphTombstoneLinkedListTest : public EphTombstoneTest {};
+
 // Check that alive, stale items have no constraint on age.
-TEST_F(EphTombstoneTest, ImmediatePurgeOfAliveStale) {
+TEST_P(EphTombstoneLinkedListTest, ImmediatePurgeOfAliveStale) {
     // Perform a mutation on the second element, with a (fake) Range Read in
     // place; causing the initial OSV to be marked as stale and a new OSV to
     // be added for that key.
@@ -529,12 +541,12 @@ TEST_F(EphTombstoneTest, ImmediatePurgeOfAliveStale) {
 
 // Test that deleted items purged out of order are handled correctly (and
 // highestDeletedPurged is updated).
-TEST_F(EphTombstoneTest, PurgeOutOfOrder) {
+TEST_P(EphTombstoneTest, PurgeOutOfOrder) {
     // Delete the 3rd item.
     softDeleteOne(keys.at(2), MutationStatus::WasDirty);
 
     // Run the tombstone purger.
-    mockEpheVB->getLL()->resetReadRange();
+    mockEpheVB->resetReadRange();
     ASSERT_EQ(1, mockEpheVB->purgeTombstones(0));
     ASSERT_EQ(2, vbucket->getNumItems());
     EXPECT_EQ(4, vbucket->getPurgeSeqno());
@@ -552,7 +564,7 @@ TEST_F(EphTombstoneTest, PurgeOutOfOrder) {
 // Thread-safety test (intended to run via Valgrind / ASan / TSan) -
 // perform sets and deletes on 2 additional threads while the purger
 // runs constantly in the main thread.
-TEST_F(EphTombstoneTest, ConcurrentPurge) {
+TEST_P(EphTombstoneTest, ConcurrentPurge) {
     ThreadGate started(2);
     std::atomic<size_t> completed(0);
 
@@ -583,7 +595,7 @@ TEST_F(EphTombstoneTest, ConcurrentPurge) {
 
 // Test that on a double-delete (delete with a different value) the deleted time
 // is updated correctly.
-TEST_F(EphTombstoneTest, DoubleDeleteTimeCorrect) {
+TEST_P(EphTombstoneTest, DoubleDeleteTimeCorrect) {
     // Delete the first item at +0s
     auto key = keys.at(0);
     softDeleteOne(key, MutationStatus::WasDirty);
@@ -610,41 +622,41 @@ TEST_F(EphTombstoneTest, DoubleDeleteTimeCorrect) {
     EXPECT_GE(secondDelTime, initialDelTime + timeJump);
 }
 
-TEST_F(EphemeralVBucketTest, UpdateUpdatesHighestDedupedSeqno) {
+TEST_P(EphemeralVBucketTest, UpdateUpdatesHighestDedupedSeqno) {
     /* Add 3 items and then update all of them */
     const int numItems = 3;
 
     auto keys = generateKeys(numItems);
     setMany(keys, MutationStatus::WasClean);
 
-    ASSERT_EQ(0, mockEpheVB->getLL()->getHighestDedupedSeqno());
+    ASSERT_EQ(0, mockEpheVB->getList()->getHighestDedupedSeqno());
 
     /* Update the items */
     setMany(keys, MutationStatus::WasDirty);
 
-    EXPECT_EQ(6, mockEpheVB->getLL()->getHighestDedupedSeqno());
+    EXPECT_EQ(6, mockEpheVB->getList()->getHighestDedupedSeqno());
 }
 
-TEST_F(EphemeralVBucketTest, AppendUpdatesHighestDedupedSeqno) {
+TEST_P(EphemeralVBucketTest, AppendUpdatesHighestDedupedSeqno) {
     /* Add 3 items and then update all of them */
     const int numItems = 3;
 
     auto keys = generateKeys(numItems);
     setMany(keys, MutationStatus::WasClean);
 
-    ASSERT_EQ(0, mockEpheVB->getLL()->getHighestDedupedSeqno());
+    ASSERT_EQ(0, mockEpheVB->getList()->getHighestDedupedSeqno());
 
     {
-        auto itr = mockEpheVB->getLL()->makeRangeIterator();
+        auto itr = mockEpheVB->getList()->makeRangeIterator();
 
         /* Update the items */
         setMany(keys, MutationStatus::WasClean);
     }
 
-    ASSERT_EQ(6, mockEpheVB->getLL()->getHighestDedupedSeqno());
+    ASSERT_EQ(6, mockEpheVB->getList()->getHighestDedupedSeqno());
 }
 
-TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicates) {
+TEST_P(EphemeralVBucketTest, SnapshotHasNoDuplicates) {
     /* Add 2 items and then update all of them */
     const int numItems = 2;
 
@@ -652,7 +664,7 @@ TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicates) {
     setMany(keys, MutationStatus::WasClean);
 
     {
-        auto itr = mockEpheVB->getLL()->makeRangeIterator();
+        auto itr = mockEpheVB->getList()->makeRangeIterator();
 
         /* Update the items  */
         setMany(keys, MutationStatus::WasClean);
@@ -667,7 +679,7 @@ TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicates) {
     EXPECT_EQ(numItems * 2, std::get<2>(res));
 }
 
-TEST_F(EphemeralVBucketTest, SnapshotIncludesNonDuplicateStaleItems) {
+TEST_P(EphemeralVBucketTest, SnapshotIncludesNonDuplicateStaleItems) {
     /* Add 2 items and then update all of them */
     const int numItems = 2;
 
@@ -675,7 +687,7 @@ TEST_F(EphemeralVBucketTest, SnapshotIncludesNonDuplicateStaleItems) {
     setMany(keys, MutationStatus::WasClean);
 
     {
-        auto itr = mockEpheVB->getLL()->makeRangeIterator();
+        auto itr = mockEpheVB->getList()->makeRangeIterator();
 
         /* Update the items  */
         setMany(keys, MutationStatus::WasClean);
@@ -689,7 +701,7 @@ TEST_F(EphemeralVBucketTest, SnapshotIncludesNonDuplicateStaleItems) {
     EXPECT_EQ(numItems * 2, std::get<2>(res));
 }
 
-TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithInterveningItems) {
+TEST_P(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithInterveningItems) {
     // Add 3 items, begin a rangeRead, add 1 more item, then update the first 2
     const int numItems = 2;
 
@@ -701,7 +713,7 @@ TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithInterveningItems) {
     EXPECT_EQ(MutationStatus::WasClean, setOne(firstFillerKey));
 
     {
-        auto itr = mockEpheVB->getLL()->makeRangeIterator();
+        auto itr = mockEpheVB->getList()->makeRangeIterator();
 
         EXPECT_EQ(MutationStatus::WasClean, setOne(secondFillerKey));
 
@@ -718,7 +730,7 @@ TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithInterveningItems) {
     EXPECT_EQ(numItems * 3, std::get<2>(res)); // extended end of readRange
 }
 
-TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithMultipleStale) {
+TEST_P(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithMultipleStale) {
     /* repeatedly update two items, ensure the backfill ignores all stale
      * versions */
     const int numItems = 2;
@@ -730,7 +742,7 @@ TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithMultipleStale) {
     for (int i = 0; i < updateIterations; ++i) {
         /* Set up a mock backfill, cover all items */
         {
-            auto itr = mockEpheVB->getLL()->makeRangeIterator();
+            auto itr = mockEpheVB->getList()->makeRangeIterator();
             /* Update the items  */
             setMany(keys, MutationStatus::WasClean);
         }
@@ -745,3 +757,24 @@ TEST_F(EphemeralVBucketTest, SnapshotHasNoDuplicatesWithMultipleStale) {
     EXPECT_EQ(numItems * (updateIterations + 1),
               std::get<2>(res)); // extended end of readRange
 }
+
+INSTANTIATE_TEST_CASE_P(LinkedListAndSkipList,
+                        EphemeralVBucketTest,
+                        ::testing::Values("linked_list", "skip_list"),
+                        [](const ::testing::TestParamInfo<std::string>& info) {
+                            return info.param;
+                        });
+
+INSTANTIATE_TEST_CASE_P(LinkedListAndSkipList,
+                        EphTombstoneTest,
+                        ::testing::Values("linked_list", "skip_list"),
+                        [](const ::testing::TestParamInfo<std::string>& info) {
+                            return info.param;
+                        });
+
+INSTANTIATE_TEST_CASE_P(LinkedList,
+                        EphTombstoneLinkedListTest,
+                        ::testing::Values("linked_list"),
+                        [](const ::testing::TestParamInfo<std::string>& info) {
+                            return info.param;
+                        });
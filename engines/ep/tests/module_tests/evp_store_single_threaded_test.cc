@@ -19,6 +19,7 @@
 #include "../mock/mock_dcp_consumer.h"
 #include "../mock/mock_dcp_producer.h"
 #include "../mock/mock_stream.h"
+#include "dcp/backfill.h"
 #include "dcp/dcpconnmap.h"
 #include "ep_time.h"
 #include "evp_store_test.h"
@@ -675,6 +676,271 @@ TEST_F(SingleThreadedEPBucketTest, MB19892_BackfillNotDeleted) {
                       dummy_dcp_add_failover_cb));
 }
 
+// Check that the disk backfills of two streams of the same vBucket share a
+// single scan of the vBucket's file, and that both streams get every item.
+TEST_F(SingleThreadedEPBucketTest, ConcurrentBackfillsShareDiskScan) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+
+    const int numItems = 3;
+    for (int ii = 0; ii < numItems; ++ii) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(ii)), "value");
+    }
+
+    // Flush and remove the checkpoint so that the streams have to backfill,
+    // and evict the values so that they are read from disk.
+    auto vb = store->getVBuckets().getBucket(vbid);
+    auto& ckpt_mgr = vb->checkpointManager;
+    ckpt_mgr.createNewCheckpoint();
+    EXPECT_EQ(numItems, store->flushVBucket(vbid));
+    bool new_ckpt_created;
+    EXPECT_EQ(numItems,
+              ckpt_mgr.removeClosedUnrefCheckpoints(*vb, new_ckpt_created));
+    for (int ii = 0; ii < numItems; ++ii) {
+        evict_key(vbid, makeStoredDocKey("key" + std::to_string(ii)));
+    }
+
+    std::vector<mock_dcp_producer_t> producers;
+    std::vector<active_stream_t> streams;
+    for (const auto* name : {"test_producer_a", "test_producer_b"}) {
+        mock_dcp_producer_t producer = new MockDcpProducer(*engine,
+                                                           cookie,
+                                                           name,
+                                                           /*flags*/ 0,
+                                                           {/*no json*/});
+        uint64_t rollbackSeqno;
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  producer->streamRequest(/*flags*/ 0,
+                                          /*opaque*/ 0,
+                                          vbid,
+                                          /*start_seqno*/ 0,
+                                          /*end_seqno*/ -1,
+                                          /*vb_uuid*/ 0xabcd,
+                                          /*snap_start*/ 0,
+                                          /*snap_end*/ 0,
+                                          &rollbackSeqno,
+                                          fakeDcpAddFailoverLog));
+        auto stream = producer->findStream(vbid);
+        ASSERT_TRUE(stream->isBackfilling());
+        producers.push_back(producer);
+        streams.push_back(
+                active_stream_t(static_cast<ActiveStream*>(stream.get())));
+    }
+
+    // Drive the backfills directly rather than via the producers'
+    // BackfillManagerTasks, so we control the interleaving.
+    auto backfillA = vb->createDCPBackfill(*engine, streams[0], 1, numItems);
+    auto backfillB = vb->createDCPBackfill(*engine, streams[1], 1, numItems);
+
+    // A starts the scan; B joins it as nothing has been read yet.
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(backfill_success, backfillB->run());
+
+    // Running A's scan sends the items to both streams.
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(numItems, streams[0]->getLastReadSeqno());
+    EXPECT_EQ(numItems, streams[1]->getLastReadSeqno());
+
+    // Both backfills then complete without reading anything more.
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(backfill_finished, backfillA->run());
+    EXPECT_EQ(backfill_success, backfillB->run());
+    EXPECT_EQ(backfill_success, backfillB->run());
+    EXPECT_EQ(backfill_finished, backfillB->run());
+
+    using StatMap = std::map<std::string, std::string>;
+    StatMap stats;
+    auto add_stats = [](const char* key,
+                        const uint16_t klen,
+                        const char* val,
+                        const uint32_t vlen,
+                        const void* cookie) {
+        auto* stats = reinterpret_cast<StatMap*>(const_cast<void*>(cookie));
+        (*stats)[std::string(key, klen)] = std::string(val, vlen);
+    };
+    vb->addStats(/*details*/ true, add_stats, &stats);
+    EXPECT_EQ("1", stats.at("vb_0:backfill_scans_shared"));
+    EXPECT_NE("0", stats.at("vb_0:backfill_scan_bytes_saved"));
+
+    for (auto& producer : producers) {
+        producer->closeAllStreams();
+    }
+}
+
+// Check that a stream whose consumer stops acking (so its backfill buffer
+// stays full) doesn't hold up the other streams sharing its disk scan: it
+// is detached from the scan, and carries on alone once its buffer drains.
+TEST_F(SingleThreadedEPBucketTest, SharedDiskScanDetachesLaggingStream) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    // Detach as soon as a stream holds up the scan.
+    engine->getConfiguration().setDcpSharedScanDetachStallMs(0);
+
+    const int numItems = 3;
+    for (int ii = 0; ii < numItems; ++ii) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(ii)), "value");
+    }
+
+    auto vb = store->getVBuckets().getBucket(vbid);
+    auto& ckpt_mgr = vb->checkpointManager;
+    ckpt_mgr.createNewCheckpoint();
+    EXPECT_EQ(numItems, store->flushVBucket(vbid));
+    bool new_ckpt_created;
+    EXPECT_EQ(numItems,
+              ckpt_mgr.removeClosedUnrefCheckpoints(*vb, new_ckpt_created));
+    for (int ii = 0; ii < numItems; ++ii) {
+        evict_key(vbid, makeStoredDocKey("key" + std::to_string(ii)));
+    }
+
+    std::vector<mock_dcp_producer_t> producers;
+    std::vector<active_stream_t> streams;
+    for (const auto* name : {"test_producer_a", "test_producer_b"}) {
+        mock_dcp_producer_t producer = new MockDcpProducer(*engine,
+                                                           cookie,
+                                                           name,
+                                                           /*flags*/ 0,
+                                                           {/*no json*/});
+        uint64_t rollbackSeqno;
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  producer->streamRequest(/*flags*/ 0,
+                                          /*opaque*/ 0,
+                                          vbid,
+                                          /*start_seqno*/ 0,
+                                          /*end_seqno*/ -1,
+                                          /*vb_uuid*/ 0xabcd,
+                                          /*snap_start*/ 0,
+                                          /*snap_end*/ 0,
+                                          &rollbackSeqno,
+                                          fakeDcpAddFailoverLog));
+        auto stream = producer->findStream(vbid);
+        ASSERT_TRUE(stream->isBackfilling());
+        producers.push_back(producer);
+        streams.push_back(
+                active_stream_t(static_cast<ActiveStream*>(stream.get())));
+    }
+
+    // B's consumer doesn't ack anything; its buffer takes one item only.
+    producers[1]->setBackfillBufferSize(1);
+
+    auto backfillA = vb->createDCPBackfill(*engine, streams[0], 1, numItems);
+    auto backfillB = vb->createDCPBackfill(*engine, streams[1], 1, numItems);
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(backfill_success, backfillB->run());
+
+    // A's scan pauses when B refuses the second item, and B is detached.
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(2, streams[0]->getLastReadSeqno());
+    EXPECT_EQ(1, streams[1]->getLastReadSeqno());
+    EXPECT_TRUE(producers[1]->getBackfillBufferFullStatus());
+
+    // A finishes without waiting for B.
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(numItems, streams[0]->getLastReadSeqno());
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(backfill_finished, backfillA->run());
+    EXPECT_EQ(1, streams[1]->getLastReadSeqno());
+
+    // B moves onto a scan of its own, which makes no progress while its
+    // buffer is full...
+    EXPECT_EQ(backfill_success, backfillB->run());
+    EXPECT_EQ(backfill_success, backfillB->run());
+    EXPECT_EQ(1, streams[1]->getLastReadSeqno());
+
+    // ...and completes once the buffer has room again.
+    producers[1]->setBackfillBufferSize(
+            engine->getConfiguration().getDcpBackfillByteLimit());
+    EXPECT_EQ(backfill_success, backfillB->run());
+    EXPECT_EQ(numItems, streams[1]->getLastReadSeqno());
+    EXPECT_EQ(backfill_success, backfillB->run());
+    EXPECT_EQ(backfill_finished, backfillB->run());
+
+    for (auto& producer : producers) {
+        producer->closeAllStreams();
+    }
+}
+
+// Check that a stream which only pauses the shared disk scan briefly (its
+// buffer fills, then drains again as its consumer acks) stays on the scan
+// rather than starting a scan of its own.
+TEST_F(SingleThreadedEPBucketTest, SharedDiskScanKeepsBrieflyPausedStream) {
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    engine->getConfiguration().setDcpSharedScanDetachStallMs(60 * 1000);
+
+    const int numItems = 3;
+    for (int ii = 0; ii < numItems; ++ii) {
+        store_item(vbid, makeStoredDocKey("key" + std::to_string(ii)), "value");
+    }
+
+    auto vb = store->getVBuckets().getBucket(vbid);
+    auto& ckpt_mgr = vb->checkpointManager;
+    ckpt_mgr.createNewCheckpoint();
+    EXPECT_EQ(numItems, store->flushVBucket(vbid));
+    bool new_ckpt_created;
+    EXPECT_EQ(numItems,
+              ckpt_mgr.removeClosedUnrefCheckpoints(*vb, new_ckpt_created));
+    for (int ii = 0; ii < numItems; ++ii) {
+        evict_key(vbid, makeStoredDocKey("key" + std::to_string(ii)));
+    }
+
+    std::vector<mock_dcp_producer_t> producers;
+    std::vector<active_stream_t> streams;
+    for (const auto* name : {"test_producer_a", "test_producer_b"}) {
+        mock_dcp_producer_t producer = new MockDcpProducer(*engine,
+                                                           cookie,
+                                                           name,
+                                                           /*flags*/ 0,
+                                                           {/*no json*/});
+        uint64_t rollbackSeqno;
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  producer->streamRequest(/*flags*/ 0,
+                                          /*opaque*/ 0,
+                                          vbid,
+                                          /*start_seqno*/ 0,
+                                          /*end_seqno*/ -1,
+                                          /*vb_uuid*/ 0xabcd,
+                                          /*snap_start*/ 0,
+                                          /*snap_end*/ 0,
+                                          &rollbackSeqno,
+                                          fakeDcpAddFailoverLog));
+        auto stream = producer->findStream(vbid);
+        ASSERT_TRUE(stream->isBackfilling());
+        producers.push_back(producer);
+        streams.push_back(
+                active_stream_t(static_cast<ActiveStream*>(stream.get())));
+    }
+
+    // B's buffer takes one item only, until its consumer catches up.
+    producers[1]->setBackfillBufferSize(1);
+
+    auto backfillA = vb->createDCPBackfill(*engine, streams[0], 1, numItems);
+    auto backfillB = vb->createDCPBackfill(*engine, streams[1], 1, numItems);
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(backfill_success, backfillB->run());
+
+    // A's scan pauses when B refuses the second item, and again when it is
+    // resumed while B's buffer is still full.
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(2, streams[0]->getLastReadSeqno());
+    EXPECT_EQ(1, streams[1]->getLastReadSeqno());
+
+    // Once B's buffer drains the shared scan carries on for both of them;
+    // B wasn't detached so it gets the rest of the items from A's scan.
+    producers[1]->setBackfillBufferSize(
+            engine->getConfiguration().getDcpBackfillByteLimit());
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(numItems, streams[0]->getLastReadSeqno());
+    EXPECT_EQ(numItems, streams[1]->getLastReadSeqno());
+
+    EXPECT_EQ(backfill_success, backfillA->run());
+    EXPECT_EQ(backfill_finished, backfillA->run());
+    EXPECT_EQ(backfill_success, backfillB->run());
+    EXPECT_EQ(backfill_success, backfillB->run());
+    EXPECT_EQ(backfill_finished, backfillB->run());
+
+    for (auto& producer : producers) {
+        producer->closeAllStreams();
+    }
+}
+
 /*
  * Test that the DCP processor returns a 'yield' return code when
  * working on a large enough buffer size.
@@ -1127,3 +1393,37 @@ TEST_F(SingleThreadedEPBucketTest, pre_expiry_xattrs) {
              "Unexpected revision sequence number";
 
 }
+
+// Check that a group commit persists the items of several vbuckets of a shard
+// in a single commit, and completes each vbucket's flush.
+TEST_F(SingleThreadedEPBucketTest, GroupCommitFlush) {
+    const uint16_t otherVb = vbid + store->getVBuckets().getNumShards();
+    ASSERT_EQ(store->getVBuckets().getShardByVbId(vbid),
+              store->getVBuckets().getShardByVbId(otherVb));
+
+    setVBucketStateAndRunPersistTask(vbid, vbucket_state_active);
+    setVBucketStateAndRunPersistTask(otherVb, vbucket_state_active);
+
+    store_item(vbid, makeStoredDocKey("key1"), "value");
+    store_item(vbid, makeStoredDocKey("key2"), "value");
+    store_item(otherVb, makeStoredDocKey("key3"), "value");
+
+    auto& stats = engine->getEpStats();
+    const size_t commits = stats.flusherCommits;
+    std::vector<uint16_t> requeue;
+    EXPECT_EQ(3u, store->flushVBuckets({vbid, otherVb}, requeue));
+    EXPECT_TRUE(requeue.empty());
+    EXPECT_EQ(commits + 1, stats.flusherCommits.load());
+
+    EXPECT_EQ(2u, store->getVBucket(vbid)->getPersistenceSeqno());
+    EXPECT_EQ(1u, store->getVBucket(otherVb)->getPersistenceSeqno());
+    EXPECT_EQ(0u, stats.diskQueueSize.load());
+
+    // Nothing left to flush.
+    EXPECT_EQ(0u, store->flushVBuckets({vbid, otherVb}, requeue));
+    EXPECT_TRUE(requeue.empty());
+
+    // All vbuckets of a group must belong to the same shard.
+    EXPECT_THROW(store->flushVBuckets({vbid, uint16_t(vbid + 1)}, requeue),
+                 std::invalid_argument);
+}
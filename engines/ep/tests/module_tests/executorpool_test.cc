@@ -265,4 +265,172 @@ TEST_F(SingleThreadedExecutorPoolTest, ignore_duplicate_schedule) {
             << "Task should only appear once in the taskQueue";
 
     pool->cancel(taskId, true);
-}
\ No newline at end of file
+}
+
+/* Due tasks are moved into the ready queue of the thread which finds them.
+ * A thread runs its own ready tasks before looking for more eligible ones,
+ * and when it has none it steals the highest priority ready task from its
+ * siblings.
+ */
+TEST_F(SingleThreadedExecutorPoolTest, steal_ready_tasks) {
+    auto makeTask = [this](TaskId id) -> ExTask {
+        return std::make_shared<LambdaTask>(
+                taskable, id, 0, true, [] { return false; });
+    };
+    // Scheduled lowest priority first, so they are not in priority order.
+    ExTask lpTask = makeTask(TaskId::WorkLoadMonitor);
+    ExTask mpTask = makeTask(TaskId::FlushAllTask);
+    ExTask hpTask = makeTask(TaskId::PendingOpsNotification);
+    pool->schedule(lpTask);
+    pool->schedule(mpTask);
+    pool->schedule(hpTask);
+
+    TaskQueue* queue =
+            dynamic_cast<SingleThreadedExecutorPool*>(ExecutorPool::get())
+                    ->getTaskLocator()
+                    .find(hpTask->getId())
+                    ->second.second;
+    FetchingExecutorThread first(pool, NONIO_TASK_IDX, "first");
+    FetchingExecutorThread second(pool, NONIO_TASK_IDX, "second");
+
+    // The first thread takes all three and runs the highest priority one.
+    ASSERT_TRUE(queue->fetchNextTask(first, false));
+    EXPECT_EQ(hpTask, first.getCurrentTask());
+    EXPECT_EQ(2, queue->getReadyQueueSize());
+    EXPECT_EQ(0, queue->getFutureQueueSize());
+
+    // The second has nothing of its own, so steals the next one.
+    ASSERT_TRUE(queue->fetchNextTask(second, false));
+    EXPECT_EQ(mpTask, second.getCurrentTask());
+    EXPECT_EQ(1, queue->getReadyQueueSize());
+
+    // A newly due task waits until the ready tasks have been taken.
+    ExTask hpTask2 = makeTask(TaskId::PendingOpsNotification);
+    pool->schedule(hpTask2);
+    ASSERT_TRUE(queue->fetchNextTask(first, false));
+    EXPECT_EQ(lpTask, first.getCurrentTask());
+    EXPECT_EQ(0, queue->getReadyQueueSize());
+    EXPECT_EQ(1, queue->getFutureQueueSize());
+
+    second.updateCurrentTime();
+    ASSERT_TRUE(queue->fetchNextTask(second, false));
+    EXPECT_EQ(hpTask2, second.getCurrentTask());
+    EXPECT_EQ(0, queue->getFutureQueueSize());
+    EXPECT_FALSE(queue->fetchNextTask(first, false));
+    EXPECT_EQ(0,
+              dynamic_cast<SingleThreadedExecutorPool*>(ExecutorPool::get())
+                      ->getTotReadyTasks());
+
+    for (const auto& task : {lpTask, mpTask, hpTask, hpTask2}) {
+        pool->cancel(task->getId(), true);
+    }
+}
+
+/* Wake, snooze and cancel tasks from several threads at once; tasks are
+ * spread over the shards of the task locator, which must not lose (or
+ * double up) any of them.
+ */
+TEST_F(ExecutorPoolDynamicWorkerTest, concurrent_wake_snooze_cancel) {
+    const size_t numTasks = 200;
+    const size_t numThreads = 4;
+
+    std::vector<std::atomic<size_t>> runCounts(numTasks);
+    std::vector<ExTask> tasks;
+    for (size_t i = 0; i < numTasks; ++i) {
+        runCounts[i] = 0;
+        // Won't run unless woken.
+        tasks.push_back(std::make_shared<LambdaTask>(
+                taskable, TaskId::StatSnap, 600, true, [&runCounts, i] {
+                    ++runCounts[i];
+                    return false;
+                }));
+        pool->schedule(tasks.back());
+    }
+
+    // Each thread handles every numThreads'th task: odd tasks are
+    // cancelled, even tasks snoozed and then woken.
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([this, &tasks, t, numTasks, numThreads] {
+            for (size_t i = t; i < numTasks; i += numThreads) {
+                const size_t taskId = tasks[i]->getId();
+                if (i % 2) {
+                    EXPECT_TRUE(pool->cancel(taskId));
+                } else {
+                    EXPECT_TRUE(pool->snooze(taskId, 600));
+                    EXPECT_TRUE(pool->wake(taskId));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    pool->waitForEmptyTaskLocator();
+
+    for (size_t i = 0; i < numTasks; ++i) {
+        EXPECT_EQ(i % 2 ? 0u : 1u, runCounts[i].load()) << "task " << i;
+        EXPECT_EQ(TASK_DEAD, tasks[i]->getState()) << "task " << i;
+    }
+    EXPECT_FALSE(pool->wake(tasks.front()->getId()))
+            << "Completed task should have been removed from the locator";
+}
+
+/* Wake a task from several threads while other tasks are being scheduled
+ * and erased, i.e. while the task locator is being modified under the
+ * lock-free lookups.
+ */
+TEST_F(ExecutorPoolDynamicWorkerTest, wake_while_scheduling) {
+    const size_t numTasks = 500;
+    const size_t numWakers = 4;
+
+    std::atomic<size_t> wakeRuns{0};
+    // Won't run unless woken.
+    ExTask wokenTask = std::make_shared<LambdaTask>(
+            taskable, TaskId::StatSnap, 600, true, [&wakeRuns] {
+                ++wakeRuns;
+                return true;
+            });
+    const size_t wokenId = pool->schedule(wokenTask);
+
+    std::atomic<bool> scheduling{true};
+    std::vector<std::thread> wakers;
+    for (size_t t = 0; t < numWakers; ++t) {
+        wakers.emplace_back([this, wokenId, &scheduling] {
+            while (scheduling) {
+                EXPECT_TRUE(pool->wake(wokenId));
+                EXPECT_TRUE(pool->snooze(wokenId, 600));
+            }
+        });
+    }
+
+    // Tasks which run once, straight away, and are then erased.
+    std::vector<std::atomic<size_t>> runCounts(numTasks);
+    std::vector<ExTask> tasks;
+    for (size_t i = 0; i < numTasks; ++i) {
+        runCounts[i] = 0;
+        tasks.push_back(std::make_shared<LambdaTask>(
+                taskable, TaskId::StatSnap, 0, true, [&runCounts, i] {
+                    ++runCounts[i];
+                    return false;
+                }));
+        pool->schedule(tasks.back());
+    }
+    for (const auto& task : tasks) {
+        while (task->getState() != TASK_DEAD) {
+            std::this_thread::yield();
+        }
+    }
+    scheduling = false;
+    for (auto& waker : wakers) {
+        waker.join();
+    }
+
+    for (size_t i = 0; i < numTasks; ++i) {
+        EXPECT_EQ(1, runCounts[i].load()) << "task " << i;
+    }
+    EXPECT_TRUE(pool->cancel(wokenId));
+    pool->waitForEmptyTaskLocator();
+    EXPECT_LT(0, wakeRuns.load());
+}
@@ -96,12 +96,29 @@ public:
      */
     void waitForEmptyTaskLocator() {
         std::unique_lock<std::mutex> lh(tMutex);
-        tMutex.wait(lh, [this] { return taskLocator.empty(); });
+        tMutex.wait(lh, [this] { return getNumTasks() == 0; });
     }
 
     ~TestExecutorPool() = default;
 };
 
+/**
+ * An ExecutorThread which is never started; tests fetch tasks for it from a
+ * TaskQueue by hand.
+ */
+class FetchingExecutorThread : public ExecutorThread {
+public:
+    FetchingExecutorThread(ExecutorPool* pool,
+                           task_type_t type,
+                           const std::string& name)
+        : ExecutorThread(pool, type, name) {
+    }
+
+    const ExTask& getCurrentTask() const {
+        return currentTask;
+    }
+};
+
 class ExecutorPoolTest : public ::testing::Test {};
 
 class SingleThreadedExecutorPoolTest : public ::testing::Test {
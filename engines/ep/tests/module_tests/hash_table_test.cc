@@ -250,11 +250,157 @@ TEST_F(HashTableTest, Resize) {
     verifyFound(h, keys);
 }
 
+TEST_F(HashTableTest, IncrementalResize) {
+    HashTable h(global_stats, makeFactory(), 5, 3);
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    ASSERT_TRUE(h.beginIncrementalResize(769));
+    EXPECT_TRUE(h.isResizing());
+    EXPECT_EQ(769, h.getResizeTargetSize());
+    EXPECT_EQ(5, h.getResizeChainsRemaining());
+    // Only one resize at a time.
+    EXPECT_FALSE(h.beginIncrementalResize(1531));
+
+    // Part way through all items must still be found and visited.
+    ASSERT_TRUE(h.continueIncrementalResize(2));
+    EXPECT_TRUE(h.isResizing());
+    EXPECT_EQ(3, h.getResizeChainsRemaining());
+    EXPECT_EQ(2, h.getNumResizeChainsMigrated());
+    verifyFound(h, keys);
+    EXPECT_EQ(1000, count(h));
+
+    // Mutations during the resize must land in the right place.
+    auto moreKeys = generateKeys(1500, 1000);
+    storeMany(h, moreKeys);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(del(h, keys[i]));
+    }
+
+    ASSERT_TRUE(h.continueIncrementalResize(100));
+    EXPECT_FALSE(h.isResizing());
+    EXPECT_EQ(769, h.getSize());
+    EXPECT_EQ(1, h.getNumResizes());
+    EXPECT_FALSE(h.continueIncrementalResize(1));
+
+    keys.erase(keys.begin(), keys.begin() + 100);
+    verifyFound(h, keys);
+    verifyFound(h, moreKeys);
+    EXPECT_EQ(1400, count(h));
+}
+
+// A blocking resize while an incremental one is in progress should fold
+// both bucket arrays into the new table.
+TEST_F(HashTableTest, BlockingResizeDuringIncrementalResize) {
+    HashTable h(global_stats, makeFactory(), 47, 3);
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    ASSERT_TRUE(h.beginIncrementalResize(769));
+    ASSERT_TRUE(h.continueIncrementalResize(10));
+    ASSERT_TRUE(h.isResizing());
+
+    h.resize(1531);
+    EXPECT_FALSE(h.isResizing());
+    EXPECT_EQ(1531, h.getSize());
+    verifyFound(h, keys);
+    EXPECT_EQ(1000, count(h));
+}
+
+TEST_F(HashTableTest, TaggedLayoutSize) {
+    HashTable h(global_stats, makeFactory(), 5, 3, HashTable::Layout::Tagged);
+    EXPECT_EQ(HashTable::Layout::Tagged, h.getLayout());
+    // Tagged tables are always a power-of-two in size.
+    EXPECT_EQ(8, h.getSize());
+
+    h.resize(6143);
+    EXPECT_EQ(8192, h.getSize());
+    h.resize(769);
+    EXPECT_EQ(1024, h.getSize());
+}
+
+// Store many more items than fit in the TagBlocks of a small table, so most
+// lookups have to fall back to walking the overflowed chain.
+TEST_F(HashTableTest, TaggedLayoutOverflow) {
+    HashTable h(global_stats, makeFactory(), 4, 1, HashTable::Layout::Tagged);
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+    verifyFound(h, keys);
+    EXPECT_EQ(1000, count(h));
+
+    // Delete every other key; remaining keys must still be found (whether
+    // indexed in the TagBlock or only in the chain) and deleted ones not.
+    std::vector<StoredDocKey> remaining;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (i % 2) {
+            EXPECT_TRUE(del(h, keys[i]));
+        } else {
+            remaining.push_back(keys[i]);
+        }
+    }
+    verifyFound(h, remaining);
+    for (size_t i = 1; i < keys.size(); i += 2) {
+        EXPECT_FALSE(h.find(keys[i], TrackReference::No, WantsDeleted::Yes));
+    }
+
+    // Once resized the chains are short enough to be fully indexed.
+    h.resize(1024);
+    verifyFound(h, remaining);
+    EXPECT_EQ(500, count(h));
+}
+
+TEST_F(HashTableTest, TaggedLayoutAutoResize) {
+    HashTable h(global_stats, makeFactory(), 8, 3, HashTable::Layout::Tagged);
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    h.resize();
+    // 1000 items at a target load of 3 items per bucket.
+    EXPECT_EQ(512, h.getSize());
+    verifyFound(h, keys);
+
+    // Small changes in item count should not cause the size to flap.
+    EXPECT_EQ(512, h.getPreferredSize());
+}
+
+TEST_F(HashTableTest, TaggedLayoutIncrementalResize) {
+    HashTable h(global_stats, makeFactory(), 4, 3, HashTable::Layout::Tagged);
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+
+    ASSERT_TRUE(h.beginIncrementalResize(500));
+    EXPECT_EQ(512, h.getResizeTargetSize());
+    ASSERT_TRUE(h.continueIncrementalResize(2));
+    verifyFound(h, keys);
+
+    auto moreKeys = generateKeys(1200, 1000);
+    storeMany(h, moreKeys);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(del(h, keys[i]));
+    }
+
+    ASSERT_TRUE(h.continueIncrementalResize(10));
+    EXPECT_FALSE(h.isResizing());
+    EXPECT_EQ(512, h.getSize());
+
+    keys.erase(keys.begin(), keys.begin() + 100);
+    verifyFound(h, keys);
+    verifyFound(h, moreKeys);
+    EXPECT_EQ(1100, count(h));
+}
+
 class AccessGenerator : public Generator<bool> {
 public:
 
     AccessGenerator(const std::vector<StoredDocKey> &k,
-                    HashTable &h) : keys(k), ht(h), size(10000) {
+                    HashTable &h,
+                    bool incremental = false)
+        : keys(k), ht(h), size(10000), incremental(incremental) {
         std::random_shuffle(keys.begin(), keys.end());
     }
 
@@ -263,6 +409,9 @@ public:
             if (rand() % 111 == 0) {
                 resize();
             }
+            if (incremental) {
+                ht.continueIncrementalResize(1);
+            }
             del(ht, key);
         }
         return true;
@@ -271,13 +420,18 @@ public:
 private:
 
     void resize() {
-        ht.resize(size);
+        if (incremental) {
+            ht.beginIncrementalResize(size);
+        } else {
+            ht.resize(size);
+        }
         size = size == 1000 ? 3000 : 1000;
     }
 
     std::vector<StoredDocKey>  keys;
     HashTable                &ht;
     std::atomic<size_t>       size;
+    const bool                incremental;
 };
 
 TEST_F(HashTableTest, ConcurrentAccessResize) {
@@ -294,6 +448,21 @@ TEST_F(HashTableTest, ConcurrentAccessResize) {
     getCompletedThreads(4, &gen);
 }
 
+TEST_F(HashTableTest, ConcurrentAccessIncrementalResize) {
+    HashTable h(global_stats, makeFactory(), 5, 3);
+
+    auto keys = generateKeys(2000);
+    h.resize(keys.size());
+    storeMany(h, keys);
+
+    verifyFound(h, keys);
+
+    srand(918475);
+    AccessGenerator gen(keys, h, /*incremental*/ true);
+    getCompletedThreads(4, &gen);
+    EXPECT_EQ(0, h.getNumItems());
+}
+
 TEST_F(HashTableTest, AutoResize) {
     HashTable h(global_stats, makeFactory(), 5, 3);
 
@@ -507,6 +676,76 @@ TEST_F(HashTableTest, NRUMinimum) {
     EXPECT_EQ(MIN_NRU_VALUE, v->getNRUValue());
 }
 
+// Check that only find() with TrackReference::Yes updates the frequency
+// counter, and that it increases with repeated references.
+TEST_F(HashTableTest, FreqCounter) {
+    HashTable ht(global_stats, makeFactory(), 5, 1);
+    StoredDocKey key = makeStoredDocKey("key");
+
+    Item item(key, 0, 0, "value", strlen("value"));
+    EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
+
+    for (int ii = 0; ii < 100; ++ii) {
+        ht.find(key, TrackReference::No, WantsDeleted::No);
+    }
+    StoredValue* v(ht.find(key, TrackReference::No, WantsDeleted::No));
+    ASSERT_NE(nullptr, v);
+    EXPECT_EQ(StoredValue::initialFreqCount, v->getFreqCounterValue());
+
+    for (int ii = 0; ii < 1000; ++ii) {
+        ht.find(key, TrackReference::Yes, WantsDeleted::No);
+    }
+    EXPECT_GT(v->getFreqCounterValue(), StoredValue::initialFreqCount);
+}
+
+// Test that the expiry index follows the expiry time of the items.
+TEST_F(HashTableTest, ExpiryIndex) {
+    HashTable ht(global_stats, makeFactory(), 5, 1);
+    StoredDocKey key = makeStoredDocKey("key");
+    StoredDocKey noExpiry = makeStoredDocKey("noExpiry");
+
+    Item item(key, 0, 100, "value", strlen("value"));
+    EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
+    Item item2(noExpiry, 0, 0, "value", strlen("value"));
+    EXPECT_EQ(MutationStatus::WasClean, ht.set(item2));
+    EXPECT_EQ(1, ht.getExpiryIndexSize());
+    EXPECT_LT(0, ht.getExpiryIndexMemory());
+
+    // Items are due once their expiry time has passed.
+    std::vector<StoredDocKey> due;
+    ht.takeDueExpiries(100, due);
+    EXPECT_TRUE(due.empty());
+
+    // Updating the item moves it within the index.
+    Item update(key, 0, 200, "value", strlen("value"));
+    EXPECT_EQ(MutationStatus::WasClean, ht.set(update));
+    EXPECT_EQ(1, ht.getExpiryIndexSize());
+    ht.takeDueExpiries(150, due);
+    EXPECT_TRUE(due.empty());
+    ht.takeDueExpiries(201, due);
+    ASSERT_EQ(1, due.size());
+    EXPECT_EQ(key, due[0]);
+    EXPECT_EQ(0, ht.getExpiryIndexSize());
+    EXPECT_EQ(0, ht.getExpiryIndexMemory());
+
+    {
+        auto hbl = ht.getLockedBucket(key);
+        StoredValue* v = ht.unlocked_find(
+                key, hbl.getBucketNum(), WantsDeleted::No, TrackReference::No);
+        ASSERT_NE(nullptr, v);
+        ht.unlocked_reindexExpiry(hbl.getHTLock(), *v);
+        EXPECT_EQ(1, ht.getExpiryIndexSize());
+        ht.unlocked_setExptime(hbl.getHTLock(), *v, 0);
+        EXPECT_EQ(0, ht.getExpiryIndexSize());
+        ht.unlocked_setExptime(hbl.getHTLock(), *v, 300);
+        EXPECT_EQ(1, ht.getExpiryIndexSize());
+    }
+
+    // Deleted items are removed from the index.
+    EXPECT_TRUE(del(ht, key));
+    EXPECT_EQ(0, ht.getExpiryIndexSize());
+}
+
 /* Test release from HT (but not deletion) of an (HT) element */
 TEST_F(HashTableTest, ReleaseItem) {
     /* Setup with 2 hash buckets and 1 lock */
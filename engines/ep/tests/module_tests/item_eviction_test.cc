@@ -0,0 +1,98 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/**
+ * Unit tests for the frequency eviction policy building blocks
+ * (ItemEviction and ProbabilisticCounter).
+ */
+
+#include "item_eviction.h"
+#include "probabilistic_counter.h"
+
+#include <gtest/gtest.h>
+
+TEST(ItemEvictionTest, EmptyThreshold) {
+    ItemEviction eviction;
+    EXPECT_TRUE(eviction.isLearning());
+    EXPECT_EQ(0, eviction.getFreqThreshold(0.5));
+}
+
+TEST(ItemEvictionTest, Learning) {
+    ItemEviction eviction;
+    for (uint64_t ii = 0; ii < ItemEviction::learningPopulation - 1; ++ii) {
+        eviction.addFreqValue(1);
+    }
+    EXPECT_TRUE(eviction.isLearning());
+    eviction.addFreqValue(1);
+    EXPECT_FALSE(eviction.isLearning());
+    EXPECT_EQ(ItemEviction::learningPopulation, eviction.getValueCount());
+
+    eviction.reset();
+    EXPECT_TRUE(eviction.isLearning());
+    EXPECT_EQ(0, eviction.getValueCount());
+}
+
+TEST(ItemEvictionTest, Threshold) {
+    ItemEviction eviction;
+    // 100 values: one each of 0..99
+    for (int ii = 0; ii < 100; ++ii) {
+        eviction.addFreqValue(uint8_t(ii));
+    }
+    EXPECT_EQ(0, eviction.getFreqThreshold(0));
+    EXPECT_EQ(9, eviction.getFreqThreshold(0.1));
+    EXPECT_EQ(49, eviction.getFreqThreshold(0.5));
+    EXPECT_EQ(98, eviction.getFreqThreshold(0.99));
+    EXPECT_EQ(255, eviction.getFreqThreshold(1));
+}
+
+TEST(ItemEvictionTest, ThresholdSkewed) {
+    ItemEviction eviction;
+    // Most items are cold; a few are hot.
+    for (int ii = 0; ii < 90; ++ii) {
+        eviction.addFreqValue(4);
+    }
+    for (int ii = 0; ii < 10; ++ii) {
+        eviction.addFreqValue(200);
+    }
+    EXPECT_EQ(4, eviction.getFreqThreshold(0.5));
+    EXPECT_EQ(4, eviction.getFreqThreshold(0.9));
+    EXPECT_EQ(200, eviction.getFreqThreshold(0.91));
+}
+
+TEST(ProbabilisticCounterTest, Saturates) {
+    ProbabilisticCounter<uint8_t> counter;
+    uint8_t value = 0;
+    size_t increments = 0;
+    while (value != std::numeric_limits<uint8_t>::max()) {
+        const uint8_t next = counter.generateValue(value);
+        ASSERT_TRUE(next == value || next == value + 1);
+        value = next;
+        ++increments;
+    }
+    // With the default incFactor the counter should take in the order of
+    // 65,000 increments to saturate.
+    EXPECT_GT(increments, 30000);
+    EXPECT_LT(increments, 130000);
+    EXPECT_EQ(value, counter.generateValue(value));
+}
+
+TEST(ProbabilisticCounterTest, ZeroAlwaysIncrements) {
+    ProbabilisticCounter<uint8_t> counter;
+    for (int ii = 0; ii < 100; ++ii) {
+        EXPECT_EQ(1, counter.generateValue(0));
+    }
+}
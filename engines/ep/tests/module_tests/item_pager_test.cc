@@ -243,6 +243,70 @@ TEST_P(STItemPagerTest, ExpiredItemsDeletedFirst) {
     }
 }
 
+/**
+ * Test fixture for item pager tests using the frequency eviction policy.
+ */
+class STItemPagerFrequencyTest : public STItemPagerTest {
+protected:
+    void SetUp() override {
+        config_string += "ht_eviction_policy=frequency;";
+        STItemPagerTest::SetUp();
+    }
+};
+
+// Test that the frequency eviction policy pages out items in a single pass,
+// and keeps the frequently accessed items resident.
+TEST_P(STItemPagerFrequencyTest, FrequentlyAccessedItemsKept) {
+    size_t count = 0;
+    const std::string value(512, 'x'); // 512B value to use for documents.
+    ENGINE_ERROR_CODE result;
+    for (result = ENGINE_SUCCESS; result == ENGINE_SUCCESS; count++) {
+        auto item = make_item(vbid,
+                              makeStoredDocKey("key_" + std::to_string(count)),
+                              value);
+        uint64_t cas;
+        result = engine->store(nullptr, &item, &cas, OPERATION_SET);
+    }
+    ASSERT_EQ(ENGINE_TMPFAIL, result);
+    ASSERT_GE(count, 50) << "Too few documents stored";
+
+    // Access every 10th document frequently.
+    const size_t hotStride = 10;
+    for (size_t ii = 0; ii < count - 1; ii += hotStride) {
+        auto key = makeStoredDocKey("key_" + std::to_string(ii));
+        for (int jj = 0; jj < 1000; ++jj) {
+            ASSERT_EQ(ENGINE_SUCCESS,
+                      store->get(key, vbid, nullptr, TRACK_REFERENCE)
+                              .getStatus());
+        }
+    }
+
+    store->getVBucket(vbid)->checkpointManager.createNewCheckpoint();
+    if (GetParam() == "persistent") {
+        store->flushVBucket(vbid);
+    }
+
+    auto& stats = engine->getEpStats();
+    const size_t memBefore = stats.getTotalMemoryUsed();
+    runItemPager();
+    EXPECT_LT(stats.getTotalMemoryUsed(), memBefore)
+            << "Expected the item pager to free memory";
+
+    auto vb = store->getVBucket(vbid);
+    size_t coldEvicted = 0;
+    for (size_t ii = 0; ii < count - 1; ++ii) {
+        auto key = makeStoredDocKey("key_" + std::to_string(ii));
+        auto* v = vb->ht.find(key, TrackReference::No, WantsDeleted::No);
+        const bool resident = v != nullptr && v->isResident();
+        if (ii % hotStride == 0) {
+            EXPECT_TRUE(resident) << "Hot key evicted:" << key;
+        } else if (!resident) {
+            ++coldEvicted;
+        }
+    }
+    EXPECT_GT(coldEvicted, 0);
+}
+
 /**
  * Test fixture for Ephemeral-only item pager tests.
  */
@@ -435,6 +499,107 @@ TEST_P(STExpiryPagerTest, ExpiredItemsDeleted) {
     << "Key with TTL:20 should be removed.";
 }
 
+// Test that the expiry pager only visits the items due to expire (found via
+// the expiry index), and that a touch moves an item within the index.
+TEST_P(STExpiryPagerTest, OnlyDueItemsVisited) {
+    const std::string value(512, 'x');
+    for (size_t ii = 0; ii < 10; ii++) {
+        auto key = makeStoredDocKey("key_" + std::to_string(ii));
+        // key_0 & key_1 expire in 10 seconds, the rest never expire.
+        const uint32_t expiry =
+                ii < 2 ? ep_abs_time(ep_current_time() + 10) : 0;
+        auto item = make_item(vbid, key, value, expiry);
+        uint64_t cas;
+        ASSERT_EQ(ENGINE_SUCCESS,
+                  engine->store(nullptr, &item, &cas, OPERATION_SET));
+    }
+    if (GetParam() == "persistent") {
+        EXPECT_EQ(10, store->flushVBucket(vbid));
+    }
+    EXPECT_EQ(2, engine->getVBucket(vbid)->ht.getExpiryIndexSize());
+
+    // Extend the expiry time of key_1 to 30 seconds.
+    auto key_1 = makeStoredDocKey("key_1");
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->getAndUpdateTtl(key_1,
+                                     vbid,
+                                     cookie,
+                                     ep_abs_time(ep_current_time() + 30))
+                      .getStatus());
+    if (GetParam() == "persistent") {
+        EXPECT_EQ(1, store->flushVBucket(vbid));
+    }
+
+    auto& stats = engine->getEpStats();
+    const size_t visited = stats.expiryPagerItemsVisited;
+
+    TimeTraveller bill(11);
+    runExpiryPager();
+    if (GetParam() == "persistent") {
+        EXPECT_EQ(1, store->flushVBucket(vbid));
+    }
+
+    EXPECT_EQ(9, engine->getVBucket(vbid)->getNumItems());
+    EXPECT_EQ(1, stats.expiryPagerItemsVisited - visited)
+            << "Only key_0 should have been visited";
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->get(key_1, vbid, nullptr, get_options_t()).getStatus());
+    EXPECT_EQ(1, engine->getVBucket(vbid)->ht.getExpiryIndexSize());
+
+    TimeTraveller ted(20);
+    runExpiryPager();
+    if (GetParam() == "persistent") {
+        EXPECT_EQ(1, store->flushVBucket(vbid));
+    }
+
+    EXPECT_EQ(8, engine->getVBucket(vbid)->getNumItems());
+    EXPECT_EQ(2, stats.expiryPagerItemsVisited - visited);
+    EXPECT_EQ(0, engine->getVBucket(vbid)->ht.getExpiryIndexSize());
+}
+
+// Test that an item taken from the expiry index but not expired (as the
+// vBucket is no longer active) is put back into the index.
+TEST_P(STExpiryPagerTest, SkippedItemReindexed) {
+    auto key = makeStoredDocKey("key");
+    auto item = make_item(
+            vbid, key, "value", ep_abs_time(ep_current_time() + 10));
+    uint64_t cas;
+    ASSERT_EQ(ENGINE_SUCCESS,
+              engine->store(nullptr, &item, &cas, OPERATION_SET));
+    if (GetParam() == "persistent") {
+        EXPECT_EQ(1, store->flushVBucket(vbid));
+    }
+
+    TimeTraveller bill(11);
+    auto vb = engine->getVBucket(vbid);
+    std::vector<StoredDocKey> due;
+    vb->ht.takeDueExpiries(ep_real_time(), due);
+    ASSERT_EQ(1, due.size());
+    EXPECT_EQ(0, vb->ht.getExpiryIndexSize());
+
+    // The vBucket changes state before the pager deletes the item.
+    store->setVBucketState(vbid, vbucket_state_replica, false);
+    std::unique_ptr<Item> expired;
+    {
+        auto hbl = vb->ht.getLockedBucket(key);
+        StoredValue* v = vb->ht.unlocked_find(
+                key, hbl.getBucketNum(), WantsDeleted::No, TrackReference::No);
+        ASSERT_NE(nullptr, v);
+        expired = v->toItem(false, vbid);
+    }
+    store->deleteExpiredItem(*expired, ep_real_time(), ExpireBy::Pager);
+    EXPECT_EQ(1, vb->ht.getExpiryIndexSize());
+
+    // Once active again the item is found via the index and expired.
+    store->setVBucketState(vbid, vbucket_state_active, false);
+    runExpiryPager();
+    if (GetParam() == "persistent") {
+        EXPECT_EQ(1, store->flushVBucket(vbid));
+    }
+    EXPECT_EQ(0, vb->getNumItems());
+    EXPECT_EQ(0, vb->ht.getExpiryIndexSize());
+}
+
 // TODO: Ideally all of these tests should run with or without jemalloc,
 // however we currently rely on jemalloc for accurate memory tracking; and
 // hence it is required currently.
@@ -453,6 +618,13 @@ INSTANTIATE_TEST_CASE_P(EphemeralOrPersistent,
                             return info.param;
                         });
 
+INSTANTIATE_TEST_CASE_P(EphemeralOrPersistent,
+                        STItemPagerFrequencyTest,
+                        ::testing::Values("ephemeral", "persistent"),
+                        [](const ::testing::TestParamInfo<std::string>& info) {
+                            return info.param;
+                        });
+
 INSTANTIATE_TEST_CASE_P(Ephemeral,
                         STEphemeralItemPagerTest,
                         ::testing::Values("ephemeral"),
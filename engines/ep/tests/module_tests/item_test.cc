@@ -65,3 +65,67 @@ TEST_F(ItemTest, getAndSetCachedDataType) {
     EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON,
               (PROTOCOL_BINARY_DATATYPE_JSON & item->getDataType()));
 }
+
+// A raw reference taken on a shared item keeps it alive after the last
+// RCPtr to it has gone, and only the final release should delete it.
+TEST_F(ItemTest, rawRefOutlivesRCPtr) {
+    std::string valueData = R"(raw data)";
+    item = std::make_unique<Item>(
+            makeStoredDocKey("key"),
+            0,
+            0,
+            valueData.c_str(),
+            valueData.size());
+
+    Item* raw = item.get();
+    raw->acquireRawRef();
+    item.reset();
+
+    // Still accessible via the raw reference.
+    EXPECT_EQ(valueData, std::string(raw->getData(), raw->getNBytes()));
+    EXPECT_TRUE(raw->releaseRawRef());
+    delete raw;
+
+    // An item which was never reference counted can be deleted straight
+    // away.
+    auto unshared = std::make_unique<Item>(makeStoredDocKey("key"),
+                                           0,
+                                           0,
+                                           valueData.c_str(),
+                                           valueData.size());
+    EXPECT_TRUE(unshared->releaseRawRef());
+}
+
+// The compressed value is built once and then shared by every caller.
+TEST_F(ItemTest, getCompressedValueIsShared) {
+    std::string valueData(1024, 'x');
+    item = std::make_unique<Item>(makeStoredDocKey("key"),
+                                  0,
+                                  0,
+                                  valueData.c_str(),
+                                  valueData.size());
+    item->setDataType(PROTOCOL_BINARY_DATATYPE_JSON);
+
+    bool cached = true;
+    value_t first = item->getCompressedValue(cached);
+    ASSERT_TRUE(first);
+    EXPECT_FALSE(cached);
+    EXPECT_LT(first->vlength(), valueData.size());
+
+    value_t second = item->getCompressedValue(cached);
+    EXPECT_TRUE(cached);
+    EXPECT_EQ(first.get(), second.get());
+
+    // A copy of the item can take on the compressed value without
+    // affecting the original.
+    Item copy(*item);
+    copy.setCompressedValue(second);
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON | PROTOCOL_BINARY_DATATYPE_SNAPPY,
+              copy.getDataType());
+    EXPECT_EQ(first.get(), copy.getValue().get());
+    EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, item->getDataType());
+    EXPECT_EQ(valueData.size(), item->getNBytes());
+
+    EXPECT_TRUE(copy.decompressValue());
+    EXPECT_EQ(valueData, std::string(copy.getData(), copy.getNBytes()));
+}
@@ -36,6 +36,7 @@
 #include "tasks.h"
 #include "tests/mock/mock_global_task.h"
 #include "tests/module_tests/test_helpers.h"
+#include "vbucket_bgfetch_item.h"
 #include "vbucketdeletiontask.h"
 
 #include <platform/dirutils.h>
@@ -389,6 +390,119 @@ TEST_P(KVBucketParamTest, GetKeyStatsNMVB) {
                                    WantsDeleted::No));
 }
 
+// getMulti tests /////////////////////////////////////////////////////////////
+
+// Check getMulti returns a result per key, in order, for resident, missing
+// and not-my-vbucket keys.
+TEST_P(KVBucketParamTest, GetMulti) {
+    store_item(vbid, makeStoredDocKey("key1"), "value1");
+    store_item(vbid, makeStoredDocKey("key3"), "value3");
+
+    const auto key1 = makeStoredDocKey("key1");
+    const auto key2 = makeStoredDocKey("key2");
+    const auto key3 = makeStoredDocKey("key3");
+    auto options = static_cast<get_options_t>(HONOR_STATES | TRACK_REFERENCE);
+
+    auto batch = std::make_shared<GetMultiBatch>(cookie);
+    auto values = store->getMulti(vbid, {key1, key2, key3}, batch, options);
+    ASSERT_EQ(3u, values.size());
+    EXPECT_EQ(ENGINE_SUCCESS, values[0].getStatus());
+    ASSERT_TRUE(values[0].item);
+    EXPECT_EQ(key1, values[0].item->getKey());
+    EXPECT_EQ(ENGINE_KEY_ENOENT, values[1].getStatus());
+    EXPECT_EQ(ENGINE_SUCCESS, values[2].getStatus());
+    ASSERT_TRUE(values[2].item);
+    EXPECT_EQ(key3, values[2].item->getKey());
+
+    values = store->getMulti(vbid + 1, {key1, key2}, batch, options);
+    ASSERT_EQ(2u, values.size());
+    EXPECT_EQ(ENGINE_NOT_MY_VBUCKET, values[0].getStatus());
+    EXPECT_EQ(ENGINE_NOT_MY_VBUCKET, values[1].getStatus());
+
+    // Nothing had to wait, so ours is the only reference on the batch.
+    EXPECT_TRUE(batch->release());
+}
+
+// Check a batched get through the engine records every key in the get_cmd
+// timings, as individual gets do.
+TEST_P(KVBucketParamTest, GetMultiTimings) {
+    store_item(vbid, makeStoredDocKey("key1"), "value1");
+    auto& histo = engine->getEpStats().getCmdHisto;
+    const auto before = histo.total();
+
+    auto values = engine->getMulti(cookie,
+                                   {{makeStoredDocKey("key1"), vbid},
+                                    {makeStoredDocKey("key2"), vbid}},
+                                   static_cast<get_options_t>(
+                                           HONOR_STATES | TRACK_REFERENCE));
+    ASSERT_EQ(2u, values.size());
+    EXPECT_EQ(cb::engine_errc::success, values[0].first);
+    EXPECT_EQ(cb::engine_errc::no_such_key, values[1].first);
+    EXPECT_EQ(before + 2, histo.total());
+}
+
+// Check every key in a batch against a pending vbucket blocks, waiting on a
+// single pending op.
+TEST_P(KVBucketParamTest, GetMultiPendingVB) {
+    store->setVBucketState(vbid, vbucket_state_pending, false);
+    auto options = static_cast<get_options_t>(HONOR_STATES | TRACK_REFERENCE);
+    auto batch = std::make_shared<GetMultiBatch>(cookie);
+    auto values = store->getMulti(vbid,
+                                  {makeStoredDocKey("key1"),
+                                   makeStoredDocKey("key2")},
+                                  batch,
+                                  options);
+    ASSERT_EQ(2u, values.size());
+    EXPECT_EQ(ENGINE_EWOULDBLOCK, values[0].getStatus());
+    EXPECT_EQ(ENGINE_EWOULDBLOCK, values[1].getStatus());
+    EXPECT_EQ(1u, engine->getEpStats().pendingOps);
+
+    // The pending op still holds a reference.
+    EXPECT_FALSE(batch->release());
+}
+
+// Check the non-resident keys of a batch are handed to the background
+// fetcher together, and the batch is complete once that fetch has run.
+TEST_P(KVBucketParamTest, GetMultiBgFetch) {
+    if (engine->getConfiguration().getBucketType() != "persistent") {
+        return;
+    }
+
+    const auto key1 = makeStoredDocKey("key1");
+    const auto key2 = makeStoredDocKey("key2");
+    const auto key3 = makeStoredDocKey("key3");
+    store_item(vbid, key1, "value1");
+    store_item(vbid, key2, "value2");
+    store_item(vbid, key3, "value3");
+    flush_vbucket_to_disk(vbid, 3);
+    evict_key(vbid, key1);
+    evict_key(vbid, key3);
+
+    auto& stats = engine->getEpStats();
+    auto options = static_cast<get_options_t>(QUEUE_BG_FETCH | HONOR_STATES |
+                                              TRACK_REFERENCE);
+    auto batch = std::make_shared<GetMultiBatch>(cookie);
+    auto values = store->getMulti(vbid, {key1, key2, key3}, batch, options);
+    ASSERT_EQ(3u, values.size());
+    EXPECT_EQ(ENGINE_EWOULDBLOCK, values[0].getStatus());
+    EXPECT_EQ(ENGINE_SUCCESS, values[1].getStatus());
+    EXPECT_EQ(ENGINE_EWOULDBLOCK, values[2].getStatus());
+    EXPECT_EQ(2u, stats.numRemainingBgItems);
+
+    // Both fetches are still outstanding.
+    EXPECT_FALSE(batch->release());
+
+    MockGlobalTask mockTask(engine->getTaskable(), TaskId::MultiBGFetcherTask);
+    store->getVBucket(vbid)->getShard()->getBgFetcher()->run(&mockTask);
+    EXPECT_EQ(0u, stats.numRemainingBgItems);
+
+    // Both keys were fetched by the one run of the fetcher.
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->get(key1, vbid, cookie, options).getStatus());
+    EXPECT_EQ(ENGINE_SUCCESS,
+              store->get(key3, vbid, cookie, options).getStatus());
+}
+
 // Replace tests //////////////////////////////////////////////////////////////
 
 // Test replace against a non-existent key.
@@ -22,6 +22,7 @@
 #include "callbacks.h"
 #include "couch-kvstore/couch-kvstore.h"
 #include "kvstore.h"
+#include "log-kvstore/log-kvstore.h"
 #include "src/internal.h"
 #include "tests/module_tests/test_helpers.h"
 #include "tests/test_fileops.h"
@@ -30,6 +31,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <kvstore.h>
+#include <fstream>
+#include <limits>
 #include <unordered_map>
 #include <vector>
 
@@ -205,8 +208,8 @@ static void add_stat_callback(const char *key, const uint16_t klen,
 }
 
 /**
- * Test fixture for KVStore tests. Inherited by both ForestDB and
- * Couchstore test fixtures.
+ * Test fixture for KVStore tests. Inherited by the backend specific test
+ * fixtures.
  **/
 class KVStoreTest : public ::testing::Test {
 protected:
@@ -223,17 +226,21 @@ protected:
     std::string data_dir;
 };
 
-/// Test fixture for tests which run on both Couchstore and ForestDB.
-class CouchAndForestTest : public KVStoreTest,
-                           public ::testing::WithParamInterface<std::string> {
+/// Test fixture for tests which run on every KVStore backend.
+class KVStoreParamTest : public KVStoreTest,
+                         public ::testing::WithParamInterface<std::string> {
 };
 
 /// Test fixture for tests which run only on Couchstore.
 class CouchKVStoreTest : public KVStoreTest {
 };
 
+/// Test fixture for tests which run only on LogKVStore.
+class LogKVStoreTest : public KVStoreTest {
+};
+
 /* Test basic set / get of a document */
-TEST_P(CouchAndForestTest, BasicTest) {
+TEST_P(KVStoreParamTest, BasicTest) {
     KVStoreConfig config(
             1024, 4, data_dir, GetParam(), 0, false /*persistnamespace*/);
     auto kvstore = setup_kv_store(config);
@@ -250,6 +257,578 @@ TEST_P(CouchAndForestTest, BasicTest) {
     checkGetValue(gv);
 }
 
+/* Test a by-seqno scan (as used by DCP backfill) only returns the latest
+ * version of each document, in seqno order */
+TEST_P(KVStoreParamTest, SeqnoScanTest) {
+    KVStoreConfig config(
+            1024, 4, data_dir, GetParam(), 0, false /*persistnamespace*/);
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin();
+    WriteCallback wc;
+    for (int i = 1; i <= 5; i++) {
+        Item item(makeStoredDocKey("key" + std::to_string(i)),
+                  0, 0, "value", 5, nullptr, 0, 0, i);
+        kvstore->set(item, wc);
+    }
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    // Update key1; its original version must not be returned.
+    kvstore->begin();
+    Item item(makeStoredDocKey("key1"), 0, 0, "value", 5, nullptr, 0, 0, 6);
+    kvstore->set(item, wc);
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    std::vector<int64_t> seqnos;
+    auto cb = std::make_shared<CustomCallback<GetValue>>(
+            [&seqnos](GetValue result) {
+                ASSERT_EQ(ENGINE_SUCCESS, result.getStatus());
+                seqnos.push_back(result.item->getBySeqno());
+            });
+    std::shared_ptr<Callback<CacheLookup>> cl(
+            new KVStoreTestCacheCallback(2, 6, 0));
+    ScanContext* scanCtx =
+            kvstore->initScanContext(cb,
+                                     cl,
+                                     0,
+                                     2,
+                                     DocumentFilter::ALL_ITEMS,
+                                     ValueFilter::VALUES_DECOMPRESSED);
+    ASSERT_NE(nullptr, scanCtx);
+    EXPECT_EQ(6u, scanCtx->maxSeqno);
+    EXPECT_EQ(scan_success, kvstore->scan(scanCtx));
+    kvstore->destroyScanContext(scanCtx);
+
+    EXPECT_EQ(std::vector<int64_t>({2, 3, 4, 5, 6}), seqnos);
+}
+
+/* Test a by-seqno scan returns the documents as they were when the scan
+ * started, even if they are updated before the scan gets to them */
+TEST_P(KVStoreParamTest, SeqnoScanSnapshotTest) {
+    KVStoreConfig config(
+            1024, 4, data_dir, GetParam(), 0, false /*persistnamespace*/);
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin();
+    WriteCallback wc;
+    for (int i = 1; i <= 5; i++) {
+        Item item(makeStoredDocKey("key" + std::to_string(i)),
+                  0, 0, "value", 5, nullptr, 0, 0, i);
+        kvstore->set(item, wc);
+    }
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    std::vector<int64_t> seqnos;
+    auto cb = std::make_shared<CustomCallback<GetValue>>(
+            [&seqnos](GetValue result) {
+                ASSERT_EQ(ENGINE_SUCCESS, result.getStatus());
+                EXPECT_FALSE(result.item->isDeleted());
+                seqnos.push_back(result.item->getBySeqno());
+            });
+    std::shared_ptr<Callback<CacheLookup>> cl(
+            new KVStoreTestCacheCallback(1, 5, 0));
+    ScanContext* scanCtx =
+            kvstore->initScanContext(cb,
+                                     cl,
+                                     0,
+                                     1,
+                                     DocumentFilter::ALL_ITEMS,
+                                     ValueFilter::VALUES_DECOMPRESSED);
+    ASSERT_NE(nullptr, scanCtx);
+    EXPECT_EQ(5u, scanCtx->maxSeqno);
+    EXPECT_EQ(5u, scanCtx->documentCount);
+
+    // Update key2 and delete key4 once the scan has started; the scan must
+    // still return their old versions.
+    kvstore->begin();
+    Item item(makeStoredDocKey("key2"), 0, 0, "value", 5, nullptr, 0, 0, 6);
+    kvstore->set(item, wc);
+    Item deleted(makeStoredDocKey("key4"), 0, 0, nullptr, 0, nullptr, 0, 0,
+                 7);
+    deleted.setDeleted();
+    CustomCallback<int> dc;
+    kvstore->del(deleted, dc);
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    EXPECT_EQ(scan_success, kvstore->scan(scanCtx));
+    kvstore->destroyScanContext(scanCtx);
+
+    EXPECT_EQ(std::vector<int64_t>({1, 2, 3, 4, 5}), seqnos);
+}
+
+/* Test a deleted document is persisted as a tombstone */
+TEST_P(KVStoreParamTest, DeleteTest) {
+    KVStoreConfig config(
+            1024, 4, data_dir, GetParam(), 0, false /*persistnamespace*/);
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin();
+    StoredDocKey key = makeStoredDocKey("key");
+    Item item(key, 0, 0, "value", 5, nullptr, 0, 0, 1);
+    WriteCallback wc;
+    kvstore->set(item, wc);
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    kvstore->begin();
+    Item deleted(key, 0, 0, nullptr, 0, nullptr, 0, 0, 2);
+    deleted.setDeleted();
+    int deleteResult = -1;
+    CustomCallback<int> dc([&deleteResult](int result) {
+        deleteResult = result;
+    });
+    kvstore->del(deleted, dc);
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+    // 1: deleted an existing document
+    EXPECT_EQ(1, deleteResult);
+
+    GetValue gv = kvstore->get(key, 0);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_TRUE(gv.item->isDeleted());
+    EXPECT_EQ(2, gv.item->getBySeqno());
+}
+
+/* Test documents and the vbucket state are recovered when the KVStore is
+ * re-opened */
+TEST_P(KVStoreParamTest, ReopenTest) {
+    KVStoreConfig config(
+            1024, 4, data_dir, GetParam(), 0, false /*persistnamespace*/);
+    {
+        auto kvstore = setup_kv_store(config);
+        kvstore->begin();
+        WriteCallback wc;
+        for (int i = 1; i <= 3; i++) {
+            Item item(makeStoredDocKey("key" + std::to_string(i)),
+                      0, 0, "value", 5, nullptr, 0, 0, i);
+            kvstore->set(item, wc);
+        }
+        EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+    }
+
+    auto kvstore = KVStoreFactory::create(config);
+    ASSERT_NE(nullptr, kvstore.rw);
+    ASSERT_NE(nullptr, kvstore.rw->getVBucketState(0));
+    EXPECT_EQ(vbucket_state_active, kvstore.rw->getVBucketState(0)->state);
+    EXPECT_EQ(3, kvstore.rw->getVBucketState(0)->highSeqno);
+    for (int i = 1; i <= 3; i++) {
+        GetValue gv = kvstore.rw->get(
+                makeStoredDocKey("key" + std::to_string(i)), 0);
+        checkGetValue(gv);
+        EXPECT_EQ(i, gv.item->getBySeqno());
+    }
+}
+
+/* Test compaction keeps the latest version of each document and purges
+ * tombstones when asked to */
+TEST_P(KVStoreParamTest, CompactionTest) {
+    KVStoreConfig config(
+            1024, 4, data_dir, GetParam(), 0, false /*persistnamespace*/);
+    auto kvstore = setup_kv_store(config);
+
+    WriteCallback wc;
+    int64_t seqno = 0;
+    for (int round = 0; round < 3; round++) {
+        kvstore->begin();
+        for (int i = 1; i <= 5; i++) {
+            Item item(makeStoredDocKey("key" + std::to_string(i)),
+                      0, 0, "value", 5, nullptr, 0, 0, ++seqno);
+            kvstore->set(item, wc);
+        }
+        EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+    }
+
+    kvstore->begin();
+    Item deleted(makeStoredDocKey("key1"), 0, 0, nullptr, 0, nullptr, 0, 0,
+                 ++seqno);
+    deleted.setDeleted();
+    CustomCallback<int> dc;
+    kvstore->del(deleted, dc);
+    // Something after the tombstone, so it isn't the highest seqno (which is
+    // never purged).
+    Item item(makeStoredDocKey("key2"), 0, 0, "value", 5, nullptr, 0, 0,
+              ++seqno);
+    kvstore->set(item, wc);
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    compaction_ctx cctx;
+    cctx.purge_before_seq = 0;
+    cctx.purge_before_ts = 0;
+    cctx.curr_time = 0;
+    cctx.drop_deletes = 1;
+    cctx.db_file_id = 0;
+    EXPECT_TRUE(kvstore->compactDB(&cctx));
+    EXPECT_EQ(16u, cctx.max_purged_seq[0]);
+
+    GetValue gv = kvstore->get(makeStoredDocKey("key1"), 0);
+    EXPECT_EQ(ENGINE_KEY_ENOENT, gv.getStatus());
+    for (int i = 2; i <= 5; i++) {
+        gv = kvstore->get(makeStoredDocKey("key" + std::to_string(i)), 0);
+        checkGetValue(gv);
+    }
+    EXPECT_EQ(17, kvstore->getVBucketState(0)->highSeqno);
+}
+
+/* Test documents are recovered when the KVStore is re-opened after
+ * compaction has replaced the files they were written to */
+TEST_P(KVStoreParamTest, CompactionReopenTest) {
+    KVStoreConfig config(
+            1024, 4, data_dir, GetParam(), 0, false /*persistnamespace*/);
+    // Small segments, so that compaction has sealed ones to replace.
+    config.setSegmentSize(1024);
+    {
+        auto kvstore = setup_kv_store(config);
+        WriteCallback wc;
+        int64_t seqno = 0;
+        for (int round = 0; round < 10; round++) {
+            kvstore->begin();
+            for (int i = 1; i <= 5; i++) {
+                Item item(makeStoredDocKey("key" + std::to_string(i)),
+                          0, 0, "value", 5, nullptr, 0, 0, ++seqno);
+                kvstore->set(item, wc);
+            }
+            EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+        }
+
+        compaction_ctx cctx;
+        cctx.purge_before_seq = 0;
+        cctx.purge_before_ts = 0;
+        cctx.curr_time = 0;
+        cctx.drop_deletes = 0;
+        cctx.db_file_id = 0;
+        EXPECT_TRUE(kvstore->compactDB(&cctx));
+
+        // And a write after compaction.
+        kvstore->begin();
+        Item item(makeStoredDocKey("key6"), 0, 0, "value", 5, nullptr, 0, 0,
+                  ++seqno);
+        kvstore->set(item, wc);
+        EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+    }
+
+    // Only the latest version of each document may come back.
+    auto kvstore = KVStoreFactory::create(config);
+    ASSERT_NE(nullptr, kvstore.rw);
+    ASSERT_NE(nullptr, kvstore.rw->getVBucketState(0));
+    EXPECT_EQ(51, kvstore.rw->getVBucketState(0)->highSeqno);
+    for (int i = 1; i <= 6; i++) {
+        GetValue gv = kvstore.rw->get(
+                makeStoredDocKey("key" + std::to_string(i)), 0);
+        checkGetValue(gv);
+        EXPECT_EQ(i == 6 ? 51 : 45 + i, gv.item->getBySeqno());
+    }
+    EXPECT_EQ(6u, kvstore.rw->getItemCount(0));
+}
+
+/* Test a batch whose write was torn, or which was never committed, is
+ * discarded when the KVStore is re-opened, and that writes carry on after
+ * it */
+TEST_P(KVStoreParamTest, TornTailTest) {
+    KVStoreConfig config(
+            1024, 4, data_dir, GetParam(), 0, false /*persistnamespace*/);
+    auto writeBatch = [](KVStore& kvstore, int64_t seqno) {
+        kvstore.begin();
+        WriteCallback wc;
+        Item item(makeStoredDocKey("key" + std::to_string(seqno)),
+                  0, 0, "value", 5, nullptr, 0, 0, seqno);
+        kvstore.set(item, wc);
+        EXPECT_TRUE(kvstore.commit(nullptr /*no collections manifest*/));
+    };
+    // The file the last batch was appended to (the highest numbered one)
+    auto lastFile = [this]() {
+        auto files = cb::io::findFilesWithPrefix(data_dir, "0.");
+        EXPECT_FALSE(files.empty());
+        return *std::max_element(files.begin(),
+                                 files.end(),
+                                 [](const std::string& a,
+                                    const std::string& b) {
+                                     return a.size() < b.size() ||
+                                            (a.size() == b.size() && a < b);
+                                 });
+    };
+    auto checkRecovered = [](KVStore& kvstore, int64_t highSeqno) {
+        ASSERT_NE(nullptr, kvstore.getVBucketState(0));
+        EXPECT_EQ(highSeqno, kvstore.getVBucketState(0)->highSeqno);
+        for (int64_t seqno = 1; seqno <= highSeqno + 1; seqno++) {
+            GetValue gv = kvstore.get(
+                    makeStoredDocKey("key" + std::to_string(seqno)), 0);
+            checkGetValue(gv,
+                          seqno <= highSeqno ? ENGINE_SUCCESS
+                                             : ENGINE_KEY_ENOENT);
+        }
+    };
+
+    {
+        auto kvstore = setup_kv_store(config);
+        writeBatch(*kvstore, 1);
+        writeBatch(*kvstore, 2);
+    }
+
+    // Tear the end off the last batch.
+    {
+        const std::string file = lastFile();
+        std::string data;
+        {
+            std::ifstream in(file, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(in),
+                        std::istreambuf_iterator<char>());
+        }
+        ASSERT_GT(data.size(), 8u);
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size() - 8);
+    }
+    {
+        auto kvstore = KVStoreFactory::create(config);
+        ASSERT_NE(nullptr, kvstore.rw);
+        checkRecovered(*kvstore.rw, 1);
+        writeBatch(*kvstore.rw, 2);
+    }
+
+    // Leave some bytes which were never committed at the end.
+    {
+        std::ofstream out(lastFile(), std::ios::binary | std::ios::app);
+        const std::string garbage(100, 'x');
+        out.write(garbage.data(), garbage.size());
+    }
+    {
+        auto kvstore = KVStoreFactory::create(config);
+        ASSERT_NE(nullptr, kvstore.rw);
+        checkRecovered(*kvstore.rw, 2);
+        writeBatch(*kvstore.rw, 3);
+    }
+
+    auto kvstore = KVStoreFactory::create(config);
+    ASSERT_NE(nullptr, kvstore.rw);
+    checkRecovered(*kvstore.rw, 3);
+}
+
+/* Test rollback restores the previous version of each document and reports
+ * the documents which were rolled back */
+TEST_P(KVStoreParamTest, RollbackTest) {
+    KVStoreConfig config(
+            1024, 4, data_dir, GetParam(), 0, false /*persistnamespace*/);
+    auto kvstore = setup_kv_store(config);
+
+    // One batch per seqno: key1..key10 then key1..key3 again.
+    WriteCallback wc;
+    for (int64_t seqno = 1; seqno <= 13; seqno++) {
+        kvstore->begin();
+        Item item(
+                makeStoredDocKey("key" + std::to_string((seqno - 1) % 10 + 1)),
+                0, 0, "value", 5, nullptr, 0, 0, seqno);
+        kvstore->set(item, wc);
+        EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+    }
+
+    std::vector<std::string> rolledBack;
+    auto rcb = std::make_shared<CustomRBCallback>([&rolledBack](GetValue val) {
+        rolledBack.emplace_back(val.item->getKey().c_str());
+    });
+    RollbackResult result = kvstore->rollback(0, 11, rcb);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(11u, result.highSeqno);
+    EXPECT_EQ(11, kvstore->getVBucketState(0)->highSeqno);
+
+    // key2 and key3 are back at their first versions.
+    for (int i = 1; i <= 10; i++) {
+        GetValue gv = kvstore->get(
+                makeStoredDocKey("key" + std::to_string(i)), 0);
+        checkGetValue(gv);
+        EXPECT_EQ(i == 1 ? 11 : i, gv.item->getBySeqno());
+    }
+    std::sort(rolledBack.begin(), rolledBack.end());
+    EXPECT_EQ(std::vector<std::string>({"key2", "key3"}), rolledBack);
+
+    // Writes carry on from the rollback point.
+    kvstore->begin();
+    Item item(makeStoredDocKey("key2"), 0, 0, "value", 5, nullptr, 0, 0, 12);
+    kvstore->set(item, wc);
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+    GetValue gv = kvstore->get(makeStoredDocKey("key2"), 0);
+    checkGetValue(gv);
+    EXPECT_EQ(12, gv.item->getBySeqno());
+}
+
+/* Test a failed write fails the commit without losing earlier batches, and
+ * that the KVStore recovers once the filesystem does */
+TEST_P(KVStoreParamTest, WriteFailureTest) {
+    KVStoreConfig config(
+            1024, 4, data_dir, GetParam(), 0, false /*persistnamespace*/);
+    ::testing::NiceMock<MockOps> ops(create_default_file_ops());
+    std::unique_ptr<KVStore> kvstore;
+    if (GetParam() == "couchdb") {
+        kvstore = std::make_unique<CouchKVStore>(config, ops);
+    } else if (GetParam() == "logstore") {
+        kvstore = std::make_unique<LogKVStore>(config, ops);
+    } else {
+        // No FileOps to inject errors with.
+        return;
+    }
+    initialize_kv_store(kvstore.get());
+
+    WriteCallback wc;
+    kvstore->begin();
+    Item item1(makeStoredDocKey("key1"), 0, 0, "value", 5, nullptr, 0, 0, 1);
+    kvstore->set(item1, wc);
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    kvstore->begin();
+    Item item2(makeStoredDocKey("key2"), 0, 0, "value", 5, nullptr, 0, 0, 2);
+    kvstore->set(item2, wc);
+    {
+        EXPECT_CALL(ops, pwrite(::testing::_, ::testing::_, ::testing::_,
+                                ::testing::_, ::testing::_))
+                .Times(::testing::AnyNumber());
+        EXPECT_CALL(ops, pwrite(::testing::_, ::testing::_, ::testing::_,
+                                ::testing::_, ::testing::_))
+                .WillOnce(::testing::Return(COUCHSTORE_ERROR_WRITE))
+                .RetiresOnSaturation();
+        EXPECT_FALSE(kvstore->commit(nullptr /*no collections manifest*/));
+    }
+    GetValue gv = kvstore->get(makeStoredDocKey("key1"), 0);
+    checkGetValue(gv);
+    gv = kvstore->get(makeStoredDocKey("key2"), 0);
+    EXPECT_EQ(ENGINE_KEY_ENOENT, gv.getStatus());
+
+    // The flusher retries the batch.
+    kvstore->begin();
+    kvstore->set(item2, wc);
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+    kvstore.reset();
+
+    auto reopened = KVStoreFactory::create(config);
+    ASSERT_NE(nullptr, reopened.rw);
+    EXPECT_EQ(2, reopened.rw->getVBucketState(0)->highSeqno);
+    for (int i = 1; i <= 2; i++) {
+        gv = reopened.rw->get(makeStoredDocKey("key" + std::to_string(i)), 0);
+        checkGetValue(gv);
+        EXPECT_EQ(i, gv.item->getBySeqno());
+    }
+}
+
+/* Test compaction only rewrites the segments where most of the bytes are
+ * no longer needed */
+TEST_F(LogKVStoreTest, CompactionPicksSparseSegments) {
+    KVStoreConfig config(
+            1024, 4, data_dir, "logstore", 0, false /*persistnamespace*/);
+    config.setSegmentSize(1024);
+    auto kvstore = setup_kv_store(config);
+
+    // Each batch fills a segment.
+    WriteCallback wc;
+    auto writeBatch = [&kvstore, &wc](
+                              int firstKey, int64_t firstSeqno, int count) {
+        kvstore->begin();
+        for (int i = 0; i < count; i++) {
+            Item item(makeStoredDocKey("key" + std::to_string(firstKey + i)),
+                      0, 0, "value", 5, nullptr, 0, 0, firstSeqno + i);
+            kvstore->set(item, wc);
+        }
+        EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+    };
+    auto getFiles = [this]() {
+        auto files = cb::io::findFilesWithPrefix(data_dir, "0.");
+        std::sort(files.begin(), files.end());
+        return files;
+    };
+    compaction_ctx cctx;
+    cctx.purge_before_seq = 0;
+    cctx.purge_before_ts = 0;
+    cctx.curr_time = 0;
+    cctx.drop_deletes = 0;
+    cctx.db_file_id = 0;
+
+    writeBatch(1, 1, 20);
+    writeBatch(21, 21, 20);
+    const auto files = getFiles();
+    ASSERT_EQ(2u, files.size());
+    EXPECT_TRUE(kvstore->compactDB(&cctx));
+    EXPECT_EQ(files, getFiles());
+
+    // Overwrite the documents of the first segment (and one of the second,
+    // so that the highest seqno, whose history is always kept, is in
+    // there). With their superseding versions old enough to purge, none of
+    // the first segment is needed any more.
+    writeBatch(1, 41, 21);
+    const uint64_t fileSize = kvstore->getDbFileInfo(0).fileSize;
+    cctx.purge_before_ts = std::numeric_limits<uint64_t>::max();
+    EXPECT_TRUE(kvstore->compactDB(&cctx));
+    const auto compacted = getFiles();
+    EXPECT_EQ(3u, compacted.size());
+    EXPECT_EQ(0, std::count(compacted.begin(), compacted.end(), files[0]));
+    EXPECT_EQ(1, std::count(compacted.begin(), compacted.end(), files[1]));
+    EXPECT_LT(kvstore->getDbFileInfo(0).fileSize, fileSize);
+    EXPECT_EQ(60u, kvstore->getVBucketState(0)->purgeSeqno);
+
+    for (int i = 1; i <= 40; i++) {
+        GetValue gv = kvstore->get(
+                makeStoredDocKey("key" + std::to_string(i)), 0);
+        checkGetValue(gv);
+        EXPECT_EQ(i <= 21 ? 40 + i : i, gv.item->getBySeqno());
+    }
+}
+
+/* Test compaction keeps the history rollback needs above the purge seqno,
+ * including across a restart, and that rollback fails below it */
+TEST_F(LogKVStoreTest, RollbackAfterCompaction) {
+    KVStoreConfig config(
+            1024, 4, data_dir, "logstore", 0, false /*persistnamespace*/);
+    config.setSegmentSize(1024);
+    {
+        auto kvstore = setup_kv_store(config);
+        // One batch per seqno: key1..key10 then key1..key3 again.
+        WriteCallback wc;
+        for (int64_t seqno = 1; seqno <= 13; seqno++) {
+            kvstore->begin();
+            Item item(makeStoredDocKey("key" +
+                                       std::to_string((seqno - 1) % 10 + 1)),
+                      0, 0, "value", 5, nullptr, 0, 0, seqno);
+            kvstore->set(item, wc);
+            EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+        }
+
+        compaction_ctx cctx;
+        cctx.purge_before_seq = 0;
+        cctx.purge_before_ts = 0;
+        cctx.curr_time = 0;
+        cctx.drop_deletes = 0;
+        cctx.db_file_id = 0;
+        EXPECT_TRUE(kvstore->compactDB(&cctx));
+        EXPECT_EQ(0u, cctx.max_purged_seq[0]);
+    }
+
+    auto kvstore = KVStoreFactory::create(config);
+    ASSERT_NE(nullptr, kvstore.rw);
+    auto rcb = std::make_shared<CustomRBCallback>();
+    RollbackResult result = kvstore.rw->rollback(0, 12, rcb);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(12u, result.highSeqno);
+    GetValue gv = kvstore.rw->get(makeStoredDocKey("key3"), 0);
+    checkGetValue(gv);
+    EXPECT_EQ(3, gv.item->getBySeqno());
+
+    // Dropping the deletes purges the history below the highest seqno.
+    compaction_ctx cctx;
+    cctx.purge_before_seq = 0;
+    cctx.purge_before_ts = 0;
+    cctx.curr_time = 0;
+    cctx.drop_deletes = 1;
+    cctx.db_file_id = 0;
+    EXPECT_TRUE(kvstore.rw->compactDB(&cctx));
+    EXPECT_EQ(11u, cctx.max_purged_seq[0]);
+    EXPECT_EQ(11u, kvstore.rw->getVBucketState(0)->purgeSeqno);
+
+    result = kvstore.rw->rollback(0, 10, rcb);
+    EXPECT_FALSE(result.success);
+
+    result = kvstore.rw->rollback(0, 11, rcb);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(11u, result.highSeqno);
+    for (int i = 1; i <= 10; i++) {
+        gv = kvstore.rw->get(makeStoredDocKey("key" + std::to_string(i)), 0);
+        checkGetValue(gv);
+        EXPECT_EQ(i == 1 ? 11 : i, gv.item->getBySeqno());
+    }
+}
+
 TEST_F(CouchKVStoreTest, CompressedTest) {
     KVStoreConfig config(
             1024, 4, data_dir, "couchdb", 0, false /*persistnamespace*/);
@@ -400,6 +979,85 @@ TEST_F(CouchKVStoreTest, MB_18580_ENOENT) {
     EXPECT_THROW(kvstore.ro->getDbFileInfo(0), std::system_error);
 }
 
+// Verify that a single transaction can commit items of several vbuckets
+// (as the flusher does when group committing).
+TEST_F(CouchKVStoreTest, MultiVBucketCommit) {
+    KVStoreConfig config(
+            1024, 4, data_dir, "couchdb", 0, false /*persistnamespace*/);
+    auto kvstore = setup_kv_store(config);
+
+    std::string failoverLog("");
+    vbucket_state state(vbucket_state_active, 0, 0, 0, 0, 0, 0, 0, failoverLog);
+    kvstore->incrementRevision(1);
+    kvstore->snapshotVBucket(1, state,
+                             VBStatePersist::VBSTATE_PERSIST_WITHOUT_COMMIT);
+
+    kvstore->begin();
+    WriteCallback wc;
+    for (uint16_t vb : {0, 1}) {
+        Item item(makeStoredDocKey("key" + std::to_string(vb)),
+                  0, 0, "value", 5, nullptr, 0, 0, 1);
+        item.setVBucketId(vb);
+        kvstore->set(item, wc);
+    }
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    for (uint16_t vb : {0, 1}) {
+        GetValue gv = kvstore->get(makeStoredDocKey("key" + std::to_string(vb)),
+                                   vb);
+        checkGetValue(gv);
+        EXPECT_EQ(1u, kvstore->getLastPersistedSeqno(vb));
+    }
+}
+
+// Verify that repeated reads of a vbucket re-use a cached read handle, and
+// that a commit invalidates it so new documents are visible.
+TEST_F(CouchKVStoreTest, ReadHandleCache) {
+    KVStoreConfig config(
+            1024, 4, data_dir, "couchdb", 0, false /*persistnamespace*/);
+    auto kvstore = setup_kv_store(config);
+
+    kvstore->begin();
+    StoredDocKey key = makeStoredDocKey("key");
+    Item item(key, 0, 0, "value", 5);
+    WriteCallback wc;
+    kvstore->set(item, wc);
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    GetValue gv = kvstore->get(key, 0);
+    checkGetValue(gv);
+    gv = kvstore->get(key, 0);
+    checkGetValue(gv);
+
+    std::map<std::string, std::string> stats;
+    kvstore->addStats(add_stat_callback, &stats);
+    EXPECT_EQ("1", stats["rw_0:read_handle_cache_misses"]);
+    EXPECT_EQ("1", stats["rw_0:read_handle_cache_hits"]);
+    EXPECT_EQ("1", stats["rw_0:read_handles_open"]);
+
+    // A new commit must not be hidden by the cached handle.
+    kvstore->begin();
+    StoredDocKey key2 = makeStoredDocKey("key2");
+    Item item2(key2, 0, 0, "value", 5);
+    kvstore->set(item2, wc);
+    EXPECT_TRUE(kvstore->commit(nullptr /*no collections manifest*/));
+
+    gv = kvstore->get(key2, 0);
+    checkGetValue(gv);
+
+    stats.clear();
+    kvstore->addStats(add_stat_callback, &stats);
+    EXPECT_EQ("2", stats["rw_0:read_handle_cache_misses"]);
+    EXPECT_EQ("1", stats["rw_0:read_handle_cache_hits"]);
+    EXPECT_EQ("1", stats["rw_0:read_handles_open"]);
+
+    // Deleting the vbucket must close its cached handle.
+    kvstore->delVBucket(0, kvstore->prepareToDelete(0));
+    stats.clear();
+    kvstore->addStats(add_stat_callback, &stats);
+    EXPECT_EQ("0", stats["rw_0:read_handles_open"]);
+}
+
 /**
  * The CouchKVStoreErrorInjectionTest cases utilise GoogleMock to inject
  * errors into couchstore as if they come from the filesystem in order
@@ -1675,17 +2333,17 @@ TEST_F(CouchKVStoreMetaData, assignment) {
 }
 
 #ifdef EP_USE_FORESTDB
-// Test cases which run on both Couchstore and ForestDB
-INSTANTIATE_TEST_CASE_P(CouchstoreAndForestDB,
-                        CouchAndForestTest,
-                        ::testing::Values("couchdb", "forestdb"),
+// Test cases which run on every backend
+INSTANTIATE_TEST_CASE_P(AllBackends,
+                        KVStoreParamTest,
+                        ::testing::Values("couchdb", "logstore", "forestdb"),
                         [] (const ::testing::TestParamInfo<std::string>& info) {
                             return info.param;
                         });
 #else
-INSTANTIATE_TEST_CASE_P(CouchstoreAndForestDB,
-                        CouchAndForestTest,
-                        ::testing::Values("couchdb"),
+INSTANTIATE_TEST_CASE_P(AllBackends,
+                        KVStoreParamTest,
+                        ::testing::Values("couchdb", "logstore"),
                         [] (const ::testing::TestParamInfo<std::string>& info) {
                             return info.param;
                         });
@@ -0,0 +1,227 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/**
+ * Test fixture for the SequenceList implementations.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <gtest/gtest.h>
+
+#include "hash_table.h"
+#include "item.h"
+#include "seqlist.h"
+#include "stats.h"
+#include "stored_value_factories.h"
+#include "tests/module_tests/test_helpers.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Test fixture for the SequenceList implementations, templated on the mock of
+ * the implementation (MockBasicLinkedList or MockSkipList).
+ */
+template <typename ListType>
+class SequenceListTest : public ::testing::Test {
+public:
+    SequenceListTest() : ht(global_stats, makeFactory(), 2, 1) {
+    }
+
+    std::unique_ptr<AbstractStoredValueFactory> makeFactory() {
+        return std::make_unique<OrderedStoredValueFactory>(global_stats);
+    }
+
+protected:
+    void SetUp() override {
+        seqList = std::make_unique<ListType>(global_stats);
+    }
+
+    void TearDown() override {
+        /* Like in a vbucket we want the list to be erased before HashTable is
+           is destroyed. */
+        seqList.reset();
+    }
+
+    /**
+     * Adds 'numItems' number of new items to the list, from startSeqno.
+     * Items to have key as keyPrefixXX, XX being the seqno.
+     *
+     * Returns the vector of seqnos added.
+     */
+    std::vector<seqno_t> addNewItemsToList(seqno_t startSeqno,
+                                           const std::string& keyPrefix,
+                                           const int numItems) {
+        const seqno_t last = startSeqno + numItems;
+        const std::string val("data");
+        OrderedStoredValue* sv;
+        std::vector<seqno_t> expectedSeqno;
+
+        /* Get a fake sequence lock */
+        std::mutex fakeSeqLock;
+        std::lock_guard<std::mutex> lg(fakeSeqLock);
+
+        for (seqno_t i = startSeqno; i < last; ++i) {
+            StoredDocKey key = makeStoredDocKey(keyPrefix + std::to_string(i));
+            Item item(key,
+                      0,
+                      0,
+                      val.data(),
+                      val.length(),
+                      /*ext_meta*/ nullptr,
+                      /*ext_len*/ 0,
+                      /*theCas*/ 0,
+                      /*bySeqno*/ i);
+            EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
+
+            sv = ht.find(key, TrackReference::Yes, WantsDeleted::No)
+                         ->toOrderedStoredValue();
+
+            std::lock_guard<std::mutex> listWriteLg(
+                    seqList->getListWriteLock());
+            seqList->appendToList(lg, listWriteLg, *sv);
+            seqList->updateHighSeqno(listWriteLg, *sv);
+            expectedSeqno.push_back(i);
+        }
+        return expectedSeqno;
+    }
+
+    /**
+     * Adds one item without a seqno to the list
+     */
+    void addItemWithoutSeqno(const std::string& key) {
+        /* Get a fake sequence lock */
+        std::mutex fakeSeqLock;
+        std::lock_guard<std::mutex> lg(fakeSeqLock);
+
+        StoredDocKey sKey = makeStoredDocKey(key);
+        Item item(sKey, 0, 0, sKey.data(), sKey.size());
+
+        EXPECT_EQ(MutationStatus::WasClean, ht.set(item));
+
+        OrderedStoredValue* sv =
+                ht.find(sKey, TrackReference::Yes, WantsDeleted::No)
+                        ->toOrderedStoredValue();
+
+        std::lock_guard<std::mutex> listWriteLg(seqList->getListWriteLock());
+        seqList->appendToList(lg, listWriteLg, *sv);
+    }
+
+    /**
+     * Updates an existing item with key == key and assigns it a seqno of
+     * highSeqno + 1. If the item is in a range being read, the list only
+     * allows an append: a new StoredValue is added for the key and the old
+     * one is marked stale.
+     *
+     * Returns the status returned by updateListElem().
+     */
+    SequenceList::UpdateStatus updateItem(seqno_t highSeqno,
+                                          const std::string& key) {
+        const std::string val("data");
+
+        /* Get a fake sequence lock */
+        std::mutex fakeSeqLock;
+        std::lock_guard<std::mutex> lg(fakeSeqLock);
+
+        StoredDocKey sKey = makeStoredDocKey(key);
+        OrderedStoredValue* osv =
+                ht.find(sKey, TrackReference::No, WantsDeleted::Yes)
+                        ->toOrderedStoredValue();
+
+        std::lock_guard<std::mutex> listWriteLg(seqList->getListWriteLock());
+        auto status = seqList->updateListElem(lg, listWriteLg, *osv);
+        if (status == SequenceList::UpdateStatus::Success) {
+            osv->setBySeqno(highSeqno + 1);
+            seqList->updateHighSeqno(listWriteLg, *osv);
+            return status;
+        }
+
+        /* Release the current sv from the HT */
+        auto hbl = ht.getLockedBucket(sKey);
+        auto ownedSv = ht.unlocked_release(hbl, osv->getKey());
+
+        /* Add a new storedvalue for the append */
+        Item itm(sKey,
+                 0,
+                 0,
+                 val.data(),
+                 val.length(),
+                 /*ext_meta*/ nullptr,
+                 /*ext_len*/ 0,
+                 /*theCas*/ 0,
+                 /*bySeqno*/ highSeqno + 1);
+        auto* newSv = ht.unlocked_addNewStoredValue(hbl, itm);
+        seqList->markItemStale(listWriteLg, std::move(ownedSv), newSv);
+
+        seqList->appendToList(
+                lg, listWriteLg, *(newSv->toOrderedStoredValue()));
+        seqList->updateHighSeqno(listWriteLg,
+                                 *(newSv->toOrderedStoredValue()));
+        return status;
+    }
+
+    /**
+     * Deletes an existing item with key == key, puts it onto the list
+     * and assigns it a seqno of highSeqno + 1.
+     * To be called when there is no range read.
+     */
+    void softDeleteItem(seqno_t highSeqno, const std::string& key) {
+        { /* hbl lock scope */
+            auto hbl = ht.getLockedBucket(makeStoredDocKey(key));
+            StoredValue* sv = ht.unlocked_find(makeStoredDocKey(key),
+                                               hbl.getBucketNum(),
+                                               WantsDeleted::Yes,
+                                               TrackReference::No);
+
+            ht.unlocked_softDelete(
+                    hbl.getHTLock(), *sv, /* onlyMarkDeleted */ false);
+        }
+
+        EXPECT_EQ(SequenceList::UpdateStatus::Success,
+                  updateItem(highSeqno, key));
+    }
+
+    /**
+     * Release a StoredValue with 'key' from the hash table
+     */
+    StoredValue::UniquePtr releaseFromHashTable(const std::string& key) {
+        auto hbl = ht.getLockedBucket(makeStoredDocKey(key));
+        return ht.unlocked_release(hbl, makeStoredDocKey(key));
+    }
+
+    /* Reads all the (remaining) items of the iterator */
+    static std::vector<seqno_t> readAll(SequenceList::RangeIterator& itr) {
+        std::vector<seqno_t> seqnos;
+        while (itr.curr() != itr.end()) {
+            seqnos.push_back((*itr).getBySeqno());
+            ++itr;
+        }
+        return seqnos;
+    }
+
+    EPStats global_stats;
+
+    /* We need a HashTable because StoredValue is created only in the HashTable
+       and then put onto the sequence list */
+    HashTable ht;
+    std::unique_ptr<ListType> seqList;
+};
@@ -0,0 +1,334 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+
+#include "../mock/mock_skip_list.h"
+#include "seqlist_test.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/* Tests of behaviour specific to the SkipList; see basic_ll_test.cc for the
+   tests run against every SequenceList implementation */
+class SkipListTest : public SequenceListTest<MockSkipList> {};
+
+TEST_F(SkipListTest, SetItems) {
+    const int numItems = 1000;
+
+    std::vector<seqno_t> expectedSeqno =
+            addNewItemsToList(1, std::string("key"), numItems);
+
+    EXPECT_EQ(expectedSeqno, seqList->getAllSeqnoForVerification());
+    EXPECT_EQ(numItems, seqList->getNumItems());
+    EXPECT_TRUE(seqList->verifyLevels());
+}
+
+TEST_F(SkipListTest, UpdateMovesElemToEnd) {
+    const int numItems = 1000;
+    const std::string keyPrefix("key");
+
+    std::vector<seqno_t> expectedSeqno =
+            addNewItemsToList(1, keyPrefix, numItems);
+
+    /* Update the first, a middle and the last element */
+    seqno_t highSeqno = numItems;
+    for (seqno_t seqno : {seqno_t(1), seqno_t(numItems / 2), highSeqno}) {
+        EXPECT_EQ(SequenceList::UpdateStatus::Success,
+                  updateItem(highSeqno, keyPrefix + std::to_string(seqno)));
+        expectedSeqno.erase(std::find(
+                expectedSeqno.begin(), expectedSeqno.end(), seqno));
+        expectedSeqno.push_back(++highSeqno);
+    }
+
+    EXPECT_EQ(expectedSeqno, seqList->getAllSeqnoForVerification());
+    EXPECT_EQ(numItems, seqList->getNumItems());
+    EXPECT_TRUE(seqList->verifyLevels());
+}
+
+TEST_F(SkipListTest, TestRangeRead) {
+    const int numItems = 100;
+
+    addNewItemsToList(1, std::string("key"), numItems);
+
+    /* Whole list, from the middle and stopping before the end */
+    for (auto range : {std::make_pair(seqno_t(1), seqno_t(numItems)),
+                       std::make_pair(seqno_t(40), seqno_t(numItems)),
+                       std::make_pair(seqno_t(40), seqno_t(60))}) {
+        ENGINE_ERROR_CODE status;
+        std::vector<UniqueItemPtr> items;
+        seqno_t endSeqno;
+        std::tie(status, items, endSeqno) =
+                seqList->rangeRead(range.first, range.second);
+
+        EXPECT_EQ(ENGINE_SUCCESS, status);
+        EXPECT_EQ(range.second, endSeqno);
+        ASSERT_EQ(range.second - range.first + 1, items.size());
+        for (size_t i = 0; i < items.size(); ++i) {
+            EXPECT_EQ(range.first + seqno_t(i), items[i]->getBySeqno());
+        }
+    }
+
+    /* Reads must not leave a range behind */
+    EXPECT_EQ(0, seqList->getNumReadRanges());
+}
+
+TEST_F(SkipListTest, TestRangeReadNegatives) {
+    const int numItems = 3;
+
+    addNewItemsToList(1, std::string("key"), numItems);
+
+    EXPECT_EQ(ENGINE_ERANGE, std::get<0>(seqList->rangeRead(2, 1)));
+    EXPECT_EQ(ENGINE_ERANGE, std::get<0>(seqList->rangeRead(-1, 2)));
+    EXPECT_EQ(ENGINE_ERANGE,
+              std::get<0>(seqList->rangeRead(numItems + 1, numItems + 2)));
+}
+
+TEST_F(SkipListTest, RangeIteratorSeek) {
+    const int numItems = 1000;
+    const std::string keyPrefix("key");
+
+    addNewItemsToList(1, keyPrefix, numItems);
+
+    /* Move seqno 500 to the end, leaving a gap */
+    EXPECT_EQ(SequenceList::UpdateStatus::Success,
+              updateItem(numItems, keyPrefix + "500"));
+
+    {
+        auto itr = seqList->makeRangeIterator(499);
+        ASSERT_TRUE(itr);
+        EXPECT_EQ(499, itr->curr());
+        EXPECT_EQ(numItems + 1, itr->back());
+        ++(*itr);
+        /* Seqno 500 is not in the list anymore */
+        EXPECT_EQ(501, itr->curr());
+    }
+
+    {
+        auto itr = seqList->makeRangeIterator(500);
+        ASSERT_TRUE(itr);
+        EXPECT_EQ(501, itr->curr());
+        EXPECT_EQ(numItems - 500 + 1, readAll(*itr).size());
+    }
+
+    {
+        /* Beyond the last seqno; nothing to read */
+        auto itr = seqList->makeRangeIterator(numItems + 2);
+        ASSERT_TRUE(itr);
+        EXPECT_EQ(itr->curr(), itr->end());
+    }
+    EXPECT_EQ(0, seqList->getNumReadRanges());
+}
+
+TEST_F(SkipListTest, MultipleConcurrentRangeIterators) {
+    const int numItems = 10;
+    const std::string keyPrefix("key");
+
+    std::vector<seqno_t> expectedSeqno =
+            addNewItemsToList(1, keyPrefix, numItems);
+
+    auto itr1 = seqList->makeRangeIterator();
+    ++itr1;
+    auto itr2 = seqList->makeRangeIterator(5);
+    ASSERT_TRUE(itr2);
+    EXPECT_EQ(2, seqList->getNumReadRanges());
+    EXPECT_EQ(2, seqList->getRangeReadBegin());
+    EXPECT_EQ(numItems, seqList->getRangeReadEnd());
+
+    /* Items in the range of any of the iterators are not moved */
+    EXPECT_EQ(SequenceList::UpdateStatus::Append,
+              updateItem(numItems, keyPrefix + "3"));
+
+    /* Items behind both of the iterators can be moved */
+    EXPECT_EQ(SequenceList::UpdateStatus::Success,
+              updateItem(numItems + 1, keyPrefix + "1"));
+
+    /* New items are not part of the snapshots */
+    addNewItemsToList(numItems + 3, keyPrefix, 1);
+
+    EXPECT_EQ(std::vector<seqno_t>(expectedSeqno.begin() + 4,
+                                   expectedSeqno.end()),
+              readAll(*itr2));
+    EXPECT_EQ(std::vector<seqno_t>(expectedSeqno.begin() + 1,
+                                   expectedSeqno.end()),
+              readAll(itr1));
+
+    /* Iterators release their range as soon as they reach the end */
+    EXPECT_EQ(0, seqList->getNumReadRanges());
+    EXPECT_TRUE(seqList->verifyLevels());
+}
+
+TEST_F(SkipListTest, PurgeDuringRangeRead) {
+    const int numItems = 100;
+    const std::string keyPrefix("key");
+
+    addNewItemsToList(1, keyPrefix, numItems);
+
+    /* Make every even seqno stale while a range read covers the list */
+    seqno_t highSeqno = numItems;
+    {
+        seqList->registerFakeReadRange(1, numItems);
+        for (seqno_t seqno = 2; seqno <= numItems; seqno += 2) {
+            EXPECT_EQ(SequenceList::UpdateStatus::Append,
+                      updateItem(highSeqno++,
+                                 keyPrefix + std::to_string(seqno)));
+        }
+        seqList->resetReadRange();
+    }
+    EXPECT_EQ(numItems / 2, seqList->getNumStaleItems());
+
+    /* A reader from the middle of the list; purge must neither wait for it
+       nor purge anything in its range */
+    auto itr = seqList->makeRangeIterator(51);
+    ASSERT_TRUE(itr);
+    EXPECT_EQ(25, seqList->purgeTombstones());
+    EXPECT_EQ(numItems / 2 - 25, seqList->getNumStaleItems());
+    EXPECT_TRUE(seqList->verifyLevels());
+
+    std::vector<seqno_t> expectedSeqno;
+    for (seqno_t seqno = 51; seqno <= highSeqno; ++seqno) {
+        expectedSeqno.push_back(seqno);
+    }
+    EXPECT_EQ(expectedSeqno, readAll(*itr));
+
+    /* Reader is done; now everything can be purged */
+    EXPECT_EQ(numItems / 2 - 25, seqList->purgeTombstones());
+    EXPECT_EQ(0, seqList->getNumStaleItems());
+    EXPECT_EQ(numItems, seqList->getNumItems());
+    EXPECT_EQ(0, seqList->getStaleValueBytes());
+    EXPECT_TRUE(seqList->verifyLevels());
+
+    expectedSeqno.clear();
+    for (seqno_t seqno = 1; seqno < numItems; seqno += 2) {
+        expectedSeqno.push_back(seqno);
+    }
+    for (seqno_t seqno = numItems + 1; seqno <= highSeqno; ++seqno) {
+        expectedSeqno.push_back(seqno);
+    }
+    EXPECT_EQ(expectedSeqno, seqList->getAllSeqnoForVerification());
+}
+
+TEST_F(SkipListTest, NodeMemoryAccounting) {
+    const int numItems = 100;
+    const std::string keyPrefix("key");
+
+    /* Only the head to begin with */
+    const size_t headBytes = seqList->getNodeBytes();
+    EXPECT_GT(headBytes, 0);
+    const size_t baseOverhead = global_stats.memOverhead->load() - headBytes;
+
+    /* Every node costs at least its element pointer, height and one link */
+    addNewItemsToList(1, keyPrefix, numItems);
+    const size_t nodeBytes = seqList->getNodeBytes();
+    EXPECT_GE(nodeBytes - headBytes, numItems * 3 * sizeof(void*));
+    EXPECT_EQ(baseOverhead + nodeBytes, global_stats.memOverhead->load());
+
+    /* Updates move the nodes, they don't allocate */
+    seqno_t highSeqno = numItems;
+    EXPECT_EQ(SequenceList::UpdateStatus::Success,
+              updateItem(highSeqno++, keyPrefix + "1"));
+    EXPECT_EQ(nodeBytes, seqList->getNodeBytes());
+
+    /* Appends of stale items allocate, and purging them frees the nodes */
+    {
+        seqList->registerFakeReadRange(2, numItems);
+        for (seqno_t seqno = 2; seqno <= numItems; seqno += 2) {
+            EXPECT_EQ(SequenceList::UpdateStatus::Append,
+                      updateItem(highSeqno++,
+                                 keyPrefix + std::to_string(seqno)));
+        }
+        seqList->resetReadRange();
+    }
+    EXPECT_GT(seqList->getNodeBytes(), nodeBytes);
+    EXPECT_EQ(numItems / 2, seqList->purgeTombstones());
+    EXPECT_EQ(baseOverhead + seqList->getNodeBytes(),
+              global_stats.memOverhead->load());
+    EXPECT_TRUE(seqList->verifyLevels());
+
+    /* Destroying the list frees the remaining nodes (and the head) */
+    seqList.reset();
+    EXPECT_EQ(baseOverhead, global_stats.memOverhead->load());
+}
+
+TEST_F(SkipListTest, ConcurrentRangeIteratorsUpdatesAndPurge) {
+    const int numItems = 1000;
+    const int numUpdates = 20000;
+    const std::string keyPrefix("key");
+
+    addNewItemsToList(1, keyPrefix, numItems);
+
+    /* Readers iterate from random seqnos; each iterator must return its
+       snapshot in seqno order while the list is updated and purged */
+    std::atomic<bool> done{false};
+    auto reader = [this, &done, numItems, numUpdates](uint32_t seed) {
+        while (!done) {
+            seed = seed * 1103515245 + 12345;
+            const seqno_t start = 1 + (seed >> 8) % (numItems + numUpdates);
+            auto itr = seqList->makeRangeIterator(start);
+            ASSERT_TRUE(itr);
+            const seqno_t back = itr->back();
+            seqno_t prev = 0;
+            while (itr->curr() != itr->end()) {
+                const seqno_t seqno = (**itr).getBySeqno();
+                ASSERT_GE(seqno, start);
+                ASSERT_GT(seqno, prev);
+                ASSERT_LE(seqno, back);
+                prev = seqno;
+                ++(*itr);
+            }
+        }
+    };
+    std::thread reader1{reader, 1};
+    std::thread reader2{reader, 2};
+    std::thread purger{[this, &done]() {
+        while (!done) {
+            seqList->purgeTombstones();
+            std::this_thread::yield();
+        }
+    }};
+
+    /* Update random keys, appending (and making the old version stale) when
+       the key is in the range of a reader or of the purge */
+    seqno_t highSeqno = numItems;
+    uint32_t seed = 3;
+    for (int i = 0; i < numUpdates; ++i) {
+        seed = seed * 1103515245 + 12345;
+        updateItem(highSeqno++,
+                   keyPrefix + std::to_string(1 + (seed >> 8) % numItems));
+    }
+
+    done = true;
+    reader1.join();
+    reader2.join();
+    purger.join();
+
+    /* With no readers left everything stale can be purged, leaving one
+       element per key */
+    seqList->purgeTombstones();
+    EXPECT_EQ(0, seqList->getNumStaleItems());
+    EXPECT_EQ(0, seqList->getStaleValueBytes());
+    EXPECT_EQ(numItems, seqList->getNumItems());
+    EXPECT_EQ(highSeqno, seqList->getHighSeqno());
+    EXPECT_TRUE(seqList->verifyLevels());
+
+    auto seqnos = seqList->getAllSeqnoForVerification();
+    ASSERT_EQ(numItems, seqnos.size());
+    EXPECT_TRUE(std::is_sorted(seqnos.begin(), seqnos.end()));
+    EXPECT_EQ(highSeqno, seqnos.back());
+}
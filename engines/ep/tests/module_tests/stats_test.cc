@@ -26,6 +26,10 @@
 
 #include <gmock/gmock.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 void StatTest::SetUp() {
     SingleThreadedEPBucketTest::SetUp();
     store->setVBucketState(vbid, vbucket_state_active, false);
@@ -284,3 +288,110 @@ INSTANTIATE_TEST_CASE_P(FullAndValueEviction, DatatypeStatTest,
                         ::testing::Values("value_only", "full_eviction"), []
                                 (const ::testing::TestParamInfo<std::string>&
                                 info) {return info.param;});
+
+// Memory accounting is done in thread-local counters; check changes are only
+// merged into the bucket total once a threshold is crossed (or the thread
+// exits), and that the precise total always includes them.
+TEST(EPStatsTest, ThreadLocalMemoryAccounting) {
+    EPStats stats;
+    stats.memoryTrackerEnabled = true;
+    stats.setMemMergeBytesThreshold(1024);
+
+    stats.memAllocated(100);
+    EXPECT_EQ(0, stats.getTotalMemoryUsed());
+    EXPECT_EQ(100, stats.getPreciseTotalMemoryUsed());
+
+    // Crossing the bytes threshold merges the counter into the total.
+    stats.memAllocated(1000);
+    EXPECT_EQ(1100, stats.getTotalMemoryUsed());
+    EXPECT_EQ(1100, stats.getPreciseTotalMemoryUsed());
+
+    stats.memDeallocated(50);
+    EXPECT_EQ(1100, stats.getTotalMemoryUsed());
+    EXPECT_EQ(1050, stats.getPreciseTotalMemoryUsed());
+
+    // Another thread's changes are seen by the precise total while the
+    // thread runs, and merged into the total when it exits.
+    std::mutex m;
+    std::condition_variable cv;
+    bool allocated = false;
+    bool checked = false;
+    std::thread t([&]() {
+        stats.memAllocated(10);
+        std::unique_lock<std::mutex> lh(m);
+        allocated = true;
+        cv.notify_one();
+        cv.wait(lh, [&checked] { return checked; });
+    });
+    {
+        std::unique_lock<std::mutex> lh(m);
+        cv.wait(lh, [&allocated] { return allocated; });
+        EXPECT_EQ(1100, stats.getTotalMemoryUsed());
+        EXPECT_EQ(1060, stats.getPreciseTotalMemoryUsed());
+        checked = true;
+        cv.notify_one();
+    }
+    t.join();
+    EXPECT_EQ(1110, stats.getTotalMemoryUsed());
+    EXPECT_EQ(1060, stats.getPreciseTotalMemoryUsed());
+}
+
+// The memory held back in the thread-local counters must stay within a fixed
+// fraction of the quota however many threads account memory, so that quota
+// checks using getTotalMemoryUsed() are within a known margin.
+TEST(EPStatsTest, ThreadLocalMemoryErrorBounded) {
+    EPStats stats;
+    stats.memoryTrackerEnabled = true;
+    stats.setMemMergeBytesThreshold(1024 * 1024);
+    const size_t quota = 10 * 1024 * 1024;
+    stats.setMaxDataSize(quota);
+    const size_t maxError = quota * EPStats::memUsedMaxErrorRatio;
+
+    // Each thread accumulates far more than its share of the error (but
+    // less than mem_merge_bytes_threshold), then waits while we check.
+    const int numThreads = 8;
+    std::mutex m;
+    std::condition_variable cv;
+    int registered = 0;
+    int allocated = 0;
+    bool checked = false;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&]() {
+            stats.memAllocated(1);
+            std::unique_lock<std::mutex> lh(m);
+            ++registered;
+            cv.notify_all();
+            cv.wait(lh, [&registered] { return registered == numThreads; });
+            lh.unlock();
+
+            for (int i = 0; i < 1000; ++i) {
+                stats.memAllocated(100 + i % 7);
+                if (i % 3 == 0) {
+                    stats.memDeallocated(50);
+                }
+            }
+
+            lh.lock();
+            ++allocated;
+            cv.notify_all();
+            cv.wait(lh, [&checked] { return checked; });
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lh(m);
+        cv.wait(lh, [&allocated] { return allocated == numThreads; });
+        EXPECT_LE(stats.getMemUsedMaxError(), maxError);
+        const auto precise = stats.getPreciseTotalMemoryUsed();
+        const auto estimate = stats.getTotalMemoryUsed();
+        EXPECT_GT(precise, maxError);
+        EXPECT_LE(std::abs(static_cast<long long>(precise) -
+                           static_cast<long long>(estimate)),
+                  static_cast<long long>(maxError));
+        checked = true;
+        cv.notify_all();
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+}
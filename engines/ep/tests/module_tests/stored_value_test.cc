@@ -28,6 +28,9 @@
 
 #include <gtest/gtest.h>
 
+#include <limits>
+#include <type_traits>
+
 /**
  * Test fixture for StoredValue tests. Type-parameterized to test both
  * StoredValue and OrderedStoredValue.
@@ -50,7 +53,7 @@ public:
 
     /// Returns the number of bytes in the Fixed part of StoredValue
     static size_t getFixedSize() {
-        return sizeof(typename Factory::value_type);
+        return Factory::value_type::getKeyOffset();
     }
 
     /// Allow testing access to StoredValue::getRequiredStorage
@@ -132,10 +135,17 @@ TYPED_TEST(ValueTest, getRequiredStorage) {
 TEST(StoredValueTest, expectedSize) {
     EXPECT_EQ(56, sizeof(StoredValue))
             << "Unexpected change in StoredValue fixed size";
+    EXPECT_EQ(54, StoredValue::getKeyOffset())
+            << "Unexpected change in StoredValue key offset";
+    // The key starts in the tail padding (2 bytes).
     auto item = make_item(0, makeStoredDocKey("k"), "v");
-    EXPECT_EQ(59, StoredValue::getRequiredStorage(item))
+    EXPECT_EQ(57, StoredValue::getRequiredStorage(item))
             << "Unexpected change in StoredValue storage size for item: "
             << item;
+    auto item2 = make_item(0, makeStoredDocKey("key_0123456"), "v");
+    EXPECT_EQ(67, StoredValue::getRequiredStorage(item2))
+            << "Unexpected change in StoredValue storage size for item: "
+            << item2;
 }
 
 TEST(OrderedStoredValueTest, expectedSize) {
@@ -146,3 +156,61 @@ TEST(OrderedStoredValueTest, expectedSize) {
             << "Unexpected change in OrderedStoredValue storage size for item: "
             << item;
 }
+
+// Check that bySeqno (stored in 48 bits) round-trips, including the negative
+// special values, and that out-of-range values are rejected. revSeqno is set
+// by clients (e.g. XDCR via SetWithMeta), so must accept any 64-bit value.
+TYPED_TEST(ValueTest, packedSeqnos) {
+    const int64_t maxSeqno = (int64_t(1) << 47) - 1;
+    this->sv->setBySeqno(maxSeqno);
+    EXPECT_EQ(maxSeqno, this->sv->getBySeqno());
+    this->sv->setRevSeqno(std::numeric_limits<uint64_t>::max());
+    EXPECT_EQ(std::numeric_limits<uint64_t>::max(), this->sv->getRevSeqno());
+
+    this->sv->setNonExistent();
+    EXPECT_TRUE(this->sv->isTempNonExistentItem());
+    EXPECT_EQ(StoredValue::state_non_existent_key, this->sv->getBySeqno());
+
+    EXPECT_THROW(this->sv->setBySeqno(maxSeqno + 1), std::out_of_range);
+    EXPECT_EQ(std::numeric_limits<uint64_t>::max(), this->sv->getRevSeqno());
+
+    // The key must be unaffected by any of the above.
+    EXPECT_EQ(makeStoredDocKey("key"), StoredDocKey(this->sv->getKey()));
+}
+
+// The key is stored in the tail padding directly after the last member of
+// StoredValue. Check that setting every field to a non-default value leaves
+// a key which spans the tail padding intact.
+TYPED_TEST(ValueTest, keyUnaffectedByFields) {
+    const auto key = makeStoredDocKey("key_0123456789");
+    auto longItem = make_item(0, key, "value");
+    auto sv = this->factory(longItem, {});
+
+    sv->setCas(std::numeric_limits<uint64_t>::max());
+    sv->setRevSeqno(std::numeric_limits<uint64_t>::max());
+    sv->setBySeqno((int64_t(1) << 47) - 1);
+    sv->lock(std::numeric_limits<rel_time_t>::max());
+    sv->setExptime(std::numeric_limits<uint32_t>::max());
+    sv->setFlags(std::numeric_limits<uint32_t>::max());
+    sv->setDatatype(PROTOCOL_BINARY_DATATYPE_JSON |
+                    PROTOCOL_BINARY_DATATYPE_SNAPPY |
+                    PROTOCOL_BINARY_DATATYPE_XATTR);
+    sv->markDirty();
+    sv->setNewCacheItem(false);
+    sv->setNRUValue(MAX_NRU_VALUE);
+    sv->setFreqCounterValue(std::numeric_limits<uint8_t>::max());
+    sv->markDeleted();
+
+    // 'stale' can only be set on an OrderedStoredValue.
+    std::mutex seqListWriteLock;
+    if (std::is_same<TypeParam, OrderedStoredValueFactory>::value) {
+        std::lock_guard<std::mutex> writeGuard(seqListWriteLock);
+        sv->toOrderedStoredValue()->markStale(writeGuard, this->sv.get());
+    }
+
+    EXPECT_EQ(key, StoredDocKey(sv->getKey()));
+    EXPECT_EQ(std::numeric_limits<uint8_t>::max(), sv->getFreqCounterValue());
+    EXPECT_EQ(MAX_NRU_VALUE, sv->getNRUValue());
+    EXPECT_EQ(std::numeric_limits<uint64_t>::max(), sv->getCas());
+    EXPECT_EQ(std::numeric_limits<uint64_t>::max(), sv->getRevSeqno());
+}
@@ -47,11 +47,11 @@ void VBucketTest::SetUp() {
                                 eviction_policy));
 }
 
-void VBucketTest::TearDown() {
+void VBucketTestBase::TearDown() {
     vbucket.reset();
 }
 
-std::vector<StoredDocKey> VBucketTest::generateKeys(int num, int start) {
+std::vector<StoredDocKey> VBucketTestBase::generateKeys(int num, int start) {
     std::vector<StoredDocKey> rv;
 
     for (int i = start; i < num + start; i++) {
@@ -61,35 +61,37 @@ std::vector<StoredDocKey> VBucketTest::generateKeys(int num, int start) {
     return rv;
 }
 
-AddStatus VBucketTest::addOne(const StoredDocKey& k, int expiry) {
+AddStatus VBucketTestBase::addOne(const StoredDocKey& k, int expiry) {
     Item i(k, 0, expiry, k.data(), k.size());
     return public_processAdd(i);
 }
 
-AddStatus VBucketTest::addOneTemp(const StoredDocKey& k) {
+AddStatus VBucketTestBase::addOneTemp(const StoredDocKey& k) {
     auto hbl_sv = lockAndFind(k);
     return vbucket->addTempStoredValue(hbl_sv.first, k);
 }
 
-void VBucketTest::addMany(std::vector<StoredDocKey>& keys, AddStatus expect) {
+void VBucketTestBase::addMany(std::vector<StoredDocKey>& keys,
+                              AddStatus expect) {
     for (const auto& k : keys) {
         EXPECT_EQ(expect, addOne(k));
     }
 }
 
-MutationStatus VBucketTest::setOne(const StoredDocKey& k, int expiry) {
+MutationStatus VBucketTestBase::setOne(const StoredDocKey& k, int expiry) {
     Item i(k, 0, expiry, k.data(), k.size());
     return public_processSet(i, i.getCas());
 }
 
-void VBucketTest::setMany(std::vector<StoredDocKey>& keys,
-                          MutationStatus expect) {
+void VBucketTestBase::setMany(std::vector<StoredDocKey>& keys,
+                              MutationStatus expect) {
     for (const auto& k : keys) {
         EXPECT_EQ(expect, setOne(k));
     }
 }
 
-void VBucketTest::softDeleteOne(const StoredDocKey& k, MutationStatus expect) {
+void VBucketTestBase::softDeleteOne(const StoredDocKey& k,
+                                    MutationStatus expect) {
     StoredValue* v(vbucket->ht.find(k, TrackReference::No, WantsDeleted::No));
     EXPECT_NE(nullptr, v);
 
@@ -97,21 +99,21 @@ void VBucketTest::softDeleteOne(const StoredDocKey& k, MutationStatus expect) {
             << "Failed to soft delete key " << k.c_str();
 }
 
-void VBucketTest::softDeleteMany(std::vector<StoredDocKey>& keys,
-                                 MutationStatus expect) {
+void VBucketTestBase::softDeleteMany(std::vector<StoredDocKey>& keys,
+                                     MutationStatus expect) {
     for (const auto& k : keys) {
         softDeleteOne(k, expect);
     }
 }
 
-StoredValue* VBucketTest::findValue(StoredDocKey& key) {
+StoredValue* VBucketTestBase::findValue(StoredDocKey& key) {
     return vbucket->ht.find(key, TrackReference::Yes, WantsDeleted::Yes);
 }
 
-void VBucketTest::verifyValue(StoredDocKey& key,
-                              const char* value,
-                              TrackReference trackReference,
-                              WantsDeleted wantDeleted) {
+void VBucketTestBase::verifyValue(StoredDocKey& key,
+                                  const char* value,
+                                  TrackReference trackReference,
+                                  WantsDeleted wantDeleted) {
     StoredValue* v = vbucket->ht.find(key, trackReference, wantDeleted);
     EXPECT_NE(nullptr, v);
     value_t val = v->getValue();
@@ -122,15 +124,16 @@ void VBucketTest::verifyValue(StoredDocKey& key,
     }
 }
 
-std::pair<HashTable::HashBucketLock, StoredValue*> VBucketTest::lockAndFind(
-        const StoredDocKey& key) {
+std::pair<HashTable::HashBucketLock, StoredValue*>
+VBucketTestBase::lockAndFind(const StoredDocKey& key) {
     auto hbl = vbucket->ht.getLockedBucket(key);
     auto* storedVal = vbucket->ht.unlocked_find(
             key, hbl.getBucketNum(), WantsDeleted::Yes, TrackReference::No);
     return std::make_pair(std::move(hbl), storedVal);
 }
 
-MutationStatus VBucketTest::public_processSet(Item& itm, const uint64_t cas) {
+MutationStatus VBucketTestBase::public_processSet(Item& itm,
+                                                  const uint64_t cas) {
     auto hbl_sv = lockAndFind(itm.getKey());
     VBQueueItemCtx queueItmCtx(GenerateBySeqno::Yes,
                                GenerateCas::No,
@@ -148,7 +151,7 @@ MutationStatus VBucketTest::public_processSet(Item& itm, const uint64_t cas) {
             .first;
 }
 
-AddStatus VBucketTest::public_processAdd(Item& itm) {
+AddStatus VBucketTestBase::public_processAdd(Item& itm) {
     auto hbl_sv = lockAndFind(itm.getKey());
     VBQueueItemCtx queueItmCtx(GenerateBySeqno::Yes,
                                GenerateCas::No,
@@ -165,9 +168,9 @@ AddStatus VBucketTest::public_processAdd(Item& itm) {
             .first;
 }
 
-MutationStatus VBucketTest::public_processSoftDelete(const DocKey& key,
-                                                     StoredValue* v,
-                                                     uint64_t cas) {
+MutationStatus VBucketTestBase::public_processSoftDelete(const DocKey& key,
+                                                         StoredValue* v,
+                                                         uint64_t cas) {
     auto hbl = vbucket->ht.getLockedBucket(key);
     if (!v) {
         v = vbucket->ht.unlocked_find(
@@ -194,7 +197,7 @@ MutationStatus VBucketTest::public_processSoftDelete(const DocKey& key,
     return status;
 }
 
-bool VBucketTest::public_deleteStoredValue(const DocKey& key) {
+bool VBucketTestBase::public_deleteStoredValue(const DocKey& key) {
     auto hbl_sv = lockAndFind(key);
     if (!hbl_sv.second) {
         return false;
@@ -202,8 +205,8 @@ bool VBucketTest::public_deleteStoredValue(const DocKey& key) {
     return vbucket->deleteStoredValue(hbl_sv.first, *hbl_sv.second);
 }
 
-GetValue VBucketTest::public_getAndUpdateTtl(const DocKey& key,
-                                             time_t exptime) {
+GetValue VBucketTestBase::public_getAndUpdateTtl(const DocKey& key,
+                                                 time_t exptime) {
     auto hbl = lockAndFind(key);
     GetValue gv;
     MutationStatus status;
@@ -40,16 +40,11 @@ public:
 };
 
 /**
- * Test fixture for VBucket tests.
- *
- * Templated on the Item Eviction policy to use.
+ * Base of the test fixtures for VBucket tests; the fixture's SetUp creates
+ * the vbucket.
  */
-class VBucketTest
-        : public ::testing::Test,
-          public ::testing::WithParamInterface<item_eviction_policy_t> {
+class VBucketTestBase : public ::testing::Test {
 protected:
-    void SetUp();
-
     void TearDown();
 
     std::vector<StoredDocKey> generateKeys(int num, int start = 0);
@@ -96,6 +91,18 @@ protected:
     Configuration config;
 };
 
+/**
+ * Test fixture for VBucket tests.
+ *
+ * Templated on the Item Eviction policy to use.
+ */
+class VBucketTest
+        : public VBucketTestBase,
+          public ::testing::WithParamInterface<item_eviction_policy_t> {
+protected:
+    void SetUp();
+};
+
 class EPVBucketTest : public VBucketTest {
 protected:
     size_t public_queueBGFetchItem(
@@ -1202,6 +1202,9 @@ EWB_Engine::EWB_Engine(GET_SERVER_API gsa_)
     ENGINE_HANDLE_V1::release = release;
     ENGINE_HANDLE_V1::get = get;
     ENGINE_HANDLE_V1::get_if = get_if;
+    // Not implemented so that every get is routed through get() (and hence
+    // is subject to the injected errors); the core falls back to get().
+    ENGINE_HANDLE_V1::get_multi = nullptr;
     ENGINE_HANDLE_V1::get_locked = get_locked;
     ENGINE_HANDLE_V1::get_and_touch = get_and_touch;
     ENGINE_HANDLE_V1::unlock = unlock;
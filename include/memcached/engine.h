@@ -9,6 +9,7 @@
 #include <memory>
 #include <sys/types.h>
 #include <utility>
+#include <vector>
 
 #include "memcached/allocator_hooks.h"
 #include "memcached/callback.h"
@@ -203,6 +204,15 @@ class ItemDeleter;
 typedef std::unique_ptr<item, ItemDeleter> unique_item_ptr;
 
 using EngineErrorItemPair = std::pair<cb::engine_errc, cb::unique_item_ptr>;
+
+/**
+ * A single key (and the vbucket it lives in) requested through
+ * ENGINE_HANDLE_V1::get_multi.
+ */
+struct GetMultiKey {
+    DocKey key;
+    uint16_t vbucket;
+};
 }
 
 /**
@@ -365,6 +375,35 @@ typedef struct engine_interface_v1 {
                                    uint16_t vbucket,
                                    DocStateFilter documentStateFilter);
 
+    /**
+     * Retrieve a batch of items.
+     *
+     * Semantically the same as calling get() for each key in turn, but
+     * allows the engine to amortise per-request costs over the batch (e.g.
+     * look up each vbucket once and schedule all of the background fetches
+     * for the batch together).
+     *
+     * This entry point is optional; if it is nullptr the core falls back
+     * to calling get() for each key.
+     *
+     * @param handle the engine handle
+     * @param cookie The cookie provided by the frontend
+     * @param keys the keys (and their vbuckets) to look up
+     * @param documentStateFilter The documents to return must be in any of
+     *                            these states (see get())
+     *
+     * @return one result per key, in the same order as `keys`. Keys which
+     *         could not be satisfied without blocking are returned as
+     *         cb::engine_errc::would_block; if there are any such keys the
+     *         engine calls notify_io_complete for the cookie exactly once,
+     *         when all of them may be retried with get().
+     */
+    std::vector<cb::EngineErrorItemPair> (*get_multi)(
+            ENGINE_HANDLE* handle,
+            const void* cookie,
+            const std::vector<cb::GetMultiKey>& keys,
+            DocStateFilter documentStateFilter);
+
     /**
      * Optionally retrieve an item. Only non-deleted items may be fetched
      * through this interface (Documents in deleted state may be evicted
@@ -26,6 +26,8 @@
 #include <memcached/protocol_binary.h>
 #include <protocol/connection/client_mcbp_connection.h>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 static uint32_t getValue(cJSON *root, const char *key) {
     cJSON *obj = cJSON_GetObjectItem(root, key);
@@ -107,6 +109,14 @@ public:
             dump("s ", 80, 0, wayout[4]);
         }
         std::cout << "Total: " << total << " operations" << std::endl;
+
+        if (!percentiles.empty()) {
+            std::cout << "Percentiles:";
+            for (const auto& p : percentiles) {
+                std::cout << " p" << p.first << " " << formatDuration(p.second);
+            }
+            std::cout << std::endl;
+        }
     }
 
 private:
@@ -179,6 +189,15 @@ private:
             oldwayout = true;
         }
 
+        // Percentiles (in ns) are only reported by newer servers, and only
+        // for command timings.
+        obj = cJSON_GetObjectItem(root, "percentiles");
+        if (obj != nullptr) {
+            for (auto* p = obj->child; p != nullptr; p = p->next) {
+                percentiles.emplace_back(p->string, p->valuedouble);
+            }
+        }
+
         // Calculate total and cumulative counts, and find the highest value.
         max = total = 0;
 
@@ -197,6 +216,24 @@ private:
         }
     }
 
+    // Format a duration in nanoseconds with the largest unit it has at
+    // least one of.
+    static std::string formatDuration(double nsec) {
+        char buffer[32];
+        if (nsec < 1000.0) {
+            snprintf(buffer, sizeof(buffer), "%.0fns", nsec);
+        } else if (nsec < 1000.0 * 1000.0) {
+            snprintf(buffer, sizeof(buffer), "%.2fus", nsec / 1000.0);
+        } else if (nsec < 1000.0 * 1000.0 * 1000.0) {
+            snprintf(buffer, sizeof(buffer), "%.2fms",
+                     nsec / (1000.0 * 1000.0));
+        } else {
+            snprintf(buffer, sizeof(buffer), "%.2fs",
+                     nsec / (1000.0 * 1000.0 * 1000.0));
+        }
+        return buffer;
+    }
+
     void dump(const char *timeunit, uint32_t low, uint32_t high,
               const Bin& value)
     {
@@ -249,6 +286,9 @@ private:
     bool oldwayout;
 
     uint64_t total;
+
+    // Percentile (e.g. "99.9") and the duration in ns at it
+    std::vector<std::pair<std::string, double>> percentiles;
 };
 
 std::string opcode2string(uint8_t opcode) {
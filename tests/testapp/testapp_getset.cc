@@ -681,3 +681,44 @@ TEST_P(GetSetTest, TestPrepepndCompressedSourceAndData) {
     memset(expected.data() + input.size(), 'a', append.size());
     EXPECT_EQ(expected, stored.value);
 }
+
+TEST_P(GetSetTest, TestSetLargeValue) {
+    // Values which don't fit in the read buffer are received straight into
+    // the item; make sure they're stored intact
+    MemcachedConnection& conn = getConnection();
+    const std::string content =
+            "{\"value\":\"" + std::string(500 * 1024, 'x') + "\"}";
+    document.value.assign(content.begin(), content.end());
+
+    const auto info = conn.mutate(document, 0, MutationType::Set);
+    auto stored = conn.get(name, 0);
+    EXPECT_EQ(info.cas, stored.info.cas);
+    EXPECT_EQ(cb::mcbp::Datatype::JSON, stored.info.datatype);
+    EXPECT_EQ(document.info.flags, stored.info.flags);
+    EXPECT_EQ(document.value, stored.value);
+
+    // And replace it with a non-JSON value using CAS
+    document.value.assign(700 * 1024, 'y');
+    document.info.datatype = cb::mcbp::Datatype::Raw;
+    document.info.cas = info.cas;
+    conn.mutate(document, 0, MutationType::Replace);
+    stored = conn.get(name, 0);
+    EXPECT_EQ(cb::mcbp::Datatype::Raw, stored.info.datatype);
+    EXPECT_EQ(document.value, stored.value);
+}
+
+TEST_P(GetSetTest, TestReplaceLargeValueWithXattr) {
+    auto& conn = getConnection();
+    document.value.assign(100 * 1024, 'a');
+    conn.mutate(document, 0, MutationType::Add);
+    createXattr("meta.cas", "\"${Mutation.CAS}\"", true);
+    const auto mutation_cas = getXattr("meta.cas");
+
+    // The existing xattrs have to go in front of the value, so it can't be
+    // stored in the item it was received into
+    document.value.assign(200 * 1024, 'b');
+    conn.mutate(document, 0, MutationType::Replace);
+    EXPECT_EQ(mutation_cas, getXattr("meta.cas"));
+    const auto stored = conn.get(name, 0);
+    EXPECT_EQ(document.value, stored.value);
+}
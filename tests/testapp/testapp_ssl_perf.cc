@@ -0,0 +1,131 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Performance tests for establishing SSL connections.
+ *
+ * Each test opens IterationCount connections to the SSL port one after
+ * another, completes the TLS handshake and closes the connection again:
+ *
+ * - FullHandshake: every connection negotiates a new session.
+ * - Resumption: every connection offers the session of the previous one,
+ *               which the server should accept (an abbreviated handshake).
+ *
+ * The rate of handshakes is recorded as the "handshakes_per_sec" property.
+ */
+
+#include "testapp.h"
+
+#include <openssl/ssl.h>
+
+#include <chrono>
+
+static const int IterationCount = 500;
+
+#ifdef THREAD_SANITIZER
+static const int ReductionFactor = 20;
+#else
+static const int ReductionFactor = 1;
+#endif
+
+class SslPerfTest : public TestappTest {
+public:
+    void SetUp() {
+        TestappTest::SetUp();
+        iterations = IterationCount / ReductionFactor;
+        ctx = SSL_CTX_new(SSLv23_client_method());
+        ASSERT_NE(nullptr, ctx);
+    }
+
+    void TearDown() {
+        SSL_CTX_free(ctx);
+        TestappTest::TearDown();
+    }
+
+protected:
+    /**
+     * Connect to the SSL port and run the TLS handshake.
+     *
+     * @param session the session to offer the server (may be nullptr)
+     * @param reused set to whether the server resumed the session
+     * @return the session negotiated (owned by the caller)
+     */
+    SSL_SESSION* handshake(SSL_SESSION* session, bool& reused) {
+        SOCKET sock = create_connect_plain_socket(ssl_port);
+        EXPECT_NE(INVALID_SOCKET, sock);
+
+        SSL* ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, int(sock));
+        if (session != nullptr) {
+            SSL_set_session(ssl, session);
+        }
+        EXPECT_EQ(1, SSL_connect(ssl));
+        reused = SSL_session_reused(ssl) == 1;
+
+        SSL_SESSION* ret = SSL_get1_session(ssl);
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+        closesocket(sock);
+        return ret;
+    }
+
+    void recordRate(std::chrono::steady_clock::duration elapsed) {
+        const auto usec = std::chrono::duration_cast<std::chrono::microseconds>(
+                                  elapsed).count();
+        if (usec > 0) {
+            RecordProperty("handshakes_per_sec",
+                           int(uint64_t(iterations) * 1000000 / usec));
+        }
+    }
+
+    size_t iterations;
+    SSL_CTX* ctx = nullptr;
+};
+
+TEST_F(SslPerfTest, FullHandshake) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t ii = 0; ii < iterations; ++ii) {
+        bool reused;
+        SSL_SESSION_free(handshake(nullptr, reused));
+        EXPECT_FALSE(reused);
+    }
+    recordRate(std::chrono::steady_clock::now() - start);
+}
+
+TEST_F(SslPerfTest, Resumption) {
+    bool reused;
+    SSL_SESSION* session = handshake(nullptr, reused);
+    ASSERT_NE(nullptr, session);
+
+    size_t resumed = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t ii = 0; ii < iterations; ++ii) {
+        SSL_SESSION* next = handshake(session, reused);
+        SSL_SESSION_free(session);
+        session = next;
+        ASSERT_NE(nullptr, session);
+        if (reused) {
+            ++resumed;
+        }
+    }
+    recordRate(std::chrono::steady_clock::now() - start);
+    SSL_SESSION_free(session);
+
+    // All of the connections use the server's shared context, so every
+    // session should have been resumed
+    EXPECT_EQ(iterations, resumed);
+}
@@ -16,6 +16,9 @@
  */
 #include "testapp_stats.h"
 
+#include <thread>
+#include <vector>
+
 INSTANTIATE_TEST_CASE_P(TransportProtocols,
                         StatsTest,
                         ::testing::Values(TransportProtocols::McbpPlain,
@@ -97,6 +100,129 @@ TEST_P(StatsTest, TestReset) {
     conn.reconnect();
 }
 
+/**
+ * Read a numeric stat from the default stats.
+ */
+static uint64_t getDefaultStat(const unique_cJSON_ptr& stats,
+                               const char* name) {
+    auto* value = cJSON_GetObjectItem(stats.get(), name);
+    EXPECT_NE(nullptr, value) << name;
+    if (value == nullptr) {
+        return 0;
+    }
+    EXPECT_EQ(cJSON_Number, value->type) << name;
+    return uint64_t(value->valuedouble);
+}
+
+/**
+ * Run a command on the connection (a GET of a document which doesn't
+ * exist), so that it needs its network buffers.
+ */
+static void getMissingDocument(MemcachedConnection& conn) {
+    try {
+        conn.get("StatsTest_missing", 0);
+        FAIL() << "Document should not exist";
+    } catch (const ConnectionError& error) {
+        EXPECT_TRUE(error.isNotFound()) << error.what();
+    }
+}
+
+/**
+ * Idle connections hand their network buffers back to the worker thread's
+ * pool; the memory used by the buffers is reported in the default stats.
+ */
+TEST_P(StatsTest, TestNetworkBufferStats) {
+    MemcachedConnection& conn = getConnection();
+    getMissingDocument(conn);
+
+    // The connection running the stats command holds its buffers, every
+    // other (idle) connection should hold none.
+    auto stats = conn.stats("");
+    const uint64_t outstanding =
+            getDefaultStat(stats, "network_buffers_outstanding_bytes");
+    EXPECT_LT(0, outstanding);
+
+    // Serve a number of clients, which then go idle.
+    const int numClients = 16;
+    std::vector<std::unique_ptr<MemcachedConnection>> clients;
+    for (int ii = 0; ii < numClients; ++ii) {
+        clients.push_back(conn.clone());
+        getMissingDocument(*clients.back());
+    }
+
+    // A client receives its response before the connection has gone idle
+    // (and given back its buffers), so allow the server a moment.
+    uint64_t nowOutstanding = 0;
+    for (int ii = 0; ii < 1000; ++ii) {
+        stats = conn.stats("");
+        nowOutstanding =
+                getDefaultStat(stats, "network_buffers_outstanding_bytes");
+        if (nowOutstanding <= outstanding) {
+            break;
+        }
+        usleep(1000);
+    }
+    EXPECT_LE(nowOutstanding, outstanding)
+            << "Idle connections should not hold network buffers";
+
+    // ... their buffers are kept by the worker threads for reuse.
+    EXPECT_LT(0, getDefaultStat(stats, "network_buffers_pooled_bytes"));
+}
+
+/**
+ * Notifications to a worker thread which already has a wakeup pending are
+ * coalesced into it; the wakeups sent and saved are in the default stats.
+ */
+TEST_P(StatsTest, TestWorkerWakeupStats) {
+    MemcachedConnection& conn = getConnection();
+    auto stats = conn.stats("");
+    const uint64_t sent = getDefaultStat(stats, "worker_wakeups");
+    const uint64_t coalesced = getDefaultStat(stats,
+                                              "worker_wakeups_coalesced");
+
+    // Connect bursts of clients at the same time. Each new connection is
+    // handed to its worker thread with a notification; those arriving
+    // while the thread already has a wakeup pending are coalesced. Whether
+    // that happens depends on scheduling, so retry a few times.
+    const int numThreads = 4;
+    const int clientsPerThread = 16;
+    int bursts = 0;
+    uint64_t nowSent = sent;
+    uint64_t nowCoalesced = coalesced;
+    while (bursts < 10 && nowCoalesced == coalesced) {
+        std::vector<std::thread> threads;
+        for (int tt = 0; tt < numThreads; ++tt) {
+            threads.emplace_back([&conn, clientsPerThread]() {
+                std::vector<std::unique_ptr<MemcachedConnection>> clients;
+                for (int ii = 0; ii < clientsPerThread; ++ii) {
+                    clients.push_back(conn.clone());
+                }
+                // Every client must still be served (none of the wakeups
+                // were lost).
+                for (auto& client : clients) {
+                    getMissingDocument(*client);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        ++bursts;
+
+        stats = conn.stats("");
+        nowSent = getDefaultStat(stats, "worker_wakeups");
+        nowCoalesced = getDefaultStat(stats, "worker_wakeups_coalesced");
+    }
+
+    EXPECT_LT(sent, nowSent);
+    EXPECT_LT(coalesced, nowCoalesced)
+            << "No wakeups coalesced in " << bursts << " bursts";
+    // Each of the new connections needed a notification, either sent or
+    // coalesced.
+    EXPECT_LE(uint64_t(bursts * numThreads * clientsPerThread),
+              (nowSent - sent) + (nowCoalesced - coalesced));
+}
+
 /**
  * MB-17815: The cmd_set stat is incremented multiple times if the underlying
  * engine returns EWOULDBLOCK (which would happen for all operations when
@@ -0,0 +1,148 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2017 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "daemon/log_linear_histogram.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// Every value maps into a bucket whose bounds contain it, and the buckets
+// are contiguous.
+TEST(LogLinearHistogramTest, BucketBounds) {
+    for (size_t ii = 0; ii < LogLinearHistogram::NumBuckets; ++ii) {
+        const auto lower = LogLinearHistogram::getBucketLowerBound(ii);
+        const auto upper = LogLinearHistogram::getBucketUpperBound(ii);
+        EXPECT_EQ(ii, LogLinearHistogram::getBucketIndex(lower));
+        EXPECT_EQ(ii, LogLinearHistogram::getBucketIndex(upper));
+        if (ii + 1 < LogLinearHistogram::NumBuckets) {
+            EXPECT_EQ(upper + 1,
+                      LogLinearHistogram::getBucketLowerBound(ii + 1));
+        }
+    }
+}
+
+// Bucket widths never exceed 1/64th of the values they hold.
+TEST(LogLinearHistogramTest, RelativeError) {
+    for (size_t ii = 0; ii < LogLinearHistogram::NumBuckets; ++ii) {
+        const auto lower = LogLinearHistogram::getBucketLowerBound(ii);
+        const auto upper = LogLinearHistogram::getBucketUpperBound(ii);
+        EXPECT_LE((upper - lower + 1) * 64, std::max(lower, hrtime_t(64)));
+    }
+}
+
+TEST(LogLinearHistogramTest, HugeValuesUseLastBucket) {
+    EXPECT_EQ(LogLinearHistogram::NumBuckets - 1,
+              LogLinearHistogram::getBucketIndex(hrtime_t(-1)));
+}
+
+TEST(LogLinearHistogramTest, Percentiles) {
+    LogLinearHistogram histogram;
+    // 1..10000 us
+    for (hrtime_t ii = 1; ii <= 10000; ++ii) {
+        histogram.add(ii * 1000);
+    }
+    EXPECT_EQ(10000, histogram.getTotal());
+
+    LogLinearHistogram::Counts counts(LogLinearHistogram::NumBuckets);
+    histogram.aggregate(counts);
+
+    const std::pair<double, hrtime_t> expected[] = {{50.0, 5000000},
+                                                    {99.0, 9900000},
+                                                    {99.9, 9990000},
+                                                    {100.0, 10000000}};
+    for (const auto& e : expected) {
+        const auto actual =
+                LogLinearHistogram::getPercentile(counts, e.first);
+        EXPECT_GE(actual, e.second) << "p" << e.first;
+        EXPECT_LE(actual, e.second + e.second / 64) << "p" << e.first;
+    }
+}
+
+TEST(LogLinearHistogramTest, AggregateSumsHistograms) {
+    LogLinearHistogram a;
+    LogLinearHistogram b;
+    a.add(100);
+    b.add(100);
+    b.add(1000000);
+
+    LogLinearHistogram::Counts counts(LogLinearHistogram::NumBuckets);
+    a.aggregate(counts);
+    b.aggregate(counts);
+    EXPECT_EQ(2, counts[LogLinearHistogram::getBucketIndex(100)]);
+    EXPECT_EQ(1, counts[LogLinearHistogram::getBucketIndex(1000000)]);
+
+    a.reset();
+    EXPECT_EQ(0, a.getTotal());
+}
+
+// A reset from another thread hides the counts straight away, and the
+// writer drops them the next time it adds a value.
+TEST(LogLinearHistogramTest, ResetFromOtherThread) {
+    LogLinearHistogram histogram;
+    histogram.add(100);
+    histogram.add(1000);
+
+    std::thread([&histogram]() { histogram.reset(); }).join();
+    EXPECT_EQ(0, histogram.getTotal());
+    LogLinearHistogram::Counts counts(LogLinearHistogram::NumBuckets);
+    histogram.aggregate(counts);
+    EXPECT_EQ(0, std::count_if(counts.begin(), counts.end(),
+                               [](uint64_t count) { return count != 0; }));
+
+    histogram.add(100);
+    EXPECT_EQ(1, histogram.getTotal());
+    std::fill(counts.begin(), counts.end(), 0);
+    histogram.aggregate(counts);
+    EXPECT_EQ(1, counts[LogLinearHistogram::getBucketIndex(100)]);
+    EXPECT_EQ(0, counts[LogLinearHistogram::getBucketIndex(1000)]);
+}
+
+// Resets racing with the writer never leave the counts inconsistent once
+// the writer has caught up.
+TEST(LogLinearHistogramTest, ResetRacesWithWriter) {
+    LogLinearHistogram histogram;
+    std::atomic<bool> done{false};
+    std::thread resetter([&histogram, &done]() {
+        while (!done) {
+            histogram.reset();
+        }
+    });
+
+    for (int ii = 0; ii < 100000; ++ii) {
+        histogram.add(ii);
+    }
+    done = true;
+    resetter.join();
+
+    histogram.add(1);
+    LogLinearHistogram::Counts counts(LogLinearHistogram::NumBuckets);
+    histogram.aggregate(counts);
+    uint64_t sum = 0;
+    for (auto count : counts) {
+        sum += count;
+    }
+    EXPECT_EQ(histogram.getTotal(), sum);
+    EXPECT_LE(1, sum);
+}
+
+TEST(LogLinearHistogramTest, EmptyPercentile) {
+    LogLinearHistogram::Counts counts(LogLinearHistogram::NumBuckets);
+    EXPECT_EQ(0, LogLinearHistogram::getPercentile(counts, 99.0));
+    EXPECT_THROW(LogLinearHistogram::getPercentile(counts, 101.0),
+                 std::invalid_argument);
+}
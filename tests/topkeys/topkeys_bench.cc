@@ -17,13 +17,15 @@
 #include "daemon/topkeys.h"
 
 #include <gtest/gtest.h>
+#include <atomic>
 #include <memory>
+#include <thread>
 
 
 class TopKeysTest : public ::testing::Test {
 protected:
     void SetUp() {
-        topkeys.reset(new TopKeys(10));
+        topkeys.reset(new TopKeys(10, 4));
     }
 
     std::unique_ptr<TopKeys> topkeys;
@@ -46,7 +48,7 @@ TEST_F(TopKeysTest, Basic) {
     // loop inserting keys
     for (int jj = 0; jj < 20000; jj++) {
         for (auto& key : keys) {
-            topkeys->updateKey(key.c_str(), key.size(), jj);
+            topkeys->updateKey(key.c_str(), key.size(), jj, 0);
         }
     }
 
@@ -55,3 +57,93 @@ TEST_F(TopKeysTest, Basic) {
     topkeys->stats(&count, 0, dump_key);
     EXPECT_EQ(80, count);
 }
+
+// Keys accessed much more often than the others (by any of the threads)
+// should be reported, most frequent first, with counts within the error
+// bound.
+TEST_F(TopKeysTest, HeavyHitters) {
+    const int numThreads = 4;
+    const int iterations = 10000;
+    std::vector<std::thread> threads;
+    for (int tt = 0; tt < numThreads; tt++) {
+        threads.emplace_back([this, tt]() {
+            for (int jj = 0; jj < iterations; jj++) {
+                // One access to each of the hot keys (hot_0 twice), then
+                // ten accesses to keys no one else accesses.
+                // (All at the same time, so the counts don't decay.)
+                for (int hot = 0; hot < 3; hot++) {
+                    const std::string key = "hot_" + std::to_string(hot);
+                    topkeys->updateKey(key.c_str(), key.size(), 0, tt);
+                }
+                topkeys->updateKey("hot_0", 5, 0, tt);
+                for (int cold = 0; cold < 10; cold++) {
+                    const std::string key = "cold_" + std::to_string(tt) +
+                                            "_" + std::to_string(jj) + "_" +
+                                            std::to_string(cold);
+                    topkeys->updateKey(key.c_str(), key.size(), 0, tt);
+                }
+            }
+        });
+    }
+
+    // Reading the stats while the keys are updated must be safe.
+    size_t reads = 0;
+    while (reads < 10) {
+        topkeys->getTopKeys();
+        reads++;
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto top = topkeys->getTopKeys();
+    ASSERT_EQ(80, top.size());
+    EXPECT_EQ("hot_0", top[0].key);
+    for (int ii = 0; ii < 3; ii++) {
+        const uint32_t expected = (ii == 0 ? 2 : 1) * numThreads * iterations;
+        EXPECT_LE(expected, top[ii].count) << top[ii].key;
+        EXPECT_GE(expected + top[ii].error, top[ii].count) << top[ii].key;
+        EXPECT_LE(top[ii + 1].count, top[ii].count);
+    }
+}
+
+// Updates from a thread index without a summary are ignored.
+TEST_F(TopKeysTest, InvalidThread) {
+    topkeys->updateKey("key", 3, 0, 4);
+    topkeys->updateKey("key", 3, 0, -1);
+    EXPECT_TRUE(topkeys->getTopKeys().empty());
+}
+
+// The counts are halved every COUNT_HALF_LIFE seconds, so a key which was
+// hot in the past is overtaken by one which is hot now.
+TEST_F(TopKeysTest, CountsDecay) {
+    for (int ii = 0; ii < 1000; ii++) {
+        topkeys->updateKey("old", 3, 0, 0);
+    }
+    const rel_time_t later = 3 * TopKeys::COUNT_HALF_LIFE;
+    for (int ii = 0; ii < 200; ii++) {
+        topkeys->updateKey("new", 3, later, 0);
+    }
+
+    auto top = topkeys->getTopKeys();
+    ASSERT_EQ(2, top.size());
+    EXPECT_EQ("new", top[0].key);
+    EXPECT_EQ(200, top[0].count);
+    EXPECT_EQ("old", top[1].key);
+    EXPECT_EQ(1000 / 8, top[1].count);
+}
+
+// ctime is when the key started being tracked; atime when it was last
+// accessed (by any thread).
+TEST_F(TopKeysTest, AccessTime) {
+    topkeys->updateKey("key", 3, 10, 0);
+    topkeys->updateKey("key", 3, 20, 0);
+    topkeys->updateKey("key", 3, 30, 1);
+
+    auto top = topkeys->getTopKeys();
+    ASSERT_EQ(1, top.size());
+    EXPECT_EQ(3, top[0].count);
+    EXPECT_EQ(10, top[0].ctime);
+    EXPECT_EQ(30, top[0].atime);
+}
@@ -24,6 +24,7 @@
 #include "basic_engine_testsuite.h"
 
 #include <iostream>
+#include <thread>
 #include <vector>
 #include <sstream>
 
@@ -500,6 +501,86 @@ static enum test_result test_datatype(ENGINE_HANDLE *h, ENGINE_HANDLE_V1 *h1) {
     return SUCCESS;
 }
 
+static uint64_t curr_items;
+static void curr_items_stats_handler(const char *key, const uint16_t klen,
+                                     const char *val, const uint32_t vlen,
+                                     const void *cookie) {
+    if (klen == 10 && strncmp(key, "curr_items", klen) == 0) {
+        curr_items = std::stoull(std::string(val, vlen));
+    }
+}
+
+/*
+ * Store, get and remove from many threads at once. Every thread has keys of
+ * its own (enough of them in total that the hash table has to grow while
+ * they are being accessed), and all threads fight over a handful of shared
+ * keys. Each thread must be able to read back all of its own keys, and the
+ * sharded curr_items statistic must add up afterwards.
+ */
+static enum test_result concurrency_test(ENGINE_HANDLE *h, ENGINE_HANDLE_V1 *h1) {
+    const int n_threads = 4;
+    const int n_keys = 30000;
+    const int n_shared_keys = 16;
+
+    auto store = [h, h1](const std::string& name) {
+        item *test_item = NULL;
+        uint64_t cas = 0;
+        DocKey key(name, test_harness.doc_namespace);
+        cb_assert(h1->allocate(h, NULL, &test_item, key, 1, 0, 0,
+                               PROTOCOL_BINARY_RAW_BYTES, 0) == ENGINE_SUCCESS);
+        cb_assert(h1->store(h, NULL, test_item, &cas, OPERATION_SET,
+                            DocumentState::Alive) == ENGINE_SUCCESS);
+        h1->release(h, NULL, test_item);
+    };
+
+    auto remove = [h, h1](const std::string& name) {
+        uint64_t cas = 0;
+        mutation_descr_t mut_info;
+        DocKey key(name, test_harness.doc_namespace);
+        auto ret = h1->remove(h, NULL, key, &cas, 0, &mut_info);
+        cb_assert(ret == ENGINE_SUCCESS || ret == ENGINE_KEY_ENOENT);
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; ++t) {
+        threads.emplace_back([t, &store, &remove, h, h1]() {
+            const std::string prefix = "concurrency_" + std::to_string(t) + "_";
+            for (int ii = 0; ii < n_keys; ++ii) {
+                store(prefix + std::to_string(ii));
+
+                const std::string shared =
+                        "concurrency_shared_" + std::to_string(ii % n_shared_keys);
+                if (ii % 2 == t % 2) {
+                    store(shared);
+                } else {
+                    remove(shared);
+                }
+            }
+
+            for (int ii = 0; ii < n_keys; ++ii) {
+                DocKey key(prefix + std::to_string(ii),
+                           test_harness.doc_namespace);
+                auto ret = h1->get(h, NULL, key, 0, DocStateFilter::Alive);
+                cb_assert(ret.first == cb::engine_errc::success);
+                cb_assert(ret.second != nullptr);
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (int ii = 0; ii < n_shared_keys; ++ii) {
+        remove("concurrency_shared_" + std::to_string(ii));
+    }
+
+    cb_assert(h1->get_stats(h, NULL, NULL, 0,
+                            curr_items_stats_handler) == ENGINE_SUCCESS);
+    assert_equal(uint64_t(n_threads * n_keys), curr_items);
+    return SUCCESS;
+}
+
 /*
  * Destroy many buckets - this test is really more interesting with valgrind
  *  destroy should invoke a background cleaner thread and at exit time there
@@ -599,6 +680,7 @@ engine_test_t* get_tests(void) {
         TEST_CASE("get stats struct test", get_stats_struct_test, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE("aggregate stats test", aggregate_stats_test, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE("Test datatype", test_datatype, NULL, NULL, NULL, NULL, NULL),
+        TEST_CASE("concurrency test", concurrency_test, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE_V2("Bucket destroy", test_n_bucket_destroy, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE_V2("Bucket destroy interleaved", test_bucket_destroy_interleaved, NULL, NULL, NULL, NULL, NULL),
         TEST_CASE(NULL, NULL, NULL, NULL, NULL, NULL, NULL)